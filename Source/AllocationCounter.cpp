@@ -0,0 +1,104 @@
+///////////////////////////////////////////////////////////////////////////////
+// allocationcounter.cpp
+// ============
+// count the heap allocations made by each thread
+///////////////////////////////////////////////////////////////////////////////
+
+#include "AllocationCounter.h"
+
+#include <cstdlib>
+#include <new>
+
+// declaration of global variables
+namespace
+{
+	thread_local uint64_t g_ThreadAllocations = 0;
+	thread_local uint64_t g_ThreadBytes = 0;
+
+	/***********************************************************
+	 *  CountedAllocate()
+	 *
+	 *  This function is used for allocating from the heap and
+	 *  counting the allocation for the calling thread.
+	 *  Returns NULL when the heap is exhausted.
+	 ***********************************************************/
+	void* CountedAllocate(size_t size)
+	{
+		g_ThreadAllocations++;
+		g_ThreadBytes += size;
+		return(malloc((size > 0) ? size : 1));
+	}
+}
+
+/***********************************************************
+ *  GetThreadAllocations()
+ ***********************************************************/
+uint64_t AllocationCounter::GetThreadAllocations()
+{
+	return(g_ThreadAllocations);
+}
+
+/***********************************************************
+ *  GetThreadBytes()
+ ***********************************************************/
+uint64_t AllocationCounter::GetThreadBytes()
+{
+	return(g_ThreadBytes);
+}
+
+// the replaceable global allocation functions, every new and
+// delete in the program goes through these
+void* operator new(size_t size)
+{
+	void* pMemory = CountedAllocate(size);
+	if (NULL == pMemory)
+	{
+		throw std::bad_alloc();
+	}
+	return(pMemory);
+}
+
+void* operator new[](size_t size)
+{
+	return(operator new(size));
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	return(CountedAllocate(size));
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	return(CountedAllocate(size));
+}
+
+void operator delete(void* pMemory) noexcept
+{
+	free(pMemory);
+}
+
+void operator delete[](void* pMemory) noexcept
+{
+	free(pMemory);
+}
+
+void operator delete(void* pMemory, size_t) noexcept
+{
+	free(pMemory);
+}
+
+void operator delete[](void* pMemory, size_t) noexcept
+{
+	free(pMemory);
+}
+
+void operator delete(void* pMemory, const std::nothrow_t&) noexcept
+{
+	free(pMemory);
+}
+
+void operator delete[](void* pMemory, const std::nothrow_t&) noexcept
+{
+	free(pMemory);
+}
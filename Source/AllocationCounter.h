@@ -0,0 +1,26 @@
+///////////////////////////////////////////////////////////////////////////////
+// allocationcounter.h
+// ============
+// count the heap allocations made by each thread
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+
+/***********************************************************
+ *  AllocationCounter
+ *
+ *  This class reads the counts kept by the replaced global
+ *  operator new.  The counts are per thread, so the render
+ *  thread can check its frames for heap allocations while
+ *  the decode and rasterizer workers allocate freely.  The
+ *  difference of two readings is what ran in between.
+ ***********************************************************/
+class AllocationCounter
+{
+public:
+	// heap allocations and bytes the calling thread has made
+	static uint64_t GetThreadAllocations();
+	static uint64_t GetThreadBytes();
+};
@@ -0,0 +1,142 @@
+///////////////////////////////////////////////////////////////////////////////
+// animationmanager.cpp
+// ============
+// manage the part animations evaluated by the vertex shaders
+///////////////////////////////////////////////////////////////////////////////
+
+#include "AnimationManager.h"
+#include "GLTrace.h"
+#include "ResourceTracker.h"
+
+#include <cmath>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// name of the uniform block in the vertex shaders
+	const char* g_AnimationBlockName = "PartAnimations";
+	// the std140 block starts with the clock as a vec4
+	const GLsizeiptr g_ClockSize = 4 * sizeof(float);
+}
+
+/***********************************************************
+ *  AnimationManager()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+AnimationManager::AnimationManager()
+{
+	m_uniformBuffer = 0;
+	m_clock = -1.0f;
+}
+
+/***********************************************************
+ *  ~AnimationManager()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+AnimationManager::~AnimationManager()
+{
+	if (0 != m_uniformBuffer)
+	{
+		ResourceTracker::Release(RESOURCE_BUFFER, m_uniformBuffer);
+		glDeleteBuffers(1, &m_uniformBuffer);
+		m_uniformBuffer = 0;
+	}
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for creating the uniform buffer with
+ *  room for the clock and all the animation records, and
+ *  binding it to its binding point for good.  The whole
+ *  block is allocated so shaders never read past the end.
+ ***********************************************************/
+bool AnimationManager::Initialize()
+{
+	GLsizeiptr size = g_ClockSize + MAX_ANIMATIONS * sizeof(SCENE_ANIMATION_RECORD);
+
+	glGenBuffers(1, &m_uniformBuffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, m_uniformBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, size, NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	ResourceTracker::Track(RESOURCE_BUFFER, m_uniformBuffer, "animation", "animation records", (size_t)size);
+	glBindBufferBase(GL_UNIFORM_BUFFER, UNIFORM_BINDING, m_uniformBuffer);
+
+	m_clock = -1.0f;
+	SetTime(0.0);
+
+	return(m_uniformBuffer != 0);
+}
+
+/***********************************************************
+ *  SetAnimations()
+ *
+ *  This method is used for uploading the animation records.
+ *  The records already have the std140 layout, so they are
+ *  copied straight from the mapped scene file.
+ ***********************************************************/
+bool AnimationManager::SetAnimations(const SCENE_ANIMATION_RECORD* pRecords, uint32_t count)
+{
+	if (0 == m_uniformBuffer)
+	{
+		return(false);
+	}
+	if (count > (uint32_t)MAX_ANIMATIONS)
+	{
+		std::cout << "Scene has more than " << MAX_ANIMATIONS << " animated parts, the rest are not animated" << std::endl;
+		count = MAX_ANIMATIONS;
+	}
+	if (count == 0)
+	{
+		return(true);
+	}
+
+	GLTrace::BindBuffer(GL_UNIFORM_BUFFER, m_uniformBuffer);
+	GLTrace::BufferSubData(GL_UNIFORM_BUFFER, g_ClockSize, count * sizeof(SCENE_ANIMATION_RECORD), pRecords);
+	GLTrace::BindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	return(true);
+}
+
+/***********************************************************
+ *  SetTime()
+ *
+ *  This method is used for writing the animation clock.  The
+ *  clock wraps at the animation period, when every animation
+ *  is back at its start, so the float stays precise.
+ ***********************************************************/
+void AnimationManager::SetTime(double seconds)
+{
+	float clock = (float)std::fmod(seconds, SCENE_ANIMATION_PERIOD);
+	if ((0 == m_uniformBuffer) || (clock == m_clock))
+	{
+		return;
+	}
+	m_clock = clock;
+
+	float values[4] = { clock, 0.0f, 0.0f, 0.0f };
+	GLTrace::BindBuffer(GL_UNIFORM_BUFFER, m_uniformBuffer);
+	GLTrace::BufferSubData(GL_UNIFORM_BUFFER, 0, g_ClockSize, values);
+	GLTrace::BindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+/***********************************************************
+ *  BindShader()
+ *
+ *  This method is used for pointing the animation block of a
+ *  shader program at the binding point of the buffer.
+ ***********************************************************/
+bool AnimationManager::BindShader(ShaderManager* pShaderManager)
+{
+	GLuint blockIndex = glGetUniformBlockIndex(pShaderManager->m_programID, g_AnimationBlockName);
+	if (GL_INVALID_INDEX == blockIndex)
+	{
+		return(false);
+	}
+
+	glUniformBlockBinding(pShaderManager->m_programID, blockIndex, UNIFORM_BINDING);
+	return(true);
+}
@@ -0,0 +1,53 @@
+///////////////////////////////////////////////////////////////////////////////
+// animationmanager.h
+// ============
+// manage the part animations evaluated by the vertex shaders
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+#include "SceneFile.h"
+
+#include <GL/glew.h>
+
+#include <cstdint>
+
+/***********************************************************
+ *  AnimationManager
+ *
+ *  This class holds the uniform buffer with the animation
+ *  records of the scene parts and the animation clock.  The
+ *  records are uploaded once when the scene is loaded and
+ *  the vertex shaders spin and bob the animated parts from
+ *  the clock, so animated parts cost no matrix work on the
+ *  CPU.  Only the clock is written each frame.
+ ***********************************************************/
+class AnimationManager
+{
+public:
+	// must match MAX_PART_ANIMATIONS in the vertex shaders
+	static const int MAX_ANIMATIONS = 256;
+	// uniform buffer binding point of the animation block
+	static const GLuint UNIFORM_BINDING = 1;
+
+	// constructor
+	AnimationManager();
+	// destructor
+	~AnimationManager();
+
+	// create the uniform buffer - needs a current OpenGL context
+	bool Initialize();
+	// upload the animation records of the scene
+	bool SetAnimations(const SCENE_ANIMATION_RECORD* pRecords, uint32_t count);
+	// set the time the animations are shown at, in seconds
+	void SetTime(double seconds);
+
+	// connect the animation block of a shader to the buffer
+	static bool BindShader(ShaderManager* pShaderManager);
+
+private:
+	GLuint m_uniformBuffer;
+	// clock value last written to the buffer
+	float m_clock;
+};
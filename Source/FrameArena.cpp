@@ -0,0 +1,136 @@
+///////////////////////////////////////////////////////////////////////////////
+// framearena.cpp
+// ============
+// linear allocator for the scratch memory of one frame
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameArena.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+// declaration of global variables
+namespace
+{
+	// room at the start of an overflow block for the link to
+	// the previous one, kept aligned for any type
+	const size_t g_OverflowHeader = alignof(std::max_align_t);
+
+	/***********************************************************
+	 *  AlignUp()
+	 ***********************************************************/
+	size_t AlignUp(size_t value, size_t alignment)
+	{
+		return((value + alignment - 1) & ~(alignment - 1));
+	}
+}
+
+/***********************************************************
+ *  FrameArena()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameArena::FrameArena(size_t initialBytes)
+{
+	m_capacity = std::max<size_t>(initialBytes, 1);
+	m_pBlock = (uint8_t*)malloc(m_capacity);
+	if (NULL == m_pBlock)
+	{
+		m_capacity = 0;
+	}
+	m_offset = 0;
+	m_pOverflow = NULL;
+	m_overflowOffset = 0;
+	m_overflowCapacity = 0;
+	m_usedBytes = 0;
+	m_peakBytes = 0;
+}
+
+/***********************************************************
+ *  ~FrameArena()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameArena::~FrameArena()
+{
+	Reset();
+	free(m_pBlock);
+	m_pBlock = NULL;
+}
+
+/***********************************************************
+ *  Reset()
+ *
+ *  This method is used for releasing the memory of the
+ *  frame.  When the frame needed extra blocks, the main
+ *  block is grown to cover the most the frame used.
+ ***********************************************************/
+void FrameArena::Reset()
+{
+	if (NULL != m_pOverflow)
+	{
+		while (NULL != m_pOverflow)
+		{
+			uint8_t* pPrevious = *(uint8_t**)m_pOverflow;
+			free(m_pOverflow);
+			m_pOverflow = pPrevious;
+		}
+		m_overflowOffset = 0;
+		m_overflowCapacity = 0;
+
+		// alignment padding is not counted, so leave some room
+		size_t capacity = m_peakBytes + m_peakBytes / 4;
+		uint8_t* pBlock = (uint8_t*)malloc(capacity);
+		if (NULL != pBlock)
+		{
+			free(m_pBlock);
+			m_pBlock = pBlock;
+			m_capacity = capacity;
+		}
+	}
+
+	m_offset = 0;
+	m_usedBytes = 0;
+}
+
+/***********************************************************
+ *  Allocate()
+ *
+ *  This method is used for taking memory for the rest of
+ *  the frame.  The alignment must be a power of two.
+ *  Returns NULL when the heap is exhausted.
+ ***********************************************************/
+void* FrameArena::Allocate(size_t bytes, size_t alignment)
+{
+	if (0 == bytes)
+	{
+		bytes = 1;
+	}
+	m_usedBytes += bytes;
+	m_peakBytes = std::max(m_peakBytes, m_usedBytes);
+
+	size_t offset = AlignUp(m_offset, alignment);
+	if ((NULL != m_pBlock) && (offset + bytes <= m_capacity))
+	{
+		m_offset = offset + bytes;
+		return(m_pBlock + offset);
+	}
+
+	offset = AlignUp(m_overflowOffset, alignment);
+	if ((NULL == m_pOverflow) || (offset + bytes > m_overflowCapacity))
+	{
+		// at least double, so a growing frame takes few blocks
+		size_t capacity = std::max(g_OverflowHeader + bytes + alignment, std::max(m_capacity, m_overflowCapacity) * 2);
+		uint8_t* pOverflow = (uint8_t*)malloc(capacity);
+		if (NULL == pOverflow)
+		{
+			return(NULL);
+		}
+		*(uint8_t**)pOverflow = m_pOverflow;
+		m_pOverflow = pOverflow;
+		m_overflowCapacity = capacity;
+		offset = AlignUp(g_OverflowHeader, alignment);
+	}
+	m_overflowOffset = offset + bytes;
+	return(m_pOverflow + offset);
+}
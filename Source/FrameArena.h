@@ -0,0 +1,65 @@
+///////////////////////////////////////////////////////////////////////////////
+// framearena.h
+// ============
+// linear allocator for the scratch memory of one frame
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+/***********************************************************
+ *  FrameArena
+ *
+ *  This class hands out scratch memory that lives until the
+ *  end of the frame.  Allocating moves a pointer through one
+ *  block and Reset() releases everything at once.  A frame
+ *  that outgrows the block takes extra blocks from the heap,
+ *  and the next Reset() replaces them with one block of the
+ *  largest size used, so once the frames settle the arena
+ *  makes no heap allocations.  Nothing is destructed, so it
+ *  only holds trivially destructible types.
+ ***********************************************************/
+class FrameArena
+{
+public:
+	// constructor
+	FrameArena(size_t initialBytes = 64 * 1024);
+	// destructor
+	~FrameArena();
+
+	// release everything allocated since the last reset
+	void Reset();
+
+	// uninitialized memory, valid until the next reset
+	void* Allocate(size_t bytes, size_t alignment);
+	template <typename T>
+	T* AllocateArray(size_t count)
+	{
+		static_assert(std::is_trivially_destructible<T>::value, "arena memory is never destructed");
+		return((T*)Allocate(sizeof(T) * count, alignof(T)));
+	}
+
+	size_t GetUsedBytes() const { return m_usedBytes; }
+	size_t GetCapacity() const { return m_capacity; }
+
+private:
+	// the main block
+	uint8_t* m_pBlock;
+	size_t m_capacity;
+	size_t m_offset;
+	// extra blocks of the current frame, chained through their
+	// first bytes
+	uint8_t* m_pOverflow;
+	size_t m_overflowOffset;
+	size_t m_overflowCapacity;
+	// bytes handed out this frame
+	size_t m_usedBytes;
+	size_t m_peakBytes;
+
+	// not copyable, it owns the blocks
+	FrameArena(const FrameArena&);
+	FrameArena& operator=(const FrameArena&);
+};
@@ -0,0 +1,633 @@
+///////////////////////////////////////////////////////////////////////////////
+// framecapture.cpp
+// ============
+// record the rendered frames to disk without stalling the renderer
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameCapture.h"
+#include "ResourceTracker.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// largest block of a stored (uncompressed) deflate stream
+	const size_t g_MaxStoredBlock = 65535;
+	// owner of the readback memory in the resource tracker
+	const char* const g_TrackerName = "frame capture";
+
+	/***********************************************************
+	 *  GetCRCTable()
+	 *
+	 *  This function is used for building the CRC-32 table
+	 *  used by the PNG chunks the first time it is needed.
+	 ***********************************************************/
+	const unsigned int* GetCRCTable()
+	{
+		static unsigned int table[256];
+		static bool bBuilt = false;
+		static std::mutex mutex;
+
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!bBuilt)
+		{
+			for (unsigned int n = 0; n < 256; n++)
+			{
+				unsigned int c = n;
+				for (int k = 0; k < 8; k++)
+				{
+					c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+				}
+				table[n] = c;
+			}
+			bBuilt = true;
+		}
+		return(table);
+	}
+
+	/***********************************************************
+	 *  AppendBigEndian()
+	 *
+	 *  This function is used for adding a 32 bit value to the
+	 *  buffer in the byte order PNG uses.
+	 ***********************************************************/
+	void AppendBigEndian(std::vector<unsigned char>& buffer, unsigned int value)
+	{
+		buffer.push_back((unsigned char)(value >> 24));
+		buffer.push_back((unsigned char)(value >> 16));
+		buffer.push_back((unsigned char)(value >> 8));
+		buffer.push_back((unsigned char)(value));
+	}
+
+	/***********************************************************
+	 *  AppendChunk()
+	 *
+	 *  This function is used for adding a PNG chunk with its
+	 *  length, type, data and CRC to the buffer.
+	 ***********************************************************/
+	void AppendChunk(std::vector<unsigned char>& buffer, const char* type,
+		const unsigned char* data, size_t size)
+	{
+		const unsigned int* crcTable = GetCRCTable();
+
+		AppendBigEndian(buffer, (unsigned int)size);
+		size_t crcStart = buffer.size();
+		buffer.insert(buffer.end(), type, type + 4);
+		buffer.insert(buffer.end(), data, data + size);
+
+		unsigned int crc = 0xFFFFFFFFu;
+		for (size_t i = crcStart; i < buffer.size(); i++)
+		{
+			crc = crcTable[(crc ^ buffer[i]) & 0xFF] ^ (crc >> 8);
+		}
+		AppendBigEndian(buffer, crc ^ 0xFFFFFFFFu);
+	}
+}
+
+/***********************************************************
+ *  FrameCapture()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameCapture::FrameCapture()
+{
+	m_bInitialized = false;
+	m_format = CAPTURE_PNG;
+	m_width = 0;
+	m_height = 0;
+	m_nextSlot = 0;
+	m_pendingSlots = 0;
+	m_frameNumber = 0;
+	m_sequenceIndex = 0;
+	m_droppedFrames = 0;
+	m_bStopWorkers = false;
+	m_writtenFrames = 0;
+	m_bWriteFailed = false;
+	m_pYUVFile = NULL;
+	m_nextWriteSequence = 0;
+
+	for (int i = 0; i < TOTAL_READBACK_BUFFERS; i++)
+	{
+		m_slots[i].pixelBuffer = 0;
+		m_slots[i].fence = 0;
+		m_slots[i].frameNumber = 0;
+	}
+}
+
+/***********************************************************
+ *  ~FrameCapture()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameCapture::~FrameCapture()
+{
+	Shutdown();
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for starting the worker threads and
+ *  creating the frame pool.  The pool size bounds the system
+ *  memory used by frames waiting to be encoded.
+ ***********************************************************/
+bool FrameCapture::Initialize(
+	const std::string& outputDirectory,
+	CAPTURE_FORMAT format,
+	int workerThreads,
+	int maxQueuedFrames)
+{
+	if (true == m_bInitialized)
+	{
+		return(true);
+	}
+
+	m_outputDirectory = outputDirectory;
+	m_format = format;
+	m_frameBuffers.resize(std::max(1, maxQueuedFrames));
+	m_freeBuffers.clear();
+	for (int i = 0; i < (int)m_frameBuffers.size(); i++)
+	{
+		m_freeBuffers.push_back(i);
+	}
+
+	m_bStopWorkers = false;
+	for (int i = 0; i < std::max(1, workerThreads); i++)
+	{
+		m_workers.push_back(std::thread(&FrameCapture::WorkerLoop, this));
+	}
+
+	m_bInitialized = true;
+	std::cout << "Capturing frames to: " << m_outputDirectory
+		<< ((m_format == CAPTURE_YUV) ? " (YUV 4:2:0)" : " (PNG)") << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  CaptureFrame()
+ *
+ *  This method is used for starting the readback of the
+ *  current frame into the next pixel buffer of the ring and
+ *  handing the readbacks the GPU has finished to the worker
+ *  threads.  If every pixel buffer is still in flight the
+ *  frame is dropped rather than waiting for the GPU.
+ ***********************************************************/
+void FrameCapture::CaptureFrame(int width, int height)
+{
+	if ((false == m_bInitialized) || (width <= 0) || (height <= 0))
+	{
+		return;
+	}
+
+	if ((width != m_width) || (height != m_height))
+	{
+		AllocateBuffers(width, height);
+	}
+
+	m_frameNumber++;
+	CollectReadbacks(false);
+
+	if (m_pendingSlots == TOTAL_READBACK_BUFFERS)
+	{
+		m_droppedFrames++;
+		return;
+	}
+
+	READBACK_SLOT& slot = m_slots[m_nextSlot];
+	slot.frameNumber = m_frameNumber;
+
+	// the read lands in the pixel buffer, so the call returns
+	// as soon as the copy is queued on the GPU
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pixelBuffer);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	m_nextSlot = (m_nextSlot + 1) % TOTAL_READBACK_BUFFERS;
+	m_pendingSlots++;
+}
+
+/***********************************************************
+ *  Shutdown()
+ *
+ *  This method is used for waiting for the frames still in
+ *  flight, letting the workers write them, and releasing
+ *  the capture resources.
+ ***********************************************************/
+void FrameCapture::Shutdown()
+{
+	if (false == m_bInitialized)
+	{
+		return;
+	}
+
+	CollectReadbacks(true);
+	WaitForWorkers();
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bStopWorkers = true;
+	}
+	m_condition.notify_all();
+	for (size_t i = 0; i < m_workers.size(); i++)
+	{
+		m_workers[i].join();
+	}
+	m_workers.clear();
+
+	ReleaseBuffers();
+	for (size_t i = 0; i < m_frameBuffers.size(); i++)
+	{
+		ResourceTracker::Release(RESOURCE_HOST_STAGING, (uint64_t)(uintptr_t)&m_frameBuffers[i]);
+	}
+	m_frameBuffers.clear();
+	m_freeBuffers.clear();
+	m_bInitialized = false;
+
+	std::cout << "CAPTURE: wrote " << m_writtenFrames << " frames, dropped "
+		<< m_droppedFrames << " frames" << std::endl;
+}
+
+/***********************************************************
+ *  GetWrittenFrames()
+ *
+ *  This method is used for getting how many frames the
+ *  workers have written to disk.
+ ***********************************************************/
+unsigned long long FrameCapture::GetWrittenFrames() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return(m_writtenFrames);
+}
+
+/***********************************************************
+ *  AllocateBuffers()
+ *
+ *  This method is used for creating the pixel buffer ring
+ *  and the frame pool for the framebuffer size.  After a
+ *  resize the frames of the old size are written first.
+ ***********************************************************/
+void FrameCapture::AllocateBuffers(int width, int height)
+{
+	CollectReadbacks(true);
+	WaitForWorkers();
+	ReleaseBuffers();
+
+	m_width = width;
+	m_height = height;
+	size_t frameBytes = (size_t)width * height * 4;
+
+	for (int i = 0; i < TOTAL_READBACK_BUFFERS; i++)
+	{
+		glGenBuffers(1, &m_slots[i].pixelBuffer);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, m_slots[i].pixelBuffer);
+		glBufferData(GL_PIXEL_PACK_BUFFER, frameBytes, NULL, GL_STREAM_READ);
+		ResourceTracker::Track(RESOURCE_BUFFER, m_slots[i].pixelBuffer, g_TrackerName, "readback buffer", frameBytes);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	m_nextSlot = 0;
+	m_pendingSlots = 0;
+
+	for (size_t i = 0; i < m_frameBuffers.size(); i++)
+	{
+		m_frameBuffers[i].resize(frameBytes);
+		ResourceTracker::Track(RESOURCE_HOST_STAGING, (uint64_t)(uintptr_t)&m_frameBuffers[i],
+			g_TrackerName, "queued frame", m_frameBuffers[i].capacity());
+	}
+
+	if (m_format == CAPTURE_YUV)
+	{
+		char filename[64];
+		snprintf(filename, sizeof(filename), "/capture_%dx%d.yuv", width, height);
+		m_pYUVFile = fopen((m_outputDirectory + filename).c_str(), "wb");
+		if (NULL == m_pYUVFile)
+		{
+			std::cout << "Could not create capture file in: " << m_outputDirectory << std::endl;
+		}
+		m_sequenceIndex = 0;
+		m_nextWriteSequence = 0;
+	}
+}
+
+/***********************************************************
+ *  ReleaseBuffers()
+ *
+ *  This method is used for deleting the pixel buffers and
+ *  closing the YUV sequence file.
+ ***********************************************************/
+void FrameCapture::ReleaseBuffers()
+{
+	for (int i = 0; i < TOTAL_READBACK_BUFFERS; i++)
+	{
+		if (0 != m_slots[i].fence)
+		{
+			glDeleteSync(m_slots[i].fence);
+			m_slots[i].fence = 0;
+		}
+		if (0 != m_slots[i].pixelBuffer)
+		{
+			ResourceTracker::Release(RESOURCE_BUFFER, m_slots[i].pixelBuffer);
+			glDeleteBuffers(1, &m_slots[i].pixelBuffer);
+			m_slots[i].pixelBuffer = 0;
+		}
+	}
+	m_pendingSlots = 0;
+
+	if (NULL != m_pYUVFile)
+	{
+		fclose(m_pYUVFile);
+		m_pYUVFile = NULL;
+	}
+}
+
+/***********************************************************
+ *  WaitForWorkers()
+ *
+ *  This method is used for blocking until every frame in the
+ *  pool has been written and returned.  It is only used when
+ *  the capture is resized or shut down.
+ ***********************************************************/
+void FrameCapture::WaitForWorkers()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_condition.wait(lock, [this]() { return m_freeBuffers.size() == m_frameBuffers.size(); });
+}
+
+/***********************************************************
+ *  CollectReadbacks()
+ *
+ *  This method is used for copying the readbacks the GPU has
+ *  finished, oldest first, into free frames of the pool and
+ *  queueing them for the workers.  Without bWait it stops at
+ *  the first readback still in flight, and a finished frame
+ *  with no free pool buffer is dropped.
+ ***********************************************************/
+void FrameCapture::CollectReadbacks(bool bWait)
+{
+	size_t frameBytes = (size_t)m_width * m_height * 4;
+
+	while (m_pendingSlots > 0)
+	{
+		int slotIndex = (m_nextSlot - m_pendingSlots + TOTAL_READBACK_BUFFERS) % TOTAL_READBACK_BUFFERS;
+		READBACK_SLOT& slot = m_slots[slotIndex];
+
+		GLenum status = glClientWaitSync(slot.fence,
+			bWait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0,
+			bWait ? 1000000000ull : 0);
+		if ((status == GL_TIMEOUT_EXPIRED) || (status == GL_WAIT_FAILED))
+		{
+			if (!bWait || (status == GL_WAIT_FAILED))
+			{
+				break;
+			}
+			continue;
+		}
+		glDeleteSync(slot.fence);
+		slot.fence = 0;
+		m_pendingSlots--;
+
+		int bufferIndex = -1;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			if (bWait)
+			{
+				m_condition.wait(lock, [this]() { return !m_freeBuffers.empty(); });
+			}
+			if (!m_freeBuffers.empty())
+			{
+				bufferIndex = m_freeBuffers.back();
+				m_freeBuffers.pop_back();
+			}
+		}
+
+		// the encoders are behind, drop the frame
+		if (bufferIndex < 0)
+		{
+			m_droppedFrames++;
+			continue;
+		}
+
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pixelBuffer);
+		void* pPixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, frameBytes, GL_MAP_READ_BIT);
+		if (NULL != pPixels)
+		{
+			memcpy(m_frameBuffers[bufferIndex].data(), pPixels, frameBytes);
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (NULL == pPixels)
+		{
+			m_freeBuffers.push_back(bufferIndex);
+			m_droppedFrames++;
+			continue;
+		}
+
+		CAPTURE_JOB job;
+		job.bufferIndex = bufferIndex;
+		job.frameNumber = slot.frameNumber;
+		job.sequenceIndex = m_sequenceIndex++;
+		m_jobs.push_back(job);
+		m_condition.notify_all();
+	}
+}
+
+/***********************************************************
+ *  WorkerLoop()
+ *
+ *  This method is run by each worker thread.  It encodes the
+ *  queued frames and returns their buffers to the pool.
+ ***********************************************************/
+void FrameCapture::WorkerLoop()
+{
+	while (true)
+	{
+		CAPTURE_JOB job;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_condition.wait(lock, [this]() { return m_bStopWorkers || !m_jobs.empty(); });
+			if (m_jobs.empty())
+			{
+				return;
+			}
+			job = m_jobs.front();
+			m_jobs.pop_front();
+		}
+
+		const std::vector<unsigned char>& pixels = m_frameBuffers[job.bufferIndex];
+		bool bWritten = (m_format == CAPTURE_YUV) ?
+			WriteYUV(pixels, job.sequenceIndex) :
+			WritePNG(pixels, job.frameNumber);
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (bWritten)
+		{
+			m_writtenFrames++;
+		}
+		else if (!m_bWriteFailed)
+		{
+			m_bWriteFailed = true;
+			std::cout << "Could not write captured frames to: " << m_outputDirectory << std::endl;
+		}
+		m_freeBuffers.push_back(job.bufferIndex);
+		m_condition.notify_all();
+	}
+}
+
+/***********************************************************
+ *  WritePNG()
+ *
+ *  This method is used for writing a frame as an RGB PNG
+ *  file.  The image data is stored without compression,
+ *  which keeps the encoder fast and dependency free at the
+ *  cost of larger files.
+ ***********************************************************/
+bool FrameCapture::WritePNG(const std::vector<unsigned char>& pixels, unsigned long long frameNumber)
+{
+	size_t rowBytes = (size_t)m_width * 3 + 1;
+	std::vector<unsigned char> rows(rowBytes * m_height);
+
+	// OpenGL rows start at the bottom, each PNG row starts
+	// with its filter type, 0 for none
+	for (int y = 0; y < m_height; y++)
+	{
+		const unsigned char* pSource = &pixels[(size_t)(m_height - 1 - y) * m_width * 4];
+		unsigned char* pTarget = &rows[y * rowBytes];
+		*pTarget++ = 0;
+		for (int x = 0; x < m_width; x++)
+		{
+			*pTarget++ = pSource[x * 4 + 0];
+			*pTarget++ = pSource[x * 4 + 1];
+			*pTarget++ = pSource[x * 4 + 2];
+		}
+	}
+
+	// zlib stream made of stored deflate blocks
+	std::vector<unsigned char> zlib;
+	zlib.reserve(rows.size() + rows.size() / g_MaxStoredBlock * 5 + 16);
+	zlib.push_back(0x78);
+	zlib.push_back(0x01);
+	unsigned int adlerA = 1;
+	unsigned int adlerB = 0;
+	for (size_t offset = 0; offset < rows.size(); offset += g_MaxStoredBlock)
+	{
+		size_t blockSize = std::min(g_MaxStoredBlock, rows.size() - offset);
+		bool bFinal = (offset + blockSize == rows.size());
+		zlib.push_back(bFinal ? 1 : 0);
+		zlib.push_back((unsigned char)(blockSize & 0xFF));
+		zlib.push_back((unsigned char)(blockSize >> 8));
+		zlib.push_back((unsigned char)(~blockSize & 0xFF));
+		zlib.push_back((unsigned char)((~blockSize >> 8) & 0xFF));
+		zlib.insert(zlib.end(), rows.begin() + offset, rows.begin() + offset + blockSize);
+
+		for (size_t i = offset; i < offset + blockSize; i++)
+		{
+			adlerA = (adlerA + rows[i]) % 65521;
+			adlerB = (adlerB + adlerA) % 65521;
+		}
+	}
+	AppendBigEndian(zlib, (adlerB << 16) | adlerA);
+
+	std::vector<unsigned char> header;
+	AppendBigEndian(header, (unsigned int)m_width);
+	AppendBigEndian(header, (unsigned int)m_height);
+	// 8 bits per channel, RGB, default compression, filter and interlace
+	const unsigned char format[5] = { 8, 2, 0, 0, 0 };
+	header.insert(header.end(), format, format + 5);
+
+	const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	std::vector<unsigned char> file(signature, signature + 8);
+	AppendChunk(file, "IHDR", header.data(), header.size());
+	AppendChunk(file, "IDAT", zlib.data(), zlib.size());
+	AppendChunk(file, "IEND", NULL, 0);
+
+	char filename[64];
+	snprintf(filename, sizeof(filename), "/frame_%06llu.png", frameNumber);
+	FILE* pFile = fopen((m_outputDirectory + filename).c_str(), "wb");
+	if (NULL == pFile)
+	{
+		return(false);
+	}
+	bool bWritten = (fwrite(file.data(), 1, file.size(), pFile) == file.size());
+	fclose(pFile);
+
+	return(bWritten);
+}
+
+/***********************************************************
+ *  WriteYUV()
+ *
+ *  This method is used for converting a frame to YUV 4:2:0
+ *  with the BT.601 limited range coefficients and appending
+ *  it to the sequence file.  The conversion runs in parallel
+ *  and the writes are done in sequence order.
+ ***********************************************************/
+bool FrameCapture::WriteYUV(const std::vector<unsigned char>& pixels, unsigned long long sequenceIndex)
+{
+	int chromaWidth = (m_width + 1) / 2;
+	int chromaHeight = (m_height + 1) / 2;
+	size_t lumaBytes = (size_t)m_width * m_height;
+	size_t chromaBytes = (size_t)chromaWidth * chromaHeight;
+	std::vector<unsigned char> frame(lumaBytes + chromaBytes * 2);
+	unsigned char* pY = frame.data();
+	unsigned char* pU = pY + lumaBytes;
+	unsigned char* pV = pU + chromaBytes;
+
+	for (int y = 0; y < m_height; y++)
+	{
+		// OpenGL rows start at the bottom
+		const unsigned char* pRow = &pixels[(size_t)(m_height - 1 - y) * m_width * 4];
+		for (int x = 0; x < m_width; x++)
+		{
+			int r = pRow[x * 4 + 0];
+			int g = pRow[x * 4 + 1];
+			int b = pRow[x * 4 + 2];
+			pY[(size_t)y * m_width + x] = (unsigned char)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+		}
+	}
+
+	// average each 2x2 block for the chroma planes
+	for (int cy = 0; cy < chromaHeight; cy++)
+	{
+		for (int cx = 0; cx < chromaWidth; cx++)
+		{
+			int r = 0;
+			int g = 0;
+			int b = 0;
+			for (int dy = 0; dy < 2; dy++)
+			{
+				int y = std::min(cy * 2 + dy, m_height - 1);
+				const unsigned char* pRow = &pixels[(size_t)(m_height - 1 - y) * m_width * 4];
+				for (int dx = 0; dx < 2; dx++)
+				{
+					int x = std::min(cx * 2 + dx, m_width - 1);
+					r += pRow[x * 4 + 0];
+					g += pRow[x * 4 + 1];
+					b += pRow[x * 4 + 2];
+				}
+			}
+			r /= 4;
+			g /= 4;
+			b /= 4;
+			pU[(size_t)cy * chromaWidth + cx] = (unsigned char)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+			pV[(size_t)cy * chromaWidth + cx] = (unsigned char)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+		}
+	}
+
+	std::unique_lock<std::mutex> lock(m_fileMutex);
+	m_fileCondition.wait(lock, [this, sequenceIndex]() { return m_nextWriteSequence == sequenceIndex; });
+
+	bool bWritten = (NULL != m_pYUVFile) &&
+		(fwrite(frame.data(), 1, frame.size(), m_pYUVFile) == frame.size());
+
+	m_nextWriteSequence++;
+	m_fileCondition.notify_all();
+
+	return(bWritten);
+}
@@ -0,0 +1,122 @@
+///////////////////////////////////////////////////////////////////////////////
+// framecapture.h
+// ============
+// record the rendered frames to disk without stalling the renderer
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  FrameCapture
+ *
+ *  This class reads the rendered frames back into a ring of
+ *  pixel buffer objects.  Each readback is fenced and only
+ *  mapped a few frames later, once the GPU has finished it,
+ *  so the render thread never waits for the GPU.  The pixels
+ *  are copied into a fixed pool of system memory buffers and
+ *  encoded to disk by worker threads.  When the ring or the
+ *  pool is full the frame is dropped and counted instead.
+ ***********************************************************/
+class FrameCapture
+{
+public:
+	enum CAPTURE_FORMAT
+	{
+		// one PNG file per frame
+		CAPTURE_PNG = 0,
+		// all the frames in one raw YUV 4:2:0 (I420) file
+		CAPTURE_YUV
+	};
+
+	// constructor
+	FrameCapture();
+	// destructor
+	~FrameCapture();
+
+	// start capturing into the output directory
+	bool Initialize(
+		const std::string& outputDirectory,
+		CAPTURE_FORMAT format,
+		int workerThreads = 2,
+		int maxQueuedFrames = 8);
+	// read back the current frame of the bound framebuffer,
+	// called after rendering and before swapping the buffers
+	void CaptureFrame(int width, int height);
+	// finish the pending frames and stop the workers
+	void Shutdown();
+
+	// frames written to disk and frames dropped so far
+	unsigned long long GetWrittenFrames() const;
+	unsigned long long GetDroppedFrames() const { return m_droppedFrames; }
+
+private:
+	static const int TOTAL_READBACK_BUFFERS = 3;
+
+	struct READBACK_SLOT
+	{
+		GLuint pixelBuffer;
+		GLsync fence;
+		unsigned long long frameNumber;
+	};
+
+	struct CAPTURE_JOB
+	{
+		int bufferIndex;
+		unsigned long long frameNumber;
+		unsigned long long sequenceIndex;
+	};
+
+	bool m_bInitialized;
+	std::string m_outputDirectory;
+	CAPTURE_FORMAT m_format;
+	int m_width;
+	int m_height;
+
+	// pixel buffer ring, the oldest pending slot is read first
+	READBACK_SLOT m_slots[TOTAL_READBACK_BUFFERS];
+	int m_nextSlot;
+	int m_pendingSlots;
+	unsigned long long m_frameNumber;
+	unsigned long long m_sequenceIndex;
+	unsigned long long m_droppedFrames;
+
+	// system memory frame pool shared with the workers
+	std::vector<std::vector<unsigned char>> m_frameBuffers;
+	std::vector<int> m_freeBuffers;
+	std::deque<CAPTURE_JOB> m_jobs;
+	std::vector<std::thread> m_workers;
+	mutable std::mutex m_mutex;
+	std::condition_variable m_condition;
+	bool m_bStopWorkers;
+	unsigned long long m_writtenFrames;
+	bool m_bWriteFailed;
+
+	// YUV sequence file, the workers append in sequence order
+	FILE* m_pYUVFile;
+	std::mutex m_fileMutex;
+	std::condition_variable m_fileCondition;
+	unsigned long long m_nextWriteSequence;
+
+	// create or resize the pixel buffers and the frame pool
+	void AllocateBuffers(int width, int height);
+	void ReleaseBuffers();
+	// block until the workers have written every queued frame
+	void WaitForWorkers();
+	// hand the finished readbacks to the workers
+	void CollectReadbacks(bool bWait);
+
+	// worker thread loop and encoders
+	void WorkerLoop();
+	bool WritePNG(const std::vector<unsigned char>& pixels, unsigned long long frameNumber);
+	bool WriteYUV(const std::vector<unsigned char>& pixels, unsigned long long sequenceIndex);
+};
@@ -0,0 +1,797 @@
+///////////////////////////////////////////////////////////////////////////////
+// framegraph.cpp
+// ============
+// order the render passes of a frame and pool their render targets
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameGraph.h"
+#include "GLTrace.h"
+#include "ResourceTracker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// owner of the pooled targets in the resource tracker
+	const char* const g_TrackerName = "frame graph";
+
+	/***********************************************************
+	 *  ToMegabytes()
+	 *
+	 *  This function is used for converting a byte count for
+	 *  the report.
+	 ***********************************************************/
+	double ToMegabytes(size_t bytes)
+	{
+		return((double)bytes / (1024.0 * 1024.0));
+	}
+}
+
+/***********************************************************
+ *  FrameGraph()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameGraph::FrameGraph()
+{
+	m_pFrameStats = NULL;
+	m_windowWidth = 0;
+	m_windowHeight = 0;
+	m_bCompiled = false;
+}
+
+/***********************************************************
+ *  ~FrameGraph()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameGraph::~FrameGraph()
+{
+	DestroyFramebuffers();
+	for (size_t i = 0; i < m_targets.size(); i++)
+	{
+		ResourceTracker::Release(RESOURCE_RENDER_TARGET, m_targets[i].texture);
+		glDeleteTextures(1, &m_targets[i].texture);
+	}
+	m_targets.clear();
+	m_pFrameStats = NULL;
+}
+
+/***********************************************************
+ *  SetFrameStats()
+ *
+ *  This method is used for setting the object the passes
+ *  are timed by.  A pass is reported under its name, so a
+ *  section another object registered under the same name
+ *  measures the pass.
+ ***********************************************************/
+void FrameGraph::SetFrameStats(FrameStats* pFrameStats)
+{
+	m_pFrameStats = pFrameStats;
+	for (size_t i = 0; i < m_passes.size(); i++)
+	{
+		m_passes[i].sectionID = (NULL != m_pFrameStats) ? m_pFrameStats->RegisterSection(m_passes[i].name.c_str()) : -1;
+	}
+}
+
+/***********************************************************
+ *  ImportBackbuffer()
+ *
+ *  This method is used for adding the window framebuffer,
+ *  which the graph does not own.  Passes drawing into it are
+ *  never culled.
+ ***********************************************************/
+int FrameGraph::ImportBackbuffer(const char* name)
+{
+	FRAME_RESOURCE resource;
+	resource.name = name;
+	resource.desc.scale = 1.0f;
+	resource.desc.internalFormat = GL_RGBA8;
+	resource.bImported = true;
+	resource.width = 0;
+	resource.height = 0;
+	resource.target = -1;
+	resource.firstUse = -1;
+	resource.lastUse = -1;
+	m_resources.push_back(resource);
+	m_bCompiled = false;
+	return((int)m_resources.size() - 1);
+}
+
+/***********************************************************
+ *  CreateTexture()
+ *
+ *  This method is used for adding a render target.  Its
+ *  texture is only taken from the pool by Compile(), and
+ *  only when a pass that is run uses the target.
+ ***********************************************************/
+int FrameGraph::CreateTexture(const char* name, const FRAME_TEXTURE_DESC& desc)
+{
+	FRAME_RESOURCE resource;
+	resource.name = name;
+	resource.desc = desc;
+	resource.bImported = false;
+	resource.width = 0;
+	resource.height = 0;
+	resource.target = -1;
+	resource.firstUse = -1;
+	resource.lastUse = -1;
+	m_resources.push_back(resource);
+	m_bCompiled = false;
+	return((int)m_resources.size() - 1);
+}
+
+/***********************************************************
+ *  AddPass()
+ *
+ *  This method is used for adding a pass.  The passes may be
+ *  added in any order that declares the writes of a target
+ *  before its reads.
+ ***********************************************************/
+int FrameGraph::AddPass(const char* name, const PassFunc& execute)
+{
+	FRAME_PASS pass;
+	pass.name = name;
+	pass.execute = execute;
+	pass.bSideEffect = false;
+	pass.bCulled = false;
+	pass.sectionID = (NULL != m_pFrameStats) ? m_pFrameStats->RegisterSection(name) : -1;
+	pass.framebuffer = -1;
+	m_passes.push_back(pass);
+	m_bCompiled = false;
+	return((int)m_passes.size() - 1);
+}
+
+/***********************************************************
+ *  Read()
+ ***********************************************************/
+void FrameGraph::Read(int pass, int resource)
+{
+	if ((pass < 0) || (pass >= (int)m_passes.size()) || (resource < 0) || (resource >= (int)m_resources.size()))
+	{
+		return;
+	}
+	m_passes[pass].reads.push_back(resource);
+	m_bCompiled = false;
+}
+
+/***********************************************************
+ *  Write()
+ ***********************************************************/
+void FrameGraph::Write(int pass, int resource)
+{
+	if ((pass < 0) || (pass >= (int)m_passes.size()) || (resource < 0) || (resource >= (int)m_resources.size()))
+	{
+		return;
+	}
+	m_passes[pass].writes.push_back(resource);
+	m_bCompiled = false;
+}
+
+/***********************************************************
+ *  SetSideEffect()
+ ***********************************************************/
+void FrameGraph::SetSideEffect(int pass)
+{
+	if ((pass < 0) || (pass >= (int)m_passes.size()))
+	{
+		return;
+	}
+	m_passes[pass].bSideEffect = true;
+	m_bCompiled = false;
+}
+
+/***********************************************************
+ *  NeedsCompile()
+ ***********************************************************/
+bool FrameGraph::NeedsCompile(int windowWidth, int windowHeight) const
+{
+	return(!m_bCompiled || (windowWidth != m_windowWidth) || (windowHeight != m_windowHeight));
+}
+
+/***********************************************************
+ *  Compile()
+ *
+ *  This method is used for working out the order of the
+ *  passes, which of them run, the textures of the targets
+ *  and the framebuffers the passes draw into.
+ ***********************************************************/
+bool FrameGraph::Compile(int windowWidth, int windowHeight)
+{
+	m_bCompiled = false;
+	m_windowWidth = windowWidth;
+	m_windowHeight = windowHeight;
+
+	FindDependencies();
+	CullPasses();
+	if (!OrderPasses())
+	{
+		std::cout << "Frame graph passes depend on each other in a cycle" << std::endl;
+		return(false);
+	}
+	AllocateTargets();
+	if (!CreateFramebuffers())
+	{
+		return(false);
+	}
+
+	m_bCompiled = true;
+	Report();
+	return(true);
+}
+
+/***********************************************************
+ *  FindDependencies()
+ *
+ *  This method is used for finding the passes each pass has
+ *  to run after, in the order the passes were added.  A pass
+ *  reading a target runs after the last pass writing it, and
+ *  a pass writing a target runs after the last pass writing
+ *  it and the passes reading what that one wrote.
+ ***********************************************************/
+void FrameGraph::FindDependencies()
+{
+	m_edges.clear();
+	std::vector<int> lastWriters(m_resources.size(), -1);
+	std::vector<std::vector<int>> readers(m_resources.size());
+
+	for (size_t p = 0; p < m_passes.size(); p++)
+	{
+		const FRAME_PASS& pass = m_passes[p];
+		for (size_t i = 0; i < pass.reads.size(); i++)
+		{
+			int resource = pass.reads[i];
+			if (lastWriters[resource] >= 0)
+			{
+				PASS_EDGE edge = { lastWriters[resource], (int)p, true };
+				m_edges.push_back(edge);
+			}
+		}
+		for (size_t i = 0; i < pass.writes.size(); i++)
+		{
+			int resource = pass.writes[i];
+			if (lastWriters[resource] >= 0)
+			{
+				// the pass may draw over only part of the target
+				PASS_EDGE edge = { lastWriters[resource], (int)p, true };
+				m_edges.push_back(edge);
+			}
+			for (size_t r = 0; r < readers[resource].size(); r++)
+			{
+				if (readers[resource][r] != (int)p)
+				{
+					PASS_EDGE edge = { readers[resource][r], (int)p, false };
+					m_edges.push_back(edge);
+				}
+			}
+			lastWriters[resource] = (int)p;
+			readers[resource].clear();
+		}
+		for (size_t i = 0; i < pass.reads.size(); i++)
+		{
+			readers[pass.reads[i]].push_back((int)p);
+		}
+	}
+}
+
+/***********************************************************
+ *  CullPasses()
+ *
+ *  This method is used for keeping only the passes that draw
+ *  into the window, have a side effect, or write something a
+ *  kept pass needs.
+ ***********************************************************/
+void FrameGraph::CullPasses()
+{
+	for (size_t p = 0; p < m_passes.size(); p++)
+	{
+		FRAME_PASS& pass = m_passes[p];
+		pass.bCulled = !pass.bSideEffect;
+		for (size_t i = 0; i < pass.writes.size(); i++)
+		{
+			if (m_resources[pass.writes[i]].bImported)
+			{
+				pass.bCulled = false;
+			}
+		}
+	}
+
+	// the edges only point to later passes, so one walk from
+	// the last pass back reaches everything a kept pass needs
+	for (int p = (int)m_passes.size() - 1; p >= 0; p--)
+	{
+		if (m_passes[p].bCulled)
+		{
+			continue;
+		}
+		for (size_t e = 0; e < m_edges.size(); e++)
+		{
+			if ((m_edges[e].to == p) && m_edges[e].bData)
+			{
+				m_passes[m_edges[e].from].bCulled = false;
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  OrderPasses()
+ *
+ *  This method is used for sorting the kept passes so each
+ *  runs after the passes it depends on.  Of the passes that
+ *  are ready, one drawing into the targets of the pass
+ *  before is taken first, which saves a framebuffer bind,
+ *  and otherwise the one added first.
+ ***********************************************************/
+bool FrameGraph::OrderPasses()
+{
+	m_order.clear();
+	std::vector<int> waiting(m_passes.size(), 0);
+	for (size_t e = 0; e < m_edges.size(); e++)
+	{
+		if (!m_passes[m_edges[e].from].bCulled && !m_passes[m_edges[e].to].bCulled)
+		{
+			waiting[m_edges[e].to]++;
+		}
+	}
+
+	std::vector<bool> bScheduled(m_passes.size(), false);
+	size_t keptCount = 0;
+	for (size_t p = 0; p < m_passes.size(); p++)
+	{
+		if (!m_passes[p].bCulled)
+			keptCount++;
+	}
+
+	while (m_order.size() < keptCount)
+	{
+		int next = -1;
+		for (size_t p = 0; p < m_passes.size(); p++)
+		{
+			if (m_passes[p].bCulled || bScheduled[p] || (waiting[p] > 0))
+			{
+				continue;
+			}
+			if (next < 0)
+			{
+				next = (int)p;
+			}
+			if (!m_order.empty() && !m_passes[p].writes.empty() &&
+				(m_passes[p].writes == m_passes[m_order.back()].writes))
+			{
+				next = (int)p;
+				break;
+			}
+		}
+		if (next < 0)
+		{
+			return(false);
+		}
+
+		bScheduled[next] = true;
+		m_order.push_back(next);
+		for (size_t e = 0; e < m_edges.size(); e++)
+		{
+			if ((m_edges[e].from == next) && !m_passes[m_edges[e].to].bCulled)
+			{
+				waiting[m_edges[e].to]--;
+			}
+		}
+	}
+	return(true);
+}
+
+/***********************************************************
+ *  AllocateTargets()
+ *
+ *  This method is used for giving each used target a texture
+ *  of the pool.  The targets are taken in the order they are
+ *  first used, and a pooled texture of the same size and
+ *  format is shared once the targets using it are no longer
+ *  needed.  Textures the pool no longer needs are deleted.
+ ***********************************************************/
+void FrameGraph::AllocateTargets()
+{
+	for (size_t i = 0; i < m_resources.size(); i++)
+	{
+		m_resources[i].firstUse = -1;
+		m_resources[i].lastUse = -1;
+		m_resources[i].target = -1;
+	}
+	for (size_t position = 0; position < m_order.size(); position++)
+	{
+		const FRAME_PASS& pass = m_passes[m_order[position]];
+		for (int list = 0; list < 2; list++)
+		{
+			const std::vector<int>& resources = (list == 0) ? pass.reads : pass.writes;
+			for (size_t i = 0; i < resources.size(); i++)
+			{
+				FRAME_RESOURCE& resource = m_resources[resources[i]];
+				if (resource.firstUse < 0)
+				{
+					resource.firstUse = (int)position;
+				}
+				resource.lastUse = (int)position;
+			}
+		}
+	}
+
+	std::vector<int> byFirstUse;
+	for (size_t i = 0; i < m_resources.size(); i++)
+	{
+		FRAME_RESOURCE& resource = m_resources[i];
+		if (resource.bImported)
+		{
+			resource.width = m_windowWidth;
+			resource.height = m_windowHeight;
+			continue;
+		}
+		resource.width = std::max((int)std::ceil(m_windowWidth * resource.desc.scale), 1);
+		resource.height = std::max((int)std::ceil(m_windowHeight * resource.desc.scale), 1);
+		if (resource.firstUse >= 0)
+		{
+			byFirstUse.push_back((int)i);
+		}
+	}
+	std::stable_sort(byFirstUse.begin(), byFirstUse.end(),
+		[this](int a, int b) { return m_resources[a].firstUse < m_resources[b].firstUse; });
+
+	for (size_t i = 0; i < m_targets.size(); i++)
+	{
+		m_targets[i].lastUse = -1;
+	}
+	for (size_t i = 0; i < byFirstUse.size(); i++)
+	{
+		FRAME_RESOURCE& resource = m_resources[byFirstUse[i]];
+		for (size_t t = 0; t < m_targets.size(); t++)
+		{
+			const POOLED_TARGET& target = m_targets[t];
+			if ((target.internalFormat == resource.desc.internalFormat) &&
+				(target.width == resource.width) && (target.height == resource.height) &&
+				(target.lastUse < resource.firstUse))
+			{
+				resource.target = (int)t;
+				break;
+			}
+		}
+
+		if (resource.target < 0)
+		{
+			POOLED_TARGET target;
+			target.internalFormat = resource.desc.internalFormat;
+			target.width = resource.width;
+			target.height = resource.height;
+			target.lastUse = -1;
+
+			bool bDepth = IsDepthFormat(target.internalFormat);
+			GLenum format = GL_RGBA;
+			GLenum type = GL_UNSIGNED_BYTE;
+			if (HasStencil(target.internalFormat))
+			{
+				format = GL_DEPTH_STENCIL;
+				type = (target.internalFormat == GL_DEPTH32F_STENCIL8) ?
+					GL_FLOAT_32_UNSIGNED_INT_24_8_REV : GL_UNSIGNED_INT_24_8;
+			}
+			else if (bDepth)
+			{
+				format = GL_DEPTH_COMPONENT;
+				type = GL_FLOAT;
+			}
+			glGenTextures(1, &target.texture);
+			glBindTexture(GL_TEXTURE_2D, target.texture);
+			glTexImage2D(GL_TEXTURE_2D, 0, target.internalFormat, target.width, target.height, 0,
+				format, type, NULL);
+			// passes that sample a target filter between texels
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, bDepth ? GL_NEAREST : GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, bDepth ? GL_NEAREST : GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+			glBindTexture(GL_TEXTURE_2D, 0);
+			ResourceTracker::Track(RESOURCE_RENDER_TARGET, target.texture, g_TrackerName, resource.name.c_str(),
+				ResourceTracker::GetImageBytes(target.internalFormat, target.width, target.height, 1));
+
+			m_targets.push_back(target);
+			resource.target = (int)m_targets.size() - 1;
+		}
+		m_targets[resource.target].lastUse = resource.lastUse;
+	}
+
+	// drop the textures no target took and renumber the rest
+	std::vector<int> newIndices(m_targets.size(), -1);
+	size_t kept = 0;
+	for (size_t t = 0; t < m_targets.size(); t++)
+	{
+		if (m_targets[t].lastUse < 0)
+		{
+			ResourceTracker::Release(RESOURCE_RENDER_TARGET, m_targets[t].texture);
+			glDeleteTextures(1, &m_targets[t].texture);
+			continue;
+		}
+		newIndices[t] = (int)kept;
+		m_targets[kept++] = m_targets[t];
+	}
+	m_targets.resize(kept);
+	for (size_t i = 0; i < m_resources.size(); i++)
+	{
+		if (m_resources[i].target >= 0)
+		{
+			m_resources[i].target = newIndices[m_resources[i].target];
+		}
+	}
+}
+
+/***********************************************************
+ *  CreateFramebuffers()
+ *
+ *  This method is used for creating a framebuffer for each
+ *  set of targets a pass draws into, shared by the passes
+ *  drawing into the same textures.  Passes drawing into the
+ *  window, or only reading it, use the default framebuffer.
+ ***********************************************************/
+bool FrameGraph::CreateFramebuffers()
+{
+	DestroyFramebuffers();
+
+	for (size_t position = 0; position < m_order.size(); position++)
+	{
+		FRAME_PASS& pass = m_passes[m_order[position]];
+		pass.framebuffer = -1;
+
+		bool bWindow = false;
+		std::vector<GLuint> colors;
+		GLuint depth = 0;
+		bool bStencil = false;
+		for (size_t i = 0; i < pass.writes.size(); i++)
+		{
+			const FRAME_RESOURCE& resource = m_resources[pass.writes[i]];
+			if (resource.bImported)
+			{
+				bWindow = true;
+			}
+			else if (IsDepthFormat(resource.desc.internalFormat))
+			{
+				depth = m_targets[resource.target].texture;
+				bStencil = HasStencil(resource.desc.internalFormat);
+			}
+			else
+			{
+				colors.push_back(m_targets[resource.target].texture);
+			}
+		}
+
+		if (bWindow && (!colors.empty() || (0 != depth)))
+		{
+			std::cout << "Frame graph pass " << pass.name << " draws into the window and a target" << std::endl;
+			return(false);
+		}
+		if (bWindow)
+		{
+			pass.framebuffer = 0;
+			continue;
+		}
+		if (colors.empty() && (0 == depth))
+		{
+			for (size_t i = 0; i < pass.reads.size(); i++)
+			{
+				if (m_resources[pass.reads[i]].bImported)
+					pass.framebuffer = 0;
+			}
+			continue;
+		}
+
+		std::vector<GLuint> attachments = colors;
+		attachments.push_back(depth);
+		for (size_t f = 0; f < m_framebuffers.size(); f++)
+		{
+			if (m_framebuffers[f].attachments == attachments)
+			{
+				pass.framebuffer = (GLint)m_framebuffers[f].framebuffer;
+				break;
+			}
+		}
+		if (pass.framebuffer >= 0)
+		{
+			continue;
+		}
+
+		FRAMEBUFFER_ENTRY entry;
+		entry.attachments = attachments;
+		glGenFramebuffers(1, &entry.framebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, entry.framebuffer);
+		std::vector<GLenum> drawBuffers;
+		for (size_t i = 0; i < colors.size(); i++)
+		{
+			glFramebufferTexture2D(GL_FRAMEBUFFER, (GLenum)(GL_COLOR_ATTACHMENT0 + i), GL_TEXTURE_2D, colors[i], 0);
+			drawBuffers.push_back((GLenum)(GL_COLOR_ATTACHMENT0 + i));
+		}
+		if (0 != depth)
+		{
+			glFramebufferTexture2D(GL_FRAMEBUFFER, bStencil ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT,
+				GL_TEXTURE_2D, depth, 0);
+		}
+		if (drawBuffers.empty())
+		{
+			glDrawBuffer(GL_NONE);
+		}
+		else
+		{
+			glDrawBuffers((GLsizei)drawBuffers.size(), drawBuffers.data());
+		}
+		GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		m_framebuffers.push_back(entry);
+
+		if (GL_FRAMEBUFFER_COMPLETE != status)
+		{
+			std::cout << "Frame graph framebuffer of pass " << pass.name << " is incomplete: 0x"
+				<< std::hex << status << std::dec << std::endl;
+			return(false);
+		}
+		pass.framebuffer = (GLint)entry.framebuffer;
+	}
+	return(true);
+}
+
+/***********************************************************
+ *  DestroyFramebuffers()
+ ***********************************************************/
+void FrameGraph::DestroyFramebuffers()
+{
+	for (size_t f = 0; f < m_framebuffers.size(); f++)
+	{
+		glDeleteFramebuffers(1, &m_framebuffers[f].framebuffer);
+	}
+	m_framebuffers.clear();
+}
+
+/***********************************************************
+ *  Execute()
+ *
+ *  This method is used for running the passes in order.  A
+ *  framebuffer is bound only when a pass draws into other
+ *  targets than the pass before, so the passes must leave
+ *  the framebuffer they were given bound.
+ ***********************************************************/
+void FrameGraph::Execute()
+{
+	if (!m_bCompiled)
+	{
+		return;
+	}
+
+	GLint boundFramebuffer = -1;
+	for (size_t position = 0; position < m_order.size(); position++)
+	{
+		FRAME_PASS& pass = m_passes[m_order[position]];
+		if ((pass.framebuffer >= 0) && (pass.framebuffer != boundFramebuffer))
+		{
+			GLTrace::BindFramebuffer(GL_FRAMEBUFFER, (GLuint)pass.framebuffer);
+			boundFramebuffer = pass.framebuffer;
+		}
+
+		if ((NULL != m_pFrameStats) && (pass.sectionID >= 0))
+			m_pFrameStats->BeginSection(pass.sectionID);
+
+		pass.execute(*this);
+
+		if ((NULL != m_pFrameStats) && (pass.sectionID >= 0))
+			m_pFrameStats->EndSection(pass.sectionID);
+	}
+}
+
+/***********************************************************
+ *  GetTexture()
+ ***********************************************************/
+GLuint FrameGraph::GetTexture(int resource) const
+{
+	if ((resource < 0) || (resource >= (int)m_resources.size()) || (m_resources[resource].target < 0))
+	{
+		return(0);
+	}
+	return(m_targets[m_resources[resource].target].texture);
+}
+
+/***********************************************************
+ *  GetTextureWidth()
+ ***********************************************************/
+int FrameGraph::GetTextureWidth(int resource) const
+{
+	if ((resource < 0) || (resource >= (int)m_resources.size()))
+	{
+		return(0);
+	}
+	return(m_resources[resource].width);
+}
+
+/***********************************************************
+ *  GetTextureHeight()
+ ***********************************************************/
+int FrameGraph::GetTextureHeight(int resource) const
+{
+	if ((resource < 0) || (resource >= (int)m_resources.size()))
+	{
+		return(0);
+	}
+	return(m_resources[resource].height);
+}
+
+/***********************************************************
+ *  Report()
+ *
+ *  This method is used for printing the pass order, the
+ *  culled passes, the framebuffer binds of a frame and the
+ *  memory the shared targets save.
+ ***********************************************************/
+void FrameGraph::Report() const
+{
+	std::cout << "FRAMEGRAPH: passes";
+	for (size_t position = 0; position < m_order.size(); position++)
+	{
+		std::cout << (position == 0 ? " " : " -> ") << m_passes[m_order[position]].name;
+	}
+	for (size_t p = 0; p < m_passes.size(); p++)
+	{
+		if (m_passes[p].bCulled)
+			std::cout << " | culled " << m_passes[p].name;
+	}
+
+	int bindCount = 0;
+	GLint boundFramebuffer = -1;
+	for (size_t position = 0; position < m_order.size(); position++)
+	{
+		GLint framebuffer = m_passes[m_order[position]].framebuffer;
+		if ((framebuffer >= 0) && (framebuffer != boundFramebuffer))
+		{
+			bindCount++;
+			boundFramebuffer = framebuffer;
+		}
+	}
+
+	size_t requestedBytes = 0;
+	size_t targetCount = 0;
+	for (size_t i = 0; i < m_resources.size(); i++)
+	{
+		const FRAME_RESOURCE& resource = m_resources[i];
+		if (!resource.bImported && (resource.target >= 0))
+		{
+			requestedBytes += ResourceTracker::GetImageBytes(resource.desc.internalFormat, resource.width, resource.height, 1);
+			targetCount++;
+		}
+	}
+	size_t allocatedBytes = 0;
+	for (size_t t = 0; t < m_targets.size(); t++)
+	{
+		allocatedBytes += ResourceTracker::GetImageBytes(m_targets[t].internalFormat, m_targets[t].width, m_targets[t].height, 1);
+	}
+
+	std::cout << std::fixed << std::setprecision(2)
+		<< " | framebuffer binds " << bindCount
+		<< " | targets " << targetCount << " in " << m_targets.size() << " textures, "
+		<< ToMegabytes(allocatedBytes) << " MB of " << ToMegabytes(requestedBytes) << " MB, saved "
+		<< ToMegabytes(requestedBytes - allocatedBytes) << " MB"
+		<< std::defaultfloat << std::endl;
+}
+
+/***********************************************************
+ *  IsDepthFormat()
+ ***********************************************************/
+bool FrameGraph::IsDepthFormat(GLenum internalFormat)
+{
+	return (internalFormat == GL_DEPTH_COMPONENT16) ||
+		(internalFormat == GL_DEPTH_COMPONENT24) ||
+		(internalFormat == GL_DEPTH_COMPONENT32F) ||
+		HasStencil(internalFormat);
+}
+
+/***********************************************************
+ *  HasStencil()
+ ***********************************************************/
+bool FrameGraph::HasStencil(GLenum internalFormat)
+{
+	return (internalFormat == GL_DEPTH24_STENCIL8) ||
+		(internalFormat == GL_DEPTH32F_STENCIL8);
+}
@@ -0,0 +1,171 @@
+///////////////////////////////////////////////////////////////////////////////
+// framegraph.h
+// ============
+// order the render passes of a frame and pool their render targets
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "FrameStats.h"
+
+#include <GL/glew.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  FRAME_TEXTURE_DESC
+ *
+ *  A render target a pass draws into, sized as a fraction
+ *  of the window so it follows the window size.
+ ***********************************************************/
+struct FRAME_TEXTURE_DESC
+{
+	// size as a fraction of the window framebuffer
+	float scale;
+	// internal format, a depth format is a depth attachment
+	GLenum internalFormat;
+};
+
+/***********************************************************
+ *  FrameGraph
+ *
+ *  This class runs the render passes of a frame.  Each pass
+ *  declares the render targets it reads and writes, and
+ *  Compile() works out the rest once:
+ *
+ *  - the passes are ordered so every pass runs after the
+ *    passes writing what it reads, and passes drawing into
+ *    the same targets are kept next to each other
+ *  - passes whose output nothing reads are culled, unless
+ *    they draw into the window or are marked as having a
+ *    side effect, like the frame capture
+ *  - the targets only live between their first and last
+ *    pass, so targets whose lifetimes do not overlap share
+ *    one texture from a pool that is kept across compiles
+ *  - the framebuffers are made once and bound only when the
+ *    next pass draws into other targets
+ *
+ *  The graph is built once and compiled again only when the
+ *  window size changes, so running it allocates nothing.
+ *  Every pass is timed as a section of the frame statistics.
+ ***********************************************************/
+class FrameGraph
+{
+public:
+	// draws a pass, with the targets of the graph to read from
+	typedef std::function<void(const FrameGraph& graph)> PassFunc;
+
+	// constructor
+	FrameGraph();
+	// destructor
+	~FrameGraph();
+
+	// time the passes as sections of the frame statistics
+	void SetFrameStats(FrameStats* pFrameStats);
+
+	// add the window framebuffer, returns its resource
+	int ImportBackbuffer(const char* name);
+	// add a render target, returns its resource
+	int CreateTexture(const char* name, const FRAME_TEXTURE_DESC& desc);
+	// add a pass, returns its index
+	int AddPass(const char* name, const PassFunc& execute);
+	// declare what a pass reads and draws into
+	void Read(int pass, int resource);
+	void Write(int pass, int resource);
+	// keep a pass even when nothing reads what it writes
+	void SetSideEffect(int pass);
+
+	// order and cull the passes and create the targets and
+	// framebuffers for the window size.  Returns false for a
+	// graph that cannot be run
+	bool Compile(int windowWidth, int windowHeight);
+	// true when the graph has to be compiled for the size
+	bool NeedsCompile(int windowWidth, int windowHeight) const;
+	// run the passes in order
+	void Execute();
+
+	// the texture of a target and its size, valid after Compile()
+	GLuint GetTexture(int resource) const;
+	int GetTextureWidth(int resource) const;
+	int GetTextureHeight(int resource) const;
+
+private:
+	struct FRAME_RESOURCE
+	{
+		std::string name;
+		FRAME_TEXTURE_DESC desc;
+		bool bImported;
+		int width;
+		int height;
+		// pooled texture, -1 for the window or an unused target
+		int target;
+		// first and last position in the pass order
+		int firstUse;
+		int lastUse;
+	};
+
+	struct FRAME_PASS
+	{
+		std::string name;
+		PassFunc execute;
+		std::vector<int> reads;
+		std::vector<int> writes;
+		bool bSideEffect;
+		bool bCulled;
+		int sectionID;
+		// framebuffer bound for the pass, -1 to leave the binding
+		GLint framebuffer;
+	};
+
+	// a dependency between two passes, data edges also keep
+	// the earlier pass from being culled
+	struct PASS_EDGE
+	{
+		int from;
+		int to;
+		bool bData;
+	};
+
+	struct POOLED_TARGET
+	{
+		GLuint texture;
+		GLenum internalFormat;
+		int width;
+		int height;
+		// last pass position of the targets sharing it, -1 free
+		int lastUse;
+	};
+
+	struct FRAMEBUFFER_ENTRY
+	{
+		GLuint framebuffer;
+		std::vector<GLuint> attachments;
+	};
+
+	FrameStats* m_pFrameStats;
+	std::vector<FRAME_RESOURCE> m_resources;
+	std::vector<FRAME_PASS> m_passes;
+	std::vector<PASS_EDGE> m_edges;
+	// the passes that are run, in order
+	std::vector<int> m_order;
+	std::vector<POOLED_TARGET> m_targets;
+	std::vector<FRAMEBUFFER_ENTRY> m_framebuffers;
+	int m_windowWidth;
+	int m_windowHeight;
+	bool m_bCompiled;
+
+	void FindDependencies();
+	void CullPasses();
+	bool OrderPasses();
+	void AllocateTargets();
+	bool CreateFramebuffers();
+	void DestroyFramebuffers();
+	// report what the compile did to the console
+	void Report() const;
+
+	static bool IsDepthFormat(GLenum internalFormat);
+	// depth formats with a stencil part
+	static bool HasStencil(GLenum internalFormat);
+};
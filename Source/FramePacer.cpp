@@ -0,0 +1,387 @@
+///////////////////////////////////////////////////////////////////////////////
+// framepacer.cpp
+// ============
+// pace the frames, cap the frame rate and limit the frames in flight
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FramePacer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+// declaration of global variables
+namespace
+{
+	// the spin starts this much before the frame time on top
+	// of the measured sleep overshoot
+	const double g_SpinMargin = 0.00025;
+	// the overshoot estimate starts here and decays back to
+	// the latest samples
+	const double g_InitialOvershoot = 0.002;
+	const double g_OvershootDecay = 0.99;
+	// timeout of one fence wait, the wait is repeated until the
+	// fence is signaled
+	const GLuint64 g_FenceTimeoutNs = 100000000;
+	// frames longer than this many periods count as missed
+	const double g_MissedFactor = 1.5;
+}
+
+// std::min() takes it by reference, which needs its storage
+// before C++17
+constexpr int FramePacer::MAX_FRAMES_IN_FLIGHT;
+
+/***********************************************************
+ *  FramePacer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FramePacer::FramePacer()
+{
+	m_framePeriod = 0.0;
+	m_maxFramesInFlight = 0;
+	m_reportInterval = 2.0;
+
+	m_frameStart = glfwGetTime();
+	m_nextFrameTime = m_frameStart;
+	m_lastPresentTime = 0.0;
+	m_sleepOvershoot = g_InitialOvershoot;
+	m_oldestFrame = 0;
+	m_framesInFlightCount = 0;
+	for (int i = 0; i < 2 * MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		m_queries[i] = 0;
+	}
+	m_gpuClockOffset = 0.0;
+
+	ResetReport(m_frameStart);
+}
+
+/***********************************************************
+ *  ~FramePacer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FramePacer::~FramePacer()
+{
+	while (m_framesInFlightCount > 0)
+	{
+		glDeleteSync(m_framesInFlight[m_oldestFrame].fence);
+		PopOldestFrame();
+	}
+	if (0 != m_queries[0])
+	{
+		glDeleteQueries(2 * MAX_FRAMES_IN_FLIGHT, m_queries);
+	}
+}
+
+/***********************************************************
+ *  SetVsync()
+ *
+ *  This method is used for turning the wait for the vertical
+ *  blank on the swap on or off, for the current context.
+ ***********************************************************/
+void FramePacer::SetVsync(bool bVsync)
+{
+	glfwSwapInterval(bVsync ? 1 : 0);
+}
+
+/***********************************************************
+ *  SetTargetFps()
+ *
+ *  This method is used for setting the frame rate cap.
+ ***********************************************************/
+void FramePacer::SetTargetFps(double framesPerSecond)
+{
+	if (framesPerSecond > 0.0)
+	{
+		m_framePeriod = 1.0 / framesPerSecond;
+	}
+	else
+	{
+		m_framePeriod = 0.0;
+	}
+	m_nextFrameTime = glfwGetTime();
+}
+
+/***********************************************************
+ *  SetMaxFramesInFlight()
+ *
+ *  This method is used for limiting how many frames the CPU
+ *  may submit before the GPU has finished the oldest one.
+ ***********************************************************/
+void FramePacer::SetMaxFramesInFlight(int frameCount)
+{
+	m_maxFramesInFlight = std::min(std::max(frameCount, 0), MAX_FRAMES_IN_FLIGHT);
+}
+
+/***********************************************************
+ *  SetReportInterval()
+ *
+ *  This method is used for setting how often the totals are
+ *  printed, 0 disables the report.
+ ***********************************************************/
+void FramePacer::SetReportInterval(double seconds)
+{
+	m_reportInterval = seconds;
+}
+
+/***********************************************************
+ *  WaitForFrameStart()
+ *
+ *  This method is used for holding the loop until the GPU
+ *  has caught up and the frame rate cap allows the next
+ *  frame.  The input read after this is the input of the
+ *  frame.
+ ***********************************************************/
+void FramePacer::WaitForFrameStart()
+{
+	WaitForFences();
+	WaitForCap();
+
+	m_frameStart = glfwGetTime();
+	Report(m_frameStart);
+}
+
+/***********************************************************
+ *  FramePresented()
+ *
+ *  This method is used for fencing the frame that was just
+ *  swapped and timing the interval since the last one.  A
+ *  timestamp query before the fence records when the GPU
+ *  finished the frame, and the GPU clock is matched to the
+ *  CPU clock to turn it into a latency.
+ ***********************************************************/
+void FramePacer::FramePresented()
+{
+	double now = glfwGetTime();
+
+	if (0 == m_queries[0])
+	{
+		glGenQueries(2 * MAX_FRAMES_IN_FLIGHT, m_queries);
+	}
+
+	// the fence is not needed once the GPU has passed it, the
+	// oldest ones are given up when the GPU falls far behind
+	if (m_framesInFlightCount >= 2 * MAX_FRAMES_IN_FLIGHT)
+	{
+		glDeleteSync(m_framesInFlight[m_oldestFrame].fence);
+		PopOldestFrame();
+	}
+	int slot = (m_oldestFrame + m_framesInFlightCount) % (2 * MAX_FRAMES_IN_FLIGHT);
+	FRAME_IN_FLIGHT& frame = m_framesInFlight[slot];
+	frame.query = m_queries[slot];
+	glQueryCounter(frame.query, GL_TIMESTAMP);
+	frame.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	frame.inputTime = m_frameStart;
+	m_framesInFlightCount++;
+	// make sure the fence reaches the GPU
+	glFlush();
+
+	GLint64 gpuTime = 0;
+	glGetInteger64v(GL_TIMESTAMP, &gpuTime);
+	m_gpuClockOffset = glfwGetTime() - (double)gpuTime * 1.0e-9;
+
+	if (m_lastPresentTime > 0.0)
+	{
+		double interval = now - m_lastPresentTime;
+		m_frameCount++;
+		m_intervalSum += interval;
+		m_intervalSquareSum += interval * interval;
+		m_intervalMax = std::max(m_intervalMax, interval);
+		if ((m_framePeriod > 0.0) && (interval > m_framePeriod * g_MissedFactor))
+		{
+			m_missedCount++;
+		}
+	}
+	m_lastPresentTime = now;
+
+	// the next frame is due one period after this one, unless
+	// this frame started so late that catching up would burst
+	if (m_framePeriod > 0.0)
+	{
+		if (m_frameStart - m_nextFrameTime > m_framePeriod)
+		{
+			m_nextFrameTime = m_frameStart;
+		}
+		m_nextFrameTime += m_framePeriod;
+	}
+}
+
+/***********************************************************
+ *  WaitForCap()
+ *
+ *  This method is used for waiting until the next frame is
+ *  due.  The thread sleeps while the sleep cannot overshoot
+ *  the frame time and spins through the rest.  How far the
+ *  sleeps overshoot is measured, since the granularity of
+ *  the system timer differs a lot between systems.
+ ***********************************************************/
+void FramePacer::WaitForCap()
+{
+	if (m_framePeriod <= 0.0)
+	{
+		return;
+	}
+
+	double now = glfwGetTime();
+	double sleepUntil = m_nextFrameTime - m_sleepOvershoot - g_SpinMargin;
+	while (now < sleepUntil)
+	{
+		double request = sleepUntil - now;
+		std::this_thread::sleep_for(std::chrono::duration<double>(request));
+
+		double after = glfwGetTime();
+		double overshoot = (after - now) - request;
+		m_sleepOvershoot = std::max(overshoot, m_sleepOvershoot * g_OvershootDecay);
+		m_sleepTime += after - now;
+		now = after;
+		sleepUntil = m_nextFrameTime - m_sleepOvershoot - g_SpinMargin;
+	}
+
+	double spinStart = now;
+	while (now < m_nextFrameTime)
+	{
+		std::this_thread::yield();
+		now = glfwGetTime();
+	}
+	m_spinTime += now - spinStart;
+}
+
+/***********************************************************
+ *  WaitForFences()
+ *
+ *  This method is used for waiting until no more than the
+ *  allowed number of frames minus the new one are still
+ *  being worked on by the GPU.
+ ***********************************************************/
+void FramePacer::WaitForFences()
+{
+	// retire whatever is already done, for the latency report
+	RetireFrames(false);
+	if (m_maxFramesInFlight <= 0)
+	{
+		return;
+	}
+
+	double start = glfwGetTime();
+	while (m_framesInFlightCount >= m_maxFramesInFlight)
+	{
+		RetireFrames(true);
+	}
+	m_fenceTime += glfwGetTime() - start;
+}
+
+/***********************************************************
+ *  RetireFrames()
+ *
+ *  This method is used for removing the frames the GPU has
+ *  finished and timing them from their input to the GPU
+ *  timestamp taken at their end.  With the wait flag the
+ *  oldest frame is waited for, otherwise the fences are only
+ *  checked.
+ ***********************************************************/
+void FramePacer::RetireFrames(bool bWaitForOldest)
+{
+	bool bWait = bWaitForOldest;
+	while (m_framesInFlightCount > 0)
+	{
+		FRAME_IN_FLIGHT& frame = m_framesInFlight[m_oldestFrame];
+		GLenum result = glClientWaitSync(frame.fence, bWait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, bWait ? g_FenceTimeoutNs : 0);
+		if (GL_TIMEOUT_EXPIRED == result)
+		{
+			if (bWait)
+			{
+				continue;
+			}
+			return;
+		}
+
+		// a failed wait retires the fence so the loop cannot hang
+		if (GL_WAIT_FAILED != result)
+		{
+			// the query is before the fence, so its result is ready
+			GLuint64 doneTime = 0;
+			glGetQueryObjectui64v(frame.query, GL_QUERY_RESULT, &doneTime);
+			double latency = ((double)doneTime * 1.0e-9 + m_gpuClockOffset) - frame.inputTime;
+			m_latencyCount++;
+			m_latencySum += latency;
+			m_latencyMax = std::max(m_latencyMax, latency);
+		}
+		glDeleteSync(frame.fence);
+		PopOldestFrame();
+		bWait = false;
+	}
+}
+
+/***********************************************************
+ *  PopOldestFrame()
+ *
+ *  This method is used for removing the oldest frame from
+ *  the ring, its fence must already be deleted.
+ ***********************************************************/
+void FramePacer::PopOldestFrame()
+{
+	m_oldestFrame = (m_oldestFrame + 1) % (2 * MAX_FRAMES_IN_FLIGHT);
+	m_framesInFlightCount--;
+}
+
+/***********************************************************
+ *  Report()
+ *
+ *  This method is used for printing the frame rate, the
+ *  jitter of the frame times, the input to GPU done latency
+ *  and where the loop waited, once the interval has passed.
+ ***********************************************************/
+void FramePacer::Report(double now)
+{
+	double elapsed = now - m_reportStartTime;
+	if ((m_reportInterval <= 0.0) || (elapsed < m_reportInterval) || (m_frameCount == 0))
+	{
+		return;
+	}
+
+	double averageInterval = m_intervalSum / m_frameCount;
+	double variance = std::max(m_intervalSquareSum / m_frameCount - averageInterval * averageInterval, 0.0);
+
+	std::cout << std::fixed << std::setprecision(2)
+		<< "PACING: " << (1.0 / averageInterval) << " fps"
+		<< " | frame " << averageInterval * 1000.0 << " ms jitter " << std::sqrt(variance) * 1000.0
+		<< " ms max " << m_intervalMax * 1000.0 << " ms missed " << m_missedCount;
+	if (m_latencyCount > 0)
+	{
+		std::cout << " | latency avg " << (m_latencySum / m_latencyCount) * 1000.0
+			<< " ms max " << m_latencyMax * 1000.0 << " ms";
+	}
+	std::cout << " | per frame sleep " << (m_sleepTime / m_frameCount) * 1000.0
+		<< " ms spin " << (m_spinTime / m_frameCount) * 1000.0
+		<< " ms fence " << (m_fenceTime / m_frameCount) * 1000.0 << " ms"
+		<< std::defaultfloat << std::endl;
+
+	ResetReport(now);
+}
+
+/***********************************************************
+ *  ResetReport()
+ *
+ *  This method is used for starting the totals of the next
+ *  report interval.
+ ***********************************************************/
+void FramePacer::ResetReport(double now)
+{
+	m_reportStartTime = now;
+	m_frameCount = 0;
+	m_intervalSum = 0.0;
+	m_intervalSquareSum = 0.0;
+	m_intervalMax = 0.0;
+	m_missedCount = 0;
+	m_latencyCount = 0;
+	m_latencySum = 0.0;
+	m_latencyMax = 0.0;
+	m_sleepTime = 0.0;
+	m_spinTime = 0.0;
+	m_fenceTime = 0.0;
+}
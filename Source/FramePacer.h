@@ -0,0 +1,109 @@
+///////////////////////////////////////////////////////////////////////////////
+// framepacer.h
+// ============
+// pace the frames, cap the frame rate and limit the frames in flight
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include "GLFW/glfw3.h"
+
+
+/***********************************************************
+ *  FramePacer
+ *
+ *  This class controls when the render loop starts a frame.
+ *  The frame rate cap sleeps while the wait is long and spins
+ *  through the end, so it saves power without missing the
+ *  start time by a sleep granule.  A fence after each swap
+ *  limits how many frames the CPU may run ahead of the GPU;
+ *  one frame in flight gives the lowest latency.  The time
+ *  from reading the input to the GPU finishing the frame,
+ *  taken from a timestamp query so it does not depend on
+ *  when the fence is checked, and the jitter of the frame
+ *  times are printed to the console.
+ ***********************************************************/
+class FramePacer
+{
+public:
+	// largest number of frames that can be in flight
+	static constexpr int MAX_FRAMES_IN_FLIGHT = 4;
+
+	// constructor
+	FramePacer();
+	// destructor
+	~FramePacer();
+
+	// turn waiting for the vertical blank on or off for the
+	// current context
+	void SetVsync(bool bVsync);
+	// frames per second to cap at, 0 for no cap
+	void SetTargetFps(double framesPerSecond);
+	// frames the CPU may queue ahead of the GPU, 0 leaves it
+	// to the driver
+	void SetMaxFramesInFlight(int frameCount);
+	// set the console report interval, 0 disables the report
+	void SetReportInterval(double seconds);
+
+	// wait until the next frame may start, call before the
+	// input is read so it is as fresh as possible
+	void WaitForFrameStart();
+	// call right after the buffers were swapped
+	void FramePresented();
+
+private:
+	struct FRAME_IN_FLIGHT
+	{
+		GLsync fence;
+		// GPU time the frame was done at
+		GLuint query;
+		// when the input of the frame was read
+		double inputTime;
+	};
+
+	double m_framePeriod;
+	int m_maxFramesInFlight;
+	double m_reportInterval;
+
+	double m_frameStart;
+	double m_nextFrameTime;
+	double m_lastPresentTime;
+	// longest a sleep was seen to oversleep, so the spin
+	// starts early enough
+	double m_sleepOvershoot;
+	// fenced frames oldest first, a fixed ring so presenting a
+	// frame never allocates
+	FRAME_IN_FLIGHT m_framesInFlight[2 * MAX_FRAMES_IN_FLIGHT];
+	int m_oldestFrame;
+	int m_framesInFlightCount;
+	// a timestamp query per ring entry, 0 until the first frame
+	GLuint m_queries[2 * MAX_FRAMES_IN_FLIGHT];
+	// CPU time minus GPU time, in seconds
+	double m_gpuClockOffset;
+
+	// totals since the last report
+	double m_reportStartTime;
+	int m_frameCount;
+	double m_intervalSum;
+	double m_intervalSquareSum;
+	double m_intervalMax;
+	int m_missedCount;
+	int m_latencyCount;
+	double m_latencySum;
+	double m_latencyMax;
+	double m_sleepTime;
+	double m_spinTime;
+	double m_fenceTime;
+
+	// wait for the cap and the frames in flight
+	void WaitForCap();
+	void WaitForFences();
+	// retire the fences the GPU has passed, or wait for the
+	// oldest one
+	void RetireFrames(bool bWaitForOldest);
+	void PopOldestFrame();
+	// print the totals and start new ones when it is time
+	void Report(double now);
+	void ResetReport(double now);
+};
@@ -0,0 +1,369 @@
+///////////////////////////////////////////////////////////////////////////////
+// framestats.cpp
+// ============
+// measure the CPU and GPU time of the frame and its render sections
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameStats.h"
+#include "AllocationCounter.h"
+#include "ResourceTracker.h"
+
+#include "GLFW/glfw3.h"
+
+#include <iostream>
+#include <iomanip>
+
+// declaration of global variables
+namespace
+{
+	// weight of the newest sample in the smoothed averages
+	const double g_SmoothingFactor = 0.1;
+	// counters of an unknown section
+	const GL_COUNTERS g_NoCounters = {};
+
+	double Smooth(double average, double sample)
+	{
+		if (average <= 0.0)
+			return(sample);
+		return(average + (sample - average) * g_SmoothingFactor);
+	}
+
+	double ToMegabytes(uint64_t bytes)
+	{
+		return((double)bytes / (1024.0 * 1024.0));
+	}
+}
+
+/***********************************************************
+ *  FrameStats()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameStats::FrameStats()
+{
+	m_bInitialized = false;
+	m_frameNumber = 0;
+	m_frameStart = 0.0;
+	m_lastFrameStart = 0.0;
+	m_frameMs = 0.0;
+	m_frameCpuMs = 0.0;
+	m_lastFrameMs = 0.0;
+	m_lastFrameCpuMs = 0.0;
+	m_frameCountersStart = GL_COUNTERS();
+	m_frameCounters = GL_COUNTERS();
+	m_frameAllocationsStart = 0;
+	m_frameAllocations = 0;
+	m_reportInterval = 2.0;
+	m_lastReport = 0.0;
+}
+
+/***********************************************************
+ *  ~FrameStats()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameStats::~FrameStats()
+{
+	if (m_bInitialized)
+	{
+		for (size_t i = 0; i < m_sections.size(); i++)
+		{
+			glDeleteQueries(QUERY_FRAMES * 2, &m_sections[i].queries[0][0]);
+		}
+	}
+	m_sections.clear();
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for creating the timer queries of
+ *  the sections registered so far.  Sections registered
+ *  later create their queries immediately.
+ ***********************************************************/
+void FrameStats::Initialize()
+{
+	for (size_t i = 0; i < m_sections.size(); i++)
+	{
+		glGenQueries(QUERY_FRAMES * 2, &m_sections[i].queries[0][0]);
+	}
+	m_bInitialized = true;
+	m_lastReport = glfwGetTime();
+}
+
+/***********************************************************
+ *  RegisterSection()
+ *
+ *  This method is used for registering a named section of
+ *  the frame.  Registering the same name twice returns the
+ *  existing ID.
+ ***********************************************************/
+int FrameStats::RegisterSection(const char* name)
+{
+	for (size_t i = 0; i < m_sections.size(); i++)
+	{
+		if (m_sections[i].name.compare(name) == 0)
+		{
+			return((int)i);
+		}
+	}
+
+	SECTION_INFO section;
+	section.name = name;
+	section.traceName = GLTrace::RegisterName(name);
+	section.cpuStart = 0.0;
+	section.cpuMs = 0.0;
+	section.gpuMs = 0.0;
+	section.countersStart = GL_COUNTERS();
+	section.counters = GL_COUNTERS();
+	for (int i = 0; i < QUERY_FRAMES; i++)
+	{
+		section.queries[i][0] = 0;
+		section.queries[i][1] = 0;
+		section.bIssued[i] = false;
+	}
+	if (m_bInitialized)
+	{
+		glGenQueries(QUERY_FRAMES * 2, &section.queries[0][0]);
+	}
+	m_sections.push_back(section);
+
+	return((int)m_sections.size() - 1);
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for marking the start of a frame and
+ *  collecting the GPU times of the frame that used the same
+ *  query slot a few frames ago.
+ ***********************************************************/
+void FrameStats::BeginFrame()
+{
+	m_frameStart = glfwGetTime();
+	if (m_lastFrameStart > 0.0)
+	{
+		m_lastFrameMs = (m_frameStart - m_lastFrameStart) * 1000.0;
+		m_frameMs = Smooth(m_frameMs, m_lastFrameMs);
+	}
+	m_lastFrameStart = m_frameStart;
+	m_frameCountersStart = GLTrace::GetCounters();
+	m_frameAllocationsStart = AllocationCounter::GetThreadAllocations();
+
+	if (m_bInitialized)
+	{
+		CollectGpuTimes((int)(m_frameNumber % QUERY_FRAMES));
+	}
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for marking the end of a frame and
+ *  printing the report when the interval has passed.
+ ***********************************************************/
+void FrameStats::EndFrame()
+{
+	double now = glfwGetTime();
+	m_lastFrameCpuMs = (now - m_frameStart) * 1000.0;
+	m_frameCpuMs = Smooth(m_frameCpuMs, m_lastFrameCpuMs);
+	m_frameCounters = GLTrace::Difference(GLTrace::GetCounters(), m_frameCountersStart);
+	m_frameAllocations = AllocationCounter::GetThreadAllocations() - m_frameAllocationsStart;
+	m_frameNumber++;
+
+	if ((m_reportInterval > 0.0) && (now - m_lastReport >= m_reportInterval))
+	{
+		Report();
+		m_lastReport = now;
+	}
+}
+
+/***********************************************************
+ *  BeginSection()
+ *
+ *  This method is used for marking the start of a section.
+ ***********************************************************/
+void FrameStats::BeginSection(int sectionID)
+{
+	if ((sectionID < 0) || (sectionID >= (int)m_sections.size()))
+	{
+		return;
+	}
+
+	SECTION_INFO& section = m_sections[sectionID];
+	GLTrace::BeginSection(section.traceName);
+	section.countersStart = GLTrace::GetCounters();
+	section.cpuStart = glfwGetTime();
+	if (m_bInitialized)
+	{
+		int slot = (int)(m_frameNumber % QUERY_FRAMES);
+		glQueryCounter(section.queries[slot][0], GL_TIMESTAMP);
+	}
+}
+
+/***********************************************************
+ *  EndSection()
+ *
+ *  This method is used for marking the end of a section.
+ ***********************************************************/
+void FrameStats::EndSection(int sectionID)
+{
+	if ((sectionID < 0) || (sectionID >= (int)m_sections.size()))
+	{
+		return;
+	}
+
+	SECTION_INFO& section = m_sections[sectionID];
+	section.cpuMs = Smooth(section.cpuMs, (glfwGetTime() - section.cpuStart) * 1000.0);
+	section.counters = GLTrace::Difference(GLTrace::GetCounters(), section.countersStart);
+	GLTrace::EndSection(section.traceName);
+	if (m_bInitialized)
+	{
+		int slot = (int)(m_frameNumber % QUERY_FRAMES);
+		glQueryCounter(section.queries[slot][1], GL_TIMESTAMP);
+		section.bIssued[slot] = true;
+	}
+}
+
+/***********************************************************
+ *  CollectGpuTimes()
+ *
+ *  This method is used for reading the timestamp queries
+ *  of a slot.  Results that are not available yet are
+ *  skipped instead of waited for.
+ ***********************************************************/
+void FrameStats::CollectGpuTimes(int slot)
+{
+	for (size_t i = 0; i < m_sections.size(); i++)
+	{
+		SECTION_INFO& section = m_sections[i];
+		if (!section.bIssued[slot])
+		{
+			continue;
+		}
+		section.bIssued[slot] = false;
+
+		GLint bAvailable = 0;
+		glGetQueryObjectiv(section.queries[slot][1], GL_QUERY_RESULT_AVAILABLE, &bAvailable);
+		if (bAvailable)
+		{
+			GLuint64 startTime = 0;
+			GLuint64 endTime = 0;
+			glGetQueryObjectui64v(section.queries[slot][0], GL_QUERY_RESULT, &startTime);
+			glGetQueryObjectui64v(section.queries[slot][1], GL_QUERY_RESULT, &endTime);
+			section.gpuMs = Smooth(section.gpuMs, (double)(endTime - startTime) / 1000000.0);
+		}
+	}
+}
+
+/***********************************************************
+ *  SetReportInterval()
+ *
+ *  This method is used for setting how often the averages
+ *  are printed to the console.
+ ***********************************************************/
+void FrameStats::SetReportInterval(double seconds)
+{
+	m_reportInterval = seconds;
+}
+
+/***********************************************************
+ *  GetSectionName()
+ ***********************************************************/
+const char* FrameStats::GetSectionName(int sectionID) const
+{
+	if ((sectionID < 0) || (sectionID >= (int)m_sections.size()))
+	{
+		return("");
+	}
+	return(m_sections[sectionID].name.c_str());
+}
+
+/***********************************************************
+ *  GetSectionCpuMs()
+ ***********************************************************/
+double FrameStats::GetSectionCpuMs(int sectionID) const
+{
+	if ((sectionID < 0) || (sectionID >= (int)m_sections.size()))
+	{
+		return(0.0);
+	}
+	return(m_sections[sectionID].cpuMs);
+}
+
+/***********************************************************
+ *  GetSectionGpuMs()
+ ***********************************************************/
+double FrameStats::GetSectionGpuMs(int sectionID) const
+{
+	if ((sectionID < 0) || (sectionID >= (int)m_sections.size()))
+	{
+		return(0.0);
+	}
+	return(m_sections[sectionID].gpuMs);
+}
+
+/***********************************************************
+ *  GetSectionCounters()
+ ***********************************************************/
+const GL_COUNTERS& FrameStats::GetSectionCounters(int sectionID) const
+{
+	if ((sectionID < 0) || (sectionID >= (int)m_sections.size()))
+	{
+		return(g_NoCounters);
+	}
+	return(m_sections[sectionID].counters);
+}
+
+/***********************************************************
+ *  Report()
+ *
+ *  This method is used for printing the smoothed frame and
+ *  section times, the OpenGL calls of the last frame and the
+ *  memory the resource tracker counts to the console.
+ ***********************************************************/
+void FrameStats::Report()
+{
+	std::cout << std::fixed << std::setprecision(2)
+		<< "STATS: frame " << m_frameMs << " ms (cpu " << m_frameCpuMs << " ms)"
+		<< " allocs " << m_frameAllocations;
+	for (size_t i = 0; i < m_sections.size(); i++)
+	{
+		std::cout << " | " << m_sections[i].name
+			<< " cpu " << m_sections[i].cpuMs << " ms"
+			<< " gpu " << m_sections[i].gpuMs << " ms";
+	}
+	std::cout << std::defaultfloat << std::endl;
+
+	const GL_COUNTERS& frame = m_frameCounters;
+	std::cout << "GLCALLS: frame draws " << frame.drawCalls
+		<< " tris " << frame.triangles
+		<< " textures " << frame.textureBinds
+		<< " programs " << frame.programSwitches
+		<< " uniforms " << frame.uniformUploads
+		<< " bytes " << frame.bufferBytes
+		<< " state " << frame.stateChanges
+		<< " redundant " << frame.redundantCalls;
+	for (size_t i = 0; i < m_sections.size(); i++)
+	{
+		const GL_COUNTERS& section = m_sections[i].counters;
+		std::cout << " | " << m_sections[i].name
+			<< " draws " << section.drawCalls
+			<< " tris " << section.triangles
+			<< " uniforms " << section.uniformUploads;
+	}
+	std::cout << std::endl;
+
+	std::cout << std::fixed << std::setprecision(2)
+		<< "MEMORY: gpu " << ToMegabytes(ResourceTracker::GetGpuBytes())
+		<< " MB (peak " << ToMegabytes(ResourceTracker::GetGpuPeakBytes()) << " MB)"
+		<< " host " << ToMegabytes(ResourceTracker::GetHostBytes())
+		<< " MB (peak " << ToMegabytes(ResourceTracker::GetHostPeakBytes()) << " MB)";
+	for (int i = 0; i < RESOURCE_CATEGORY_COUNT; i++)
+	{
+		RESOURCE_CATEGORY category = (RESOURCE_CATEGORY)i;
+		std::cout << " | " << ResourceTracker::GetCategoryName(category)
+			<< " " << ToMegabytes(ResourceTracker::GetLiveBytes(category)) << " MB";
+	}
+	std::cout << std::defaultfloat << std::endl;
+}
@@ -0,0 +1,110 @@
+///////////////////////////////////////////////////////////////////////////////
+// framestats.h
+// ============
+// measure the CPU and GPU time of the frame and its render sections
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "GLTrace.h"
+
+#include <GL/glew.h>
+
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  FrameStats
+ *
+ *  This class measures the time of each frame and of named
+ *  render sections.  GPU times use timestamp queries that
+ *  are read back a few frames later, so measuring never
+ *  waits on the GPU.  The OpenGL calls made through GLTrace
+ *  are counted per frame and per section as well, and so
+ *  are the heap allocations of the render thread.  The
+ *  averages and the counts of the last frame are printed to
+ *  the console at a fixed interval.
+ ***********************************************************/
+class FrameStats
+{
+public:
+	// number of frames the GPU query results are delayed by
+	static const int QUERY_FRAMES = 4;
+
+	// constructor
+	FrameStats();
+	// destructor
+	~FrameStats();
+
+	// create the GPU queries - needs a current OpenGL context
+	void Initialize();
+
+	// mark the start and end of a frame
+	void BeginFrame();
+	void EndFrame();
+
+	// register a named section and return its ID
+	int RegisterSection(const char* name);
+	// mark the start and end of a section inside the frame
+	void BeginSection(int sectionID);
+	void EndSection(int sectionID);
+
+	// set the console report interval, 0 disables the report
+	void SetReportInterval(double seconds);
+
+	// smoothed frame times in milliseconds
+	double GetFrameMs() const { return m_frameMs; }
+	double GetFrameCpuMs() const { return m_frameCpuMs; }
+	// unsmoothed times of the last frame in milliseconds
+	double GetLastFrameMs() const { return m_lastFrameMs; }
+	double GetLastFrameCpuMs() const { return m_lastFrameCpuMs; }
+	// smoothed section times in milliseconds
+	int GetSectionCount() const { return (int)m_sections.size(); }
+	const char* GetSectionName(int sectionID) const;
+	double GetSectionCpuMs(int sectionID) const;
+	double GetSectionGpuMs(int sectionID) const;
+	// OpenGL calls of the last frame and of its sections
+	const GL_COUNTERS& GetFrameCounters() const { return m_frameCounters; }
+	const GL_COUNTERS& GetSectionCounters(int sectionID) const;
+	// heap allocations the render thread made in the last frame
+	uint64_t GetFrameAllocations() const { return m_frameAllocations; }
+	// number of frames since the start
+	unsigned long long GetFrameNumber() const { return m_frameNumber; }
+
+private:
+	struct SECTION_INFO
+	{
+		std::string name;
+		// handle of the name in the GL call traces
+		int traceName;
+		double cpuStart;
+		double cpuMs;
+		double gpuMs;
+		// begin and end timestamp queries per delayed frame
+		GLuint queries[QUERY_FRAMES][2];
+		bool bIssued[QUERY_FRAMES];
+		GL_COUNTERS countersStart;
+		GL_COUNTERS counters;
+	};
+
+	bool m_bInitialized;
+	std::vector<SECTION_INFO> m_sections;
+	unsigned long long m_frameNumber;
+	double m_frameStart;
+	double m_lastFrameStart;
+	double m_frameMs;
+	double m_frameCpuMs;
+	double m_lastFrameMs;
+	double m_lastFrameCpuMs;
+	GL_COUNTERS m_frameCountersStart;
+	GL_COUNTERS m_frameCounters;
+	uint64_t m_frameAllocationsStart;
+	uint64_t m_frameAllocations;
+	double m_reportInterval;
+	double m_lastReport;
+
+	// read the finished queries of the current slot
+	void CollectGpuTimes(int slot);
+	// print the averages to the console
+	void Report();
+};
@@ -0,0 +1,1156 @@
+///////////////////////////////////////////////////////////////////////////////
+// gltrace.cpp
+// ============
+// count and record the OpenGL calls of the render path
+///////////////////////////////////////////////////////////////////////////////
+
+#include "GLTrace.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <vector>
+
+// declaration of global variables
+namespace
+{
+	// stands for a binding the layer has not seen yet
+	const GLuint g_UnknownBinding = 0xFFFFFFFFu;
+	// triangles in the plane, box and cylinder meshes
+	const uint32_t g_MeshTriangles[MESH_TYPE_COUNT] = { 2, 12, 144 };
+
+	GLTrace::TRACE_BACKEND g_Backend = GLTrace::TRACE_BACKEND_OPENGL;
+	GL_COUNTERS g_Counters = {};
+
+	// state set through the layer, to find redundant calls
+	GLuint g_Program = g_UnknownBinding;
+	GLenum g_ActiveUnit = GL_TEXTURE0;
+	std::map<uint64_t, GLuint> g_TextureBindings;
+	std::map<GLenum, bool> g_Capabilities;
+	std::map<GLenum, GLuint> g_FramebufferBindings;
+	GLint g_DepthMask = -1;
+	GLenum g_DepthFunc = 0;
+	GLuint g_VertexArray = g_UnknownBinding;
+
+	// open capture, its calls are buffered and written out at
+	// the end of each frame
+	FILE* g_pCaptureFile = NULL;
+	std::vector<uint8_t> g_CaptureBuffer;
+	// names already written to the open capture
+	std::vector<bool> g_CapturedNames;
+
+	// uniform locations per program, by name handle
+	const GLint g_UnknownLocation = -2;
+	std::map<GLuint, std::vector<GLint>> g_UniformLocations;
+
+	// the registered names, kept in a function so handles can
+	// be registered while the globals of other files are set up
+	struct NAME_TABLE
+	{
+		std::vector<std::string> names;
+		std::map<std::string, int, std::less<>> handles;
+	};
+
+	NAME_TABLE& GetNameTable()
+	{
+		static NAME_TABLE table;
+		return(table);
+	}
+
+	/***********************************************************
+	 *  Write()
+	 *
+	 *  This function is used for appending a value to the
+	 *  capture buffer.
+	 ***********************************************************/
+	template <typename T>
+	void Write(const T& value)
+	{
+		const uint8_t* pBytes = reinterpret_cast<const uint8_t*>(&value);
+		g_CaptureBuffer.insert(g_CaptureBuffer.end(), pBytes, pBytes + sizeof(T));
+	}
+
+	/***********************************************************
+	 *  WriteCall()
+	 *
+	 *  This function is used for starting a call record.
+	 ***********************************************************/
+	void WriteCall(TRACE_CALL call)
+	{
+		g_CaptureBuffer.push_back((uint8_t)call);
+	}
+
+	/***********************************************************
+	 *  CaptureName()
+	 *
+	 *  This function is used for recording a name the first
+	 *  time the open capture uses it.
+	 ***********************************************************/
+	void CaptureName(int handle)
+	{
+		if ((size_t)handle >= g_CapturedNames.size())
+		{
+			g_CapturedNames.resize(handle + 1, false);
+		}
+		if (g_CapturedNames[handle])
+		{
+			return;
+		}
+		g_CapturedNames[handle] = true;
+
+		const std::string& name = GetNameTable().names[handle];
+		WriteCall(TRACE_NAME);
+		Write((uint16_t)handle);
+		Write((uint16_t)name.size());
+		g_CaptureBuffer.insert(g_CaptureBuffer.end(), name.begin(), name.end());
+	}
+
+	/***********************************************************
+	 *  CaptureUniform()
+	 *
+	 *  This function is used for counting a uniform upload and
+	 *  recording it when a capture is open.
+	 ***********************************************************/
+	template <typename T>
+	void CaptureUniform(TRACE_CALL call, int uniform, const T& value)
+	{
+		g_Counters.uniformUploads++;
+		if (NULL == g_pCaptureFile)
+		{
+			return;
+		}
+		CaptureName(uniform);
+		WriteCall(call);
+		Write((uint16_t)uniform);
+		Write(value);
+	}
+
+	/***********************************************************
+	 *  GetUniformLocation()
+	 *
+	 *  This function is used for getting the location of a
+	 *  uniform in a program, asking OpenGL only the first time.
+	 ***********************************************************/
+	GLint GetUniformLocation(ShaderManager* pShader, int uniform)
+	{
+		std::vector<GLint>& locations = g_UniformLocations[(GLuint)pShader->m_programID];
+		if ((size_t)uniform >= locations.size())
+		{
+			locations.resize(GetNameTable().names.size(), g_UnknownLocation);
+		}
+		if (g_UnknownLocation == locations[uniform])
+		{
+			locations[uniform] = glGetUniformLocation(pShader->m_programID, GetNameTable().names[uniform].c_str());
+		}
+		return(locations[uniform]);
+	}
+
+	/***********************************************************
+	 *  CaptureProgram()
+	 *
+	 *  This function is used for counting a program switch and
+	 *  recording it when a capture is open.
+	 ***********************************************************/
+	void CaptureProgram(GLuint programID)
+	{
+		g_Counters.programSwitches++;
+		if (g_Program == programID)
+		{
+			g_Counters.redundantCalls++;
+		}
+		g_Program = programID;
+
+		if (NULL != g_pCaptureFile)
+		{
+			WriteCall(TRACE_USE_PROGRAM);
+			Write((uint32_t)programID);
+		}
+	}
+
+	/***********************************************************
+	 *  ChangeState()
+	 *
+	 *  This function is used for counting a state change and
+	 *  whether it changed anything.
+	 ***********************************************************/
+	template <typename T>
+	void ChangeState(T& current, const T& value)
+	{
+		g_Counters.stateChanges++;
+		if (current == value)
+		{
+			g_Counters.redundantCalls++;
+		}
+		current = value;
+	}
+
+	/***********************************************************
+	 *  SetCapability()
+	 *
+	 *  This function is used for counting an enable or disable.
+	 ***********************************************************/
+	void SetCapability(GLenum capability, bool bEnabled)
+	{
+		g_Counters.stateChanges++;
+		std::map<GLenum, bool>::iterator found = g_Capabilities.find(capability);
+		if ((found != g_Capabilities.end()) && (found->second == bEnabled))
+		{
+			g_Counters.redundantCalls++;
+		}
+		g_Capabilities[capability] = bEnabled;
+	}
+
+	bool IsOpenGL()
+	{
+		return(GLTrace::TRACE_BACKEND_OPENGL == g_Backend);
+	}
+}
+
+/***********************************************************
+ *  SetBackend()
+ *
+ *  This method is used for choosing whether the calls reach
+ *  OpenGL or are only counted and recorded.
+ ***********************************************************/
+void GLTrace::SetBackend(TRACE_BACKEND backend)
+{
+	g_Backend = backend;
+	ResetState();
+}
+
+/***********************************************************
+ *  GetBackend()
+ ***********************************************************/
+GLTrace::TRACE_BACKEND GLTrace::GetBackend()
+{
+	return(g_Backend);
+}
+
+/***********************************************************
+ *  GetCounters()
+ *
+ *  This method is used for getting the counts of all the
+ *  calls made through the layer since the start.
+ ***********************************************************/
+const GL_COUNTERS& GLTrace::GetCounters()
+{
+	return(g_Counters);
+}
+
+/***********************************************************
+ *  Difference()
+ *
+ *  This method is used for getting the counts of the calls
+ *  made between two snapshots of the counters.
+ ***********************************************************/
+GL_COUNTERS GLTrace::Difference(const GL_COUNTERS& later, const GL_COUNTERS& earlier)
+{
+	GL_COUNTERS difference;
+	difference.drawCalls = later.drawCalls - earlier.drawCalls;
+	difference.triangles = later.triangles - earlier.triangles;
+	difference.textureBinds = later.textureBinds - earlier.textureBinds;
+	difference.programSwitches = later.programSwitches - earlier.programSwitches;
+	difference.uniformUploads = later.uniformUploads - earlier.uniformUploads;
+	difference.bufferBytes = later.bufferBytes - earlier.bufferBytes;
+	difference.stateChanges = later.stateChanges - earlier.stateChanges;
+	difference.redundantCalls = later.redundantCalls - earlier.redundantCalls;
+	return(difference);
+}
+
+/***********************************************************
+ *  ResetState()
+ *
+ *  This method is used for forgetting the state set through
+ *  the layer, so the next calls are not taken as redundant.
+ ***********************************************************/
+void GLTrace::ResetState()
+{
+	g_Program = g_UnknownBinding;
+	g_ActiveUnit = GL_TEXTURE0;
+	g_TextureBindings.clear();
+	g_Capabilities.clear();
+	g_FramebufferBindings.clear();
+	g_DepthMask = -1;
+	g_DepthFunc = 0;
+	g_VertexArray = g_UnknownBinding;
+}
+
+/***********************************************************
+ *  BeginCapture()
+ *
+ *  This method is used for opening a trace file that all
+ *  the following calls are written into.
+ ***********************************************************/
+bool GLTrace::BeginCapture(const std::string& filename)
+{
+	EndCapture();
+
+	g_pCaptureFile = fopen(filename.c_str(), "wb");
+	if (NULL == g_pCaptureFile)
+	{
+		std::cout << "Could not create the trace file: " << filename << std::endl;
+		return(false);
+	}
+
+	GL_TRACE_FILE_HEADER header;
+	header.magic = GL_TRACE_FILE_MAGIC;
+	header.version = GL_TRACE_FILE_VERSION;
+	fwrite(&header, sizeof(header), 1, g_pCaptureFile);
+
+	g_CaptureBuffer.clear();
+	g_CapturedNames.clear();
+	return(true);
+}
+
+/***********************************************************
+ *  EndCapture()
+ *
+ *  This method is used for writing out the calls still in
+ *  the buffer and closing the trace file.
+ ***********************************************************/
+void GLTrace::EndCapture()
+{
+	if (NULL == g_pCaptureFile)
+	{
+		return;
+	}
+	if (!g_CaptureBuffer.empty())
+	{
+		fwrite(g_CaptureBuffer.data(), 1, g_CaptureBuffer.size(), g_pCaptureFile);
+		g_CaptureBuffer.clear();
+	}
+	fclose(g_pCaptureFile);
+	g_pCaptureFile = NULL;
+}
+
+/***********************************************************
+ *  IsCapturing()
+ ***********************************************************/
+bool GLTrace::IsCapturing()
+{
+	return(NULL != g_pCaptureFile);
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for marking the end of a frame and
+ *  writing its calls out to the trace file.
+ ***********************************************************/
+void GLTrace::EndFrame()
+{
+	if (NULL == g_pCaptureFile)
+	{
+		return;
+	}
+	WriteCall(TRACE_FRAME);
+	fwrite(g_CaptureBuffer.data(), 1, g_CaptureBuffer.size(), g_pCaptureFile);
+	g_CaptureBuffer.clear();
+}
+
+/***********************************************************
+ *  BeginSection()
+ *
+ *  This method is used for marking the start of a named
+ *  section of the frame in the trace.
+ ***********************************************************/
+void GLTrace::BeginSection(int name)
+{
+	if (NULL != g_pCaptureFile)
+	{
+		CaptureName(name);
+		WriteCall(TRACE_SECTION_BEGIN);
+		Write((uint16_t)name);
+	}
+}
+
+/***********************************************************
+ *  EndSection()
+ *
+ *  This method is used for marking the end of a named
+ *  section of the frame in the trace.
+ ***********************************************************/
+void GLTrace::EndSection(int name)
+{
+	if (NULL != g_pCaptureFile)
+	{
+		CaptureName(name);
+		WriteCall(TRACE_SECTION_END);
+		Write((uint16_t)name);
+	}
+}
+
+/***********************************************************
+ *  RegisterName()
+ *
+ *  This method is used for getting the handle of a uniform
+ *  or section name, adding the name the first time.
+ ***********************************************************/
+int GLTrace::RegisterName(const char* name)
+{
+	NAME_TABLE& table = GetNameTable();
+	std::map<std::string, int, std::less<>>::const_iterator found = table.handles.find(name);
+	if (found != table.handles.end())
+	{
+		return(found->second);
+	}
+
+	int handle = (int)table.names.size();
+	table.names.push_back(name);
+	table.handles.insert(std::make_pair(table.names.back(), handle));
+	return(handle);
+}
+
+/***********************************************************
+ *  GetName()
+ ***********************************************************/
+const char* GLTrace::GetName(int handle)
+{
+	NAME_TABLE& table = GetNameTable();
+	if ((handle < 0) || (handle >= (int)table.names.size()))
+	{
+		return("");
+	}
+	return(table.names[handle].c_str());
+}
+
+/***********************************************************
+ *  UseProgram()
+ *
+ *  This method is used for binding the program of a shader.
+ ***********************************************************/
+void GLTrace::UseProgram(ShaderManager* pShader)
+{
+	CaptureProgram((GLuint)pShader->m_programID);
+	if (IsOpenGL())
+	{
+		pShader->use();
+	}
+}
+
+/***********************************************************
+ *  UseProgram()
+ *
+ *  This method is used for binding a program by its name.
+ ***********************************************************/
+void GLTrace::UseProgram(GLuint programID)
+{
+	CaptureProgram(programID);
+	if (IsOpenGL())
+	{
+		glUseProgram(programID);
+	}
+}
+
+/***********************************************************
+ *  ForgetProgram()
+ *
+ *  This method is used for dropping the cached uniform
+ *  locations of a program that was deleted, so a program
+ *  later created under the same name looks them up again.
+ ***********************************************************/
+void GLTrace::ForgetProgram(GLuint programID)
+{
+	g_UniformLocations.erase(programID);
+	if (g_Program == programID)
+	{
+		g_Program = g_UnknownBinding;
+	}
+}
+
+/***********************************************************
+ *  SetBool()
+ *
+ *  This method is used for setting a bool uniform of the
+ *  bound program.  The other setters work the same way.
+ *  OpenGL is called directly with the cached location, the
+ *  shader's own setters would look the name up every time.
+ ***********************************************************/
+void GLTrace::SetBool(ShaderManager* pShader, int uniform, bool bValue)
+{
+	CaptureUniform(TRACE_UNIFORM_BOOL, uniform, (uint8_t)(bValue ? 1 : 0));
+	if (IsOpenGL())
+	{
+		GLint location = GetUniformLocation(pShader, uniform);
+		glUniform1i(location, bValue ? 1 : 0);
+	}
+}
+
+/***********************************************************
+ *  SetInt()
+ ***********************************************************/
+void GLTrace::SetInt(ShaderManager* pShader, int uniform, int value)
+{
+	CaptureUniform(TRACE_UNIFORM_INT, uniform, (int32_t)value);
+	if (IsOpenGL())
+	{
+		GLint location = GetUniformLocation(pShader, uniform);
+		glUniform1i(location, value);
+	}
+}
+
+/***********************************************************
+ *  SetSampler()
+ ***********************************************************/
+void GLTrace::SetSampler(ShaderManager* pShader, int uniform, int unit)
+{
+	CaptureUniform(TRACE_UNIFORM_SAMPLER, uniform, (int32_t)unit);
+	if (IsOpenGL())
+	{
+		GLint location = GetUniformLocation(pShader, uniform);
+		glUniform1i(location, unit);
+	}
+}
+
+/***********************************************************
+ *  SetFloat()
+ ***********************************************************/
+void GLTrace::SetFloat(ShaderManager* pShader, int uniform, float value)
+{
+	CaptureUniform(TRACE_UNIFORM_FLOAT, uniform, value);
+	if (IsOpenGL())
+	{
+		GLint location = GetUniformLocation(pShader, uniform);
+		glUniform1f(location, value);
+	}
+}
+
+/***********************************************************
+ *  SetVec2()
+ ***********************************************************/
+void GLTrace::SetVec2(ShaderManager* pShader, int uniform, const glm::vec2& value)
+{
+	CaptureUniform(TRACE_UNIFORM_VEC2, uniform, value);
+	if (IsOpenGL())
+	{
+		GLint location = GetUniformLocation(pShader, uniform);
+		glUniform2fv(location, 1, glm::value_ptr(value));
+	}
+}
+
+/***********************************************************
+ *  SetVec3()
+ ***********************************************************/
+void GLTrace::SetVec3(ShaderManager* pShader, int uniform, const glm::vec3& value)
+{
+	CaptureUniform(TRACE_UNIFORM_VEC3, uniform, value);
+	if (IsOpenGL())
+	{
+		GLint location = GetUniformLocation(pShader, uniform);
+		glUniform3fv(location, 1, glm::value_ptr(value));
+	}
+}
+
+/***********************************************************
+ *  SetVec4()
+ ***********************************************************/
+void GLTrace::SetVec4(ShaderManager* pShader, int uniform, const glm::vec4& value)
+{
+	CaptureUniform(TRACE_UNIFORM_VEC4, uniform, value);
+	if (IsOpenGL())
+	{
+		GLint location = GetUniformLocation(pShader, uniform);
+		glUniform4fv(location, 1, glm::value_ptr(value));
+	}
+}
+
+/***********************************************************
+ *  SetMat4()
+ ***********************************************************/
+void GLTrace::SetMat4(ShaderManager* pShader, int uniform, const glm::mat4& value)
+{
+	CaptureUniform(TRACE_UNIFORM_MAT4, uniform, value);
+	if (IsOpenGL())
+	{
+		GLint location = GetUniformLocation(pShader, uniform);
+		glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
+	}
+}
+
+/***********************************************************
+ *  ActiveTexture()
+ *
+ *  This method is used for selecting the texture unit the
+ *  following binds go to.
+ ***********************************************************/
+void GLTrace::ActiveTexture(GLenum unit)
+{
+	ChangeState(g_ActiveUnit, unit);
+	if (NULL != g_pCaptureFile)
+	{
+		WriteCall(TRACE_ACTIVE_TEXTURE);
+		Write((uint32_t)unit);
+	}
+	if (IsOpenGL())
+	{
+		glActiveTexture(unit);
+	}
+}
+
+/***********************************************************
+ *  BindTexture()
+ *
+ *  This method is used for binding a texture to the active
+ *  texture unit.
+ ***********************************************************/
+void GLTrace::BindTexture(GLenum target, GLuint textureID)
+{
+	g_Counters.textureBinds++;
+	uint64_t key = ((uint64_t)g_ActiveUnit << 32) | (uint64_t)target;
+	std::map<uint64_t, GLuint>::iterator found = g_TextureBindings.find(key);
+	if ((found != g_TextureBindings.end()) && (found->second == textureID))
+	{
+		g_Counters.redundantCalls++;
+	}
+	g_TextureBindings[key] = textureID;
+
+	if (NULL != g_pCaptureFile)
+	{
+		WriteCall(TRACE_BIND_TEXTURE);
+		Write((uint32_t)target);
+		Write((uint32_t)textureID);
+	}
+	if (IsOpenGL())
+	{
+		glBindTexture(target, textureID);
+	}
+}
+
+/***********************************************************
+ *  TexImage2D()
+ *
+ *  This method is used for sending a texture image level to
+ *  the bound texture.  The trace keeps the size of the image
+ *  but not its texels.
+ ***********************************************************/
+void GLTrace::TexImage2D(GLenum target, GLint level, GLint internalFormat,
+	GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pPixels, size_t byteCount)
+{
+	if (NULL != pPixels)
+	{
+		g_Counters.bufferBytes += byteCount;
+	}
+	if (NULL != g_pCaptureFile)
+	{
+		WriteCall(TRACE_TEX_IMAGE_2D);
+		Write((uint32_t)target);
+		Write((int32_t)level);
+		Write((int32_t)internalFormat);
+		Write((int32_t)width);
+		Write((int32_t)height);
+		Write((uint32_t)format);
+		Write((uint32_t)type);
+		Write((uint32_t)((NULL != pPixels) ? byteCount : 0));
+	}
+	if (IsOpenGL())
+	{
+		glTexImage2D(target, level, internalFormat, width, height, 0, format, type, pPixels);
+	}
+}
+
+/***********************************************************
+ *  Enable()
+ ***********************************************************/
+void GLTrace::Enable(GLenum capability)
+{
+	SetCapability(capability, true);
+	if (NULL != g_pCaptureFile)
+	{
+		WriteCall(TRACE_ENABLE);
+		Write((uint32_t)capability);
+	}
+	if (IsOpenGL())
+	{
+		glEnable(capability);
+	}
+}
+
+/***********************************************************
+ *  Disable()
+ ***********************************************************/
+void GLTrace::Disable(GLenum capability)
+{
+	SetCapability(capability, false);
+	if (NULL != g_pCaptureFile)
+	{
+		WriteCall(TRACE_DISABLE);
+		Write((uint32_t)capability);
+	}
+	if (IsOpenGL())
+	{
+		glDisable(capability);
+	}
+}
+
+/***********************************************************
+ *  DepthMask()
+ ***********************************************************/
+void GLTrace::DepthMask(GLboolean bWrite)
+{
+	ChangeState(g_DepthMask, (GLint)(bWrite ? 1 : 0));
+	if (NULL != g_pCaptureFile)
+	{
+		WriteCall(TRACE_DEPTH_MASK);
+		Write((uint8_t)(bWrite ? 1 : 0));
+	}
+	if (IsOpenGL())
+	{
+		glDepthMask(bWrite);
+	}
+}
+
+/***********************************************************
+ *  DepthFunc()
+ ***********************************************************/
+void GLTrace::DepthFunc(GLenum function)
+{
+	ChangeState(g_DepthFunc, function);
+	if (NULL != g_pCaptureFile)
+	{
+		WriteCall(TRACE_DEPTH_FUNC);
+		Write((uint32_t)function);
+	}
+	if (IsOpenGL())
+	{
+		glDepthFunc(function);
+	}
+}
+
+/***********************************************************
+ *  ColorMask()
+ ***********************************************************/
+void GLTrace::ColorMask(GLboolean bRed, GLboolean bGreen, GLboolean bBlue, GLboolean bAlpha)
+{
+	g_Counters.stateChanges++;
+	if (NULL != g_pCaptureFile)
+	{
+		WriteCall(TRACE_COLOR_MASK);
+		Write((uint8_t)((bRed ? 1 : 0) | (bGreen ? 2 : 0) | (bBlue ? 4 : 0) | (bAlpha ? 8 : 0)));
+	}
+	if (IsOpenGL())
+	{
+		glColorMask(bRed, bGreen, bBlue, bAlpha);
+	}
+}
+
+/***********************************************************
+ *  BlendFunc()
+ ***********************************************************/
+void GLTrace::BlendFunc(GLenum source, GLenum destination)
+{
+	g_Counters.stateChanges++;
+	if (NULL != g_pCaptureFile)
+	{
+		WriteCall(TRACE_BLEND_FUNC);
+		Write((uint32_t)source);
+		Write((uint32_t)destination);
+	}
+	if (IsOpenGL())
+	{
+		glBlendFunc(source, destination);
+	}
+}
+
+/***********************************************************
+ *  PolygonOffset()
+ ***********************************************************/
+void GLTrace::PolygonOffset(GLfloat factor, GLfloat units)
+{
+	g_Counters.stateChanges++;
+	if (NULL != g_pCaptureFile)
+	{
+		WriteCall(TRACE_POLYGON_OFFSET);
+		Write(factor);
+		Write(units);
+	}
+	if (IsOpenGL())
+	{
+		glPolygonOffset(factor, units);
+	}
+}
+
+/***********************************************************
+ *  Viewport()
+ ***********************************************************/
+void GLTrace::Viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+	g_Counters.stateChanges++;
+	if (NULL != g_pCaptureFile)
+	{
+		WriteCall(TRACE_VIEWPORT);
+		Write((int32_t)x);
+		Write((int32_t)y);
+		Write((int32_t)width);
+		Write((int32_t)height);
+	}
+	if (IsOpenGL())
+	{
+		glViewport(x, y, width, height);
+	}
+}
+
+/***********************************************************
+ *  ViewportIndexed()
+ ***********************************************************/
+void GLTrace::ViewportIndexed(GLuint index, GLfloat x, GLfloat y, GLfloat width, GLfloat height)
+{
+	g_Counters.stateChanges++;
+	if (NULL != g_pCaptureFile)
+	{
+		WriteCall(TRACE_VIEWPORT_INDEXED);
+		Write((uint32_t)index);
+		Write(x);
+		Write(y);
+		Write(width);
+		Write(height);
+	}
+	if (IsOpenGL())
+	{
+		glViewportIndexedf(index, x, y, width, height);
+	}
+}
+
+/***********************************************************
+ *  Scissor()
+ ***********************************************************/
+void GLTrace::Scissor(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+	g_Counters.stateChanges++;
+	if (NULL != g_pCaptureFile)
+	{
+		WriteCall(TRACE_SCISSOR);
+		Write((int32_t)x);
+		Write((int32_t)y);
+		Write((int32_t)width);
+		Write((int32_t)height);
+	}
+	if (IsOpenGL())
+	{
+		glScissor(x, y, width, height);
+	}
+}
+
+/***********************************************************
+ *  ClearColor()
+ ***********************************************************/
+void GLTrace::ClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha)
+{
+	g_Counters.stateChanges++;
+	if (NULL != g_pCaptureFile)
+	{
+		WriteCall(TRACE_CLEAR_COLOR);
+		Write(red);
+		Write(green);
+		Write(blue);
+		Write(alpha);
+	}
+	if (IsOpenGL())
+	{
+		glClearColor(red, green, blue, alpha);
+	}
+}
+
+/***********************************************************
+ *  Clear()
+ ***********************************************************/
+void GLTrace::Clear(GLbitfield mask)
+{
+	if (NULL != g_pCaptureFile)
+	{
+		WriteCall(TRACE_CLEAR);
+		Write((uint32_t)mask);
+	}
+	if (IsOpenGL())
+	{
+		glClear(mask);
+	}
+}
+
+/***********************************************************
+ *  BindFramebuffer()
+ ***********************************************************/
+void GLTrace::BindFramebuffer(GLenum target, GLuint framebufferID)
+{
+	g_Counters.stateChanges++;
+	// binding both targets replaces the two bindings
+	GLenum targets[2] = { target, target };
+	if (GL_FRAMEBUFFER == target)
+	{
+		targets[0] = GL_DRAW_FRAMEBUFFER;
+		targets[1] = GL_READ_FRAMEBUFFER;
+	}
+	bool bRedundant = true;
+	for (int i = 0; i < 2; i++)
+	{
+		std::map<GLenum, GLuint>::iterator found = g_FramebufferBindings.find(targets[i]);
+		if ((found == g_FramebufferBindings.end()) || (found->second != framebufferID))
+		{
+			bRedundant = false;
+		}
+		g_FramebufferBindings[targets[i]] = framebufferID;
+	}
+	if (bRedundant)
+	{
+		g_Counters.redundantCalls++;
+	}
+
+	if (NULL != g_pCaptureFile)
+	{
+		WriteCall(TRACE_BIND_FRAMEBUFFER);
+		Write((uint32_t)target);
+		Write((uint32_t)framebufferID);
+	}
+	if (IsOpenGL())
+	{
+		glBindFramebuffer(target, framebufferID);
+	}
+}
+
+/***********************************************************
+ *  FramebufferTextureLayer()
+ ***********************************************************/
+void GLTrace::FramebufferTextureLayer(GLenum target, GLenum attachment, GLuint textureID, GLint level, GLint layer)
+{
+	g_Counters.stateChanges++;
+	if (NULL != g_pCaptureFile)
+	{
+		WriteCall(TRACE_FRAMEBUFFER_LAYER);
+		Write((uint32_t)target);
+		Write((uint32_t)attachment);
+		Write((uint32_t)textureID);
+		Write((int32_t)level);
+		Write((int32_t)layer);
+	}
+	if (IsOpenGL())
+	{
+		glFramebufferTextureLayer(target, attachment, textureID, level, layer);
+	}
+}
+
+/***********************************************************
+ *  CopyImageSubData()
+ ***********************************************************/
+void GLTrace::CopyImageSubData(
+	GLuint sourceID, GLenum sourceTarget, GLint sourceLevel, GLint sourceX, GLint sourceY, GLint sourceZ,
+	GLuint targetID, GLenum targetTarget, GLint targetLevel, GLint targetX, GLint targetY, GLint targetZ,
+	GLsizei width, GLsizei height, GLsizei depth)
+{
+	if (NULL != g_pCaptureFile)
+	{
+		int32_t values[15] = {
+			(int32_t)sourceID, (int32_t)sourceTarget, sourceLevel, sourceX, sourceY, sourceZ,
+			(int32_t)targetID, (int32_t)targetTarget, targetLevel, targetX, targetY, targetZ,
+			width, height, depth };
+		WriteCall(TRACE_COPY_IMAGE);
+		Write(values);
+	}
+	if (IsOpenGL())
+	{
+		glCopyImageSubData(
+			sourceID, sourceTarget, sourceLevel, sourceX, sourceY, sourceZ,
+			targetID, targetTarget, targetLevel, targetX, targetY, targetZ,
+			width, height, depth);
+	}
+}
+
+/***********************************************************
+ *  BindBuffer()
+ ***********************************************************/
+void GLTrace::BindBuffer(GLenum target, GLuint bufferID)
+{
+	if (NULL != g_pCaptureFile)
+	{
+		WriteCall(TRACE_BIND_BUFFER);
+		Write((uint32_t)target);
+		Write((uint32_t)bufferID);
+	}
+	if (IsOpenGL())
+	{
+		glBindBuffer(target, bufferID);
+	}
+}
+
+/***********************************************************
+ *  BufferSubData()
+ *
+ *  This method is used for writing into the bound buffer.
+ *  The data is kept in the trace.
+ ***********************************************************/
+void GLTrace::BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* pData)
+{
+	g_Counters.bufferBytes += (uint64_t)size;
+	if (NULL != g_pCaptureFile)
+	{
+		WriteCall(TRACE_BUFFER_SUB_DATA);
+		Write((uint32_t)target);
+		Write((uint32_t)offset);
+		Write((uint32_t)size);
+		const uint8_t* pBytes = static_cast<const uint8_t*>(pData);
+		g_CaptureBuffer.insert(g_CaptureBuffer.end(), pBytes, pBytes + size);
+	}
+	if (IsOpenGL())
+	{
+		glBufferSubData(target, offset, size, pData);
+	}
+}
+
+/***********************************************************
+ *  BindVertexArray()
+ ***********************************************************/
+void GLTrace::BindVertexArray(GLuint vertexArrayID)
+{
+	ChangeState(g_VertexArray, vertexArrayID);
+	if (NULL != g_pCaptureFile)
+	{
+		WriteCall(TRACE_BIND_VERTEX_ARRAY);
+		Write((uint32_t)vertexArrayID);
+	}
+	if (IsOpenGL())
+	{
+		glBindVertexArray(vertexArrayID);
+	}
+}
+
+/***********************************************************
+ *  DrawArrays()
+ ***********************************************************/
+void GLTrace::DrawArrays(GLenum mode, GLint first, GLsizei count)
+{
+	g_Counters.drawCalls++;
+	if (GL_TRIANGLES == mode)
+	{
+		g_Counters.triangles += (uint64_t)(count / 3);
+	}
+	if (NULL != g_pCaptureFile)
+	{
+		WriteCall(TRACE_DRAW_ARRAYS);
+		Write((uint32_t)mode);
+		Write((int32_t)first);
+		Write((int32_t)count);
+	}
+	if (IsOpenGL())
+	{
+		glDrawArrays(mode, first, count);
+	}
+}
+
+/***********************************************************
+ *  DrawElements()
+ ***********************************************************/
+void GLTrace::DrawElements(GLenum mode, GLsizei count, GLenum type, GLintptr offset)
+{
+	g_Counters.drawCalls++;
+	if (GL_TRIANGLES == mode)
+	{
+		g_Counters.triangles += (uint64_t)(count / 3);
+	}
+	if (NULL != g_pCaptureFile)
+	{
+		WriteCall(TRACE_DRAW_ELEMENTS);
+		Write((uint32_t)mode);
+		Write((int32_t)count);
+		Write((uint32_t)type);
+		Write((uint32_t)offset);
+	}
+	if (IsOpenGL())
+	{
+		glDrawElements(mode, count, type, (const void*)offset);
+	}
+}
+
+/***********************************************************
+ *  MultiDrawArraysIndirect()
+ *
+ *  This method is used for issuing several instanced draws
+ *  with one call.  The commands are written to the start of
+ *  the bound indirect buffer first, so the draws can be
+ *  counted and recorded from the copy the caller keeps.
+ ***********************************************************/
+void GLTrace::MultiDrawArraysIndirect(GLenum mode, const DRAW_ARRAYS_INDIRECT* pCommands, GLsizei drawCount)
+{
+	if (drawCount <= 0)
+	{
+		return;
+	}
+
+	g_Counters.drawCalls++;
+	g_Counters.bufferBytes += (uint64_t)drawCount * sizeof(DRAW_ARRAYS_INDIRECT);
+	if (GL_TRIANGLES == mode)
+	{
+		for (GLsizei i = 0; i < drawCount; i++)
+		{
+			g_Counters.triangles += (uint64_t)(pCommands[i].count / 3) * pCommands[i].instanceCount;
+		}
+	}
+	if (NULL != g_pCaptureFile)
+	{
+		WriteCall(TRACE_MULTI_DRAW_ARRAYS_INDIRECT);
+		Write((uint32_t)mode);
+		Write((int32_t)drawCount);
+		const uint8_t* pBytes = reinterpret_cast<const uint8_t*>(pCommands);
+		g_CaptureBuffer.insert(g_CaptureBuffer.end(), pBytes, pBytes + drawCount * sizeof(DRAW_ARRAYS_INDIRECT));
+	}
+	if (IsOpenGL())
+	{
+		glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, drawCount * sizeof(DRAW_ARRAYS_INDIRECT), pCommands);
+		glMultiDrawArraysIndirect(mode, (const void*)0, drawCount, 0);
+	}
+}
+
+/***********************************************************
+ *  DrawMesh()
+ *
+ *  This method is used for drawing one of the loaded basic
+ *  shape meshes with the bound program.  The meshes bind
+ *  their own vertex arrays, so the tracked binding is lost.
+ ***********************************************************/
+void GLTrace::DrawMesh(ShapeMeshes* pMeshes, MESH_TYPE mesh)
+{
+	if ((mesh < 0) || (mesh >= MESH_TYPE_COUNT))
+	{
+		return;
+	}
+
+	g_Counters.drawCalls++;
+	g_Counters.triangles += g_MeshTriangles[mesh];
+	g_VertexArray = g_UnknownBinding;
+	if (NULL != g_pCaptureFile)
+	{
+		WriteCall(TRACE_DRAW_MESH);
+		Write((uint8_t)mesh);
+	}
+	if (!IsOpenGL() || (NULL == pMeshes))
+	{
+		return;
+	}
+
+	switch (mesh)
+	{
+	case MESH_PLANE:
+		pMeshes->DrawPlaneMesh();
+		break;
+	case MESH_BOX:
+		pMeshes->DrawBoxMesh();
+		break;
+	case MESH_CYLINDER:
+		pMeshes->DrawCylinderMesh();
+		break;
+	default:
+		break;
+	}
+}
+
+/***********************************************************
+ *  GetMeshTriangles()
+ ***********************************************************/
+uint32_t GLTrace::GetMeshTriangles(MESH_TYPE mesh)
+{
+	if ((mesh < 0) || (mesh >= MESH_TYPE_COUNT))
+	{
+		return(0);
+	}
+	return(g_MeshTriangles[mesh]);
+}
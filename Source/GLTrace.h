@@ -0,0 +1,224 @@
+///////////////////////////////////////////////////////////////////////////////
+// gltrace.h
+// ============
+// count and record the OpenGL calls of the render path
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+#include "ShapeMeshes.h"
+#include "RenderQueue.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+
+// a trace file is the header followed by the calls, each one
+// byte of TRACE_CALL and its arguments packed little endian.
+// Uniform and section names are sent once as TRACE_NAME and
+// then referred to by their 16 bit name handle.  Texture images are
+// recorded with their size only, so traces stay small.
+#define GL_TRACE_FILE_MAGIC 0x52544C47u   // "GLTR"
+#define GL_TRACE_FILE_VERSION 1u
+
+struct GL_TRACE_FILE_HEADER
+{
+	uint32_t magic;
+	uint32_t version;
+};
+
+static_assert(sizeof(GL_TRACE_FILE_HEADER) == 8, "trace header must be packed");
+
+// one draw of MultiDrawArraysIndirect(), laid out like the
+// command OpenGL reads from the indirect buffer
+struct DRAW_ARRAYS_INDIRECT
+{
+	uint32_t count;
+	uint32_t instanceCount;
+	uint32_t first;
+	uint32_t baseInstance;
+};
+
+static_assert(sizeof(DRAW_ARRAYS_INDIRECT) == 16, "indirect draw must be packed");
+
+enum TRACE_CALL
+{
+	TRACE_FRAME = 0,
+	TRACE_NAME,
+	TRACE_SECTION_BEGIN,
+	TRACE_SECTION_END,
+	TRACE_USE_PROGRAM,
+	TRACE_UNIFORM_BOOL,
+	TRACE_UNIFORM_INT,
+	TRACE_UNIFORM_SAMPLER,
+	TRACE_UNIFORM_FLOAT,
+	TRACE_UNIFORM_VEC2,
+	TRACE_UNIFORM_VEC3,
+	TRACE_UNIFORM_VEC4,
+	TRACE_UNIFORM_MAT4,
+	TRACE_ACTIVE_TEXTURE,
+	TRACE_BIND_TEXTURE,
+	TRACE_ENABLE,
+	TRACE_DISABLE,
+	TRACE_DEPTH_MASK,
+	TRACE_DEPTH_FUNC,
+	TRACE_COLOR_MASK,
+	TRACE_BLEND_FUNC,
+	TRACE_POLYGON_OFFSET,
+	TRACE_VIEWPORT,
+	TRACE_VIEWPORT_INDEXED,
+	TRACE_SCISSOR,
+	TRACE_CLEAR_COLOR,
+	TRACE_CLEAR,
+	TRACE_BIND_FRAMEBUFFER,
+	TRACE_FRAMEBUFFER_LAYER,
+	TRACE_COPY_IMAGE,
+	TRACE_BIND_BUFFER,
+	TRACE_BUFFER_SUB_DATA,
+	TRACE_TEX_IMAGE_2D,
+	TRACE_BIND_VERTEX_ARRAY,
+	TRACE_DRAW_ARRAYS,
+	TRACE_DRAW_MESH,
+	TRACE_DRAW_ELEMENTS,
+	TRACE_MULTI_DRAW_ARRAYS_INDIRECT,
+	TRACE_CALL_COUNT
+};
+
+// what the render path asked of OpenGL
+struct GL_COUNTERS
+{
+	uint64_t drawCalls;
+	uint64_t triangles;
+	uint64_t textureBinds;
+	uint64_t programSwitches;
+	uint64_t uniformUploads;
+	// buffer and texture image bytes sent to the GPU
+	uint64_t bufferBytes;
+	// enables, masks, viewports and framebuffer binds
+	uint64_t stateChanges;
+	// binds and state changes to what was already set
+	uint64_t redundantCalls;
+};
+
+/***********************************************************
+ *  GLTrace
+ *
+ *  This class is the layer the render path makes its OpenGL
+ *  calls through, including the shader uniform setters and
+ *  the basic mesh draws.  Every call is counted, so the cost
+ *  of a frame or a section can be read as the difference of
+ *  two counter snapshots, and redundant binds and state
+ *  changes are counted separately.  While a capture is open
+ *  every call is also written to a trace file.  On the null
+ *  backend the calls are counted and recorded but never
+ *  reach OpenGL, which lets a trace be replayed on the CPU
+ *  alone.  Creating and deleting objects and reading back
+ *  results go to OpenGL directly.
+ ***********************************************************/
+class GLTrace
+{
+public:
+	enum TRACE_BACKEND
+	{
+		TRACE_BACKEND_OPENGL = 0,
+		TRACE_BACKEND_NULL
+	};
+
+	// where the calls go, OpenGL unless set
+	static void SetBackend(TRACE_BACKEND backend);
+	static TRACE_BACKEND GetBackend();
+
+	// totals since the start
+	static const GL_COUNTERS& GetCounters();
+	// counters of the calls made between two snapshots
+	static GL_COUNTERS Difference(const GL_COUNTERS& later, const GL_COUNTERS& earlier);
+	// forget the bound state, for after OpenGL was called
+	// around the layer
+	static void ResetState();
+
+	// write all the following calls into the file
+	static bool BeginCapture(const std::string& filename);
+	static void EndCapture();
+	static bool IsCapturing();
+	// mark the end of a frame and of a named section
+	static void EndFrame();
+	static void BeginSection(int name);
+	static void EndSection(int name);
+
+	// handle of a uniform or section name, the same name
+	// always gets the same handle.  Handles are kept for the
+	// whole run, so the draw path never builds name strings
+	static int RegisterName(const char* name);
+	static const char* GetName(int handle);
+
+	// programs and uniforms, set on the bound program.  The
+	// locations are looked up once per program and name
+	static void UseProgram(ShaderManager* pShader);
+	static void UseProgram(GLuint programID);
+	// drop the cached locations of a deleted program
+	static void ForgetProgram(GLuint programID);
+	static void SetBool(ShaderManager* pShader, int uniform, bool bValue);
+	static void SetInt(ShaderManager* pShader, int uniform, int value);
+	static void SetSampler(ShaderManager* pShader, int uniform, int unit);
+	static void SetFloat(ShaderManager* pShader, int uniform, float value);
+	static void SetVec2(ShaderManager* pShader, int uniform, const glm::vec2& value);
+	static void SetVec3(ShaderManager* pShader, int uniform, const glm::vec3& value);
+	static void SetVec4(ShaderManager* pShader, int uniform, const glm::vec4& value);
+	static void SetMat4(ShaderManager* pShader, int uniform, const glm::mat4& value);
+	// the same by name, for code that runs once
+	static void SetBool(ShaderManager* pShader, const char* name, bool bValue) { SetBool(pShader, RegisterName(name), bValue); }
+	static void SetInt(ShaderManager* pShader, const char* name, int value) { SetInt(pShader, RegisterName(name), value); }
+	static void SetSampler(ShaderManager* pShader, const char* name, int unit) { SetSampler(pShader, RegisterName(name), unit); }
+	static void SetFloat(ShaderManager* pShader, const char* name, float value) { SetFloat(pShader, RegisterName(name), value); }
+	static void SetVec2(ShaderManager* pShader, const char* name, const glm::vec2& value) { SetVec2(pShader, RegisterName(name), value); }
+	static void SetVec3(ShaderManager* pShader, const char* name, const glm::vec3& value) { SetVec3(pShader, RegisterName(name), value); }
+	static void SetVec4(ShaderManager* pShader, const char* name, const glm::vec4& value) { SetVec4(pShader, RegisterName(name), value); }
+	static void SetMat4(ShaderManager* pShader, const char* name, const glm::mat4& value) { SetMat4(pShader, RegisterName(name), value); }
+
+	// textures
+	static void ActiveTexture(GLenum unit);
+	static void BindTexture(GLenum target, GLuint textureID);
+	static void TexImage2D(GLenum target, GLint level, GLint internalFormat,
+		GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pPixels, size_t byteCount);
+
+	// fixed function state
+	static void Enable(GLenum capability);
+	static void Disable(GLenum capability);
+	static void DepthMask(GLboolean bWrite);
+	static void DepthFunc(GLenum function);
+	static void ColorMask(GLboolean bRed, GLboolean bGreen, GLboolean bBlue, GLboolean bAlpha);
+	static void BlendFunc(GLenum source, GLenum destination);
+	static void PolygonOffset(GLfloat factor, GLfloat units);
+	static void Viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+	static void ViewportIndexed(GLuint index, GLfloat x, GLfloat y, GLfloat width, GLfloat height);
+	static void Scissor(GLint x, GLint y, GLsizei width, GLsizei height);
+	static void ClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha);
+	static void Clear(GLbitfield mask);
+
+	// framebuffers and buffers
+	static void BindFramebuffer(GLenum target, GLuint framebufferID);
+	static void FramebufferTextureLayer(GLenum target, GLenum attachment, GLuint textureID, GLint level, GLint layer);
+	static void CopyImageSubData(
+		GLuint sourceID, GLenum sourceTarget, GLint sourceLevel, GLint sourceX, GLint sourceY, GLint sourceZ,
+		GLuint targetID, GLenum targetTarget, GLint targetLevel, GLint targetX, GLint targetY, GLint targetZ,
+		GLsizei width, GLsizei height, GLsizei depth);
+	static void BindBuffer(GLenum target, GLuint bufferID);
+	static void BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* pData);
+
+	// draws
+	static void BindVertexArray(GLuint vertexArrayID);
+	static void DrawArrays(GLenum mode, GLint first, GLsizei count);
+	// the offset is into the bound index buffer
+	static void DrawElements(GLenum mode, GLsizei count, GLenum type, GLintptr offset);
+	// draw one of the basic shape meshes
+	static void DrawMesh(ShapeMeshes* pMeshes, MESH_TYPE mesh);
+	// write the draws into the bound indirect buffer and issue
+	// them with one call, the commands are kept in the trace
+	static void MultiDrawArraysIndirect(GLenum mode, const DRAW_ARRAYS_INDIRECT* pCommands, GLsizei drawCount);
+
+	// triangles in a basic shape mesh
+	static uint32_t GetMeshTriangles(MESH_TYPE mesh);
+};
@@ -0,0 +1,608 @@
+///////////////////////////////////////////////////////////////////////////////
+// gltracereplay.cpp
+// ============
+// replay the OpenGL call traces written by GLTrace
+///////////////////////////////////////////////////////////////////////////////
+
+#include "GLTraceReplay.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+
+	/***********************************************************
+	 *  Read()
+	 *
+	 *  This function is used for reading a value of a call and
+	 *  moving past it.  Returns false at the end of the data.
+	 ***********************************************************/
+	template <typename T>
+	bool Read(const uint8_t*& pRead, const uint8_t* pEnd, T& value)
+	{
+		if ((size_t)(pEnd - pRead) < sizeof(T))
+		{
+			return(false);
+		}
+		memcpy(&value, pRead, sizeof(T));
+		pRead += sizeof(T);
+		return(true);
+	}
+}
+
+/***********************************************************
+ *  GLTraceReplay()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+GLTraceReplay::GLTraceReplay()
+{
+	m_endOffset = 0;
+	m_pCurrentShader = NULL;
+}
+
+/***********************************************************
+ *  ~GLTraceReplay()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+GLTraceReplay::~GLTraceReplay()
+{
+	Close();
+}
+
+/***********************************************************
+ *  Open()
+ *
+ *  This method is used for mapping a trace file, checking
+ *  its header and finding where each frame starts.  Calls
+ *  after the last frame marker belong to a frame that was
+ *  not finished and are left out.
+ ***********************************************************/
+bool GLTraceReplay::Open(const std::string& filename)
+{
+	Close();
+
+	if (!m_file.Open(filename))
+	{
+		std::cout << "Could not open the trace file: " << filename << std::endl;
+		return(false);
+	}
+
+	GL_TRACE_FILE_HEADER header = {};
+	if (m_file.GetSize() >= sizeof(header))
+	{
+		memcpy(&header, m_file.GetData(), sizeof(header));
+	}
+	if (header.magic != GL_TRACE_FILE_MAGIC)
+	{
+		std::cout << "Not a trace file: " << filename << std::endl;
+		Close();
+		return(false);
+	}
+	if (header.version != GL_TRACE_FILE_VERSION)
+	{
+		std::cout << "Trace file version " << header.version << " is not supported: " << filename << std::endl;
+		Close();
+		return(false);
+	}
+
+	const uint8_t* pStart = m_file.GetData();
+	const uint8_t* pEnd = pStart + m_file.GetSize();
+	const uint8_t* pRead = pStart + sizeof(header);
+	size_t frameStart = sizeof(header);
+	while (pRead < pEnd)
+	{
+		bool bFrameEnd = (TRACE_FRAME == *pRead);
+		if (!ReplayCall(pRead, pEnd, false, NULL))
+		{
+			std::cout << "Trace file is damaged after frame " << m_frameOffsets.size() << ": " << filename << std::endl;
+			break;
+		}
+		if (bFrameEnd)
+		{
+			m_frameOffsets.push_back(frameStart);
+			frameStart = (size_t)(pRead - pStart);
+			m_endOffset = frameStart;
+		}
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  Close()
+ *
+ *  This method is used for unmapping the trace and freeing
+ *  the program stand-ins.
+ ***********************************************************/
+void GLTraceReplay::Close()
+{
+	std::map<GLuint, ShaderManager*>::iterator shader;
+	for (shader = m_shaders.begin(); shader != m_shaders.end(); ++shader)
+	{
+		// the program belongs to whoever created it
+		shader->second->m_programID = 0;
+		delete shader->second;
+	}
+	m_shaders.clear();
+	m_pCurrentShader = NULL;
+
+	m_frameOffsets.clear();
+	m_endOffset = 0;
+	m_names.clear();
+	m_file.Close();
+}
+
+/***********************************************************
+ *  ReplayFrame()
+ *
+ *  This method is used for making the calls of a frame
+ *  through the GLTrace layer, so they are counted and go to
+ *  its backend.
+ ***********************************************************/
+bool GLTraceReplay::ReplayFrame(int frame, ShapeMeshes* pMeshes)
+{
+	if ((frame < 0) || (frame >= (int)m_frameOffsets.size()))
+	{
+		return(false);
+	}
+
+	size_t endOffset = ((size_t)frame + 1 < m_frameOffsets.size()) ? m_frameOffsets[frame + 1] : m_endOffset;
+	const uint8_t* pRead = m_file.GetData() + m_frameOffsets[frame];
+	const uint8_t* pEnd = m_file.GetData() + endOffset;
+	while (pRead < pEnd)
+	{
+		if (!ReplayCall(pRead, pEnd, true, pMeshes))
+		{
+			return(false);
+		}
+	}
+	return(true);
+}
+
+/***********************************************************
+ *  Benchmark()
+ *
+ *  This method is used for measuring the CPU cost of the
+ *  render path's OpenGL calls.  The frames of the trace are
+ *  replayed on the null backend, so no OpenGL context is
+ *  needed and the time is only the layer itself.
+ ***********************************************************/
+bool GLTraceReplay::Benchmark(const std::string& filename, int loops)
+{
+	GLTraceReplay replay;
+	if (!replay.Open(filename))
+	{
+		return(false);
+	}
+	int frameCount = replay.GetFrameCount();
+	if (frameCount == 0)
+	{
+		std::cout << "Trace file has no frames: " << filename << std::endl;
+		return(false);
+	}
+	loops = std::max(loops, 1);
+
+	GLTrace::TRACE_BACKEND previousBackend = GLTrace::GetBackend();
+	GLTrace::SetBackend(GLTrace::TRACE_BACKEND_NULL);
+	GL_COUNTERS start = GLTrace::GetCounters();
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+	for (int loop = 0; loop < loops; loop++)
+	{
+		for (int frame = 0; frame < frameCount; frame++)
+		{
+			replay.ReplayFrame(frame, NULL);
+		}
+	}
+
+	double totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+	GL_COUNTERS total = GLTrace::Difference(GLTrace::GetCounters(), start);
+	GLTrace::SetBackend(previousBackend);
+
+	double frames = (double)frameCount * (double)loops;
+	std::cout << std::fixed << std::setprecision(3)
+		<< "REPLAY: " << frameCount << " frames x " << loops << " loops, "
+		<< totalMs / frames << " ms per frame" << std::setprecision(1)
+		<< " | per frame draws " << (double)total.drawCalls / frames
+		<< " tris " << (double)total.triangles / frames
+		<< " textures " << (double)total.textureBinds / frames
+		<< " programs " << (double)total.programSwitches / frames
+		<< " uniforms " << (double)total.uniformUploads / frames
+		<< " bytes " << (double)total.bufferBytes / frames
+		<< " state " << (double)total.stateChanges / frames
+		<< " redundant " << (double)total.redundantCalls / frames
+		<< std::defaultfloat << std::endl;
+	return(true);
+}
+
+/***********************************************************
+ *  GetShader()
+ *
+ *  This method is used for getting the stand-in for a
+ *  traced program, creating it the first time.
+ ***********************************************************/
+ShaderManager* GLTraceReplay::GetShader(GLuint programID)
+{
+	std::map<GLuint, ShaderManager*>::iterator found = m_shaders.find(programID);
+	if (found != m_shaders.end())
+	{
+		return(found->second);
+	}
+
+	ShaderManager* pShader = new ShaderManager();
+	pShader->m_programID = programID;
+	m_shaders[programID] = pShader;
+	return(pShader);
+}
+
+/***********************************************************
+ *  GetName()
+ ***********************************************************/
+int GLTraceReplay::GetName(uint16_t index) const
+{
+	if (index >= m_names.size())
+	{
+		return(GLTrace::RegisterName(""));
+	}
+	return(m_names[index]);
+}
+
+/***********************************************************
+ *  ReplayCall()
+ *
+ *  This method is used for reading one call of the trace.
+ *  When bExecute is set the call is made, otherwise only
+ *  the names are kept.  Returns false when the call is cut
+ *  off or unknown.
+ ***********************************************************/
+bool GLTraceReplay::ReplayCall(const uint8_t*& pRead, const uint8_t* pEnd, bool bExecute, ShapeMeshes* pMeshes)
+{
+	uint8_t call = 0;
+	if (!Read(pRead, pEnd, call))
+	{
+		return(false);
+	}
+
+	// uniform calls start with the name index
+	uint16_t nameIndex = 0;
+	if ((call >= TRACE_UNIFORM_BOOL) && (call <= TRACE_UNIFORM_MAT4))
+	{
+		if (!Read(pRead, pEnd, nameIndex))
+		{
+			return(false);
+		}
+		if (bExecute && (NULL == m_pCurrentShader))
+		{
+			m_pCurrentShader = GetShader(0);
+		}
+	}
+
+	switch (call)
+	{
+	case TRACE_FRAME:
+		return(true);
+	case TRACE_NAME:
+	{
+		uint16_t index = 0;
+		uint16_t length = 0;
+		if (!Read(pRead, pEnd, index) || !Read(pRead, pEnd, length) ||
+			((size_t)(pEnd - pRead) < length))
+		{
+			return(false);
+		}
+		if (!bExecute)
+		{
+			if (index >= m_names.size())
+			{
+				m_names.resize(index + 1, GLTrace::RegisterName(""));
+			}
+			// traced names are mapped to this run's handles
+			m_names[index] = GLTrace::RegisterName(std::string((const char*)pRead, length).c_str());
+		}
+		pRead += length;
+		return(true);
+	}
+	case TRACE_SECTION_BEGIN:
+	case TRACE_SECTION_END:
+	{
+		uint16_t index = 0;
+		if (!Read(pRead, pEnd, index))
+		{
+			return(false);
+		}
+		if (bExecute && (TRACE_SECTION_BEGIN == call))
+			GLTrace::BeginSection(GetName(index));
+		else if (bExecute)
+			GLTrace::EndSection(GetName(index));
+		return(true);
+	}
+	case TRACE_USE_PROGRAM:
+	{
+		uint32_t programID = 0;
+		if (!Read(pRead, pEnd, programID))
+		{
+			return(false);
+		}
+		if (bExecute)
+		{
+			m_pCurrentShader = GetShader(programID);
+			GLTrace::UseProgram(m_pCurrentShader);
+		}
+		return(true);
+	}
+	case TRACE_UNIFORM_BOOL:
+	{
+		uint8_t value = 0;
+		if (!Read(pRead, pEnd, value))
+			return(false);
+		if (bExecute)
+			GLTrace::SetBool(m_pCurrentShader, GetName(nameIndex), value != 0);
+		return(true);
+	}
+	case TRACE_UNIFORM_INT:
+	case TRACE_UNIFORM_SAMPLER:
+	{
+		int32_t value = 0;
+		if (!Read(pRead, pEnd, value))
+			return(false);
+		if (bExecute && (TRACE_UNIFORM_INT == call))
+			GLTrace::SetInt(m_pCurrentShader, GetName(nameIndex), value);
+		else if (bExecute)
+			GLTrace::SetSampler(m_pCurrentShader, GetName(nameIndex), value);
+		return(true);
+	}
+	case TRACE_UNIFORM_FLOAT:
+	{
+		float value = 0.0f;
+		if (!Read(pRead, pEnd, value))
+			return(false);
+		if (bExecute)
+			GLTrace::SetFloat(m_pCurrentShader, GetName(nameIndex), value);
+		return(true);
+	}
+	case TRACE_UNIFORM_VEC2:
+	{
+		glm::vec2 value;
+		if (!Read(pRead, pEnd, value))
+			return(false);
+		if (bExecute)
+			GLTrace::SetVec2(m_pCurrentShader, GetName(nameIndex), value);
+		return(true);
+	}
+	case TRACE_UNIFORM_VEC3:
+	{
+		glm::vec3 value;
+		if (!Read(pRead, pEnd, value))
+			return(false);
+		if (bExecute)
+			GLTrace::SetVec3(m_pCurrentShader, GetName(nameIndex), value);
+		return(true);
+	}
+	case TRACE_UNIFORM_VEC4:
+	{
+		glm::vec4 value;
+		if (!Read(pRead, pEnd, value))
+			return(false);
+		if (bExecute)
+			GLTrace::SetVec4(m_pCurrentShader, GetName(nameIndex), value);
+		return(true);
+	}
+	case TRACE_UNIFORM_MAT4:
+	{
+		glm::mat4 value;
+		if (!Read(pRead, pEnd, value))
+			return(false);
+		if (bExecute)
+			GLTrace::SetMat4(m_pCurrentShader, GetName(nameIndex), value);
+		return(true);
+	}
+	case TRACE_ACTIVE_TEXTURE:
+	case TRACE_ENABLE:
+	case TRACE_DISABLE:
+	case TRACE_DEPTH_FUNC:
+	case TRACE_CLEAR:
+	case TRACE_BIND_VERTEX_ARRAY:
+	{
+		uint32_t value = 0;
+		if (!Read(pRead, pEnd, value))
+			return(false);
+		if (!bExecute)
+			return(true);
+		switch (call)
+		{
+		case TRACE_ACTIVE_TEXTURE:
+			GLTrace::ActiveTexture(value);
+			break;
+		case TRACE_ENABLE:
+			GLTrace::Enable(value);
+			break;
+		case TRACE_DISABLE:
+			GLTrace::Disable(value);
+			break;
+		case TRACE_DEPTH_FUNC:
+			GLTrace::DepthFunc(value);
+			break;
+		case TRACE_CLEAR:
+			GLTrace::Clear(value);
+			break;
+		default:
+			GLTrace::BindVertexArray(value);
+			break;
+		}
+		return(true);
+	}
+	case TRACE_BIND_TEXTURE:
+	case TRACE_BLEND_FUNC:
+	case TRACE_BIND_FRAMEBUFFER:
+	case TRACE_BIND_BUFFER:
+	{
+		uint32_t values[2];
+		if (!Read(pRead, pEnd, values))
+			return(false);
+		if (!bExecute)
+			return(true);
+		switch (call)
+		{
+		case TRACE_BIND_TEXTURE:
+			GLTrace::BindTexture(values[0], values[1]);
+			break;
+		case TRACE_BLEND_FUNC:
+			GLTrace::BlendFunc(values[0], values[1]);
+			break;
+		case TRACE_BIND_FRAMEBUFFER:
+			GLTrace::BindFramebuffer(values[0], values[1]);
+			break;
+		default:
+			GLTrace::BindBuffer(values[0], values[1]);
+			break;
+		}
+		return(true);
+	}
+	case TRACE_DEPTH_MASK:
+	case TRACE_COLOR_MASK:
+	{
+		uint8_t value = 0;
+		if (!Read(pRead, pEnd, value))
+			return(false);
+		if (bExecute && (TRACE_DEPTH_MASK == call))
+			GLTrace::DepthMask(value ? GL_TRUE : GL_FALSE);
+		else if (bExecute)
+			GLTrace::ColorMask(
+				(value & 1) ? GL_TRUE : GL_FALSE,
+				(value & 2) ? GL_TRUE : GL_FALSE,
+				(value & 4) ? GL_TRUE : GL_FALSE,
+				(value & 8) ? GL_TRUE : GL_FALSE);
+		return(true);
+	}
+	case TRACE_POLYGON_OFFSET:
+	{
+		float values[2];
+		if (!Read(pRead, pEnd, values))
+			return(false);
+		if (bExecute)
+			GLTrace::PolygonOffset(values[0], values[1]);
+		return(true);
+	}
+	case TRACE_VIEWPORT:
+	case TRACE_SCISSOR:
+	{
+		int32_t values[4];
+		if (!Read(pRead, pEnd, values))
+			return(false);
+		if (bExecute && (TRACE_VIEWPORT == call))
+			GLTrace::Viewport(values[0], values[1], values[2], values[3]);
+		else if (bExecute)
+			GLTrace::Scissor(values[0], values[1], values[2], values[3]);
+		return(true);
+	}
+	case TRACE_VIEWPORT_INDEXED:
+	{
+		uint32_t index = 0;
+		float values[4];
+		if (!Read(pRead, pEnd, index) || !Read(pRead, pEnd, values))
+			return(false);
+		if (bExecute)
+			GLTrace::ViewportIndexed(index, values[0], values[1], values[2], values[3]);
+		return(true);
+	}
+	case TRACE_CLEAR_COLOR:
+	{
+		float values[4];
+		if (!Read(pRead, pEnd, values))
+			return(false);
+		if (bExecute)
+			GLTrace::ClearColor(values[0], values[1], values[2], values[3]);
+		return(true);
+	}
+	case TRACE_FRAMEBUFFER_LAYER:
+	{
+		int32_t values[5];
+		if (!Read(pRead, pEnd, values))
+			return(false);
+		if (bExecute)
+			GLTrace::FramebufferTextureLayer(
+				(GLenum)values[0], (GLenum)values[1], (GLuint)values[2], values[3], values[4]);
+		return(true);
+	}
+	case TRACE_COPY_IMAGE:
+	{
+		int32_t values[15];
+		if (!Read(pRead, pEnd, values))
+			return(false);
+		if (bExecute)
+			GLTrace::CopyImageSubData(
+				(GLuint)values[0], (GLenum)values[1], values[2], values[3], values[4], values[5],
+				(GLuint)values[6], (GLenum)values[7], values[8], values[9], values[10], values[11],
+				values[12], values[13], values[14]);
+		return(true);
+	}
+	case TRACE_BUFFER_SUB_DATA:
+	{
+		uint32_t values[3];
+		if (!Read(pRead, pEnd, values) || ((size_t)(pEnd - pRead) < values[2]))
+			return(false);
+		if (bExecute)
+			GLTrace::BufferSubData(values[0], values[1], values[2], pRead);
+		pRead += values[2];
+		return(true);
+	}
+	case TRACE_TEX_IMAGE_2D:
+	{
+		// the texels are not in the trace
+		int32_t values[8];
+		return(Read(pRead, pEnd, values));
+	}
+	case TRACE_DRAW_ARRAYS:
+	{
+		int32_t values[3];
+		if (!Read(pRead, pEnd, values))
+			return(false);
+		if (bExecute)
+			GLTrace::DrawArrays((GLenum)values[0], values[1], values[2]);
+		return(true);
+	}
+	case TRACE_DRAW_MESH:
+	{
+		uint8_t mesh = 0;
+		if (!Read(pRead, pEnd, mesh))
+			return(false);
+		if (bExecute)
+			GLTrace::DrawMesh(pMeshes, (MESH_TYPE)mesh);
+		return(true);
+	}
+	case TRACE_DRAW_ELEMENTS:
+	{
+		uint32_t values[4];
+		if (!Read(pRead, pEnd, values))
+			return(false);
+		if (bExecute)
+			GLTrace::DrawElements((GLenum)values[0], (GLsizei)values[1], (GLenum)values[2], (GLintptr)values[3]);
+		return(true);
+	}
+	case TRACE_MULTI_DRAW_ARRAYS_INDIRECT:
+	{
+		int32_t values[2];
+		if (!Read(pRead, pEnd, values) || (values[1] < 0) ||
+			((size_t)(pEnd - pRead) < (size_t)values[1] * sizeof(DRAW_ARRAYS_INDIRECT)))
+			return(false);
+		if (bExecute)
+		{
+			// the commands in the trace may not be aligned
+			std::vector<DRAW_ARRAYS_INDIRECT> commands(values[1]);
+			memcpy(commands.data(), pRead, values[1] * sizeof(DRAW_ARRAYS_INDIRECT));
+			GLTrace::MultiDrawArraysIndirect((GLenum)values[0], commands.data(), values[1]);
+		}
+		pRead += values[1] * sizeof(DRAW_ARRAYS_INDIRECT);
+		return(true);
+	}
+	default:
+		return(false);
+	}
+}
@@ -0,0 +1,66 @@
+///////////////////////////////////////////////////////////////////////////////
+// gltracereplay.h
+// ============
+// replay the OpenGL call traces written by GLTrace
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "GLTrace.h"
+#include "MappedFile.h"
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  GLTraceReplay
+ *
+ *  This class plays the calls of a trace file back through
+ *  the GLTrace layer, one frame at a time.  The frames and
+ *  the names are indexed when the file is opened, so any
+ *  frame can be replayed on its own.  On the OpenGL backend
+ *  the objects the calls name must exist, as they do in the
+ *  application that wrote the trace.  Texture images are not
+ *  in the trace, so their uploads are skipped.
+ ***********************************************************/
+class GLTraceReplay
+{
+public:
+	// constructor
+	GLTraceReplay();
+	// destructor
+	~GLTraceReplay();
+
+	// map the trace and index its frames
+	bool Open(const std::string& filename);
+	void Close();
+
+	int GetFrameCount() const { return (int)m_frameOffsets.size(); }
+
+	// make the calls of one frame, the meshes are only drawn
+	// on the OpenGL backend
+	bool ReplayFrame(int frame, ShapeMeshes* pMeshes);
+
+	// replay all the frames on the null backend and print the
+	// CPU time and the counts per frame
+	static bool Benchmark(const std::string& filename, int loops);
+
+private:
+	MappedFile m_file;
+	// start of each frame, the end is the start of the next
+	std::vector<size_t> m_frameOffsets;
+	size_t m_endOffset;
+	// handles of the traced names, by trace name index
+	std::vector<int> m_names;
+	// stand-ins for the traced programs, so the uniforms go
+	// through the same setters
+	std::map<GLuint, ShaderManager*> m_shaders;
+	ShaderManager* m_pCurrentShader;
+
+	// read one call, making it when bExecute is set
+	bool ReplayCall(const uint8_t*& pRead, const uint8_t* pEnd, bool bExecute, ShapeMeshes* pMeshes);
+	ShaderManager* GetShader(GLuint programID);
+	int GetName(uint16_t index) const;
+};
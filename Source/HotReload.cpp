@@ -0,0 +1,835 @@
+///////////////////////////////////////////////////////////////////////////////
+// hotreload.cpp
+// ============
+// reload changed shaders, textures and scene files while running
+///////////////////////////////////////////////////////////////////////////////
+
+#include "HotReload.h"
+#include "GLTrace.h"
+#include "ResourceTracker.h"
+
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// declaration of global variables
+namespace
+{
+	// time the writes to a file must stop for before it is
+	// reloaded, since editors save in several steps
+	const int g_SettleMilliseconds = 100;
+	// longest wait for file events and the interval the
+	// modified times are polled at without them
+	const int g_WaitMilliseconds = 50;
+	const int g_PollMilliseconds = 250;
+	// shader stage of each program file, in PROGRAM_RELOAD order
+	const GLenum g_ShaderTypes[3] = { GL_VERTEX_SHADER, GL_GEOMETRY_SHADER, GL_FRAGMENT_SHADER };
+}
+
+/***********************************************************
+ *  HotReload()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+HotReload::HotReload()
+{
+	m_bStop = false;
+	m_bPrepared = false;
+	m_notifyHandle = -1;
+	m_bParallelCompile = false;
+	m_pWorkerWindow = NULL;
+}
+
+/***********************************************************
+ *  ~HotReload()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+HotReload::~HotReload()
+{
+	Stop();
+
+	for (size_t i = 0; i < m_programs.size(); i++)
+	{
+		DeleteProgramShaders(m_programs[i]);
+		if (0 != m_programs[i]->programID)
+		{
+			glDeleteProgram(m_programs[i]->programID);
+		}
+		delete m_programs[i];
+	}
+	m_programs.clear();
+	for (size_t i = 0; i < m_watches.size(); i++)
+	{
+		delete m_watches[i];
+	}
+	m_watches.clear();
+}
+
+/***********************************************************
+ *  Watch()
+ *
+ *  This method is used for watching a group of files that
+ *  make up one asset.  When any of them changes the prepare
+ *  function runs on the watcher thread, and when it has
+ *  something to swap in the apply function runs on the
+ *  render thread.  Must be called before Start().
+ ***********************************************************/
+void HotReload::Watch(const std::vector<std::string>& filenames, const PrepareFunc& prepare, const ApplyFunc& apply)
+{
+	if (IsRunning())
+	{
+		std::cout << "Files must be watched before the hot reload starts" << std::endl;
+		return;
+	}
+
+	WATCH* pWatch = new WATCH();
+	for (size_t i = 0; i < filenames.size(); i++)
+	{
+		const std::string& path = filenames[i];
+		size_t slash = path.find_last_of("/\\");
+
+		WATCHED_FILE file;
+		file.path = path;
+		if (std::string::npos == slash)
+		{
+			file.directory = FindDirectory(".");
+			file.name = path;
+		}
+		else
+		{
+			file.directory = FindDirectory((slash == 0) ? std::string("/") : path.substr(0, slash));
+			file.name = path.substr(slash + 1);
+		}
+		file.modifiedTime = -1;
+		pWatch->files.push_back(file);
+	}
+	pWatch->prepare = prepare;
+	pWatch->apply = apply;
+	pWatch->state = WATCH_IDLE;
+	pWatch->bChangedAgain = false;
+	m_watches.push_back(pWatch);
+}
+
+/***********************************************************
+ *  WatchProgram()
+ *
+ *  This method is used for rebuilding the program of a
+ *  shader manager when one of its shader files changes.  The
+ *  files are read on the watcher thread, and the program is
+ *  built there in the worker context, or by the driver in
+ *  the background, or in steps on the render thread when
+ *  neither is available.  The new program replaces the old one in the same shader manager
+ *  only once it linked, so a shader with errors leaves the
+ *  old program drawing.  The callback then sets the uniforms
+ *  that are only set once, as the program starts with none.
+ ***********************************************************/
+void HotReload::WatchProgram(
+	ShaderManager* pShader,
+	const char* vertexFilename,
+	const char* geometryFilename,
+	const char* fragmentFilename,
+	const char* subsystem,
+	const ProgramFunc& onReload)
+{
+	PROGRAM_RELOAD* pProgram = new PROGRAM_RELOAD();
+	pProgram->pShader = pShader;
+	pProgram->filenames[0] = vertexFilename;
+	pProgram->filenames[1] = (NULL != geometryFilename) ? geometryFilename : "";
+	pProgram->filenames[2] = fragmentFilename;
+	pProgram->subsystem = subsystem;
+	pProgram->onReload = onReload;
+	pProgram->programID = 0;
+	pProgram->bBuilt = false;
+	pProgram->buildStep = 0;
+
+	std::vector<std::string> filenames;
+	for (int i = 0; i < PROGRAM_STAGES; i++)
+	{
+		pProgram->shaders[i] = 0;
+		if (!pProgram->filenames[i].empty())
+		{
+			filenames.push_back(pProgram->filenames[i]);
+		}
+	}
+	m_programs.push_back(pProgram);
+
+	Watch(filenames,
+		[this, pProgram]() { return PrepareProgram(pProgram); },
+		[this, pProgram]() { return BuildProgram(pProgram); });
+}
+
+/***********************************************************
+ *  Start()
+ *
+ *  This method is used for starting the watcher thread.  On
+ *  Linux the directories of the watched files are watched
+ *  with inotify, so a change is seen as soon as the file is
+ *  closed or renamed into place.  Elsewhere, or when inotify
+ *  fails, the modified times are polled.  Must be called on
+ *  the render thread, with its context current.
+ ***********************************************************/
+bool HotReload::Start()
+{
+	if (IsRunning())
+	{
+		return(true);
+	}
+	if (m_watches.empty())
+	{
+		return(false);
+	}
+
+	// let the driver compile the programs on its own threads,
+	// so a reload is checked on instead of waited for
+	m_bParallelCompile = (GLEW_KHR_parallel_shader_compile != 0);
+	if (m_bParallelCompile)
+	{
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFFu);
+	}
+	// otherwise build them on the watcher thread
+	else if (!CreateWorkerContext())
+	{
+		std::cout << "Reloaded shader programs are built on the render thread, "
+			<< "a stage per frame, which can stall those frames" << std::endl;
+	}
+
+#ifdef __linux__
+	m_notifyHandle = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	for (size_t i = 0; (m_notifyHandle >= 0) && (i < m_directories.size()); i++)
+	{
+		int handle = inotify_add_watch(m_notifyHandle, m_directories[i].c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+		if (handle < 0)
+		{
+			std::cout << "Could not watch the directory:" << m_directories[i] << std::endl;
+			close(m_notifyHandle);
+			m_notifyHandle = -1;
+			m_directoryHandles.clear();
+			break;
+		}
+		m_directoryHandles.push_back(handle);
+	}
+#endif
+
+	size_t fileCount = 0;
+	for (size_t i = 0; i < m_watches.size(); i++)
+	{
+		for (size_t j = 0; j < m_watches[i]->files.size(); j++)
+		{
+			WATCHED_FILE& file = m_watches[i]->files[j];
+			file.modifiedTime = GetModifiedTime(file.path);
+			fileCount++;
+		}
+	}
+	m_applying.reserve(m_watches.size());
+
+	m_bStop = false;
+	m_watcher = std::thread(&HotReload::WatcherLoop, this);
+
+	std::cout << "Hot reload is watching " << fileCount << " files"
+		<< ((m_notifyHandle < 0) ? " by polling" : "") << std::endl;
+	return(true);
+}
+
+/***********************************************************
+ *  Stop()
+ *
+ *  This method is used for stopping the watcher thread.  A
+ *  reload that was prepared but not yet swapped in is
+ *  dropped.
+ ***********************************************************/
+void HotReload::Stop()
+{
+	if (m_watcher.joinable())
+	{
+		m_bStop = true;
+		m_condition.notify_all();
+		m_watcher.join();
+	}
+	if (NULL != m_pWorkerWindow)
+	{
+		glfwDestroyWindow(m_pWorkerWindow);
+		m_pWorkerWindow = NULL;
+	}
+
+#ifdef __linux__
+	if (m_notifyHandle >= 0)
+	{
+		close(m_notifyHandle);
+	}
+#endif
+	m_notifyHandle = -1;
+	m_directoryHandles.clear();
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for swapping in the assets the
+ *  watcher thread has prepared, at the start of a frame.  A
+ *  swap that is not finished is tried again next frame, so
+ *  a frame never waits for one.
+ ***********************************************************/
+bool HotReload::Update()
+{
+	if (!m_bPrepared.load(std::memory_order_acquire))
+	{
+		return(false);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_applying.clear();
+		for (size_t i = 0; i < m_watches.size(); i++)
+		{
+			if (WATCH_PREPARED == m_watches[i]->state)
+			{
+				m_applying.push_back(m_watches[i]);
+			}
+		}
+	}
+
+	bool bSwapped = false;
+	for (size_t i = 0; i < m_applying.size(); i++)
+	{
+		WATCH* pWatch = m_applying[i];
+		if (!pWatch->apply())
+		{
+			continue;
+		}
+		bSwapped = true;
+
+		// a change seen meanwhile is reloaded in turn
+		std::lock_guard<std::mutex> lock(m_mutex);
+		pWatch->state = pWatch->bChangedAgain ? WATCH_CHANGED : WATCH_IDLE;
+		pWatch->bChangedAgain = false;
+		pWatch->changeTime = std::chrono::steady_clock::now();
+	}
+
+	// the watcher thread may have prepared more meanwhile
+	std::lock_guard<std::mutex> lock(m_mutex);
+	bool bPrepared = false;
+	for (size_t i = 0; i < m_watches.size(); i++)
+	{
+		if (WATCH_PREPARED == m_watches[i]->state)
+		{
+			bPrepared = true;
+		}
+	}
+	m_bPrepared.store(bPrepared, std::memory_order_release);
+
+	return(bSwapped);
+}
+
+/***********************************************************
+ *  WatcherLoop()
+ *
+ *  This method is run by the watcher thread.  It collects
+ *  the file changes and prepares the assets whose files have
+ *  not been written to for a moment.
+ ***********************************************************/
+void HotReload::WatcherLoop()
+{
+	if (NULL != m_pWorkerWindow)
+	{
+		glfwMakeContextCurrent(m_pWorkerWindow);
+	}
+
+	while (!m_bStop)
+	{
+		WaitForChanges();
+		PrepareChanged();
+	}
+
+	if (NULL != m_pWorkerWindow)
+	{
+		glfwMakeContextCurrent(NULL);
+	}
+}
+
+/***********************************************************
+ *  WaitForChanges()
+ *
+ *  This method is used for waiting a short while for file
+ *  events, or for polling the modified times once.
+ ***********************************************************/
+void HotReload::WaitForChanges()
+{
+#ifdef __linux__
+	if (m_notifyHandle >= 0)
+	{
+		struct pollfd pollInfo;
+		pollInfo.fd = m_notifyHandle;
+		pollInfo.events = POLLIN;
+		pollInfo.revents = 0;
+		if (poll(&pollInfo, 1, g_WaitMilliseconds) <= 0)
+		{
+			return;
+		}
+
+		alignas(struct inotify_event) char buffer[4096];
+		ssize_t length = 0;
+		while ((length = read(m_notifyHandle, buffer, sizeof(buffer))) > 0)
+		{
+			const char* pEvent = buffer;
+			while (pEvent < buffer + length)
+			{
+				const struct inotify_event* pInfo = (const struct inotify_event*)pEvent;
+				if (pInfo->len > 0)
+				{
+					for (size_t i = 0; i < m_directoryHandles.size(); i++)
+					{
+						if (m_directoryHandles[i] == pInfo->wd)
+						{
+							MarkChanged((int)i, pInfo->name);
+						}
+					}
+				}
+				pEvent += sizeof(struct inotify_event) + pInfo->len;
+			}
+		}
+		return;
+	}
+#endif
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_condition.wait_for(lock, std::chrono::milliseconds(g_PollMilliseconds), [this]() { return m_bStop.load(); });
+	if (m_bStop)
+	{
+		return;
+	}
+
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < m_watches.size(); i++)
+	{
+		WATCH* pWatch = m_watches[i];
+		bool bChanged = false;
+		for (size_t j = 0; j < pWatch->files.size(); j++)
+		{
+			WATCHED_FILE& file = pWatch->files[j];
+			long long modifiedTime = GetModifiedTime(file.path);
+			if (modifiedTime != file.modifiedTime)
+			{
+				file.modifiedTime = modifiedTime;
+				bChanged = (modifiedTime >= 0) || bChanged;
+			}
+		}
+		if (!bChanged)
+		{
+			continue;
+		}
+
+		if ((WATCH_IDLE == pWatch->state) || (WATCH_CHANGED == pWatch->state))
+		{
+			pWatch->state = WATCH_CHANGED;
+			pWatch->changeTime = now;
+		}
+		else
+		{
+			pWatch->bChangedAgain = true;
+		}
+	}
+}
+
+/***********************************************************
+ *  MarkChanged()
+ *
+ *  This method is used for marking the watches of a file
+ *  the file system reported a write to.  Each write starts
+ *  the settle time over.
+ ***********************************************************/
+void HotReload::MarkChanged(int directory, const char* name)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+	for (size_t i = 0; i < m_watches.size(); i++)
+	{
+		WATCH* pWatch = m_watches[i];
+		for (size_t j = 0; j < pWatch->files.size(); j++)
+		{
+			const WATCHED_FILE& file = pWatch->files[j];
+			if ((file.directory != directory) || (file.name.compare(name) != 0))
+			{
+				continue;
+			}
+
+			if ((WATCH_IDLE == pWatch->state) || (WATCH_CHANGED == pWatch->state))
+			{
+				pWatch->state = WATCH_CHANGED;
+				pWatch->changeTime = now;
+			}
+			else
+			{
+				pWatch->bChangedAgain = true;
+			}
+			break;
+		}
+	}
+}
+
+/***********************************************************
+ *  PrepareChanged()
+ *
+ *  This method is used for running the prepare functions of
+ *  the changed watches whose files have settled.  They run
+ *  without the lock held, so the render thread never waits
+ *  for them.
+ ***********************************************************/
+void HotReload::PrepareChanged()
+{
+	for (size_t i = 0; (i < m_watches.size()) && !m_bStop; i++)
+	{
+		WATCH* pWatch = m_watches[i];
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+			if ((WATCH_CHANGED != pWatch->state) ||
+				(now - pWatch->changeTime < std::chrono::milliseconds(g_SettleMilliseconds)))
+			{
+				continue;
+			}
+			pWatch->state = WATCH_PREPARING;
+			pWatch->bChangedAgain = false;
+		}
+
+		bool bPrepared = pWatch->prepare();
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (bPrepared)
+		{
+			pWatch->state = WATCH_PREPARED;
+			m_bPrepared.store(true, std::memory_order_release);
+			// wake the render loop when it sleeps between changes
+			glfwPostEmptyEvent();
+		}
+		else
+		{
+			pWatch->state = pWatch->bChangedAgain ? WATCH_CHANGED : WATCH_IDLE;
+			pWatch->bChangedAgain = false;
+			pWatch->changeTime = std::chrono::steady_clock::now();
+		}
+	}
+}
+
+/***********************************************************
+ *  CreateWorkerContext()
+ *
+ *  This method is used for creating a hidden window whose
+ *  context shares its objects with the render context, for
+ *  the watcher thread to build the programs in.
+ ***********************************************************/
+bool HotReload::CreateWorkerContext()
+{
+	GLFWwindow* pRenderWindow = glfwGetCurrentContext();
+	if (NULL == pRenderWindow)
+	{
+		return(false);
+	}
+
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	m_pWorkerWindow = glfwCreateWindow(1, 1, "Hot reload", NULL, pRenderWindow);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+	glfwMakeContextCurrent(pRenderWindow);
+
+	return(NULL != m_pWorkerWindow);
+}
+
+/***********************************************************
+ *  PrepareProgram()
+ *
+ *  This method is used for reading the shader files of a
+ *  program on the watcher thread and, with a worker context,
+ *  compiling and linking it there.  The link is waited for
+ *  and finished here, so the program is complete when the
+ *  render thread swaps it in.
+ ***********************************************************/
+bool HotReload::PrepareProgram(PROGRAM_RELOAD* pProgram)
+{
+	if (!ReadProgramSources(pProgram))
+	{
+		return(false);
+	}
+	if (NULL == m_pWorkerWindow)
+	{
+		return(true);
+	}
+
+	pProgram->programID = glCreateProgram();
+	for (int i = 0; i < PROGRAM_STAGES; i++)
+	{
+		CompileStage(pProgram, i);
+	}
+	glLinkProgram(pProgram->programID);
+
+	GLint bLinked = GL_FALSE;
+	glGetProgramiv(pProgram->programID, GL_LINK_STATUS, &bLinked);
+	glFinish();
+	pProgram->bBuilt = true;
+
+	return(true);
+}
+
+/***********************************************************
+ *  ReadProgramSources()
+ *
+ *  This method is used for reading the shader files of a
+ *  program on the watcher thread.
+ ***********************************************************/
+bool HotReload::ReadProgramSources(PROGRAM_RELOAD* pProgram)
+{
+	for (int i = 0; i < PROGRAM_STAGES; i++)
+	{
+		pProgram->sources[i].clear();
+		if (pProgram->filenames[i].empty())
+		{
+			continue;
+		}
+
+		std::ifstream file(pProgram->filenames[i].c_str());
+		if (!file)
+		{
+			std::cout << "Could not read shader file:" << pProgram->filenames[i] << std::endl;
+			return(false);
+		}
+		std::stringstream source;
+		source << file.rdbuf();
+		pProgram->sources[i] = source.str();
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  CompileStage()
+ *
+ *  This method is used for compiling one shader stage of
+ *  the new program and attaching it.
+ ***********************************************************/
+void HotReload::CompileStage(PROGRAM_RELOAD* pProgram, int stage)
+{
+	if (pProgram->filenames[stage].empty())
+	{
+		return;
+	}
+
+	const char* pSource = pProgram->sources[stage].c_str();
+	pProgram->shaders[stage] = glCreateShader(g_ShaderTypes[stage]);
+	glShaderSource(pProgram->shaders[stage], 1, &pSource, NULL);
+	glCompileShader(pProgram->shaders[stage]);
+	glAttachShader(pProgram->programID, pProgram->shaders[stage]);
+}
+
+/***********************************************************
+ *  BuildProgram()
+ *
+ *  This method is used for finishing the new program on the
+ *  render thread.  A program built in the worker context is
+ *  only swapped in.  With parallel shader compiles the driver
+ *  works on it in the background and the completion status
+ *  is checked once per frame.  Without either, a stage is
+ *  compiled per frame and then linked in another, so a frame
+ *  never does the whole build.
+ ***********************************************************/
+bool HotReload::BuildProgram(PROGRAM_RELOAD* pProgram)
+{
+	if (pProgram->bBuilt)
+	{
+		pProgram->bBuilt = false;
+		return(FinishProgram(pProgram));
+	}
+
+	if (true == m_bParallelCompile)
+	{
+		if (0 == pProgram->programID)
+		{
+			pProgram->programID = glCreateProgram();
+			for (int i = 0; i < PROGRAM_STAGES; i++)
+			{
+				CompileStage(pProgram, i);
+			}
+			glLinkProgram(pProgram->programID);
+			return(false);
+		}
+
+		GLint bComplete = GL_FALSE;
+		glGetProgramiv(pProgram->programID, GL_COMPLETION_STATUS_KHR, &bComplete);
+		if (GL_TRUE != bComplete)
+		{
+			return(false);
+		}
+		return(FinishProgram(pProgram));
+	}
+
+	if (0 == pProgram->programID)
+	{
+		pProgram->programID = glCreateProgram();
+		pProgram->buildStep = 0;
+	}
+	while ((pProgram->buildStep < PROGRAM_STAGES) && pProgram->filenames[pProgram->buildStep].empty())
+	{
+		pProgram->buildStep++;
+	}
+	if (pProgram->buildStep < PROGRAM_STAGES)
+	{
+		CompileStage(pProgram, pProgram->buildStep);
+		pProgram->buildStep++;
+		return(false);
+	}
+	if (PROGRAM_STAGES == pProgram->buildStep)
+	{
+		glLinkProgram(pProgram->programID);
+		pProgram->buildStep++;
+		return(false);
+	}
+
+	return(FinishProgram(pProgram));
+}
+
+/***********************************************************
+ *  FinishProgram()
+ *
+ *  This method is used for putting the linked program into
+ *  the shader manager in place of the old one, which is
+ *  deleted along with its cached uniform locations.  When
+ *  the program did not compile or link, the errors are shown
+ *  and the old program stays.
+ ***********************************************************/
+bool HotReload::FinishProgram(PROGRAM_RELOAD* pProgram)
+{
+	GLint bLinked = GL_FALSE;
+	glGetProgramiv(pProgram->programID, GL_LINK_STATUS, &bLinked);
+	if (GL_TRUE != bLinked)
+	{
+		bool bCompileFailed = false;
+		for (int i = 0; i < PROGRAM_STAGES; i++)
+		{
+			GLint bCompiled = GL_TRUE;
+			if (0 != pProgram->shaders[i])
+			{
+				glGetShaderiv(pProgram->shaders[i], GL_COMPILE_STATUS, &bCompiled);
+			}
+			if (GL_TRUE == bCompiled)
+			{
+				continue;
+			}
+
+			GLint logLength = 0;
+			glGetShaderiv(pProgram->shaders[i], GL_INFO_LOG_LENGTH, &logLength);
+			std::vector<char> log(std::max(logLength, 1), '\0');
+			glGetShaderInfoLog(pProgram->shaders[i], (GLsizei)log.size(), NULL, log.data());
+			std::cout << "Failed to compile " << pProgram->filenames[i] << ": " << log.data() << std::endl;
+			bCompileFailed = true;
+		}
+		if (!bCompileFailed)
+		{
+			GLint logLength = 0;
+			glGetProgramiv(pProgram->programID, GL_INFO_LOG_LENGTH, &logLength);
+			std::vector<char> log(std::max(logLength, 1), '\0');
+			glGetProgramInfoLog(pProgram->programID, (GLsizei)log.size(), NULL, log.data());
+			std::cout << "Failed to link " << pProgram->filenames[2] << ": " << log.data() << std::endl;
+		}
+		std::cout << "Keeping the old program of " << pProgram->filenames[2] << std::endl;
+
+		DeleteProgramShaders(pProgram);
+		glDeleteProgram(pProgram->programID);
+		pProgram->programID = 0;
+		return(true);
+	}
+	DeleteProgramShaders(pProgram);
+
+	ShaderManager* pShader = pProgram->pShader;
+	GLuint oldProgramID = pShader->m_programID;
+	ResourceTracker::Release(RESOURCE_PROGRAM, oldProgramID);
+	GLTrace::ForgetProgram(oldProgramID);
+	glDeleteProgram(oldProgramID);
+
+	pShader->m_programID = pProgram->programID;
+	pProgram->programID = 0;
+	ResourceTracker::TrackProgram(pShader->m_programID, pProgram->subsystem.c_str(), pProgram->filenames[2].c_str());
+
+	GLTrace::UseProgram(pShader);
+	if (pProgram->onReload)
+	{
+		pProgram->onReload(pShader);
+	}
+
+	std::cout << "Reloaded shader program:" << pProgram->filenames[2] << " of " << pProgram->subsystem << std::endl;
+	return(true);
+}
+
+/***********************************************************
+ *  DeleteProgramShaders()
+ *
+ *  This method is used for deleting the compiled shaders of
+ *  a program being built, which it no longer needs once it
+ *  is linked.
+ ***********************************************************/
+void HotReload::DeleteProgramShaders(PROGRAM_RELOAD* pProgram)
+{
+	for (int i = 0; i < PROGRAM_STAGES; i++)
+	{
+		if (0 == pProgram->shaders[i])
+		{
+			continue;
+		}
+		if (0 != pProgram->programID)
+		{
+			glDetachShader(pProgram->programID, pProgram->shaders[i]);
+		}
+		glDeleteShader(pProgram->shaders[i]);
+		pProgram->shaders[i] = 0;
+	}
+}
+
+/***********************************************************
+ *  FindDirectory()
+ *
+ *  This method is used for getting the index of a watched
+ *  directory, adding it the first time.
+ ***********************************************************/
+int HotReload::FindDirectory(const std::string& directory)
+{
+	for (size_t i = 0; i < m_directories.size(); i++)
+	{
+		if (m_directories[i].compare(directory) == 0)
+		{
+			return((int)i);
+		}
+	}
+
+	m_directories.push_back(directory);
+	return((int)m_directories.size() - 1);
+}
+
+/***********************************************************
+ *  GetModifiedTime()
+ *
+ *  This method is used for getting the last write time of a
+ *  file, or -1 when the file does not exist.
+ ***********************************************************/
+long long HotReload::GetModifiedTime(const std::string& filename)
+{
+#ifdef _WIN32
+	struct _stat fileInfo;
+	if (_stat(filename.c_str(), &fileInfo) != 0)
+		return(-1);
+#else
+	struct stat fileInfo;
+	if (stat(filename.c_str(), &fileInfo) != 0)
+		return(-1);
+#endif
+	return((long long)fileInfo.st_mtime);
+}
@@ -0,0 +1,187 @@
+///////////////////////////////////////////////////////////////////////////////
+// hotreload.h
+// ============
+// reload changed shaders, textures and scene files while running
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+
+#include <GL/glew.h>
+#include "GLFW/glfw3.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  HotReload
+ *
+ *  This class watches asset files and swaps in the new
+ *  version of whatever changed, without restarting.  A
+ *  watcher thread waits for the file system to report a
+ *  write (inotify on Linux, the modified times elsewhere)
+ *  and runs the slow part of the reload there, reading and
+ *  compiling files.  Shader programs are built there too,
+ *  in a hidden context sharing objects with the render
+ *  context, unless the driver compiles them in the
+ *  background anyway.  The render thread then finishes the
+ *  reload at the start of a frame in Update(), which costs
+ *  one atomic load when nothing changed.  A swap that is not
+ *  finished, such as a program still being compiled by the
+ *  driver, is retried on the next frame instead of waiting
+ *  for it.
+ *
+ *  Only the assets of the changed files are reloaded, and
+ *  the objects they are swapped into keep their OpenGL
+ *  names or their shader manager, so nothing holding on to
+ *  them has to change.
+ ***********************************************************/
+class HotReload
+{
+public:
+	// runs on the watcher thread once the files have changed,
+	// returns false when there is nothing to swap in
+	typedef std::function<bool()> PrepareFunc;
+	// runs on the render thread at the start of a frame,
+	// returns false to be called again on the next frame
+	typedef std::function<bool()> ApplyFunc;
+	// sets the uniforms of a swapped in program, which is bound
+	typedef std::function<void(ShaderManager*)> ProgramFunc;
+
+	// constructor
+	HotReload();
+	// destructor
+	~HotReload();
+
+	// reload when any of the files changes, before Start()
+	void Watch(const std::vector<std::string>& filenames, const PrepareFunc& prepare, const ApplyFunc& apply);
+	// rebuild the program of a shader manager when one of its
+	// shader files changes, the geometry shader may be NULL
+	void WatchProgram(
+		ShaderManager* pShader,
+		const char* vertexFilename,
+		const char* geometryFilename,
+		const char* fragmentFilename,
+		const char* subsystem,
+		const ProgramFunc& onReload);
+
+	// start and stop the watcher thread
+	bool Start();
+	void Stop();
+	bool IsRunning() const { return m_watcher.joinable(); }
+
+	// swap in the reloaded assets, called once per frame on the
+	// render thread.  Returns true when something was swapped
+	bool Update();
+	// true while a reload waits to be swapped in
+	bool IsSwapPending() const { return m_bPrepared.load(std::memory_order_acquire); }
+
+private:
+	enum WATCH_STATE
+	{
+		WATCH_IDLE = 0,
+		// a file changed, waiting for the writes to settle
+		WATCH_CHANGED,
+		// being prepared on the watcher thread
+		WATCH_PREPARING,
+		// waiting for or being applied on the render thread
+		WATCH_PREPARED
+	};
+
+	struct WATCHED_FILE
+	{
+		// directory watched for the file and its name in it
+		int directory;
+		std::string name;
+		std::string path;
+		long long modifiedTime;
+	};
+
+	struct WATCH
+	{
+		std::vector<WATCHED_FILE> files;
+		PrepareFunc prepare;
+		ApplyFunc apply;
+		WATCH_STATE state;
+		// changed again while prepared, reload once more after
+		bool bChangedAgain;
+		std::chrono::steady_clock::time_point changeTime;
+	};
+
+	// shader stages of a watched program
+	static const int PROGRAM_STAGES = 3;
+
+	struct PROGRAM_RELOAD
+	{
+		ShaderManager* pShader;
+		std::string filenames[PROGRAM_STAGES];
+		std::string subsystem;
+		ProgramFunc onReload;
+		// read by the watcher thread
+		std::string sources[PROGRAM_STAGES];
+		// program being compiled, 0 when none
+		GLuint shaders[PROGRAM_STAGES];
+		GLuint programID;
+		// linked on the worker context, only the swap is left
+		bool bBuilt;
+		// without a worker context or parallel compiles, the
+		// next stage compiled on the render thread, one per
+		// frame, and PROGRAM_STAGES once they are to be linked
+		int buildStep;
+	};
+
+	std::vector<WATCH*> m_watches;
+	std::vector<PROGRAM_RELOAD*> m_programs;
+	std::vector<std::string> m_directories;
+	// watches being applied on the render thread
+	std::vector<WATCH*> m_applying;
+
+	std::thread m_watcher;
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	std::atomic<bool> m_bStop;
+	// set when a watch is ready to be applied
+	std::atomic<bool> m_bPrepared;
+	// inotify instance and a watch per directory, -1 when the
+	// modified times are polled instead
+	int m_notifyHandle;
+	std::vector<int> m_directoryHandles;
+	bool m_bParallelCompile;
+	// hidden window whose context the watcher thread builds
+	// the programs in, NULL when they are built by the driver
+	// in the background or on the render thread
+	GLFWwindow* m_pWorkerWindow;
+
+	// watcher thread loop
+	void WatcherLoop();
+	// wait for file events or poll the modified times
+	void WaitForChanges();
+	void MarkChanged(int directory, const char* name);
+	// prepare the watches whose files have settled
+	void PrepareChanged();
+
+	// create the context the programs are built in
+	bool CreateWorkerContext();
+	// read the shader files of a program and build it when
+	// there is a worker context
+	bool PrepareProgram(PROGRAM_RELOAD* pProgram);
+	bool ReadProgramSources(PROGRAM_RELOAD* pProgram);
+	void CompileStage(PROGRAM_RELOAD* pProgram, int stage);
+	// compile and link, false while the driver is still busy
+	// or more steps are left for the next frames
+	bool BuildProgram(PROGRAM_RELOAD* pProgram);
+	bool FinishProgram(PROGRAM_RELOAD* pProgram);
+	void DeleteProgramShaders(PROGRAM_RELOAD* pProgram);
+
+	// index of a watched directory, added when new
+	int FindDirectory(const std::string& directory);
+	// last write time of a file, -1 when it does not exist
+	static long long GetModifiedTime(const std::string& filename);
+};
@@ -0,0 +1,857 @@
+///////////////////////////////////////////////////////////////////////////////
+// lightmapatlas.cpp
+// ============
+// bake the light of the static parts into a texture atlas
+///////////////////////////////////////////////////////////////////////////////
+
+#include "LightmapAtlas.h"
+#include "ShapeGeometry.h"
+#include "MappedFile.h"
+#include "ResourceTracker.h"
+#include "GLTrace.h"
+
+#include <glm/gtc/packing.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+// declaration of global variables
+namespace
+{
+	// number of light sources in the fragment shader
+	const uint32_t g_TotalLights = 4;
+	// texels per world unit the charts start out with, halved
+	// until the charts fit in the atlas
+	const float g_TexelsPerUnit = 8.0f;
+	const uint32_t g_MinChartTexels = 4;
+	const uint32_t g_MaxChartTexels = 512;
+	const uint32_t g_AtlasWidth = 1024;
+	const uint32_t g_MaxAtlasHeight = 4096;
+	// hemisphere rays per texel and how far away something
+	// still occludes the ambient light
+	const int g_OcclusionSamples = 64;
+	const float g_OcclusionDistance = 2.0f;
+	// rays start this far off the surface so it does not
+	// shadow itself
+	const float g_RayOffset = 0.002f;
+	// the shadow rays of the key light, which the shadow maps
+	// treat as a directional light, go this far
+	const float g_KeyLightDistance = 1000.0f;
+	// rings of texels filled around the covered ones
+	const int g_DilatePasses = 4;
+	const char* g_CacheExtension = ".lightmap";
+	const char* g_TrackerName = "scene";
+
+	/***********************************************************
+	 *  HashBytes()
+	 *
+	 *  This function is used for adding bytes to an FNV-1a
+	 *  hash.
+	 ***********************************************************/
+	uint64_t HashBytes(uint64_t hash, const void* pData, size_t size)
+	{
+		const unsigned char* pBytes = (const unsigned char*)pData;
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= pBytes[i];
+			hash *= 0x100000001B3ull;
+		}
+		return(hash);
+	}
+
+	/***********************************************************
+	 *  RadicalInverse()
+	 *
+	 *  This function is used for mirroring the bits of a sample
+	 *  index behind the binary point, the second coordinate of
+	 *  the Hammersley points.
+	 ***********************************************************/
+	float RadicalInverse(uint32_t bits)
+	{
+		bits = (bits << 16u) | (bits >> 16u);
+		bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+		bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+		bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+		bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+		return((float)bits * 2.3283064365386963e-10f);
+	}
+
+	/***********************************************************
+	 *  HashTexel()
+	 *
+	 *  This function is used for turning a texel index into a
+	 *  number in [0, 1), so each texel turns the same sample
+	 *  pattern by its own amount and the noise does not line
+	 *  up into bands.
+	 ***********************************************************/
+	float HashTexel(uint32_t index, uint32_t salt)
+	{
+		uint32_t x = index * 0x9E3779B9u + salt * 0x85EBCA6Bu;
+		x ^= x >> 16;
+		x *= 0x7FEB352Du;
+		x ^= x >> 15;
+		x *= 0x846CA68Bu;
+		x ^= x >> 16;
+		return((float)(x >> 8) / 16777216.0f);
+	}
+}
+
+/***********************************************************
+ *  LightmapAtlas()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+LightmapAtlas::LightmapAtlas()
+{
+	m_lightmappedPartCount = 0;
+	m_sceneHash = 0;
+	m_width = 0;
+	m_height = 0;
+	m_texture = 0;
+	m_bBaked = false;
+	for (int mesh = 0; mesh < MESH_TYPE_COUNT; mesh++)
+	{
+		ShapeGeometry::BuildTriangles((MESH_TYPE)mesh, m_shapes[mesh]);
+	}
+}
+
+/***********************************************************
+ *  ~LightmapAtlas()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+LightmapAtlas::~LightmapAtlas()
+{
+	if (0 != m_texture)
+	{
+		ResourceTracker::Release(RESOURCE_TEXTURE, m_texture);
+		glDeleteTextures(1, &m_texture);
+		m_texture = 0;
+	}
+}
+
+/***********************************************************
+ *  GetCacheFilename()
+ *
+ *  This method is used for getting the name of the baked
+ *  file of a scene file, which sits next to the scene file.
+ ***********************************************************/
+std::string LightmapAtlas::GetCacheFilename(const std::string& sceneFilename)
+{
+	return(sceneFilename + g_CacheExtension);
+}
+
+/***********************************************************
+ *  GetChart()
+ *
+ *  This method is used for finding the side of a basic shape
+ *  a vertex lies on from its normal: the one side of the
+ *  plane, the six faces of the box, and the side, top and
+ *  bottom of the cylinder.  The texture coordinates of the
+ *  shapes run from 0 to 1 over each side, so they give the
+ *  place in its chart.
+ ***********************************************************/
+int LightmapAtlas::GetChart(MESH_TYPE mesh, const glm::vec3& normal)
+{
+	if (MESH_BOX == mesh)
+	{
+		glm::vec3 size = glm::abs(normal);
+		int axis = 0;
+		if (size.y > size[axis])
+			axis = 1;
+		if (size.z > size[axis])
+			axis = 2;
+		return(axis * 2 + ((normal[axis] < 0.0f) ? 1 : 0));
+	}
+	if (MESH_CYLINDER == mesh)
+	{
+		if (normal.y > 0.5f)
+			return(1);
+		if (normal.y < -0.5f)
+			return(2);
+	}
+	return(0);
+}
+
+/***********************************************************
+ *  GetChartCount()
+ *
+ *  This method is used for getting the number of sides
+ *  GetChart() tells apart for a basic shape.
+ ***********************************************************/
+int LightmapAtlas::GetChartCount(MESH_TYPE mesh)
+{
+	if (MESH_BOX == mesh)
+		return(6);
+	if (MESH_CYLINDER == mesh)
+		return(3);
+	return(1);
+}
+
+/***********************************************************
+ *  IsStaticPart()
+ *
+ *  This method is used for checking that a part never moves
+ *  and blocks the light, so it can shade the baked texels.
+ *  The models have no triangles on the CPU here, and parts
+ *  that can be seen through let the light pass.
+ ***********************************************************/
+bool LightmapAtlas::IsStaticPart(const SceneFile* pSceneFile, const SCENE_PART_RECORD& part, const char* movingGroupName)
+{
+	if ((part.mesh >= MESH_TYPE_COUNT) || (part.animation >= 0) || ((part.flags & SCENE_PART_DYNAMIC) != 0))
+	{
+		return(false);
+	}
+	if ((NULL != movingGroupName) && (strcmp(pSceneFile->GetString(part.group), movingGroupName) == 0))
+	{
+		return(false);
+	}
+	return((part.texture >= 0) || (part.color[3] >= 1.0f));
+}
+
+/***********************************************************
+ *  CanLightmap()
+ *
+ *  This method is used for checking that a static part is
+ *  lit with a material, which its texels are baked with.
+ ***********************************************************/
+bool LightmapAtlas::CanLightmap(const SceneFile* pSceneFile, const SCENE_PART_RECORD& part)
+{
+	return(((part.flags & SCENE_PART_UNLIT) == 0) &&
+		(part.material >= 0) && ((uint32_t)part.material < pSceneFile->GetMaterialCount()));
+}
+
+/***********************************************************
+ *  Prepare()
+ *
+ *  This method is used for choosing the static parts that
+ *  are baked, measuring the world size of their sides and
+ *  packing a chart for each side into the atlas.  The hash
+ *  covers everything the texels are computed from: the bake
+ *  settings, the lights, and the meshes, transforms and
+ *  materials of the static parts.  The textures and colors
+ *  are applied when drawing, so they can change without a
+ *  new bake.
+ ***********************************************************/
+void LightmapAtlas::Prepare(const SceneFile* pSceneFile, const char* movingGroupName)
+{
+	const SCENE_PART_RECORD* pParts = pSceneFile->GetParts();
+	uint32_t partCount = (NULL != pParts) ? pSceneFile->GetPartCount() : 0;
+
+	m_charts.clear();
+	m_partCharts.assign(partCount, -1);
+	m_occluderParts.assign(partCount, 0);
+	m_lightmappedPartCount = 0;
+
+	uint64_t hash = 0xCBF29CE484222325ull;
+	uint32_t version = LIGHTMAP_FILE_VERSION;
+	hash = HashBytes(hash, &version, sizeof(version));
+	hash = HashBytes(hash, &g_TexelsPerUnit, sizeof(g_TexelsPerUnit));
+	hash = HashBytes(hash, &g_OcclusionSamples, sizeof(g_OcclusionSamples));
+	hash = HashBytes(hash, &g_OcclusionDistance, sizeof(g_OcclusionDistance));
+	uint32_t lightCount = std::min(pSceneFile->GetLightCount(), g_TotalLights);
+	if (lightCount > 0)
+	{
+		hash = HashBytes(hash, pSceneFile->GetLights(), lightCount * sizeof(SCENE_LIGHT_RECORD));
+	}
+
+	// world length of each chart along its u and v
+	std::vector<glm::vec2> chartSizes;
+	for (uint32_t i = 0; i < partCount; i++)
+	{
+		const SCENE_PART_RECORD& part = pParts[i];
+		bool bStatic = IsStaticPart(pSceneFile, part, movingGroupName);
+		bool bLightmapped = bStatic && CanLightmap(pSceneFile, part);
+		m_occluderParts[i] = bStatic ? 1 : 0;
+
+		uint32_t flags = (bStatic ? 1u : 0u) | (bLightmapped ? 2u : 0u);
+		hash = HashBytes(hash, &flags, sizeof(flags));
+		if (!bStatic)
+		{
+			continue;
+		}
+		hash = HashBytes(hash, &part.mesh, sizeof(part.mesh));
+		hash = HashBytes(hash, part.model, sizeof(part.model));
+		if (!bLightmapped)
+		{
+			continue;
+		}
+		const SCENE_MATERIAL_RECORD& material = pSceneFile->GetMaterials()[part.material];
+		hash = HashBytes(hash, &material.ambientStrength, sizeof(material) - sizeof(material.tag));
+
+		// the longest the side of a triangle is in the world per
+		// unit of its texture coordinates
+		MESH_TYPE mesh = (MESH_TYPE)part.mesh;
+		int chartCount = GetChartCount(mesh);
+		size_t firstSize = chartSizes.size();
+		chartSizes.resize(firstSize + chartCount, glm::vec2(0.0f));
+		glm::mat4 transform = glm::make_mat4(part.model);
+		const std::vector<MESH_VERTEX>& shape = m_shapes[mesh];
+		for (size_t v = 0; v + 2 < shape.size(); v += 3)
+		{
+			glm::vec3 p0 = glm::vec3(transform * glm::vec4(glm::make_vec3(shape[v].position), 1.0f));
+			glm::vec3 p1 = glm::vec3(transform * glm::vec4(glm::make_vec3(shape[v + 1].position), 1.0f));
+			glm::vec3 p2 = glm::vec3(transform * glm::vec4(glm::make_vec3(shape[v + 2].position), 1.0f));
+			glm::vec2 uv0 = glm::make_vec2(shape[v].uv);
+			glm::vec2 uv1 = glm::make_vec2(shape[v + 1].uv);
+			glm::vec2 uv2 = glm::make_vec2(shape[v + 2].uv);
+			glm::vec2 du = uv1 - uv0;
+			glm::vec2 dv = uv2 - uv0;
+			float determinant = du.x * dv.y - dv.x * du.y;
+			if (std::fabs(determinant) < 1e-8f)
+			{
+				continue;
+			}
+			glm::vec3 dPdu = ((p1 - p0) * dv.y - (p2 - p0) * du.y) / determinant;
+			glm::vec3 dPdv = ((p2 - p0) * du.x - (p1 - p0) * dv.x) / determinant;
+			glm::vec2& size = chartSizes[firstSize + GetChart(mesh, glm::make_vec3(shape[v].normal))];
+			size = glm::max(size, glm::vec2(glm::length(dPdu), glm::length(dPdv)));
+		}
+
+		m_partCharts[i] = (int)m_charts.size();
+		for (int c = 0; c < chartCount; c++)
+		{
+			LIGHTMAP_CHART chart;
+			memset(&chart, 0, sizeof(chart));
+			chart.part = i;
+			chart.chart = (uint32_t)c;
+			m_charts.push_back(chart);
+		}
+		m_lightmappedPartCount++;
+	}
+	m_sceneHash = hash;
+
+	// a scene too large for the atlas is baked coarser
+	float texelsPerUnit = g_TexelsPerUnit;
+	while (!PackCharts(chartSizes, texelsPerUnit))
+	{
+		texelsPerUnit *= 0.5f;
+	}
+	m_texels.clear();
+	m_bBaked = false;
+}
+
+/***********************************************************
+ *  PackCharts()
+ *
+ *  This method is used for sizing the charts and packing
+ *  them into shelves, tallest first, with a texel of space
+ *  around each so filtering never mixes two charts.  The
+ *  atlas is as high as the shelves need.  Charts hit their
+ *  smallest size at some point, so halving the texels per
+ *  unit always ends with charts that fit.
+ ***********************************************************/
+bool LightmapAtlas::PackCharts(const std::vector<glm::vec2>& chartSizes, float texelsPerUnit)
+{
+	std::vector<uint32_t> order(m_charts.size());
+	for (size_t i = 0; i < m_charts.size(); i++)
+	{
+		LIGHTMAP_CHART& chart = m_charts[i];
+		chart.width = (uint32_t)std::ceil(chartSizes[i].x * texelsPerUnit) + 1;
+		chart.height = (uint32_t)std::ceil(chartSizes[i].y * texelsPerUnit) + 1;
+		chart.width = std::min(std::max(chart.width, g_MinChartTexels), g_MaxChartTexels);
+		chart.height = std::min(std::max(chart.height, g_MinChartTexels), g_MaxChartTexels);
+		order[i] = (uint32_t)i;
+	}
+	std::stable_sort(order.begin(), order.end(),
+		[this](uint32_t a, uint32_t b) { return m_charts[a].height > m_charts[b].height; });
+
+	uint32_t x = 0;
+	uint32_t y = 0;
+	uint32_t shelfHeight = 0;
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		LIGHTMAP_CHART& chart = m_charts[order[i]];
+		if (x + chart.width + 2 > g_AtlasWidth)
+		{
+			y += shelfHeight;
+			x = 0;
+			shelfHeight = 0;
+		}
+		chart.x = x + 1;
+		chart.y = y + 1;
+		x += chart.width + 2;
+		shelfHeight = std::max(shelfHeight, chart.height + 2);
+	}
+
+	m_width = m_charts.empty() ? 0 : g_AtlasWidth;
+	m_height = y + shelfHeight;
+	return((m_height <= g_MaxAtlasHeight) || (texelsPerUnit * g_MaxChartTexels < 1.0f));
+}
+
+/***********************************************************
+ *  GetAtlasCoordinate()
+ *
+ *  This method is used for getting where the lightmap is
+ *  read for a vertex of a baked part.  The texture
+ *  coordinates of the side map onto the texel centers of
+ *  its chart, the ones the bake computed.
+ ***********************************************************/
+bool LightmapAtlas::GetAtlasCoordinate(uint32_t part, MESH_TYPE mesh, const MESH_VERTEX& vertex, float atlasUV[2]) const
+{
+	if (!IsLightmapped(part))
+	{
+		return(false);
+	}
+
+	const LIGHTMAP_CHART& chart = m_charts[m_partCharts[part] + GetChart(mesh, glm::make_vec3(vertex.normal))];
+	atlasUV[0] = ((float)chart.x + 0.5f + vertex.uv[0] * (float)(chart.width - 1)) / (float)m_width;
+	atlasUV[1] = ((float)chart.y + 0.5f + vertex.uv[1] * (float)(chart.height - 1)) / (float)m_height;
+	return(true);
+}
+
+/***********************************************************
+ *  RasterizeCharts()
+ *
+ *  This method is used for drawing the triangles of each
+ *  baked side into its chart, in the texture coordinates of
+ *  the shape, to find the world position and the normals
+ *  under each texel center.
+ ***********************************************************/
+void LightmapAtlas::RasterizeCharts(const SceneFile* pSceneFile, std::vector<TEXEL_SURFACE>& surfaces, std::vector<char>& covered) const
+{
+	const SCENE_PART_RECORD* pParts = pSceneFile->GetParts();
+	surfaces.resize((size_t)m_width * m_height);
+	covered.assign((size_t)m_width * m_height, 0);
+
+	for (size_t c = 0; c < m_charts.size(); c++)
+	{
+		const LIGHTMAP_CHART& chart = m_charts[c];
+		const SCENE_PART_RECORD& part = pParts[chart.part];
+		MESH_TYPE mesh = (MESH_TYPE)part.mesh;
+		glm::mat4 transform = glm::make_mat4(part.model);
+		glm::mat3 normalTransform = glm::transpose(glm::inverse(glm::mat3(transform)));
+		glm::vec2 chartScale((float)(chart.width - 1), (float)(chart.height - 1));
+
+		const std::vector<MESH_VERTEX>& shape = m_shapes[mesh];
+		for (size_t v = 0; v + 2 < shape.size(); v += 3)
+		{
+			if (GetChart(mesh, glm::make_vec3(shape[v].normal)) != (int)chart.chart)
+			{
+				continue;
+			}
+
+			glm::vec2 corners[3];
+			for (int k = 0; k < 3; k++)
+			{
+				corners[k] = glm::make_vec2(shape[v + k].uv) * chartScale;
+			}
+			float area = (corners[1].x - corners[0].x) * (corners[2].y - corners[0].y) -
+				(corners[2].x - corners[0].x) * (corners[1].y - corners[0].y);
+			if (std::fabs(area) < 1e-8f)
+			{
+				continue;
+			}
+
+			glm::vec2 cornerMin = glm::min(corners[0], glm::min(corners[1], corners[2]));
+			glm::vec2 cornerMax = glm::max(corners[0], glm::max(corners[1], corners[2]));
+			int x0 = std::max((int)std::ceil(cornerMin.x - 1e-3f), 0);
+			int y0 = std::max((int)std::ceil(cornerMin.y - 1e-3f), 0);
+			int x1 = std::min((int)std::floor(cornerMax.x + 1e-3f), (int)chart.width - 1);
+			int y1 = std::min((int)std::floor(cornerMax.y + 1e-3f), (int)chart.height - 1);
+			for (int ty = y0; ty <= y1; ty++)
+			{
+				for (int tx = x0; tx <= x1; tx++)
+				{
+					// barycentric weights of the texel center, a little
+					// outside still counts so the edges are covered
+					glm::vec2 p((float)tx, (float)ty);
+					float w0 = ((corners[1].x - p.x) * (corners[2].y - p.y) - (corners[2].x - p.x) * (corners[1].y - p.y)) / area;
+					float w1 = ((corners[2].x - p.x) * (corners[0].y - p.y) - (corners[0].x - p.x) * (corners[2].y - p.y)) / area;
+					float w2 = 1.0f - w0 - w1;
+					if ((w0 < -1e-4f) || (w1 < -1e-4f) || (w2 < -1e-4f))
+					{
+						continue;
+					}
+
+					glm::vec3 position = glm::make_vec3(shape[v].position) * w0 +
+						glm::make_vec3(shape[v + 1].position) * w1 +
+						glm::make_vec3(shape[v + 2].position) * w2;
+					glm::vec3 normal = glm::make_vec3(shape[v].normal) * w0 +
+						glm::make_vec3(shape[v + 1].normal) * w1 +
+						glm::make_vec3(shape[v + 2].normal) * w2;
+
+					size_t index = (size_t)(chart.y + ty) * m_width + (chart.x + tx);
+					TEXEL_SURFACE& surface = surfaces[index];
+					surface.position = glm::vec3(transform * glm::vec4(position, 1.0f));
+					surface.shadingNormal = glm::normalize(normal);
+					surface.surfaceNormal = glm::normalize(normalTransform * normal);
+					surface.part = (int)chart.part;
+					covered[index] = 1;
+				}
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  BakeTexel()
+ *
+ *  This method is used for computing the light of a texel
+ *  the way the fragment shader does, with the shadows and
+ *  the ambient occlusion of the static parts added.  The
+ *  shaders light with the mesh normal as it is, so the
+ *  diffuse light uses it too, while the rays leave along
+ *  the normal of the surface in the world.  Lights without
+ *  shadow maps are not shadowed here either.
+ ***********************************************************/
+glm::vec4 LightmapAtlas::BakeTexel(
+	const SceneFile* pSceneFile,
+	const TriangleBVH& bvh,
+	const TEXEL_SURFACE& surface,
+	uint32_t texelIndex) const
+{
+	const SCENE_PART_RECORD& part = pSceneFile->GetParts()[surface.part];
+	const SCENE_MATERIAL_RECORD& material = pSceneFile->GetMaterials()[part.material];
+	const SCENE_LIGHT_RECORD* pLights = pSceneFile->GetLights();
+	uint32_t lightCount = std::min(pSceneFile->GetLightCount(), g_TotalLights);
+
+	glm::vec3 origin = surface.position + surface.surfaceNormal * g_RayOffset;
+
+	// cosine weighted Hammersley points over the hemisphere,
+	// turned by a different amount for each texel
+	glm::vec3 tangent = (std::fabs(surface.surfaceNormal.x) < 0.9f) ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+	tangent = glm::normalize(glm::cross(surface.surfaceNormal, tangent));
+	glm::vec3 bitangent = glm::cross(surface.surfaceNormal, tangent);
+	float turnU = HashTexel(texelIndex, 1);
+	float turnV = HashTexel(texelIndex, 2);
+	int openCount = 0;
+	for (int i = 0; i < g_OcclusionSamples; i++)
+	{
+		float u = std::fmod(((float)i + 0.5f) / (float)g_OcclusionSamples + turnU, 1.0f);
+		float v = std::fmod(RadicalInverse((uint32_t)i) + turnV, 1.0f);
+		float radius = std::sqrt(u);
+		float angle = 6.28318530718f * v;
+		glm::vec3 direction = tangent * (radius * std::cos(angle)) + bitangent * (radius * std::sin(angle)) +
+			surface.surfaceNormal * std::sqrt(std::max(1.0f - u, 0.0f));
+		if (!bvh.IsOccluded(origin, direction, g_OcclusionDistance))
+		{
+			openCount++;
+		}
+	}
+	float occlusion = (float)openCount / (float)g_OcclusionSamples;
+
+	glm::vec3 materialAmbient = glm::make_vec3(material.ambientColor) * material.ambientStrength;
+	glm::vec3 materialDiffuse = glm::make_vec3(material.diffuseColor);
+	glm::vec4 texel(0.0f);
+	for (uint32_t i = 0; i < lightCount; i++)
+	{
+		const SCENE_LIGHT_RECORD& light = pLights[i];
+		glm::vec3 lightPosition = glm::make_vec3(light.position);
+		glm::vec3 ambient = glm::make_vec3(light.ambientColor) + materialAmbient;
+		texel += glm::vec4(ambient * occlusion, 0.0f);
+
+		glm::vec3 toLight = lightPosition - surface.position;
+		float lightDistance = glm::length(toLight);
+		if (lightDistance <= 0.0f)
+		{
+			continue;
+		}
+		float impact = std::max(glm::dot(surface.shadingNormal, toLight / lightDistance), 0.0f);
+		if ((impact > 0.0f) && ((light.flags & SCENE_LIGHT_SHADOWS) != 0))
+		{
+			// the key light shadows like a directional light
+			bool bShadowed = (i == 0) ?
+				((glm::length(lightPosition) > 0.0f) && bvh.IsOccluded(origin, glm::normalize(lightPosition), g_KeyLightDistance)) :
+				bvh.IsOccluded(origin, toLight / lightDistance, lightDistance - g_RayOffset);
+			if (bShadowed)
+			{
+				impact = 0.0f;
+			}
+		}
+
+		if (i == 0)
+		{
+			texel.a = impact;
+		}
+		else
+		{
+			texel += glm::vec4(impact * materialDiffuse, 0.0f);
+		}
+	}
+	return(texel);
+}
+
+/***********************************************************
+ *  DilateTexels()
+ *
+ *  This method is used for giving the texels no triangle
+ *  covers the average of their covered neighbours, a ring
+ *  at a time.
+ ***********************************************************/
+void LightmapAtlas::DilateTexels(std::vector<glm::vec4>& texels, std::vector<char>& covered) const
+{
+	std::vector<char> nextCovered;
+	for (int pass = 0; pass < g_DilatePasses; pass++)
+	{
+		nextCovered = covered;
+		for (uint32_t y = 0; y < m_height; y++)
+		{
+			for (uint32_t x = 0; x < m_width; x++)
+			{
+				size_t index = (size_t)y * m_width + x;
+				if (covered[index])
+				{
+					continue;
+				}
+
+				glm::vec4 sum(0.0f);
+				int count = 0;
+				for (int dy = -1; dy <= 1; dy++)
+				{
+					for (int dx = -1; dx <= 1; dx++)
+					{
+						int nx = (int)x + dx;
+						int ny = (int)y + dy;
+						if ((nx < 0) || (ny < 0) || (nx >= (int)m_width) || (ny >= (int)m_height))
+						{
+							continue;
+						}
+						size_t neighbour = (size_t)ny * m_width + nx;
+						if (covered[neighbour])
+						{
+							sum += texels[neighbour];
+							count++;
+						}
+					}
+				}
+				if (count > 0)
+				{
+					texels[index] = sum / (float)count;
+					nextCovered[index] = 1;
+				}
+			}
+		}
+		covered.swap(nextCovered);
+	}
+}
+
+/***********************************************************
+ *  Bake()
+ *
+ *  This method is used for tracing the texels of all the
+ *  charts.  The triangles of the static parts are put into
+ *  a tree, the texels are found by drawing the charts, and
+ *  the rows of the atlas are handed out to the threads one
+ *  at a time, since the charts make some rows much more
+ *  work than others.
+ ***********************************************************/
+void LightmapAtlas::Bake(const SceneFile* pSceneFile, int threadCount)
+{
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+	TriangleBVH bvh;
+	const SCENE_PART_RECORD* pParts = pSceneFile->GetParts();
+	for (size_t i = 0; i < m_occluderParts.size(); i++)
+	{
+		if (!m_occluderParts[i])
+		{
+			continue;
+		}
+		glm::mat4 transform = glm::make_mat4(pParts[i].model);
+		const std::vector<MESH_VERTEX>& shape = m_shapes[pParts[i].mesh];
+		for (size_t v = 0; v + 2 < shape.size(); v += 3)
+		{
+			bvh.AddTriangle(
+				glm::vec3(transform * glm::vec4(glm::make_vec3(shape[v].position), 1.0f)),
+				glm::vec3(transform * glm::vec4(glm::make_vec3(shape[v + 1].position), 1.0f)),
+				glm::vec3(transform * glm::vec4(glm::make_vec3(shape[v + 2].position), 1.0f)));
+		}
+	}
+	bvh.Build();
+
+	std::vector<TEXEL_SURFACE> surfaces;
+	std::vector<char> covered;
+	RasterizeCharts(pSceneFile, surfaces, covered);
+
+	std::vector<glm::vec4> texels((size_t)m_width * m_height, glm::vec4(0.0f));
+	if (threadCount <= 0)
+	{
+		threadCount = std::max((int)std::thread::hardware_concurrency(), 1);
+	}
+	threadCount = std::max(std::min(threadCount, (int)m_height), 1);
+
+	std::atomic<uint32_t> nextRow(0);
+	auto bakeRows = [&]()
+	{
+		for (uint32_t y = nextRow++; y < m_height; y = nextRow++)
+		{
+			for (uint32_t x = 0; x < m_width; x++)
+			{
+				size_t index = (size_t)y * m_width + x;
+				if (covered[index])
+				{
+					texels[index] = BakeTexel(pSceneFile, bvh, surfaces[index], (uint32_t)index);
+				}
+			}
+		}
+	};
+	std::vector<std::thread> threads;
+	threads.reserve(threadCount - 1);
+	for (int t = 1; t < threadCount; t++)
+	{
+		threads.push_back(std::thread(bakeRows));
+	}
+	bakeRows();
+	for (size_t i = 0; i < threads.size(); i++)
+	{
+		threads[i].join();
+	}
+
+	DilateTexels(texels, covered);
+
+	m_texels.resize(texels.size() * 4);
+	for (size_t i = 0; i < texels.size(); i++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			m_texels[i * 4 + c] = glm::packHalf1x16(texels[i][c]);
+		}
+	}
+	m_bBaked = true;
+
+	double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+	std::cout << "Lightmaps: baked " << m_charts.size() << " charts of " << m_lightmappedPartCount
+		<< " parts into " << m_width << "x" << m_height << " against " << bvh.GetTriangleCount()
+		<< " triangles on " << threadCount << " threads in " << (long)milliseconds << " ms" << std::endl;
+}
+
+/***********************************************************
+ *  Save()
+ *
+ *  This method is used for writing the charts and texels
+ *  into the baked file, with the hash they were baked for.
+ ***********************************************************/
+bool LightmapAtlas::Save(const std::string& filename) const
+{
+	LIGHTMAP_FILE_HEADER header;
+	memset(&header, 0, sizeof(header));
+	header.magic = LIGHTMAP_FILE_MAGIC;
+	header.version = LIGHTMAP_FILE_VERSION;
+	header.width = m_width;
+	header.height = m_height;
+	header.chartCount = (uint32_t)m_charts.size();
+	header.chartOffset = sizeof(LIGHTMAP_FILE_HEADER);
+	header.texelOffset = header.chartOffset + header.chartCount * sizeof(LIGHTMAP_CHART);
+	header.fileSize = header.texelOffset + (uint32_t)(m_texels.size() * sizeof(uint16_t));
+	header.sceneHash = m_sceneHash;
+
+	FILE* pFile = fopen(filename.c_str(), "wb");
+	if (NULL == pFile)
+	{
+		std::cout << "Could not write lightmap file:" << filename << std::endl;
+		return(false);
+	}
+	bool bWritten = (fwrite(&header, sizeof(header), 1, pFile) == 1);
+	if (bWritten && !m_charts.empty())
+	{
+		bWritten = (fwrite(m_charts.data(), sizeof(LIGHTMAP_CHART), m_charts.size(), pFile) == m_charts.size());
+	}
+	if (bWritten && !m_texels.empty())
+	{
+		bWritten = (fwrite(m_texels.data(), sizeof(uint16_t), m_texels.size(), pFile) == m_texels.size());
+	}
+	if ((fclose(pFile) != 0) || !bWritten)
+	{
+		std::cout << "Could not write lightmap file:" << filename << std::endl;
+		remove(filename.c_str());
+		return(false);
+	}
+	return(true);
+}
+
+/***********************************************************
+ *  Load()
+ *
+ *  This method is used for reading the texels of the baked
+ *  file.  The file must have been baked for the same hash
+ *  and hold the charts Prepare() laid out.
+ ***********************************************************/
+bool LightmapAtlas::Load(const std::string& filename)
+{
+	MappedFile file;
+	if (!file.Open(filename) || (file.GetSize() < sizeof(LIGHTMAP_FILE_HEADER)))
+	{
+		return(false);
+	}
+
+	const LIGHTMAP_FILE_HEADER* pHeader = (const LIGHTMAP_FILE_HEADER*)file.GetData();
+	size_t texelCount = (size_t)m_width * m_height * 4;
+	if ((pHeader->magic != LIGHTMAP_FILE_MAGIC) ||
+		(pHeader->version != LIGHTMAP_FILE_VERSION) ||
+		(pHeader->fileSize != file.GetSize()) ||
+		(pHeader->sceneHash != m_sceneHash) ||
+		(pHeader->width != m_width) ||
+		(pHeader->height != m_height) ||
+		(pHeader->chartCount != m_charts.size()) ||
+		((unsigned long long)pHeader->chartOffset + (unsigned long long)pHeader->chartCount * sizeof(LIGHTMAP_CHART) > file.GetSize()) ||
+		((pHeader->texelOffset % 2) != 0) ||
+		((unsigned long long)pHeader->texelOffset + texelCount * sizeof(uint16_t) > file.GetSize()))
+	{
+		return(false);
+	}
+	if (!m_charts.empty() &&
+		(memcmp(file.GetData() + pHeader->chartOffset, m_charts.data(), m_charts.size() * sizeof(LIGHTMAP_CHART)) != 0))
+	{
+		return(false);
+	}
+
+	const uint16_t* pTexels = (const uint16_t*)(file.GetData() + pHeader->texelOffset);
+	m_texels.assign(pTexels, pTexels + texelCount);
+	m_bBaked = false;
+	return(true);
+}
+
+/***********************************************************
+ *  LoadOrBake()
+ *
+ *  This method is used for getting the texels from the baked
+ *  file when it matches the scene, and baking and saving
+ *  them when it does not.
+ ***********************************************************/
+void LightmapAtlas::LoadOrBake(const SceneFile* pSceneFile, const std::string& filename, int threadCount)
+{
+	if (m_charts.empty() || Load(filename))
+	{
+		return;
+	}
+	Bake(pSceneFile, threadCount);
+	Save(filename);
+}
+
+/***********************************************************
+ *  CreateTexture()
+ *
+ *  This method is used for uploading the texels into a half
+ *  float texture on the lightmap unit and freeing them.
+ *  The charts have a texel of space around them, so the
+ *  texture is filtered but has no mipmaps.
+ ***********************************************************/
+void LightmapAtlas::CreateTexture()
+{
+	if (m_texels.empty())
+	{
+		return;
+	}
+
+	glGenTextures(1, &m_texture);
+	GLTrace::ActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT);
+	GLTrace::BindTexture(GL_TEXTURE_2D, m_texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, (GLsizei)m_width, (GLsizei)m_height, 0, GL_RGBA, GL_HALF_FLOAT, m_texels.data());
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	GLTrace::ActiveTexture(GL_TEXTURE0);
+	ResourceTracker::Track(RESOURCE_TEXTURE, m_texture, g_TrackerName, "lightmap",
+		ResourceTracker::GetImageBytes(GL_RGBA16F, (int)m_width, (int)m_height, 1));
+
+	std::vector<uint16_t>().swap(m_texels);
+}
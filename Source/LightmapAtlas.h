@@ -0,0 +1,175 @@
+///////////////////////////////////////////////////////////////////////////////
+// lightmapatlas.h
+// ============
+// bake the light of the static parts into a texture atlas
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneFile.h"
+#include "RenderQueue.h"
+#include "MeshImporter.h"
+#include "TriangleBVH.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// the baked file is the header, the chart records and the
+// texels as half floats, four per texel, row after row
+#define LIGHTMAP_FILE_MAGIC 0x504D4C44u   // "DLMP"
+#define LIGHTMAP_FILE_VERSION 1u
+
+struct LIGHTMAP_FILE_HEADER
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t fileSize;
+	uint32_t width;
+	uint32_t height;
+	uint32_t chartCount;
+	uint32_t chartOffset;
+	uint32_t texelOffset;
+	// hash of everything the light of the static parts
+	// depends on, the file is baked again when it changes
+	uint64_t sceneHash;
+};
+
+// the texels one side of a basic shape is baked into
+struct LIGHTMAP_CHART
+{
+	uint32_t part;
+	// side of the shape, see GetChart()
+	uint32_t chart;
+	// texels of the atlas, the texel centers on the edges of
+	// the chart lie on the edges of the side
+	uint32_t x;
+	uint32_t y;
+	uint32_t width;
+	uint32_t height;
+};
+
+static_assert(sizeof(LIGHTMAP_FILE_HEADER) == 40, "lightmap header must be packed");
+static_assert(sizeof(LIGHTMAP_CHART) == 24, "lightmap chart must be packed");
+
+/***********************************************************
+ *  LightmapAtlas
+ *
+ *  This class bakes the light falling on the parts that
+ *  never move into one texture, so the fragment shader reads
+ *  it instead of lighting them every frame.  Each side of a
+ *  static plane, box or cylinder gets a chart of the atlas
+ *  sized by its area.  The texels store the ambient light
+ *  darkened by ambient occlusion and the diffuse light of the
+ *  fill lights, with the shadows of the static parts, in
+ *  RGB, and the diffuse share of the key light, shadowed
+ *  the same way, in alpha.  The key light keeps its shadow
+ *  map at run time, so the moving parts still cast shadows
+ *  on the baked surfaces.
+ *
+ *  The light is traced on the CPU against a tree of the
+ *  static triangles, on one thread per hardware thread, and
+ *  the result is saved next to the scene file with a hash of
+ *  the parts, materials and lights it was baked from.  Only
+ *  the first run of a scene, or of a changed scene, bakes.
+ ***********************************************************/
+class LightmapAtlas
+{
+public:
+	// after the terrain heights
+	static const int TEXTURE_UNIT = 9;
+
+	// constructor
+	LightmapAtlas();
+	// destructor
+	~LightmapAtlas();
+
+	// choose the parts of the scene that are baked, leaving
+	// out the group that is moved as a whole, lay out their
+	// charts and hash what lights them
+	void Prepare(const SceneFile* pSceneFile, const char* movingGroupName);
+	// read the texels from the baked file, false when it is
+	// missing or was baked for another scene
+	bool Load(const std::string& filename);
+	// trace the texels of the charts on the given threads, 0
+	// for one per hardware thread
+	void Bake(const SceneFile* pSceneFile, int threadCount);
+	// write the texels into the baked file
+	bool Save(const std::string& filename) const;
+	// load the baked file of the scene, or bake and save it
+	// when it is out of date
+	void LoadOrBake(const SceneFile* pSceneFile, const std::string& filename, int threadCount);
+	// name of the baked file of a scene file
+	static std::string GetCacheFilename(const std::string& sceneFilename);
+
+	// upload the texels into the texture and free them
+	void CreateTexture();
+	GLuint GetTexture() const { return m_texture; }
+
+	// true when the part is drawn with the lightmap
+	bool IsLightmapped(uint32_t part) const { return (part < m_partCharts.size()) && (m_partCharts[part] >= 0); }
+	// texture coordinate of the atlas for a vertex of the
+	// triangles ShapeGeometry builds for the mesh of a part
+	bool GetAtlasCoordinate(uint32_t part, MESH_TYPE mesh, const MESH_VERTEX& vertex, float atlasUV[2]) const;
+
+	uint64_t GetSceneHash() const { return m_sceneHash; }
+	int GetWidth() const { return (int)m_width; }
+	int GetHeight() const { return (int)m_height; }
+	int GetChartCount() const { return (int)m_charts.size(); }
+	int GetLightmappedPartCount() const { return m_lightmappedPartCount; }
+	// true when the texels were baked rather than loaded
+	bool WasBaked() const { return m_bBaked; }
+
+private:
+	// what the bake needs of a covered texel
+	struct TEXEL_SURFACE
+	{
+		glm::vec3 position;
+		// the mesh normal the shaders light with, and the normal
+		// of the surface in the world the rays leave along
+		glm::vec3 shadingNormal;
+		glm::vec3 surfaceNormal;
+		int part;
+	};
+
+	std::vector<LIGHTMAP_CHART> m_charts;
+	// first chart of each part, -1 when it is not baked
+	std::vector<int> m_partCharts;
+	// parts whose triangles shade the baked texels
+	std::vector<char> m_occluderParts;
+	int m_lightmappedPartCount;
+	uint64_t m_sceneHash;
+	uint32_t m_width;
+	uint32_t m_height;
+	// RGBA half floats
+	std::vector<uint16_t> m_texels;
+	GLuint m_texture;
+	bool m_bBaked;
+	// triangles of the basic shape meshes
+	std::vector<MESH_VERTEX> m_shapes[MESH_TYPE_COUNT];
+
+	// side of a shape a vertex lies on
+	static int GetChart(MESH_TYPE mesh, const glm::vec3& normal);
+	static int GetChartCount(MESH_TYPE mesh);
+	// true when the part shades others, and when it is baked
+	static bool IsStaticPart(const SceneFile* pSceneFile, const SCENE_PART_RECORD& part, const char* movingGroupName);
+	static bool CanLightmap(const SceneFile* pSceneFile, const SCENE_PART_RECORD& part);
+	// size the charts for a number of texels per unit and pack
+	// them into rows of the atlas, false when they do not fit
+	// in the largest atlas
+	bool PackCharts(const std::vector<glm::vec2>& chartSizes, float texelsPerUnit);
+	// find the surface under each texel of the charts
+	void RasterizeCharts(const SceneFile* pSceneFile, std::vector<TEXEL_SURFACE>& surfaces, std::vector<char>& covered) const;
+	// light of one texel
+	glm::vec4 BakeTexel(
+		const SceneFile* pSceneFile,
+		const TriangleBVH& bvh,
+		const TEXEL_SURFACE& surface,
+		uint32_t texelIndex) const;
+	// spread the covered texels into the ones around them, so
+	// filtering at the chart edges reads no black texels
+	void DilateTexels(std::vector<glm::vec4>& texels, std::vector<char>& covered) const;
+};
@@ -13,6 +13,24 @@
 #include "ViewManager.h"
 #include "ShapeMeshes.h"
 #include "ShaderManager.h"
+#include "FrameStats.h"
+#include "FrameCapture.h"
+#include "FrameGraph.h"
+#include "TelemetryPlayback.h"
+#include "TelemetryIngest.h"
+#include "SwarmSimulation.h"
+#include "RedrawScheduler.h"
+#include "ResolutionScaler.h"
+#include "PerformanceHud.h"
+#include "FramePacer.h"
+#include "GLTrace.h"
+#include "GLTraceReplay.h"
+#include "ResourceTracker.h"
+#include "MeshCache.h"
+#include "TerrainFile.h"
+
+#include <string>
+#include <vector>
 
 // Namespace for declaring global variables
 namespace
@@ -29,12 +47,158 @@ namespace
 	ShaderManager* g_ShaderManager = nullptr;
 	// view manager object for managing the 3D view setup and projection to 2D
 	ViewManager* g_ViewManager = nullptr;
+	// frame statistics object for measuring the frame and pass timings
+	FrameStats* g_FrameStats = nullptr;
+	// frame capture object for recording the rendered frames
+	FrameCapture* g_FrameCapture = nullptr;
+	// frame graph object for ordering the passes of a frame
+	FrameGraph* g_FrameGraph = nullptr;
+	// telemetry playback object for replaying recorded flights
+	TelemetryPlayback* g_TelemetryPlayback = nullptr;
+	// telemetry ingest object for receiving live flights
+	TelemetryIngest* g_TelemetryIngest = nullptr;
+	// swarm simulation object for flying simulated drones
+	SwarmSimulation* g_SwarmSimulation = nullptr;
+	// redraw scheduler object for drawing only when something changed
+	RedrawScheduler* g_RedrawScheduler = nullptr;
+	// resolution scaler object for holding the frame time target
+	ResolutionScaler* g_ResolutionScaler = nullptr;
+	// frame pacer object for the frame rate cap and low latency
+	FramePacer* g_FramePacer = nullptr;
+	// performance overlay object for the statistics in the window
+	PerformanceHud* g_PerformanceHud = nullptr;
+
+	// command line options
+	// --headless            render in a hidden window
+	// --capture <folder>    record the frames into the folder
+	// --capture-format <f>  png (default) or yuv
+	// --frames <count>      close after rendering this many frames
+	// --scene <file>        load this scene instead of the default
+	// --telemetry <file>    replay the drone flights of the log
+	// --telemetry-speed <x> playback speed, 1 is real time
+	// --write-telemetry <file> <drones> <seconds>
+	//                       write a synthetic log and exit
+	// --ingest <name>       show the drones written to the shared
+	//                       memory ring of this name
+	// --telemetry-producer <name> <drones> <rate> <seconds>
+	//                       run the stand-in simulator and exit
+	// --swarm <drones>      fly this many simulated drones in a
+	//                       swarm that follows waypoints
+	// --swarm-threads <count>
+	//                       swarm simulation threads, 0 for one
+	//                       per hardware thread
+	// --swarm-benchmark <drones> <steps> <threads>
+	//                       time the swarm steps without drawing
+	//                       and exit
+	// --on-demand           draw a frame only when the view, the
+	//                       scene or the telemetry changed
+	// --max-latency <s>     longest time without a frame in the
+	//                       render on demand mode
+	// --dynamic-resolution <ms>
+	//                       scale the render resolution to hold
+	//                       this GPU time per frame
+	// --min-scale <x>       smallest fraction of the window size
+	// --vsync on|off        wait for the vertical blank on swap
+	// --fps <count>         cap the frame rate
+	// --max-frames-in-flight <count>
+	//                       frames the CPU may run ahead of the
+	//                       GPU, 1 for the lowest latency
+	// --views single|quad   one camera, or the main, chase, map
+	//                       and drone cameras in four quarters
+	// --multiview on|off    draw the views in one pass when the
+	//                       OpenGL context supports it
+	// --static-batching on|off
+	//                       merge the parts that never move apart
+	//                       into one draw per group and state
+	// --lightmaps on|off    draw the static batches with light
+	//                       baked next to the scene file
+	// --hud on|off          show the performance overlay, H
+	//                       toggles it
+	// --renderer gl|software
+	//                       draw the scene with OpenGL or with
+	//                       the CPU rasterizer
+	// --verify-software <tolerance>
+	//                       draw every frame on the CPU too and
+	//                       fail when the mean color error is
+	//                       above the tolerance, shadows are off
+	// --verify-shadows      draw the shadow maps from scratch too
+	//                       and fail when the cached ones differ
+	// --raster-threads <count>
+	//                       CPU rasterizer threads, 0 for one per
+	//                       hardware thread
+	// --gl-trace <file>     record the OpenGL calls of the frames
+	// --gl-replay <file> <loops>
+	//                       replay a recorded trace on the CPU
+	//                       alone, print its cost and exit
+	// --check-allocations <frames>
+	//                       report every frame after the first
+	//                       frames that allocates from the heap,
+	//                       and fail the run if any did
+	// --memory-budget <category> <megabytes>
+	//                       warn when the GPU or host memory of a
+	//                       category goes over, may be repeated
+	// --memory-report       list the live resources at the end
+	// --hot-reload          reload the shaders, textures and
+	//                       scene file when their files change
+	// --cook-model <file> <threads>
+	//                       import an OBJ or glTF file into its
+	//                       cooked mesh file and exit, 0 threads
+	//                       for one per hardware thread
+	// --terrain <file>      stream the terrain of a cooked terrain
+	//                       file in place of the floor
+	// --trails <samples>    draw a trail of this many samples
+	//                       behind each drone
+	// --write-terrain <file> <samples> <spacing>
+	//                       cook synthetic hills of this many
+	//                       samples per side and exit
+	// --cook-terrain <raw file> <width> <height> <spacing> <range> <file>
+	//                       cook a raw 16 bit heightmap whose
+	//                       samples span the height range and exit
+	// --bake-lightmaps <scene file> <threads>
+	//                       bake the lightmaps of a scene file and
+	//                       exit, 0 threads for one per hardware
+	//                       thread
+	bool g_bHeadless = false;
+	std::string g_captureFolder;
+	FrameCapture::CAPTURE_FORMAT g_captureFormat = FrameCapture::CAPTURE_PNG;
+	long g_maxFrames = 0;
+	std::string g_sceneFile;
+	std::string g_telemetryFile;
+	double g_telemetrySpeed = 1.0;
+	std::string g_ingestName;
+	int g_swarmDrones = 0;
+	int g_swarmThreads = 0;
+	bool g_bOnDemand = false;
+	double g_maxLatency = 1.0;
+	double g_dynamicResolutionMs = 0.0;
+	float g_minResolutionScale = 0.5f;
+	// -1 leaves the swap interval to the driver
+	int g_vsync = -1;
+	double g_targetFps = 0.0;
+	int g_maxFramesInFlight = 0;
+	VIEW_LAYOUT g_viewLayout = VIEW_LAYOUT_SINGLE;
+	bool g_bMultiview = true;
+	bool g_bStaticBatching = true;
+	bool g_bLightmaps = true;
+	bool g_bHud = false;
+	SceneManager::RENDER_BACKEND g_renderBackend = SceneManager::RENDER_BACKEND_OPENGL;
+	// negative when the frames are not verified
+	float g_verifyTolerance = -1.0f;
+	bool g_bVerifyShadows = false;
+	int g_rasterThreads = 0;
+	std::string g_glTraceFile;
+	long g_allocationWarmup = -1;
+	bool g_bMemoryReport = false;
+	bool g_bHotReload = false;
+	std::string g_terrainFile;
+	int g_trailSamples = 0;
 }
 
 // Function declarations - all functions that are called manually
 // need to be pre-declared at the beginning of the source code.
 bool InitializeGLFW();
 bool InitializeGLEW();
+bool ParseCommandLine(int argc, char* argv[]);
 
 
 /***********************************************************
@@ -45,6 +209,12 @@ bool InitializeGLEW();
  ***********************************************************/
 int main(int argc, char* argv[])
 {
+	// read the headless and capture options
+	if (ParseCommandLine(argc, argv) == false)
+	{
+		return(EXIT_FAILURE);
+	}
+
 	// if GLFW fails initialization, then terminate the application
 	if (InitializeGLFW() == false)
 	{
@@ -67,6 +237,19 @@ int main(int argc, char* argv[])
 		}
 		});
 
+	// the window contents are lost or the window was resized, so
+	// the render on demand mode has to draw again
+	glfwSetWindowRefreshCallback(g_Window, [](GLFWwindow* window) {
+		if (g_RedrawScheduler) {
+			g_RedrawScheduler->MarkDirty(RedrawScheduler::REDRAW_WINDOW);
+		}
+		});
+	glfwSetFramebufferSizeCallback(g_Window, [](GLFWwindow* window, int width, int height) {
+		if (g_RedrawScheduler) {
+			g_RedrawScheduler->MarkDirty(RedrawScheduler::REDRAW_WINDOW);
+		}
+		});
+
 	// if GLEW fails initialization, then terminate the application
 	if (InitializeGLEW() == false)
 	{
@@ -77,45 +260,468 @@ int main(int argc, char* argv[])
 	g_ShaderManager->LoadShaders(
 		"vertexShader.glsl",
 		"fragmentShader.glsl");
+	ResourceTracker::TrackProgram(g_ShaderManager->m_programID, "scene", "fragmentShader.glsl");
 	g_ShaderManager->use();
 
 	// try to create a new scene manager object and prepare the 3D scene
 	g_SceneManager = new SceneManager(g_ShaderManager);
+	if (!g_sceneFile.empty())
+	{
+		g_SceneManager->SetSceneFile(g_sceneFile);
+	}
+	if (!g_terrainFile.empty())
+	{
+		g_SceneManager->SetTerrainFile(g_terrainFile);
+	}
+	g_SceneManager->SetTrailLength(g_trailSamples);
+	g_SceneManager->SetRenderBackend(g_renderBackend, g_rasterThreads);
+	if (g_verifyTolerance >= 0.0f)
+	{
+		// the CPU rasterizer draws no shadows to compare with
+		g_SceneManager->SetSoftwareVerification(g_verifyTolerance, g_rasterThreads);
+		g_SceneManager->SetShadowsEnabled(false);
+	}
+	g_SceneManager->SetShadowVerification(g_bVerifyShadows);
+	if (g_bHotReload)
+	{
+		g_SceneManager->EnableHotReload("vertexShader.glsl", "fragmentShader.glsl");
+	}
+	g_SceneManager->SetStaticBatchingEnabled(g_bStaticBatching);
+	g_SceneManager->SetLightmapsEnabled(g_bLightmaps);
 	g_SceneManager->PrepareScene();
+	g_SceneManager->SetMultiviewEnabled(g_bMultiview);
+	g_ViewManager->SetViewLayout(g_viewLayout);
+	g_ViewManager->SetHudVisible(g_bHud);
 
-	// loop will keep running until the application is closed 
-	// or until an error has occurred
-	while (!glfwWindowShouldClose(g_Window))
+	// replay the recorded flights when a telemetry log was given
+	if (!g_telemetryFile.empty())
 	{
+		g_TelemetryPlayback = new TelemetryPlayback();
+		if (g_TelemetryPlayback->Open(g_telemetryFile))
+		{
+			g_TelemetryPlayback->SetSpeed(g_telemetrySpeed);
+			g_SceneManager->SetTelemetryPlayback(g_TelemetryPlayback);
+		}
+	}
+
+	// receive the live flights when a ring name was given
+	if (!g_ingestName.empty())
+	{
+		g_TelemetryIngest = new TelemetryIngest();
+		if (g_TelemetryIngest->Create(g_ingestName))
+		{
+			g_SceneManager->SetTelemetryIngest(g_TelemetryIngest);
+		}
+	}
+
+	// simulate a swarm when a drone count was given
+	if (g_swarmDrones > 0)
+	{
+		g_SwarmSimulation = new SwarmSimulation();
+		if (g_SwarmSimulation->Initialize(g_swarmDrones, g_swarmThreads))
+		{
+			g_SceneManager->SetSwarmSimulation(g_SwarmSimulation);
+		}
+		else
+		{
+			delete g_SwarmSimulation;
+			g_SwarmSimulation = NULL;
+		}
+	}
+
+	// create the frame statistics object for the timing report
+	g_FrameStats = new FrameStats();
+	g_FrameStats->Initialize();
+	g_SceneManager->SetFrameStats(g_FrameStats);
+	int swarmSectionID = (NULL != g_SwarmSimulation) ? g_FrameStats->RegisterSection("swarm") : -1;
+
+	// scale the render resolution to hold the frame time target
+	if (g_dynamicResolutionMs > 0.0)
+	{
+		g_ResolutionScaler = new ResolutionScaler();
+		g_ResolutionScaler->SetTargetFrameMs(g_dynamicResolutionMs);
+		g_ResolutionScaler->SetScaleRange(g_minResolutionScale, 1.0f);
+		if (!g_ResolutionScaler->Initialize(g_FrameStats))
+		{
+			delete g_ResolutionScaler;
+			g_ResolutionScaler = NULL;
+		}
+	}
+
+	// build the overlay even when hidden, so H can show it
+	g_PerformanceHud = new PerformanceHud();
+	if (!g_PerformanceHud->Initialize(g_FrameStats))
+	{
+		delete g_PerformanceHud;
+		g_PerformanceHud = NULL;
+	}
+
+	// start recording the frames when a capture folder was given
+	if (!g_captureFolder.empty())
+	{
+		g_FrameCapture = new FrameCapture();
+		g_FrameCapture->Initialize(g_captureFolder, g_captureFormat);
+	}
+	// sleep between changes instead of drawing every frame
+	if (g_bOnDemand)
+	{
+		g_RedrawScheduler = new RedrawScheduler();
+		g_RedrawScheduler->SetMaxLatency(g_maxLatency);
+		// the producers cannot wake the event wait, so the ring
+		// is checked at the display rate
+		if (NULL != g_TelemetryIngest)
+		{
+			g_RedrawScheduler->SetPollInterval(1.0 / 60.0);
+		}
+	}
+	// pace the frames when any of the pacing options was given
+	if ((g_vsync >= 0) || (g_targetFps > 0.0) || (g_maxFramesInFlight > 0))
+	{
+		g_FramePacer = new FramePacer();
+		if (g_vsync >= 0)
+		{
+			g_FramePacer->SetVsync(g_vsync == 1);
+		}
+		g_FramePacer->SetTargetFps(g_targetFps);
+		g_FramePacer->SetMaxFramesInFlight(g_maxFramesInFlight);
+	}
+	// record the calls from the first frame, the scene setup
+	// before it is not part of the trace
+	if (!g_glTraceFile.empty())
+	{
+		GLTrace::BeginCapture(g_glTraceFile);
+	}
+	long frameCount = 0;
+	bool bAllocationsFailed = false;
+	double lastFrameTime = glfwGetTime();
+	double lastSwarmTime = lastFrameTime;
+	std::vector<RENDER_VIEW> renderViews;
+	int windowWidth = 0;
+	int windowHeight = 0;
+
+	// the passes of a frame, drawing the scene into the window
+	// or into a target that is upscaled into the window, and
+	// reading back the finished frame
+	g_FrameGraph = new FrameGraph();
+	g_FrameGraph->SetFrameStats(g_FrameStats);
+	int backbuffer = g_FrameGraph->ImportBackbuffer("window");
+	int sceneColor = backbuffer;
+	int sceneDepth = -1;
+	if (NULL != g_ResolutionScaler)
+	{
+		FRAME_TEXTURE_DESC desc;
+		desc.scale = g_ResolutionScaler->GetMaxScale();
+		desc.internalFormat = GL_RGBA8;
+		sceneColor = g_FrameGraph->CreateTexture("scene color", desc);
+		desc.internalFormat = GL_DEPTH_COMPONENT24;
+		sceneDepth = g_FrameGraph->CreateTexture("scene depth", desc);
+	}
+
+	int scenePass = g_FrameGraph->AddPass("scene", [&](const FrameGraph& graph)
+	{
+		// render at the dynamic resolution, or straight into the
+		// window at its current size
+		bool bScaled = false;
+		if (sceneColor != backbuffer)
+		{
+			bScaled = g_ResolutionScaler->BeginScene(windowWidth, windowHeight,
+				graph.GetTextureWidth(sceneColor), graph.GetTextureHeight(sceneColor));
+		}
+		if (!bScaled)
+		{
+			GLTrace::Viewport(0, 0, windowWidth, windowHeight);
+		}
+
 		// Enable z-depth
-		glEnable(GL_DEPTH_TEST);
+		GLTrace::Enable(GL_DEPTH_TEST);
 
 		// Clear the frame and z buffers
 		// Set the background to green (R, G, B, A)
-		glClearColor(0.2f, 0.6f, 0.2f, 1.0f);  // Light green background
+		GLTrace::ClearColor(0.2f, 0.6f, 0.2f, 1.0f);  // Light green background
 
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		GLTrace::Clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 		// convert from 3D object space to 2D view
 		g_ViewManager->PrepareSceneView();
+		g_SceneManager->SetViewTransform(
+			g_ViewManager->GetViewMatrix(),
+			g_ViewManager->GetProjectionMatrix());
+
+		// move the replayed drones to their poses for this frame
+		double frameTime = glfwGetTime();
+		if (NULL != g_TelemetryPlayback)
+		{
+			g_TelemetryPlayback->Update(frameTime - lastFrameTime);
+		}
+		lastFrameTime = frameTime;
+
+		// split the window between the views of the layout, the
+		// drone cameras follow the first drone
+		if (VIEW_LAYOUT_SINGLE != g_viewLayout)
+		{
+			g_ViewManager->GetRenderViews(g_SceneManager->GetDroneTransform(0), renderViews);
+			g_SceneManager->SetRenderViews(renderViews);
+		}
+
+		// spin the rotors and other animated parts
+		g_SceneManager->SetAnimationTime(frameTime);
 
 		// refresh the 3D scene
 		g_SceneManager->RenderScene();
+	});
+	g_FrameGraph->Write(scenePass, sceneColor);
+	if (sceneDepth >= 0)
+	{
+		g_FrameGraph->Write(scenePass, sceneDepth);
+
+		// present the scene in the window
+		int upscalePass = g_FrameGraph->AddPass("upscale", [&](const FrameGraph& graph)
+		{
+			g_ResolutionScaler->EndScene(graph.GetTexture(sceneColor));
+		});
+		g_FrameGraph->Read(upscalePass, sceneColor);
+		g_FrameGraph->Write(upscalePass, backbuffer);
+	}
+
+	// draw the overlay over the finished frame, so the capture
+	// records it
+	if (NULL != g_PerformanceHud)
+	{
+		int hudPass = g_FrameGraph->AddPass("hud", [&](const FrameGraph&)
+		{
+			g_PerformanceHud->Update();
+			if (g_ViewManager->IsHudVisible())
+			{
+				g_PerformanceHud->Draw(windowWidth, windowHeight, g_SceneManager, g_ViewManager->IsOrthographic());
+			}
+		});
+		g_FrameGraph->Write(hudPass, backbuffer);
+	}
+
+	// queue the readback of the finished frame
+	if (NULL != g_FrameCapture)
+	{
+		int capturePass = g_FrameGraph->AddPass("capture", [&](const FrameGraph&)
+		{
+			g_FrameCapture->CaptureFrame(windowWidth, windowHeight);
+		});
+		g_FrameGraph->Read(capturePass, backbuffer);
+		g_FrameGraph->SetSideEffect(capturePass);
+	}
+
+	// loop will keep running until the application is closed 
+	// or until an error has occurred
+	while (!glfwWindowShouldClose(g_Window))
+	{
+		// wait for the frame to be due, then read the freshest
+		// input for it
+		if (NULL != g_FramePacer)
+		{
+			g_FramePacer->WaitForFrameStart();
+		}
+		if (NULL != g_RedrawScheduler)
+		{
+			g_RedrawScheduler->WaitForEvents();
+		}
+		else if (NULL != g_FramePacer)
+		{
+			glfwPollEvents();
+		}
+
+		// move the camera from the held keys
+		g_ViewManager->ProcessInput();
+
+		// read the live drone updates that arrived
+		bool bTelemetryChanged = false;
+		if (NULL != g_TelemetryIngest)
+		{
+			bTelemetryChanged = g_TelemetryIngest->Poll();
+		}
+
+		// skip the frame when it would look like the last one
+		if (NULL != g_RedrawScheduler)
+		{
+			if (g_ViewManager->HasViewChanged())
+			{
+				g_RedrawScheduler->MarkDirty(RedrawScheduler::REDRAW_VIEW);
+			}
+			if (g_SceneManager->NeedsRedraw())
+			{
+				g_RedrawScheduler->MarkDirty(RedrawScheduler::REDRAW_SCENE);
+			}
+			if (bTelemetryChanged || (NULL != g_SwarmSimulation) ||
+				((NULL != g_TelemetryPlayback) && !g_TelemetryPlayback->IsPaused()))
+			{
+				g_RedrawScheduler->MarkDirty(RedrawScheduler::REDRAW_TELEMETRY);
+			}
+			if (!g_RedrawScheduler->ShouldRender())
+			{
+				continue;
+			}
+		}
+
+		// there is nothing to draw into while minimized
+		glfwGetFramebufferSize(g_Window, &windowWidth, &windowHeight);
+		if ((windowWidth <= 0) || (windowHeight <= 0))
+		{
+			glfwWaitEvents();
+			continue;
+		}
+
+		// the targets follow the window size
+		if (g_FrameGraph->NeedsCompile(windowWidth, windowHeight) &&
+			!g_FrameGraph->Compile(windowWidth, windowHeight))
+		{
+			break;
+		}
+
+		g_FrameStats->BeginFrame();
+
+		// fly the simulated drones to their poses for this frame
+		if (NULL != g_SwarmSimulation)
+		{
+			double swarmTime = glfwGetTime();
+			g_FrameStats->BeginSection(swarmSectionID);
+			g_SwarmSimulation->Update(swarmTime - lastSwarmTime);
+			g_FrameStats->EndSection(swarmSectionID);
+			lastSwarmTime = swarmTime;
+		}
 
+		g_FrameGraph->Execute();
+
+		g_FrameStats->EndFrame();
+		GLTrace::EndFrame();
+
+		// once warmed up, the frames must not touch the heap
+		if ((g_allocationWarmup >= 0) && (frameCount >= g_allocationWarmup) &&
+			(g_FrameStats->GetFrameAllocations() > 0))
+		{
+			std::cout << "ALLOCATIONS: frame " << frameCount << " made "
+				<< g_FrameStats->GetFrameAllocations() << " heap allocations" << std::endl;
+			bAllocationsFailed = true;
+		}
 
 		// Flips the the back buffer with the front buffer every frame.
 		glfwSwapBuffers(g_Window);
 
-		// query the latest GLFW events
-		glfwPollEvents();
+		if (NULL != g_FramePacer)
+		{
+			g_FramePacer->FramePresented();
+		}
+		if (NULL != g_RedrawScheduler)
+		{
+			// wait for the frame so the latency covers the GPU work
+			glFinish();
+			g_RedrawScheduler->FramePresented();
+		}
+		else if (NULL == g_FramePacer)
+		{
+			// query the latest GLFW events
+			glfwPollEvents();
+		}
+
+		// stop after the requested number of frames
+		frameCount++;
+		if ((g_maxFrames > 0) && (frameCount >= g_maxFrames))
+		{
+			glfwSetWindowShouldClose(g_Window, GLFW_TRUE);
+		}
+	}
+
+	// write out the frames still being captured
+	GLTrace::EndCapture();
+	if (g_bMemoryReport)
+	{
+		std::cout << "MEMORY REPORT:" << std::endl;
+		ResourceTracker::Dump(std::cout);
+	}
+	if (NULL != g_FramePacer)
+	{
+		delete g_FramePacer;
+		g_FramePacer = NULL;
+	}
+	if (NULL != g_PerformanceHud)
+	{
+		delete g_PerformanceHud;
+		g_PerformanceHud = NULL;
+	}
+	if (NULL != g_FrameGraph)
+	{
+		delete g_FrameGraph;
+		g_FrameGraph = NULL;
+	}
+	if (NULL != g_ResolutionScaler)
+	{
+		delete g_ResolutionScaler;
+		g_ResolutionScaler = NULL;
+	}
+	if (NULL != g_RedrawScheduler)
+	{
+		delete g_RedrawScheduler;
+		g_RedrawScheduler = NULL;
+	}
+	if (NULL != g_FrameCapture)
+	{
+		delete g_FrameCapture;
+		g_FrameCapture = NULL;
 	}
 
 	// clear the allocated manager objects from memory
+	bool bVerificationFailed = false;
+	bool bShadowVerificationFailed = false;
 	if (NULL != g_SceneManager)
 	{
+		bVerificationFailed = g_SceneManager->HasVerificationFailed();
+		bShadowVerificationFailed = g_SceneManager->HasShadowVerificationFailed();
+		const TerrainClipmap* pTerrain = g_SceneManager->GetTerrainClipmap();
+		if (NULL != pTerrain)
+		{
+			const TerrainTileCache& tileCache = pTerrain->GetTileCache();
+			std::cout << "TERRAIN: levels " << pTerrain->GetLevelCount()
+				<< " level updates " << pTerrain->GetLevelUpdateCount()
+				<< " triangles " << pTerrain->GetLastTriangleCount()
+				<< " tiles loaded " << tileCache.GetLoadCount()
+				<< " evicted " << tileCache.GetEvictionCount()
+				<< " resident " << tileCache.GetResidentCount() << " of " << tileCache.GetSlotCount() << std::endl;
+		}
+		const TrailRenderer* pTrails = g_SceneManager->GetTrailRenderer();
+		if (NULL != pTrails)
+		{
+			std::cout << "TRAILS: drones " << pTrails->GetDroneCount()
+				<< " samples " << pTrails->GetSampleCount()
+				<< " ring " << pTrails->GetRingBytes() / (1024 * 1024) << " MB"
+				<< " rows " << pTrails->GetRowCount()
+				<< " uploaded " << pTrails->GetUploadBytes() / 1024 << " KB"
+				<< " segments " << pTrails->GetLastSegmentCount() << std::endl;
+		}
 		delete g_SceneManager;
 		g_SceneManager = NULL;
 	}
+	if (NULL != g_TelemetryPlayback)
+	{
+		delete g_TelemetryPlayback;
+		g_TelemetryPlayback = NULL;
+	}
+	if (NULL != g_TelemetryIngest)
+	{
+		delete g_TelemetryIngest;
+		g_TelemetryIngest = NULL;
+	}
+	if (NULL != g_SwarmSimulation)
+	{
+		std::cout << "SWARM: drones " << g_SwarmSimulation->GetDroneCount()
+			<< " steps " << g_SwarmSimulation->GetStepCount()
+			<< " step " << g_SwarmSimulation->GetStepMs() << " ms"
+			<< " threads " << g_SwarmSimulation->GetThreadCount()
+			<< " state " << std::hex << g_SwarmSimulation->GetStateHash() << std::dec << std::endl;
+		delete g_SwarmSimulation;
+		g_SwarmSimulation = NULL;
+	}
+	if (NULL != g_FrameStats)
+	{
+		delete g_FrameStats;
+		g_FrameStats = NULL;
+	}
 	if (NULL != g_ViewManager)
 	{
 		delete g_ViewManager;
@@ -123,10 +729,31 @@ int main(int argc, char* argv[])
 	}
 	if (NULL != g_ShaderManager)
 	{
+		ResourceTracker::Release(RESOURCE_PROGRAM, g_ShaderManager->m_programID);
 		delete g_ShaderManager;
 		g_ShaderManager = NULL;
 	}
 
+	// every owner is gone, what is still tracked was not freed
+	ResourceTracker::ReportLeaks();
+
+	// a frame the CPU rasterizer did not match fails the run
+	if (bVerificationFailed)
+	{
+		std::cerr << "The software rasterizer frames differ from the OpenGL frames" << std::endl;
+		exit(EXIT_FAILURE);
+	}
+	if (bShadowVerificationFailed)
+	{
+		std::cerr << "The cached shadow maps differ from the redrawn ones" << std::endl;
+		exit(EXIT_FAILURE);
+	}
+	if (bAllocationsFailed)
+	{
+		std::cerr << "Frames allocated from the heap after the warmup" << std::endl;
+		exit(EXIT_FAILURE);
+	}
+
 	// Terminates the program successfully
 	exit(EXIT_SUCCESS); 
 }
@@ -153,6 +780,12 @@ bool InitializeGLFW()
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 #endif
+	// the window still has a default framebuffer to render and
+	// read back from when it is not shown
+	if (g_bHeadless)
+	{
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	}
 	// GLFW: end -------------------------------
 
 	return(true);
@@ -183,4 +816,310 @@ bool InitializeGLEW()
 	std::cout << "INFO: OpenGL Version: " << glGetString(GL_VERSION) << "\n" << std::endl;
 
 	return(true);
-}
\ No newline at end of file
+}
+
+/***********************************************************
+ *	ParseCommandLine()
+ *
+ *  This function is used to read the command line options
+ *  for headless rendering and frame capture.
+ ***********************************************************/
+bool ParseCommandLine(int argc, char* argv[])
+{
+	for (int i = 1; i < argc; i++)
+	{
+		std::string option = argv[i];
+		bool bHasValue = (i + 1 < argc);
+
+		if (option == "--headless")
+		{
+			g_bHeadless = true;
+		}
+		else if ((option == "--capture") && bHasValue)
+		{
+			g_captureFolder = argv[++i];
+		}
+		else if ((option == "--capture-format") && bHasValue)
+		{
+			std::string format = argv[++i];
+			if (format == "yuv")
+				g_captureFormat = FrameCapture::CAPTURE_YUV;
+			else if (format == "png")
+				g_captureFormat = FrameCapture::CAPTURE_PNG;
+			else
+			{
+				std::cerr << "Unknown capture format: " << format << std::endl;
+				return false;
+			}
+		}
+		else if ((option == "--frames") && bHasValue)
+		{
+			g_maxFrames = std::atol(argv[++i]);
+		}
+		else if ((option == "--scene") && bHasValue)
+		{
+			g_sceneFile = argv[++i];
+		}
+		else if ((option == "--telemetry") && bHasValue)
+		{
+			g_telemetryFile = argv[++i];
+		}
+		else if ((option == "--telemetry-speed") && bHasValue)
+		{
+			g_telemetrySpeed = std::atof(argv[++i]);
+		}
+		else if ((option == "--write-telemetry") && (i + 3 < argc))
+		{
+			std::string filename = argv[i + 1];
+			int droneCount = std::atoi(argv[i + 2]);
+			double duration = std::atof(argv[i + 3]);
+			exit(TelemetryPlayback::WriteSyntheticLog(filename, droneCount, duration) ? EXIT_SUCCESS : EXIT_FAILURE);
+		}
+		else if ((option == "--ingest") && bHasValue)
+		{
+			g_ingestName = argv[++i];
+		}
+		else if ((option == "--telemetry-producer") && (i + 4 < argc))
+		{
+			std::string name = argv[i + 1];
+			int droneCount = std::atoi(argv[i + 2]);
+			double rate = std::atof(argv[i + 3]);
+			double duration = std::atof(argv[i + 4]);
+			exit(TelemetryIngest::RunProducer(name, droneCount, rate, duration) ? EXIT_SUCCESS : EXIT_FAILURE);
+		}
+		else if ((option == "--swarm") && bHasValue)
+		{
+			g_swarmDrones = std::atoi(argv[++i]);
+		}
+		else if ((option == "--swarm-threads") && bHasValue)
+		{
+			g_swarmThreads = std::atoi(argv[++i]);
+		}
+		else if ((option == "--swarm-benchmark") && (i + 3 < argc))
+		{
+			int droneCount = std::atoi(argv[i + 1]);
+			int stepCount = std::atoi(argv[i + 2]);
+			int threadCount = std::atoi(argv[i + 3]);
+			exit(SwarmSimulation::RunBenchmark(droneCount, stepCount, threadCount) ? EXIT_SUCCESS : EXIT_FAILURE);
+		}
+		else if (option == "--on-demand")
+		{
+			g_bOnDemand = true;
+		}
+		else if ((option == "--max-latency") && bHasValue)
+		{
+			g_maxLatency = std::atof(argv[++i]);
+		}
+		else if ((option == "--dynamic-resolution") && bHasValue)
+		{
+			g_dynamicResolutionMs = std::atof(argv[++i]);
+		}
+		else if ((option == "--min-scale") && bHasValue)
+		{
+			g_minResolutionScale = (float)std::atof(argv[++i]);
+		}
+		else if ((option == "--vsync") && bHasValue)
+		{
+			std::string mode = argv[++i];
+			if (mode == "on")
+				g_vsync = 1;
+			else if (mode == "off")
+				g_vsync = 0;
+			else
+			{
+				std::cerr << "Unknown vsync mode: " << mode << std::endl;
+				return false;
+			}
+		}
+		else if ((option == "--fps") && bHasValue)
+		{
+			g_targetFps = std::atof(argv[++i]);
+		}
+		else if ((option == "--max-frames-in-flight") && bHasValue)
+		{
+			g_maxFramesInFlight = std::atoi(argv[++i]);
+		}
+		else if ((option == "--views") && bHasValue)
+		{
+			std::string layout = argv[++i];
+			if (layout == "single")
+				g_viewLayout = VIEW_LAYOUT_SINGLE;
+			else if (layout == "quad")
+				g_viewLayout = VIEW_LAYOUT_QUAD;
+			else
+			{
+				std::cerr << "Unknown view layout: " << layout << std::endl;
+				return false;
+			}
+		}
+		else if ((option == "--multiview") && bHasValue)
+		{
+			std::string mode = argv[++i];
+			if (mode == "on")
+				g_bMultiview = true;
+			else if (mode == "off")
+				g_bMultiview = false;
+			else
+			{
+				std::cerr << "Unknown multiview mode: " << mode << std::endl;
+				return false;
+			}
+		}
+		else if ((option == "--static-batching") && bHasValue)
+		{
+			std::string mode = argv[++i];
+			if (mode == "on")
+				g_bStaticBatching = true;
+			else if (mode == "off")
+				g_bStaticBatching = false;
+			else
+			{
+				std::cerr << "Unknown static batching mode: " << mode << std::endl;
+				return false;
+			}
+		}
+		else if ((option == "--hud") && bHasValue)
+		{
+			std::string mode = argv[++i];
+			if (mode == "on")
+				g_bHud = true;
+			else if (mode == "off")
+				g_bHud = false;
+			else
+			{
+				std::cerr << "Unknown hud mode: " << mode << std::endl;
+				return false;
+			}
+		}
+		else if ((option == "--lightmaps") && bHasValue)
+		{
+			std::string mode = argv[++i];
+			if (mode == "on")
+				g_bLightmaps = true;
+			else if (mode == "off")
+				g_bLightmaps = false;
+			else
+			{
+				std::cerr << "Unknown lightmaps mode: " << mode << std::endl;
+				return false;
+			}
+		}
+		else if ((option == "--renderer") && bHasValue)
+		{
+			std::string renderer = argv[++i];
+			if (renderer == "gl")
+				g_renderBackend = SceneManager::RENDER_BACKEND_OPENGL;
+			else if (renderer == "software")
+				g_renderBackend = SceneManager::RENDER_BACKEND_SOFTWARE;
+			else
+			{
+				std::cerr << "Unknown renderer: " << renderer << std::endl;
+				return false;
+			}
+		}
+		else if ((option == "--verify-software") && bHasValue)
+		{
+			g_verifyTolerance = (float)std::atof(argv[++i]);
+		}
+		else if ((option == "--raster-threads") && bHasValue)
+		{
+			g_rasterThreads = std::atoi(argv[++i]);
+		}
+		else if ((option == "--gl-trace") && bHasValue)
+		{
+			g_glTraceFile = argv[++i];
+		}
+		else if ((option == "--gl-replay") && (i + 2 < argc))
+		{
+			std::string filename = argv[i + 1];
+			int loops = std::atoi(argv[i + 2]);
+			exit(GLTraceReplay::Benchmark(filename, loops) ? EXIT_SUCCESS : EXIT_FAILURE);
+		}
+		else if ((option == "--check-allocations") && bHasValue)
+		{
+			g_allocationWarmup = std::atol(argv[++i]);
+		}
+		else if ((option == "--memory-budget") && (i + 2 < argc))
+		{
+			RESOURCE_CATEGORY category = RESOURCE_TEXTURE;
+			if (!ResourceTracker::FindCategory(argv[i + 1], category))
+			{
+				std::cerr << "Unknown memory category: " << argv[i + 1]
+					<< ", use texture, target, buffer, program, staging or raster" << std::endl;
+				return false;
+			}
+			ResourceTracker::SetBudget(category, (uint64_t)(std::atof(argv[i + 2]) * 1024.0 * 1024.0));
+			i += 2;
+		}
+		else if (option == "--memory-report")
+		{
+			g_bMemoryReport = true;
+		}
+		else if (option == "--verify-shadows")
+		{
+			g_bVerifyShadows = true;
+		}
+		else if (option == "--hot-reload")
+		{
+			g_bHotReload = true;
+		}
+		else if ((option == "--cook-model") && (i + 2 < argc))
+		{
+			std::string filename = argv[i + 1];
+			int threadCount = std::atoi(argv[i + 2]);
+			exit(MeshCache::Cook(filename, MeshCache::GetCacheFilename(filename), threadCount) ? EXIT_SUCCESS : EXIT_FAILURE);
+		}
+		else if ((option == "--terrain") && bHasValue)
+		{
+			g_terrainFile = argv[++i];
+		}
+		else if ((option == "--trails") && bHasValue)
+		{
+			g_trailSamples = std::atoi(argv[++i]);
+		}
+		else if ((option == "--write-terrain") && (i + 3 < argc))
+		{
+			std::string filename = argv[i + 1];
+			int sampleCount = std::atoi(argv[i + 2]);
+			float spacing = (float)std::atof(argv[i + 3]);
+			exit(TerrainFile::WriteSynthetic(filename, sampleCount, spacing) ? EXIT_SUCCESS : EXIT_FAILURE);
+		}
+		else if ((option == "--cook-terrain") && (i + 6 < argc))
+		{
+			std::string rawFilename = argv[i + 1];
+			int width = std::atoi(argv[i + 2]);
+			int height = std::atoi(argv[i + 3]);
+			float spacing = (float)std::atof(argv[i + 4]);
+			float heightRange = (float)std::atof(argv[i + 5]);
+			std::string filename = argv[i + 6];
+			exit(TerrainFile::CookRaw(rawFilename, width, height, spacing, heightRange, filename) ? EXIT_SUCCESS : EXIT_FAILURE);
+		}
+		else if ((option == "--bake-lightmaps") && (i + 2 < argc))
+		{
+			std::string filename = argv[i + 1];
+			int threadCount = std::atoi(argv[i + 2]);
+			exit(SceneManager::BakeLightmaps(filename, threadCount) ? EXIT_SUCCESS : EXIT_FAILURE);
+		}
+		else
+		{
+			std::cerr << "Unknown option: " << option << std::endl;
+			std::cerr << "Usage: " << argv[0]
+				<< " [--headless] [--capture <folder>] [--capture-format png|yuv] [--frames <count>] [--scene <file>]"
+				<< " [--telemetry <file>] [--telemetry-speed <x>] [--write-telemetry <file> <drones> <seconds>]"
+				<< " [--ingest <name>] [--telemetry-producer <name> <drones> <rate> <seconds>]"
+				<< " [--swarm <drones>] [--swarm-threads <count>] [--swarm-benchmark <drones> <steps> <threads>]"
+				<< " [--on-demand] [--max-latency <seconds>] [--dynamic-resolution <ms>] [--min-scale <x>]"
+				<< " [--vsync on|off] [--fps <count>] [--max-frames-in-flight <count>]"
+				<< " [--views single|quad] [--multiview on|off] [--static-batching on|off] [--lightmaps on|off] [--hud on|off]"
+				<< " [--renderer gl|software] [--verify-software <tolerance>] [--verify-shadows] [--raster-threads <count>]"
+				<< " [--gl-trace <file>] [--gl-replay <file> <loops>] [--check-allocations <frames>]"
+				<< " [--memory-budget <category> <megabytes>] [--memory-report] [--hot-reload]"
+				<< " [--cook-model <file> <threads>] [--terrain <file>] [--trails <samples>] [--write-terrain <file> <samples> <spacing>]"
+				<< " [--cook-terrain <raw file> <width> <height> <spacing> <range> <file>]"
+				<< " [--bake-lightmaps <scene file> <threads>]" << std::endl;
+			return false;
+		}
+	}
+
+	return(true);
+}
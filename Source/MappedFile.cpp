@@ -0,0 +1,202 @@
+///////////////////////////////////////////////////////////////////////////////
+// mappedfile.cpp
+// ============
+// map a file read-only into memory
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/***********************************************************
+ *  MappedFile()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+MappedFile::MappedFile()
+{
+	m_pView = NULL;
+	m_viewSize = 0;
+	m_pData = NULL;
+	m_size = 0;
+	m_fileSize = 0;
+#ifdef _WIN32
+	m_fileHandle = INVALID_HANDLE_VALUE;
+	m_mappingHandle = NULL;
+#endif
+}
+
+/***********************************************************
+ *  ~MappedFile()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+/***********************************************************
+ *  Open()
+ *
+ *  This method is used for mapping the whole file read-only.
+ *  Empty files cannot be mapped and are reported as errors.
+ ***********************************************************/
+bool MappedFile::Open(const std::string& filename)
+{
+	return(Open(filename, 0, 0));
+}
+
+/***********************************************************
+ *  Open()
+ *
+ *  This method is used for mapping a range of the file
+ *  read-only.  The range must lie inside the file.  Views
+ *  have to start on an allocation boundary, so the view
+ *  starts before the offset and the data pointer is moved
+ *  forward to it.
+ ***********************************************************/
+bool MappedFile::Open(const std::string& filename, unsigned long long offset, size_t size)
+{
+	Close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ,
+		NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return(false);
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize))
+	{
+		CloseHandle(file);
+		return(false);
+	}
+	unsigned long long totalSize = (unsigned long long)fileSize.QuadPart;
+	if (size == 0)
+	{
+		size = (offset < totalSize) ? (size_t)(totalSize - offset) : 0;
+	}
+	if ((size == 0) || (offset + size > totalSize))
+	{
+		CloseHandle(file);
+		return(false);
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping == NULL)
+	{
+		CloseHandle(file);
+		return(false);
+	}
+
+	SYSTEM_INFO systemInfo;
+	GetSystemInfo(&systemInfo);
+	unsigned long long viewOffset = offset - (offset % systemInfo.dwAllocationGranularity);
+	size_t viewSize = (size_t)(offset - viewOffset) + size;
+
+	void* pView = MapViewOfFile(mapping, FILE_MAP_READ,
+		(DWORD)(viewOffset >> 32), (DWORD)(viewOffset & 0xFFFFFFFFu), viewSize);
+	if (pView == NULL)
+	{
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return(false);
+	}
+
+	m_fileHandle = file;
+	m_mappingHandle = mapping;
+#else
+	int file = open(filename.c_str(), O_RDONLY);
+	if (file < 0)
+	{
+		return(false);
+	}
+
+	struct stat fileInfo;
+	if (fstat(file, &fileInfo) != 0)
+	{
+		close(file);
+		return(false);
+	}
+	unsigned long long totalSize = (unsigned long long)fileInfo.st_size;
+	if (size == 0)
+	{
+		size = (offset < totalSize) ? (size_t)(totalSize - offset) : 0;
+	}
+	if ((size == 0) || (offset + size > totalSize))
+	{
+		close(file);
+		return(false);
+	}
+
+	unsigned long long pageSize = (unsigned long long)sysconf(_SC_PAGESIZE);
+	unsigned long long viewOffset = offset - (offset % pageSize);
+	size_t viewSize = (size_t)(offset - viewOffset) + size;
+
+	void* pView = mmap(NULL, viewSize, PROT_READ, MAP_PRIVATE, file, (off_t)viewOffset);
+	// the mapping stays valid after the descriptor is closed
+	close(file);
+	if (pView == MAP_FAILED)
+	{
+		return(false);
+	}
+#endif
+
+	m_pView = pView;
+	m_viewSize = viewSize;
+	m_pData = (const unsigned char*)pView + (offset - viewOffset);
+	m_size = size;
+	m_fileSize = totalSize;
+
+	return(true);
+}
+
+/***********************************************************
+ *  Close()
+ *
+ *  This method is used for unmapping the file.  Pointers into
+ *  the mapped data are no longer valid afterwards.
+ ***********************************************************/
+void MappedFile::Close()
+{
+#ifdef _WIN32
+	if (NULL != m_pView)
+	{
+		UnmapViewOfFile(m_pView);
+	}
+	if (NULL != m_mappingHandle)
+	{
+		CloseHandle(m_mappingHandle);
+		m_mappingHandle = NULL;
+	}
+	if (INVALID_HANDLE_VALUE != m_fileHandle)
+	{
+		CloseHandle(m_fileHandle);
+		m_fileHandle = INVALID_HANDLE_VALUE;
+	}
+#else
+	if (NULL != m_pView)
+	{
+		munmap(m_pView, m_viewSize);
+	}
+#endif
+
+	m_pView = NULL;
+	m_viewSize = 0;
+	m_pData = NULL;
+	m_size = 0;
+	m_fileSize = 0;
+}
@@ -0,0 +1,58 @@
+///////////////////////////////////////////////////////////////////////////////
+// mappedfile.h
+// ============
+// map a file read-only into memory
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/***********************************************************
+ *  MappedFile
+ *
+ *  This class maps a file, or a range of it, read-only into
+ *  the address space of the process, so its contents can be
+ *  used in place without reading or copying them.  The
+ *  operating system pages the data in on first access.
+ *  Mapping ranges keeps files larger than the address space
+ *  usable.
+ ***********************************************************/
+class MappedFile
+{
+public:
+	// constructor
+	MappedFile();
+	// destructor
+	~MappedFile();
+
+	// map the file, replacing any file mapped before
+	bool Open(const std::string& filename);
+	// map size bytes starting at offset, 0 maps to the end
+	bool Open(const std::string& filename, unsigned long long offset, size_t size);
+	// unmap the file
+	void Close();
+
+	bool IsOpen() const { return m_pData != NULL; }
+	const unsigned char* GetData() const { return m_pData; }
+	size_t GetSize() const { return m_size; }
+	// size of the whole file, not only the mapped range
+	unsigned long long GetFileSize() const { return m_fileSize; }
+
+private:
+	// the view starts at an aligned offset at or before the data
+	void* m_pView;
+	size_t m_viewSize;
+	const unsigned char* m_pData;
+	size_t m_size;
+	unsigned long long m_fileSize;
+#ifdef _WIN32
+	void* m_fileHandle;
+	void* m_mappingHandle;
+#endif
+
+	// the mapping cannot be shared between two owners
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+};
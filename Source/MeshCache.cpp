@@ -0,0 +1,241 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshcache.cpp
+// ============
+// cook imported models into binary files that load by mapping
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MeshCache.h"
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+// declaration of global variables
+namespace
+{
+	// suffix of the cooked file next to the model file
+	const char* g_CacheExtension = ".meshbin";
+
+	/***********************************************************
+	 *  GetModifiedTime()
+	 *
+	 *  This function is used for getting the last write time
+	 *  of a file, or -1 when the file does not exist.
+	 ***********************************************************/
+	long long GetModifiedTime(const std::string& filename)
+	{
+#ifdef _WIN32
+		struct _stat fileInfo;
+		if (_stat(filename.c_str(), &fileInfo) != 0)
+			return(-1);
+#else
+		struct stat fileInfo;
+		if (stat(filename.c_str(), &fileInfo) != 0)
+			return(-1);
+#endif
+		return((long long)fileInfo.st_mtime);
+	}
+}
+
+/***********************************************************
+ *  MeshCache()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+MeshCache::MeshCache()
+{
+	m_pHeader = NULL;
+	m_pVertices = NULL;
+	m_pIndices = NULL;
+}
+
+/***********************************************************
+ *  ~MeshCache()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+MeshCache::~MeshCache()
+{
+	Close();
+}
+
+/***********************************************************
+ *  GetCacheFilename()
+ *
+ *  This method is used for getting the name of the cooked
+ *  file of a model file, which sits next to the model file.
+ ***********************************************************/
+std::string MeshCache::GetCacheFilename(const std::string& modelFilename)
+{
+	return(modelFilename + g_CacheExtension);
+}
+
+/***********************************************************
+ *  Load()
+ *
+ *  This method is used for mapping a cooked model.  For a
+ *  model file the cooked file next to it is used, and cooked
+ *  first when it is missing or older than the model file.
+ *  The buffers a glTF file refers to are not checked, so a
+ *  changed buffer needs its glTF file touched.
+ ***********************************************************/
+bool MeshCache::Load(const std::string& filename, int threadCount)
+{
+	Close();
+
+	std::string cacheFilename = filename;
+	bool bModelFile = MeshImporter::IsModelFilename(filename);
+	if (bModelFile)
+	{
+		cacheFilename = GetCacheFilename(filename);
+
+		long long modelTime = GetModifiedTime(filename);
+		long long cacheTime = GetModifiedTime(cacheFilename);
+		if ((modelTime >= 0) && (cacheTime < modelTime))
+		{
+			if (!Cook(filename, cacheFilename, threadCount))
+			{
+				return(false);
+			}
+		}
+	}
+
+	if (m_file.Open(cacheFilename) && Validate())
+	{
+		return(true);
+	}
+
+	// a cooked file from an older build is cooked again
+	if (bModelFile && (GetModifiedTime(filename) >= 0))
+	{
+		m_file.Close();
+		if (Cook(filename, cacheFilename, threadCount) &&
+			m_file.Open(cacheFilename) && Validate())
+		{
+			return(true);
+		}
+	}
+
+	std::cout << "Could not load mesh file:" << cacheFilename << std::endl;
+	Close();
+	return(false);
+}
+
+/***********************************************************
+ *  Close()
+ *
+ *  This method is used for unmapping the cooked file.
+ ***********************************************************/
+void MeshCache::Close()
+{
+	m_file.Close();
+	m_pHeader = NULL;
+	m_pVertices = NULL;
+	m_pIndices = NULL;
+}
+
+/***********************************************************
+ *  Validate()
+ *
+ *  This method is used for checking that the vertices and
+ *  indices are within the mapped file and that every index
+ *  names a vertex, so a damaged file can never make the GPU
+ *  read outside the vertex buffer.
+ ***********************************************************/
+bool MeshCache::Validate()
+{
+	const unsigned char* pData = m_file.GetData();
+	size_t size = m_file.GetSize();
+
+	if (size < sizeof(MESH_CACHE_HEADER))
+	{
+		return(false);
+	}
+
+	const MESH_CACHE_HEADER* pHeader = (const MESH_CACHE_HEADER*)pData;
+	if ((pHeader->magic != MESH_CACHE_MAGIC) ||
+		(pHeader->version != MESH_CACHE_VERSION) ||
+		(pHeader->fileSize != size) ||
+		((pHeader->vertexOffset % 4) != 0) ||
+		((pHeader->indexOffset % 4) != 0) ||
+		((pHeader->indexCount % 3) != 0) ||
+		((unsigned long long)pHeader->vertexOffset + (unsigned long long)pHeader->vertexCount * sizeof(MESH_VERTEX) > size) ||
+		((unsigned long long)pHeader->indexOffset + (unsigned long long)pHeader->indexCount * sizeof(uint32_t) > size))
+	{
+		return(false);
+	}
+
+	const uint32_t* pIndices = (const uint32_t*)(pData + pHeader->indexOffset);
+	for (uint32_t i = 0; i < pHeader->indexCount; i++)
+	{
+		if (pIndices[i] >= pHeader->vertexCount)
+			return(false);
+	}
+
+	m_pHeader = pHeader;
+	m_pVertices = (const MESH_VERTEX*)(pData + pHeader->vertexOffset);
+	m_pIndices = pIndices;
+	return(true);
+}
+
+/***********************************************************
+ *  Cook()
+ *
+ *  This method is used for importing a model file and writing
+ *  the imported mesh into a cooked file.
+ ***********************************************************/
+bool MeshCache::Cook(const std::string& modelFilename, const std::string& cacheFilename, int threadCount)
+{
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+	MeshImporter importer;
+	importer.SetThreadCount(threadCount);
+	IMPORTED_MESH mesh;
+	if (!importer.Import(modelFilename, mesh))
+	{
+		return(false);
+	}
+
+	MESH_CACHE_HEADER header;
+	unsigned long long vertexBytes = (unsigned long long)mesh.vertices.size() * sizeof(MESH_VERTEX);
+	unsigned long long indexBytes = (unsigned long long)mesh.indices.size() * sizeof(uint32_t);
+	unsigned long long fileSize = sizeof(MESH_CACHE_HEADER) + vertexBytes + indexBytes;
+	if (fileSize > 0xFFFFFFFFull)
+	{
+		std::cout << "Model is too large to cook:" << modelFilename << std::endl;
+		return(false);
+	}
+	header.magic = MESH_CACHE_MAGIC;
+	header.version = MESH_CACHE_VERSION;
+	header.fileSize = (uint32_t)fileSize;
+	header.vertexCount = (uint32_t)mesh.vertices.size();
+	header.vertexOffset = sizeof(MESH_CACHE_HEADER);
+	header.indexCount = (uint32_t)mesh.indices.size();
+	header.indexOffset = (uint32_t)(sizeof(MESH_CACHE_HEADER) + vertexBytes);
+	for (int i = 0; i < 3; i++)
+	{
+		header.boundsMin[i] = mesh.boundsMin[i];
+		header.boundsMax[i] = mesh.boundsMax[i];
+	}
+
+	FILE* pFile = fopen(cacheFilename.c_str(), "wb");
+	if (NULL == pFile)
+	{
+		std::cout << "Could not write mesh file:" << cacheFilename << std::endl;
+		return(false);
+	}
+	fwrite(&header, sizeof(header), 1, pFile);
+	fwrite(mesh.vertices.data(), sizeof(MESH_VERTEX), mesh.vertices.size(), pFile);
+	fwrite(mesh.indices.data(), sizeof(uint32_t), mesh.indices.size(), pFile);
+	bool bWritten = (ferror(pFile) == 0);
+	fclose(pFile);
+
+	double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+	std::cout << "Cooked model file:" << modelFilename << " -> " << cacheFilename
+		<< " (" << header.vertexCount << " vertices, " << header.indexCount / 3 << " triangles, "
+		<< milliseconds << " ms)" << std::endl;
+	return(bWritten);
+}
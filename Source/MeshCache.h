@@ -0,0 +1,82 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshcache.h
+// ============
+// cook imported models into binary files that load by mapping
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MappedFile.h"
+#include "MeshImporter.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+
+// the cooked file is the header, the vertices and the 32 bit
+// indices, stored exactly as the vertex and index buffers
+// take them
+#define MESH_CACHE_MAGIC 0x48534D44u   // "DMSH"
+#define MESH_CACHE_VERSION 1u
+
+struct MESH_CACHE_HEADER
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t fileSize;
+	uint32_t vertexCount;
+	uint32_t vertexOffset;
+	uint32_t indexCount;
+	uint32_t indexOffset;
+	// object space bounds of the vertices
+	float boundsMin[3];
+	float boundsMax[3];
+};
+
+static_assert(sizeof(MESH_CACHE_HEADER) == 52, "mesh cache header must be packed");
+
+/***********************************************************
+ *  MeshCache
+ *
+ *  This class loads a cooked model by mapping it into memory,
+ *  so the vertices and indices go from the page cache to the
+ *  GPU buffers without being parsed or copied.  Load() cooks
+ *  a model file first when its cooked file is missing or
+ *  older than it, so only the first run pays for the import.
+ ***********************************************************/
+class MeshCache
+{
+public:
+	// constructor
+	MeshCache();
+	// destructor
+	~MeshCache();
+
+	// load a model file through its cooked file, or a cooked
+	// file directly, importing on the given threads
+	bool Load(const std::string& filename, int threadCount);
+	// unmap the cooked file
+	void Close();
+	// import a model file and write its cooked file
+	static bool Cook(const std::string& modelFilename, const std::string& cacheFilename, int threadCount);
+	// name of the cooked file of a model file
+	static std::string GetCacheFilename(const std::string& modelFilename);
+
+	// access to the mapped mesh
+	uint32_t GetVertexCount() const { return m_pHeader->vertexCount; }
+	uint32_t GetIndexCount() const { return m_pHeader->indexCount; }
+	const MESH_VERTEX* GetVertices() const { return m_pVertices; }
+	const uint32_t* GetIndices() const { return m_pIndices; }
+	glm::vec3 GetBoundsMin() const { return glm::vec3(m_pHeader->boundsMin[0], m_pHeader->boundsMin[1], m_pHeader->boundsMin[2]); }
+	glm::vec3 GetBoundsMax() const { return glm::vec3(m_pHeader->boundsMax[0], m_pHeader->boundsMax[1], m_pHeader->boundsMax[2]); }
+
+private:
+	MappedFile m_file;
+	const MESH_CACHE_HEADER* m_pHeader;
+	const MESH_VERTEX* m_pVertices;
+	const uint32_t* m_pIndices;
+
+	// check the mapped file and set the pointers
+	bool Validate();
+};
@@ -0,0 +1,1988 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshimporter.cpp
+// ============
+// import OBJ and glTF 2.0 model files on several threads
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MeshImporter.h"
+#include "MappedFile.h"
+
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+// declaration of global variables
+namespace
+{
+	// extensions of the model files, compared without case
+	const char* g_ObjExtension = ".obj";
+	const char* g_GltfExtension = ".gltf";
+	const char* g_GlbExtension = ".glb";
+	// OBJ text handed to each worker before it is split further
+	const size_t g_ObjChunkBytes = 1 << 20;
+	// powers of ten that are exact as doubles
+	const double g_PowersOfTen[23] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+	// binary glTF container, little endian
+	const uint32_t g_GlbMagic = 0x46546C67u;   // "glTF"
+	const uint32_t g_GlbJsonChunk = 0x4E4F534Au;   // "JSON"
+	const uint32_t g_GlbBinaryChunk = 0x004E4942u;   // "BIN"
+	// glTF accessor component types and the triangle list mode
+	const int g_GltfByte = 5120;
+	const int g_GltfUnsignedByte = 5121;
+	const int g_GltfShort = 5122;
+	const int g_GltfUnsignedShort = 5123;
+	const int g_GltfUnsignedInt = 5125;
+	const int g_GltfFloat = 5126;
+	const int g_GltfTriangles = 4;
+
+	/***********************************************************
+	 *  HasExtension()
+	 *
+	 *  This function is used for checking the extension of a
+	 *  file name, ignoring case.
+	 ***********************************************************/
+	bool HasExtension(const std::string& filename, const char* extension)
+	{
+		size_t length = strlen(extension);
+		if (filename.size() <= length)
+		{
+			return(false);
+		}
+		for (size_t i = 0; i < length; i++)
+		{
+			char c = filename[filename.size() - length + i];
+			if (tolower((unsigned char)c) != extension[i])
+				return(false);
+		}
+		return(true);
+	}
+
+	/***********************************************************
+	 *  IsBlank()
+	 *
+	 *  This function is used for checking for a space inside a
+	 *  line of text.
+	 ***********************************************************/
+	inline bool IsBlank(char c)
+	{
+		return((c == ' ') || (c == '\t') || (c == '\r'));
+	}
+
+	/***********************************************************
+	 *  SkipBlanks()
+	 ***********************************************************/
+	inline void SkipBlanks(const char*& p, const char* pEnd)
+	{
+		while ((p < pEnd) && IsBlank(*p))
+			p++;
+	}
+
+	/***********************************************************
+	 *  ParseDouble()
+	 *
+	 *  This function is used for reading a decimal number
+	 *  without the locale lookups and the terminated string
+	 *  strtod() needs, which dominate a generic loader.  The
+	 *  first 18 significant digits are kept, which is more
+	 *  than a float or a buffer offset needs.
+	 ***********************************************************/
+	bool ParseDouble(const char*& p, const char* pEnd, double& value)
+	{
+		const char* pStart = p;
+		bool bNegative = false;
+		if ((p < pEnd) && ((*p == '-') || (*p == '+')))
+		{
+			bNegative = (*p == '-');
+			p++;
+		}
+
+		uint64_t mantissa = 0;
+		int exponent = 0;
+		bool bDigits = false;
+		while ((p < pEnd) && (*p >= '0') && (*p <= '9'))
+		{
+			if (mantissa < 100000000000000000ull)
+				mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+			else
+				exponent++;
+			bDigits = true;
+			p++;
+		}
+		if ((p < pEnd) && (*p == '.'))
+		{
+			p++;
+			while ((p < pEnd) && (*p >= '0') && (*p <= '9'))
+			{
+				if (mantissa < 100000000000000000ull)
+				{
+					mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+					exponent--;
+				}
+				bDigits = true;
+				p++;
+			}
+		}
+		if (!bDigits)
+		{
+			p = pStart;
+			return(false);
+		}
+
+		if ((p < pEnd) && ((*p == 'e') || (*p == 'E')))
+		{
+			const char* pExponent = p;
+			p++;
+			bool bNegativeExponent = false;
+			if ((p < pEnd) && ((*p == '-') || (*p == '+')))
+			{
+				bNegativeExponent = (*p == '-');
+				p++;
+			}
+			if ((p >= pEnd) || (*p < '0') || (*p > '9'))
+			{
+				// not an exponent, the number ends before the e
+				p = pExponent;
+			}
+			else
+			{
+				int written = 0;
+				while ((p < pEnd) && (*p >= '0') && (*p <= '9'))
+				{
+					if (written < 10000)
+						written = written * 10 + (*p - '0');
+					p++;
+				}
+				exponent += bNegativeExponent ? -written : written;
+			}
+		}
+
+		double result = (double)mantissa;
+		int power = std::abs(exponent);
+		double scale = (power < 23) ? g_PowersOfTen[power] : std::pow(10.0, (double)power);
+		result = (exponent < 0) ? result / scale : result * scale;
+		value = bNegative ? -result : result;
+		return(true);
+	}
+
+	/***********************************************************
+	 *  ParseFloat()
+	 ***********************************************************/
+	inline bool ParseFloat(const char*& p, const char* pEnd, float& value)
+	{
+		double number = 0.0;
+		if (!ParseDouble(p, pEnd, number))
+		{
+			return(false);
+		}
+		value = (float)number;
+		return(true);
+	}
+
+	/***********************************************************
+	 *  ParseIndex()
+	 *
+	 *  This function is used for reading a signed OBJ index.
+	 ***********************************************************/
+	inline bool ParseIndex(const char*& p, const char* pEnd, int64_t& value)
+	{
+		bool bNegative = false;
+		if ((p < pEnd) && (*p == '-'))
+		{
+			bNegative = true;
+			p++;
+		}
+		if ((p >= pEnd) || (*p < '0') || (*p > '9'))
+		{
+			return(false);
+		}
+		int64_t result = 0;
+		while ((p < pEnd) && (*p >= '0') && (*p <= '9'))
+		{
+			if (result < 0x100000000ll)
+				result = result * 10 + (*p - '0');
+			p++;
+		}
+		value = bNegative ? -result : result;
+		return(true);
+	}
+
+	/***********************************************************
+	 *  OBJ_CORNER
+	 *
+	 *  The position, texture coordinate and normal of a face
+	 *  corner as zero based indices, -1 for none.
+	 ***********************************************************/
+	struct OBJ_CORNER
+	{
+		int32_t position;
+		int32_t uv;
+		int32_t normal;
+	};
+
+	/***********************************************************
+	 *  OBJ_CHUNK
+	 *
+	 *  A range of whole lines of an OBJ file.  The first pass
+	 *  counts what each chunk defines, which gives every chunk
+	 *  the place of its values in the whole file, so the second
+	 *  pass can resolve relative indices and write the values
+	 *  straight into the shared arrays.
+	 ***********************************************************/
+	struct OBJ_CHUNK
+	{
+		size_t begin;
+		size_t end;
+		uint32_t lineCount;
+		uint32_t positionCount;
+		uint32_t uvCount;
+		uint32_t normalCount;
+		uint32_t cornerCount;
+		// first line and values of the chunk in the whole file
+		uint32_t firstLine;
+		uint32_t firstPosition;
+		uint32_t firstUV;
+		uint32_t firstNormal;
+		uint32_t firstCorner;
+		// line of the first error, 0 for none
+		uint32_t errorLine;
+		bool bUVs;
+		bool bNormals;
+	};
+
+	// arrays the second pass writes the chunks into
+	struct OBJ_VALUES
+	{
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec2> uvs;
+		std::vector<glm::vec3> normals;
+		std::vector<OBJ_CORNER> corners;
+	};
+
+	/***********************************************************
+	 *  ResolveIndex()
+	 *
+	 *  This function is used for turning a one based OBJ index,
+	 *  or a negative one counting back from the last value
+	 *  defined, into a zero based index.
+	 ***********************************************************/
+	inline bool ResolveIndex(int64_t index, uint32_t definedCount, uint32_t totalCount, int32_t& resolved)
+	{
+		int64_t result = (index > 0) ? index - 1 : (int64_t)definedCount + index;
+		if ((index == 0) || (result < 0) || (result >= (int64_t)totalCount))
+		{
+			return(false);
+		}
+		resolved = (int32_t)result;
+		return(true);
+	}
+
+	/***********************************************************
+	 *  ProcessObjChunk()
+	 *
+	 *  This function is used for the two passes over the lines
+	 *  of a chunk.  Without values it only counts the lines,
+	 *  the vertex values and the triangle corners, with them it
+	 *  parses the lines and triangulates the faces as fans.
+	 *  Lines other than v, vt, vn and f are skipped.
+	 ***********************************************************/
+	void ProcessObjChunk(const char* pText, OBJ_CHUNK& chunk, OBJ_VALUES* pValues)
+	{
+		const char* p = pText + chunk.begin;
+		const char* pChunkEnd = pText + chunk.end;
+		uint32_t lineCount = 0;
+		uint32_t positionCount = 0;
+		uint32_t uvCount = 0;
+		uint32_t normalCount = 0;
+		uint32_t cornerCount = 0;
+
+		while ((p < pChunkEnd) && (0 == chunk.errorLine))
+		{
+			const char* pLineEnd = (const char*)memchr(p, '\n', pChunkEnd - p);
+			if (NULL == pLineEnd)
+			{
+				pLineEnd = pChunkEnd;
+			}
+			lineCount++;
+
+			SkipBlanks(p, pLineEnd);
+			bool bError = false;
+			if ((pLineEnd - p >= 2) && (p[0] == 'v') && IsBlank(p[1]))
+			{
+				if (NULL != pValues)
+				{
+					glm::vec3& position = pValues->positions[chunk.firstPosition + positionCount];
+					p += 2;
+					for (int i = 0; (i < 3) && !bError; i++)
+					{
+						SkipBlanks(p, pLineEnd);
+						bError = !ParseFloat(p, pLineEnd, position[i]);
+					}
+				}
+				positionCount++;
+			}
+			else if ((pLineEnd - p >= 3) && (p[0] == 'v') && (p[1] == 't') && IsBlank(p[2]))
+			{
+				if (NULL != pValues)
+				{
+					glm::vec2& uv = pValues->uvs[chunk.firstUV + uvCount];
+					p += 3;
+					SkipBlanks(p, pLineEnd);
+					bError = !ParseFloat(p, pLineEnd, uv.x);
+					// the v coordinate is optional
+					SkipBlanks(p, pLineEnd);
+					uv.y = 0.0f;
+					ParseFloat(p, pLineEnd, uv.y);
+				}
+				uvCount++;
+			}
+			else if ((pLineEnd - p >= 3) && (p[0] == 'v') && (p[1] == 'n') && IsBlank(p[2]))
+			{
+				if (NULL != pValues)
+				{
+					glm::vec3& normal = pValues->normals[chunk.firstNormal + normalCount];
+					p += 3;
+					for (int i = 0; (i < 3) && !bError; i++)
+					{
+						SkipBlanks(p, pLineEnd);
+						bError = !ParseFloat(p, pLineEnd, normal[i]);
+					}
+				}
+				normalCount++;
+			}
+			else if ((pLineEnd - p >= 2) && (p[0] == 'f') && IsBlank(p[1]))
+			{
+				p += 2;
+				int cornersInFace = 0;
+				if (NULL == pValues)
+				{
+					// count the corner words, each makes a triangle
+					// with the first corner and the one before it
+					while (p < pLineEnd)
+					{
+						SkipBlanks(p, pLineEnd);
+						if (p >= pLineEnd)
+							break;
+						cornersInFace++;
+						while ((p < pLineEnd) && !IsBlank(*p))
+							p++;
+					}
+				}
+				else
+				{
+					OBJ_CORNER first = { -1, -1, -1 };
+					OBJ_CORNER previous = { -1, -1, -1 };
+					uint32_t definedPositions = chunk.firstPosition + positionCount;
+					uint32_t definedUVs = chunk.firstUV + uvCount;
+					uint32_t definedNormals = chunk.firstNormal + normalCount;
+					while ((p < pLineEnd) && !bError)
+					{
+						SkipBlanks(p, pLineEnd);
+						if (p >= pLineEnd)
+							break;
+
+						// v, v/vt, v//vn or v/vt/vn
+						OBJ_CORNER corner = { -1, -1, -1 };
+						int64_t index = 0;
+						bError = !ParseIndex(p, pLineEnd, index) ||
+							!ResolveIndex(index, definedPositions, (uint32_t)pValues->positions.size(), corner.position);
+						if (!bError && (p < pLineEnd) && (*p == '/'))
+						{
+							p++;
+							if ((p < pLineEnd) && (*p != '/'))
+							{
+								bError = !ParseIndex(p, pLineEnd, index) ||
+									!ResolveIndex(index, definedUVs, (uint32_t)pValues->uvs.size(), corner.uv);
+							}
+							if (!bError && (p < pLineEnd) && (*p == '/'))
+							{
+								p++;
+								bError = !ParseIndex(p, pLineEnd, index) ||
+									!ResolveIndex(index, definedNormals, (uint32_t)pValues->normals.size(), corner.normal);
+							}
+						}
+						if (bError || ((p < pLineEnd) && !IsBlank(*p)))
+						{
+							bError = true;
+							break;
+						}
+
+						chunk.bUVs = chunk.bUVs || (corner.uv >= 0);
+						chunk.bNormals = chunk.bNormals || (corner.normal >= 0);
+						if (cornersInFace == 0)
+						{
+							first = corner;
+						}
+						else if (cornersInFace >= 2)
+						{
+							OBJ_CORNER* pTriangle = &pValues->corners[chunk.firstCorner + cornerCount];
+							pTriangle[0] = first;
+							pTriangle[1] = previous;
+							pTriangle[2] = corner;
+							cornerCount += 3;
+						}
+						previous = corner;
+						cornersInFace++;
+					}
+				}
+				if (NULL == pValues)
+				{
+					cornerCount += (cornersInFace >= 3) ? (uint32_t)(cornersInFace - 2) * 3 : 0;
+				}
+			}
+
+			if (bError)
+			{
+				chunk.errorLine = chunk.firstLine + lineCount;
+			}
+			p = pLineEnd + 1;
+		}
+
+		if (NULL == pValues)
+		{
+			chunk.lineCount = lineCount;
+			chunk.positionCount = positionCount;
+			chunk.uvCount = uvCount;
+			chunk.normalCount = normalCount;
+			chunk.cornerCount = cornerCount;
+		}
+	}
+
+	/***********************************************************
+	 *  JSON_VALUE
+	 *
+	 *  A parsed JSON value.  Arrays and objects keep their
+	 *  values in items, objects also their member names in keys.
+	 ***********************************************************/
+	struct JSON_VALUE
+	{
+		enum JSON_TYPE
+		{
+			JSON_NULL = 0,
+			JSON_BOOL,
+			JSON_NUMBER,
+			JSON_STRING,
+			JSON_ARRAY,
+			JSON_OBJECT
+		};
+
+		JSON_TYPE type;
+		double number;
+		std::string text;
+		std::vector<JSON_VALUE> items;
+		std::vector<std::string> keys;
+
+		JSON_VALUE()
+		{
+			type = JSON_NULL;
+			number = 0.0;
+		}
+
+		const JSON_VALUE* Find(const char* key) const
+		{
+			for (size_t i = 0; i < keys.size(); i++)
+			{
+				if (keys[i] == key)
+					return(&items[i]);
+			}
+			return(NULL);
+		}
+
+		const JSON_VALUE* At(size_t index) const
+		{
+			if ((type != JSON_ARRAY) || (index >= items.size()))
+				return(NULL);
+			return(&items[index]);
+		}
+
+		double GetNumber(const char* key, double defaultValue) const
+		{
+			const JSON_VALUE* pValue = Find(key);
+			if ((NULL == pValue) || (pValue->type != JSON_NUMBER))
+				return(defaultValue);
+			return(pValue->number);
+		}
+
+		int GetInt(const char* key, int defaultValue) const
+		{
+			return((int)GetNumber(key, (double)defaultValue));
+		}
+	};
+
+	/***********************************************************
+	 *  JSON_PARSER
+	 *
+	 *  Reads the JSON part of a glTF file.  It accepts strict
+	 *  JSON only, nested no deeper than a glTF file ever is.
+	 ***********************************************************/
+	struct JSON_PARSER
+	{
+		const char* p;
+		const char* pEnd;
+
+		void SkipSpaces()
+		{
+			while ((p < pEnd) && ((*p == ' ') || (*p == '\t') || (*p == '\n') || (*p == '\r')))
+				p++;
+		}
+
+		bool MatchLiteral(const char* literal)
+		{
+			size_t length = strlen(literal);
+			if (((size_t)(pEnd - p) < length) || (memcmp(p, literal, length) != 0))
+				return(false);
+			p += length;
+			return(true);
+		}
+
+		bool ParseString(std::string& text)
+		{
+			if ((p >= pEnd) || (*p != '"'))
+				return(false);
+			p++;
+			while ((p < pEnd) && (*p != '"'))
+			{
+				char c = *p++;
+				if (c != '\\')
+				{
+					text.push_back(c);
+					continue;
+				}
+				if (p >= pEnd)
+					return(false);
+				c = *p++;
+				switch (c)
+				{
+				case 'b': text.push_back('\b'); break;
+				case 'f': text.push_back('\f'); break;
+				case 'n': text.push_back('\n'); break;
+				case 'r': text.push_back('\r'); break;
+				case 't': text.push_back('\t'); break;
+				case 'u':
+				{
+					if (pEnd - p < 4)
+						return(false);
+					unsigned int code = 0;
+					for (int i = 0; i < 4; i++)
+					{
+						char digit = p[i];
+						code <<= 4;
+						if ((digit >= '0') && (digit <= '9')) code |= digit - '0';
+						else if ((digit >= 'a') && (digit <= 'f')) code |= digit - 'a' + 10;
+						else if ((digit >= 'A') && (digit <= 'F')) code |= digit - 'A' + 10;
+						else return(false);
+					}
+					p += 4;
+					// written as UTF-8, names in glTF files are ASCII
+					if (code < 0x80)
+					{
+						text.push_back((char)code);
+					}
+					else if (code < 0x800)
+					{
+						text.push_back((char)(0xC0 | (code >> 6)));
+						text.push_back((char)(0x80 | (code & 0x3F)));
+					}
+					else
+					{
+						text.push_back((char)(0xE0 | (code >> 12)));
+						text.push_back((char)(0x80 | ((code >> 6) & 0x3F)));
+						text.push_back((char)(0x80 | (code & 0x3F)));
+					}
+					break;
+				}
+				default:
+					text.push_back(c);
+					break;
+				}
+			}
+			if (p >= pEnd)
+				return(false);
+			p++;
+			return(true);
+		}
+
+		bool ParseValue(JSON_VALUE& value, int depth)
+		{
+			SkipSpaces();
+			if ((p >= pEnd) || (depth > 64))
+				return(false);
+
+			if (*p == '{')
+			{
+				value.type = JSON_VALUE::JSON_OBJECT;
+				p++;
+				SkipSpaces();
+				if ((p < pEnd) && (*p == '}'))
+				{
+					p++;
+					return(true);
+				}
+				while (true)
+				{
+					SkipSpaces();
+					value.keys.push_back(std::string());
+					if (!ParseString(value.keys.back()))
+						return(false);
+					SkipSpaces();
+					if ((p >= pEnd) || (*p != ':'))
+						return(false);
+					p++;
+					value.items.push_back(JSON_VALUE());
+					if (!ParseValue(value.items.back(), depth + 1))
+						return(false);
+					SkipSpaces();
+					if ((p < pEnd) && (*p == ','))
+					{
+						p++;
+						continue;
+					}
+					if ((p < pEnd) && (*p == '}'))
+					{
+						p++;
+						return(true);
+					}
+					return(false);
+				}
+			}
+			if (*p == '[')
+			{
+				value.type = JSON_VALUE::JSON_ARRAY;
+				p++;
+				SkipSpaces();
+				if ((p < pEnd) && (*p == ']'))
+				{
+					p++;
+					return(true);
+				}
+				while (true)
+				{
+					value.items.push_back(JSON_VALUE());
+					if (!ParseValue(value.items.back(), depth + 1))
+						return(false);
+					SkipSpaces();
+					if ((p < pEnd) && (*p == ','))
+					{
+						p++;
+						continue;
+					}
+					if ((p < pEnd) && (*p == ']'))
+					{
+						p++;
+						return(true);
+					}
+					return(false);
+				}
+			}
+			if (*p == '"')
+			{
+				value.type = JSON_VALUE::JSON_STRING;
+				return(ParseString(value.text));
+			}
+			if (MatchLiteral("true"))
+			{
+				value.type = JSON_VALUE::JSON_BOOL;
+				value.number = 1.0;
+				return(true);
+			}
+			if (MatchLiteral("false"))
+			{
+				value.type = JSON_VALUE::JSON_BOOL;
+				return(true);
+			}
+			if (MatchLiteral("null"))
+			{
+				return(true);
+			}
+			value.type = JSON_VALUE::JSON_NUMBER;
+			return(ParseDouble(p, pEnd, value.number));
+		}
+	};
+
+	/***********************************************************
+	 *  GLTF_DOCUMENT
+	 *
+	 *  The parsed JSON of a glTF file and its buffers, which
+	 *  are used in place where they are mapped files or the
+	 *  binary chunk of a .glb file.
+	 ***********************************************************/
+	struct GLTF_BUFFER
+	{
+		const unsigned char* pData;
+		size_t size;
+	};
+
+	struct GLTF_DOCUMENT
+	{
+		MappedFile file;
+		JSON_VALUE root;
+		std::vector<GLTF_BUFFER> buffers;
+		std::vector<MappedFile*> bufferFiles;
+		// buffers embedded as base64 data URIs
+		std::vector<std::vector<unsigned char> > decodedBuffers;
+
+		~GLTF_DOCUMENT()
+		{
+			for (size_t i = 0; i < bufferFiles.size(); i++)
+			{
+				delete bufferFiles[i];
+			}
+		}
+	};
+
+	/***********************************************************
+	 *  GLTF_ACCESSOR
+	 *
+	 *  Where the elements of an accessor are in its buffer.
+	 ***********************************************************/
+	struct GLTF_ACCESSOR
+	{
+		const unsigned char* pData;
+		size_t count;
+		size_t stride;
+		int componentType;
+		int components;
+		bool bNormalized;
+	};
+
+	/***********************************************************
+	 *  GLTF_PRIMITIVE
+	 *
+	 *  A triangle list of a mesh placed by a node, and where
+	 *  its vertices and indices go in the imported mesh.
+	 ***********************************************************/
+	struct GLTF_PRIMITIVE
+	{
+		GLTF_ACCESSOR positions;
+		GLTF_ACCESSOR normals;
+		GLTF_ACCESSOR tangents;
+		GLTF_ACCESSOR uvs;
+		GLTF_ACCESSOR indices;
+		bool bNormals;
+		bool bTangents;
+		bool bUVs;
+		bool bIndices;
+		glm::mat4 world;
+		glm::mat3 normalMatrix;
+		// a mirroring transform turns the triangles around
+		bool bMirrored;
+		size_t firstVertex;
+		size_t vertexCount;
+		size_t firstIndex;
+		size_t indexCount;
+	};
+
+	/***********************************************************
+	 *  DecodeBase64()
+	 *
+	 *  This function is used for decoding the data of a base64
+	 *  data URI, stopping at the padding.
+	 ***********************************************************/
+	bool DecodeBase64(const char* pText, size_t length, std::vector<unsigned char>& data)
+	{
+		data.reserve(length / 4 * 3);
+		uint32_t bits = 0;
+		int bitCount = 0;
+		for (size_t i = 0; i < length; i++)
+		{
+			char c = pText[i];
+			int value;
+			if ((c >= 'A') && (c <= 'Z')) value = c - 'A';
+			else if ((c >= 'a') && (c <= 'z')) value = c - 'a' + 26;
+			else if ((c >= '0') && (c <= '9')) value = c - '0' + 52;
+			else if (c == '+') value = 62;
+			else if (c == '/') value = 63;
+			else if (c == '=') break;
+			else return(false);
+
+			bits = (bits << 6) | (uint32_t)value;
+			bitCount += 6;
+			if (bitCount >= 8)
+			{
+				bitCount -= 8;
+				data.push_back((unsigned char)((bits >> bitCount) & 0xFF));
+			}
+		}
+		return(true);
+	}
+
+	/***********************************************************
+	 *  DecodeURI()
+	 *
+	 *  This function is used for turning the %XX escapes of a
+	 *  relative buffer URI back into the file name.
+	 ***********************************************************/
+	std::string DecodeURI(const std::string& uri)
+	{
+		std::string path;
+		for (size_t i = 0; i < uri.size(); i++)
+		{
+			if ((uri[i] == '%') && (i + 2 < uri.size()) &&
+				isxdigit((unsigned char)uri[i + 1]) && isxdigit((unsigned char)uri[i + 2]))
+			{
+				path.push_back((char)strtol(uri.substr(i + 1, 2).c_str(), NULL, 16));
+				i += 2;
+			}
+			else
+			{
+				path.push_back(uri[i]);
+			}
+		}
+		return(path);
+	}
+
+	/***********************************************************
+	 *  LoadGltfBuffers()
+	 *
+	 *  This function is used for finding the data of all the
+	 *  buffers of a glTF file.  Buffer 0 of a .glb file without
+	 *  a URI is its binary chunk.
+	 ***********************************************************/
+	bool LoadGltfBuffers(GLTF_DOCUMENT& document, const std::string& filename, const GLTF_BUFFER& binaryChunk)
+	{
+		const JSON_VALUE* pBuffers = document.root.Find("buffers");
+		size_t bufferCount = (NULL != pBuffers) ? pBuffers->items.size() : 0;
+		std::string directory;
+		size_t slash = filename.find_last_of("/\\");
+		if (slash != std::string::npos)
+		{
+			directory = filename.substr(0, slash + 1);
+		}
+
+		document.buffers.resize(bufferCount);
+		document.decodedBuffers.resize(bufferCount);
+		for (size_t i = 0; i < bufferCount; i++)
+		{
+			const JSON_VALUE& buffer = pBuffers->items[i];
+			size_t byteLength = (size_t)buffer.GetNumber("byteLength", 0.0);
+			const JSON_VALUE* pUri = buffer.Find("uri");
+			GLTF_BUFFER& data = document.buffers[i];
+
+			if ((NULL == pUri) || (pUri->type != JSON_VALUE::JSON_STRING))
+			{
+				if ((i != 0) || (NULL == binaryChunk.pData))
+				{
+					std::cout << "glTF buffer has no data:" << filename << std::endl;
+					return(false);
+				}
+				data = binaryChunk;
+			}
+			else if (pUri->text.compare(0, 5, "data:") == 0)
+			{
+				size_t comma = pUri->text.find(";base64,");
+				if ((comma == std::string::npos) ||
+					!DecodeBase64(pUri->text.c_str() + comma + 8, pUri->text.size() - comma - 8, document.decodedBuffers[i]))
+				{
+					std::cout << "glTF buffer has an unsupported data URI:" << filename << std::endl;
+					return(false);
+				}
+				data.pData = document.decodedBuffers[i].data();
+				data.size = document.decodedBuffers[i].size();
+			}
+			else
+			{
+				MappedFile* pFile = new MappedFile();
+				document.bufferFiles.push_back(pFile);
+				std::string path = directory + DecodeURI(pUri->text);
+				if (!pFile->Open(path))
+				{
+					std::cout << "Could not open glTF buffer:" << path << std::endl;
+					return(false);
+				}
+				data.pData = pFile->GetData();
+				data.size = pFile->GetSize();
+			}
+
+			if (data.size < byteLength)
+			{
+				std::cout << "glTF buffer is shorter than its byteLength:" << filename << std::endl;
+				return(false);
+			}
+		}
+		return(true);
+	}
+
+	/***********************************************************
+	 *  GetAccessor()
+	 *
+	 *  This function is used for finding the elements of an
+	 *  accessor and checking that they are all inside their
+	 *  buffer view.  Sparse accessors are not supported.
+	 ***********************************************************/
+	bool GetAccessor(const GLTF_DOCUMENT& document, int index, GLTF_ACCESSOR& accessor)
+	{
+		const JSON_VALUE* pAccessors = document.root.Find("accessors");
+		const JSON_VALUE* pViews = document.root.Find("bufferViews");
+		const JSON_VALUE* pAccessor = (NULL != pAccessors) ? pAccessors->At((size_t)index) : NULL;
+		if ((NULL == pAccessor) || (index < 0) || (NULL != pAccessor->Find("sparse")))
+		{
+			return(false);
+		}
+		const JSON_VALUE* pView = (NULL != pViews) ? pViews->At((size_t)pAccessor->GetInt("bufferView", -1)) : NULL;
+		if (NULL == pView)
+		{
+			return(false);
+		}
+
+		const JSON_VALUE* pType = pAccessor->Find("type");
+		std::string type = (NULL != pType) ? pType->text : "";
+		if (type == "SCALAR") accessor.components = 1;
+		else if (type == "VEC2") accessor.components = 2;
+		else if (type == "VEC3") accessor.components = 3;
+		else if (type == "VEC4") accessor.components = 4;
+		else return(false);
+
+		accessor.componentType = pAccessor->GetInt("componentType", 0);
+		size_t componentSize = 0;
+		switch (accessor.componentType)
+		{
+		case g_GltfByte:
+		case g_GltfUnsignedByte:
+			componentSize = 1;
+			break;
+		case g_GltfShort:
+		case g_GltfUnsignedShort:
+			componentSize = 2;
+			break;
+		case g_GltfUnsignedInt:
+		case g_GltfFloat:
+			componentSize = 4;
+			break;
+		default:
+			return(false);
+		}
+		const JSON_VALUE* pNormalized = pAccessor->Find("normalized");
+		accessor.bNormalized = (NULL != pNormalized) && (pNormalized->number != 0.0);
+
+		size_t bufferIndex = (size_t)pView->GetInt("buffer", -1);
+		if (bufferIndex >= document.buffers.size())
+		{
+			return(false);
+		}
+		const GLTF_BUFFER& buffer = document.buffers[bufferIndex];
+		size_t viewOffset = (size_t)pView->GetNumber("byteOffset", 0.0);
+		size_t viewLength = (size_t)pView->GetNumber("byteLength", 0.0);
+		size_t elementSize = componentSize * accessor.components;
+		accessor.stride = (size_t)pView->GetNumber("byteStride", 0.0);
+		if (0 == accessor.stride)
+		{
+			accessor.stride = elementSize;
+		}
+		accessor.count = (size_t)pAccessor->GetNumber("count", 0.0);
+		size_t offset = (size_t)pAccessor->GetNumber("byteOffset", 0.0);
+
+		if ((viewOffset > buffer.size) || (viewLength > buffer.size - viewOffset) ||
+			((accessor.count > 0) && ((offset > viewLength) ||
+				((unsigned long long)(accessor.count - 1) * accessor.stride + elementSize > viewLength - offset))))
+		{
+			return(false);
+		}
+		accessor.pData = buffer.pData + viewOffset + offset;
+		return(true);
+	}
+
+	/***********************************************************
+	 *  ReadComponent()
+	 *
+	 *  This function is used for reading a component of an
+	 *  accessor element as a float, scaling normalized integers
+	 *  into the 0 to 1 or -1 to 1 range.
+	 ***********************************************************/
+	inline float ReadComponent(const GLTF_ACCESSOR& accessor, size_t element, int component)
+	{
+		const unsigned char* pElement = accessor.pData + element * accessor.stride;
+		switch (accessor.componentType)
+		{
+		case g_GltfFloat:
+		{
+			float value;
+			memcpy(&value, pElement + component * 4, 4);
+			return(value);
+		}
+		case g_GltfUnsignedByte:
+		{
+			float value = (float)pElement[component];
+			return(accessor.bNormalized ? value / 255.0f : value);
+		}
+		case g_GltfByte:
+		{
+			float value = (float)(int8_t)pElement[component];
+			return(accessor.bNormalized ? std::max(value / 127.0f, -1.0f) : value);
+		}
+		case g_GltfUnsignedShort:
+		{
+			uint16_t value;
+			memcpy(&value, pElement + component * 2, 2);
+			return(accessor.bNormalized ? (float)value / 65535.0f : (float)value);
+		}
+		case g_GltfShort:
+		{
+			int16_t value;
+			memcpy(&value, pElement + component * 2, 2);
+			return(accessor.bNormalized ? std::max((float)value / 32767.0f, -1.0f) : (float)value);
+		}
+		default:
+		{
+			uint32_t value;
+			memcpy(&value, pElement + component * 4, 4);
+			return((float)value);
+		}
+		}
+	}
+
+	/***********************************************************
+	 *  ReadIndex()
+	 ***********************************************************/
+	inline uint32_t ReadIndex(const GLTF_ACCESSOR& accessor, size_t element)
+	{
+		const unsigned char* pElement = accessor.pData + element * accessor.stride;
+		if (accessor.componentType == g_GltfUnsignedByte)
+		{
+			return(pElement[0]);
+		}
+		if (accessor.componentType == g_GltfUnsignedShort)
+		{
+			uint16_t value;
+			memcpy(&value, pElement, 2);
+			return(value);
+		}
+		uint32_t value;
+		memcpy(&value, pElement, 4);
+		return(value);
+	}
+
+	/***********************************************************
+	 *  GetNodeMatrix()
+	 *
+	 *  This function is used for getting the local transform of
+	 *  a node, its matrix or its translation, rotation and scale.
+	 ***********************************************************/
+	glm::mat4 GetNodeMatrix(const JSON_VALUE& node)
+	{
+		const JSON_VALUE* pMatrix = node.Find("matrix");
+		if ((NULL != pMatrix) && (pMatrix->items.size() == 16))
+		{
+			glm::mat4 matrix;
+			for (int column = 0; column < 4; column++)
+			{
+				for (int row = 0; row < 4; row++)
+				{
+					matrix[column][row] = (float)pMatrix->items[column * 4 + row].number;
+				}
+			}
+			return(matrix);
+		}
+
+		glm::vec3 translation(0.0f);
+		glm::quat rotation(1.0f, 0.0f, 0.0f, 0.0f);
+		glm::vec3 scale(1.0f);
+		const JSON_VALUE* pValue = node.Find("translation");
+		if ((NULL != pValue) && (pValue->items.size() == 3))
+		{
+			translation = glm::vec3((float)pValue->items[0].number, (float)pValue->items[1].number, (float)pValue->items[2].number);
+		}
+		pValue = node.Find("rotation");
+		if ((NULL != pValue) && (pValue->items.size() == 4))
+		{
+			// stored as x, y, z, w
+			rotation = glm::quat((float)pValue->items[3].number, (float)pValue->items[0].number,
+				(float)pValue->items[1].number, (float)pValue->items[2].number);
+		}
+		pValue = node.Find("scale");
+		if ((NULL != pValue) && (pValue->items.size() == 3))
+		{
+			scale = glm::vec3((float)pValue->items[0].number, (float)pValue->items[1].number, (float)pValue->items[2].number);
+		}
+
+		glm::mat4 matrix = glm::mat4_cast(rotation);
+		matrix[0] *= scale.x;
+		matrix[1] *= scale.y;
+		matrix[2] *= scale.z;
+		matrix[3] = glm::vec4(translation, 1.0f);
+		return(matrix);
+	}
+
+	/***********************************************************
+	 *  BuildVertexTriangles()
+	 *
+	 *  This function is used for listing the triangles around
+	 *  each group of vertices, packed one group after another
+	 *  with the offsets of the groups.  The group of a vertex is
+	 *  its entry in groups, or the vertex itself when empty.
+	 ***********************************************************/
+	void BuildVertexTriangles(
+		const IMPORTED_MESH& mesh,
+		const std::vector<uint32_t>& groups,
+		size_t groupCount,
+		std::vector<uint32_t>& offsets,
+		std::vector<uint32_t>& triangles)
+	{
+		offsets.assign(groupCount + 1, 0);
+		for (size_t i = 0; i < mesh.indices.size(); i++)
+		{
+			uint32_t group = groups.empty() ? mesh.indices[i] : groups[mesh.indices[i]];
+			offsets[group + 1]++;
+		}
+		for (size_t g = 0; g < groupCount; g++)
+		{
+			offsets[g + 1] += offsets[g];
+		}
+
+		std::vector<uint32_t> cursors(offsets.begin(), offsets.end() - 1);
+		triangles.resize(mesh.indices.size());
+		for (size_t i = 0; i < mesh.indices.size(); i++)
+		{
+			uint32_t group = groups.empty() ? mesh.indices[i] : groups[mesh.indices[i]];
+			triangles[cursors[group]++] = (uint32_t)(i / 3);
+		}
+	}
+
+	/***********************************************************
+	 *  GetVertexPosition()
+	 ***********************************************************/
+	inline glm::vec3 GetVertexPosition(const IMPORTED_MESH& mesh, uint32_t index)
+	{
+		return(glm::make_vec3(mesh.vertices[index].position));
+	}
+}
+
+/***********************************************************
+ *  MeshImporter()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+MeshImporter::MeshImporter()
+{
+	m_threadCount = 0;
+}
+
+/***********************************************************
+ *  ~MeshImporter()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+MeshImporter::~MeshImporter()
+{
+}
+
+/***********************************************************
+ *  SetThreadCount()
+ *
+ *  This method is used for setting how many threads import
+ *  a file, 0 for one per hardware thread.
+ ***********************************************************/
+void MeshImporter::SetThreadCount(int threadCount)
+{
+	m_threadCount = std::max(threadCount, 0);
+}
+
+/***********************************************************
+ *  IsModelFilename()
+ *
+ *  This method is used for checking whether a file name has
+ *  the extension of a model file the importer reads.
+ ***********************************************************/
+bool MeshImporter::IsModelFilename(const std::string& filename)
+{
+	return(HasExtension(filename, g_ObjExtension) ||
+		HasExtension(filename, g_GltfExtension) ||
+		HasExtension(filename, g_GlbExtension));
+}
+
+/***********************************************************
+ *  Import()
+ *
+ *  This method is used for importing a model file into an
+ *  indexed triangle list with all the vertex values filled
+ *  in and the bounds of the vertices.
+ ***********************************************************/
+bool MeshImporter::Import(const std::string& filename, IMPORTED_MESH& mesh)
+{
+	mesh.vertices.clear();
+	mesh.indices.clear();
+
+	std::vector<uint8_t> missing;
+	std::vector<uint32_t> positionGroups;
+	size_t positionCount = 0;
+	bool bImported = false;
+	if (HasExtension(filename, g_ObjExtension))
+	{
+		bImported = ImportOBJ(filename, mesh, missing, positionGroups, positionCount);
+	}
+	else if (HasExtension(filename, g_GltfExtension) || HasExtension(filename, g_GlbExtension))
+	{
+		bImported = ImportGLTF(filename, mesh, missing);
+	}
+	else
+	{
+		std::cout << "Unknown model file type:" << filename << std::endl;
+		return(false);
+	}
+
+	if (!bImported)
+	{
+		return(false);
+	}
+	if (mesh.indices.empty())
+	{
+		std::cout << "Model file has no triangles:" << filename << std::endl;
+		return(false);
+	}
+
+	uint8_t missingAny = 0;
+	for (size_t i = 0; i < missing.size(); i++)
+	{
+		missingAny |= missing[i];
+	}
+
+	ComputeBounds(mesh);
+	if (missingAny & MISSING_NORMAL)
+	{
+		if (positionGroups.empty())
+		{
+			positionCount = mesh.vertices.size();
+		}
+		GenerateNormals(mesh, missing, positionGroups, positionCount);
+	}
+	if (missingAny & MISSING_TANGENT)
+	{
+		GenerateTangents(mesh, missing);
+	}
+	return(true);
+}
+
+/***********************************************************
+ *  ImportOBJ()
+ *
+ *  This method is used for importing the faces of an OBJ
+ *  file.  The mapped text is cut into chunks at line ends;
+ *  a first parallel pass counts the values and corners of
+ *  each chunk and a second one parses them into their place.
+ *  Corners with the same position, texture coordinate and
+ *  normal then become one vertex.  The position groups let
+ *  generated normals be smooth across texture seams.
+ ***********************************************************/
+bool MeshImporter::ImportOBJ(
+	const std::string& filename,
+	IMPORTED_MESH& mesh,
+	std::vector<uint8_t>& missing,
+	std::vector<uint32_t>& positionGroups,
+	size_t& positionCount)
+{
+	MappedFile file;
+	if (!file.Open(filename))
+	{
+		std::cout << "Could not open model file:" << filename << std::endl;
+		return(false);
+	}
+	const char* pText = (const char*)file.GetData();
+	size_t size = file.GetSize();
+
+	// several chunks per worker even out lines of different cost
+	size_t chunkCount = std::min((size + g_ObjChunkBytes - 1) / g_ObjChunkBytes, (size_t)GetWorkerCount() * 8);
+	chunkCount = std::max(chunkCount, (size_t)1);
+	std::vector<OBJ_CHUNK> chunks(chunkCount);
+	size_t begin = 0;
+	for (size_t c = 0; c < chunkCount; c++)
+	{
+		size_t end = (c + 1 == chunkCount) ? size : std::max(size * (c + 1) / chunkCount, begin);
+		while ((end < size) && (end > 0) && (pText[end - 1] != '\n'))
+		{
+			end++;
+		}
+		memset(&chunks[c], 0, sizeof(OBJ_CHUNK));
+		chunks[c].begin = begin;
+		chunks[c].end = end;
+		begin = end;
+	}
+
+	ParallelFor(chunkCount, [&](int, size_t first, size_t last)
+	{
+		for (size_t c = first; c < last; c++)
+		{
+			ProcessObjChunk(pText, chunks[c], NULL);
+		}
+	});
+
+	unsigned long long totals[5] = { 0, 0, 0, 0, 0 };
+	for (size_t c = 0; c < chunkCount; c++)
+	{
+		OBJ_CHUNK& chunk = chunks[c];
+		chunk.firstLine = (uint32_t)totals[0];
+		chunk.firstPosition = (uint32_t)totals[1];
+		chunk.firstUV = (uint32_t)totals[2];
+		chunk.firstNormal = (uint32_t)totals[3];
+		chunk.firstCorner = (uint32_t)totals[4];
+		totals[0] += chunk.lineCount;
+		totals[1] += chunk.positionCount;
+		totals[2] += chunk.uvCount;
+		totals[3] += chunk.normalCount;
+		totals[4] += chunk.cornerCount;
+	}
+	if ((totals[0] > 0x7FFFFFFFull) || (totals[4] > 0x7FFFFFFFull))
+	{
+		std::cout << "Model file is too large:" << filename << std::endl;
+		return(false);
+	}
+
+	OBJ_VALUES values;
+	values.positions.resize((size_t)totals[1]);
+	values.uvs.resize((size_t)totals[2]);
+	values.normals.resize((size_t)totals[3]);
+	values.corners.resize((size_t)totals[4]);
+	ParallelFor(chunkCount, [&](int, size_t first, size_t last)
+	{
+		for (size_t c = first; c < last; c++)
+		{
+			ProcessObjChunk(pText, chunks[c], &values);
+		}
+	});
+
+	bool bUVs = false;
+	bool bNormals = false;
+	for (size_t c = 0; c < chunkCount; c++)
+	{
+		if (0 != chunks[c].errorLine)
+		{
+			std::cout << "Model file error:" << filename << ":" << chunks[c].errorLine << std::endl;
+			return(false);
+		}
+		bUVs = bUVs || chunks[c].bUVs;
+		bNormals = bNormals || chunks[c].bNormals;
+	}
+	file.Close();
+
+	// weld the corners into vertices, the vertices made from a
+	// position are chained so few of them are compared
+	std::vector<OBJ_CORNER> vertexCorners;
+	const std::vector<OBJ_CORNER>& corners = values.corners;
+	mesh.indices.resize(corners.size());
+	if (!bUVs && !bNormals)
+	{
+		vertexCorners.resize(values.positions.size());
+		for (size_t v = 0; v < vertexCorners.size(); v++)
+		{
+			vertexCorners[v].position = (int32_t)v;
+			vertexCorners[v].uv = -1;
+			vertexCorners[v].normal = -1;
+		}
+		for (size_t c = 0; c < corners.size(); c++)
+		{
+			mesh.indices[c] = (uint32_t)corners[c].position;
+		}
+	}
+	else
+	{
+		std::vector<uint32_t> firstVertex(values.positions.size(), UINT32_MAX);
+		std::vector<uint32_t> nextVertex;
+		vertexCorners.reserve(values.positions.size());
+		nextVertex.reserve(values.positions.size());
+		for (size_t c = 0; c < corners.size(); c++)
+		{
+			const OBJ_CORNER& corner = corners[c];
+			uint32_t vertex = firstVertex[corner.position];
+			while ((vertex != UINT32_MAX) &&
+				((vertexCorners[vertex].uv != corner.uv) || (vertexCorners[vertex].normal != corner.normal)))
+			{
+				vertex = nextVertex[vertex];
+			}
+			if (vertex == UINT32_MAX)
+			{
+				vertex = (uint32_t)vertexCorners.size();
+				vertexCorners.push_back(corner);
+				nextVertex.push_back(firstVertex[corner.position]);
+				firstVertex[corner.position] = vertex;
+			}
+			mesh.indices[c] = vertex;
+		}
+	}
+
+	mesh.vertices.resize(vertexCorners.size());
+	missing.resize(vertexCorners.size());
+	positionGroups.resize(vertexCorners.size());
+	positionCount = values.positions.size();
+	ParallelFor(vertexCorners.size(), [&](int, size_t first, size_t last)
+	{
+		for (size_t v = first; v < last; v++)
+		{
+			const OBJ_CORNER& corner = vertexCorners[v];
+			MESH_VERTEX& vertex = mesh.vertices[v];
+			const glm::vec3& position = values.positions[corner.position];
+			glm::vec3 normal = (corner.normal >= 0) ? values.normals[corner.normal] : glm::vec3(0.0f);
+			glm::vec2 uv = (corner.uv >= 0) ? values.uvs[corner.uv] : glm::vec2(0.0f);
+			for (int i = 0; i < 3; i++)
+			{
+				vertex.position[i] = position[i];
+				vertex.normal[i] = normal[i];
+				vertex.tangent[i] = 0.0f;
+			}
+			vertex.uv[0] = uv.x;
+			vertex.uv[1] = uv.y;
+			vertex.tangent[3] = 1.0f;
+			missing[v] = (uint8_t)(MISSING_TANGENT | ((corner.normal < 0) ? MISSING_NORMAL : 0));
+			positionGroups[v] = (uint32_t)corner.position;
+		}
+	});
+	return(true);
+}
+
+/***********************************************************
+ *  ImportGLTF()
+ *
+ *  This method is used for importing the triangle lists of
+ *  the meshes in the default scene of a glTF file, placed by
+ *  the transforms of their nodes.  The vertex and index
+ *  ranges of all the primitives are laid out first, then
+ *  converted from the accessors in parallel ranges, so a
+ *  single large primitive also uses all the workers.
+ ***********************************************************/
+bool MeshImporter::ImportGLTF(const std::string& filename, IMPORTED_MESH& mesh, std::vector<uint8_t>& missing)
+{
+	GLTF_DOCUMENT document;
+	if (!document.file.Open(filename))
+	{
+		std::cout << "Could not open model file:" << filename << std::endl;
+		return(false);
+	}
+
+	const unsigned char* pData = document.file.GetData();
+	size_t size = document.file.GetSize();
+	JSON_PARSER parser;
+	parser.p = (const char*)pData;
+	parser.pEnd = (const char*)pData + size;
+	GLTF_BUFFER binaryChunk = { NULL, 0 };
+
+	uint32_t magic = 0;
+	if (size >= 4)
+	{
+		memcpy(&magic, pData, 4);
+	}
+	if (magic == g_GlbMagic)
+	{
+		// header, then the JSON chunk and an optional binary chunk
+		uint32_t header[5];
+		if (size < sizeof(header))
+		{
+			std::cout << "Model file is not a valid glTF file:" << filename << std::endl;
+			return(false);
+		}
+		memcpy(header, pData, sizeof(header));
+		size_t jsonLength = header[3];
+		if ((header[1] != 2) || (header[4] != g_GlbJsonChunk) || (jsonLength > size - 20))
+		{
+			std::cout << "Model file is not a valid glTF 2.0 file:" << filename << std::endl;
+			return(false);
+		}
+		parser.p = (const char*)pData + 20;
+		parser.pEnd = parser.p + jsonLength;
+
+		size_t binaryOffset = 20 + ((jsonLength + 3) & ~(size_t)3);
+		if (binaryOffset + 8 <= size)
+		{
+			uint32_t chunkHeader[2];
+			memcpy(chunkHeader, pData + binaryOffset, sizeof(chunkHeader));
+			if ((chunkHeader[1] == g_GlbBinaryChunk) && (chunkHeader[0] <= size - binaryOffset - 8))
+			{
+				binaryChunk.pData = pData + binaryOffset + 8;
+				binaryChunk.size = chunkHeader[0];
+			}
+		}
+	}
+
+	if (!parser.ParseValue(document.root, 0) || (document.root.type != JSON_VALUE::JSON_OBJECT))
+	{
+		std::cout << "Model file has invalid JSON:" << filename << std::endl;
+		return(false);
+	}
+	const JSON_VALUE* pAsset = document.root.Find("asset");
+	const JSON_VALUE* pVersion = (NULL != pAsset) ? pAsset->Find("version") : NULL;
+	if ((NULL == pVersion) || (pVersion->text.compare(0, 2, "2.") != 0))
+	{
+		std::cout << "Model file is not a glTF 2.0 file:" << filename << std::endl;
+		return(false);
+	}
+	if (!LoadGltfBuffers(document, filename, binaryChunk))
+	{
+		return(false);
+	}
+
+	// the root nodes of the default scene, or of every node
+	// that is no child when the file has no scenes
+	const JSON_VALUE* pNodes = document.root.Find("nodes");
+	const JSON_VALUE* pMeshes = document.root.Find("meshes");
+	size_t nodeCount = (NULL != pNodes) ? pNodes->items.size() : 0;
+	std::vector<int> rootNodes;
+	const JSON_VALUE* pScenes = document.root.Find("scenes");
+	const JSON_VALUE* pScene = (NULL != pScenes) ? pScenes->At((size_t)document.root.GetInt("scene", 0)) : NULL;
+	if (NULL != pScene)
+	{
+		const JSON_VALUE* pSceneNodes = pScene->Find("nodes");
+		for (size_t i = 0; (NULL != pSceneNodes) && (i < pSceneNodes->items.size()); i++)
+		{
+			rootNodes.push_back((int)pSceneNodes->items[i].number);
+		}
+	}
+	else
+	{
+		std::vector<bool> bChild(nodeCount, false);
+		for (size_t n = 0; n < nodeCount; n++)
+		{
+			const JSON_VALUE* pChildren = pNodes->items[n].Find("children");
+			for (size_t i = 0; (NULL != pChildren) && (i < pChildren->items.size()); i++)
+			{
+				size_t child = (size_t)pChildren->items[i].number;
+				if (child < nodeCount)
+					bChild[child] = true;
+			}
+		}
+		for (size_t n = 0; n < nodeCount; n++)
+		{
+			if (!bChild[n])
+				rootNodes.push_back((int)n);
+		}
+	}
+
+	// walk the node tree, a node deeper than the node count
+	// can only be reached through a cycle
+	struct NODE_VISIT
+	{
+		int node;
+		glm::mat4 parent;
+		size_t depth;
+	};
+	std::vector<NODE_VISIT> stack;
+	for (size_t i = rootNodes.size(); i > 0; i--)
+	{
+		NODE_VISIT visit = { rootNodes[i - 1], glm::mat4(1.0f), 0 };
+		stack.push_back(visit);
+	}
+
+	std::vector<GLTF_PRIMITIVE> primitives;
+	size_t vertexTotal = 0;
+	size_t indexTotal = 0;
+	int skippedPrimitives = 0;
+	while (!stack.empty())
+	{
+		NODE_VISIT visit = stack.back();
+		stack.pop_back();
+		if ((visit.node < 0) || ((size_t)visit.node >= nodeCount) || (visit.depth > nodeCount))
+		{
+			std::cout << "Model file has an invalid node tree:" << filename << std::endl;
+			return(false);
+		}
+
+		const JSON_VALUE& node = pNodes->items[visit.node];
+		glm::mat4 world = visit.parent * GetNodeMatrix(node);
+		const JSON_VALUE* pChildren = node.Find("children");
+		for (size_t i = (NULL != pChildren) ? pChildren->items.size() : 0; i > 0; i--)
+		{
+			NODE_VISIT child = { (int)pChildren->items[i - 1].number, world, visit.depth + 1 };
+			stack.push_back(child);
+		}
+
+		const JSON_VALUE* pMesh = (NULL != pMeshes) ? pMeshes->At((size_t)node.GetInt("mesh", -1)) : NULL;
+		const JSON_VALUE* pPrimitives = (NULL != pMesh) ? pMesh->Find("primitives") : NULL;
+		for (size_t p = 0; (NULL != pPrimitives) && (p < pPrimitives->items.size()); p++)
+		{
+			const JSON_VALUE& source = pPrimitives->items[p];
+			const JSON_VALUE* pAttributes = source.Find("attributes");
+			if ((source.GetInt("mode", g_GltfTriangles) != g_GltfTriangles) || (NULL == pAttributes))
+			{
+				skippedPrimitives++;
+				continue;
+			}
+
+			GLTF_PRIMITIVE primitive;
+			if (!GetAccessor(document, pAttributes->GetInt("POSITION", -1), primitive.positions) ||
+				(primitive.positions.components != 3))
+			{
+				std::cout << "Model file has a primitive without usable positions:" << filename << std::endl;
+				return(false);
+			}
+			primitive.bNormals = GetAccessor(document, pAttributes->GetInt("NORMAL", -1), primitive.normals) &&
+				(primitive.normals.components == 3) && (primitive.normals.count == primitive.positions.count);
+			primitive.bTangents = GetAccessor(document, pAttributes->GetInt("TANGENT", -1), primitive.tangents) &&
+				(primitive.tangents.components == 4) && (primitive.tangents.count == primitive.positions.count);
+			primitive.bUVs = GetAccessor(document, pAttributes->GetInt("TEXCOORD_0", -1), primitive.uvs) &&
+				(primitive.uvs.components == 2) && (primitive.uvs.count == primitive.positions.count);
+			primitive.bIndices = false;
+			if (NULL != source.Find("indices"))
+			{
+				primitive.bIndices = GetAccessor(document, source.GetInt("indices", -1), primitive.indices);
+				if (!primitive.bIndices || (primitive.indices.components != 1) ||
+					((primitive.indices.componentType != g_GltfUnsignedByte) &&
+					(primitive.indices.componentType != g_GltfUnsignedShort) &&
+					(primitive.indices.componentType != g_GltfUnsignedInt)))
+				{
+					std::cout << "Model file has a primitive with unusable indices:" << filename << std::endl;
+					return(false);
+				}
+			}
+
+			primitive.world = world;
+			primitive.normalMatrix = glm::transpose(glm::inverse(glm::mat3(world)));
+			primitive.bMirrored = glm::determinant(glm::mat3(world)) < 0.0f;
+			primitive.firstVertex = vertexTotal;
+			primitive.vertexCount = primitive.positions.count;
+			primitive.firstIndex = indexTotal;
+			primitive.indexCount = (primitive.bIndices ? primitive.indices.count : primitive.vertexCount) / 3 * 3;
+			vertexTotal += primitive.vertexCount;
+			indexTotal += primitive.indexCount;
+			primitives.push_back(primitive);
+		}
+	}
+
+	if (skippedPrimitives > 0)
+	{
+		std::cout << "Skipped " << skippedPrimitives << " primitives that are not triangle lists in:" << filename << std::endl;
+	}
+	if (vertexTotal > (size_t)UINT32_MAX)
+	{
+		std::cout << "Model file is too large:" << filename << std::endl;
+		return(false);
+	}
+
+	mesh.vertices.resize(vertexTotal);
+	mesh.indices.resize(indexTotal);
+	missing.resize(vertexTotal);
+
+	// the primitive of each item is found by a search, so the
+	// ranges of the workers can split primitives
+	ParallelFor(vertexTotal, [&](int, size_t first, size_t last)
+	{
+		size_t p = 0;
+		while (primitives[p].firstVertex + primitives[p].vertexCount <= first)
+			p++;
+		for (size_t v = first; v < last; v++)
+		{
+			while (primitives[p].firstVertex + primitives[p].vertexCount <= v)
+				p++;
+			const GLTF_PRIMITIVE& primitive = primitives[p];
+			size_t element = v - primitive.firstVertex;
+			MESH_VERTEX& vertex = mesh.vertices[v];
+
+			glm::vec3 position(
+				ReadComponent(primitive.positions, element, 0),
+				ReadComponent(primitive.positions, element, 1),
+				ReadComponent(primitive.positions, element, 2));
+			position = glm::vec3(primitive.world * glm::vec4(position, 1.0f));
+			glm::vec3 normal(0.0f);
+			if (primitive.bNormals)
+			{
+				normal = glm::vec3(
+					ReadComponent(primitive.normals, element, 0),
+					ReadComponent(primitive.normals, element, 1),
+					ReadComponent(primitive.normals, element, 2));
+				normal = primitive.normalMatrix * normal;
+				float length = glm::length(normal);
+				normal = (length > 0.0f) ? normal / length : glm::vec3(0.0f, 1.0f, 0.0f);
+			}
+			glm::vec4 tangent(0.0f, 0.0f, 0.0f, 1.0f);
+			if (primitive.bTangents)
+			{
+				glm::vec3 direction(
+					ReadComponent(primitive.tangents, element, 0),
+					ReadComponent(primitive.tangents, element, 1),
+					ReadComponent(primitive.tangents, element, 2));
+				direction = glm::mat3(primitive.world) * direction;
+				float length = glm::length(direction);
+				direction = (length > 0.0f) ? direction / length : glm::vec3(1.0f, 0.0f, 0.0f);
+				float handedness = (ReadComponent(primitive.tangents, element, 3) < 0.0f) ? -1.0f : 1.0f;
+				tangent = glm::vec4(direction, primitive.bMirrored ? -handedness : handedness);
+			}
+			glm::vec2 uv(0.0f);
+			if (primitive.bUVs)
+			{
+				// glTF puts the texture origin at the top left and
+				// the images are loaded bottom up
+				uv.x = ReadComponent(primitive.uvs, element, 0);
+				uv.y = 1.0f - ReadComponent(primitive.uvs, element, 1);
+			}
+
+			for (int i = 0; i < 3; i++)
+			{
+				vertex.position[i] = position[i];
+				vertex.normal[i] = normal[i];
+				vertex.tangent[i] = tangent[i];
+			}
+			vertex.tangent[3] = tangent.w;
+			vertex.uv[0] = uv.x;
+			vertex.uv[1] = uv.y;
+			missing[v] = (uint8_t)((primitive.bNormals ? 0 : MISSING_NORMAL) | (primitive.bTangents ? 0 : MISSING_TANGENT));
+		}
+	});
+
+	std::atomic<bool> bBadIndex(false);
+	ParallelFor(indexTotal / 3, [&](int, size_t first, size_t last)
+	{
+		size_t p = 0;
+		for (size_t t = first; t < last; t++)
+		{
+			size_t index = t * 3;
+			while (primitives[p].firstIndex + primitives[p].indexCount <= index)
+				p++;
+			const GLTF_PRIMITIVE& primitive = primitives[p];
+			size_t element = index - primitive.firstIndex;
+			uint32_t corners[3];
+			for (int i = 0; i < 3; i++)
+			{
+				corners[i] = primitive.bIndices ? ReadIndex(primitive.indices, element + i) : (uint32_t)(element + i);
+				if (corners[i] >= primitive.vertexCount)
+				{
+					bBadIndex.store(true, std::memory_order_relaxed);
+					corners[i] = 0;
+				}
+			}
+			if (primitive.bMirrored)
+			{
+				std::swap(corners[1], corners[2]);
+			}
+			for (int i = 0; i < 3; i++)
+			{
+				mesh.indices[index + i] = corners[i] + (uint32_t)primitive.firstVertex;
+			}
+		}
+	});
+
+	if (bBadIndex.load())
+	{
+		std::cout << "Model file has an index out of range:" << filename << std::endl;
+		return(false);
+	}
+	return(true);
+}
+
+/***********************************************************
+ *  GenerateNormals()
+ *
+ *  This method is used for giving the vertices without a
+ *  normal the sum of the normals of the triangles around
+ *  them, weighted by the triangle area.  Vertices in the same
+ *  position group share the triangles of the whole group, so
+ *  they are smooth across texture seams.
+ ***********************************************************/
+void MeshImporter::GenerateNormals(
+	IMPORTED_MESH& mesh,
+	const std::vector<uint8_t>& missing,
+	const std::vector<uint32_t>& positionGroups,
+	size_t groupCount)
+{
+	size_t triangleCount = mesh.indices.size() / 3;
+	std::vector<glm::vec3> faceNormals(triangleCount);
+	ParallelFor(triangleCount, [&](int, size_t first, size_t last)
+	{
+		for (size_t t = first; t < last; t++)
+		{
+			glm::vec3 p0 = GetVertexPosition(mesh, mesh.indices[t * 3]);
+			glm::vec3 p1 = GetVertexPosition(mesh, mesh.indices[t * 3 + 1]);
+			glm::vec3 p2 = GetVertexPosition(mesh, mesh.indices[t * 3 + 2]);
+			// the length of the cross product is twice the area
+			faceNormals[t] = glm::cross(p1 - p0, p2 - p0);
+		}
+	});
+
+	std::vector<uint32_t> offsets;
+	std::vector<uint32_t> triangles;
+	BuildVertexTriangles(mesh, positionGroups, groupCount, offsets, triangles);
+
+	ParallelFor(mesh.vertices.size(), [&](int, size_t first, size_t last)
+	{
+		for (size_t v = first; v < last; v++)
+		{
+			if (!(missing[v] & MISSING_NORMAL))
+			{
+				continue;
+			}
+			uint32_t group = positionGroups.empty() ? (uint32_t)v : positionGroups[v];
+			glm::vec3 sum(0.0f);
+			for (uint32_t i = offsets[group]; i < offsets[group + 1]; i++)
+			{
+				sum += faceNormals[triangles[i]];
+			}
+			float length = glm::length(sum);
+			glm::vec3 normal = (length > 0.0f) ? sum / length : glm::vec3(0.0f, 1.0f, 0.0f);
+			for (int i = 0; i < 3; i++)
+			{
+				mesh.vertices[v].normal[i] = normal[i];
+			}
+		}
+	});
+}
+
+/***********************************************************
+ *  GenerateTangents()
+ *
+ *  This method is used for giving the vertices without a
+ *  tangent the direction the u texture coordinate increases
+ *  in across the triangles around them, made perpendicular
+ *  to the normal.  The w is -1 where the v direction is
+ *  mirrored.  Without texture coordinates any direction
+ *  perpendicular to the normal is used.
+ ***********************************************************/
+void MeshImporter::GenerateTangents(IMPORTED_MESH& mesh, const std::vector<uint8_t>& missing)
+{
+	size_t triangleCount = mesh.indices.size() / 3;
+	std::vector<glm::vec3> faceTangents(triangleCount);
+	std::vector<glm::vec3> faceBitangents(triangleCount);
+	ParallelFor(triangleCount, [&](int, size_t first, size_t last)
+	{
+		for (size_t t = first; t < last; t++)
+		{
+			const MESH_VERTEX& v0 = mesh.vertices[mesh.indices[t * 3]];
+			const MESH_VERTEX& v1 = mesh.vertices[mesh.indices[t * 3 + 1]];
+			const MESH_VERTEX& v2 = mesh.vertices[mesh.indices[t * 3 + 2]];
+			glm::vec3 edge1 = glm::make_vec3(v1.position) - glm::make_vec3(v0.position);
+			glm::vec3 edge2 = glm::make_vec3(v2.position) - glm::make_vec3(v0.position);
+			glm::vec2 uvEdge1 = glm::make_vec2(v1.uv) - glm::make_vec2(v0.uv);
+			glm::vec2 uvEdge2 = glm::make_vec2(v2.uv) - glm::make_vec2(v0.uv);
+
+			// the sum keeps the area weighting of the triangles,
+			// so the determinant only gives the sign
+			float determinant = uvEdge1.x * uvEdge2.y - uvEdge2.x * uvEdge1.y;
+			if (determinant == 0.0f)
+			{
+				faceTangents[t] = glm::vec3(0.0f);
+				faceBitangents[t] = glm::vec3(0.0f);
+				continue;
+			}
+			float sign = (determinant < 0.0f) ? -1.0f : 1.0f;
+			faceTangents[t] = (edge1 * uvEdge2.y - edge2 * uvEdge1.y) * sign;
+			faceBitangents[t] = (edge2 * uvEdge1.x - edge1 * uvEdge2.x) * sign;
+		}
+	});
+
+	std::vector<uint32_t> offsets;
+	std::vector<uint32_t> triangles;
+	BuildVertexTriangles(mesh, std::vector<uint32_t>(), mesh.vertices.size(), offsets, triangles);
+
+	ParallelFor(mesh.vertices.size(), [&](int, size_t first, size_t last)
+	{
+		for (size_t v = first; v < last; v++)
+		{
+			if (!(missing[v] & MISSING_TANGENT))
+			{
+				continue;
+			}
+			glm::vec3 tangent(0.0f);
+			glm::vec3 bitangent(0.0f);
+			for (uint32_t i = offsets[v]; i < offsets[v + 1]; i++)
+			{
+				tangent += faceTangents[triangles[i]];
+				bitangent += faceBitangents[triangles[i]];
+			}
+
+			MESH_VERTEX& vertex = mesh.vertices[v];
+			glm::vec3 normal = glm::make_vec3(vertex.normal);
+			tangent -= normal * glm::dot(normal, tangent);
+			float length = glm::length(tangent);
+			float handedness = 1.0f;
+			if (length > 1e-12f)
+			{
+				tangent /= length;
+				handedness = (glm::dot(glm::cross(normal, tangent), bitangent) < 0.0f) ? -1.0f : 1.0f;
+			}
+			else
+			{
+				glm::vec3 axis = (std::fabs(normal.x) < 0.9f) ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+				tangent = glm::normalize(axis - normal * glm::dot(normal, axis));
+			}
+			for (int i = 0; i < 3; i++)
+			{
+				vertex.tangent[i] = tangent[i];
+			}
+			vertex.tangent[3] = handedness;
+		}
+	});
+}
+
+/***********************************************************
+ *  ComputeBounds()
+ *
+ *  This method is used for finding the axis aligned bounds
+ *  of the vertices, each worker over its own range.
+ ***********************************************************/
+void MeshImporter::ComputeBounds(IMPORTED_MESH& mesh)
+{
+	int workerCount = GetWorkerCount();
+	std::vector<glm::vec3> workerMin(workerCount, glm::vec3(FLT_MAX));
+	std::vector<glm::vec3> workerMax(workerCount, glm::vec3(-FLT_MAX));
+	ParallelFor(mesh.vertices.size(), [&](int worker, size_t first, size_t last)
+	{
+		glm::vec3 minXYZ(FLT_MAX);
+		glm::vec3 maxXYZ(-FLT_MAX);
+		for (size_t v = first; v < last; v++)
+		{
+			glm::vec3 position = glm::make_vec3(mesh.vertices[v].position);
+			minXYZ = glm::min(minXYZ, position);
+			maxXYZ = glm::max(maxXYZ, position);
+		}
+		workerMin[worker] = minXYZ;
+		workerMax[worker] = maxXYZ;
+	});
+
+	mesh.boundsMin = glm::vec3(FLT_MAX);
+	mesh.boundsMax = glm::vec3(-FLT_MAX);
+	for (int w = 0; w < workerCount; w++)
+	{
+		mesh.boundsMin = glm::min(mesh.boundsMin, workerMin[w]);
+		mesh.boundsMax = glm::max(mesh.boundsMax, workerMax[w]);
+	}
+	if (mesh.vertices.empty())
+	{
+		mesh.boundsMin = glm::vec3(0.0f);
+		mesh.boundsMax = glm::vec3(0.0f);
+	}
+}
+
+/***********************************************************
+ *  GetWorkerCount()
+ *
+ *  This method is used for getting the number of threads
+ *  that work on an import.
+ ***********************************************************/
+int MeshImporter::GetWorkerCount() const
+{
+	if (m_threadCount > 0)
+	{
+		return(m_threadCount);
+	}
+	return(std::max((int)std::thread::hardware_concurrency(), 1));
+}
+
+/***********************************************************
+ *  ParallelFor()
+ *
+ *  This method is used for splitting the items into one
+ *  contiguous range per worker and running the ranges at
+ *  the same time, the first one on the calling thread.
+ ***********************************************************/
+void MeshImporter::ParallelFor(size_t count, const RangeFunc& func) const
+{
+	if (0 == count)
+	{
+		return;
+	}
+
+	size_t workerCount = std::min((size_t)GetWorkerCount(), count);
+	std::vector<std::thread> threads;
+	threads.reserve(workerCount - 1);
+	for (size_t w = 1; w < workerCount; w++)
+	{
+		threads.push_back(std::thread(func, (int)w, count * w / workerCount, count * (w + 1) / workerCount));
+	}
+	func(0, 0, count / workerCount);
+	for (size_t i = 0; i < threads.size(); i++)
+	{
+		threads[i].join();
+	}
+}
@@ -0,0 +1,113 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshimporter.h
+// ============
+// import OBJ and glTF 2.0 model files on several threads
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// vertex of an imported model, laid out as the vertex buffer
+// and the cooked mesh cache store it.  The tangent w is the
+// handedness of the bitangent, cross(normal, tangent) * w.
+struct MESH_VERTEX
+{
+	float position[3];
+	float normal[3];
+	float uv[2];
+	float tangent[4];
+};
+
+static_assert(sizeof(MESH_VERTEX) == 48, "mesh vertex must be packed");
+
+/***********************************************************
+ *  IMPORTED_MESH
+ *
+ *  An indexed triangle list with the object space bounds of
+ *  its vertices.
+ ***********************************************************/
+struct IMPORTED_MESH
+{
+	std::vector<MESH_VERTEX> vertices;
+	std::vector<uint32_t> indices;
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+};
+
+/***********************************************************
+ *  MeshImporter
+ *
+ *  This class reads OBJ and glTF 2.0 (.gltf and .glb) files
+ *  into one indexed triangle list.  An OBJ file is mapped and
+ *  cut into chunks at line ends, which are counted and then
+ *  parsed by all the workers at once, so the time goes down
+ *  with the number of cores instead of the single stream a
+ *  generic loader reads.  The glTF vertices and indices are
+ *  converted in parallel ranges from the mapped buffers.
+ *  Normals and tangents the file does not have are generated,
+ *  area weighted normals from the triangles around a vertex
+ *  and tangents from the texture coordinate directions.
+ *
+ *  Only the triangles, positions, normals, tangents and the
+ *  first texture coordinate are imported, materials, skins
+ *  and animations are left out.
+ ***********************************************************/
+class MeshImporter
+{
+public:
+	// constructor
+	MeshImporter();
+	// destructor
+	~MeshImporter();
+
+	// set the worker threads, 0 for one per hardware thread
+	void SetThreadCount(int threadCount);
+	// import a model file, by the extension of its name
+	bool Import(const std::string& filename, IMPORTED_MESH& mesh);
+	// true for the name of a file Import() can read
+	static bool IsModelFilename(const std::string& filename);
+
+private:
+	// what the file left out for a vertex
+	enum VERTEX_MISSING
+	{
+		MISSING_NORMAL = 1,
+		MISSING_TANGENT = 2
+	};
+
+	// runs on a worker for a range of items
+	typedef std::function<void(int worker, size_t first, size_t last)> RangeFunc;
+
+	int m_threadCount;
+
+	// the OBJ vertices also get the position they were made from
+	bool ImportOBJ(
+		const std::string& filename,
+		IMPORTED_MESH& mesh,
+		std::vector<uint8_t>& missing,
+		std::vector<uint32_t>& positionGroups,
+		size_t& positionCount);
+	bool ImportGLTF(const std::string& filename, IMPORTED_MESH& mesh, std::vector<uint8_t>& missing);
+
+	// fill in the vertex values the file did not have, normals
+	// are shared by the vertices in a position group, each
+	// vertex is its own group when there are none
+	void GenerateNormals(
+		IMPORTED_MESH& mesh,
+		const std::vector<uint8_t>& missing,
+		const std::vector<uint32_t>& positionGroups,
+		size_t groupCount);
+	void GenerateTangents(IMPORTED_MESH& mesh, const std::vector<uint8_t>& missing);
+	void ComputeBounds(IMPORTED_MESH& mesh);
+
+	// split the items into one range per worker and run them
+	int GetWorkerCount() const;
+	void ParallelFor(size_t count, const RangeFunc& func) const;
+};
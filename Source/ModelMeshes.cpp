@@ -0,0 +1,256 @@
+///////////////////////////////////////////////////////////////////////////////
+// modelmeshes.cpp
+// ============
+// load imported models into GPU buffers and draw them
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ModelMeshes.h"
+#include "MeshCache.h"
+#include "GLTrace.h"
+#include "ResourceTracker.h"
+
+#include <cstddef>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// subsystem the buffers are reported under
+	const char* g_TrackerName = "models";
+}
+
+/***********************************************************
+ *  ModelMeshes()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ModelMeshes::ModelMeshes()
+{
+	m_threadCount = 0;
+}
+
+/***********************************************************
+ *  ~ModelMeshes()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ModelMeshes::~ModelMeshes()
+{
+	DestroyAll();
+}
+
+/***********************************************************
+ *  SetThreadCount()
+ *
+ *  This method is used for setting how many threads import
+ *  a model file that has no cooked file yet.
+ ***********************************************************/
+void ModelMeshes::SetThreadCount(int threadCount)
+{
+	m_threadCount = threadCount;
+}
+
+/***********************************************************
+ *  LoadModel()
+ *
+ *  This method is used for creating the buffers of a model.
+ *  The cooked file is mapped and its vertices and indices
+ *  are copied by the driver straight from the mapping, then
+ *  it is unmapped again, so no copy stays in host memory.
+ ***********************************************************/
+int ModelMeshes::LoadModel(const std::string& filename)
+{
+	for (size_t i = 0; i < m_models.size(); i++)
+	{
+		if (m_models[i].filename == filename)
+			return((int)i);
+	}
+
+	MeshCache cache;
+	if (!cache.Load(filename, m_threadCount))
+	{
+		return(-1);
+	}
+
+	int model = CreateModel(filename, cache.GetVertices(), cache.GetVertexCount(), cache.GetIndices(), cache.GetIndexCount(),
+		cache.GetBoundsMin(), cache.GetBoundsMax());
+	std::cout << "Loaded model: " << filename << " (" << cache.GetIndexCount() / 3 << " triangles)" << std::endl;
+	return(model);
+}
+
+/***********************************************************
+ *  CreateModel()
+ *
+ *  This method is used for creating the buffers of a model
+ *  built in memory, with the attribute layout of the loaded
+ *  models.
+ ***********************************************************/
+int ModelMeshes::CreateModel(
+	const std::string& name,
+	const MESH_VERTEX* pVertices,
+	uint32_t vertexCount,
+	const uint32_t* pIndices,
+	uint32_t indexCount,
+	const glm::vec3& boundsMin,
+	const glm::vec3& boundsMax)
+{
+	MODEL_MESH model;
+	model.filename = name;
+
+	// bound through the trace layer, which skips binding a
+	// vertex array it thinks is still bound
+	glGenVertexArrays(1, &model.vertexArray);
+	GLTrace::BindVertexArray(model.vertexArray);
+	glGenBuffers(1, &model.vertexBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, model.vertexBuffer);
+	glGenBuffers(1, &model.indexBuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, model.indexBuffer);
+
+	GLsizei stride = sizeof(MESH_VERTEX);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(MESH_VERTEX, position));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(MESH_VERTEX, normal));
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(MESH_VERTEX, uv));
+	glEnableVertexAttribArray(3);
+	glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(MESH_VERTEX, tangent));
+
+	m_models.push_back(model);
+	int index = (int)m_models.size() - 1;
+	// the vertex array keeps the index buffer binding, so the
+	// buffers are filled while it is still bound
+	UploadModel(m_models[index], pVertices, vertexCount, pIndices, indexCount, boundsMin, boundsMax);
+	GLTrace::BindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	return(index);
+}
+
+/***********************************************************
+ *  UpdateModel()
+ *
+ *  This method is used for replacing the vertices and
+ *  indices of a model, keeping its index and vertex array.
+ ***********************************************************/
+bool ModelMeshes::UpdateModel(
+	int model,
+	const MESH_VERTEX* pVertices,
+	uint32_t vertexCount,
+	const uint32_t* pIndices,
+	uint32_t indexCount,
+	const glm::vec3& boundsMin,
+	const glm::vec3& boundsMax)
+{
+	if ((model < 0) || (model >= (int)m_models.size()))
+	{
+		return(false);
+	}
+
+	GLTrace::BindVertexArray(m_models[model].vertexArray);
+	UploadModel(m_models[model], pVertices, vertexCount, pIndices, indexCount, boundsMin, boundsMax);
+	GLTrace::BindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	return(true);
+}
+
+/***********************************************************
+ *  UploadModel()
+ *
+ *  This method is used for filling the buffers of a model,
+ *  with its vertex array bound, and reporting their size.
+ ***********************************************************/
+void ModelMeshes::UploadModel(
+	MODEL_MESH& model,
+	const MESH_VERTEX* pVertices,
+	uint32_t vertexCount,
+	const uint32_t* pIndices,
+	uint32_t indexCount,
+	const glm::vec3& boundsMin,
+	const glm::vec3& boundsMax)
+{
+	size_t vertexBytes = (size_t)vertexCount * sizeof(MESH_VERTEX);
+	size_t indexBytes = (size_t)indexCount * sizeof(uint32_t);
+
+	glBindBuffer(GL_ARRAY_BUFFER, model.vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, vertexBytes, pVertices, GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, model.indexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBytes, pIndices, GL_STATIC_DRAW);
+
+	model.indexCount = indexCount;
+	model.boundsMin = boundsMin;
+	model.boundsMax = boundsMax;
+
+	ResourceTracker::Release(RESOURCE_BUFFER, model.vertexBuffer);
+	ResourceTracker::Release(RESOURCE_BUFFER, model.indexBuffer);
+	ResourceTracker::Track(RESOURCE_BUFFER, model.vertexBuffer, g_TrackerName, model.filename.c_str(), vertexBytes);
+	ResourceTracker::Track(RESOURCE_BUFFER, model.indexBuffer, g_TrackerName, model.filename.c_str(), indexBytes);
+}
+
+/***********************************************************
+ *  DestroyAll()
+ *
+ *  This method is used for deleting the buffers and vertex
+ *  arrays of all the models.
+ ***********************************************************/
+void ModelMeshes::DestroyAll()
+{
+	if (!m_models.empty())
+	{
+		GLTrace::BindVertexArray(0);
+	}
+	for (size_t i = 0; i < m_models.size(); i++)
+	{
+		MODEL_MESH& model = m_models[i];
+		ResourceTracker::Release(RESOURCE_BUFFER, model.vertexBuffer);
+		ResourceTracker::Release(RESOURCE_BUFFER, model.indexBuffer);
+		glDeleteBuffers(1, &model.vertexBuffer);
+		glDeleteBuffers(1, &model.indexBuffer);
+		glDeleteVertexArrays(1, &model.vertexArray);
+	}
+	m_models.clear();
+}
+
+/***********************************************************
+ *  DrawModel()
+ *
+ *  This method is used for drawing the triangles of a model
+ *  with the bound program.
+ ***********************************************************/
+void ModelMeshes::DrawModel(int model) const
+{
+	if ((model < 0) || (model >= (int)m_models.size()))
+	{
+		return;
+	}
+
+	const MODEL_MESH& mesh = m_models[model];
+	GLTrace::BindVertexArray(mesh.vertexArray);
+	GLTrace::DrawElements(GL_TRIANGLES, (GLsizei)mesh.indexCount, GL_UNSIGNED_INT, 0);
+}
+
+/***********************************************************
+ *  GetBounds()
+ ***********************************************************/
+void ModelMeshes::GetBounds(int model, glm::vec3& minXYZ, glm::vec3& maxXYZ) const
+{
+	if ((model < 0) || (model >= (int)m_models.size()))
+	{
+		minXYZ = glm::vec3(0.0f);
+		maxXYZ = glm::vec3(0.0f);
+		return;
+	}
+	minXYZ = m_models[model].boundsMin;
+	maxXYZ = m_models[model].boundsMax;
+}
+
+/***********************************************************
+ *  GetTriangleCount()
+ ***********************************************************/
+uint32_t ModelMeshes::GetTriangleCount(int model) const
+{
+	if ((model < 0) || (model >= (int)m_models.size()))
+	{
+		return(0);
+	}
+	return(m_models[model].indexCount / 3);
+}
@@ -0,0 +1,96 @@
+///////////////////////////////////////////////////////////////////////////////
+// modelmeshes.h
+// ============
+// load imported models into GPU buffers and draw them
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MeshImporter.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  ModelMeshes
+ *
+ *  This class owns the vertex and index buffers of the
+ *  models loaded from OBJ and glTF files.  Each model goes
+ *  through its cooked mesh file, which is mapped and handed
+ *  to OpenGL as it is.  The vertex arrays use the attribute
+ *  locations of the basic shape meshes, position, normal and
+ *  texture coordinate, with the tangent at location 3.
+ ***********************************************************/
+class ModelMeshes
+{
+public:
+	// constructor
+	ModelMeshes();
+	// destructor
+	~ModelMeshes();
+
+	// set the threads importing a model that is not cooked yet,
+	// 0 for one per hardware thread
+	void SetThreadCount(int threadCount);
+	// load a model file, returns the index of the model or -1.
+	// A file already loaded returns the index it has
+	int LoadModel(const std::string& filename);
+	// create a model from vertices and indices in memory under
+	// a name, returns the index of the model
+	int CreateModel(
+		const std::string& name,
+		const MESH_VERTEX* pVertices,
+		uint32_t vertexCount,
+		const uint32_t* pIndices,
+		uint32_t indexCount,
+		const glm::vec3& boundsMin,
+		const glm::vec3& boundsMax);
+	// replace the vertices and indices of a model
+	bool UpdateModel(
+		int model,
+		const MESH_VERTEX* pVertices,
+		uint32_t vertexCount,
+		const uint32_t* pIndices,
+		uint32_t indexCount,
+		const glm::vec3& boundsMin,
+		const glm::vec3& boundsMax);
+	// delete the buffers of all the models
+	void DestroyAll();
+
+	// draw a model with the bound program
+	void DrawModel(int model) const;
+
+	int GetModelCount() const { return (int)m_models.size(); }
+	// object space bounds and triangles of a model
+	void GetBounds(int model, glm::vec3& minXYZ, glm::vec3& maxXYZ) const;
+	uint32_t GetTriangleCount(int model) const;
+
+private:
+	struct MODEL_MESH
+	{
+		std::string filename;
+		GLuint vertexArray;
+		GLuint vertexBuffer;
+		GLuint indexBuffer;
+		uint32_t indexCount;
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+	};
+
+	std::vector<MODEL_MESH> m_models;
+	int m_threadCount;
+
+	// fill the buffers of a model with its vertex array bound
+	void UploadModel(
+		MODEL_MESH& model,
+		const MESH_VERTEX* pVertices,
+		uint32_t vertexCount,
+		const uint32_t* pIndices,
+		uint32_t indexCount,
+		const glm::vec3& boundsMin,
+		const glm::vec3& boundsMax);
+};
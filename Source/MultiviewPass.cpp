@@ -0,0 +1,319 @@
+///////////////////////////////////////////////////////////////////////////////
+// multiviewpass.cpp
+// ============
+// draw several views of the scene in one pass with viewport arrays
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MultiviewPass.h"
+#include "AnimationManager.h"
+#include "GLTrace.h"
+#include "ResourceTracker.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// declaration of global variables
+namespace
+{
+	const char* g_ViewName = "view";
+	const char* g_ProjectionName = "projection";
+	const int g_ViewCountName = GLTrace::RegisterName("viewCount");
+
+	/***********************************************************
+	 *  GetViewProjectionName()
+	 *
+	 *  This function is used for getting the handle of the
+	 *  view projection uniform of a view, the names are only
+	 *  built the first time.
+	 ***********************************************************/
+	int GetViewProjectionName(int view)
+	{
+		static int names[MultiviewPass::MAX_VIEWS] = {};
+		static bool bRegistered = false;
+		if (!bRegistered)
+		{
+			for (int i = 0; i < MultiviewPass::MAX_VIEWS; i++)
+			{
+				names[i] = GLTrace::RegisterName(("viewProjections[" + std::to_string(i) + "]").c_str());
+			}
+			bRegistered = true;
+		}
+		return(names[view]);
+	}
+}
+
+// std::min() takes it by reference, which needs its storage
+// before C++17
+constexpr int MultiviewPass::MAX_VIEWS;
+
+/***********************************************************
+ *  MultiviewPass()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+MultiviewPass::MultiviewPass()
+{
+	m_pShader = NULL;
+	m_pDepthShader = NULL;
+}
+
+/***********************************************************
+ *  ~MultiviewPass()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+MultiviewPass::~MultiviewPass()
+{
+	if (NULL != m_pShader)
+	{
+		ResourceTracker::Release(RESOURCE_PROGRAM, m_pShader->m_programID);
+		delete m_pShader;
+		m_pShader = NULL;
+	}
+	if (NULL != m_pDepthShader)
+	{
+		ResourceTracker::Release(RESOURCE_PROGRAM, m_pDepthShader->m_programID);
+		delete m_pDepthShader;
+		m_pDepthShader = NULL;
+	}
+}
+
+/***********************************************************
+ *  IsSupported()
+ *
+ *  This method is used for checking for viewport arrays and
+ *  instanced geometry shaders.
+ ***********************************************************/
+bool MultiviewPass::IsSupported()
+{
+	if (GLEW_VERSION_4_1)
+	{
+		return(true);
+	}
+	return(GLEW_ARB_viewport_array && GLEW_ARB_gpu_shader5);
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for loading the multiview versions
+ *  of the lighting and the depth shaders.  Their vertex
+ *  shaders are the regular ones, run with identity view and
+ *  projection matrices so the geometry shader gets world
+ *  positions.
+ ***********************************************************/
+bool MultiviewPass::Initialize()
+{
+	if (!IsSupported())
+	{
+		std::cout << "Views are drawn one at a time: viewport arrays are not supported" << std::endl;
+		return(false);
+	}
+
+	m_pShader = LoadShaders(
+		"vertexShader.glsl",
+		"multiviewGeometryShader.glsl",
+		"fragmentShader.glsl");
+	m_pDepthShader = LoadShaders(
+		"depthVertexShader.glsl",
+		"multiviewDepthGeometryShader.glsl",
+		"depthFragmentShader.glsl");
+	if ((NULL == m_pShader) || (NULL == m_pDepthShader))
+	{
+		std::cout << "Views are drawn one at a time: the multiview shaders failed to load" << std::endl;
+		return(false);
+	}
+
+	ShaderManager* shaders[2] = { m_pShader, m_pDepthShader };
+	for (int i = 0; i < 2; i++)
+	{
+		shaders[i]->use();
+		shaders[i]->setMat4Value(g_ViewName, glm::mat4(1.0f));
+		shaders[i]->setMat4Value(g_ProjectionName, glm::mat4(1.0f));
+		AnimationManager::BindShader(shaders[i]);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  WatchShaders()
+ *
+ *  This method is used for having the multiview shaders
+ *  rebuilt when one of their files changes.  The view and
+ *  projection matrices and the animation block are set
+ *  again as Initialize() set them.
+ ***********************************************************/
+void MultiviewPass::WatchShaders(HotReload* pHotReload, const HotReload::ProgramFunc& onReload)
+{
+	HotReload::ProgramFunc onDepthReload = [](ShaderManager* pShader)
+	{
+		pShader->setMat4Value(g_ViewName, glm::mat4(1.0f));
+		pShader->setMat4Value(g_ProjectionName, glm::mat4(1.0f));
+		AnimationManager::BindShader(pShader);
+	};
+	HotReload::ProgramFunc onColorReload = [onDepthReload, onReload](ShaderManager* pShader)
+	{
+		onDepthReload(pShader);
+		onReload(pShader);
+	};
+
+	pHotReload->WatchProgram(m_pShader,
+		"vertexShader.glsl", "multiviewGeometryShader.glsl", "fragmentShader.glsl", "multiview", onColorReload);
+	pHotReload->WatchProgram(m_pDepthShader,
+		"depthVertexShader.glsl", "multiviewDepthGeometryShader.glsl", "depthFragmentShader.glsl", "multiview", onDepthReload);
+}
+
+/***********************************************************
+ *  Begin()
+ *
+ *  This method is used for setting one viewport per view
+ *  inside the target viewport and passing the view
+ *  projections to both multiview shaders.  The depth shader
+ *  is left bound.
+ ***********************************************************/
+void MultiviewPass::Begin(const RENDER_VIEW* pViews, int viewCount, const GLint targetViewport[4])
+{
+	viewCount = std::min(viewCount, MAX_VIEWS);
+	for (int i = 0; i < viewCount; i++)
+	{
+		const glm::vec4& viewport = pViews[i].viewport;
+		GLTrace::ViewportIndexed((GLuint)i,
+			(float)targetViewport[0] + viewport.x * (float)targetViewport[2],
+			(float)targetViewport[1] + viewport.y * (float)targetViewport[3],
+			viewport.z * (float)targetViewport[2],
+			viewport.w * (float)targetViewport[3]);
+	}
+
+	SetViews(m_pShader, pViews, viewCount);
+	SetViews(m_pDepthShader, pViews, viewCount);
+}
+
+/***********************************************************
+ *  End()
+ *
+ *  This method is used for setting all the viewports back
+ *  to the target viewport.
+ ***********************************************************/
+void MultiviewPass::End(const GLint targetViewport[4])
+{
+	GLTrace::Viewport(targetViewport[0], targetViewport[1], targetViewport[2], targetViewport[3]);
+}
+
+/***********************************************************
+ *  SetViews()
+ *
+ *  This method is used for binding the shader and passing
+ *  the view projection matrices of the views into it.
+ ***********************************************************/
+void MultiviewPass::SetViews(ShaderManager* pShader, const RENDER_VIEW* pViews, int viewCount)
+{
+	GLTrace::UseProgram(pShader);
+	for (int i = 0; i < viewCount; i++)
+	{
+		GLTrace::SetMat4(pShader, GetViewProjectionName(i), pViews[i].projection * pViews[i].view);
+	}
+	GLTrace::SetInt(pShader, g_ViewCountName, viewCount);
+}
+
+/***********************************************************
+ *  LoadShaders()
+ *
+ *  This method is used for compiling the three shader files
+ *  and linking them into a program.  The program is wrapped
+ *  in a shader manager so it is used like the others.
+ ***********************************************************/
+ShaderManager* MultiviewPass::LoadShaders(
+	const char* vertexFilename,
+	const char* geometryFilename,
+	const char* fragmentFilename)
+{
+	GLuint shaders[3] = {
+		CompileShader(GL_VERTEX_SHADER, vertexFilename),
+		CompileShader(GL_GEOMETRY_SHADER, geometryFilename),
+		CompileShader(GL_FRAGMENT_SHADER, fragmentFilename) };
+
+	GLuint programID = glCreateProgram();
+	for (int i = 0; i < 3; i++)
+	{
+		if (0 != shaders[i])
+		{
+			glAttachShader(programID, shaders[i]);
+		}
+	}
+	glLinkProgram(programID);
+
+	GLint bLinked = GL_FALSE;
+	glGetProgramiv(programID, GL_LINK_STATUS, &bLinked);
+	if (GL_TRUE != bLinked)
+	{
+		GLint logLength = 0;
+		glGetProgramiv(programID, GL_INFO_LOG_LENGTH, &logLength);
+		std::vector<char> log(std::max(logLength, 1), '\0');
+		glGetProgramInfoLog(programID, (GLsizei)log.size(), NULL, log.data());
+		std::cout << "Failed to link " << geometryFilename << ": " << log.data() << std::endl;
+	}
+
+	for (int i = 0; i < 3; i++)
+	{
+		if (0 != shaders[i])
+		{
+			glDetachShader(programID, shaders[i]);
+			glDeleteShader(shaders[i]);
+		}
+	}
+
+	if (GL_TRUE != bLinked)
+	{
+		glDeleteProgram(programID);
+		return(NULL);
+	}
+
+	ShaderManager* pShader = new ShaderManager();
+	pShader->m_programID = programID;
+	ResourceTracker::TrackProgram(programID, "multiview", fragmentFilename);
+	return(pShader);
+}
+
+/***********************************************************
+ *  CompileShader()
+ *
+ *  This method is used for reading a shader file and
+ *  compiling it.  Returns 0 when either fails.
+ ***********************************************************/
+GLuint MultiviewPass::CompileShader(GLenum type, const char* filename)
+{
+	std::ifstream file(filename);
+	if (!file)
+	{
+		std::cout << "Failed to open shader file: " << filename << std::endl;
+		return(0);
+	}
+	std::stringstream stream;
+	stream << file.rdbuf();
+	std::string source = stream.str();
+	const char* pSource = source.c_str();
+
+	GLuint shaderID = glCreateShader(type);
+	glShaderSource(shaderID, 1, &pSource, NULL);
+	glCompileShader(shaderID);
+
+	GLint bCompiled = GL_FALSE;
+	glGetShaderiv(shaderID, GL_COMPILE_STATUS, &bCompiled);
+	if (GL_TRUE != bCompiled)
+	{
+		GLint logLength = 0;
+		glGetShaderiv(shaderID, GL_INFO_LOG_LENGTH, &logLength);
+		std::vector<char> log(std::max(logLength, 1), '\0');
+		glGetShaderInfoLog(shaderID, (GLsizei)log.size(), NULL, log.data());
+		std::cout << "Failed to compile " << filename << ": " << log.data() << std::endl;
+		glDeleteShader(shaderID);
+		return(0);
+	}
+
+	return(shaderID);
+}
@@ -0,0 +1,69 @@
+///////////////////////////////////////////////////////////////////////////////
+// multiviewpass.h
+// ============
+// draw several views of the scene in one pass with viewport arrays
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+#include "RenderQueue.h"
+#include "HotReload.h"
+
+#include <GL/glew.h>
+
+/***********************************************************
+ *  MultiviewPass
+ *
+ *  This class holds versions of the lighting and the depth
+ *  pre-pass shaders with a geometry shader that sends every
+ *  triangle to up to MAX_VIEWS viewports, one instanced
+ *  invocation per view.  The draw commands are then issued
+ *  once for all the views instead of once per view.  Needs
+ *  viewport arrays and geometry shader instancing (OpenGL
+ *  4.1); without them the views are drawn one at a time.
+ ***********************************************************/
+class MultiviewPass
+{
+public:
+	// must match MAX_VIEWS in the multiview geometry shaders
+	static constexpr int MAX_VIEWS = 4;
+
+	// constructor
+	MultiviewPass();
+	// destructor
+	~MultiviewPass();
+
+	// true when the OpenGL context can draw views in one pass
+	static bool IsSupported();
+
+	// load the multiview shaders - needs a current OpenGL context
+	bool Initialize();
+	// rebuild the shaders when their files change, the callback
+	// sets the lighting uniforms of the color shader
+	void WatchShaders(HotReload* pHotReload, const HotReload::ProgramFunc& onReload);
+
+	// direct the following draws into the viewports of the
+	// views, the target is the viewport holding all of them
+	void Begin(const RENDER_VIEW* pViews, int viewCount, const GLint targetViewport[4]);
+	// set the viewport of the target again
+	void End(const GLint targetViewport[4]);
+
+	// the shaders to draw with between Begin() and End()
+	ShaderManager* GetShader() const { return m_pShader; }
+	ShaderManager* GetDepthShader() const { return m_pDepthShader; }
+
+private:
+	ShaderManager* m_pShader;
+	ShaderManager* m_pDepthShader;
+
+	// build a shader program from a vertex, a geometry and a
+	// fragment shader file
+	static ShaderManager* LoadShaders(
+		const char* vertexFilename,
+		const char* geometryFilename,
+		const char* fragmentFilename);
+	static GLuint CompileShader(GLenum type, const char* filename);
+	// pass the view projections to the bound shader
+	static void SetViews(ShaderManager* pShader, const RENDER_VIEW* pViews, int viewCount);
+};
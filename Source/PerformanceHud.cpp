@@ -0,0 +1,668 @@
+///////////////////////////////////////////////////////////////////////////////
+// performancehud.cpp
+// ============
+// draw the frame statistics as an overlay over the finished frame
+///////////////////////////////////////////////////////////////////////////////
+
+#include "PerformanceHud.h"
+#include "GLTrace.h"
+#include "ResourceTracker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// the atlas holds the printable ASCII characters from the
+	// space on, 16 to a row, the last cell is solid
+	const int g_FirstGlyph = 32;
+	const int g_GlyphCount = 96;
+	const int g_GlyphSize = 8;
+	const int g_AtlasColumns = 16;
+	const int g_AtlasWidth = g_AtlasColumns * g_GlyphSize;
+	const int g_AtlasHeight = (g_GlyphCount / g_AtlasColumns) * g_GlyphSize;
+	const char g_SolidGlyph = 127;
+
+	// 8 x 8 font of the characters from the space to the tilde,
+	// one byte per row from the top, the lowest bit leftmost
+	const uint8_t g_Font[g_GlyphCount - 1][g_GlyphSize] =
+	{
+		{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },
+		{ 0x18, 0x3C, 0x3C, 0x18, 0x18, 0x00, 0x18, 0x00 },
+		{ 0x36, 0x36, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },
+		{ 0x36, 0x36, 0x7F, 0x36, 0x7F, 0x36, 0x36, 0x00 },
+		{ 0x0C, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x0C, 0x00 },
+		{ 0x00, 0x63, 0x33, 0x18, 0x0C, 0x66, 0x63, 0x00 },
+		{ 0x1C, 0x36, 0x1C, 0x6E, 0x3B, 0x33, 0x6E, 0x00 },
+		{ 0x06, 0x06, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00 },
+		{ 0x18, 0x0C, 0x06, 0x06, 0x06, 0x0C, 0x18, 0x00 },
+		{ 0x06, 0x0C, 0x18, 0x18, 0x18, 0x0C, 0x06, 0x00 },
+		{ 0x00, 0x66, 0x3C, 0xFF, 0x3C, 0x66, 0x00, 0x00 },
+		{ 0x00, 0x0C, 0x0C, 0x3F, 0x0C, 0x0C, 0x00, 0x00 },
+		{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x06 },
+		{ 0x00, 0x00, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x00 },
+		{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x00 },
+		{ 0x60, 0x30, 0x18, 0x0C, 0x06, 0x03, 0x01, 0x00 },
+		{ 0x3E, 0x63, 0x73, 0x7B, 0x6F, 0x67, 0x3E, 0x00 },
+		{ 0x0C, 0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x3F, 0x00 },
+		{ 0x1E, 0x33, 0x30, 0x1C, 0x06, 0x33, 0x3F, 0x00 },
+		{ 0x1E, 0x33, 0x30, 0x1C, 0x30, 0x33, 0x1E, 0x00 },
+		{ 0x38, 0x3C, 0x36, 0x33, 0x7F, 0x30, 0x78, 0x00 },
+		{ 0x3F, 0x03, 0x1F, 0x30, 0x30, 0x33, 0x1E, 0x00 },
+		{ 0x1C, 0x06, 0x03, 0x1F, 0x33, 0x33, 0x1E, 0x00 },
+		{ 0x3F, 0x33, 0x30, 0x18, 0x0C, 0x0C, 0x0C, 0x00 },
+		{ 0x1E, 0x33, 0x33, 0x1E, 0x33, 0x33, 0x1E, 0x00 },
+		{ 0x1E, 0x33, 0x33, 0x3E, 0x30, 0x18, 0x0E, 0x00 },
+		{ 0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x00 },
+		{ 0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x06 },
+		{ 0x18, 0x0C, 0x06, 0x03, 0x06, 0x0C, 0x18, 0x00 },
+		{ 0x00, 0x00, 0x3F, 0x00, 0x00, 0x3F, 0x00, 0x00 },
+		{ 0x06, 0x0C, 0x18, 0x30, 0x18, 0x0C, 0x06, 0x00 },
+		{ 0x1E, 0x33, 0x30, 0x18, 0x0C, 0x00, 0x0C, 0x00 },
+		{ 0x3E, 0x63, 0x7B, 0x7B, 0x7B, 0x03, 0x1E, 0x00 },
+		{ 0x0C, 0x1E, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x00 },
+		{ 0x3F, 0x66, 0x66, 0x3E, 0x66, 0x66, 0x3F, 0x00 },
+		{ 0x3C, 0x66, 0x03, 0x03, 0x03, 0x66, 0x3C, 0x00 },
+		{ 0x1F, 0x36, 0x66, 0x66, 0x66, 0x36, 0x1F, 0x00 },
+		{ 0x7F, 0x46, 0x16, 0x1E, 0x16, 0x46, 0x7F, 0x00 },
+		{ 0x7F, 0x46, 0x16, 0x1E, 0x16, 0x06, 0x0F, 0x00 },
+		{ 0x3C, 0x66, 0x03, 0x03, 0x73, 0x66, 0x7C, 0x00 },
+		{ 0x33, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x33, 0x00 },
+		{ 0x1E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 },
+		{ 0x78, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E, 0x00 },
+		{ 0x67, 0x66, 0x36, 0x1E, 0x36, 0x66, 0x67, 0x00 },
+		{ 0x0F, 0x06, 0x06, 0x06, 0x46, 0x66, 0x7F, 0x00 },
+		{ 0x63, 0x77, 0x7F, 0x7F, 0x6B, 0x63, 0x63, 0x00 },
+		{ 0x63, 0x67, 0x6F, 0x7B, 0x73, 0x63, 0x63, 0x00 },
+		{ 0x1C, 0x36, 0x63, 0x63, 0x63, 0x36, 0x1C, 0x00 },
+		{ 0x3F, 0x66, 0x66, 0x3E, 0x06, 0x06, 0x0F, 0x00 },
+		{ 0x1E, 0x33, 0x33, 0x33, 0x3B, 0x1E, 0x38, 0x00 },
+		{ 0x3F, 0x66, 0x66, 0x3E, 0x36, 0x66, 0x67, 0x00 },
+		{ 0x1E, 0x33, 0x07, 0x0E, 0x38, 0x33, 0x1E, 0x00 },
+		{ 0x3F, 0x2D, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 },
+		{ 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x3F, 0x00 },
+		{ 0x33, 0x33, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00 },
+		{ 0x63, 0x63, 0x63, 0x6B, 0x7F, 0x77, 0x63, 0x00 },
+		{ 0x63, 0x63, 0x36, 0x1C, 0x1C, 0x36, 0x63, 0x00 },
+		{ 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x0C, 0x1E, 0x00 },
+		{ 0x7F, 0x63, 0x31, 0x18, 0x4C, 0x66, 0x7F, 0x00 },
+		{ 0x1E, 0x06, 0x06, 0x06, 0x06, 0x06, 0x1E, 0x00 },
+		{ 0x03, 0x06, 0x0C, 0x18, 0x30, 0x60, 0x40, 0x00 },
+		{ 0x1E, 0x18, 0x18, 0x18, 0x18, 0x18, 0x1E, 0x00 },
+		{ 0x08, 0x1C, 0x36, 0x63, 0x00, 0x00, 0x00, 0x00 },
+		{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF },
+		{ 0x0C, 0x0C, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00 },
+		{ 0x00, 0x00, 0x1E, 0x30, 0x3E, 0x33, 0x6E, 0x00 },
+		{ 0x07, 0x06, 0x06, 0x3E, 0x66, 0x66, 0x3B, 0x00 },
+		{ 0x00, 0x00, 0x1E, 0x33, 0x03, 0x33, 0x1E, 0x00 },
+		{ 0x38, 0x30, 0x30, 0x3E, 0x33, 0x33, 0x6E, 0x00 },
+		{ 0x00, 0x00, 0x1E, 0x33, 0x3F, 0x03, 0x1E, 0x00 },
+		{ 0x1C, 0x36, 0x06, 0x0F, 0x06, 0x06, 0x0F, 0x00 },
+		{ 0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x1F },
+		{ 0x07, 0x06, 0x36, 0x6E, 0x66, 0x66, 0x67, 0x00 },
+		{ 0x0C, 0x00, 0x0E, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 },
+		{ 0x30, 0x00, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E },
+		{ 0x07, 0x06, 0x66, 0x36, 0x1E, 0x36, 0x67, 0x00 },
+		{ 0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 },
+		{ 0x00, 0x00, 0x33, 0x7F, 0x7F, 0x6B, 0x63, 0x00 },
+		{ 0x00, 0x00, 0x1F, 0x33, 0x33, 0x33, 0x33, 0x00 },
+		{ 0x00, 0x00, 0x1E, 0x33, 0x33, 0x33, 0x1E, 0x00 },
+		{ 0x00, 0x00, 0x3B, 0x66, 0x66, 0x3E, 0x06, 0x0F },
+		{ 0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x78 },
+		{ 0x00, 0x00, 0x3B, 0x6E, 0x66, 0x06, 0x0F, 0x00 },
+		{ 0x00, 0x00, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x00 },
+		{ 0x08, 0x0C, 0x3E, 0x0C, 0x0C, 0x2C, 0x18, 0x00 },
+		{ 0x00, 0x00, 0x33, 0x33, 0x33, 0x33, 0x6E, 0x00 },
+		{ 0x00, 0x00, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00 },
+		{ 0x00, 0x00, 0x63, 0x6B, 0x7F, 0x7F, 0x36, 0x00 },
+		{ 0x00, 0x00, 0x63, 0x36, 0x1C, 0x36, 0x63, 0x00 },
+		{ 0x00, 0x00, 0x33, 0x33, 0x33, 0x3E, 0x30, 0x1F },
+		{ 0x00, 0x00, 0x3F, 0x19, 0x0C, 0x26, 0x3F, 0x00 },
+		{ 0x38, 0x0C, 0x0C, 0x07, 0x0C, 0x0C, 0x38, 0x00 },
+		{ 0x18, 0x18, 0x18, 0x00, 0x18, 0x18, 0x18, 0x00 },
+		{ 0x07, 0x0C, 0x0C, 0x38, 0x0C, 0x0C, 0x07, 0x00 },
+		{ 0x6E, 0x3B, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }
+	};
+
+	// most quads drawn per frame, the indices are 16 bit
+	const int g_MaxQuads = 4096;
+	// frames shown in the graph
+	const int g_HistoryFrames = 120;
+	// font pixels of the graph, the margins and a line
+	const float g_GraphHeight = 40.0f;
+	const float g_Margin = 6.0f;
+	const float g_LineHeight = 10.0f;
+	// window height the font is drawn at one pixel per pixel,
+	// taller windows scale it by whole pixels
+	const int g_BaseHeight = 540;
+	// frame time of 60 frames per second, the graph lines are
+	// drawn at its multiples
+	const float g_TargetFrameMs = 1000.0f / 60.0f;
+	// the overlay must cost less than this on the CPU and GPU
+	const double g_BudgetMs = 0.1;
+
+	// the bytes R, G, B and A from the lowest
+	const uint32_t g_PanelColor = 0xB0000000u;
+	const uint32_t g_TextColor = 0xFFFFFFFFu;
+	const uint32_t g_LabelColor = 0xFFB0B0B0u;
+	const uint32_t g_OverBudgetColor = 0xFF4040FFu;
+	const uint32_t g_GridColor = 0x80FFFFFFu;
+	const uint32_t g_FastColor = 0xFF40D040u;
+	const uint32_t g_SlowColor = 0xFF30C0F0u;
+	const uint32_t g_DroppedColor = 0xFF4040F0u;
+	const uint32_t g_CpuColor = 0xFFF0A040u;
+
+	const char* const g_TrackerName = "hud";
+	const char* const g_VertexShaderFilename = "hudVertexShader.glsl";
+	const char* const g_FragmentShaderFilename = "hudFragmentShader.glsl";
+
+	const int g_ScreenSizeName = GLTrace::RegisterName("screenSize");
+
+	double ToMegabytes(uint64_t bytes)
+	{
+		return((double)bytes / (1024.0 * 1024.0));
+	}
+}
+
+/***********************************************************
+ *  PerformanceHud()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+PerformanceHud::PerformanceHud()
+{
+	m_pFrameStats = NULL;
+	m_pShader = NULL;
+	m_atlasTexture = 0;
+	m_vertexArray = 0;
+	m_vertexBuffer = 0;
+	m_indexBuffer = 0;
+	m_hudSectionID = -1;
+	m_quadCount = 0;
+	m_lastQuadCount = 0;
+	m_scale = 1.0f;
+	m_historyNext = 0;
+	m_historyCount = 0;
+}
+
+/***********************************************************
+ *  ~PerformanceHud()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+PerformanceHud::~PerformanceHud()
+{
+	if (0 != m_atlasTexture)
+	{
+		ResourceTracker::Release(RESOURCE_TEXTURE, m_atlasTexture);
+		glDeleteTextures(1, &m_atlasTexture);
+		m_atlasTexture = 0;
+	}
+	if (0 != m_vertexBuffer)
+	{
+		ResourceTracker::Release(RESOURCE_BUFFER, m_vertexBuffer);
+		glDeleteBuffers(1, &m_vertexBuffer);
+		m_vertexBuffer = 0;
+	}
+	if (0 != m_indexBuffer)
+	{
+		ResourceTracker::Release(RESOURCE_BUFFER, m_indexBuffer);
+		glDeleteBuffers(1, &m_indexBuffer);
+		m_indexBuffer = 0;
+	}
+	if (0 != m_vertexArray)
+	{
+		glDeleteVertexArrays(1, &m_vertexArray);
+		m_vertexArray = 0;
+	}
+	if (NULL != m_pShader)
+	{
+		ResourceTracker::Release(RESOURCE_PROGRAM, m_pShader->m_programID);
+		delete m_pShader;
+		m_pShader = NULL;
+	}
+	m_pFrameStats = NULL;
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for creating what the overlay is
+ *  drawn with.  The overlay is drawn in the "hud" pass of
+ *  the frame graph, whose section its own cost is read from.
+ ***********************************************************/
+bool PerformanceHud::Initialize(FrameStats* pFrameStats)
+{
+	m_pFrameStats = pFrameStats;
+	if (NULL == m_pFrameStats)
+	{
+		return(false);
+	}
+	m_hudSectionID = m_pFrameStats->RegisterSection("hud");
+
+	if (!LoadShader() || !CreateBuffers())
+	{
+		return(false);
+	}
+	CreateAtlas();
+
+	m_vertices.resize((size_t)g_MaxQuads * 4);
+	m_frameHistory.resize(g_HistoryFrames, 0.0f);
+	m_cpuHistory.resize(g_HistoryFrames, 0.0f);
+	return(true);
+}
+
+/***********************************************************
+ *  LoadShader()
+ *
+ *  This method is used for loading the overlay shader.
+ ***********************************************************/
+bool PerformanceHud::LoadShader()
+{
+	// the scene keeps its program bound from its setup, and
+	// loading binds the new one
+	GLint previousProgram = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+
+	m_pShader = new ShaderManager();
+	m_pShader->LoadShaders(g_VertexShaderFilename, g_FragmentShaderFilename);
+	if (0 == m_pShader->m_programID)
+	{
+		std::cout << "The overlay shader failed to load" << std::endl;
+		delete m_pShader;
+		m_pShader = NULL;
+		return(false);
+	}
+	ResourceTracker::TrackProgram(m_pShader->m_programID, g_TrackerName, g_VertexShaderFilename);
+
+	GLTrace::UseProgram(m_pShader);
+	GLTrace::SetSampler(m_pShader, "glyphAtlas", TEXTURE_UNIT);
+	GLTrace::UseProgram((GLuint)previousProgram);
+	return(true);
+}
+
+/***********************************************************
+ *  CreateAtlas()
+ *
+ *  This method is used for expanding the bits of the font
+ *  into a one channel texture, one cell per character and a
+ *  solid last cell the rectangles are drawn with.  The rows
+ *  are stored from the top, as the glyphs are read.
+ ***********************************************************/
+void PerformanceHud::CreateAtlas()
+{
+	std::vector<uint8_t> texels((size_t)g_AtlasWidth * g_AtlasHeight, 0);
+	for (int glyph = 0; glyph < g_GlyphCount; glyph++)
+	{
+		int cellX = (glyph % g_AtlasColumns) * g_GlyphSize;
+		int cellY = (glyph / g_AtlasColumns) * g_GlyphSize;
+		for (int row = 0; row < g_GlyphSize; row++)
+		{
+			uint8_t bits = (glyph < g_GlyphCount - 1) ? g_Font[glyph][row] : 0xFF;
+			for (int column = 0; column < g_GlyphSize; column++)
+			{
+				if (bits & (1 << column))
+				{
+					texels[(size_t)(cellY + row) * g_AtlasWidth + cellX + column] = 255;
+				}
+			}
+		}
+	}
+
+	glGenTextures(1, &m_atlasTexture);
+	GLTrace::ActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT);
+	GLTrace::BindTexture(GL_TEXTURE_2D, m_atlasTexture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, g_AtlasWidth, g_AtlasHeight, 0, GL_RED, GL_UNSIGNED_BYTE, texels.data());
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	// the glyphs are drawn at whole multiples of their size
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	GLTrace::ActiveTexture(GL_TEXTURE0);
+	ResourceTracker::Track(RESOURCE_TEXTURE, m_atlasTexture, g_TrackerName, "glyph atlas", texels.size());
+}
+
+/***********************************************************
+ *  CreateBuffers()
+ *
+ *  This method is used for creating the vertex buffer the
+ *  quads are written into each frame, and the index buffer
+ *  that splits every four vertices into two triangles,
+ *  which never changes.
+ ***********************************************************/
+bool PerformanceHud::CreateBuffers()
+{
+	std::vector<uint16_t> indices((size_t)g_MaxQuads * 6);
+	for (int quad = 0; quad < g_MaxQuads; quad++)
+	{
+		uint16_t corner = (uint16_t)(quad * 4);
+		uint16_t* pIndices = &indices[(size_t)quad * 6];
+		pIndices[0] = corner;
+		pIndices[1] = corner + 2;
+		pIndices[2] = corner + 1;
+		pIndices[3] = corner + 1;
+		pIndices[4] = corner + 2;
+		pIndices[5] = corner + 3;
+	}
+
+	glGenVertexArrays(1, &m_vertexArray);
+	glGenBuffers(1, &m_vertexBuffer);
+	glGenBuffers(1, &m_indexBuffer);
+	GLTrace::BindVertexArray(m_vertexArray);
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)g_MaxQuads * 4 * sizeof(HUD_VERTEX), NULL, GL_DYNAMIC_DRAW);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(HUD_VERTEX), (void*)offsetof(HUD_VERTEX, x));
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(HUD_VERTEX), (void*)offsetof(HUD_VERTEX, u));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(HUD_VERTEX), (void*)offsetof(HUD_VERTEX, color));
+	glEnableVertexAttribArray(2);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint16_t), indices.data(), GL_STATIC_DRAW);
+
+	GLTrace::BindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	ResourceTracker::Track(RESOURCE_BUFFER, m_vertexBuffer, g_TrackerName, "overlay quads",
+		(size_t)g_MaxQuads * 4 * sizeof(HUD_VERTEX));
+	ResourceTracker::Track(RESOURCE_BUFFER, m_indexBuffer, g_TrackerName, "overlay quads",
+		indices.size() * sizeof(uint16_t));
+	return(true);
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for adding the times of the last
+ *  frame to the graph history, so the graph is complete
+ *  as soon as the overlay is shown.
+ ***********************************************************/
+void PerformanceHud::Update()
+{
+	if (m_frameHistory.empty())
+	{
+		return;
+	}
+	m_frameHistory[m_historyNext] = (float)m_pFrameStats->GetLastFrameMs();
+	m_cpuHistory[m_historyNext] = (float)m_pFrameStats->GetLastFrameCpuMs();
+	m_historyNext = (m_historyNext + 1) % g_HistoryFrames;
+	m_historyCount = std::min(m_historyCount + 1, g_HistoryFrames);
+}
+
+/***********************************************************
+ *  AddRectangle()
+ *
+ *  This method is used for adding a quad of one color,
+ *  which samples the middle of the solid cell.
+ ***********************************************************/
+void PerformanceHud::AddRectangle(float x, float y, float width, float height, uint32_t color)
+{
+	if (m_quadCount >= g_MaxQuads)
+	{
+		return;
+	}
+
+	int solid = g_SolidGlyph - g_FirstGlyph;
+	float u = ((solid % g_AtlasColumns) * g_GlyphSize + 0.5f * g_GlyphSize) / (float)g_AtlasWidth;
+	float v = ((solid / g_AtlasColumns) * g_GlyphSize + 0.5f * g_GlyphSize) / (float)g_AtlasHeight;
+
+	HUD_VERTEX* pQuad = &m_vertices[(size_t)m_quadCount * 4];
+	for (int corner = 0; corner < 4; corner++)
+	{
+		pQuad[corner].x = x + ((corner & 1) ? width : 0.0f);
+		pQuad[corner].y = y + ((corner & 2) ? height : 0.0f);
+		pQuad[corner].u = u;
+		pQuad[corner].v = v;
+		pQuad[corner].color = color;
+	}
+	m_quadCount++;
+}
+
+/***********************************************************
+ *  AddGlyph()
+ *
+ *  This method is used for adding the quad of a character
+ *  at the font size.
+ ***********************************************************/
+void PerformanceHud::AddGlyph(float x, float y, char glyph, uint32_t color)
+{
+	int index = (int)(unsigned char)glyph - g_FirstGlyph;
+	if ((index <= 0) || (index >= g_GlyphCount) || (m_quadCount >= g_MaxQuads))
+	{
+		return;
+	}
+
+	float size = g_GlyphSize * m_scale;
+	float u0 = (float)((index % g_AtlasColumns) * g_GlyphSize) / (float)g_AtlasWidth;
+	float v0 = (float)((index / g_AtlasColumns) * g_GlyphSize) / (float)g_AtlasHeight;
+	float u1 = u0 + (float)g_GlyphSize / (float)g_AtlasWidth;
+	float v1 = v0 + (float)g_GlyphSize / (float)g_AtlasHeight;
+
+	HUD_VERTEX* pQuad = &m_vertices[(size_t)m_quadCount * 4];
+	for (int corner = 0; corner < 4; corner++)
+	{
+		pQuad[corner].x = x + ((corner & 1) ? size : 0.0f);
+		pQuad[corner].y = y + ((corner & 2) ? size : 0.0f);
+		pQuad[corner].u = (corner & 1) ? u1 : u0;
+		pQuad[corner].v = (corner & 2) ? v1 : v0;
+		pQuad[corner].color = color;
+	}
+	m_quadCount++;
+}
+
+/***********************************************************
+ *  AddText()
+ *
+ *  This method is used for adding a line of text, one quad
+ *  per character that is not a space.
+ ***********************************************************/
+float PerformanceHud::AddText(float x, float y, const char* pText, uint32_t color)
+{
+	float advance = g_GlyphSize * m_scale;
+	float left = x;
+	for (const char* pChar = pText; *pChar != '\0'; pChar++)
+	{
+		AddGlyph(x, y, *pChar, color);
+		x += advance;
+	}
+	return(x - left);
+}
+
+/***********************************************************
+ *  AddGraph()
+ *
+ *  This method is used for adding the bars of the recent
+ *  frames, oldest on the left.  A frame bar is green within
+ *  the time of 60 frames per second, yellow within twice
+ *  that and red beyond, with the CPU time of the frame as a
+ *  narrower bar inside it.  The graph spans at least two
+ *  target frame times and grows by whole ones, with a line
+ *  at each.
+ ***********************************************************/
+float PerformanceHud::AddGraph(float x, float y)
+{
+	float barWidth = 2.0f * m_scale;
+	float height = g_GraphHeight * m_scale;
+
+	float largest = 2.0f * g_TargetFrameMs;
+	for (int i = 0; i < m_historyCount; i++)
+	{
+		largest = std::max(largest, std::max(m_frameHistory[i], m_cpuHistory[i]));
+	}
+	float graphMs = std::ceil(largest / g_TargetFrameMs) * g_TargetFrameMs;
+	float pixelsPerMs = height / graphMs;
+
+	// the oldest frame is where the next one is written
+	int first = (m_historyNext - m_historyCount + g_HistoryFrames) % g_HistoryFrames;
+	float left = x + (g_HistoryFrames - m_historyCount) * barWidth;
+	for (int i = 0; i < m_historyCount; i++)
+	{
+		int sample = (first + i) % g_HistoryFrames;
+		float frameMs = m_frameHistory[sample];
+		float cpuMs = m_cpuHistory[sample];
+		uint32_t color = g_FastColor;
+		if (frameMs > 2.0f * g_TargetFrameMs)
+			color = g_DroppedColor;
+		else if (frameMs > g_TargetFrameMs)
+			color = g_SlowColor;
+
+		float barLeft = left + i * barWidth;
+		float frameHeight = frameMs * pixelsPerMs;
+		float cpuHeight = cpuMs * pixelsPerMs;
+		AddRectangle(barLeft, y + height - frameHeight, barWidth, frameHeight, color);
+		AddRectangle(barLeft + 0.25f * barWidth, y + height - cpuHeight, 0.5f * barWidth, cpuHeight, g_CpuColor);
+	}
+
+	// the lines at the multiples of the target, at most a few
+	int lineCount = (int)(graphMs / g_TargetFrameMs + 0.5f);
+	int lineStep = std::max(1, lineCount / 4);
+	for (int line = lineStep; line <= lineCount; line += lineStep)
+	{
+		float lineY = y + height - line * g_TargetFrameMs * pixelsPerMs;
+		AddRectangle(x, lineY, g_HistoryFrames * barWidth, m_scale, g_GridColor);
+	}
+	return(height);
+}
+
+/***********************************************************
+ *  Draw()
+ *
+ *  This method is used for writing the quads of the overlay
+ *  and drawing them with one call.  The panel behind the
+ *  text is the first quad, sized once the lines are added.
+ *  The counters are those of the last whole frame.  The
+ *  bound program is restored afterwards.
+ ***********************************************************/
+void PerformanceHud::Draw(int width, int height, const SceneManager* pSceneManager, bool bOrthographic)
+{
+	m_lastQuadCount = 0;
+	if ((NULL == m_pShader) || (width <= 0) || (height <= 0))
+	{
+		return;
+	}
+
+	m_scale = (float)std::max(1, height / g_BaseHeight);
+	float lineHeight = g_LineHeight * m_scale;
+	float margin = g_Margin * m_scale;
+	float x = 2.0f * margin;
+	float y = 2.0f * margin;
+	float right = x + g_HistoryFrames * 2.0f * m_scale;
+	char line[128];
+
+	m_quadCount = 0;
+	AddRectangle(0.0f, 0.0f, 0.0f, 0.0f, g_PanelColor);
+
+	double frameMs = m_pFrameStats->GetFrameMs();
+	snprintf(line, sizeof(line), "%6.2f ms  cpu %6.2f ms  %5.1f fps",
+		frameMs, m_pFrameStats->GetFrameCpuMs(), (frameMs > 0.0) ? 1000.0 / frameMs : 0.0);
+	right = std::max(right, x + AddText(x, y, line, g_TextColor));
+	y += lineHeight;
+	y += AddGraph(x, y) + margin;
+
+	const GL_COUNTERS& counters = m_pFrameStats->GetFrameCounters();
+	snprintf(line, sizeof(line), "draws %llu  tris %llu",
+		(unsigned long long)counters.drawCalls, (unsigned long long)counters.triangles);
+	right = std::max(right, x + AddText(x, y, line, g_TextColor));
+	y += lineHeight;
+	snprintf(line, sizeof(line), "texture binds %llu  programs %llu",
+		(unsigned long long)counters.textureBinds, (unsigned long long)counters.programSwitches);
+	right = std::max(right, x + AddText(x, y, line, g_TextColor));
+	y += lineHeight;
+	snprintf(line, sizeof(line), "uniforms %llu  state %llu  redundant %llu",
+		(unsigned long long)counters.uniformUploads, (unsigned long long)counters.stateChanges,
+		(unsigned long long)counters.redundantCalls);
+	right = std::max(right, x + AddText(x, y, line, g_TextColor));
+	y += lineHeight;
+	snprintf(line, sizeof(line), "uploaded %.1f KB  allocations %llu",
+		(double)counters.bufferBytes / 1024.0, (unsigned long long)m_pFrameStats->GetFrameAllocations());
+	right = std::max(right, x + AddText(x, y, line, g_TextColor));
+	y += lineHeight;
+
+	if (NULL != pSceneManager)
+	{
+		// every view culls the whole queue, so the draws kept
+		// are out of the submitted draws times the views
+		int viewCount = std::max(pSceneManager->GetViewOrderCount(), 1);
+		int submitted = pSceneManager->GetSubmittedDrawCount() * viewCount;
+		int visible = pSceneManager->GetVisibleDrawCount();
+		if (viewCount > 1)
+		{
+			snprintf(line, sizeof(line), "culling: %d of %d draws kept in %d views", visible, submitted, viewCount);
+		}
+		else
+		{
+			snprintf(line, sizeof(line), "culling: %d of %d draws kept", visible, submitted);
+		}
+		right = std::max(right, x + AddText(x, y, line, g_TextColor));
+		y += lineHeight;
+	}
+
+	snprintf(line, sizeof(line), "memory: gpu %.1f MB  host %.1f MB",
+		ToMegabytes(ResourceTracker::GetGpuBytes()), ToMegabytes(ResourceTracker::GetHostBytes()));
+	right = std::max(right, x + AddText(x, y, line, g_TextColor));
+	y += lineHeight;
+	snprintf(line, sizeof(line), "textures %.1f MB  buffers %.1f MB  view %s",
+		ToMegabytes(ResourceTracker::GetLiveBytes(RESOURCE_TEXTURE)),
+		ToMegabytes(ResourceTracker::GetLiveBytes(RESOURCE_BUFFER)),
+		bOrthographic ? "ortho" : "perspective");
+	right = std::max(right, x + AddText(x, y, line, g_TextColor));
+	y += lineHeight + margin;
+
+	// the sections, the overlay's own in red while it is over
+	// its budget
+	for (int i = 0; i < m_pFrameStats->GetSectionCount(); i++)
+	{
+		double cpuMs = m_pFrameStats->GetSectionCpuMs(i);
+		double gpuMs = m_pFrameStats->GetSectionGpuMs(i);
+		uint32_t color = g_LabelColor;
+		if ((i == m_hudSectionID) && ((cpuMs > g_BudgetMs) || (gpuMs > g_BudgetMs)))
+		{
+			color = g_OverBudgetColor;
+		}
+		snprintf(line, sizeof(line), "%-10.10s cpu %7.2f  gpu %7.2f ms", m_pFrameStats->GetSectionName(i), cpuMs, gpuMs);
+		right = std::max(right, x + AddText(x, y, line, color));
+		y += lineHeight;
+	}
+
+	// size the panel around the lines
+	HUD_VERTEX* pPanel = &m_vertices[0];
+	for (int corner = 0; corner < 4; corner++)
+	{
+		pPanel[corner].x = (corner & 1) ? right + margin : margin;
+		pPanel[corner].y = (corner & 2) ? y + margin : margin;
+	}
+
+	GLint previousProgram = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+
+	GLTrace::Viewport(0, 0, width, height);
+	GLTrace::Disable(GL_DEPTH_TEST);
+	GLTrace::Enable(GL_BLEND);
+	GLTrace::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	GLTrace::UseProgram(m_pShader);
+	GLTrace::SetVec2(m_pShader, g_ScreenSizeName, glm::vec2((float)width, (float)height));
+	GLTrace::ActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT);
+	GLTrace::BindTexture(GL_TEXTURE_2D, m_atlasTexture);
+	GLTrace::ActiveTexture(GL_TEXTURE0);
+
+	GLTrace::BindVertexArray(m_vertexArray);
+	GLTrace::BindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+	GLTrace::BufferSubData(GL_ARRAY_BUFFER, 0, (GLsizeiptr)m_quadCount * 4 * sizeof(HUD_VERTEX), m_vertices.data());
+	GLTrace::DrawElements(GL_TRIANGLES, m_quadCount * 6, GL_UNSIGNED_SHORT, 0);
+	GLTrace::BindBuffer(GL_ARRAY_BUFFER, 0);
+	GLTrace::BindVertexArray(0);
+	m_lastQuadCount = m_quadCount;
+
+	GLTrace::Disable(GL_BLEND);
+	GLTrace::Enable(GL_DEPTH_TEST);
+	GLTrace::UseProgram((GLuint)previousProgram);
+}
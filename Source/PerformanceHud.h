@@ -0,0 +1,104 @@
+///////////////////////////////////////////////////////////////////////////////
+// performancehud.h
+// ============
+// draw the frame statistics as an overlay over the finished frame
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "FrameStats.h"
+#include "SceneManager.h"
+#include "ShaderManager.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  PerformanceHud
+ *
+ *  This class draws what FrameStats measures in a corner of
+ *  the window: graphs of the recent frame times, the OpenGL
+ *  call counters of the last frame, the memory the resource
+ *  tracker counts, how many draws survived the culling and
+ *  the time of each section, its own included.
+ *
+ *  The text is drawn from a glyph atlas built once from an
+ *  8 x 8 bitmap font compiled into the program.  Each frame
+ *  the glyphs, graph bars and panel are written as quads
+ *  into one array, uploaded with one buffer update and drawn
+ *  with one call.  The lines are formatted into fixed
+ *  buffers, so the overlay makes no heap allocations.
+ ***********************************************************/
+class PerformanceHud
+{
+public:
+	// after the lightmap
+	static const int TEXTURE_UNIT = 10;
+
+	// constructor
+	PerformanceHud();
+	// destructor
+	~PerformanceHud();
+
+	// build the glyph atlas and the quad buffers and load the
+	// overlay shader, the statistics are read from FrameStats
+	bool Initialize(FrameStats* pFrameStats);
+
+	// record the times of the last frame in the graphs, called
+	// once per frame whether the overlay is shown or not
+	void Update();
+	// draw the overlay over the bound framebuffer of the given
+	// size, with the culling counts of the scene
+	void Draw(int width, int height, const SceneManager* pSceneManager, bool bOrthographic);
+
+	// quads drawn by the last Draw()
+	int GetLastQuadCount() const { return m_lastQuadCount; }
+
+private:
+	struct HUD_VERTEX
+	{
+		// pixels from the top left corner
+		float x;
+		float y;
+		float u;
+		float v;
+		// RGBA, 8 bits each
+		uint32_t color;
+	};
+
+	FrameStats* m_pFrameStats;
+	ShaderManager* m_pShader;
+	GLuint m_atlasTexture;
+	GLuint m_vertexArray;
+	GLuint m_vertexBuffer;
+	GLuint m_indexBuffer;
+	int m_hudSectionID;
+
+	std::vector<HUD_VERTEX> m_vertices;
+	int m_quadCount;
+	int m_lastQuadCount;
+	// pixels per font pixel
+	float m_scale;
+
+	// ring of the frame and CPU times of the recent frames
+	std::vector<float> m_frameHistory;
+	std::vector<float> m_cpuHistory;
+	int m_historyNext;
+	int m_historyCount;
+
+	bool LoadShader();
+	// fill the atlas texture from the font
+	void CreateAtlas();
+	bool CreateBuffers();
+
+	// add a quad of the solid atlas cell, or of a glyph
+	void AddRectangle(float x, float y, float width, float height, uint32_t color);
+	void AddGlyph(float x, float y, char glyph, uint32_t color);
+	// add a line of text, returns its width in pixels
+	float AddText(float x, float y, const char* pText, uint32_t color);
+	// add the frame time graph, returns its height in pixels
+	float AddGraph(float x, float y);
+};
@@ -0,0 +1,265 @@
+///////////////////////////////////////////////////////////////////////////////
+// redrawscheduler.cpp
+// ============
+// decide when a frame has to be drawn in the render on demand mode
+///////////////////////////////////////////////////////////////////////////////
+
+#include "RedrawScheduler.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#include "GLFW/glfw3.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// names of the redraw reasons in the report, in bit order
+	const char* g_ReasonNames[RedrawScheduler::REDRAW_REASON_COUNT] = { "view", "scene", "telemetry", "window", "tick" };
+
+	/***********************************************************
+	 *  GetProcessCpuSeconds()
+	 *
+	 *  This function is used for getting the CPU time used by
+	 *  all the threads of the process so far.
+	 ***********************************************************/
+	double GetProcessCpuSeconds()
+	{
+#ifdef _WIN32
+		FILETIME creationTime;
+		FILETIME exitTime;
+		FILETIME kernelTime;
+		FILETIME userTime;
+		if (!GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime))
+		{
+			return(0.0);
+		}
+		unsigned long long kernel = ((unsigned long long)kernelTime.dwHighDateTime << 32) | kernelTime.dwLowDateTime;
+		unsigned long long user = ((unsigned long long)userTime.dwHighDateTime << 32) | userTime.dwLowDateTime;
+		// the times are in units of 100 nanoseconds
+		return((double)(kernel + user) * 1e-7);
+#else
+		struct timespec cpuTime;
+		if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpuTime) != 0)
+		{
+			return(0.0);
+		}
+		return((double)cpuTime.tv_sec + (double)cpuTime.tv_nsec * 1e-9);
+#endif
+	}
+}
+
+/***********************************************************
+ *  RedrawScheduler()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+RedrawScheduler::RedrawScheduler()
+{
+	m_maxLatency = 1.0;
+	m_pollInterval = 0.0;
+	m_reportInterval = 5.0;
+
+	// the first frame is always drawn
+	m_dirtyReasons = REDRAW_WINDOW;
+	m_bActive = true;
+	m_lastPresentTime = glfwGetTime();
+	m_wakeTime = m_lastPresentTime;
+
+	ResetReport(m_lastPresentTime);
+}
+
+/***********************************************************
+ *  ~RedrawScheduler()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+RedrawScheduler::~RedrawScheduler()
+{
+}
+
+/***********************************************************
+ *  SetMaxLatency()
+ *
+ *  This method is used for setting the longest time the
+ *  screen goes without a frame, so clocks and animations
+ *  still move now and then on an idle display.
+ ***********************************************************/
+void RedrawScheduler::SetMaxLatency(double seconds)
+{
+	m_maxLatency = std::max(seconds, 0.001);
+}
+
+/***********************************************************
+ *  SetPollInterval()
+ *
+ *  This method is used for setting how often the loop wakes
+ *  up to check sources that cannot wake the event wait.  A
+ *  wake up without a change only costs the checks.
+ ***********************************************************/
+void RedrawScheduler::SetPollInterval(double seconds)
+{
+	m_pollInterval = std::max(seconds, 0.0);
+}
+
+/***********************************************************
+ *  SetReportInterval()
+ *
+ *  This method is used for setting how often the totals are
+ *  printed, 0 disables the report.
+ ***********************************************************/
+void RedrawScheduler::SetReportInterval(double seconds)
+{
+	m_reportInterval = seconds;
+}
+
+/***********************************************************
+ *  WaitForEvents()
+ *
+ *  This method is used for processing the window events.
+ *  Right after a frame it only polls, so held keys and
+ *  ongoing changes keep drawing.  Otherwise it sleeps until
+ *  an event arrives, the poll interval ends or the latency
+ *  tick is due.
+ ***********************************************************/
+void RedrawScheduler::WaitForEvents()
+{
+	double now = glfwGetTime();
+	double timeout = m_maxLatency - (now - m_lastPresentTime);
+	if (m_pollInterval > 0.0)
+	{
+		timeout = std::min(timeout, m_pollInterval);
+	}
+
+	if (m_bActive || (m_dirtyReasons != 0) || (timeout <= 0.0))
+	{
+		glfwPollEvents();
+	}
+	else
+	{
+		glfwWaitEventsTimeout(timeout);
+	}
+
+	m_wakeTime = glfwGetTime();
+	m_wakeCount++;
+	Report(m_wakeTime);
+}
+
+/***********************************************************
+ *  MarkDirty()
+ *
+ *  This method is used for marking that the screen no longer
+ *  shows the current state, for one or more reasons.
+ ***********************************************************/
+void RedrawScheduler::MarkDirty(int reasons)
+{
+	m_dirtyReasons |= reasons;
+}
+
+/***********************************************************
+ *  ShouldRender()
+ *
+ *  This method is used for deciding whether a frame has to
+ *  be drawn after the last wake up.  When none is needed the
+ *  next wait sleeps.
+ ***********************************************************/
+bool RedrawScheduler::ShouldRender()
+{
+	if (m_wakeTime - m_lastPresentTime >= m_maxLatency)
+	{
+		m_dirtyReasons |= REDRAW_TICK;
+	}
+
+	m_bActive = (m_dirtyReasons != 0);
+	return(m_bActive);
+}
+
+/***********************************************************
+ *  FramePresented()
+ *
+ *  This method is used for recording a presented frame and
+ *  the time it took from waking up to presenting it.
+ ***********************************************************/
+void RedrawScheduler::FramePresented()
+{
+	double now = glfwGetTime();
+	double latency = now - m_wakeTime;
+
+	m_frameCount++;
+	m_latencySum += latency;
+	m_latencyMax = std::max(m_latencyMax, latency);
+	for (int i = 0; i < REDRAW_REASON_COUNT; i++)
+	{
+		if (m_dirtyReasons & (1 << i))
+		{
+			m_reasonCounts[i]++;
+		}
+	}
+
+	m_dirtyReasons = 0;
+	m_lastPresentTime = now;
+}
+
+/***********************************************************
+ *  Report()
+ *
+ *  This method is used for printing the CPU use of the
+ *  process, the frames drawn and why, and the wake to
+ *  present latency once the report interval has passed.
+ ***********************************************************/
+void RedrawScheduler::Report(double now)
+{
+	double elapsed = now - m_reportStartTime;
+	if ((m_reportInterval <= 0.0) || (elapsed < m_reportInterval))
+	{
+		return;
+	}
+
+	double cpuPercent = 100.0 * (GetProcessCpuSeconds() - m_reportStartCpuTime) / elapsed;
+
+	std::cout << std::fixed << std::setprecision(2)
+		<< "REDRAW: cpu " << cpuPercent << "% | " << m_frameCount << " frames, "
+		<< m_wakeCount << " wakeups in " << elapsed << " s";
+	if (m_frameCount > 0)
+	{
+		std::cout << " | wake to present avg " << (m_latencySum / m_frameCount) * 1000.0
+			<< " ms max " << m_latencyMax * 1000.0 << " ms |";
+		for (int i = 0; i < REDRAW_REASON_COUNT; i++)
+		{
+			std::cout << " " << g_ReasonNames[i] << " " << m_reasonCounts[i];
+		}
+	}
+	std::cout << std::endl;
+
+	ResetReport(now);
+}
+
+/***********************************************************
+ *  ResetReport()
+ *
+ *  This method is used for starting the totals of the next
+ *  report interval.
+ ***********************************************************/
+void RedrawScheduler::ResetReport(double now)
+{
+	m_reportStartTime = now;
+	m_reportStartCpuTime = GetProcessCpuSeconds();
+	m_wakeCount = 0;
+	m_frameCount = 0;
+	m_latencySum = 0.0;
+	m_latencyMax = 0.0;
+	for (int i = 0; i < REDRAW_REASON_COUNT; i++)
+	{
+		m_reasonCounts[i] = 0;
+	}
+}
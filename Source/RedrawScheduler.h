@@ -0,0 +1,82 @@
+///////////////////////////////////////////////////////////////////////////////
+// redrawscheduler.h
+// ============
+// decide when a frame has to be drawn in the render on demand mode
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/***********************************************************
+ *  RedrawScheduler
+ *
+ *  This class lets the render loop sleep in the event wait
+ *  while nothing on screen changes.  The sources of change
+ *  mark the scheduler dirty with a reason, and a frame is
+ *  drawn only when something is dirty or when the longest
+ *  allowed time without a frame has passed.  Sources that
+ *  cannot wake the event wait, such as another process
+ *  writing telemetry, are checked at the poll interval.
+ *  The idle CPU use and the time from waking up to the
+ *  presented frame are printed to the console.
+ ***********************************************************/
+class RedrawScheduler
+{
+public:
+	enum REDRAW_REASON
+	{
+		REDRAW_VIEW = 1,
+		REDRAW_SCENE = 2,
+		REDRAW_TELEMETRY = 4,
+		REDRAW_WINDOW = 8,
+		REDRAW_TICK = 16,
+		REDRAW_REASON_COUNT = 5
+	};
+
+	// constructor
+	RedrawScheduler();
+	// destructor
+	~RedrawScheduler();
+
+	// longest time without a frame, in seconds
+	void SetMaxLatency(double seconds);
+	// how often to wake up and check the polled sources, in
+	// seconds, 0 when every source wakes the wait itself
+	void SetPollInterval(double seconds);
+	// set the console report interval, 0 disables the report
+	void SetReportInterval(double seconds);
+
+	// process window events, sleeping until one arrives or a
+	// polled source or the latency tick has to be checked
+	void WaitForEvents();
+	// mark that the screen is out of date for the reasons
+	void MarkDirty(int reasons);
+	// true when a frame has to be drawn now
+	bool ShouldRender();
+	// call once the frame has been presented
+	void FramePresented();
+
+private:
+	double m_maxLatency;
+	double m_pollInterval;
+	double m_reportInterval;
+
+	int m_dirtyReasons;
+	// a frame was just drawn, so check again without sleeping
+	// in case the change is still going on
+	bool m_bActive;
+	double m_lastPresentTime;
+	double m_wakeTime;
+
+	// totals since the last report
+	double m_reportStartTime;
+	double m_reportStartCpuTime;
+	int m_wakeCount;
+	int m_frameCount;
+	double m_latencySum;
+	double m_latencyMax;
+	int m_reasonCounts[REDRAW_REASON_COUNT];
+
+	// print the totals and start new ones when it is time
+	void Report(double now);
+	void ResetReport(double now);
+};
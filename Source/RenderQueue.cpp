@@ -0,0 +1,350 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderqueue.cpp
+// ============
+// collect the draw commands for a frame and order them for the
+// depth pre-pass, the opaque pass and the transparent pass
+///////////////////////////////////////////////////////////////////////////////
+
+#include "RenderQueue.h"
+
+#include <algorithm>
+
+// declaration of global variables
+namespace
+{
+	// object space bounds of the loaded models, by model index
+	std::vector<glm::vec3> g_ModelBoundsMin;
+	std::vector<glm::vec3> g_ModelBoundsMax;
+}
+
+/***********************************************************
+ *  RenderQueue()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+RenderQueue::RenderQueue()
+{
+}
+
+/***********************************************************
+ *  ~RenderQueue()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+RenderQueue::~RenderQueue()
+{
+	Clear();
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing all the draw commands
+ *  that were submitted for the previous frame.  The vector
+ *  capacity is kept so the next frame does not reallocate.
+ ***********************************************************/
+void RenderQueue::Clear()
+{
+	m_commands.clear();
+	m_viewDepths.clear();
+	m_opaqueOrder.clear();
+	m_transparentOrder.clear();
+	m_boundsMin.clear();
+	m_boundsMax.clear();
+}
+
+/***********************************************************
+ *  Submit()
+ *
+ *  This method is used for adding a draw command to the
+ *  queue for the current frame.
+ ***********************************************************/
+void RenderQueue::Submit(const DRAW_COMMAND& command)
+{
+	m_commands.push_back(command);
+}
+
+/***********************************************************
+ *  Sort()
+ *
+ *  This method is used for splitting the submitted commands
+ *  into the opaque and transparent lists and ordering them
+ *  by the view depth of their mesh center.
+ ***********************************************************/
+void RenderQueue::Sort(const glm::mat4& view)
+{
+	m_viewDepths.resize(m_commands.size());
+	m_opaqueOrder.clear();
+	m_transparentOrder.clear();
+
+	for (uint32_t i = 0; i < m_commands.size(); i++)
+	{
+		const DRAW_COMMAND& command = m_commands[i];
+		glm::vec4 center = command.model * glm::vec4(GetMeshLocalCenter(command.mesh), 1.0f);
+
+		// the camera looks down the negative Z axis in view space
+		m_viewDepths[i] = -(view * center).z;
+
+		if (IsTransparent(command))
+			m_transparentOrder.push_back(i);
+		else
+			m_opaqueOrder.push_back(i);
+	}
+
+	// opaque objects nearest first so hidden fragments fail the depth test.
+	// Equal depths keep the submission order through the index, which
+	// std::sort can do in place where std::stable_sort takes a buffer
+	std::sort(m_opaqueOrder.begin(), m_opaqueOrder.end(),
+		[this](uint32_t a, uint32_t b)
+		{ return (m_viewDepths[a] < m_viewDepths[b]) || ((m_viewDepths[a] == m_viewDepths[b]) && (a < b)); });
+
+	// transparent objects farthest first so blending composites correctly
+	std::sort(m_transparentOrder.begin(), m_transparentOrder.end(),
+		[this](uint32_t a, uint32_t b)
+		{ return (m_viewDepths[a] > m_viewDepths[b]) || ((m_viewDepths[a] == m_viewDepths[b]) && (a < b)); });
+}
+
+/***********************************************************
+ *  UpdateBounds()
+ *
+ *  This method is used for computing the world bounds of
+ *  every submitted command.  The bounds do not depend on the
+ *  view, so all the views of a frame cull against them.
+ ***********************************************************/
+void RenderQueue::UpdateBounds()
+{
+	m_boundsMin.resize(m_commands.size());
+	m_boundsMax.resize(m_commands.size());
+	for (size_t i = 0; i < m_commands.size(); i++)
+	{
+		GetWorldBounds(m_commands[i], m_boundsMin[i], m_boundsMax[i]);
+	}
+}
+
+/***********************************************************
+ *  CullAndSort()
+ *
+ *  This method is used for listing the commands whose world
+ *  bounds touch the frustum of at least one of the views.
+ *  The frustum planes are taken from the rows of the view
+ *  projection matrix, which works for perspective and
+ *  orthographic views alike.  The lists are sorted by the
+ *  view depth in the first view, like Sort() does.
+ ***********************************************************/
+void RenderQueue::CullAndSort(const RENDER_VIEW* pViews, int viewCount, VIEW_ORDER& order)
+{
+	order.opaqueOrder.clear();
+	order.transparentOrder.clear();
+	if ((viewCount <= 0) || (m_boundsMin.size() != m_commands.size()))
+	{
+		return;
+	}
+
+	// six planes per view, pointing into the frustum
+	std::vector<glm::vec4>& planes = m_cullPlanes;
+	planes.resize(viewCount * 6);
+	for (int v = 0; v < viewCount; v++)
+	{
+		glm::mat4 viewProjection = pViews[v].projection * pViews[v].view;
+		glm::vec4 row0(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+		glm::vec4 row1(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+		glm::vec4 row2(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+		glm::vec4 row3(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+		planes[v * 6 + 0] = row3 + row0;
+		planes[v * 6 + 1] = row3 - row0;
+		planes[v * 6 + 2] = row3 + row1;
+		planes[v * 6 + 3] = row3 - row1;
+		planes[v * 6 + 4] = row3 + row2;
+		planes[v * 6 + 5] = row3 - row2;
+	}
+
+	// room for every command, so the lists do not grow on the
+	// heap as moving parts come into view
+	order.opaqueOrder.reserve(m_commands.size());
+	order.transparentOrder.reserve(m_commands.size());
+
+	const glm::mat4& firstView = pViews[0].view;
+	m_cullDepths.resize(m_commands.size());
+	for (uint32_t i = 0; i < m_commands.size(); i++)
+	{
+		const glm::vec3& minXYZ = m_boundsMin[i];
+		const glm::vec3& maxXYZ = m_boundsMax[i];
+
+		bool bVisible = false;
+		for (int v = 0; (v < viewCount) && !bVisible; v++)
+		{
+			bVisible = true;
+			for (int p = 0; p < 6; p++)
+			{
+				// the box corner farthest along the plane normal
+				const glm::vec4& plane = planes[v * 6 + p];
+				glm::vec3 corner(
+					(plane.x >= 0.0f) ? maxXYZ.x : minXYZ.x,
+					(plane.y >= 0.0f) ? maxXYZ.y : minXYZ.y,
+					(plane.z >= 0.0f) ? maxXYZ.z : minXYZ.z);
+				if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f)
+				{
+					bVisible = false;
+					break;
+				}
+			}
+		}
+		if (!bVisible)
+		{
+			continue;
+		}
+
+		const DRAW_COMMAND& command = m_commands[i];
+		glm::vec4 center = command.model * glm::vec4(GetMeshLocalCenter(command.mesh), 1.0f);
+		m_cullDepths[i] = -(firstView * center).z;
+
+		if (IsTransparent(command))
+			order.transparentOrder.push_back(i);
+		else
+			order.opaqueOrder.push_back(i);
+	}
+
+	std::sort(order.opaqueOrder.begin(), order.opaqueOrder.end(),
+		[this](uint32_t a, uint32_t b)
+		{ return (m_cullDepths[a] < m_cullDepths[b]) || ((m_cullDepths[a] == m_cullDepths[b]) && (a < b)); });
+	std::sort(order.transparentOrder.begin(), order.transparentOrder.end(),
+		[this](uint32_t a, uint32_t b)
+		{ return (m_cullDepths[a] > m_cullDepths[b]) || ((m_cullDepths[a] == m_cullDepths[b]) && (a < b)); });
+}
+
+/***********************************************************
+ *  IsTransparent()
+ *
+ *  This method is used for checking whether the command
+ *  needs to be drawn in the blended transparent pass.
+ ***********************************************************/
+bool RenderQueue::IsTransparent(const DRAW_COMMAND& command)
+{
+	// textured draws take their alpha from the lit shader output,
+	// which is always opaque, so only the solid color is checked
+	return (command.textureID < 0) && (command.color.a < 1.0f);
+}
+
+/***********************************************************
+ *  GetMeshLocalCenter()
+ *
+ *  This method is used for getting the center of the basic
+ *  mesh or loaded model bounds in object space.
+ ***********************************************************/
+glm::vec3 RenderQueue::GetMeshLocalCenter(MESH_TYPE mesh)
+{
+	if (mesh >= MESH_MODEL_FIRST)
+	{
+		glm::vec3 minXYZ;
+		glm::vec3 maxXYZ;
+		GetMeshLocalBounds(mesh, minXYZ, maxXYZ);
+		return((minXYZ + maxXYZ) * 0.5f);
+	}
+
+	// the cylinder mesh extends upward from its base at the origin
+	if (mesh == MESH_CYLINDER)
+	{
+		return(glm::vec3(0.0f, 0.5f, 0.0f));
+	}
+
+	return(glm::vec3(0.0f));
+}
+
+/***********************************************************
+ *  GetMeshLocalBounds()
+ *
+ *  This method is used for getting the axis aligned bounds
+ *  of the basic mesh or the loaded model in object space.
+ ***********************************************************/
+void RenderQueue::GetMeshLocalBounds(MESH_TYPE mesh, glm::vec3& minXYZ, glm::vec3& maxXYZ)
+{
+	if (mesh >= MESH_MODEL_FIRST)
+	{
+		size_t model = (size_t)(mesh - MESH_MODEL_FIRST);
+		bool bKnown = (model < g_ModelBoundsMin.size());
+		minXYZ = bKnown ? g_ModelBoundsMin[model] : glm::vec3(0.0f);
+		maxXYZ = bKnown ? g_ModelBoundsMax[model] : glm::vec3(0.0f);
+		return;
+	}
+
+	switch (mesh)
+	{
+	case MESH_PLANE:
+		minXYZ = glm::vec3(-1.0f, 0.0f, -1.0f);
+		maxXYZ = glm::vec3(1.0f, 0.0f, 1.0f);
+		break;
+	case MESH_CYLINDER:
+		minXYZ = glm::vec3(-1.0f, 0.0f, -1.0f);
+		maxXYZ = glm::vec3(1.0f, 1.0f, 1.0f);
+		break;
+	default:
+		minXYZ = glm::vec3(-0.5f);
+		maxXYZ = glm::vec3(0.5f);
+		break;
+	}
+}
+
+/***********************************************************
+ *  GetWorldBounds()
+ *
+ *  This method is used for transforming the mesh bounds of
+ *  the command into an axis aligned box in world space.  An
+ *  animated part can be turned any way around its position,
+ *  so its box holds the sphere the turning part sweeps.
+ ***********************************************************/
+void RenderQueue::GetWorldBounds(const DRAW_COMMAND& command, glm::vec3& minXYZ, glm::vec3& maxXYZ)
+{
+	glm::vec3 localMin;
+	glm::vec3 localMax;
+	GetMeshLocalBounds(command.mesh, localMin, localMax);
+
+	if (command.animationIndex >= 0)
+	{
+		glm::vec3 farthest = glm::max(glm::abs(localMin), glm::abs(localMax));
+		glm::vec3 scaled(
+			glm::length(glm::vec3(command.model[0])) * farthest.x,
+			glm::length(glm::vec3(command.model[1])) * farthest.y,
+			glm::length(glm::vec3(command.model[2])) * farthest.z);
+		float radius = glm::length(scaled) + command.animationReach;
+		glm::vec3 position = glm::vec3(command.model[3]);
+
+		minXYZ = position - glm::vec3(radius);
+		maxXYZ = position + glm::vec3(radius);
+		return;
+	}
+
+	// transform the box center and its extents along the
+	// absolute matrix axes, which is exact for any affine model
+	glm::vec3 center = (localMin + localMax) * 0.5f;
+	glm::vec3 extent = (localMax - localMin) * 0.5f;
+	glm::vec3 worldCenter = glm::vec3(command.model * glm::vec4(center, 1.0f));
+	glm::vec3 worldExtent =
+		glm::abs(glm::vec3(command.model[0])) * extent.x +
+		glm::abs(glm::vec3(command.model[1])) * extent.y +
+		glm::abs(glm::vec3(command.model[2])) * extent.z;
+
+	minXYZ = worldCenter - worldExtent;
+	maxXYZ = worldCenter + worldExtent;
+}
+
+/***********************************************************
+ *  SetModelBounds()
+ *
+ *  This method is used for setting the object space bounds
+ *  of a loaded model, which the commands drawing it are
+ *  culled and sorted by.
+ ***********************************************************/
+void RenderQueue::SetModelBounds(int model, const glm::vec3& minXYZ, const glm::vec3& maxXYZ)
+{
+	if ((model < 0) || (model > MESH_MODEL_LAST - MESH_MODEL_FIRST))
+	{
+		return;
+	}
+	if ((size_t)model >= g_ModelBoundsMin.size())
+	{
+		g_ModelBoundsMin.resize(model + 1, glm::vec3(0.0f));
+		g_ModelBoundsMax.resize(model + 1, glm::vec3(0.0f));
+	}
+	g_ModelBoundsMin[model] = minXYZ;
+	g_ModelBoundsMax[model] = maxXYZ;
+}
@@ -0,0 +1,146 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderqueue.h
+// ============
+// collect the draw commands for a frame and order them for the
+// depth pre-pass, the opaque pass and the transparent pass
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// basic shape meshes that can be referenced by a draw command.
+// The loaded models follow them, model n is drawn with the mesh
+// MESH_MODEL_FIRST + n
+enum MESH_TYPE
+{
+	MESH_PLANE = 0,
+	MESH_BOX,
+	MESH_CYLINDER,
+	MESH_TYPE_COUNT,
+	MESH_MODEL_FIRST = MESH_TYPE_COUNT,
+	MESH_MODEL_LAST = MESH_MODEL_FIRST + 0xFFFF
+};
+
+/***********************************************************
+ *  DRAW_COMMAND
+ *
+ *  All the state needed to issue one mesh draw, captured
+ *  when the scene is built so the draws can be reordered.
+ ***********************************************************/
+struct DRAW_COMMAND
+{
+	MESH_TYPE mesh;
+	glm::mat4 model;
+	glm::vec4 color;
+	glm::vec2 uvScale;
+	// OpenGL texture ID, or -1 to draw with the solid color
+	int textureID;
+	// index into the defined materials, or -1 for none
+	int materialIndex;
+	bool bUseLighting;
+	// true for the static batches drawn with baked lightmaps
+	bool bUseLightmap;
+	// true for objects that move, so cached shadows exclude them
+	bool bDynamic;
+	// animation evaluated by the vertex shaders, or -1 for none
+	int animationIndex;
+	// farthest the animation moves the part away from its
+	// position without turning it
+	float animationReach;
+};
+
+/***********************************************************
+ *  RENDER_VIEW
+ *
+ *  One camera drawn into a part of the render target.  The
+ *  viewport is given in fractions of the target, so the
+ *  views follow the window size and the render resolution.
+ ***********************************************************/
+struct RENDER_VIEW
+{
+	glm::mat4 view;
+	glm::mat4 projection;
+	// left, bottom, width and height in fractions of the target
+	glm::vec4 viewport;
+};
+
+/***********************************************************
+ *  VIEW_ORDER
+ *
+ *  The commands visible in a view, in the order they are
+ *  drawn in the opaque and the transparent passes.
+ ***********************************************************/
+struct VIEW_ORDER
+{
+	std::vector<uint32_t> opaqueOrder;
+	std::vector<uint32_t> transparentOrder;
+};
+
+/***********************************************************
+ *  RenderQueue
+ *
+ *  This class holds the draw commands submitted for the
+ *  current frame and sorts them by view depth: opaque
+ *  commands front-to-back for early depth rejection and
+ *  transparent commands back-to-front for blending.
+ ***********************************************************/
+class RenderQueue
+{
+public:
+	// constructor
+	RenderQueue();
+	// destructor
+	~RenderQueue();
+
+	// remove all the submitted draw commands
+	void Clear();
+	// add a draw command to the queue
+	void Submit(const DRAW_COMMAND& command);
+	// split the commands into opaque and transparent lists
+	// and sort both by their depth in view space
+	void Sort(const glm::mat4& view);
+	// compute the world bounds of all the commands, once per
+	// frame for all the views
+	void UpdateBounds();
+	// list the commands inside the frustum of any of the views,
+	// sorted by their depth in the first view
+	void CullAndSort(const RENDER_VIEW* pViews, int viewCount, VIEW_ORDER& order);
+
+	// the submitted commands in submission order
+	const std::vector<DRAW_COMMAND>& GetCommands() const { return m_commands; }
+	// world bounds of the commands from UpdateBounds()
+	const std::vector<glm::vec3>& GetBoundsMin() const { return m_boundsMin; }
+	const std::vector<glm::vec3>& GetBoundsMax() const { return m_boundsMax; }
+	// indices of the opaque commands, nearest first
+	const std::vector<uint32_t>& GetOpaqueOrder() const { return m_opaqueOrder; }
+	// indices of the transparent commands, farthest first
+	const std::vector<uint32_t>& GetTransparentOrder() const { return m_transparentOrder; }
+
+	// true when the command has to be drawn with blending
+	static bool IsTransparent(const DRAW_COMMAND& command);
+	// center of the mesh bounds in object space
+	static glm::vec3 GetMeshLocalCenter(MESH_TYPE mesh);
+	// axis aligned mesh bounds in object space
+	static void GetMeshLocalBounds(MESH_TYPE mesh, glm::vec3& minXYZ, glm::vec3& maxXYZ);
+	// axis aligned bounds of the command in world space
+	static void GetWorldBounds(const DRAW_COMMAND& command, glm::vec3& minXYZ, glm::vec3& maxXYZ);
+	// set the object space bounds of a loaded model
+	static void SetModelBounds(int model, const glm::vec3& minXYZ, const glm::vec3& maxXYZ);
+
+private:
+	std::vector<DRAW_COMMAND> m_commands;
+	// distance in front of the camera for each command
+	std::vector<float> m_viewDepths;
+	std::vector<uint32_t> m_opaqueOrder;
+	std::vector<uint32_t> m_transparentOrder;
+	// world bounds of each command from UpdateBounds()
+	std::vector<glm::vec3> m_boundsMin;
+	std::vector<glm::vec3> m_boundsMax;
+	// frustum planes and command depths of the views being culled
+	std::vector<glm::vec4> m_cullPlanes;
+	std::vector<float> m_cullDepths;
+};
@@ -0,0 +1,257 @@
+///////////////////////////////////////////////////////////////////////////////
+// resolutionscaler.cpp
+// ============
+// scale the render resolution to hold a GPU frame time target
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ResolutionScaler.h"
+#include "GLTrace.h"
+#include "ResourceTracker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// the render size is rounded to this many pixels
+	const int g_SizeGranularity = 8;
+	// frames to wait after a change before the next one, long
+	// enough for the delayed and smoothed GPU times to show it
+	const unsigned long long g_SettleFrames = 20;
+	// aim a little under the target so noise does not miss it
+	const double g_Headroom = 0.9;
+	// relative scale differences that are not worth a change
+	const float g_DeadBand = 0.05f;
+	// fraction of the way to the wanted scale taken per change
+	const float g_Gain = 0.5f;
+	// largest change of the scale at once
+	const float g_MaxStep = 0.15f;
+	// owner of the upscale shader in the resource tracker
+	const char* const g_TrackerName = "dynamic resolution";
+}
+
+/***********************************************************
+ *  ResolutionScaler()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ResolutionScaler::ResolutionScaler()
+{
+	m_pFrameStats = NULL;
+	m_sectionID = -1;
+	m_pUpscaleShader = NULL;
+	m_vertexArray = 0;
+	m_textureWidth = 0;
+	m_textureHeight = 0;
+	m_windowWidth = 0;
+	m_windowHeight = 0;
+	m_renderWidth = 0;
+	m_renderHeight = 0;
+	m_targetMs = 16.6;
+	m_minScale = 0.5f;
+	m_maxScale = 1.0f;
+	m_scale = 1.0f;
+	m_lastChangeFrame = 0;
+}
+
+/***********************************************************
+ *  ~ResolutionScaler()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ResolutionScaler::~ResolutionScaler()
+{
+	if (0 != m_vertexArray)
+	{
+		glDeleteVertexArrays(1, &m_vertexArray);
+		m_vertexArray = 0;
+	}
+	if (NULL != m_pUpscaleShader)
+	{
+		ResourceTracker::Release(RESOURCE_PROGRAM, m_pUpscaleShader->m_programID);
+		delete m_pUpscaleShader;
+		m_pUpscaleShader = NULL;
+	}
+	m_pFrameStats = NULL;
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for loading the upscale shader and
+ *  registering the section whose GPU time drives the scale.
+ *  The frame graph times its scene pass under the same name.
+ ***********************************************************/
+bool ResolutionScaler::Initialize(FrameStats* pFrameStats)
+{
+	if (NULL == pFrameStats)
+	{
+		std::cout << "Dynamic resolution needs the frame statistics" << std::endl;
+		return false;
+	}
+	m_pFrameStats = pFrameStats;
+	m_sectionID = m_pFrameStats->RegisterSection("scene");
+
+	// loading binds the new program, the scene keeps its own
+	// bound from its setup
+	GLint previousProgram = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+	m_pUpscaleShader = new ShaderManager();
+	m_pUpscaleShader->LoadShaders(
+		"upscaleVertexShader.glsl",
+		"upscaleFragmentShader.glsl");
+	ResourceTracker::TrackProgram(m_pUpscaleShader->m_programID, g_TrackerName, "upscaleVertexShader.glsl");
+	GLTrace::UseProgram((GLuint)previousProgram);
+
+	glGenVertexArrays(1, &m_vertexArray);
+
+	return true;
+}
+
+/***********************************************************
+ *  SetTargetFrameMs()
+ *
+ *  This method is used for setting the GPU time the scene
+ *  should take per frame.
+ ***********************************************************/
+void ResolutionScaler::SetTargetFrameMs(double milliseconds)
+{
+	m_targetMs = std::max(milliseconds, 1.0);
+}
+
+/***********************************************************
+ *  SetScaleRange()
+ *
+ *  This method is used for limiting the fraction of the
+ *  window size the scene is rendered at.
+ ***********************************************************/
+void ResolutionScaler::SetScaleRange(float minScale, float maxScale)
+{
+	m_maxScale = glm::clamp(maxScale, 0.1f, 1.0f);
+	m_minScale = glm::clamp(minScale, 0.1f, m_maxScale);
+	m_scale = glm::clamp(m_scale, m_minScale, m_maxScale);
+}
+
+/***********************************************************
+ *  BeginScene()
+ *
+ *  This method is used for picking the render size of the
+ *  frame and limiting the rendering to that corner of the
+ *  bound offscreen target.
+ ***********************************************************/
+bool ResolutionScaler::BeginScene(int windowWidth, int windowHeight, int textureWidth, int textureHeight)
+{
+	if ((windowWidth <= 0) || (windowHeight <= 0) ||
+		(textureWidth <= 0) || (textureHeight <= 0) || (NULL == m_pFrameStats))
+	{
+		return false;
+	}
+	m_windowWidth = windowWidth;
+	m_windowHeight = windowHeight;
+	m_textureWidth = textureWidth;
+	m_textureHeight = textureHeight;
+
+	UpdateScale();
+
+	// round to whole blocks so small scale changes do not
+	// shift every pixel of the upscaled image
+	m_renderWidth = (int)std::lround(m_windowWidth * m_scale / g_SizeGranularity) * g_SizeGranularity;
+	m_renderHeight = (int)std::lround(m_windowHeight * m_scale / g_SizeGranularity) * g_SizeGranularity;
+	m_renderWidth = glm::clamp(m_renderWidth, std::min(g_SizeGranularity, m_textureWidth), m_textureWidth);
+	m_renderHeight = glm::clamp(m_renderHeight, std::min(g_SizeGranularity, m_textureHeight), m_textureHeight);
+
+	GLTrace::Viewport(0, 0, m_renderWidth, m_renderHeight);
+
+	return true;
+}
+
+/***********************************************************
+ *  EndScene()
+ *
+ *  This method is used for upscaling the rendered part of
+ *  the offscreen target into the window.  The shader and
+ *  texture of the scene are restored afterwards.
+ ***********************************************************/
+void ResolutionScaler::EndScene(GLuint colorTexture)
+{
+	if ((NULL == m_pFrameStats) || (0 == colorTexture))
+	{
+		return;
+	}
+
+	GLint previousProgram = 0;
+	GLint previousTexture = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+	GLTrace::ActiveTexture(GL_TEXTURE0);
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &previousTexture);
+
+	GLTrace::Viewport(0, 0, m_windowWidth, m_windowHeight);
+	GLTrace::Disable(GL_DEPTH_TEST);
+	GLTrace::Disable(GL_BLEND);
+
+	GLTrace::UseProgram(m_pUpscaleShader);
+	GLTrace::SetSampler(m_pUpscaleShader, "sourceTexture", 0);
+	GLTrace::SetVec2(m_pUpscaleShader, "sourceSize", glm::vec2((float)m_renderWidth, (float)m_renderHeight));
+	GLTrace::SetVec2(m_pUpscaleShader, "textureSize", glm::vec2((float)m_textureWidth, (float)m_textureHeight));
+	GLTrace::BindTexture(GL_TEXTURE_2D, colorTexture);
+
+	GLTrace::BindVertexArray(m_vertexArray);
+	GLTrace::DrawArrays(GL_TRIANGLES, 0, 3);
+	GLTrace::BindVertexArray(0);
+
+	GLTrace::BindTexture(GL_TEXTURE_2D, (GLuint)previousTexture);
+	GLTrace::UseProgram((GLuint)previousProgram);
+	GLTrace::Enable(GL_DEPTH_TEST);
+}
+
+/***********************************************************
+ *  UpdateScale()
+ *
+ *  This method is used for moving the scale toward the one
+ *  that meets the frame time target.  The GPU time of the
+ *  scene grows with its pixel count, the square of the
+ *  scale, so the wanted scale is the current one times the
+ *  square root of the time ratio.  Only part of the way is
+ *  taken, and only once the last change shows in the timing,
+ *  so the scale settles instead of oscillating.
+ ***********************************************************/
+void ResolutionScaler::UpdateScale()
+{
+	unsigned long long frameNumber = m_pFrameStats->GetFrameNumber();
+	if (frameNumber - m_lastChangeFrame < g_SettleFrames)
+	{
+		return;
+	}
+
+	double gpuMs = m_pFrameStats->GetSectionGpuMs(m_sectionID);
+	if (gpuMs <= 0.0)
+	{
+		return;
+	}
+
+	float wantedScale = m_scale * (float)std::sqrt(m_targetMs * g_Headroom / gpuMs);
+	wantedScale = glm::clamp(wantedScale, m_minScale, m_maxScale);
+
+	float difference = wantedScale - m_scale;
+	float step = glm::clamp(difference * g_Gain, -g_MaxStep, g_MaxStep);
+	if (std::fabs(difference) < g_DeadBand * m_scale)
+	{
+		// next to a limit go all the way instead of creeping
+		bool bAtLimit = (wantedScale == m_minScale) || (wantedScale == m_maxScale);
+		if (!bAtLimit || (difference == 0.0f))
+		{
+			return;
+		}
+		step = difference;
+	}
+
+	m_scale = glm::clamp(m_scale + step, m_minScale, m_maxScale);
+	m_lastChangeFrame = frameNumber;
+
+	std::cout << std::fixed << std::setprecision(2)
+		<< "RESOLUTION: scale " << m_scale << " for scene gpu " << gpuMs
+		<< " ms, target " << m_targetMs << " ms" << std::defaultfloat << std::endl;
+}
@@ -0,0 +1,83 @@
+///////////////////////////////////////////////////////////////////////////////
+// resolutionscaler.h
+// ============
+// scale the render resolution to hold a GPU frame time target
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+#include "FrameStats.h"
+
+#include <GL/glew.h>
+
+/***********************************************************
+ *  ResolutionScaler
+ *
+ *  This class renders the scene into a fraction of an
+ *  offscreen target and upscales it into the window with a
+ *  bicubic filter.  The fraction follows the GPU time of the
+ *  scene measured by the frame statistics, so heavy scenes
+ *  drop resolution instead of frame rate.  The target is a
+ *  texture of the frame graph sized for the largest scale,
+ *  so changing the scale never reallocates; only resizing
+ *  the window does.
+ ***********************************************************/
+class ResolutionScaler
+{
+public:
+	// constructor
+	ResolutionScaler();
+	// destructor
+	~ResolutionScaler();
+
+	// create the upscale shader and register the timed section
+	// with the frame statistics - needs a current OpenGL context
+	bool Initialize(FrameStats* pFrameStats);
+
+	// GPU time of the scene to hold, in milliseconds
+	void SetTargetFrameMs(double milliseconds);
+	// smallest and largest fraction of the window size
+	void SetScaleRange(float minScale, float maxScale);
+
+	// pick the scale for this frame and set the viewport to
+	// the part of the bound target the scene is drawn into,
+	// call before the frame is cleared.  Returns false when
+	// the window has no area
+	bool BeginScene(int windowWidth, int windowHeight, int textureWidth, int textureHeight);
+	// upscale the scene from the color texture of the target
+	// into the bound framebuffer, which covers the window
+	void EndScene(GLuint colorTexture);
+
+	float GetScale() const { return m_scale; }
+	// fraction of the window size the target is made for
+	float GetMaxScale() const { return m_maxScale; }
+	int GetRenderWidth() const { return m_renderWidth; }
+	int GetRenderHeight() const { return m_renderHeight; }
+
+private:
+	FrameStats* m_pFrameStats;
+	int m_sectionID;
+	ShaderManager* m_pUpscaleShader;
+	// the upscale triangle is built in the vertex shader, but
+	// the core profile still needs a vertex array bound
+	GLuint m_vertexArray;
+
+	int m_textureWidth;
+	int m_textureHeight;
+
+	int m_windowWidth;
+	int m_windowHeight;
+	int m_renderWidth;
+	int m_renderHeight;
+
+	double m_targetMs;
+	float m_minScale;
+	float m_maxScale;
+	float m_scale;
+	// frame number of the last scale change
+	unsigned long long m_lastChangeFrame;
+
+	// move the scale toward the frame time target
+	void UpdateScale();
+};
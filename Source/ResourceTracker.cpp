@@ -0,0 +1,398 @@
+///////////////////////////////////////////////////////////////////////////////
+// resourcetracker.cpp
+// ============
+// account for the GPU and host memory the renderer holds
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ResourceTracker.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+// declaration of global variables
+namespace
+{
+	const char* const g_CategoryNames[RESOURCE_CATEGORY_COUNT] =
+	{
+		"texture",
+		"target",
+		"buffer",
+		"program",
+		"staging",
+		"raster"
+	};
+
+	// the last GPU category, the rest are host memory
+	const int g_LastGpuCategory = RESOURCE_PROGRAM;
+
+	struct RESOURCE_RECORD
+	{
+		const char* subsystem;
+		std::string asset;
+		uint64_t bytes;
+	};
+
+	struct CATEGORY_TOTALS
+	{
+		uint64_t liveBytes;
+		uint64_t peakBytes;
+		int liveCount;
+		uint64_t budget;
+		// set while over the budget, so it is warned about once
+		bool bOverBudget;
+	};
+
+	typedef std::pair<int, uint64_t> RESOURCE_KEY;
+	std::map<RESOURCE_KEY, RESOURCE_RECORD> g_Resources;
+	CATEGORY_TOTALS g_Totals[RESOURCE_CATEGORY_COUNT] = {};
+	uint64_t g_GpuBytes = 0;
+	uint64_t g_GpuPeakBytes = 0;
+	uint64_t g_HostBytes = 0;
+	uint64_t g_HostPeakBytes = 0;
+
+	/***********************************************************
+	 *  ToMegabytes()
+	 ***********************************************************/
+	double ToMegabytes(uint64_t bytes)
+	{
+		return((double)bytes / (1024.0 * 1024.0));
+	}
+
+	/***********************************************************
+	 *  AddBytes()
+	 *
+	 *  This function is used for changing the live bytes of a
+	 *  category, keeping the peaks and warning when the
+	 *  category goes over its budget.
+	 ***********************************************************/
+	void AddBytes(int category, uint64_t removed, uint64_t added)
+	{
+		CATEGORY_TOTALS& totals = g_Totals[category];
+		totals.liveBytes = totals.liveBytes - removed + added;
+		totals.peakBytes = std::max(totals.peakBytes, totals.liveBytes);
+
+		if (category <= g_LastGpuCategory)
+		{
+			g_GpuBytes = g_GpuBytes - removed + added;
+			g_GpuPeakBytes = std::max(g_GpuPeakBytes, g_GpuBytes);
+		}
+		else
+		{
+			g_HostBytes = g_HostBytes - removed + added;
+			g_HostPeakBytes = std::max(g_HostPeakBytes, g_HostBytes);
+		}
+
+		bool bOver = (totals.budget > 0) && (totals.liveBytes > totals.budget);
+		if (bOver && !totals.bOverBudget)
+		{
+			std::cout << std::fixed << std::setprecision(2)
+				<< "MEMORY: " << g_CategoryNames[category] << " memory is over its budget, "
+				<< ToMegabytes(totals.liveBytes) << " MB of " << ToMegabytes(totals.budget) << " MB"
+				<< std::defaultfloat << std::endl;
+		}
+		totals.bOverBudget = bOver;
+	}
+}
+
+/***********************************************************
+ *  Track()
+ *
+ *  This method is used for recording a resource that was
+ *  created, or the new size of one that was resized.
+ ***********************************************************/
+void ResourceTracker::Track(RESOURCE_CATEGORY category, uint64_t key,
+	const char* subsystem, const char* asset, size_t bytes)
+{
+	if ((category < 0) || (category >= RESOURCE_CATEGORY_COUNT))
+	{
+		return;
+	}
+
+	RESOURCE_KEY resourceKey((int)category, key);
+	std::map<RESOURCE_KEY, RESOURCE_RECORD>::iterator found = g_Resources.find(resourceKey);
+	if (found != g_Resources.end())
+	{
+		// a resized resource keeps its names
+		uint64_t previous = found->second.bytes;
+		found->second.bytes = bytes;
+		AddBytes(category, previous, bytes);
+		return;
+	}
+
+	RESOURCE_RECORD record;
+	record.subsystem = (NULL != subsystem) ? subsystem : "";
+	record.asset = (NULL != asset) ? asset : "";
+	record.bytes = bytes;
+	g_Resources.insert(std::make_pair(resourceKey, record));
+	g_Totals[category].liveCount++;
+	AddBytes(category, 0, bytes);
+}
+
+/***********************************************************
+ *  Release()
+ *
+ *  This method is used for removing the record of a freed
+ *  resource.  Releasing an untracked key does nothing.
+ ***********************************************************/
+void ResourceTracker::Release(RESOURCE_CATEGORY category, uint64_t key)
+{
+	if ((category < 0) || (category >= RESOURCE_CATEGORY_COUNT))
+	{
+		return;
+	}
+
+	std::map<RESOURCE_KEY, RESOURCE_RECORD>::iterator found = g_Resources.find(RESOURCE_KEY((int)category, key));
+	if (found == g_Resources.end())
+	{
+		return;
+	}
+	AddBytes(category, found->second.bytes, 0);
+	g_Totals[category].liveCount--;
+	g_Resources.erase(found);
+}
+
+/***********************************************************
+ *  TrackProgram()
+ *
+ *  This method is used for recording a linked program.  The
+ *  driver memory behind a program is not exposed, so its
+ *  binary size stands in for it.
+ ***********************************************************/
+void ResourceTracker::TrackProgram(GLuint programID, const char* subsystem, const char* asset)
+{
+	if (0 == programID)
+	{
+		return;
+	}
+
+	GLint binaryBytes = 0;
+	if (GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary)
+	{
+		glGetProgramiv(programID, GL_PROGRAM_BINARY_LENGTH, &binaryBytes);
+	}
+	Track(RESOURCE_PROGRAM, programID, subsystem, asset, (size_t)std::max(binaryBytes, 0));
+}
+
+/***********************************************************
+ *  GetLiveBytes()
+ ***********************************************************/
+uint64_t ResourceTracker::GetLiveBytes(RESOURCE_CATEGORY category)
+{
+	return(((category >= 0) && (category < RESOURCE_CATEGORY_COUNT)) ? g_Totals[category].liveBytes : 0);
+}
+
+/***********************************************************
+ *  GetPeakBytes()
+ ***********************************************************/
+uint64_t ResourceTracker::GetPeakBytes(RESOURCE_CATEGORY category)
+{
+	return(((category >= 0) && (category < RESOURCE_CATEGORY_COUNT)) ? g_Totals[category].peakBytes : 0);
+}
+
+/***********************************************************
+ *  GetLiveCount()
+ ***********************************************************/
+int ResourceTracker::GetLiveCount(RESOURCE_CATEGORY category)
+{
+	return(((category >= 0) && (category < RESOURCE_CATEGORY_COUNT)) ? g_Totals[category].liveCount : 0);
+}
+
+/***********************************************************
+ *  GetGpuBytes()
+ ***********************************************************/
+uint64_t ResourceTracker::GetGpuBytes()
+{
+	return(g_GpuBytes);
+}
+
+/***********************************************************
+ *  GetGpuPeakBytes()
+ ***********************************************************/
+uint64_t ResourceTracker::GetGpuPeakBytes()
+{
+	return(g_GpuPeakBytes);
+}
+
+/***********************************************************
+ *  GetHostBytes()
+ ***********************************************************/
+uint64_t ResourceTracker::GetHostBytes()
+{
+	return(g_HostBytes);
+}
+
+/***********************************************************
+ *  GetHostPeakBytes()
+ ***********************************************************/
+uint64_t ResourceTracker::GetHostPeakBytes()
+{
+	return(g_HostPeakBytes);
+}
+
+/***********************************************************
+ *  SetBudget()
+ *
+ *  This method is used for setting the most memory a
+ *  category should hold.  Going over it is only warned
+ *  about, the owners decide what to free.
+ ***********************************************************/
+void ResourceTracker::SetBudget(RESOURCE_CATEGORY category, uint64_t bytes)
+{
+	if ((category < 0) || (category >= RESOURCE_CATEGORY_COUNT))
+	{
+		return;
+	}
+	g_Totals[category].budget = bytes;
+	g_Totals[category].bOverBudget = false;
+	// warn now when the category is already over
+	AddBytes(category, 0, 0);
+}
+
+/***********************************************************
+ *  GetBudget()
+ ***********************************************************/
+uint64_t ResourceTracker::GetBudget(RESOURCE_CATEGORY category)
+{
+	return(((category >= 0) && (category < RESOURCE_CATEGORY_COUNT)) ? g_Totals[category].budget : 0);
+}
+
+/***********************************************************
+ *  Dump()
+ *
+ *  This method is used for writing the totals of every
+ *  category followed by its live resources.
+ ***********************************************************/
+void ResourceTracker::Dump(std::ostream& stream)
+{
+	stream << std::fixed << std::setprecision(2)
+		<< "gpu " << ToMegabytes(g_GpuBytes) << " MB (peak " << ToMegabytes(g_GpuPeakBytes) << " MB)"
+		<< " host " << ToMegabytes(g_HostBytes) << " MB (peak " << ToMegabytes(g_HostPeakBytes) << " MB)" << std::endl;
+
+	for (int category = 0; category < RESOURCE_CATEGORY_COUNT; category++)
+	{
+		const CATEGORY_TOTALS& totals = g_Totals[category];
+		stream << g_CategoryNames[category] << ": " << totals.liveCount << " live, "
+			<< ToMegabytes(totals.liveBytes) << " MB (peak " << ToMegabytes(totals.peakBytes) << " MB";
+		if (totals.budget > 0)
+		{
+			stream << ", budget " << ToMegabytes(totals.budget) << " MB";
+		}
+		stream << ")" << std::endl;
+
+		std::vector<std::pair<uint64_t, const RESOURCE_RECORD*>> records;
+		std::map<RESOURCE_KEY, RESOURCE_RECORD>::const_iterator it = g_Resources.lower_bound(RESOURCE_KEY(category, 0));
+		for (; (it != g_Resources.end()) && (it->first.first == category); ++it)
+		{
+			records.push_back(std::make_pair(it->first.second, &it->second));
+		}
+		std::sort(records.begin(), records.end(),
+			[](const std::pair<uint64_t, const RESOURCE_RECORD*>& a, const std::pair<uint64_t, const RESOURCE_RECORD*>& b)
+			{
+				return a.second->bytes > b.second->bytes;
+			});
+
+		for (size_t i = 0; i < records.size(); i++)
+		{
+			const RESOURCE_RECORD& record = *records[i].second;
+			stream << "  " << std::setw(10) << (ToMegabytes(record.bytes) * 1024.0) << " KB  "
+				<< record.subsystem;
+			if (!record.asset.empty())
+			{
+				stream << " " << record.asset;
+			}
+			stream << std::endl;
+		}
+	}
+	stream << std::defaultfloat;
+}
+
+/***********************************************************
+ *  ReportLeaks()
+ *
+ *  This method is used for printing every resource that is
+ *  still live, for after the owners were destroyed.
+ ***********************************************************/
+int ResourceTracker::ReportLeaks()
+{
+	int leaks = 0;
+	std::map<RESOURCE_KEY, RESOURCE_RECORD>::const_iterator it = g_Resources.begin();
+	for (; it != g_Resources.end(); ++it)
+	{
+		std::cout << "LEAK: " << g_CategoryNames[it->first.first] << " " << it->first.second
+			<< " of " << it->second.subsystem;
+		if (!it->second.asset.empty())
+		{
+			std::cout << " " << it->second.asset;
+		}
+		std::cout << ", " << it->second.bytes << " bytes" << std::endl;
+		leaks++;
+	}
+	return(leaks);
+}
+
+/***********************************************************
+ *  GetCategoryName()
+ ***********************************************************/
+const char* ResourceTracker::GetCategoryName(RESOURCE_CATEGORY category)
+{
+	return(((category >= 0) && (category < RESOURCE_CATEGORY_COUNT)) ? g_CategoryNames[category] : "");
+}
+
+/***********************************************************
+ *  FindCategory()
+ *
+ *  This method is used for getting a category from its
+ *  name.  Returns false for an unknown name.
+ ***********************************************************/
+bool ResourceTracker::FindCategory(const char* name, RESOURCE_CATEGORY& category)
+{
+	for (int i = 0; i < RESOURCE_CATEGORY_COUNT; i++)
+	{
+		if (0 == strcmp(name, g_CategoryNames[i]))
+		{
+			category = (RESOURCE_CATEGORY)i;
+			return(true);
+		}
+	}
+	return(false);
+}
+
+/***********************************************************
+ *  GetImageBytes()
+ *
+ *  This method is used for getting the size of one level
+ *  of a texture or render buffer.  Formats the renderer does
+ *  not use are counted at four bytes a texel.
+ ***********************************************************/
+size_t ResourceTracker::GetImageBytes(GLenum internalFormat, int width, int height, int depth)
+{
+	size_t texelBytes = 4;
+	switch (internalFormat)
+	{
+	case GL_R8:
+		texelBytes = 1;
+		break;
+	case GL_RG8:
+		texelBytes = 2;
+		break;
+	case GL_RGB8:
+	case GL_RGB:
+		texelBytes = 3;
+		break;
+	case GL_RGBA16F:
+		texelBytes = 8;
+		break;
+	case GL_RGBA32F:
+		texelBytes = 16;
+		break;
+	default:
+		break;
+	}
+	return(texelBytes * (size_t)std::max(width, 0) * (size_t)std::max(height, 0) * (size_t)std::max(depth, 1));
+}
@@ -0,0 +1,84 @@
+///////////////////////////////////////////////////////////////////////////////
+// resourcetracker.h
+// ============
+// account for the GPU and host memory the renderer holds
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+// what a tracked allocation is, each with its own total and
+// budget.  The first categories are GPU memory
+enum RESOURCE_CATEGORY
+{
+	RESOURCE_TEXTURE = 0,
+	RESOURCE_RENDER_TARGET,
+	RESOURCE_BUFFER,
+	RESOURCE_PROGRAM,
+	// CPU copies of what goes to or comes from the GPU
+	RESOURCE_HOST_STAGING,
+	// images the CPU rasterizer draws into and samples
+	RESOURCE_HOST_RASTER,
+	RESOURCE_CATEGORY_COUNT
+};
+
+/***********************************************************
+ *  ResourceTracker
+ *
+ *  This class keeps a record of every GPU allocation the
+ *  renderer makes and of the host memory that goes with
+ *  them, each tagged with the subsystem that owns it and
+ *  the asset it holds.  The owners report a resource when
+ *  they create or resize it and again when they free it,
+ *  so the live and peak totals per category can be read at
+ *  any time and what is still live at shutdown is a leak.
+ *  A category over its budget is warned about once each
+ *  time it goes over.  The records are kept by category and
+ *  key, the OpenGL object name or the address of the host
+ *  memory.  Only the render thread reports resources.
+ ***********************************************************/
+class ResourceTracker
+{
+public:
+	// add a resource, or set the size of one already tracked.
+	// The subsystem must be a string that outlives the record
+	static void Track(RESOURCE_CATEGORY category, uint64_t key,
+		const char* subsystem, const char* asset, size_t bytes);
+	static void Release(RESOURCE_CATEGORY category, uint64_t key);
+	// render buffers share the render target category with
+	// textures, so they are keyed apart from the texture names
+	static uint64_t GetRenderbufferKey(GLuint renderbufferID) { return (1ull << 32) | renderbufferID; }
+	// a linked program, sized by its binary when the driver
+	// can report it
+	static void TrackProgram(GLuint programID, const char* subsystem, const char* asset);
+
+	// bytes now and at most, per category and in total
+	static uint64_t GetLiveBytes(RESOURCE_CATEGORY category);
+	static uint64_t GetPeakBytes(RESOURCE_CATEGORY category);
+	static int GetLiveCount(RESOURCE_CATEGORY category);
+	static uint64_t GetGpuBytes();
+	static uint64_t GetGpuPeakBytes();
+	static uint64_t GetHostBytes();
+	static uint64_t GetHostPeakBytes();
+
+	// 0 for no budget
+	static void SetBudget(RESOURCE_CATEGORY category, uint64_t bytes);
+	static uint64_t GetBudget(RESOURCE_CATEGORY category);
+
+	// write the totals and every live resource, the largest
+	// first within each category
+	static void Dump(std::ostream& stream);
+	// print the resources still live, returns their count
+	static int ReportLeaks();
+
+	static const char* GetCategoryName(RESOURCE_CATEGORY category);
+	static bool FindCategory(const char* name, RESOURCE_CATEGORY& category);
+	// bytes of a texture level in one of the formats the
+	// renderer uses
+	static size_t GetImageBytes(GLenum internalFormat, int width, int height, int depth);
+};
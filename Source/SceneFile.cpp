@@ -0,0 +1,667 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenefile.cpp
+// ============
+// compile and load the scene description files
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneFile.h"
+#include "RenderQueue.h"
+
+#include <glm/gtx/transform.hpp>
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <vector>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+// declaration of global variables
+namespace
+{
+	// mesh names used by the text form, in MESH_TYPE order
+	const char* g_MeshNames[MESH_TYPE_COUNT] = { "plane", "box", "cylinder" };
+	// extension of the text form and suffix of the binary form
+	const char* g_TextExtension = ".scene";
+	const char* g_BinarySuffix = "bin";
+
+	/***********************************************************
+	 *  GetModifiedTime()
+	 *
+	 *  This function is used for getting the last write time
+	 *  of a file, or -1 when the file does not exist.
+	 ***********************************************************/
+	long long GetModifiedTime(const std::string& filename)
+	{
+#ifdef _WIN32
+		struct _stat fileInfo;
+		if (_stat(filename.c_str(), &fileInfo) != 0)
+			return(-1);
+#else
+		struct stat fileInfo;
+		if (stat(filename.c_str(), &fileInfo) != 0)
+			return(-1);
+#endif
+		return((long long)fileInfo.st_mtime);
+	}
+
+	/***********************************************************
+	 *  STRING_TABLE
+	 *
+	 *  Collects the strings of a scene being compiled, storing
+	 *  each distinct string once.
+	 ***********************************************************/
+	struct STRING_TABLE
+	{
+		std::vector<char> data;
+		std::map<std::string, uint32_t> offsets;
+
+		uint32_t Add(const std::string& text)
+		{
+			std::map<std::string, uint32_t>::iterator it = offsets.find(text);
+			if (it != offsets.end())
+			{
+				return(it->second);
+			}
+			uint32_t offset = (uint32_t)data.size();
+			data.insert(data.end(), text.begin(), text.end());
+			data.push_back('\0');
+			offsets[text] = offset;
+			return(offset);
+		}
+	};
+
+	/***********************************************************
+	 *  ReadFloats()
+	 *
+	 *  This function is used for reading the values that follow
+	 *  a keyword of the text form.
+	 ***********************************************************/
+	bool ReadFloats(std::istringstream& stream, float* pValues, int count)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			if (!(stream >> pValues[i]))
+				return(false);
+		}
+		return(true);
+	}
+
+	/***********************************************************
+	 *  RoundToPeriod()
+	 *
+	 *  This function is used for turning a rate in cycles per
+	 *  second into radians per second, rounded so the motion
+	 *  repeats exactly after the animation period.
+	 ***********************************************************/
+	float RoundToPeriod(float cyclesPerSecond)
+	{
+		double cycles = std::floor(cyclesPerSecond * SCENE_ANIMATION_PERIOD + 0.5);
+		return((float)(cycles * 2.0 * 3.14159265358979323846 / SCENE_ANIMATION_PERIOD));
+	}
+
+	/***********************************************************
+	 *  FindTag()
+	 *
+	 *  This function is used for finding a texture, material or
+	 *  model record by its tag while compiling.
+	 ***********************************************************/
+	template <typename RECORD>
+	int32_t FindTag(const std::vector<RECORD>& records, const STRING_TABLE& strings, const std::string& tag)
+	{
+		for (size_t i = 0; i < records.size(); i++)
+		{
+			if (tag.compare(&strings.data[records[i].tag]) == 0)
+				return((int32_t)i);
+		}
+		return(-1);
+	}
+}
+
+/***********************************************************
+ *  SceneFile()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneFile::SceneFile()
+{
+	m_pHeader = NULL;
+	m_pTextures = NULL;
+	m_pMaterials = NULL;
+	m_pLights = NULL;
+	m_pParts = NULL;
+	m_pAnimations = NULL;
+	m_pModels = NULL;
+	m_pStrings = NULL;
+}
+
+/***********************************************************
+ *  ~SceneFile()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+SceneFile::~SceneFile()
+{
+	m_file.Close();
+}
+
+/***********************************************************
+ *  GetBinaryFilename()
+ *
+ *  This method is used for getting the name of the binary
+ *  file a text scene file is compiled into, which sits next
+ *  to the text file.
+ ***********************************************************/
+std::string SceneFile::GetBinaryFilename(const std::string& textFilename)
+{
+	return(textFilename + g_BinarySuffix);
+}
+
+/***********************************************************
+ *  GetReloadFilename()
+ *
+ *  This method is used for getting the name of a binary file
+ *  a changed text scene file can be compiled into while the
+ *  scene is running.  The mapped binary file cannot be
+ *  written over, so reloads alternate between two slots.
+ ***********************************************************/
+std::string SceneFile::GetReloadFilename(const std::string& textFilename, int slot)
+{
+	std::string baseName = textFilename;
+	if (IsTextFilename(textFilename))
+	{
+		baseName.resize(textFilename.size() - strlen(g_TextExtension));
+	}
+	return(baseName + ".reload" + std::to_string(slot) + g_TextExtension + g_BinarySuffix);
+}
+
+/***********************************************************
+ *  IsTextFilename()
+ *
+ *  This method is used for checking whether a file name has
+ *  the extension of the text form.
+ ***********************************************************/
+bool SceneFile::IsTextFilename(const std::string& filename)
+{
+	size_t extensionLength = strlen(g_TextExtension);
+	return((filename.size() > extensionLength) &&
+		(filename.compare(filename.size() - extensionLength, extensionLength, g_TextExtension) == 0));
+}
+
+/***********************************************************
+ *  Load()
+ *
+ *  This method is used for mapping a scene into memory.  For
+ *  a text scene file the binary file next to it is used, and
+ *  compiled first when it is missing or older than the text,
+ *  so content changes never need the program rebuilt.
+ ***********************************************************/
+bool SceneFile::Load(const std::string& filename)
+{
+	std::string binaryFilename = filename;
+	bool bTextFile = false;
+
+	if (IsTextFilename(filename))
+	{
+		bTextFile = true;
+		binaryFilename = GetBinaryFilename(filename);
+
+		long long textTime = GetModifiedTime(filename);
+		long long binaryTime = GetModifiedTime(binaryFilename);
+		if ((textTime >= 0) && (binaryTime < textTime))
+		{
+			if (!Compile(filename, binaryFilename))
+			{
+				return(false);
+			}
+		}
+	}
+
+	if (m_file.Open(binaryFilename) && Validate())
+	{
+		return(true);
+	}
+
+	// a binary file from an older build is compiled again
+	if (bTextFile && (GetModifiedTime(filename) >= 0))
+	{
+		m_file.Close();
+		if (Compile(filename, binaryFilename) &&
+			m_file.Open(binaryFilename) && Validate())
+		{
+			return(true);
+		}
+	}
+
+	std::cout << "Could not load scene file:" << binaryFilename << std::endl;
+	m_file.Close();
+	return(false);
+}
+
+/***********************************************************
+ *  Validate()
+ *
+ *  This method is used for checking that the header and all
+ *  the records of the mapped file are within the file, and
+ *  that every index and string offset is in range, so the
+ *  records can then be used without further checks.
+ ***********************************************************/
+bool SceneFile::Validate()
+{
+	const unsigned char* pData = m_file.GetData();
+	size_t size = m_file.GetSize();
+
+	if (size < sizeof(SCENE_FILE_HEADER))
+	{
+		return(false);
+	}
+
+	const SCENE_FILE_HEADER* pHeader = (const SCENE_FILE_HEADER*)pData;
+	if ((pHeader->magic != SCENE_FILE_MAGIC) ||
+		(pHeader->version != SCENE_FILE_VERSION) ||
+		(pHeader->fileSize != size))
+	{
+		return(false);
+	}
+
+	const SCENE_SECTION* sections[6] = { &pHeader->textures, &pHeader->materials, &pHeader->lights, &pHeader->parts, &pHeader->animations, &pHeader->models };
+	const size_t recordSizes[6] = { sizeof(SCENE_TEXTURE_RECORD), sizeof(SCENE_MATERIAL_RECORD), sizeof(SCENE_LIGHT_RECORD), sizeof(SCENE_PART_RECORD), sizeof(SCENE_ANIMATION_RECORD), sizeof(SCENE_MODEL_RECORD) };
+	for (int i = 0; i < 6; i++)
+	{
+		if (((sections[i]->offset % 4) != 0) ||
+			((unsigned long long)sections[i]->offset + (unsigned long long)sections[i]->count * recordSizes[i] > size))
+		{
+			return(false);
+		}
+	}
+
+	// the string table must end with a terminator so any offset
+	// inside it reads a terminated string
+	uint32_t stringBytes = pHeader->strings.count;
+	if ((stringBytes == 0) ||
+		((unsigned long long)pHeader->strings.offset + stringBytes > size) ||
+		(pData[pHeader->strings.offset + stringBytes - 1] != '\0'))
+	{
+		return(false);
+	}
+
+	const SCENE_TEXTURE_RECORD* pTextures = (const SCENE_TEXTURE_RECORD*)(pData + pHeader->textures.offset);
+	for (uint32_t i = 0; i < pHeader->textures.count; i++)
+	{
+		if ((pTextures[i].tag >= stringBytes) || (pTextures[i].path >= stringBytes))
+			return(false);
+	}
+
+	const SCENE_MATERIAL_RECORD* pMaterials = (const SCENE_MATERIAL_RECORD*)(pData + pHeader->materials.offset);
+	for (uint32_t i = 0; i < pHeader->materials.count; i++)
+	{
+		if (pMaterials[i].tag >= stringBytes)
+			return(false);
+	}
+
+	const SCENE_MODEL_RECORD* pModels = (const SCENE_MODEL_RECORD*)(pData + pHeader->models.offset);
+	for (uint32_t i = 0; i < pHeader->models.count; i++)
+	{
+		if ((pModels[i].tag >= stringBytes) || (pModels[i].path >= stringBytes))
+			return(false);
+	}
+
+	const SCENE_PART_RECORD* pParts = (const SCENE_PART_RECORD*)(pData + pHeader->parts.offset);
+	for (uint32_t i = 0; i < pHeader->parts.count; i++)
+	{
+		const SCENE_PART_RECORD& part = pParts[i];
+		if ((part.group >= stringBytes) ||
+			((unsigned long long)part.mesh >= (unsigned long long)MESH_MODEL_FIRST + pHeader->models.count) ||
+			(part.texture >= (int32_t)pHeader->textures.count) ||
+			(part.material >= (int32_t)pHeader->materials.count) ||
+			(part.animation >= (int32_t)pHeader->animations.count))
+		{
+			return(false);
+		}
+	}
+
+	m_pHeader = pHeader;
+	m_pTextures = pTextures;
+	m_pMaterials = pMaterials;
+	m_pLights = (const SCENE_LIGHT_RECORD*)(pData + pHeader->lights.offset);
+	m_pParts = pParts;
+	m_pAnimations = (const SCENE_ANIMATION_RECORD*)(pData + pHeader->animations.offset);
+	m_pModels = pModels;
+	m_pStrings = (const char*)(pData + pHeader->strings.offset);
+
+	return(true);
+}
+
+/***********************************************************
+ *  Compile()
+ *
+ *  This method is used for compiling the text form of a
+ *  scene into the binary form.  Each line of the text form
+ *  defines one record, with optional keyword values:
+ *
+ *  texture <tag> <image file>
+ *  model <tag> <OBJ or glTF file>
+ *  material <tag> ambientStrength f ambient r g b
+ *      diffuse r g b specular r g b shininess f
+ *  light position x y z ambient r g b diffuse r g b
+ *      specular r g b focal f intensity f shadows
+ *  part <group> plane|box|cylinder|<model tag> texture <tag>
+ *      color r g b a uv u v material <tag> scale x y z
+ *      rotate x y z position x y z dynamic unlit
+ *      spin x y z turns bob x y z cycles phase degrees
+ *
+ *  Parts with spin or bob are animated by the vertex shaders
+ *  and always treated as dynamic.  Turns and cycles are per
+ *  second, the spin axis and bob offset are in the frame of
+ *  the part after its rotation, centered on its position.
+ *  A model must be defined before the parts drawing it and
+ *  is drawn in its own units.  Blank lines and lines
+ *  starting with # are ignored.
+ ***********************************************************/
+bool SceneFile::Compile(const std::string& textFilename, const std::string& binaryFilename)
+{
+	std::ifstream input(textFilename.c_str());
+	if (!input)
+	{
+		std::cout << "Could not open scene file:" << textFilename << std::endl;
+		return(false);
+	}
+
+	STRING_TABLE strings;
+	std::vector<SCENE_TEXTURE_RECORD> textures;
+	std::vector<SCENE_MATERIAL_RECORD> materials;
+	std::vector<SCENE_LIGHT_RECORD> lights;
+	std::vector<SCENE_PART_RECORD> parts;
+	std::vector<SCENE_ANIMATION_RECORD> animations;
+	std::vector<SCENE_MODEL_RECORD> models;
+
+	std::string line;
+	int lineNumber = 0;
+	bool bError = false;
+
+	while (!bError && std::getline(input, line))
+	{
+		lineNumber++;
+		std::istringstream stream(line);
+		std::string type;
+		if (!(stream >> type) || (type[0] == '#'))
+		{
+			continue;
+		}
+
+		std::string keyword;
+		if (type == "texture")
+		{
+			std::string tag;
+			std::string path;
+			if (!(stream >> tag >> path))
+			{
+				bError = true;
+				break;
+			}
+			SCENE_TEXTURE_RECORD texture;
+			texture.tag = strings.Add(tag);
+			texture.path = strings.Add(path);
+			textures.push_back(texture);
+		}
+		else if (type == "model")
+		{
+			std::string tag;
+			std::string path;
+			if (!(stream >> tag >> path) || (models.size() > MESH_MODEL_LAST - MESH_MODEL_FIRST))
+			{
+				bError = true;
+				break;
+			}
+			SCENE_MODEL_RECORD model;
+			model.tag = strings.Add(tag);
+			model.path = strings.Add(path);
+			models.push_back(model);
+		}
+		else if (type == "material")
+		{
+			std::string tag;
+			if (!(stream >> tag))
+			{
+				bError = true;
+				break;
+			}
+			SCENE_MATERIAL_RECORD material;
+			memset(&material, 0, sizeof(material));
+			material.tag = strings.Add(tag);
+			material.ambientStrength = 0.2f;
+			material.shininess = 32.0f;
+
+			while (!bError && (stream >> keyword))
+			{
+				if (keyword == "ambientStrength")
+					bError = !ReadFloats(stream, &material.ambientStrength, 1);
+				else if (keyword == "ambient")
+					bError = !ReadFloats(stream, material.ambientColor, 3);
+				else if (keyword == "diffuse")
+					bError = !ReadFloats(stream, material.diffuseColor, 3);
+				else if (keyword == "specular")
+					bError = !ReadFloats(stream, material.specularColor, 3);
+				else if (keyword == "shininess")
+					bError = !ReadFloats(stream, &material.shininess, 1);
+				else
+					bError = true;
+			}
+			materials.push_back(material);
+		}
+		else if (type == "light")
+		{
+			SCENE_LIGHT_RECORD light;
+			memset(&light, 0, sizeof(light));
+			light.focalStrength = 32.0f;
+			light.specularIntensity = 0.5f;
+
+			while (!bError && (stream >> keyword))
+			{
+				if (keyword == "position")
+					bError = !ReadFloats(stream, light.position, 3);
+				else if (keyword == "ambient")
+					bError = !ReadFloats(stream, light.ambientColor, 3);
+				else if (keyword == "diffuse")
+					bError = !ReadFloats(stream, light.diffuseColor, 3);
+				else if (keyword == "specular")
+					bError = !ReadFloats(stream, light.specularColor, 3);
+				else if (keyword == "focal")
+					bError = !ReadFloats(stream, &light.focalStrength, 1);
+				else if (keyword == "intensity")
+					bError = !ReadFloats(stream, &light.specularIntensity, 1);
+				else if (keyword == "shadows")
+					light.flags |= SCENE_LIGHT_SHADOWS;
+				else
+					bError = true;
+			}
+			lights.push_back(light);
+		}
+		else if (type == "part")
+		{
+			std::string group;
+			std::string meshName;
+			if (!(stream >> group >> meshName))
+			{
+				bError = true;
+				break;
+			}
+
+			SCENE_PART_RECORD part;
+			memset(&part, 0, sizeof(part));
+			part.group = strings.Add(group);
+			// a basic mesh name or the tag of a model
+			int32_t modelIndex = FindTag(models, strings, meshName);
+			bool bMeshFound = (modelIndex >= 0);
+			part.mesh = bMeshFound ? (uint32_t)MESH_MODEL_FIRST + (uint32_t)modelIndex : (uint32_t)MESH_TYPE_COUNT;
+			for (uint32_t i = 0; i < MESH_TYPE_COUNT; i++)
+			{
+				if (meshName == g_MeshNames[i])
+				{
+					part.mesh = i;
+					bMeshFound = true;
+				}
+			}
+			part.texture = -1;
+			part.material = -1;
+			part.color[0] = part.color[1] = part.color[2] = part.color[3] = 1.0f;
+			part.uvScale[0] = part.uvScale[1] = 1.0f;
+			part.animation = -1;
+			bError = !bMeshFound;
+
+			glm::vec3 scale(1.0f);
+			glm::vec3 rotation(0.0f);
+			glm::vec3 position(0.0f);
+			std::string tag;
+			// spin axis and turns, bob offset and cycles, phase
+			glm::vec4 spin(0.0f, 1.0f, 0.0f, 0.0f);
+			glm::vec4 bob(0.0f);
+			float phase = 0.0f;
+			bool bAnimated = false;
+
+			while (!bError && (stream >> keyword))
+			{
+				if (keyword == "texture")
+				{
+					bError = !(stream >> tag) || ((part.texture = FindTag(textures, strings, tag)) < 0);
+				}
+				else if (keyword == "material")
+				{
+					bError = !(stream >> tag) || ((part.material = FindTag(materials, strings, tag)) < 0);
+				}
+				else if (keyword == "color")
+					bError = !ReadFloats(stream, part.color, 4);
+				else if (keyword == "uv")
+					bError = !ReadFloats(stream, part.uvScale, 2);
+				else if (keyword == "scale")
+					bError = !ReadFloats(stream, &scale.x, 3);
+				else if (keyword == "rotate")
+					bError = !ReadFloats(stream, &rotation.x, 3);
+				else if (keyword == "position")
+					bError = !ReadFloats(stream, &position.x, 3);
+				else if (keyword == "dynamic")
+					part.flags |= SCENE_PART_DYNAMIC;
+				else if (keyword == "unlit")
+					part.flags |= SCENE_PART_UNLIT;
+				else if (keyword == "spin")
+				{
+					bError = !ReadFloats(stream, &spin.x, 4) || (glm::length(glm::vec3(spin)) == 0.0f);
+					bAnimated = true;
+				}
+				else if (keyword == "bob")
+				{
+					bError = !ReadFloats(stream, &bob.x, 4);
+					bAnimated = true;
+				}
+				else if (keyword == "phase")
+				{
+					bError = !ReadFloats(stream, &phase, 1);
+					bAnimated = true;
+				}
+				else
+					bError = true;
+			}
+
+			if (bAnimated)
+			{
+				SCENE_ANIMATION_RECORD animation;
+				glm::vec3 axis = glm::normalize(glm::vec3(spin));
+				for (int i = 0; i < 3; i++)
+				{
+					animation.spinAxis[i] = axis[i];
+					animation.bobOffset[i] = bob[i];
+					// a flat part cannot be turned rigidly by unscaling
+					// it, any scale works because it has no volume
+					animation.scale[i] = (scale[i] != 0.0f) ? scale[i] : 1.0f;
+				}
+				animation.spinRate = RoundToPeriod(spin.w);
+				animation.bobRate = RoundToPeriod(bob.w);
+				animation.phase = glm::radians(phase);
+
+				part.animation = (int32_t)animations.size();
+				part.flags |= SCENE_PART_DYNAMIC;
+				animations.push_back(animation);
+			}
+
+			// same order as SceneManager::SetTransformations()
+			glm::mat4 model =
+				glm::translate(position) *
+				glm::rotate(glm::radians(rotation.x), glm::vec3(1.0f, 0.0f, 0.0f)) *
+				glm::rotate(glm::radians(rotation.y), glm::vec3(0.0f, 1.0f, 0.0f)) *
+				glm::rotate(glm::radians(rotation.z), glm::vec3(0.0f, 0.0f, 1.0f)) *
+				glm::scale(scale);
+			for (int column = 0; column < 4; column++)
+			{
+				for (int row = 0; row < 4; row++)
+				{
+					part.model[column * 4 + row] = model[column][row];
+				}
+			}
+			parts.push_back(part);
+		}
+		else
+		{
+			bError = true;
+		}
+	}
+
+	if (bError)
+	{
+		std::cout << "Scene file error:" << textFilename << ":" << lineNumber << ": " << line << std::endl;
+		return(false);
+	}
+
+	// at least one byte so the string table always ends with a terminator
+	strings.Add("");
+
+	SCENE_FILE_HEADER header;
+	uint32_t offset = sizeof(SCENE_FILE_HEADER);
+	header.magic = SCENE_FILE_MAGIC;
+	header.version = SCENE_FILE_VERSION;
+	header.textures.offset = offset;
+	header.textures.count = (uint32_t)textures.size();
+	offset += header.textures.count * sizeof(SCENE_TEXTURE_RECORD);
+	header.materials.offset = offset;
+	header.materials.count = (uint32_t)materials.size();
+	offset += header.materials.count * sizeof(SCENE_MATERIAL_RECORD);
+	header.lights.offset = offset;
+	header.lights.count = (uint32_t)lights.size();
+	offset += header.lights.count * sizeof(SCENE_LIGHT_RECORD);
+	header.parts.offset = offset;
+	header.parts.count = (uint32_t)parts.size();
+	offset += header.parts.count * sizeof(SCENE_PART_RECORD);
+	header.animations.offset = offset;
+	header.animations.count = (uint32_t)animations.size();
+	offset += header.animations.count * sizeof(SCENE_ANIMATION_RECORD);
+	header.models.offset = offset;
+	header.models.count = (uint32_t)models.size();
+	offset += header.models.count * sizeof(SCENE_MODEL_RECORD);
+	header.strings.offset = offset;
+	header.strings.count = (uint32_t)strings.data.size();
+	header.fileSize = offset + header.strings.count;
+
+	FILE* pFile = fopen(binaryFilename.c_str(), "wb");
+	if (NULL == pFile)
+	{
+		std::cout << "Could not write scene file:" << binaryFilename << std::endl;
+		return(false);
+	}
+	fwrite(&header, sizeof(header), 1, pFile);
+	fwrite(textures.data(), sizeof(SCENE_TEXTURE_RECORD), textures.size(), pFile);
+	fwrite(materials.data(), sizeof(SCENE_MATERIAL_RECORD), materials.size(), pFile);
+	fwrite(lights.data(), sizeof(SCENE_LIGHT_RECORD), lights.size(), pFile);
+	fwrite(parts.data(), sizeof(SCENE_PART_RECORD), parts.size(), pFile);
+	fwrite(animations.data(), sizeof(SCENE_ANIMATION_RECORD), animations.size(), pFile);
+	fwrite(models.data(), sizeof(SCENE_MODEL_RECORD), models.size(), pFile);
+	fwrite(strings.data.data(), 1, strings.data.size(), pFile);
+	bool bWritten = (ferror(pFile) == 0);
+	fclose(pFile);
+
+	std::cout << "Compiled scene file:" << textFilename << " -> " << binaryFilename << std::endl;
+	return(bWritten);
+}
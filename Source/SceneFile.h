@@ -0,0 +1,191 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenefile.h
+// ============
+// compile and load the scene description files
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MappedFile.h"
+
+#include <cstdint>
+#include <string>
+
+// the records below are stored in the binary scene file
+// exactly as they are laid out in memory, so they only hold
+// 4 byte fields and no pointers.  Strings are offsets into
+// the null-terminated string table at the end of the file.
+#define SCENE_FILE_MAGIC 0x4E435344u   // "DSCN"
+#define SCENE_FILE_VERSION 3u
+// seconds after which every part animation repeats.  The
+// compiler rounds the rates to whole turns over this period,
+// so the animation clock can wrap without a visible jump.
+#define SCENE_ANIMATION_PERIOD 600.0
+
+enum SCENE_PART_FLAGS
+{
+	SCENE_PART_DYNAMIC = 1,
+	SCENE_PART_UNLIT = 2
+};
+
+enum SCENE_LIGHT_FLAGS
+{
+	SCENE_LIGHT_SHADOWS = 1
+};
+
+struct SCENE_SECTION
+{
+	uint32_t offset;
+	uint32_t count;
+};
+
+struct SCENE_FILE_HEADER
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t fileSize;
+	SCENE_SECTION textures;
+	SCENE_SECTION materials;
+	SCENE_SECTION lights;
+	SCENE_SECTION parts;
+	SCENE_SECTION animations;
+	SCENE_SECTION models;
+	// byte size of the string table
+	SCENE_SECTION strings;
+};
+
+struct SCENE_TEXTURE_RECORD
+{
+	uint32_t tag;
+	uint32_t path;
+};
+
+// a model file, imported through its cooked mesh file
+struct SCENE_MODEL_RECORD
+{
+	uint32_t tag;
+	uint32_t path;
+};
+
+struct SCENE_MATERIAL_RECORD
+{
+	uint32_t tag;
+	float ambientStrength;
+	float ambientColor[3];
+	float diffuseColor[3];
+	float specularColor[3];
+	float shininess;
+};
+
+struct SCENE_LIGHT_RECORD
+{
+	float position[3];
+	float ambientColor[3];
+	float diffuseColor[3];
+	float specularColor[3];
+	float focalStrength;
+	float specularIntensity;
+	uint32_t flags;
+};
+
+struct SCENE_PART_RECORD
+{
+	// name of the object the part belongs to
+	uint32_t group;
+	// one of the MESH_TYPE values, MESH_MODEL_FIRST + n for
+	// the model record n
+	uint32_t mesh;
+	uint32_t flags;
+	// index into the texture and material records, -1 for none
+	int32_t texture;
+	int32_t material;
+	float color[4];
+	float uvScale[2];
+	// model matrix, column major like glm
+	float model[16];
+	// index into the animation records, -1 for none
+	int32_t animation;
+};
+
+// laid out like the std140 PartAnimation struct of the vertex
+// shaders, so the records are uploaded as they are
+struct SCENE_ANIMATION_RECORD
+{
+	// unit spin axis in the part frame and radians per second
+	float spinAxis[3];
+	float spinRate;
+	// peak offset of the bobbing in the part frame and radians
+	// per second
+	float bobOffset[3];
+	float bobRate;
+	// scale of the part, the animation turns the scaled part
+	// so it stays rigid, and the start angle of both motions
+	float scale[3];
+	float phase;
+};
+
+static_assert(sizeof(SCENE_FILE_HEADER) == 68, "scene header must be packed");
+static_assert(sizeof(SCENE_PART_RECORD) == 112, "scene part record must be packed");
+static_assert(sizeof(SCENE_ANIMATION_RECORD) == 48, "scene animation record must match std140");
+
+/***********************************************************
+ *  SceneFile
+ *
+ *  This class loads a compiled scene file by mapping it into
+ *  memory.  The records are used in place, so loading a
+ *  scene only checks that the sections fit in the file.
+ *  The human-editable text form is compiled into the binary
+ *  form with Compile(), and Load() does this automatically
+ *  when the binary file is missing or older than the text.
+ ***********************************************************/
+class SceneFile
+{
+public:
+	// constructor
+	SceneFile();
+	// destructor
+	~SceneFile();
+
+	// load a text scene through its compiled binary file, or
+	// a binary scene file directly
+	bool Load(const std::string& filename);
+	// compile a text scene file into a binary scene file
+	static bool Compile(const std::string& textFilename, const std::string& binaryFilename);
+	// name of the binary file compiled from a text scene file
+	static std::string GetBinaryFilename(const std::string& textFilename);
+	// name of one of the two binary files a text scene file is
+	// compiled into while its binary file is mapped
+	static std::string GetReloadFilename(const std::string& textFilename, int slot);
+	// true for the name of a text scene file
+	static bool IsTextFilename(const std::string& filename);
+
+	// access to the mapped records
+	uint32_t GetTextureCount() const { return m_pHeader->textures.count; }
+	uint32_t GetMaterialCount() const { return m_pHeader->materials.count; }
+	uint32_t GetLightCount() const { return m_pHeader->lights.count; }
+	uint32_t GetPartCount() const { return m_pHeader->parts.count; }
+	uint32_t GetAnimationCount() const { return m_pHeader->animations.count; }
+	uint32_t GetModelCount() const { return m_pHeader->models.count; }
+	const SCENE_TEXTURE_RECORD* GetTextures() const { return m_pTextures; }
+	const SCENE_MATERIAL_RECORD* GetMaterials() const { return m_pMaterials; }
+	const SCENE_LIGHT_RECORD* GetLights() const { return m_pLights; }
+	const SCENE_PART_RECORD* GetParts() const { return m_pParts; }
+	const SCENE_ANIMATION_RECORD* GetAnimations() const { return m_pAnimations; }
+	const SCENE_MODEL_RECORD* GetModels() const { return m_pModels; }
+	// string stored at an offset of the string table
+	const char* GetString(uint32_t offset) const { return m_pStrings + offset; }
+
+private:
+	MappedFile m_file;
+	const SCENE_FILE_HEADER* m_pHeader;
+	const SCENE_TEXTURE_RECORD* m_pTextures;
+	const SCENE_MATERIAL_RECORD* m_pMaterials;
+	const SCENE_LIGHT_RECORD* m_pLights;
+	const SCENE_PART_RECORD* m_pParts;
+	const SCENE_ANIMATION_RECORD* m_pAnimations;
+	const SCENE_MODEL_RECORD* m_pModels;
+	const char* m_pStrings;
+
+	// check the mapped file and set the record pointers
+	bool Validate();
+};
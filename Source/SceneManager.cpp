@@ -9,6 +9,7 @@
 // Student: Gonzalo Patino
 
 #include "SceneManager.h"
+#include "ResourceTracker.h"
 
 #ifndef STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_IMPLEMENTATION
@@ -16,15 +17,41 @@
 #endif
 
 #include <glm/gtx/transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 
 // declaration of global variables
 namespace
 {
-	const char* g_ModelName = "model";
-	const char* g_ColorValueName = "objectColor";
-	const char* g_TextureValueName = "objectTexture";
-	const char* g_UseTextureName = "bUseTexture";
-	const char* g_UseLightingName = "bUseLighting";
+	// uniform names, as handles so the draws build no strings
+	const int g_ModelName = GLTrace::RegisterName("model");
+	const int g_ColorValueName = GLTrace::RegisterName("objectColor");
+	const int g_TextureValueName = GLTrace::RegisterName("objectTexture");
+	const int g_UseTextureName = GLTrace::RegisterName("bUseTexture");
+	const int g_UseLightingName = GLTrace::RegisterName("bUseLighting");
+	const int g_UseLightmapName = GLTrace::RegisterName("bUseLightmap");
+	const int g_UVScaleName = GLTrace::RegisterName("UVscale");
+	const int g_ViewName = GLTrace::RegisterName("view");
+	const int g_ProjectionName = GLTrace::RegisterName("projection");
+	const int g_AnimationIndexName = GLTrace::RegisterName("animationIndex");
+	const int g_ViewPositionName = GLTrace::RegisterName("viewPosition");
+	const int g_MaterialAmbientColorName = GLTrace::RegisterName("material.ambientColor");
+	const int g_MaterialAmbientStrengthName = GLTrace::RegisterName("material.ambientStrength");
+	const int g_MaterialDiffuseColorName = GLTrace::RegisterName("material.diffuseColor");
+	const int g_MaterialSpecularColorName = GLTrace::RegisterName("material.specularColor");
+	const int g_MaterialShininessName = GLTrace::RegisterName("material.shininess");
+
+	// number of light sources in the fragment shader
+	const uint32_t g_TotalLights = 4;
+	// scene loaded when no other scene file is set
+	const char* g_DefaultSceneFile = "Scenes/drone.scene";
+	// scene part group placed by the telemetry playback
+	const char* g_TelemetryGroupName = "drone";
+	// scene part group the terrain takes the place of
+	const char* g_FloorGroupName = "floor";
 }
 
 /***********************************************************
@@ -36,6 +63,59 @@ SceneManager::SceneManager(ShaderManager* pShaderManager)
 {
 	m_pShaderManager = pShaderManager;
 	m_basicMeshes = new ShapeMeshes();
+	m_pModelMeshes = new ModelMeshes();
+	m_pStaticBatches = NULL;
+	m_bStaticBatching = true;
+	m_pLightmapAtlas = NULL;
+	m_pReloadedLightmapAtlas = NULL;
+	m_bLightmaps = true;
+	m_loadedTextures = 0;
+	m_pDepthShaderManager = NULL;
+	m_bDepthPrepass = true;
+	m_viewMatrix = glm::mat4(1.0f);
+	m_projectionMatrix = glm::mat4(1.0f);
+	m_pShadowManager = NULL;
+	m_pFrameStats = NULL;
+	m_shadowSectionID = -1;
+	m_pTextureStreamer = new TextureStreamer();
+	m_sceneFilename = g_DefaultSceneFile;
+	m_pSceneFile = new SceneFile();
+	m_pHotReload = NULL;
+	m_pReloadedSceneFile = NULL;
+	m_sceneReloadCount = 0;
+	m_pTelemetryPlayback = NULL;
+	m_pTelemetryIngest = NULL;
+	m_pSwarmSimulation = NULL;
+	m_pAnimationManager = NULL;
+	m_pMultiviewPass = NULL;
+	m_bMultiviewEnabled = true;
+	m_bShadowsEnabled = true;
+	m_bVerifyShadows = false;
+	m_renderBackend = RENDER_BACKEND_OPENGL;
+	m_pSoftwareRasterizer = NULL;
+	m_rasterThreadCount = 0;
+	m_verifyTolerance = -1.0f;
+	m_bVerificationFailed = false;
+	m_pTerrainClipmap = NULL;
+	m_terrainSectionID = -1;
+	m_pTrailRenderer = NULL;
+	m_trailSampleCount = 0;
+	m_trailSectionID = -1;
+	m_animationSeconds = 0.0;
+
+	// default draw state, matching the shader uniform defaults
+	m_pendingCommand.mesh = MESH_BOX;
+	m_pendingCommand.model = glm::mat4(1.0f);
+	m_pendingCommand.color = glm::vec4(1.0f);
+	m_pendingCommand.uvScale = glm::vec2(1.0f, 1.0f);
+	m_pendingCommand.textureID = -1;
+	m_pendingCommand.materialIndex = -1;
+	m_pendingCommand.bUseLighting = true;
+	m_pendingCommand.bUseLightmap = false;
+	m_pendingCommand.bDynamic = false;
+	m_pendingCommand.animationIndex = -1;
+	m_pendingCommand.animationReach = 0.0f;
+	m_terrainCommand = m_pendingCommand;
 }
 
 /***********************************************************
@@ -45,93 +125,122 @@ SceneManager::SceneManager(ShaderManager* pShaderManager)
  ***********************************************************/
 SceneManager::~SceneManager()
 {
+	// the watcher thread may be loading a scene file
+	if (NULL != m_pHotReload)
+	{
+		delete m_pHotReload;
+		m_pHotReload = NULL;
+	}
 	m_pShaderManager = NULL;
 	delete m_basicMeshes;
 	m_basicMeshes = NULL;
+	if (NULL != m_pStaticBatches)
+	{
+		delete m_pStaticBatches;
+		m_pStaticBatches = NULL;
+	}
+	delete m_pModelMeshes;
+	m_pModelMeshes = NULL;
+	if (NULL != m_pDepthShaderManager)
+	{
+		ResourceTracker::Release(RESOURCE_PROGRAM, m_pDepthShaderManager->m_programID);
+		delete m_pDepthShaderManager;
+		m_pDepthShaderManager = NULL;
+	}
+	if (NULL != m_pShadowManager)
+	{
+		delete m_pShadowManager;
+		m_pShadowManager = NULL;
+	}
+	m_pFrameStats = NULL;
+	if (NULL != m_pTextureStreamer)
+	{
+		delete m_pTextureStreamer;
+		m_pTextureStreamer = NULL;
+	}
+	if (NULL != m_pAnimationManager)
+	{
+		delete m_pAnimationManager;
+		m_pAnimationManager = NULL;
+	}
+	if (NULL != m_pMultiviewPass)
+	{
+		delete m_pMultiviewPass;
+		m_pMultiviewPass = NULL;
+	}
+	if (NULL != m_pSoftwareRasterizer)
+	{
+		delete m_pSoftwareRasterizer;
+		m_pSoftwareRasterizer = NULL;
+	}
+	if (NULL != m_pTerrainClipmap)
+	{
+		delete m_pTerrainClipmap;
+		m_pTerrainClipmap = NULL;
+	}
+	if (NULL != m_pTrailRenderer)
+	{
+		delete m_pTrailRenderer;
+		m_pTrailRenderer = NULL;
+	}
+	if (NULL != m_pReloadedSceneFile)
+	{
+		delete m_pReloadedSceneFile;
+		m_pReloadedSceneFile = NULL;
+	}
+	if (NULL != m_pLightmapAtlas)
+	{
+		delete m_pLightmapAtlas;
+		m_pLightmapAtlas = NULL;
+	}
+	if (NULL != m_pReloadedLightmapAtlas)
+	{
+		delete m_pReloadedLightmapAtlas;
+		m_pReloadedLightmapAtlas = NULL;
+	}
+	delete m_pSceneFile;
+	m_pSceneFile = NULL;
 }
 
 /***********************************************************
  *  CreateGLTexture()
  *
- *  This method is used for loading textures from image files,
- *  configuring the texture mapping parameters in OpenGL,
- *  generating the mipmaps, and loading the read texture into
- *  the next available texture slot in memory.
+ *  This method is used for loading textures from image files
+ *  through the texture streamer, which decodes the image in
+ *  the background and keeps only the mip levels the scene
+ *  needs in GPU memory, and registering the texture ID in
+ *  the next available texture slot.
  ***********************************************************/
-bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
+bool SceneManager::CreateGLTexture(const char* filename, const char* tag)
 {
-	int width = 0;
-	int height = 0;
-	int colorChannels = 0;
-	GLuint textureID = 0;
-
-	// indicate to always flip images vertically when loaded
-	stbi_set_flip_vertically_on_load(true);
+	if (m_loadedTextures >= 16)
+	{
+		std::cout << "Could not load image:" << filename << ", all texture slots are used" << std::endl;
+		return false;
+	}
 
-	// try to parse the image data from the specified image file
-	unsigned char* image = stbi_load(
-		filename,
-		&width,
-		&height,
-		&colorChannels,
-		0);
+	// the texture ID stays the same while mip levels stream in and out
+	GLuint textureID = m_pTextureStreamer->LoadTexture(filename, tag);
 
-	// if the image was successfully read from the image file
-	if (image)
+	// if the image header was successfully read from the image file
+	if (textureID != 0)
 	{
-		std::cout << "Successfully loaded image:" << filename << ", width:" << width << ", height:" << height << ", channels:" << colorChannels << std::endl;
-
-		glGenTextures(1, &textureID);
 		std::cout << "Generated Texture ID: " << textureID << " for file: " << filename << std::endl;
 
-		glBindTexture(GL_TEXTURE_2D, textureID);
-
-		// set the texture wrapping parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		// set texture filtering parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		// if the loaded image is in RGB format
-		if (colorChannels == 3)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-		// if the loaded image is in RGBA format - it supports transparency
-		else if (colorChannels == 4)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-		else
-		{
-			std::cout << "Not implemented to handle image with " << colorChannels << " channels" << std::endl;
-			return false;
-		}
-
-		// generate the texture mipmaps for mapping textures to lower resolutions
-		glGenerateMipmap(GL_TEXTURE_2D);
-
-		// free the image data from local memory
-		stbi_image_free(image);
-		glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
-
 		// register the loaded texture and associate it with the special tag string
 		m_textureIDs[m_loadedTextures].ID = textureID;
 		m_textureIDs[m_loadedTextures].tag = tag;
 		m_loadedTextures++;
 
-
-		if (!glIsTexture(textureID)) {
-			std::cout << "ERROR: Texture ID " << textureID << " is not valid!" << std::endl;
-		}
-		else {
-			std::cout << "✅ Texture successfully validated and stored with tag: " << tag << std::endl;
+		// the CPU rasterizer keeps its own copy of the image
+		if (NULL != m_pSoftwareRasterizer)
+		{
+			m_pSoftwareRasterizer->LoadTexture((int)textureID, filename);
 		}
 
-
-
 		return true;
 	}
 
-	std::cout << "Could not load image:" << filename << std::endl;
-
 	// Error loading the image
 	return false;
 }
@@ -164,11 +273,9 @@ void SceneManager::DestroyGLTextures()
 	{
 		glGenTextures(1, &m_textureIDs[i].ID);
 	}*/
-	for (int i = 0; i < m_loadedTextures; i++)
-	{
-		glDeleteTextures(1, &m_textureIDs[i].ID);
-	}
-
+	// the streamer owns the OpenGL textures
+	m_pTextureStreamer->DestroyAll();
+	m_loadedTextures = 0;
 }
 
 /***********************************************************
@@ -177,7 +284,7 @@ void SceneManager::DestroyGLTextures()
  *  This method is used for getting an ID for the previously
  *  loaded texture bitmap associated with the passed in tag.
  ***********************************************************/
-int SceneManager::FindTextureID(std::string tag)
+int SceneManager::FindTextureID(const char* tag) const
 {
 	int textureID = -1;
 	int index = 0;
@@ -203,7 +310,7 @@ int SceneManager::FindTextureID(std::string tag)
  *  This method is used for getting a slot index for the previously
  *  loaded texture bitmap associated with the passed in tag.
  ***********************************************************/
-int SceneManager::FindTextureSlot(std::string tag)
+int SceneManager::FindTextureSlot(const char* tag) const
 {
 	int textureSlot = -1;
 	int index = 0;
@@ -229,7 +336,7 @@ int SceneManager::FindTextureSlot(std::string tag)
  *  This method is used for getting a material from the previously
  *  defined materials list that is associated with the passed in tag.
  ***********************************************************/
-bool SceneManager::FindMaterial(std::string tag, OBJECT_MATERIAL& material)
+bool SceneManager::FindMaterial(const char* tag, OBJECT_MATERIAL& material) const
 {
 	if (m_objectMaterials.size() == 0)
 	{
@@ -258,11 +365,31 @@ bool SceneManager::FindMaterial(std::string tag, OBJECT_MATERIAL& material)
 	return(true);
 }
 
+/***********************************************************
+ *  FindMaterialIndex()
+ *
+ *  This method is used for getting the index of a previously
+ *  defined material that is associated with the passed in tag.
+ ***********************************************************/
+int SceneManager::FindMaterialIndex(const char* tag) const
+{
+	for (int index = 0; index < (int)m_objectMaterials.size(); index++)
+	{
+		if (m_objectMaterials[index].tag.compare(tag) == 0)
+		{
+			return(index);
+		}
+	}
+
+	return(-1);
+}
+
 /***********************************************************
  *  SetTransformations()
  *
  *  This method is used for setting the transform buffer
- *  using the passed in transformation values.
+ *  using the passed in transformation values.  The result
+ *  is stored in the draw state for the next DrawMesh().
  ***********************************************************/
 void SceneManager::SetTransformations(
 	glm::vec3 scaleXYZ,
@@ -290,10 +417,7 @@ void SceneManager::SetTransformations(
 
 	modelView = translation * rotationX * rotationY * rotationZ * scale;
 
-	if (NULL != m_pShaderManager)
-	{
-		m_pShaderManager->setMat4Value(g_ModelName, modelView);
-	}
+	m_pendingCommand.model = modelView;
 }
 
 /***********************************************************
@@ -316,11 +440,8 @@ void SceneManager::SetShaderColor(
 	currentColor.b = blueColorValue;
 	currentColor.a = alphaValue;
 
-	if (NULL != m_pShaderManager)
-	{
-		m_pShaderManager->setIntValue(g_UseTextureName, false);
-		m_pShaderManager->setVec4Value(g_ColorValueName, currentColor);
-	}
+	m_pendingCommand.textureID = -1;
+	m_pendingCommand.color = currentColor;
 }
 
 /***********************************************************
@@ -330,16 +451,20 @@ void SceneManager::SetShaderColor(
  *  associated with the passed in ID into the shader.
  ***********************************************************/
 void SceneManager::SetShaderTexture(
-	std::string textureTag)
+	const char* textureTag)
 {
-	if (NULL != m_pShaderManager)
-	{
-		m_pShaderManager->setIntValue(g_UseTextureName, true);
+	m_pendingCommand.textureID = FindTextureID(textureTag);
+}
 
-		int textureID = -1;
-		textureID = FindTextureSlot(textureTag);
-		m_pShaderManager->setSampler2DValue(g_TextureValueName, textureID);
-	}
+/***********************************************************
+ *  SetShaderTextureID()
+ *
+ *  This method is used for setting a texture found earlier
+ *  into the shader, without searching the tags.
+ ***********************************************************/
+void SceneManager::SetShaderTextureID(int textureID)
+{
+	m_pendingCommand.textureID = textureID;
 }
 
 /***********************************************************
@@ -350,10 +475,7 @@ void SceneManager::SetShaderTexture(
  ***********************************************************/
 void SceneManager::SetTextureUVScale(float u, float v)
 {
-	if (NULL != m_pShaderManager)
-	{
-		m_pShaderManager->setVec2Value("UVscale", glm::vec2(u, v));
-	}
+	m_pendingCommand.uvScale = glm::vec2(u, v);
 }
 
 /***********************************************************
@@ -363,297 +485,1823 @@ void SceneManager::SetTextureUVScale(float u, float v)
  *  into the shader.
  ***********************************************************/
 void SceneManager::SetShaderMaterial(
-	std::string materialTag)
+	const char* materialTag)
 {
-	if (m_objectMaterials.size() > 0)
+	m_pendingCommand.materialIndex = FindMaterialIndex(materialTag);
+}
+
+/***********************************************************
+ *  SetShaderMaterialIndex()
+ *
+ *  This method is used for setting a material found earlier
+ *  into the shader, without searching the tags.
+ ***********************************************************/
+void SceneManager::SetShaderMaterialIndex(int materialIndex)
+{
+	if ((materialIndex < 0) || (materialIndex >= (int)m_objectMaterials.size()))
 	{
-		OBJECT_MATERIAL material;
-		bool bReturn = false;
+		materialIndex = -1;
+	}
+	m_pendingCommand.materialIndex = materialIndex;
+}
 
-		bReturn = FindMaterial(materialTag, material);
-		if (bReturn == true)
-		{
-			// Send the material
-			m_pShaderManager->setVec3Value("material.ambientColor", material.ambientColor);
-			m_pShaderManager->setFloatValue("material.ambientStrength", material.ambientStrength);
-			m_pShaderManager->setVec3Value("material.diffuseColor", material.diffuseColor);
-			m_pShaderManager->setVec3Value("material.specularColor", material.specularColor);
-			m_pShaderManager->setFloatValue("material.shininess", material.shininess);
+/***********************************************************
+ *  SetDynamicObject()
+ *
+ *  This method is used for marking the following meshes as
+ *  moving objects.  Only moving objects cause the cached
+ *  shadow maps to be partly redrawn.
+ ***********************************************************/
+void SceneManager::SetDynamicObject(bool bDynamic)
+{
+	m_pendingCommand.bDynamic = bDynamic;
+}
 
-		}
+/***********************************************************
+ *  SetLightSource()
+ *
+ *  This method is used for defining a light source and
+ *  passing its values into the shader.
+ ***********************************************************/
+void SceneManager::SetLightSource(int index, const LIGHT_SOURCE& light)
+{
+	if (index >= (int)m_lightSources.size())
+	{
+		m_lightSources.resize(index + 1);
+	}
+	m_lightSources[index] = light;
+
+	ApplyLightSource(m_pShaderManager, index, light);
+
+	if (NULL != m_pSoftwareRasterizer)
+	{
+		SoftwareRasterizer::RASTER_LIGHT rasterLight;
+		rasterLight.position = light.position;
+		rasterLight.ambientColor = light.ambientColor;
+		rasterLight.diffuseColor = light.diffuseColor;
+		rasterLight.specularColor = light.specularColor;
+		rasterLight.focalStrength = light.focalStrength;
+		rasterLight.specularIntensity = light.specularIntensity;
+		m_pSoftwareRasterizer->SetLight(index, rasterLight);
 	}
 }
 
-/**************************************************************/
-/*** STUDENTS CAN MODIFY the code in the methods BELOW for  ***/
-/*** preparing and rendering their own 3D replicated scenes.***/
-/*** Please refer to the code in the OpenGL sample project  ***/
-/*** for assistance.                                        ***/
-/**************************************************************/
+/***********************************************************
+ *  ApplyLightSource()
+ *
+ *  This method is used for passing the values of a light
+ *  source into a shader, which must be bound.
+ ***********************************************************/
+void SceneManager::ApplyLightSource(ShaderManager* pShader, int index, const LIGHT_SOURCE& light)
+{
+	std::string prefix = "lightSources[" + std::to_string(index) + "].";
+	GLTrace::SetVec3(pShader, (prefix + "position").c_str(), light.position);
+	GLTrace::SetVec3(pShader, (prefix + "ambientColor").c_str(), light.ambientColor);
+	GLTrace::SetVec3(pShader, (prefix + "diffuseColor").c_str(), light.diffuseColor);
+	GLTrace::SetVec3(pShader, (prefix + "specularColor").c_str(), light.specularColor);
+	GLTrace::SetFloat(pShader, (prefix + "focalStrength").c_str(), light.focalStrength);
+	GLTrace::SetFloat(pShader, (prefix + "specularIntensity").c_str(), light.specularIntensity);
+}
 
+/***********************************************************
+ *  ApplyShadowSamplers()
+ *
+ *  This method is used for pointing the shadow map samplers
+ *  of a shader, which must be bound, and its lightmap
+ *  sampler at their texture units.  They need their own
+ *  units even when shadows and lightmaps are off, so they
+ *  never alias objectTexture.
+ ***********************************************************/
+void SceneManager::ApplyShadowSamplers(ShaderManager* pShader)
+{
+	GLTrace::SetSampler(pShader, "keyLightShadowMap", ShadowManager::KEY_SHADOW_TEXTURE_UNIT);
+	for (int i = 0; i < ShadowManager::MAX_POINT_SHADOWS; i++)
+	{
+		GLTrace::SetSampler(pShader,
+			("pointShadowMaps[" + std::to_string(i) + "]").c_str(),
+			ShadowManager::POINT_SHADOW_TEXTURE_UNIT + i);
+	}
+	GLTrace::SetSampler(pShader, "lightmap", LightmapAtlas::TEXTURE_UNIT);
+}
 
 /***********************************************************
- *  PrepareScene()
+ *  ApplyLightingState()
  *
- *  This method is used for preparing the 3D scene by loading
- *  the shapes, textures in memory to support the 3D scene
- *  rendering
+ *  This method is used for passing the values a lighting
+ *  shader, which must be bound, only gets once: the lights,
+ *  the shadow samplers and the view position.
  ***********************************************************/
-void SceneManager::PrepareScene()
+void SceneManager::ApplyLightingState(ShaderManager* pShader)
 {
-	// only one instance of a particular mesh needs to be
-	// loaded in memory no matter how many times it is drawn
-	// in the rendered 3D scene
+	for (int i = 0; i < (int)m_lightSources.size(); i++)
+	{
+		ApplyLightSource(pShader, i, m_lightSources[i]);
+	}
+	ApplyShadowSamplers(pShader);
+	// one view position for all the views, like the main shader
+	GLTrace::SetVec3(pShader, g_ViewPositionName, glm::vec3(0.0f, 6.0f, 5.0f));
+}
 
-	m_basicMeshes->LoadPlaneMesh();
-	m_basicMeshes->LoadBoxMesh(); //  Required for drone body
-	m_basicMeshes->LoadCylinderMesh(); // required for camera lens
+/***********************************************************
+ *  PrepareShadows()
+ *
+ *  This method is used for creating the shadow maps of the
+ *  defined lights.  Light source 0 is the key light and
+ *  gets the cascades, the others get a cube map each.  The
+ *  CPU rasterizer draws no shadows, so there are none when
+ *  it draws the scene.
+ ***********************************************************/
+void SceneManager::PrepareShadows()
+{
+	ApplyShadowSamplers(m_pShaderManager);
+
+	if ((false == m_bShadowsEnabled) || (RENDER_BACKEND_SOFTWARE == m_renderBackend))
+	{
+		return;
+	}
 
-	//Drone Texture #1
-	if (!CreateGLTexture("Resources/stainless_end.jpg", "droneTextureBlack"))
+	m_pShadowManager = new ShadowManager();
+	if (!m_pShadowManager->Initialize())
 	{
-		std::cerr << " Failed to load drone texture!" << std::endl;
+		delete m_pShadowManager;
+		m_pShadowManager = NULL;
+		GLTrace::UseProgram(m_pShaderManager);
+		return;
+	}
+	m_pShadowManager->SetVerifyCache(m_bVerifyShadows);
+
+	for (int i = 0; i < (int)m_lightSources.size(); i++)
+	{
+		if (!m_lightSources[i].bCastShadows)
+		{
+			continue;
+		}
+		if (i == 0)
+		{
+			// the key light is treated as a directional light
+			// shining from its position toward the origin
+			m_pShadowManager->SetKeyLightDirection(-m_lightSources[i].position);
+		}
+		else if (m_pShadowManager->AddPointLight(i, m_lightSources[i].position) < 0)
+		{
+			std::cout << "No shadow map left for light source " << i << std::endl;
+		}
 	}
-	//Drone Texture #2
-	if (!CreateGLTexture("Resources/tilesf2.jpg", "droneTextureTiles"))
+
+	// loading the shadow shaders changed the bound program
+	GLTrace::UseProgram(m_pShaderManager);
+}
+
+/***********************************************************
+ *  PrepareMultiview()
+ *
+ *  This method is used for loading the shaders that draw
+ *  several views in one pass and passing the lights and the
+ *  shadow samplers into them.  Without them the views are
+ *  drawn one at a time.
+ ***********************************************************/
+void SceneManager::PrepareMultiview()
+{
+	m_pMultiviewPass = new MultiviewPass();
+	if (!m_pMultiviewPass->Initialize())
 	{
-		std::cerr << " Failed to load drone texture!" << std::endl;
+		delete m_pMultiviewPass;
+		m_pMultiviewPass = NULL;
+		GLTrace::UseProgram(m_pShaderManager);
+		return;
 	}
-	//Drone Texture #3
-	if (!CreateGLTexture("Resources/backdrop.jpg", "droneTextureBackDrops"))
+
+	GLTrace::UseProgram(m_pMultiviewPass->GetShader());
+	ApplyLightingState(m_pMultiviewPass->GetShader());
+
+	GLTrace::UseProgram(m_pShaderManager);
+}
+
+/***********************************************************
+ *  PrepareSoftwareRasterizer()
+ *
+ *  This method is used for starting the CPU rasterizer when
+ *  it draws the scene or checks the OpenGL frames.  It must
+ *  exist before the scene file is loaded, so it gets the
+ *  textures and lights as they are created.  On a CPU
+ *  without AVX2 it falls back to its scalar edge functions,
+ *  which draw the same pixels more slowly.
+ ***********************************************************/
+void SceneManager::PrepareSoftwareRasterizer()
+{
+	if ((RENDER_BACKEND_SOFTWARE != m_renderBackend) && (m_verifyTolerance < 0.0f))
 	{
-		std::cerr << " Failed to load drone texture!" << std::endl;
+		return;
 	}
-	//Drone Texture #4
-	if (!CreateGLTexture("Resources/pavers.jpg", "droneTextureStainlessEnd"))
+
+	m_pSoftwareRasterizer = new SoftwareRasterizer();
+	if (!m_pSoftwareRasterizer->Initialize(m_rasterThreadCount))
 	{
-		std::cerr << " Failed to load drone texture!" << std::endl;
+		delete m_pSoftwareRasterizer;
+		m_pSoftwareRasterizer = NULL;
+		m_renderBackend = RENDER_BACKEND_OPENGL;
+		m_verifyTolerance = -1.0f;
+		std::cout << "The scene is drawn with OpenGL" << std::endl;
+		return;
 	}
+	// the same view position as the shaders get
+	m_pSoftwareRasterizer->SetViewPosition(glm::vec3(0.0f, 6.0f, 5.0f));
+}
 
-	// Floor Texture
-	if (!CreateGLTexture("Resources/rusticwood.jpg", "floorTexture"))
+/***********************************************************
+ *  PrepareTerrain()
+ *
+ *  This method is used for opening the terrain file, when
+ *  one is set, and passing the lights and shadow samplers
+ *  into the terrain shader.  The CPU rasterizer has no
+ *  terrain, so the floor is kept when it draws or checks
+ *  the frames.
+ ***********************************************************/
+void SceneManager::PrepareTerrain()
+{
+	if (m_terrainFilename.empty())
+	{
+		return;
+	}
+	if (NULL != m_pSoftwareRasterizer)
 	{
-		std::cerr << "Failed to load floor texture!" << std::endl;
+		std::cout << "The CPU rasterizer draws no terrain, the floor is drawn instead" << std::endl;
+		return;
 	}
 
-	// Camera Lens
-	if (!CreateGLTexture("Resources/abstract.jpg", "cameraLens"))
+	m_pTerrainClipmap = new TerrainClipmap();
+	if (!m_pTerrainClipmap->Initialize(m_terrainFilename))
 	{
-		std::cerr << "Failed to load floor texture!" << std::endl;
+		delete m_pTerrainClipmap;
+		m_pTerrainClipmap = NULL;
+		GLTrace::UseProgram(m_pShaderManager);
+		return;
 	}
 
+	GLTrace::UseProgram(m_pTerrainClipmap->GetShader());
+	ApplyLightingState(m_pTerrainClipmap->GetShader());
 
+	GLTrace::UseProgram(m_pShaderManager);
+}
+
+/***********************************************************
+ *  PrepareTrails()
+ *
+ *  This method is used for creating the trail renderer when
+ *  a trail length is set.  The CPU rasterizer draws no
+ *  trails, so none are drawn when it draws or checks the
+ *  frames.
+ ***********************************************************/
+void SceneManager::PrepareTrails()
+{
+	if (m_trailSampleCount <= 0)
+	{
+		return;
+	}
+	if (NULL != m_pSoftwareRasterizer)
+	{
+		std::cout << "The CPU rasterizer draws no trails" << std::endl;
+		return;
+	}
 
-	OBJECT_MATERIAL droneMaterial;
-	droneMaterial.tag = "default";
+	m_pTrailRenderer = new TrailRenderer();
+	if (!m_pTrailRenderer->Initialize(m_trailSampleCount))
+	{
+		delete m_pTrailRenderer;
+		m_pTrailRenderer = NULL;
+	}
+	GLTrace::UseProgram(m_pShaderManager);
+}
 
-	droneMaterial.ambientStrength = 0.2f;
-	droneMaterial.ambientColor = glm::vec3(0.2f, 0.2f, 0.2f);
-	droneMaterial.diffuseColor = glm::vec3(0.5f);
-	droneMaterial.specularColor = glm::vec3(0.7f);
-	droneMaterial.shininess = 32.0f;
+/***********************************************************
+ *  DrawMesh()
+ *
+ *  This method is used for submitting the passed in mesh
+ *  with the current draw state to the render queue.  The
+ *  actual draw happens later in the sorted render passes.
+ ***********************************************************/
+void SceneManager::DrawMesh(MESH_TYPE mesh)
+{
+	m_pendingCommand.mesh = mesh;
+	m_renderQueue.Submit(m_pendingCommand);
+}
 
-	m_objectMaterials.push_back(droneMaterial);
+/***********************************************************
+ *  DrawBasicMesh()
+ *
+ *  This method is used for drawing one of the loaded basic
+ *  shape meshes or models with the currently bound shader.
+ ***********************************************************/
+void SceneManager::DrawBasicMesh(MESH_TYPE mesh)
+{
+	if (mesh >= MESH_MODEL_FIRST)
+	{
+		m_pModelMeshes->DrawModel(mesh - MESH_MODEL_FIRST);
+		return;
+	}
+	GLTrace::DrawMesh(m_basicMeshes, mesh);
+}
 
-	// Light source 0 – key light (from above front-right)
-	m_pShaderManager->setVec3Value("lightSources[0].ambientColor", glm::vec3(0.2f));
-	m_pShaderManager->setVec3Value("lightSources[0].diffuseColor", glm::vec3(0.6f));
-	m_pShaderManager->setVec3Value("lightSources[0].specularColor", glm::vec3(0.8f));
-	m_pShaderManager->setFloatValue("lightSources[0].specularIntensity", 0.8f);
-	m_pShaderManager->setFloatValue("lightSources[0].focalStrength", 48.0f);
+/***********************************************************
+ *  ExecuteDrawCommand()
+ *
+ *  This method is used for passing the values of a draw
+ *  command into the bound shader and drawing its mesh.
+ ***********************************************************/
+void SceneManager::ExecuteDrawCommand(ShaderManager* pShader, const DRAW_COMMAND& command)
+{
+	GLTrace::SetMat4(pShader, g_ModelName, command.model);
+	GLTrace::SetInt(pShader, g_AnimationIndexName, command.animationIndex);
+	ApplyCommandState(pShader, command);
 
+	DrawBasicMesh(command.mesh);
+}
 
+/***********************************************************
+ *  ApplyCommandState()
+ *
+ *  This method is used for passing the texture or color, the
+ *  material and the lighting and lightmap switches of a draw
+ *  command into the bound shader.
+ ***********************************************************/
+void SceneManager::ApplyCommandState(ShaderManager* pShader, const DRAW_COMMAND& command)
+{
+	if (command.textureID >= 0)
+	{
+		GLTrace::SetInt(pShader, g_UseTextureName, true);
+		GLTrace::ActiveTexture(GL_TEXTURE0);
+		GLTrace::BindTexture(GL_TEXTURE_2D, command.textureID);
+		GLTrace::SetSampler(pShader, g_TextureValueName, 0);
+	}
+	else
+	{
+		GLTrace::SetInt(pShader, g_UseTextureName, false);
+		GLTrace::SetVec4(pShader, g_ColorValueName, command.color);
+	}
+	GLTrace::SetVec2(pShader, g_UVScaleName, command.uvScale);
 
+	if ((command.materialIndex >= 0) &&
+		(command.materialIndex < (int)m_objectMaterials.size()))
+	{
+		const OBJECT_MATERIAL& material = m_objectMaterials[command.materialIndex];
+
+		// Send the material
+		GLTrace::SetVec3(pShader, g_MaterialAmbientColorName, material.ambientColor);
+		GLTrace::SetFloat(pShader, g_MaterialAmbientStrengthName, material.ambientStrength);
+		GLTrace::SetVec3(pShader, g_MaterialDiffuseColorName, material.diffuseColor);
+		GLTrace::SetVec3(pShader, g_MaterialSpecularColorName, material.specularColor);
+		GLTrace::SetFloat(pShader, g_MaterialShininessName, material.shininess);
+	}
+	GLTrace::SetInt(pShader, g_UseLightingName, command.bUseLighting);
+	GLTrace::SetInt(pShader, g_UseLightmapName, command.bUseLightmap);
+}
 
+/***********************************************************
+ *  RequestTextureFootprints()
+ *
+ *  This method is used for telling the texture streamer how
+ *  much texture detail each textured command needs in a
+ *  view.  The UV distance per pixel is measured at the point
+ *  of the object bounds nearest the camera, the worst case
+ *  on screen.  The streamer keeps the finest request of all
+ *  the views.
+ ***********************************************************/
+void SceneManager::RequestTextureFootprints(const RENDER_VIEW& view, float viewportHeight)
+{
+	const std::vector<DRAW_COMMAND>& commands = m_renderQueue.GetCommands();
+	const std::vector<glm::vec3>& boundsMin = m_renderQueue.GetBoundsMin();
+	const std::vector<glm::vec3>& boundsMax = m_renderQueue.GetBoundsMax();
+	glm::vec3 cameraPosition = glm::vec3(glm::inverse(view.view)[3]);
+	bool bPerspective = (view.projection[3][3] == 0.0f);
 
-	// Light source 1 – soft fill light
-	m_pShaderManager->setVec3Value("lightSources[1].position", glm::vec3(-4.0f, 3.0f, -4.0f));
-	m_pShaderManager->setVec3Value("lightSources[1].ambientColor", glm::vec3(0.2f));
-	m_pShaderManager->setVec3Value("lightSources[1].diffuseColor", glm::vec3(0.3f));
-	m_pShaderManager->setVec3Value("lightSources[1].specularColor", glm::vec3(0.3f));
-	m_pShaderManager->setFloatValue("lightSources[1].focalStrength", 16.0f);
-	m_pShaderManager->setFloatValue("lightSources[1].specularIntensity", 0.5f);
+	// pixels covered by one world unit at a distance of one
+	float pixelScale = view.projection[1][1] * viewportHeight * 0.5f;
 
-	// Light source 2 – top fill light (softened)
-	m_pShaderManager->setVec3Value("lightSources[2].position", glm::vec3(0.0f, 10.0f, 0.0f));
-	m_pShaderManager->setVec3Value("lightSources[2].ambientColor", glm::vec3(0.1f));   // lower from 0.3
-	m_pShaderManager->setVec3Value("lightSources[2].diffuseColor", glm::vec3(0.25f));  // lower from 0.6
-	m_pShaderManager->setVec3Value("lightSources[2].specularColor", glm::vec3(0.3f));  // lower from 0.8
-	m_pShaderManager->setFloatValue("lightSources[2].focalStrength", 32.0f);           // standard sharpness
-	m_pShaderManager->setFloatValue("lightSources[2].specularIntensity", 0.5f);        // soften highlight
+	for (size_t i = 0; i < commands.size(); i++)
+	{
+		const DRAW_COMMAND& command = commands[i];
+		if (command.textureID < 0)
+		{
+			continue;
+		}
 
+		const glm::vec3& minXYZ = boundsMin[i];
+		const glm::vec3& maxXYZ = boundsMax[i];
 
-	// Light source 3 – subtle bounce from below
-	m_pShaderManager->setVec3Value("lightSources[3].position", glm::vec3(0.0f, -2.0f, 0.0f));
-	m_pShaderManager->setVec3Value("lightSources[3].ambientColor", glm::vec3(0.05f));
-	m_pShaderManager->setVec3Value("lightSources[3].diffuseColor", glm::vec3(0.1f));
-	m_pShaderManager->setVec3Value("lightSources[3].specularColor", glm::vec3(0.05f));
-	m_pShaderManager->setFloatValue("lightSources[3].focalStrength", 16.0f);
-	m_pShaderManager->setFloatValue("lightSources[3].specularIntensity", 0.1f);
+		float pixelsPerUnit = pixelScale;
+		if (bPerspective)
+		{
+			glm::vec3 nearest = glm::clamp(cameraPosition, minXYZ, maxXYZ);
+			pixelsPerUnit /= glm::max(glm::length(nearest - cameraPosition), 0.1f);
+		}
 
+		// the UV range is stretched over the two largest sides
+		glm::vec3 size = maxXYZ - minXYZ;
+		float largest = glm::max(size.x, glm::max(size.y, size.z));
+		float smallest = glm::min(size.x, glm::min(size.y, size.z));
+		float middle = size.x + size.y + size.z - largest - smallest;
+		float worldSize = glm::max(std::sqrt(largest * middle), 0.001f);
+		float uvPerUnit = glm::max(command.uvScale.x, command.uvScale.y) / worldSize;
 
+		m_pTextureStreamer->RequestFootprint((GLuint)command.textureID, uvPerUnit / pixelsPerUnit);
+	}
 }
 
 /***********************************************************
- *  RenderScene()
+ *  RenderViewsSeparately()
  *
- *  This method is used for rendering the 3D scene by
- *  transforming and drawing the basic 3D shapes
+ *  This method is used for culling and drawing the views one
+ *  after the other, each in its own viewport with its own
+ *  camera matrices.
  ***********************************************************/
-void SceneManager::RenderScene()
+void SceneManager::RenderViewsSeparately(const RENDER_VIEW* pViews, int viewCount, const GLint targetViewport[4])
 {
-	// Set the view position for lighting calculations
-	m_pShaderManager->setVec3Value("viewPosition", glm::vec3(0.0f, 6.0f, 5.0f));
+	m_viewOrders.resize(viewCount);
+	for (int v = 0; v < viewCount; v++)
+	{
+		const RENDER_VIEW& view = pViews[v];
+		VIEW_ORDER& order = m_viewOrders[v];
+		m_renderQueue.CullAndSort(&view, 1, order);
 
-	// ----------------------------
-	// DRAW FLOOR (Textured Plane)
-	// ----------------------------
-	glm::vec3 scaleXYZ = glm::vec3(20.0f, 1.0f, 10.0f);
-	glm::vec3 positionXYZ = glm::vec3(0.0f, 1.1f, 0.0f);
-	SetTransformations(scaleXYZ, 0.0f, 0.0f, 0.0f, positionXYZ);
+		GLTrace::Viewport(
+			targetViewport[0] + (GLint)(view.viewport.x * (float)targetViewport[2]),
+			targetViewport[1] + (GLint)(view.viewport.y * (float)targetViewport[3]),
+			(GLsizei)(view.viewport.z * (float)targetViewport[2]),
+			(GLsizei)(view.viewport.w * (float)targetViewport[3]));
+
+		if ((true == m_bDepthPrepass) && (NULL != m_pDepthShaderManager))
+		{
+			GLTrace::UseProgram(m_pDepthShaderManager);
+			GLTrace::SetMat4(m_pDepthShaderManager, g_ViewName, view.view);
+			GLTrace::SetMat4(m_pDepthShaderManager, g_ProjectionName, view.projection);
+			RenderDepthPrepass(m_pDepthShaderManager, order);
+		}
+		if (NULL != m_pTerrainClipmap)
+		{
+			RenderTerrain(view);
+		}
 
-	// Enable lighting and texture
-	m_pShaderManager->setIntValue("bUseLighting", true);
-	m_pShaderManager->setBoolValue("bUseTexture", true);
+		GLTrace::UseProgram(m_pShaderManager);
+		GLTrace::SetMat4(m_pShaderManager, g_ViewName, view.view);
+		GLTrace::SetMat4(m_pShaderManager, g_ProjectionName, view.projection);
+		RenderOpaquePass(m_pShaderManager, order);
+		RenderTransparentPass(m_pShaderManager, order);
+		if (NULL != m_pTrailRenderer)
+		{
+			RenderTrails(view, targetViewport);
+			GLTrace::UseProgram(m_pShaderManager);
+		}
+	}
 
-	// Bind the correct texture for the floor
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, FindTextureID("floorTexture"));
+	// leave the main camera set for whatever is drawn next
+	GLTrace::Viewport(targetViewport[0], targetViewport[1], targetViewport[2], targetViewport[3]);
+	GLTrace::SetMat4(m_pShaderManager, g_ViewName, m_viewMatrix);
+	GLTrace::SetMat4(m_pShaderManager, g_ProjectionName, m_projectionMatrix);
+}
 
-	m_pShaderManager->setIntValue("objectTexture", 0);
+/***********************************************************
+ *  RenderViewsTogether()
+ *
+ *  This method is used for drawing up to MAX_VIEWS views in
+ *  one pass over the draw commands.  The multiview geometry
+ *  shaders send each triangle to the viewport of every view,
+ *  so a group draws the commands visible in any of its views
+ *  once, sorted by the depth in its first view.
+ ***********************************************************/
+void SceneManager::RenderViewsTogether(const RENDER_VIEW* pViews, int viewCount, const GLint targetViewport[4])
+{
+	ShaderManager* pShader = m_pMultiviewPass->GetShader();
+	ShaderManager* pDepthShader = m_pMultiviewPass->GetDepthShader();
 
-	SetTextureUVScale(4.0f, 4.0f);           // Tile wood texture
-	SetShaderMaterial("default");            // Phong lighting material
+	int groupCount = (viewCount + MultiviewPass::MAX_VIEWS - 1) / MultiviewPass::MAX_VIEWS;
+	m_viewOrders.resize(groupCount);
+	for (int group = 0; group < groupCount; group++)
+	{
+		int first = group * MultiviewPass::MAX_VIEWS;
+		int count = std::min(viewCount - first, MultiviewPass::MAX_VIEWS);
+		VIEW_ORDER& order = m_viewOrders[group];
+		m_renderQueue.CullAndSort(&pViews[first], count, order);
+
+		// the terrain shader has no multiview version, so the
+		// terrain is drawn into each viewport first
+		for (int v = first; (NULL != m_pTerrainClipmap) && (v < first + count); v++)
+		{
+			GLTrace::Viewport(
+				targetViewport[0] + (GLint)(pViews[v].viewport.x * (float)targetViewport[2]),
+				targetViewport[1] + (GLint)(pViews[v].viewport.y * (float)targetViewport[3]),
+				(GLsizei)(pViews[v].viewport.z * (float)targetViewport[2]),
+				(GLsizei)(pViews[v].viewport.w * (float)targetViewport[3]));
+			RenderTerrain(pViews[v]);
+		}
 
-	// Draw floor plane
-	m_basicMeshes->DrawPlaneMesh();
+		m_pMultiviewPass->Begin(&pViews[first], count, targetViewport);
+		if (true == m_bDepthPrepass)
+		{
+			RenderDepthPrepass(pDepthShader, order);
+		}
+		RenderOpaquePass(pShader, order);
+		RenderTransparentPass(pShader, order);
+		m_pMultiviewPass->End(targetViewport);
 
-	// Reset texture binding (optional but clean)
-	glBindTexture(GL_TEXTURE_2D, 0);
-	m_pShaderManager->setBoolValue("bUseTexture", false);
+		// nor do the trails, which are drawn over each viewport
+		// once the scene is in it
+		for (int v = first; (NULL != m_pTrailRenderer) && (v < first + count); v++)
+		{
+			RenderTrails(pViews[v], targetViewport);
+		}
+	}
 
-	// ----------------------------
-	// DRAW DRONE (Textured Meshes)
-	// ----------------------------
-	RenderDrone();  // Handles its own texture binding per part
-}
-
-
-void SceneManager::RenderDrone()
-{
-	// === DRONE BODY ===
-	m_pShaderManager->setBoolValue("bUseTexture", true); // Enable texture use in the shader
-	glActiveTexture(GL_TEXTURE0); // Activate texture unit 0
-	glBindTexture(GL_TEXTURE_2D, FindTextureID("droneTextureBlack")); // Bind the drone texture
-	m_pShaderManager->setIntValue("objectTexture", 0); // Let the shader know to sample from texture unit 0
-
-	SetTransformations(
-		glm::vec3(3.0f, 1.0f, 2.0f),  // bigger scale
-		0.0f, 0.0f, 0.0f,
-		glm::vec3(0.0f, 2.0f, 0.0f)   // higher Y position
-	);
-	SetShaderMaterial("default"); // << ADD THIS LINE
-	m_pShaderManager->setIntValue("bUseLighting", true);
-	m_basicMeshes->DrawBoxMesh(); // draw the body
-	m_pShaderManager->setBoolValue("bUseTexture", false); // Disable texture for non-textured parts
-
-	// === CAMERA BOX ===
-	m_pShaderManager->setBoolValue("bUseTexture", true);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, FindTextureID("cameraLens"));
-	m_pShaderManager->setIntValue("objectTexture", 0);
-
-	SetTransformations(
-		glm::vec3(0.8f, 0.6f, 0.3f),  // smaller box
-		0.0f, 0.0f, 0.0f,
-		glm::vec3(0.0f, 1.6f, 0.9f)   // in front of the body
-	);
-	SetTextureUVScale(2.0f, 2.0f); // call this before drawing textured parts
-	SetShaderMaterial("default"); // << ADD THIS LINE
-	m_pShaderManager->setIntValue("bUseLighting", true);
-	m_basicMeshes->DrawBoxMesh();
-	m_pShaderManager->setBoolValue("bUseTexture", false);
-
-	// === CAMERA LENS ===
-	m_pShaderManager->setBoolValue("bUseTexture", false);
-	SetShaderColor(0.0f, 0.0f, 0.0f, 1.0f);  // RGBA → solid black
-
-	SetTransformations(
-		glm::vec3(0.3f, 0.3f, 0.4f),
-		90.0f, 0.0f, 0.0f,
-		glm::vec3(0.0f, 1.5f, 0.8f)
-	);
-	SetTextureUVScale(2.0f, 2.0f); // call this before drawing textured parts
-	SetShaderMaterial("default");
-	m_pShaderManager->setIntValue("bUseLighting", true);
-	m_basicMeshes->DrawCylinderMesh();
-	m_pShaderManager->setBoolValue("bUseTexture", false);
-
-	// === FRONT LEFT ARM ===
-	m_pShaderManager->setBoolValue("bUseTexture", false);
-	SetShaderColor(0.2f, 0.2f, 0.2f, 1.0f);  // Dark grey RGBA
-
-
-	SetTransformations(
-		glm::vec3(2.25f, 0.2f, 0.5f),
-		0.0f, 30.0f, 0.0f,
-		glm::vec3(-2.0f, 2.35f, 1.5f)
-	);
-	SetTextureUVScale(2.0f, 2.0f); // call this before drawing textured parts
-	SetShaderMaterial("default");
-	m_pShaderManager->setIntValue("bUseLighting", true);
-	m_basicMeshes->DrawBoxMesh();
-	m_pShaderManager->setBoolValue("bUseTexture", false);
-
-	// === FRONT RIGHT ARM ===
-	m_pShaderManager->setBoolValue("bUseTexture", false);
-	SetShaderColor(0.2f, 0.2f, 0.2f, 1.0f);  // Dark grey RGBA
-
-
-	SetTransformations(
-		glm::vec3(2.25f, 0.2f, 0.5f),
-		0.0f, -30.0f, 0.0f,
-		glm::vec3(2.0f, 2.35f, 1.5f)
-	);
-	SetTextureUVScale(2.0f, 2.0f); // call this before drawing textured parts
-	SetShaderMaterial("default");
-	m_pShaderManager->setIntValue("bUseLighting", true);
-	m_basicMeshes->DrawBoxMesh();
-	m_pShaderManager->setBoolValue("bUseTexture", false);
-
-	// === REAR LEFT ARM ===
-	m_pShaderManager->setBoolValue("bUseTexture", false);
-	SetShaderColor(0.2f, 0.2f, 0.2f, 1.0f);  // Dark grey RGBA
-
-
-	SetTransformations(
-		glm::vec3(2.25f, 0.2f, 0.5f),
-		0.0f, -30.0f, 0.0f,
-		glm::vec3(-2.0f, 2.35f, -1.5f)
-	);
-	SetTextureUVScale(2.0f, 2.0f); // call this before drawing textured parts
-	SetShaderMaterial("default");
-	m_pShaderManager->setIntValue("bUseLighting", true);
-	m_basicMeshes->DrawBoxMesh();
-	m_pShaderManager->setBoolValue("bUseTexture", false);
-
-	// === REAR RIGHT ARM ===
-	m_pShaderManager->setBoolValue("bUseTexture", false);
-	SetShaderColor(0.2f, 0.2f, 0.2f, 1.0f);  // Dark grey RGBA
-
-
-	SetTransformations(
-		glm::vec3(2.25f, 0.2f, 0.5f),
-		0.0f, 30.0f, 0.0f,
-		glm::vec3(2.0f, 2.35f, -1.5f)
-	);
-	SetTextureUVScale(2.0f, 2.0f); // call this before drawing textured parts
-	SetShaderMaterial("default");
-	m_pShaderManager->setIntValue("bUseLighting", true);
-	m_basicMeshes->DrawBoxMesh();
-	m_pShaderManager->setBoolValue("bUseTexture", false);
+	GLTrace::Viewport(targetViewport[0], targetViewport[1], targetViewport[2], targetViewport[3]);
+	GLTrace::UseProgram(m_pShaderManager);
 }
 
+/***********************************************************
+ *  RenderViewsSoftware()
+ *
+ *  This method is used for culling and drawing the views on
+ *  the CPU, each at the pixel size of its viewport.  The
+ *  color buffer of a view is either copied into its viewport
+ *  or compared with what OpenGL drew there, and the result
+ *  is printed to the console.
+ ***********************************************************/
+void SceneManager::RenderViewsSoftware(const RENDER_VIEW* pViews, int viewCount, const GLint targetViewport[4], bool bVerify)
+{
+	const std::vector<DRAW_COMMAND>& commands = m_renderQueue.GetCommands();
+	glm::vec4 clearColor;
+	glGetFloatv(GL_COLOR_CLEAR_VALUE, &clearColor[0]);
 
+	m_viewOrders.resize(viewCount);
+	for (int v = 0; v < viewCount; v++)
+	{
+		const RENDER_VIEW& view = pViews[v];
+		VIEW_ORDER& order = m_viewOrders[v];
+		m_renderQueue.CullAndSort(&view, 1, order);
 
+		GLint x = targetViewport[0] + (GLint)(view.viewport.x * (float)targetViewport[2]);
+		GLint y = targetViewport[1] + (GLint)(view.viewport.y * (float)targetViewport[3]);
+		GLsizei width = (GLsizei)(view.viewport.z * (float)targetViewport[2]);
+		GLsizei height = (GLsizei)(view.viewport.w * (float)targetViewport[3]);
+		m_pSoftwareRasterizer->Render(commands, order, view, width, height, clearColor);
 
+		if (false == bVerify)
+		{
+			m_pSoftwareRasterizer->Present(x, y);
+			continue;
+		}
+
+		SoftwareRasterizer::RASTER_DIFFERENCE difference;
+		m_pSoftwareRasterizer->Compare(x, y, difference);
+		bool bPassed = (difference.meanError <= m_verifyTolerance);
+		if (!bPassed)
+		{
+			m_bVerificationFailed = true;
+		}
+		std::cout << "RASTER: view " << v
+			<< " mean " << difference.meanError
+			<< " max " << difference.maxError
+			<< " different " << difference.differentFraction * 100.0f << "%"
+			<< " cpu " << m_pSoftwareRasterizer->GetLastRenderMs() << " ms"
+			<< " threads " << m_pSoftwareRasterizer->GetThreadCount()
+			<< (bPassed ? " pass" : " FAIL") << std::endl;
+	}
+}
+
+/***********************************************************
+ *  RenderDepthPrepass()
+ *
+ *  This method is used for laying down the depth of all the
+ *  visible opaque objects with a depth-only shader, so the
+ *  lighting shader later runs once per visible pixel.  The
+ *  depth shader must have its camera matrices set.
+ ***********************************************************/
+void SceneManager::RenderDepthPrepass(ShaderManager* pDepthShader, const VIEW_ORDER& order)
+{
+	const std::vector<DRAW_COMMAND>& commands = m_renderQueue.GetCommands();
+	const std::vector<uint32_t>& opaqueOrder = order.opaqueOrder;
+
+	GLTrace::UseProgram(pDepthShader);
+
+	GLTrace::ColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	GLTrace::DepthMask(GL_TRUE);
+	GLTrace::DepthFunc(GL_LESS);
+
+	for (size_t i = 0; i < opaqueOrder.size(); i++)
+	{
+		const DRAW_COMMAND& command = commands[opaqueOrder[i]];
+		GLTrace::SetMat4(pDepthShader, g_ModelName, command.model);
+		GLTrace::SetInt(pDepthShader, g_AnimationIndexName, command.animationIndex);
+		DrawBasicMesh(command.mesh);
+	}
+
+	GLTrace::ColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}
+
+/***********************************************************
+ *  RenderOpaquePass()
+ *
+ *  This method is used for drawing the visible opaque
+ *  objects front to back with blending disabled.  After a
+ *  pre-pass the depth buffer is already complete, so it is
+ *  only tested.
+ ***********************************************************/
+void SceneManager::RenderOpaquePass(ShaderManager* pShader, const VIEW_ORDER& order)
+{
+	const std::vector<DRAW_COMMAND>& commands = m_renderQueue.GetCommands();
+	const std::vector<uint32_t>& opaqueOrder = order.opaqueOrder;
+
+	GLTrace::UseProgram(pShader);
+	GLTrace::Disable(GL_BLEND);
+	if (m_bDepthPrepass)
+	{
+		// the vertex shaders declare gl_Position invariant, so the
+		// depth values written by the pre-pass match exactly
+		GLTrace::DepthFunc(GL_LEQUAL);
+		GLTrace::DepthMask(GL_FALSE);
+	}
+	else
+	{
+		GLTrace::DepthFunc(GL_LESS);
+		GLTrace::DepthMask(GL_TRUE);
+	}
+
+	for (size_t i = 0; i < opaqueOrder.size(); i++)
+	{
+		ExecuteDrawCommand(pShader, commands[opaqueOrder[i]]);
+	}
+}
+
+/***********************************************************
+ *  RenderTransparentPass()
+ *
+ *  This method is used for drawing the visible objects with
+ *  an alpha below one back to front with blending enabled.
+ *  Depth writes are off so they do not hide each other.
+ ***********************************************************/
+void SceneManager::RenderTransparentPass(ShaderManager* pShader, const VIEW_ORDER& order)
+{
+	const std::vector<DRAW_COMMAND>& commands = m_renderQueue.GetCommands();
+	const std::vector<uint32_t>& transparentOrder = order.transparentOrder;
+
+	if (transparentOrder.size() == 0)
+	{
+		return;
+	}
+
+	GLTrace::UseProgram(pShader);
+	GLTrace::Enable(GL_BLEND);
+	GLTrace::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	GLTrace::DepthFunc(GL_LESS);
+	GLTrace::DepthMask(GL_FALSE);
+
+	for (size_t i = 0; i < transparentOrder.size(); i++)
+	{
+		ExecuteDrawCommand(pShader, commands[transparentOrder[i]]);
+	}
+
+	GLTrace::Disable(GL_BLEND);
+}
+
+/***********************************************************
+ *  RenderTerrain()
+ *
+ *  This method is used for drawing the terrain for a view
+ *  with the texture and material of the floor it replaces.
+ *  It is drawn after the depth pre-pass and before the
+ *  opaque pass, writing its own depth, since the pre-pass
+ *  does not include it.
+ ***********************************************************/
+void SceneManager::RenderTerrain(const RENDER_VIEW& view)
+{
+	ShaderManager* pShader = m_pTerrainClipmap->GetShader();
+
+	GLTrace::UseProgram(pShader);
+	GLTrace::Disable(GL_BLEND);
+	GLTrace::DepthFunc(GL_LESS);
+	GLTrace::DepthMask(GL_TRUE);
+	ApplyCommandState(pShader, m_terrainCommand);
+	m_pTerrainClipmap->Draw(view.view, view.projection);
+}
+
+/***********************************************************
+ *  RenderTrails()
+ *
+ *  This method is used for drawing the drone trails for a
+ *  view into its viewport of the target.  They are blended
+ *  over the scene after the transparent pass, tested against
+ *  its depth but not writing any.
+ ***********************************************************/
+void SceneManager::RenderTrails(const RENDER_VIEW& view, const GLint viewport[4])
+{
+	GLint x = viewport[0] + (GLint)(view.viewport.x * (float)viewport[2]);
+	GLint y = viewport[1] + (GLint)(view.viewport.y * (float)viewport[3]);
+	GLsizei width = (GLsizei)(view.viewport.z * (float)viewport[2]);
+	GLsizei height = (GLsizei)(view.viewport.w * (float)viewport[3]);
+	if ((width <= 0) || (height <= 0))
+	{
+		return;
+	}
+
+	GLTrace::Viewport(x, y, width, height);
+	GLTrace::Enable(GL_BLEND);
+	GLTrace::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	GLTrace::DepthFunc(GL_LESS);
+	GLTrace::DepthMask(GL_FALSE);
+	m_pTrailRenderer->Draw(view.view, view.projection, glm::vec2((float)width, (float)height));
+	GLTrace::Disable(GL_BLEND);
+}
+
+/***********************************************************
+ *  LoadSceneFile()
+ *
+ *  This method is used for mapping the scene file and
+ *  creating the textures, materials and lights it defines.
+ *  The parts are read from the mapped file every frame.
+ ***********************************************************/
+bool SceneManager::LoadSceneFile()
+{
+	if (!m_pSceneFile->Load(m_sceneFilename))
+	{
+		return(false);
+	}
+
+	PrepareLightmaps();
+	ApplySceneFile();
+	return(true);
+}
+
+/***********************************************************
+ *  PrepareLightmaps()
+ *
+ *  This method is used for loading the lightmaps of the
+ *  static parts from the baked file next to the scene file,
+ *  baking them first when the file is missing or out of
+ *  date.  They are drawn by the static batches, and the CPU
+ *  rasterizer lights every part itself, so there are none
+ *  without batching or when it draws or checks the scene.
+ ***********************************************************/
+void SceneManager::PrepareLightmaps()
+{
+	if (false == m_bLightmaps)
+	{
+		return;
+	}
+	if ((false == m_bStaticBatching) || (NULL != m_pSoftwareRasterizer))
+	{
+		std::cout << "Lightmaps: off, they need static batching and the OpenGL renderer" << std::endl;
+		return;
+	}
+
+	m_pLightmapAtlas = new LightmapAtlas();
+	m_pLightmapAtlas->Prepare(m_pSceneFile, g_TelemetryGroupName);
+	m_pLightmapAtlas->LoadOrBake(m_pSceneFile, LightmapAtlas::GetCacheFilename(m_sceneFilename), 0);
+	if (!m_pLightmapAtlas->WasBaked())
+	{
+		std::cout << "Lightmaps: loaded " << m_pLightmapAtlas->GetChartCount() << " charts of "
+			<< m_pLightmapAtlas->GetLightmappedPartCount() << " parts, " << m_pLightmapAtlas->GetWidth()
+			<< "x" << m_pLightmapAtlas->GetHeight() << std::endl;
+	}
+	m_pLightmapAtlas->CreateTexture();
+}
+
+/***********************************************************
+ *  BakeLightmaps()
+ *
+ *  This method is used for baking the lightmaps of a scene
+ *  file into its baked file on the given threads, without
+ *  an OpenGL context, so the first run does not wait for
+ *  them.
+ ***********************************************************/
+bool SceneManager::BakeLightmaps(const std::string& sceneFilename, int threadCount)
+{
+	SceneFile sceneFile;
+	if (!sceneFile.Load(sceneFilename))
+	{
+		std::cerr << "Failed to load scene file: " << sceneFilename << std::endl;
+		return(false);
+	}
+
+	LightmapAtlas lightmapAtlas;
+	lightmapAtlas.Prepare(&sceneFile, g_TelemetryGroupName);
+	lightmapAtlas.Bake(&sceneFile, threadCount);
+	return(lightmapAtlas.Save(LightmapAtlas::GetCacheFilename(sceneFilename)));
+}
+
+/***********************************************************
+ *  ApplySceneFile()
+ *
+ *  This method is used for creating the textures, models,
+ *  materials and lights of the mapped scene file.  Textures
+ *  already loaded under the same tag and models loaded from
+ *  the same file are used as they are, so a reloaded scene
+ *  only loads the ones it added.
+ ***********************************************************/
+void SceneManager::ApplySceneFile()
+{
+	const SCENE_TEXTURE_RECORD* pTextures = m_pSceneFile->GetTextures();
+	m_sceneTextureIDs.assign(m_pSceneFile->GetTextureCount(), -1);
+	for (uint32_t i = 0; i < m_pSceneFile->GetTextureCount(); i++)
+	{
+		const char* tag = m_pSceneFile->GetString(pTextures[i].tag);
+		int textureID = FindTextureID(tag);
+		if ((textureID < 0) && !CreateGLTexture(m_pSceneFile->GetString(pTextures[i].path), tag))
+		{
+			std::cerr << "Failed to load texture: " << tag << std::endl;
+			continue;
+		}
+		m_sceneTextureIDs[i] = FindTextureID(tag);
+	}
+
+	const SCENE_MODEL_RECORD* pModels = m_pSceneFile->GetModels();
+	int loadedModels = m_pModelMeshes->GetModelCount();
+	m_sceneModelIndices.assign(m_pSceneFile->GetModelCount(), -1);
+	for (uint32_t i = 0; i < m_pSceneFile->GetModelCount(); i++)
+	{
+		const char* path = m_pSceneFile->GetString(pModels[i].path);
+		int model = m_pModelMeshes->LoadModel(path);
+		if (model < 0)
+		{
+			std::cerr << "Failed to load model: " << m_pSceneFile->GetString(pModels[i].tag) << std::endl;
+			continue;
+		}
+		if (model >= loadedModels)
+		{
+			glm::vec3 boundsMin;
+			glm::vec3 boundsMax;
+			m_pModelMeshes->GetBounds(model, boundsMin, boundsMax);
+			RenderQueue::SetModelBounds(model, boundsMin, boundsMax);
+			// the CPU rasterizer keeps its own copy of the triangles
+			if (NULL != m_pSoftwareRasterizer)
+			{
+				m_pSoftwareRasterizer->LoadModel(model, path);
+			}
+		}
+		m_sceneModelIndices[i] = model;
+	}
+
+	// the material records keep their order, so the part
+	// material indices are also indices into m_objectMaterials
+	const SCENE_MATERIAL_RECORD* pMaterials = m_pSceneFile->GetMaterials();
+	m_objectMaterials.clear();
+	for (uint32_t i = 0; i < m_pSceneFile->GetMaterialCount(); i++)
+	{
+		OBJECT_MATERIAL material;
+		material.tag = m_pSceneFile->GetString(pMaterials[i].tag);
+		material.ambientStrength = pMaterials[i].ambientStrength;
+		material.ambientColor = glm::make_vec3(pMaterials[i].ambientColor);
+		material.diffuseColor = glm::make_vec3(pMaterials[i].diffuseColor);
+		material.specularColor = glm::make_vec3(pMaterials[i].specularColor);
+		material.shininess = pMaterials[i].shininess;
+		m_objectMaterials.push_back(material);
+	}
+
+	const SCENE_LIGHT_RECORD* pLights = m_pSceneFile->GetLights();
+	uint32_t previousLightCount = (uint32_t)m_lightSources.size();
+	for (uint32_t i = 0; i < m_pSceneFile->GetLightCount(); i++)
+	{
+		if (i >= g_TotalLights)
+		{
+			std::cerr << "Scene has more than " << g_TotalLights << " lights, the rest are ignored" << std::endl;
+			break;
+		}
+
+		LIGHT_SOURCE light;
+		light.position = glm::make_vec3(pLights[i].position);
+		light.ambientColor = glm::make_vec3(pLights[i].ambientColor);
+		light.diffuseColor = glm::make_vec3(pLights[i].diffuseColor);
+		light.specularColor = glm::make_vec3(pLights[i].specularColor);
+		light.focalStrength = pLights[i].focalStrength;
+		light.specularIntensity = pLights[i].specularIntensity;
+		light.bCastShadows = (pLights[i].flags & SCENE_LIGHT_SHADOWS) != 0;
+		SetLightSource((int)i, light);
+	}
+
+	// lights a reloaded scene no longer has are turned off
+	uint32_t lightCount = std::min(m_pSceneFile->GetLightCount(), g_TotalLights);
+	if (previousLightCount > lightCount)
+	{
+		LIGHT_SOURCE darkLight;
+		darkLight.position = glm::vec3(0.0f);
+		darkLight.ambientColor = glm::vec3(0.0f);
+		darkLight.diffuseColor = glm::vec3(0.0f);
+		darkLight.specularColor = glm::vec3(0.0f);
+		darkLight.focalStrength = 1.0f;
+		darkLight.specularIntensity = 0.0f;
+		darkLight.bCastShadows = false;
+		for (uint32_t i = lightCount; i < previousLightCount; i++)
+		{
+			SetLightSource((int)i, darkLight);
+		}
+		m_lightSources.resize(lightCount);
+	}
+
+	if (NULL != m_pAnimationManager)
+	{
+		m_pAnimationManager->SetAnimations(m_pSceneFile->GetAnimations(), m_pSceneFile->GetAnimationCount());
+	}
+
+	if (NULL != m_pSoftwareRasterizer)
+	{
+		std::vector<SoftwareRasterizer::RASTER_MATERIAL> materials(m_objectMaterials.size());
+		for (size_t i = 0; i < m_objectMaterials.size(); i++)
+		{
+			materials[i].ambientColor = m_objectMaterials[i].ambientColor;
+			materials[i].ambientStrength = m_objectMaterials[i].ambientStrength;
+			materials[i].diffuseColor = m_objectMaterials[i].diffuseColor;
+			materials[i].specularColor = m_objectMaterials[i].specularColor;
+			materials[i].shininess = m_objectMaterials[i].shininess;
+		}
+		m_pSoftwareRasterizer->SetMaterials(materials);
+		m_pSoftwareRasterizer->SetAnimations(m_pSceneFile->GetAnimations(), m_pSceneFile->GetAnimationCount());
+	}
+
+	// the parts that never move apart are merged, and merged
+	// again after a reload only where the parts changed
+	if (true == m_bStaticBatching)
+	{
+		if (NULL == m_pStaticBatches)
+		{
+			m_pStaticBatches = new StaticBatches();
+		}
+		m_pStaticBatches->Build(m_pSceneFile, m_pModelMeshes, m_pSoftwareRasterizer, m_pLightmapAtlas);
+	}
+}
+
+/***********************************************************
+ *  WatchAssets()
+ *
+ *  This method is used for having the shaders, the textures
+ *  and the scene file reloaded when their files change.  The
+ *  main shader gets its lights, shadow samplers and animation
+ *  block back after a reload, the other shaders are watched
+ *  by their owners.
+ ***********************************************************/
+void SceneManager::WatchAssets()
+{
+	m_pHotReload->WatchProgram(m_pShaderManager,
+		m_vertexShaderFilename.c_str(), NULL, m_fragmentShaderFilename.c_str(), "scene",
+		[this](ShaderManager* pShader)
+		{
+			AnimationManager::BindShader(pShader);
+			ApplyLightingState(pShader);
+		});
+	m_pHotReload->WatchProgram(m_pDepthShaderManager,
+		"depthVertexShader.glsl", NULL, "depthFragmentShader.glsl", "scene",
+		[](ShaderManager* pShader) { AnimationManager::BindShader(pShader); });
+	if (NULL != m_pShadowManager)
+	{
+		m_pShadowManager->WatchShaders(m_pHotReload);
+	}
+	if (NULL != m_pMultiviewPass)
+	{
+		m_pMultiviewPass->WatchShaders(m_pHotReload,
+			[this](ShaderManager* pShader) { ApplyLightingState(pShader); });
+	}
+	if (NULL != m_pTerrainClipmap)
+	{
+		m_pTerrainClipmap->WatchShaders(m_pHotReload,
+			[this](ShaderManager* pShader) { ApplyLightingState(pShader); });
+	}
+	if (NULL != m_pTrailRenderer)
+	{
+		m_pTrailRenderer->WatchShaders(m_pHotReload);
+	}
+
+	// the images are decoded again by the texture streamer
+	// worker, so there is nothing to prepare here
+	std::vector<std::string> texturePaths;
+	const SCENE_TEXTURE_RECORD* pTextures = m_pSceneFile->GetTextures();
+	for (uint32_t i = 0; (NULL != pTextures) && (i < m_pSceneFile->GetTextureCount()); i++)
+	{
+		std::string path = m_pSceneFile->GetString(pTextures[i].path);
+		if (std::find(texturePaths.begin(), texturePaths.end(), path) != texturePaths.end())
+		{
+			continue;
+		}
+		texturePaths.push_back(path);
+
+		m_pHotReload->Watch(std::vector<std::string>(1, path),
+			[]() { return true; },
+			[this, path]()
+			{
+				m_pTextureStreamer->ReloadTexture(path);
+				return true;
+			});
+	}
+
+	m_pHotReload->Watch(std::vector<std::string>(1, m_sceneFilename),
+		[this]() { return PrepareSceneReload(); },
+		[this]()
+		{
+			SwapSceneFile();
+			return true;
+		});
+
+	m_pHotReload->Start();
+}
+
+/***********************************************************
+ *  PrepareSceneReload()
+ *
+ *  This method is used for compiling and mapping a changed
+ *  scene file on the watcher thread.  The binary file that
+ *  is mapped cannot be written over, so a text scene is
+ *  compiled into one of two other files in turn.  The
+ *  lightmaps are loaded or baked here too when the edit
+ *  changed what lights the static parts.
+ ***********************************************************/
+bool SceneManager::PrepareSceneReload()
+{
+	std::string binaryFilename = m_sceneFilename;
+	if (SceneFile::IsTextFilename(m_sceneFilename))
+	{
+		binaryFilename = SceneFile::GetReloadFilename(m_sceneFilename, m_sceneReloadCount % 2);
+		if (!SceneFile::Compile(m_sceneFilename, binaryFilename))
+		{
+			return(false);
+		}
+	}
+
+	SceneFile* pSceneFile = new SceneFile();
+	if (!pSceneFile->Load(binaryFilename))
+	{
+		std::cout << "Keeping the scene file loaded before" << std::endl;
+		delete pSceneFile;
+		return(false);
+	}
+
+	// the texture of the lightmaps in use is only replaced on
+	// the render thread
+	if (NULL != m_pLightmapAtlas)
+	{
+		LightmapAtlas* pLightmapAtlas = new LightmapAtlas();
+		pLightmapAtlas->Prepare(pSceneFile, g_TelemetryGroupName);
+		if (pLightmapAtlas->GetSceneHash() == m_pLightmapAtlas->GetSceneHash())
+		{
+			delete pLightmapAtlas;
+		}
+		else
+		{
+			pLightmapAtlas->LoadOrBake(pSceneFile, LightmapAtlas::GetCacheFilename(m_sceneFilename), 0);
+			m_pReloadedLightmapAtlas = pLightmapAtlas;
+		}
+	}
+
+	m_pReloadedSceneFile = pSceneFile;
+	m_sceneReloadCount++;
+	return(true);
+}
+
+/***********************************************************
+ *  SwapSceneFile()
+ *
+ *  This method is used for replacing the mapped scene file
+ *  with the reloaded one at the start of a frame.  The parts
+ *  are read from it from this frame on, and its materials,
+ *  lights and animations replace the old ones.  The point
+ *  lights with shadow maps stay the ones the first scene
+ *  had.
+ ***********************************************************/
+void SceneManager::SwapSceneFile()
+{
+	delete m_pSceneFile;
+	m_pSceneFile = m_pReloadedSceneFile;
+	m_pReloadedSceneFile = NULL;
+
+	// the batches take their atlas coordinates from the new
+	// lightmaps
+	if (NULL != m_pReloadedLightmapAtlas)
+	{
+		m_pReloadedLightmapAtlas->CreateTexture();
+		delete m_pLightmapAtlas;
+		m_pLightmapAtlas = m_pReloadedLightmapAtlas;
+		m_pReloadedLightmapAtlas = NULL;
+	}
+
+	GLTrace::UseProgram(m_pShaderManager);
+	ApplySceneFile();
+
+	if ((NULL != m_pMultiviewPass) && (NULL != m_pMultiviewPass->GetShader()))
+	{
+		GLTrace::UseProgram(m_pMultiviewPass->GetShader());
+		ApplyLightingState(m_pMultiviewPass->GetShader());
+		GLTrace::UseProgram(m_pShaderManager);
+	}
+	if (NULL != m_pTerrainClipmap)
+	{
+		GLTrace::UseProgram(m_pTerrainClipmap->GetShader());
+		ApplyLightingState(m_pTerrainClipmap->GetShader());
+		GLTrace::UseProgram(m_pShaderManager);
+	}
+	if (NULL != m_pShadowManager)
+	{
+		if (!m_lightSources.empty() && m_lightSources[0].bCastShadows)
+		{
+			m_pShadowManager->SetKeyLightDirection(-m_lightSources[0].position);
+		}
+		m_pShadowManager->InvalidateStatic();
+	}
+
+	std::cout << "Reloaded scene file:" << m_sceneFilename << std::endl;
+}
+
+/***********************************************************
+ *  GetDroneTransforms()
+ *
+ *  This method is used for getting the transforms of the
+ *  drones.  Live telemetry takes the place of the swarm
+ *  simulation, and both take the place of a replayed log.
+ ***********************************************************/
+const std::vector<glm::mat4>* SceneManager::GetDroneTransforms() const
+{
+	const std::vector<glm::mat4>* pDroneTransforms = NULL;
+	if (NULL != m_pTelemetryIngest)
+	{
+		pDroneTransforms = &m_pTelemetryIngest->GetDroneTransforms();
+	}
+	else if (NULL != m_pSwarmSimulation)
+	{
+		pDroneTransforms = &m_pSwarmSimulation->GetDroneTransforms();
+	}
+	else if (NULL != m_pTelemetryPlayback)
+	{
+		pDroneTransforms = &m_pTelemetryPlayback->GetDroneTransforms();
+	}
+	if ((NULL != pDroneTransforms) && pDroneTransforms->empty())
+	{
+		pDroneTransforms = NULL;
+	}
+	return(pDroneTransforms);
+}
+
+/***********************************************************
+ *  SubmitSceneParts()
+ *
+ *  This method is used for submitting a draw command for
+ *  each part record of the mapped scene file that is not in
+ *  a static batch, and one for each batch.  When flight
+ *  telemetry is being replayed or received live, or the
+ *  swarm is simulated, the drone parts are drawn once for
+ *  every drone at its pose.  With a terrain the floor parts
+ *  are left out, the terrain takes their draw state.
+ ***********************************************************/
+void SceneManager::SubmitSceneParts()
+{
+	const SCENE_PART_RECORD* pParts = m_pSceneFile->GetParts();
+	if (NULL == pParts)
+	{
+		return;
+	}
+
+	const std::vector<glm::mat4>* pDroneTransforms = GetDroneTransforms();
+
+	DRAW_COMMAND command;
+	for (uint32_t i = 0; i < m_pSceneFile->GetPartCount(); i++)
+	{
+		if (((NULL != m_pStaticBatches) && m_pStaticBatches->IsBatched(i)) ||
+			!GetPartCommand(pParts[i], command))
+		{
+			continue;
+		}
+		// the terrain is drawn with the state of the floor
+		if ((NULL != m_pTerrainClipmap) && (strcmp(m_pSceneFile->GetString(pParts[i].group), g_FloorGroupName) == 0))
+		{
+			m_terrainCommand = command;
+			continue;
+		}
+		SubmitPartCommand(command, pParts[i].group, pDroneTransforms);
+	}
+
+	// a batch is drawn with the state of its first part, its
+	// triangles are already moved into the group frame
+	for (int i = 0; (NULL != m_pStaticBatches) && (i < m_pStaticBatches->GetBatchCount()); i++)
+	{
+		const SCENE_PART_RECORD& part = pParts[m_pStaticBatches->GetBatchParts(i)[0]];
+		if (!GetPartCommand(part, command))
+		{
+			continue;
+		}
+		if ((NULL != m_pTerrainClipmap) && (strcmp(m_pSceneFile->GetString(part.group), g_FloorGroupName) == 0))
+		{
+			m_terrainCommand = command;
+			continue;
+		}
+		command.mesh = (MESH_TYPE)(MESH_MODEL_FIRST + m_pStaticBatches->GetBatch(i).model);
+		command.model = glm::mat4(1.0f);
+		command.bUseLightmap = m_pStaticBatches->GetBatch(i).bLightmapped;
+		SubmitPartCommand(command, part.group, pDroneTransforms);
+	}
+}
+
+/***********************************************************
+ *  GetPartCommand()
+ *
+ *  This method is used for filling a draw command with the
+ *  mesh and draw state of a part record, returning false
+ *  for a part whose model did not load.
+ ***********************************************************/
+bool SceneManager::GetPartCommand(const SCENE_PART_RECORD& part, DRAW_COMMAND& command) const
+{
+	command.mesh = (MESH_TYPE)part.mesh;
+	if (part.mesh >= MESH_MODEL_FIRST)
+	{
+		// parts of a model that did not load are left out
+		int model = m_sceneModelIndices[part.mesh - MESH_MODEL_FIRST];
+		if (model < 0)
+		{
+			return(false);
+		}
+		command.mesh = (MESH_TYPE)(MESH_MODEL_FIRST + model);
+	}
+	command.model = glm::make_mat4(part.model);
+	command.color = glm::make_vec4(part.color);
+	command.uvScale = glm::make_vec2(part.uvScale);
+	command.textureID = (part.texture >= 0) ? m_sceneTextureIDs[part.texture] : -1;
+	command.materialIndex = part.material;
+	command.bUseLighting = (part.flags & SCENE_PART_UNLIT) == 0;
+	command.bUseLightmap = false;
+	command.bDynamic = (part.flags & SCENE_PART_DYNAMIC) != 0;
+	command.animationIndex = -1;
+	command.animationReach = 0.0f;
+	if ((part.animation >= 0) && (part.animation < AnimationManager::MAX_ANIMATIONS))
+	{
+		command.animationIndex = part.animation;
+		command.animationReach = glm::length(glm::make_vec3(m_pSceneFile->GetAnimations()[part.animation].bobOffset));
+	}
+	return(true);
+}
+
+/***********************************************************
+ *  SubmitPartCommand()
+ *
+ *  This method is used for submitting the command of a part
+ *  of the given group, once for every drone when the group
+ *  is placed by the telemetry.
+ ***********************************************************/
+void SceneManager::SubmitPartCommand(
+	DRAW_COMMAND& command,
+	uint32_t group,
+	const std::vector<glm::mat4>* pDroneTransforms)
+{
+	if ((NULL != pDroneTransforms) && (strcmp(m_pSceneFile->GetString(group), g_TelemetryGroupName) == 0))
+	{
+		const std::vector<glm::mat4>& transforms = *pDroneTransforms;
+		glm::mat4 partModel = command.model;
+
+		// the replayed drones move every frame
+		command.bDynamic = true;
+		for (size_t drone = 0; drone < transforms.size(); drone++)
+		{
+			command.model = transforms[drone] * partModel;
+			m_renderQueue.Submit(command);
+		}
+		return;
+	}
+
+	m_renderQueue.Submit(command);
+}
+
+/***********************************************************
+ *  SetTelemetryPlayback()
+ *
+ *  This method is used for setting the telemetry playback
+ *  that places the drones, or NULL to draw the drone parts
+ *  where the scene file puts them.
+ ***********************************************************/
+void SceneManager::SetTelemetryPlayback(TelemetryPlayback* pTelemetryPlayback)
+{
+	m_pTelemetryPlayback = pTelemetryPlayback;
+}
+
+/***********************************************************
+ *  SetTelemetryIngest()
+ *
+ *  This method is used for setting the live telemetry that
+ *  places the drones.  It is used in place of a telemetry
+ *  playback while it is set.
+ ***********************************************************/
+void SceneManager::SetTelemetryIngest(TelemetryIngest* pTelemetryIngest)
+{
+	m_pTelemetryIngest = pTelemetryIngest;
+}
+
+/***********************************************************
+ *  SetSwarmSimulation()
+ *
+ *  This method is used for setting the swarm simulation
+ *  that places the drones.  It is used in place of a
+ *  telemetry playback while it is set.
+ ***********************************************************/
+void SceneManager::SetSwarmSimulation(SwarmSimulation* pSwarmSimulation)
+{
+	m_pSwarmSimulation = pSwarmSimulation;
+}
+
+/***********************************************************
+ *  SetTerrainFile()
+ *
+ *  This method is used for setting the cooked terrain file
+ *  PrepareScene() streams the terrain from.
+ ***********************************************************/
+void SceneManager::SetTerrainFile(const std::string& filename)
+{
+	m_terrainFilename = filename;
+}
+
+/***********************************************************
+ *  SetTrailLength()
+ *
+ *  This method is used for setting how many samples of its
+ *  path each drone trails behind it.  PrepareScene() only
+ *  creates the trails when it is above 0.
+ ***********************************************************/
+void SceneManager::SetTrailLength(int sampleCount)
+{
+	m_trailSampleCount = sampleCount;
+}
+
+/***********************************************************
+ *  SetSceneFile()
+ *
+ *  This method is used for setting the scene file loaded by
+ *  PrepareScene(), either a text .scene file or a compiled
+ *  binary scene file.
+ ***********************************************************/
+void SceneManager::SetSceneFile(const std::string& filename)
+{
+	m_sceneFilename = filename;
+}
+
+/***********************************************************
+ *  SetViewTransform()
+ *
+ *  This method is used for setting the camera transforms of
+ *  the current frame, used for the view depth sorting and
+ *  the depth pre-pass.
+ ***********************************************************/
+void SceneManager::SetViewTransform(
+	const glm::mat4& view,
+	const glm::mat4& projection)
+{
+	m_viewMatrix = view;
+	m_projectionMatrix = projection;
+}
+
+/***********************************************************
+ *  SetRenderViews()
+ *
+ *  This method is used for setting the views drawn by
+ *  RenderScene(), each in its part of the render target.
+ *  With no views the main camera fills the target.
+ ***********************************************************/
+void SceneManager::SetRenderViews(const std::vector<RENDER_VIEW>& views)
+{
+	m_views = views;
+}
+
+/***********************************************************
+ *  SetMultiviewEnabled()
+ *
+ *  This method is used for allowing several views to be
+ *  drawn in one pass when the OpenGL context supports it,
+ *  or forcing them to be drawn one at a time.
+ ***********************************************************/
+void SceneManager::SetMultiviewEnabled(bool bEnabled)
+{
+	m_bMultiviewEnabled = bEnabled;
+}
+
+/***********************************************************
+ *  SetStaticBatchingEnabled()
+ *
+ *  This method is used for merging the parts that keep their
+ *  place in their group into static batches, or drawing
+ *  every part on its own.  Must be called before
+ *  PrepareScene().
+ ***********************************************************/
+void SceneManager::SetStaticBatchingEnabled(bool bEnabled)
+{
+	m_bStaticBatching = bEnabled;
+}
+
+/***********************************************************
+ *  SetLightmapsEnabled()
+ *
+ *  This method is used for drawing the static batches with
+ *  baked lightmaps, or lighting every part each frame.  Must
+ *  be called before PrepareScene().
+ ***********************************************************/
+void SceneManager::SetLightmapsEnabled(bool bEnabled)
+{
+	m_bLightmaps = bEnabled;
+}
+
+/***********************************************************
+ *  SetRenderBackend()
+ *
+ *  This method is used for choosing whether OpenGL or the
+ *  CPU rasterizer draws the scene, for machines whose only
+ *  OpenGL driver is too slow to draw it.  Must be called
+ *  before PrepareScene().
+ ***********************************************************/
+void SceneManager::SetRenderBackend(RENDER_BACKEND backend, int threadCount)
+{
+	m_renderBackend = backend;
+	m_rasterThreadCount = threadCount;
+}
+
+/***********************************************************
+ *  SetSoftwareVerification()
+ *
+ *  This method is used for drawing every OpenGL frame on
+ *  the CPU as well and comparing the two, to check the CPU
+ *  rasterizer against the shaders.  Shadows should be off,
+ *  since the CPU rasterizer draws none.  Must be called
+ *  before PrepareScene().
+ ***********************************************************/
+void SceneManager::SetSoftwareVerification(float tolerance, int threadCount)
+{
+	m_verifyTolerance = tolerance;
+	m_rasterThreadCount = threadCount;
+}
+
+/***********************************************************
+ *  SetShadowsEnabled()
+ *
+ *  This method is used for turning the shadow maps on or
+ *  off.  Must be called before PrepareScene().
+ ***********************************************************/
+void SceneManager::SetShadowsEnabled(bool bEnabled)
+{
+	m_bShadowsEnabled = bEnabled;
+}
+
+/***********************************************************
+ *  SetShadowVerification()
+ *
+ *  This method is used for having the cached shadow maps
+ *  checked against maps drawn from scratch every frame.
+ *  Must be called before PrepareScene().
+ ***********************************************************/
+void SceneManager::SetShadowVerification(bool bVerify)
+{
+	m_bVerifyShadows = bVerify;
+}
+
+/***********************************************************
+ *  GetDroneTransform()
+ *
+ *  This method is used for getting the world transform the
+ *  telemetry or the swarm gives a drone.  Without one
+ *  the drone parts are where the scene file puts them.
+ ***********************************************************/
+glm::mat4 SceneManager::GetDroneTransform(int drone) const
+{
+	const std::vector<glm::mat4>* pDroneTransforms = GetDroneTransforms();
+	if ((NULL != pDroneTransforms) && (drone >= 0) && (drone < (int)pDroneTransforms->size()))
+	{
+		return((*pDroneTransforms)[drone]);
+	}
+	return(glm::mat4(1.0f));
+}
+
+/***********************************************************
+ *  SetFrameStats()
+ *
+ *  This method is used for setting the object that collects
+ *  the frame timings.  The shadow update, the terrain
+ *  update and the trail update are measured as their own
+ *  sections.
+ ***********************************************************/
+void SceneManager::SetFrameStats(FrameStats* pFrameStats)
+{
+	m_pFrameStats = pFrameStats;
+	if (NULL != m_pFrameStats)
+	{
+		m_shadowSectionID = m_pFrameStats->RegisterSection("shadow");
+		if (NULL != m_pTerrainClipmap)
+		{
+			m_terrainSectionID = m_pFrameStats->RegisterSection("terrain");
+		}
+		if (NULL != m_pTrailRenderer)
+		{
+			m_trailSectionID = m_pFrameStats->RegisterSection("trails");
+		}
+	}
+}
+
+/***********************************************************
+ *  SetDepthPrepassEnabled()
+ *
+ *  This method is used for enabling or disabling the depth
+ *  pre-pass.  It only pays off when objects overlap on the
+ *  screen, so it can be turned off for simple scenes.
+ ***********************************************************/
+void SceneManager::SetDepthPrepassEnabled(bool bEnabled)
+{
+	m_bDepthPrepass = bEnabled;
+}
+
+/***********************************************************
+ *  SetTextureMemoryBudget()
+ *
+ *  This method is used for setting how much GPU memory the
+ *  streamed textures may use.  Levels over the budget are
+ *  evicted starting with the least recently used texture.
+ ***********************************************************/
+void SceneManager::SetTextureMemoryBudget(size_t budgetBytes)
+{
+	m_pTextureStreamer->SetMemoryBudget(budgetBytes);
+}
+
+/**************************************************************/
+/*** STUDENTS CAN MODIFY the code in the methods BELOW for  ***/
+/*** preparing and rendering their own 3D replicated scenes.***/
+/*** Please refer to the code in the OpenGL sample project  ***/
+/*** for assistance.                                        ***/
+/**************************************************************/
+
+
+/***********************************************************
+ *  SetAnimationTime()
+ *
+ *  This method is used for setting the time the animated
+ *  parts are shown at, once per frame before rendering.
+ ***********************************************************/
+void SceneManager::SetAnimationTime(double seconds)
+{
+	m_animationSeconds = seconds;
+	if (NULL != m_pAnimationManager)
+	{
+		m_pAnimationManager->SetTime(seconds);
+	}
+	if (NULL != m_pSoftwareRasterizer)
+	{
+		m_pSoftwareRasterizer->SetAnimationClock((float)std::fmod(seconds, SCENE_ANIMATION_PERIOD));
+	}
+}
+
+/***********************************************************
+ *  EnableHotReload()
+ *
+ *  This method is used for reloading the shaders, textures
+ *  and scene file while the scene is shown, whenever their
+ *  files change.  The files of the main shader are passed
+ *  in since it is loaded outside.  Must be called before
+ *  PrepareScene().
+ ***********************************************************/
+void SceneManager::EnableHotReload(const char* vertexFilename, const char* fragmentFilename)
+{
+	if (NULL == m_pHotReload)
+	{
+		m_pHotReload = new HotReload();
+	}
+	m_vertexShaderFilename = vertexFilename;
+	m_fragmentShaderFilename = fragmentFilename;
+}
+
+/***********************************************************
+ *  GetVisibleDrawCount()
+ *
+ *  This method is used for counting the draw commands that
+ *  survived the culling of the last frame, for each view or
+ *  group of views drawn together.
+ ***********************************************************/
+int SceneManager::GetVisibleDrawCount() const
+{
+	size_t visibleCount = 0;
+	for (size_t i = 0; i < m_viewOrders.size(); i++)
+	{
+		visibleCount += m_viewOrders[i].opaqueOrder.size() + m_viewOrders[i].transparentOrder.size();
+	}
+	return((int)visibleCount);
+}
+
+/***********************************************************
+ *  NeedsRedraw()
+ *
+ *  This method is used for checking whether the next frame
+ *  would differ from the last one with the same camera and
+ *  drones, because textures or terrain tiles are still
+ *  being streamed in.
+ ***********************************************************/
+bool SceneManager::NeedsRedraw() const
+{
+	if ((NULL != m_pHotReload) && m_pHotReload->IsSwapPending())
+	{
+		return(true);
+	}
+	if ((NULL != m_pTerrainClipmap) && m_pTerrainClipmap->IsStreaming())
+	{
+		return(true);
+	}
+	if (NULL != m_pTextureStreamer)
+	{
+		return(m_pTextureStreamer->IsStreaming());
+	}
+	return(false);
+}
+
+/***********************************************************
+ *  PrepareScene()
+ *
+ *  This method is used for preparing the 3D scene by loading
+ *  the shapes, textures in memory to support the 3D scene
+ *  rendering
+ ***********************************************************/
+void SceneManager::PrepareScene()
+{
+	// only one instance of a particular mesh needs to be
+	// loaded in memory no matter how many times it is drawn
+	// in the rendered 3D scene
+
+	m_basicMeshes->LoadPlaneMesh();
+	m_basicMeshes->LoadBoxMesh(); //  Required for drone body
+	m_basicMeshes->LoadCylinderMesh(); // required for camera lens
+
+	// depth-only shader for the pre-pass, the lighting shader
+	// stays bound for everything else
+	m_pDepthShaderManager = new ShaderManager();
+	m_pDepthShaderManager->LoadShaders(
+		"depthVertexShader.glsl",
+		"depthFragmentShader.glsl");
+	ResourceTracker::TrackProgram(m_pDepthShaderManager->m_programID, "scene", "depthVertexShader.glsl");
+	GLTrace::UseProgram(m_pShaderManager);
+
+	// animated parts are spun and bobbed by the vertex shaders
+	m_pAnimationManager = new AnimationManager();
+	m_pAnimationManager->Initialize();
+	AnimationManager::BindShader(m_pShaderManager);
+	AnimationManager::BindShader(m_pDepthShaderManager);
+
+	PrepareSoftwareRasterizer();
+
+	// textures, materials, lights and parts come from the scene file
+	if (!LoadSceneFile())
+	{
+		std::cerr << "Failed to load scene file: " << m_sceneFilename << std::endl;
+		return;
+	}
+
+	PrepareShadows();
+	PrepareMultiview();
+	PrepareTerrain();
+	PrepareTrails();
+
+	if (NULL != m_pHotReload)
+	{
+		WatchAssets();
+	}
+}
+
+/***********************************************************
+ *  RenderScene()
+ *
+ *  This method is used for rendering the 3D scene by
+ *  transforming and drawing the basic 3D shapes.  The draws
+ *  are collected first and then rendered in sorted passes.
+ ***********************************************************/
+void SceneManager::RenderScene()
+{
+	m_frameArena.Reset();
+	m_renderQueue.Clear();
+
+	// swap in the assets whose files changed, which may have
+	// bound other programs
+	if ((NULL != m_pHotReload) && m_pHotReload->Update())
+	{
+		GLTrace::UseProgram(m_pShaderManager);
+	}
+
+	// Set the view position for lighting calculations
+	GLTrace::SetVec3(m_pShaderManager, g_ViewPositionName, glm::vec3(0.0f, 6.0f, 5.0f));
+
+	// ----------------------------
+	// DRAW THE SCENE FILE PARTS
+	// ----------------------------
+	SubmitSceneParts();
+
+	// ----------------------------
+	// RENDER THE SORTED PASSES
+	// ----------------------------
+	// the main camera orders the shadow casters, the views cull
+	// against bounds computed once for all of them
+	m_renderQueue.Sort(m_viewMatrix);
+	m_renderQueue.UpdateBounds();
+
+	// without views set, the main camera fills the target
+	GLint targetViewport[4];
+	glGetIntegerv(GL_VIEWPORT, targetViewport);
+	RENDER_VIEW mainView;
+	const RENDER_VIEW* pViews = &mainView;
+	int viewCount = 1;
+	if (m_views.empty())
+	{
+		mainView.view = m_viewMatrix;
+		mainView.projection = m_projectionMatrix;
+		mainView.viewport = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+	}
+	else
+	{
+		pViews = m_views.data();
+		viewCount = (int)m_views.size();
+	}
+	bool bTogether = (viewCount > 1) && (true == m_bMultiviewEnabled) && (NULL != m_pMultiviewPass);
+
+	// the CPU rasterizer has the images, nothing is streamed
+	if ((RENDER_BACKEND_SOFTWARE == m_renderBackend) && (NULL != m_pSoftwareRasterizer))
+	{
+		RenderViewsSoftware(pViews, viewCount, targetViewport, false);
+		return;
+	}
+
+	// stream the texture levels the views need
+	for (int v = 0; v < viewCount; v++)
+	{
+		RequestTextureFootprints(pViews[v], pViews[v].viewport.w * (float)targetViewport[3]);
+	}
+	m_pTextureStreamer->Update(m_frameArena);
+
+	// the terrain levels follow the main camera, like the
+	// shadow cascades, and stand where the floor was
+	if (NULL != m_pTerrainClipmap)
+	{
+		if (NULL != m_pFrameStats)
+			m_pFrameStats->BeginSection(m_terrainSectionID);
+
+		m_pTerrainClipmap->SetPlacement(glm::vec3(m_terrainCommand.model[3]),
+			2.0f * glm::length(glm::vec3(m_terrainCommand.model[0])));
+		m_pTerrainClipmap->Update(glm::vec3(glm::inverse(m_viewMatrix)[3]));
+
+		if (NULL != m_pFrameStats)
+			m_pFrameStats->EndSection(m_terrainSectionID);
+	}
+
+	// the trails take the newest positions of the drones, with
+	// the strides picked from the main camera
+	if (NULL != m_pTrailRenderer)
+	{
+		if (NULL != m_pFrameStats)
+			m_pFrameStats->BeginSection(m_trailSectionID);
+
+		m_pTrailRenderer->Update(GetDroneTransforms(), m_animationSeconds,
+			glm::vec3(glm::inverse(m_viewMatrix)[3]));
+
+		if (NULL != m_pFrameStats)
+			m_pFrameStats->EndSection(m_trailSectionID);
+	}
+
+	// the shadow maps are shared by all the views, the cascades
+	// follow the main camera
+	if (NULL != m_pShadowManager)
+	{
+		if (NULL != m_pFrameStats)
+			m_pFrameStats->BeginSection(m_shadowSectionID);
+
+		glm::vec3 cameraPosition = glm::vec3(glm::inverse(m_viewMatrix)[3]);
+		m_pShadowManager->Update(m_renderQueue, cameraPosition,
+			[this](const DRAW_COMMAND& command) { DrawBasicMesh(command.mesh); });
+
+		if (NULL != m_pFrameStats)
+			m_pFrameStats->EndSection(m_shadowSectionID);
+
+		if (bTogether)
+		{
+			GLTrace::UseProgram(m_pMultiviewPass->GetShader());
+			m_pShadowManager->ApplyToShader(m_pMultiviewPass->GetShader());
+		}
+		if (NULL != m_pTerrainClipmap)
+		{
+			GLTrace::UseProgram(m_pTerrainClipmap->GetShader());
+			m_pShadowManager->ApplyToShader(m_pTerrainClipmap->GetShader());
+		}
+		GLTrace::UseProgram(m_pShaderManager);
+		m_pShadowManager->ApplyToShader(m_pShaderManager);
+	}
+
+	if ((NULL != m_pLightmapAtlas) && (0 != m_pLightmapAtlas->GetTexture()))
+	{
+		GLTrace::ActiveTexture(GL_TEXTURE0 + LightmapAtlas::TEXTURE_UNIT);
+		GLTrace::BindTexture(GL_TEXTURE_2D, m_pLightmapAtlas->GetTexture());
+		GLTrace::ActiveTexture(GL_TEXTURE0);
+	}
+
+	if (bTogether)
+	{
+		RenderViewsTogether(pViews, viewCount, targetViewport);
+	}
+	else
+	{
+		RenderViewsSeparately(pViews, viewCount, targetViewport);
+	}
+
+	// the OpenGL textures only match the decoded images once
+	// all their levels are streamed in
+	if ((m_verifyTolerance >= 0.0f) && (NULL != m_pSoftwareRasterizer) && !m_pTextureStreamer->IsStreaming())
+	{
+		RenderViewsSoftware(pViews, viewCount, targetViewport, true);
+	}
+
+	// restore the default depth state for the next clear
+	GLTrace::DepthMask(GL_TRUE);
+	GLTrace::DepthFunc(GL_LESS);
+}
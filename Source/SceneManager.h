@@ -11,6 +11,24 @@
 
 #include "ShaderManager.h"
 #include "ShapeMeshes.h"
+#include "RenderQueue.h"
+#include "ShadowManager.h"
+#include "FrameStats.h"
+#include "TextureStreamer.h"
+#include "SceneFile.h"
+#include "TelemetryPlayback.h"
+#include "TelemetryIngest.h"
+#include "SwarmSimulation.h"
+#include "AnimationManager.h"
+#include "MultiviewPass.h"
+#include "SoftwareRasterizer.h"
+#include "GLTrace.h"
+#include "HotReload.h"
+#include "ModelMeshes.h"
+#include "StaticBatches.h"
+#include "LightmapAtlas.h"
+#include "TerrainClipmap.h"
+#include "TrailRenderer.h"
 
 #include <string>
 #include <vector>
@@ -45,6 +63,24 @@ public:
 		std::string tag;
 	};
 
+	struct LIGHT_SOURCE
+	{
+		glm::vec3 position;
+		glm::vec3 ambientColor;
+		glm::vec3 diffuseColor;
+		glm::vec3 specularColor;
+		float focalStrength;
+		float specularIntensity;
+		bool bCastShadows;
+	};
+
+	// what draws the render queue
+	enum RENDER_BACKEND
+	{
+		RENDER_BACKEND_OPENGL = 0,
+		RENDER_BACKEND_SOFTWARE
+	};
+
 private:
 
 
@@ -54,24 +90,115 @@ private:
 	ShaderManager* m_pShaderManager;
 	// pointer to basic shapes object
 	ShapeMeshes* m_basicMeshes;
+	// pointer to the models loaded from model files, and the
+	// model index of each model record of the scene file
+	ModelMeshes* m_pModelMeshes;
+	std::vector<int> m_sceneModelIndices;
+	// pointer to the merged parts that never move apart, NULL
+	// when every part is drawn on its own
+	StaticBatches* m_pStaticBatches;
+	bool m_bStaticBatching;
+	// pointer to the baked light of the static parts, NULL when
+	// they are lit every frame, and the lightmaps of a reloaded
+	// scene file waiting for their texture
+	LightmapAtlas* m_pLightmapAtlas;
+	LightmapAtlas* m_pReloadedLightmapAtlas;
+	bool m_bLightmaps;
 	// total number of loaded textures
 	int m_loadedTextures;
 	// loaded textures info
 	TEXTURE_INFO m_textureIDs[16];
 	// defined object materials
 	std::vector<OBJECT_MATERIAL> m_objectMaterials;
+	// draw commands collected for the current frame
+	RenderQueue m_renderQueue;
+	// draw state applied to the next submitted mesh
+	DRAW_COMMAND m_pendingCommand;
+	// pointer to the shader used for the depth-only pre-pass
+	ShaderManager* m_pDepthShaderManager;
+	// true when a depth pre-pass is drawn before the opaque pass
+	bool m_bDepthPrepass;
+	// camera transforms for the current frame
+	glm::mat4 m_viewMatrix;
+	glm::mat4 m_projectionMatrix;
+	// defined light sources, index 0 is the key light
+	std::vector<LIGHT_SOURCE> m_lightSources;
+	// pointer to the shadow map manager object
+	ShadowManager* m_pShadowManager;
+	// pointer to the frame statistics object
+	FrameStats* m_pFrameStats;
+	int m_shadowSectionID;
+	// pointer to the texture streaming object
+	TextureStreamer* m_pTextureStreamer;
+	// scratch memory of the frame, reset by RenderScene()
+	FrameArena m_frameArena;
+	// mapped scene file and the texture IDs of its textures
+	std::string m_sceneFilename;
+	SceneFile* m_pSceneFile;
+	std::vector<int> m_sceneTextureIDs;
+	// pointer to the object reloading changed assets, and the
+	// files of the main shader it watches
+	HotReload* m_pHotReload;
+	std::string m_vertexShaderFilename;
+	std::string m_fragmentShaderFilename;
+	// scene file loaded again by the watcher thread, waiting to
+	// replace the mapped one, and the reloads done so far
+	SceneFile* m_pReloadedSceneFile;
+	int m_sceneReloadCount;
+	// pointer to the flight telemetry playback object
+	TelemetryPlayback* m_pTelemetryPlayback;
+	// pointer to the live telemetry ingest object
+	TelemetryIngest* m_pTelemetryIngest;
+	// pointer to the swarm simulation object
+	SwarmSimulation* m_pSwarmSimulation;
+	// pointer to the part animation object
+	AnimationManager* m_pAnimationManager;
+	// views drawn by RenderScene(), the main camera alone when
+	// no views are set, and the commands visible in each
+	std::vector<RENDER_VIEW> m_views;
+	std::vector<VIEW_ORDER> m_viewOrders;
+	// pointer to the object drawing several views in one pass
+	MultiviewPass* m_pMultiviewPass;
+	bool m_bMultiviewEnabled;
+	// shadow maps are drawn by the OpenGL backend when enabled
+	bool m_bShadowsEnabled;
+	bool m_bVerifyShadows;
+	// pointer to the CPU rasterizer, when it draws the scene or
+	// checks what OpenGL drew
+	RENDER_BACKEND m_renderBackend;
+	SoftwareRasterizer* m_pSoftwareRasterizer;
+	int m_rasterThreadCount;
+	// largest mean color error allowed, negative when the CPU
+	// rasterizer does not check the OpenGL frames
+	float m_verifyTolerance;
+	bool m_bVerificationFailed;
+	// pointer to the streamed terrain drawn in place of the
+	// floor parts, the file it is read from, and the state of
+	// the floor part it takes its texture and material from
+	TerrainClipmap* m_pTerrainClipmap;
+	std::string m_terrainFilename;
+	DRAW_COMMAND m_terrainCommand;
+	int m_terrainSectionID;
+	// pointer to the flight path trails of the drones, the
+	// samples kept per drone, 0 for none, and the time of the
+	// frame they are sampled at
+	TrailRenderer* m_pTrailRenderer;
+	int m_trailSampleCount;
+	int m_trailSectionID;
+	double m_animationSeconds;
 
 	// load texture images and convert to OpenGL texture data
-	bool CreateGLTexture(const char* filename, std::string tag);
+	bool CreateGLTexture(const char* filename, const char* tag);
 	// bind loaded OpenGL textures to slots in memory
 	void BindGLTextures();
 	// free the loaded OpenGL textures
 	void DestroyGLTextures();
 	// find a loaded texture by tag
-	int FindTextureID(std::string tag);
-	int FindTextureSlot(std::string tag);
+	int FindTextureID(const char* tag) const;
+	int FindTextureSlot(const char* tag) const;
 	// find a defined material by tag
-	bool FindMaterial(std::string tag, OBJECT_MATERIAL& material);
+	bool FindMaterial(const char* tag, OBJECT_MATERIAL& material) const;
+	int FindMaterialIndex(const char* tag) const;
 
 	// set the transformation values 
 	// into the transform buffer
@@ -89,17 +216,94 @@ private:
 		float blueColorValue,
 		float alphaValue);
 
-	// set the texture data into the shader
+	// set the texture data into the shader, by tag or by the
+	// ID FindTextureID() returned, which needs no search
 	void SetShaderTexture(
-		std::string textureTag);
+		const char* textureTag);
+	void SetShaderTextureID(int textureID);
 
 	// set the UV scale for the texture mapping
 	void SetTextureUVScale(
 		float u, float v);
 
-	// set the object material into the shader
+	// set the object material into the shader, by tag or by
+	// the index FindMaterialIndex() returned
 	void SetShaderMaterial(
-		std::string materialTag);
+		const char* materialTag);
+	void SetShaderMaterialIndex(int materialIndex);
+
+	// mark the following meshes as moving or static objects
+	void SetDynamicObject(bool bDynamic);
+
+	// define a light source and pass it into the shader
+	void SetLightSource(int index, const LIGHT_SOURCE& light);
+	// pass a light source into a bound shader
+	void ApplyLightSource(ShaderManager* pShader, int index, const LIGHT_SOURCE& light);
+	// point the shadow samplers of a bound shader at their units
+	void ApplyShadowSamplers(ShaderManager* pShader);
+	// pass the lights, shadow samplers and view position into a
+	// bound lighting shader
+	void ApplyLightingState(ShaderManager* pShader);
+	// create the shadow maps of the shadow casting lights
+	void PrepareShadows();
+	// load the shaders that draw several views in one pass
+	void PrepareMultiview();
+	// start the CPU rasterizer for the backend or verification
+	void PrepareSoftwareRasterizer();
+	// open the terrain file and load the terrain shader
+	void PrepareTerrain();
+	// create the trail renderer and load the trail shader
+	void PrepareTrails();
+	// load or bake the lightmaps of the static parts
+	void PrepareLightmaps();
+	// create the textures, materials and lights of the scene file
+	bool LoadSceneFile();
+	void ApplySceneFile();
+	// watch the shaders, textures and scene file for changes
+	void WatchAssets();
+	// load the changed scene file on the watcher thread and
+	// swap it in on the render thread
+	bool PrepareSceneReload();
+	void SwapSceneFile();
+	// transforms of the drones from the live telemetry, the
+	// swarm or the replayed log, NULL when there are none
+	const std::vector<glm::mat4>* GetDroneTransforms() const;
+	// submit the parts of the scene file to the render queue
+	void SubmitSceneParts();
+	// fill a command with the state of a part, false when the
+	// part is not drawn
+	bool GetPartCommand(const SCENE_PART_RECORD& part, DRAW_COMMAND& command) const;
+	// submit a part command, once per drone for the drone group
+	void SubmitPartCommand(
+		DRAW_COMMAND& command,
+		uint32_t group,
+		const std::vector<glm::mat4>* pDroneTransforms);
+
+	// submit the mesh with the current draw state
+	void DrawMesh(MESH_TYPE mesh);
+	// draw one of the loaded basic meshes or models
+	void DrawBasicMesh(MESH_TYPE mesh);
+	// set the shader values of a command and draw it
+	void ExecuteDrawCommand(ShaderManager* pShader, const DRAW_COMMAND& command);
+	// set the texture, color and material of a command
+	void ApplyCommandState(ShaderManager* pShader, const DRAW_COMMAND& command);
+	// report the screen footprint of the textured commands in
+	// a view that is the given number of pixels high
+	void RequestTextureFootprints(const RENDER_VIEW& view, float viewportHeight);
+	// draw the views one at a time or together in one pass
+	void RenderViewsSeparately(const RENDER_VIEW* pViews, int viewCount, const GLint targetViewport[4]);
+	void RenderViewsTogether(const RENDER_VIEW* pViews, int viewCount, const GLint targetViewport[4]);
+	// draw the visible commands in separate sorted passes
+	void RenderDepthPrepass(ShaderManager* pDepthShader, const VIEW_ORDER& order);
+	void RenderOpaquePass(ShaderManager* pShader, const VIEW_ORDER& order);
+	void RenderTransparentPass(ShaderManager* pShader, const VIEW_ORDER& order);
+	// draw the terrain for a view into the bound viewport
+	void RenderTerrain(const RENDER_VIEW& view);
+	// draw the drone trails for a view into the bound viewport
+	void RenderTrails(const RENDER_VIEW& view, const GLint viewport[4]);
+	// draw the views on the CPU and copy them into the target,
+	// or compare them with what OpenGL drew there
+	void RenderViewsSoftware(const RENDER_VIEW* pViews, int viewCount, const GLint targetViewport[4], bool bVerify);
 
 public:
 
@@ -107,6 +311,83 @@ public:
 	// customize for their own 3D scene
 	void PrepareScene();
 	void RenderScene();
-	void RenderDrone();
+
+	// set the scene file loaded by PrepareScene()
+	void SetSceneFile(const std::string& filename);
+	// set the telemetry playback that places the drones
+	void SetTelemetryPlayback(TelemetryPlayback* pTelemetryPlayback);
+	// set the live telemetry that places the drones
+	void SetTelemetryIngest(TelemetryIngest* pTelemetryIngest);
+	// set the swarm simulation that places the drones
+	void SetSwarmSimulation(SwarmSimulation* pSwarmSimulation);
+	// draw the terrain of a cooked terrain file in place of the
+	// floor, before PrepareScene()
+	void SetTerrainFile(const std::string& filename);
+	// the streamed terrain, NULL when there is none
+	const TerrainClipmap* GetTerrainClipmap() const { return m_pTerrainClipmap; }
+	// draw a trail of the given number of samples behind each
+	// drone, 0 for none, before PrepareScene()
+	void SetTrailLength(int sampleCount);
+	// the drone trails, NULL when there are none
+	const TrailRenderer* GetTrailRenderer() const { return m_pTrailRenderer; }
+
+	// set the camera transforms used for sorting and the pre-pass
+	void SetViewTransform(
+		const glm::mat4& view,
+		const glm::mat4& projection);
+	// set the views drawn each frame, none for the main camera
+	// filling the window
+	void SetRenderViews(const std::vector<RENDER_VIEW>& views);
+	// allow views to be drawn together in one pass
+	void SetMultiviewEnabled(bool bEnabled);
+	// merge the parts that never move apart, before PrepareScene()
+	void SetStaticBatchingEnabled(bool bEnabled);
+	// draw the static batches with baked lightmaps, before
+	// PrepareScene()
+	void SetLightmapsEnabled(bool bEnabled);
+	// bake the lightmaps of a scene file into its baked file
+	// and return, 0 threads for one per hardware thread
+	static bool BakeLightmaps(const std::string& sceneFilename, int threadCount);
+	// world transform of a drone placed by the telemetry, or
+	// the identity when the drone is drawn where the scene is
+	glm::mat4 GetDroneTransform(int drone) const;
+	// draw the scene with OpenGL or the CPU rasterizer, with
+	// the given worker threads, 0 for one per hardware thread
+	void SetRenderBackend(RENDER_BACKEND backend, int threadCount);
+	// draw every frame on the CPU too and compare, failing when
+	// the mean color error is above the tolerance
+	void SetSoftwareVerification(float tolerance, int threadCount);
+	// true when a verified frame was off by more than allowed
+	bool HasVerificationFailed() const { return m_bVerificationFailed; }
+	// enable or disable the shadow maps, before PrepareScene()
+	void SetShadowsEnabled(bool bEnabled);
+	// redraw the shadow maps from scratch every frame and fail
+	// when the cached ones differ, before PrepareScene()
+	void SetShadowVerification(bool bVerify);
+	// true when a cached shadow map differed from the redrawn one
+	bool HasShadowVerificationFailed() const
+	{ return (NULL != m_pShadowManager) && m_pShadowManager->HasVerificationFailed(); }
+	// enable or disable the depth-only pre-pass
+	void SetDepthPrepassEnabled(bool bEnabled);
+	// set the object that collects the frame timings
+	void SetFrameStats(FrameStats* pFrameStats);
+	// set the GPU memory the streamed textures may use
+	void SetTextureMemoryBudget(size_t budgetBytes);
+	// set the time the part animations are shown at
+	void SetAnimationTime(double seconds);
+	// reload the shaders, textures and scene file when their
+	// files change, with the files of the main shader, before
+	// PrepareScene()
+	void EnableHotReload(const char* vertexFilename, const char* fragmentFilename);
+	// true while the scene changes without outside input, such
+	// as textures still streaming in
+	bool NeedsRedraw() const;
+	// draw commands submitted for the last frame, and how many
+	// the views drew after culling, once per view they are in
+	int GetSubmittedDrawCount() const { return (int)m_renderQueue.GetCommands().size(); }
+	int GetVisibleDrawCount() const;
+	// views or groups of views culled separately last frame,
+	// each of which could keep all the submitted draws
+	int GetViewOrderCount() const { return (int)m_viewOrders.size(); }
 
 };
\ No newline at end of file
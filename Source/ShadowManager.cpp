@@ -0,0 +1,1059 @@
+///////////////////////////////////////////////////////////////////////////////
+// shadowmanager.cpp
+// ============
+// manage the cached shadow maps of the scene lights
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShadowManager.h"
+#include "AnimationManager.h"
+#include "GLTrace.h"
+#include "ResourceTracker.h"
+
+#include <glm/gtx/transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	const int g_CascadeResolution = 1024;
+	const int g_CubeResolution = 512;
+	// owner of the shadow maps in the resource tracker
+	const char* const g_TrackerName = "shadows";
+	// radius around the camera covered by each cascade
+	const float g_CascadeRadius[ShadowManager::TOTAL_CASCADES] = { 6.0f, 18.0f, 54.0f };
+	// distance covered toward and away from the key light
+	const float g_CascadeDepthRange = 60.0f;
+	// range of the point light cube maps
+	const float g_PointShadowNear = 0.05f;
+	const float g_PointShadowFar = 40.0f;
+
+	// view direction and up vector of each cube map face
+	const glm::vec3 g_CubeFaceDirections[6] = {
+		glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f),
+		glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+		glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f) };
+	const glm::vec3 g_CubeFaceUps[6] = {
+		glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+		glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f),
+		glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f) };
+
+	// FNV-1a hash of a block of memory
+	size_t HashBytes(size_t hash, const void* data, size_t size)
+	{
+		const unsigned char* bytes = (const unsigned char*)data;
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= (size_t)1099511628211ULL;
+		}
+		return(hash);
+	}
+}
+
+/***********************************************************
+ *  ShadowManager()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ShadowManager::ShadowManager()
+{
+	m_bInitialized = false;
+	m_pDirectionalShader = NULL;
+	m_pPointShader = NULL;
+	m_framebuffer = 0;
+	m_keyLightDirection = glm::vec3(0.0f, -1.0f, 0.0f);
+	m_staticCascades = 0;
+	m_compositeCascades = 0;
+	for (int i = 0; i < TOTAL_CASCADES; i++)
+	{
+		// far away so the first update builds the matrices
+		m_cascadeCenters[i] = glm::vec3(1.0e30f);
+		m_cascadeMatrices[i] = glm::mat4(1.0f);
+		m_bCascadeValid[i] = false;
+		m_cascadeMatrixNames[i] = GLTrace::RegisterName(
+			("cascadeMatrices[" + std::to_string(i) + "]").c_str());
+	}
+	m_staticSignature = 0;
+	m_updateInfo.staticLayersRendered = 0;
+	m_updateInfo.dynamicRegionsRendered = 0;
+	m_updateInfo.dynamicCastersDrawn = 0;
+	m_bVerifyCache = false;
+	m_bVerificationFailed = false;
+	m_referenceCascades = 0;
+	m_referenceCubeMap = 0;
+}
+
+/***********************************************************
+ *  ~ShadowManager()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ShadowManager::~ShadowManager()
+{
+	for (size_t i = 0; i < m_pointShadows.size(); i++)
+	{
+		DeleteTexture(m_pointShadows[i].staticCubeMap);
+		DeleteTexture(m_pointShadows[i].compositeCubeMap);
+	}
+	m_pointShadows.clear();
+
+	if (m_bInitialized)
+	{
+		DeleteTexture(m_staticCascades);
+		DeleteTexture(m_compositeCascades);
+		glDeleteFramebuffers(1, &m_framebuffer);
+	}
+	if (0 != m_referenceCascades)
+	{
+		DeleteTexture(m_referenceCascades);
+	}
+	if (0 != m_referenceCubeMap)
+	{
+		DeleteTexture(m_referenceCubeMap);
+	}
+	if (NULL != m_pDirectionalShader)
+	{
+		ResourceTracker::Release(RESOURCE_PROGRAM, m_pDirectionalShader->m_programID);
+		delete m_pDirectionalShader;
+		m_pDirectionalShader = NULL;
+	}
+	if (NULL != m_pPointShader)
+	{
+		ResourceTracker::Release(RESOURCE_PROGRAM, m_pPointShader->m_programID);
+		delete m_pPointShader;
+		m_pPointShader = NULL;
+	}
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for creating the shadow map shaders,
+ *  the cascade textures and the framebuffer used to render
+ *  into them.
+ ***********************************************************/
+bool ShadowManager::Initialize()
+{
+	// the cached layers are composited with texture copies
+	if (!GLEW_VERSION_4_3 && !GLEW_ARB_copy_image)
+	{
+		std::cout << "Shadow maps disabled: texture copies are not supported" << std::endl;
+		return false;
+	}
+
+	m_pDirectionalShader = new ShaderManager();
+	m_pDirectionalShader->LoadShaders(
+		"depthVertexShader.glsl",
+		"depthFragmentShader.glsl");
+	m_pPointShader = new ShaderManager();
+	m_pPointShader->LoadShaders(
+		"shadowPointVertexShader.glsl",
+		"shadowPointFragmentShader.glsl");
+	ResourceTracker::TrackProgram(m_pDirectionalShader->m_programID, g_TrackerName, "depthVertexShader.glsl");
+	ResourceTracker::TrackProgram(m_pPointShader->m_programID, g_TrackerName, "shadowPointVertexShader.glsl");
+	// animated parts cast their shadows where they are drawn
+	AnimationManager::BindShader(m_pDirectionalShader);
+	AnimationManager::BindShader(m_pPointShader);
+
+	// the shadow framebuffer only ever has a depth attachment
+	glGenFramebuffers(1, &m_framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	m_staticCascades = CreateCascadeTexture("static cascades");
+	m_compositeCascades = CreateCascadeTexture("composite cascades");
+
+	m_bInitialized = true;
+	InvalidateStatic();
+
+	return true;
+}
+
+/***********************************************************
+ *  CreateCascadeTexture()
+ *
+ *  This method is used for creating a depth texture array
+ *  with one layer per cascade and hardware depth compare.
+ ***********************************************************/
+GLuint ShadowManager::CreateCascadeTexture(const char* asset)
+{
+	GLuint textureID = 0;
+
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, textureID);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24,
+		g_CascadeResolution, g_CascadeResolution, TOTAL_CASCADES,
+		0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	ResourceTracker::Track(RESOURCE_RENDER_TARGET, textureID, g_TrackerName, asset,
+		ResourceTracker::GetImageBytes(GL_DEPTH_COMPONENT24, g_CascadeResolution, g_CascadeResolution, TOTAL_CASCADES));
+	return(textureID);
+}
+
+/***********************************************************
+ *  CreateCubeTexture()
+ *
+ *  This method is used for creating a depth cube map that
+ *  holds the linear distance to a point light.
+ ***********************************************************/
+GLuint ShadowManager::CreateCubeTexture(const char* asset)
+{
+	GLuint textureID = 0;
+
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+	for (int face = 0; face < 6; face++)
+	{
+		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, GL_DEPTH_COMPONENT24,
+			g_CubeResolution, g_CubeResolution, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+	}
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+	ResourceTracker::Track(RESOURCE_RENDER_TARGET, textureID, g_TrackerName, asset,
+		ResourceTracker::GetImageBytes(GL_DEPTH_COMPONENT24, g_CubeResolution, g_CubeResolution, 6));
+	return(textureID);
+}
+
+/***********************************************************
+ *  DeleteTexture()
+ *
+ *  This method is used for freeing a shadow map texture and
+ *  its record in the resource tracker.
+ ***********************************************************/
+void ShadowManager::DeleteTexture(GLuint& textureID)
+{
+	ResourceTracker::Release(RESOURCE_RENDER_TARGET, textureID);
+	glDeleteTextures(1, &textureID);
+	textureID = 0;
+}
+
+/***********************************************************
+ *  WatchShaders()
+ *
+ *  This method is used for having the shadow shaders rebuilt
+ *  when their files change.  The static layers were drawn
+ *  with the old shaders, so they are drawn again.
+ ***********************************************************/
+void ShadowManager::WatchShaders(HotReload* pHotReload)
+{
+	HotReload::ProgramFunc onReload = [this](ShaderManager* pShader)
+	{
+		AnimationManager::BindShader(pShader);
+		InvalidateStatic();
+	};
+
+	pHotReload->WatchProgram(m_pDirectionalShader,
+		"depthVertexShader.glsl", NULL, "depthFragmentShader.glsl", g_TrackerName, onReload);
+	pHotReload->WatchProgram(m_pPointShader,
+		"shadowPointVertexShader.glsl", NULL, "shadowPointFragmentShader.glsl", g_TrackerName, onReload);
+}
+
+/***********************************************************
+ *  SetKeyLightDirection()
+ *
+ *  This method is used for setting the direction the key
+ *  light shines in.  The cascades are redrawn.
+ ***********************************************************/
+void ShadowManager::SetKeyLightDirection(const glm::vec3& direction)
+{
+	m_keyLightDirection = glm::normalize(direction);
+	for (int i = 0; i < TOTAL_CASCADES; i++)
+	{
+		m_bCascadeValid[i] = false;
+		// force the cascade matrices to be rebuilt
+		m_cascadeCenters[i] = glm::vec3(1.0e30f);
+	}
+}
+
+/***********************************************************
+ *  AddPointLight()
+ *
+ *  This method is used for adding a point light that casts
+ *  shadows.  The returned index selects its cube map in
+ *  the lighting shader, or -1 when none are left.
+ ***********************************************************/
+int ShadowManager::AddPointLight(int lightIndex, const glm::vec3& position)
+{
+	if (!m_bInitialized || (m_pointShadows.size() >= MAX_POINT_SHADOWS))
+	{
+		return(-1);
+	}
+
+	POINT_SHADOW pointShadow;
+	pointShadow.lightIndex = lightIndex;
+	pointShadow.shadowMapName = GLTrace::RegisterName(
+		("lightShadowMaps[" + std::to_string(lightIndex) + "]").c_str());
+	pointShadow.position = position;
+	pointShadow.staticCubeMap = CreateCubeTexture("static point light cube map");
+	pointShadow.compositeCubeMap = CreateCubeTexture("composite point light cube map");
+	pointShadow.bStaticValid = false;
+	m_pointShadows.push_back(pointShadow);
+
+	return((int)m_pointShadows.size() - 1);
+}
+
+/***********************************************************
+ *  InvalidateStatic()
+ *
+ *  This method is used for forcing every static layer to be
+ *  redrawn, for example after the static scene changed.
+ ***********************************************************/
+void ShadowManager::InvalidateStatic()
+{
+	for (int i = 0; i < TOTAL_CASCADES; i++)
+	{
+		m_bCascadeValid[i] = false;
+	}
+	for (size_t i = 0; i < m_pointShadows.size(); i++)
+	{
+		m_pointShadows[i].bStaticValid = false;
+	}
+}
+
+/***********************************************************
+ *  UpdateCascades()
+ *
+ *  This method is used for placing the cascades around the
+ *  camera.  A cascade only moves when the camera has left
+ *  half of its radius, so its static layer stays cached
+ *  while the camera moves and rotates inside it.
+ ***********************************************************/
+void ShadowManager::UpdateCascades(const glm::vec3& cameraPosition)
+{
+	glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
+	if (std::fabs(m_keyLightDirection.y) > 0.99f)
+	{
+		up = glm::vec3(0.0f, 0.0f, 1.0f);
+	}
+	glm::mat4 lightRotation = glm::lookAt(glm::vec3(0.0f), m_keyLightDirection, up);
+	glm::mat4 inverseRotation = glm::inverse(lightRotation);
+	glm::vec3 lightSpaceCamera = glm::vec3(lightRotation * glm::vec4(cameraPosition, 1.0f));
+
+	for (int i = 0; i < TOTAL_CASCADES; i++)
+	{
+		// snap the center to a grid of half the cascade radius
+		float step = g_CascadeRadius[i] * 0.5f;
+		glm::vec3 snapped = glm::floor(lightSpaceCamera / step + 0.5f) * step;
+		glm::vec3 center = glm::vec3(inverseRotation * glm::vec4(snapped, 1.0f));
+
+		if (glm::length(center - m_cascadeCenters[i]) < step * 0.01f)
+		{
+			continue;
+		}
+
+		// grow the covered area by the snap step so the camera
+		// stays covered anywhere inside the grid cell
+		float extent = g_CascadeRadius[i] + step;
+		glm::mat4 view = glm::lookAt(
+			center - m_keyLightDirection * g_CascadeDepthRange,
+			center,
+			up);
+		glm::mat4 projection = glm::ortho(
+			-extent, extent, -extent, extent,
+			0.0f, g_CascadeDepthRange * 2.0f);
+
+		m_cascadeCenters[i] = center;
+		m_cascadeMatrices[i] = projection * view;
+		m_bCascadeValid[i] = false;
+	}
+}
+
+/***********************************************************
+ *  GetCubeFaceMatrix()
+ *
+ *  This method is used for getting the view projection
+ *  matrix of one face of a point light cube map.
+ ***********************************************************/
+glm::mat4 ShadowManager::GetCubeFaceMatrix(const glm::vec3& position, int face) const
+{
+	glm::mat4 projection = glm::perspective(
+		glm::radians(90.0f), 1.0f, g_PointShadowNear, g_PointShadowFar);
+	glm::mat4 view = glm::lookAt(
+		position,
+		position + g_CubeFaceDirections[face],
+		g_CubeFaceUps[face]);
+
+	return(projection * view);
+}
+
+/***********************************************************
+ *  GetDirtyRect()
+ *
+ *  This method is used for projecting a world space box
+ *  into a shadow map and getting the covered texel area.
+ *  It returns false when the box is outside the map.
+ ***********************************************************/
+bool ShadowManager::GetDirtyRect(
+	const glm::mat4& viewProjection,
+	const glm::vec3& minXYZ,
+	const glm::vec3& maxXYZ,
+	int resolution,
+	bool bPerspective,
+	glm::ivec4& rect) const
+{
+	glm::vec2 ndcMin = glm::vec2(1.0e30f);
+	glm::vec2 ndcMax = glm::vec2(-1.0e30f);
+	int behindCount = 0;
+	bool bInRange = false;
+
+	for (int corner = 0; corner < 8; corner++)
+	{
+		glm::vec3 point = glm::vec3(
+			(corner & 1) ? maxXYZ.x : minXYZ.x,
+			(corner & 2) ? maxXYZ.y : minXYZ.y,
+			(corner & 4) ? maxXYZ.z : minXYZ.z);
+		glm::vec4 clip = viewProjection * glm::vec4(point, 1.0f);
+
+		if (bPerspective && (clip.w <= g_PointShadowNear))
+		{
+			behindCount++;
+			continue;
+		}
+		glm::vec3 ndc = glm::vec3(clip) / clip.w;
+		ndcMin = glm::min(ndcMin, glm::vec2(ndc.x, ndc.y));
+		ndcMax = glm::max(ndcMax, glm::vec2(ndc.x, ndc.y));
+		if (ndc.z <= 1.0f)
+		{
+			bInRange = true;
+		}
+	}
+
+	if (behindCount == 8)
+	{
+		return false;
+	}
+	if (behindCount > 0)
+	{
+		// the box crosses the light position, redraw the whole face
+		rect = glm::ivec4(0, 0, resolution, resolution);
+		return true;
+	}
+	if (!bInRange ||
+		(ndcMax.x < -1.0f) || (ndcMin.x > 1.0f) ||
+		(ndcMax.y < -1.0f) || (ndcMin.y > 1.0f))
+	{
+		return false;
+	}
+
+	// convert to texels with a small border for the filtering
+	int x0 = (int)std::floor((ndcMin.x * 0.5f + 0.5f) * resolution) - 2;
+	int y0 = (int)std::floor((ndcMin.y * 0.5f + 0.5f) * resolution) - 2;
+	int x1 = (int)std::ceil((ndcMax.x * 0.5f + 0.5f) * resolution) + 2;
+	int y1 = (int)std::ceil((ndcMax.y * 0.5f + 0.5f) * resolution) + 2;
+	x0 = glm::clamp(x0, 0, resolution);
+	y0 = glm::clamp(y0, 0, resolution);
+	x1 = glm::clamp(x1, 0, resolution);
+	y1 = glm::clamp(y1, 0, resolution);
+	if ((x1 <= x0) || (y1 <= y0))
+	{
+		return false;
+	}
+
+	rect = glm::ivec4(x0, y0, x1 - x0, y1 - y0);
+	return true;
+}
+
+/***********************************************************
+ *  AttachLayer()
+ *
+ *  This method is used for attaching one layer of a depth
+ *  texture array or cube map to the shadow framebuffer.
+ ***********************************************************/
+void ShadowManager::AttachLayer(GLuint texture, int layer, int resolution)
+{
+	GLTrace::FramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture, 0, layer);
+	GLTrace::Viewport(0, 0, resolution, resolution);
+}
+
+/***********************************************************
+ *  DrawStaticCasters()
+ *
+ *  This method is used for drawing the opaque casters that
+ *  never move with the bound shadow shader.
+ ***********************************************************/
+void ShadowManager::DrawStaticCasters(
+	const RenderQueue& renderQueue,
+	ShaderManager* pShader,
+	DrawCasterFunc drawCaster)
+{
+	const std::vector<DRAW_COMMAND>& commands = renderQueue.GetCommands();
+	const std::vector<uint32_t>& opaqueOrder = renderQueue.GetOpaqueOrder();
+
+	for (size_t i = 0; i < opaqueOrder.size(); i++)
+	{
+		const DRAW_COMMAND& command = commands[opaqueOrder[i]];
+		if (!command.bDynamic)
+		{
+			GLTrace::SetMat4(pShader, "model", command.model);
+			GLTrace::SetInt(pShader, "animationIndex", command.animationIndex);
+			drawCaster(command);
+		}
+	}
+}
+
+/***********************************************************
+ *  DrawDynamicCasters()
+ *
+ *  This method is used for drawing the selected moving
+ *  casters with the bound shadow shader.  A caster is only
+ *  drawn when its box covers texels of the rect, the others
+ *  could not change a texel inside the scissor anyway.
+ ***********************************************************/
+void ShadowManager::DrawDynamicCasters(
+	const RenderQueue& renderQueue,
+	const glm::mat4& viewProjection,
+	int resolution,
+	bool bPerspective,
+	const glm::ivec4& rect,
+	ShaderManager* pShader,
+	DrawCasterFunc drawCaster)
+{
+	const std::vector<DRAW_COMMAND>& commands = renderQueue.GetCommands();
+
+	for (size_t i = 0; i < m_layerCasters.size(); i++)
+	{
+		const CASTER& caster = m_casters[m_layerCasters[i]];
+		glm::ivec4 casterRect;
+		if (!GetDirtyRect(viewProjection, caster.minXYZ, caster.maxXYZ,
+			resolution, bPerspective, casterRect))
+		{
+			continue;
+		}
+		if ((casterRect.x >= rect.x + rect.z) || (casterRect.x + casterRect.z <= rect.x) ||
+			(casterRect.y >= rect.y + rect.w) || (casterRect.y + casterRect.w <= rect.y))
+		{
+			continue;
+		}
+
+		const DRAW_COMMAND& command = commands[caster.command];
+		GLTrace::SetMat4(pShader, "model", command.model);
+		GLTrace::SetInt(pShader, "animationIndex", command.animationIndex);
+		drawCaster(command);
+		m_updateInfo.dynamicCastersDrawn++;
+	}
+}
+
+/***********************************************************
+ *  UpdateDynamicLayer()
+ *
+ *  This method is used for bringing a composite layer whose
+ *  static layer is valid up to date.  The texels covered by
+ *  the selected dirty boxes are gathered into one rect,
+ *  copied back from the static layer and redrawn with the
+ *  moving casters that reach into the rect.
+ ***********************************************************/
+void ShadowManager::UpdateDynamicLayer(
+	const RenderQueue& renderQueue,
+	GLuint staticTexture,
+	GLuint compositeTexture,
+	GLenum target,
+	int layer,
+	const glm::mat4& viewProjection,
+	int resolution,
+	bool bPerspective,
+	ShaderManager* pShader,
+	DrawCasterFunc drawCaster)
+{
+	bool bHaveRect = false;
+	glm::ivec4 rect = glm::ivec4(0, 0, 0, 0);
+	for (size_t i = 0; i < m_layerDirty.size(); i++)
+	{
+		uint32_t box = m_layerDirty[i];
+		glm::ivec4 boxRect;
+		if (!GetDirtyRect(viewProjection, m_dirtyMin[box], m_dirtyMax[box],
+			resolution, bPerspective, boxRect))
+		{
+			continue;
+		}
+		if (!bHaveRect)
+		{
+			rect = boxRect;
+			bHaveRect = true;
+			continue;
+		}
+		int x1 = std::max(rect.x + rect.z, boxRect.x + boxRect.z);
+		int y1 = std::max(rect.y + rect.w, boxRect.y + boxRect.w);
+		rect.x = std::min(rect.x, boxRect.x);
+		rect.y = std::min(rect.y, boxRect.y);
+		rect.z = x1 - rect.x;
+		rect.w = y1 - rect.y;
+	}
+	if (!bHaveRect)
+	{
+		return;
+	}
+
+	GLTrace::CopyImageSubData(
+		staticTexture, target, 0, rect.x, rect.y, layer,
+		compositeTexture, target, 0, rect.x, rect.y, layer,
+		rect.z, rect.w, 1);
+	AttachLayer(compositeTexture, layer, resolution);
+	GLTrace::Enable(GL_SCISSOR_TEST);
+	GLTrace::Scissor(rect.x, rect.y, rect.z, rect.w);
+	DrawDynamicCasters(renderQueue, viewProjection, resolution, bPerspective, rect, pShader, drawCaster);
+	GLTrace::Disable(GL_SCISSOR_TEST);
+	m_updateInfo.dynamicRegionsRendered++;
+}
+
+/***********************************************************
+ *  UpdateCasters()
+ *
+ *  This method is used for listing the moving casters of the
+ *  frame and the boxes whose shadows must be redrawn.  The
+ *  casters are matched with the previous frame by their
+ *  place in the list; a caster that moved dirties where it
+ *  is and where it was, and when the list changed every box
+ *  old and new is dirty.  An animated part turns inside a
+ *  box that stays put, so its box is dirty every frame.
+ ***********************************************************/
+void ShadowManager::UpdateCasters(const RenderQueue& renderQueue)
+{
+	const std::vector<DRAW_COMMAND>& commands = renderQueue.GetCommands();
+	const std::vector<uint32_t>& opaqueOrder = renderQueue.GetOpaqueOrder();
+	const std::vector<glm::vec3>& boundsMin = renderQueue.GetBoundsMin();
+	const std::vector<glm::vec3>& boundsMax = renderQueue.GetBoundsMax();
+	bool bHaveBounds = (boundsMin.size() == commands.size());
+
+	m_previousCasters.swap(m_casters);
+	m_casters.clear();
+	for (size_t i = 0; i < opaqueOrder.size(); i++)
+	{
+		const DRAW_COMMAND& command = commands[opaqueOrder[i]];
+		if (!command.bDynamic)
+		{
+			continue;
+		}
+
+		CASTER caster;
+		caster.command = opaqueOrder[i];
+		if (bHaveBounds)
+		{
+			caster.minXYZ = boundsMin[caster.command];
+			caster.maxXYZ = boundsMax[caster.command];
+		}
+		else
+		{
+			RenderQueue::GetWorldBounds(command, caster.minXYZ, caster.maxXYZ);
+		}
+		m_casters.push_back(caster);
+	}
+
+	m_dirtyMin.clear();
+	m_dirtyMax.clear();
+	bool bSameCasters = (m_casters.size() == m_previousCasters.size());
+	for (size_t i = 0; i < m_casters.size(); i++)
+	{
+		const CASTER& caster = m_casters[i];
+		if (bSameCasters)
+		{
+			const CASTER& previous = m_previousCasters[i];
+			bool bMoved = (previous.command != caster.command) ||
+				(previous.minXYZ != caster.minXYZ) || (previous.maxXYZ != caster.maxXYZ);
+			if (bMoved)
+			{
+				m_dirtyMin.push_back(previous.minXYZ);
+				m_dirtyMax.push_back(previous.maxXYZ);
+			}
+			else if (commands[caster.command].animationIndex < 0)
+			{
+				continue;
+			}
+		}
+		m_dirtyMin.push_back(caster.minXYZ);
+		m_dirtyMax.push_back(caster.maxXYZ);
+	}
+	if (!bSameCasters)
+	{
+		for (size_t i = 0; i < m_previousCasters.size(); i++)
+		{
+			m_dirtyMin.push_back(m_previousCasters[i].minXYZ);
+			m_dirtyMax.push_back(m_previousCasters[i].maxXYZ);
+		}
+	}
+}
+
+/***********************************************************
+ *  SelectLayerCasters()
+ *
+ *  This method is used for picking the casters and dirty
+ *  boxes the next layers are updated with.  A point light
+ *  only sees the boxes within the range of its cube map, so
+ *  the faces skip the others without projecting them.
+ ***********************************************************/
+void ShadowManager::SelectLayerCasters(bool bPointLight, const glm::vec3& lightPosition)
+{
+	m_layerCasters.clear();
+	m_layerDirty.clear();
+
+	for (size_t i = 0; i < m_casters.size(); i++)
+	{
+		const CASTER& caster = m_casters[i];
+		glm::vec3 nearest = glm::clamp(lightPosition, caster.minXYZ, caster.maxXYZ);
+		if (!bPointLight || (glm::length(nearest - lightPosition) < g_PointShadowFar))
+		{
+			m_layerCasters.push_back((uint32_t)i);
+		}
+	}
+	for (size_t i = 0; i < m_dirtyMin.size(); i++)
+	{
+		glm::vec3 nearest = glm::clamp(lightPosition, m_dirtyMin[i], m_dirtyMax[i]);
+		if (!bPointLight || (glm::length(nearest - lightPosition) < g_PointShadowFar))
+		{
+			m_layerDirty.push_back((uint32_t)i);
+		}
+	}
+}
+
+/***********************************************************
+ *  ComputeStaticSignature()
+ *
+ *  This method is used for hashing the meshes and transforms
+ *  of the static casters, so any change to the static scene
+ *  invalidates the cached layers.
+ ***********************************************************/
+size_t ShadowManager::ComputeStaticSignature(const RenderQueue& renderQueue) const
+{
+	const std::vector<DRAW_COMMAND>& commands = renderQueue.GetCommands();
+	const std::vector<uint32_t>& opaqueOrder = renderQueue.GetOpaqueOrder();
+	size_t hash = (size_t)14695981039346656037ULL;
+
+	for (size_t i = 0; i < opaqueOrder.size(); i++)
+	{
+		const DRAW_COMMAND& command = commands[opaqueOrder[i]];
+		if (!command.bDynamic)
+		{
+			hash = HashBytes(hash, &command.mesh, sizeof(command.mesh));
+			hash = HashBytes(hash, &command.model[0][0], sizeof(float) * 16);
+		}
+	}
+
+	return(hash);
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for bringing the composite shadow
+ *  maps up to date.  Static layers are only redrawn when
+ *  invalid; otherwise only the area covered by the moving
+ *  casters that changed, now and in the previous frame, is
+ *  restored from the static layer and redrawn with the
+ *  moving casters that reach into it.
+ ***********************************************************/
+void ShadowManager::Update(
+	const RenderQueue& renderQueue,
+	const glm::vec3& cameraPosition,
+	DrawCasterFunc drawCaster)
+{
+	m_updateInfo.staticLayersRendered = 0;
+	m_updateInfo.dynamicRegionsRendered = 0;
+	m_updateInfo.dynamicCastersDrawn = 0;
+
+	if (!m_bInitialized)
+	{
+		return;
+	}
+
+	size_t signature = ComputeStaticSignature(renderQueue);
+	if (signature != m_staticSignature)
+	{
+		m_staticSignature = signature;
+		InvalidateStatic();
+	}
+	UpdateCascades(cameraPosition);
+
+	UpdateCasters(renderQueue);
+
+	// save the state that is changed for the shadow passes
+	GLint viewport[4];
+	GLint previousFramebuffer = 0;
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+
+	GLTrace::BindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	GLTrace::Disable(GL_BLEND);
+	GLTrace::Enable(GL_DEPTH_TEST);
+	GLTrace::DepthMask(GL_TRUE);
+	GLTrace::DepthFunc(GL_LESS);
+	GLTrace::Enable(GL_POLYGON_OFFSET_FILL);
+	GLTrace::PolygonOffset(2.0f, 4.0f);
+
+	// ----------------------------
+	// KEY LIGHT CASCADES
+	// ----------------------------
+	const glm::ivec4 cascadeRect = glm::ivec4(0, 0, g_CascadeResolution, g_CascadeResolution);
+	SelectLayerCasters(false, glm::vec3(0.0f));
+	GLTrace::UseProgram(m_pDirectionalShader);
+	GLTrace::SetMat4(m_pDirectionalShader, "view", glm::mat4(1.0f));
+	for (int i = 0; i < TOTAL_CASCADES; i++)
+	{
+		GLTrace::SetMat4(m_pDirectionalShader, "projection", m_cascadeMatrices[i]);
+
+		if (!m_bCascadeValid[i])
+		{
+			AttachLayer(m_staticCascades, i, g_CascadeResolution);
+			GLTrace::Clear(GL_DEPTH_BUFFER_BIT);
+			DrawStaticCasters(renderQueue, m_pDirectionalShader, drawCaster);
+
+			GLTrace::CopyImageSubData(
+				m_staticCascades, GL_TEXTURE_2D_ARRAY, 0, 0, 0, i,
+				m_compositeCascades, GL_TEXTURE_2D_ARRAY, 0, 0, 0, i,
+				g_CascadeResolution, g_CascadeResolution, 1);
+			AttachLayer(m_compositeCascades, i, g_CascadeResolution);
+			DrawDynamicCasters(renderQueue, m_cascadeMatrices[i], g_CascadeResolution, false,
+				cascadeRect, m_pDirectionalShader, drawCaster);
+
+			m_bCascadeValid[i] = true;
+			m_updateInfo.staticLayersRendered++;
+		}
+		else
+		{
+			UpdateDynamicLayer(renderQueue, m_staticCascades, m_compositeCascades,
+				GL_TEXTURE_2D_ARRAY, i, m_cascadeMatrices[i], g_CascadeResolution, false,
+				m_pDirectionalShader, drawCaster);
+		}
+	}
+
+	// ----------------------------
+	// POINT LIGHT CUBE MAPS
+	// ----------------------------
+	const glm::ivec4 cubeRect = glm::ivec4(0, 0, g_CubeResolution, g_CubeResolution);
+	GLTrace::UseProgram(m_pPointShader);
+	GLTrace::SetMat4(m_pPointShader, "view", glm::mat4(1.0f));
+	GLTrace::SetFloat(m_pPointShader, "farPlane", g_PointShadowFar);
+	for (size_t i = 0; i < m_pointShadows.size(); i++)
+	{
+		POINT_SHADOW& pointShadow = m_pointShadows[i];
+		SelectLayerCasters(true, pointShadow.position);
+		if (pointShadow.bStaticValid && m_layerDirty.empty())
+		{
+			continue;
+		}
+		GLTrace::SetVec3(m_pPointShader, "lightPosition", pointShadow.position);
+
+		for (int face = 0; face < 6; face++)
+		{
+			glm::mat4 faceMatrix = GetCubeFaceMatrix(pointShadow.position, face);
+			GLTrace::SetMat4(m_pPointShader, "projection", faceMatrix);
+
+			if (!pointShadow.bStaticValid)
+			{
+				AttachLayer(pointShadow.staticCubeMap, face, g_CubeResolution);
+				GLTrace::Clear(GL_DEPTH_BUFFER_BIT);
+				DrawStaticCasters(renderQueue, m_pPointShader, drawCaster);
+
+				GLTrace::CopyImageSubData(
+					pointShadow.staticCubeMap, GL_TEXTURE_CUBE_MAP, 0, 0, 0, face,
+					pointShadow.compositeCubeMap, GL_TEXTURE_CUBE_MAP, 0, 0, 0, face,
+					g_CubeResolution, g_CubeResolution, 1);
+				AttachLayer(pointShadow.compositeCubeMap, face, g_CubeResolution);
+				DrawDynamicCasters(renderQueue, faceMatrix, g_CubeResolution, true,
+					cubeRect, m_pPointShader, drawCaster);
+
+				m_updateInfo.staticLayersRendered++;
+			}
+			else
+			{
+				UpdateDynamicLayer(renderQueue, pointShadow.staticCubeMap, pointShadow.compositeCubeMap,
+					GL_TEXTURE_CUBE_MAP, face, faceMatrix, g_CubeResolution, true,
+					m_pPointShader, drawCaster);
+			}
+		}
+		pointShadow.bStaticValid = true;
+	}
+
+	if (m_bVerifyCache)
+	{
+		VerifyCache(renderQueue, drawCaster);
+	}
+
+	// restore the state of the main passes
+	GLTrace::Disable(GL_POLYGON_OFFSET_FILL);
+	GLTrace::BindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+	GLTrace::Viewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
+
+/***********************************************************
+ *  DrawAllCasters()
+ *
+ *  This method is used for drawing every opaque caster,
+ *  static or moving, without any culling.
+ ***********************************************************/
+void ShadowManager::DrawAllCasters(
+	const RenderQueue& renderQueue,
+	ShaderManager* pShader,
+	DrawCasterFunc drawCaster)
+{
+	const std::vector<DRAW_COMMAND>& commands = renderQueue.GetCommands();
+	const std::vector<uint32_t>& opaqueOrder = renderQueue.GetOpaqueOrder();
+
+	for (size_t i = 0; i < opaqueOrder.size(); i++)
+	{
+		const DRAW_COMMAND& command = commands[opaqueOrder[i]];
+		GLTrace::SetMat4(pShader, "model", command.model);
+		GLTrace::SetInt(pShader, "animationIndex", command.animationIndex);
+		drawCaster(command);
+	}
+}
+
+/***********************************************************
+ *  CountDifferentTexels()
+ *
+ *  This method is used for reading back one image of the
+ *  cached and of the reference texture and counting the
+ *  texels whose depth is not the same.  Both are drawn the
+ *  same way, so they are expected to match exactly.
+ ***********************************************************/
+int ShadowManager::CountDifferentTexels(
+	GLenum bindTarget,
+	GLenum imageTarget,
+	GLuint cachedTexture,
+	GLuint referenceTexture,
+	size_t texelCount)
+{
+	m_cachedTexels.resize(texelCount);
+	m_referenceTexels.resize(texelCount);
+	GLTrace::BindTexture(bindTarget, cachedTexture);
+	glGetTexImage(imageTarget, 0, GL_DEPTH_COMPONENT, GL_FLOAT, m_cachedTexels.data());
+	GLTrace::BindTexture(bindTarget, referenceTexture);
+	glGetTexImage(imageTarget, 0, GL_DEPTH_COMPONENT, GL_FLOAT, m_referenceTexels.data());
+
+	int count = 0;
+	for (size_t i = 0; i < texelCount; i++)
+	{
+		if (m_cachedTexels[i] != m_referenceTexels[i])
+		{
+			count++;
+		}
+	}
+	return(count);
+}
+
+/***********************************************************
+ *  VerifyCache()
+ *
+ *  This method is used for checking the cached maps.  Every
+ *  layer is drawn again from scratch with all the casters
+ *  into a reference texture and read back with the
+ *  composite layer.  A moving or turning caster whose
+ *  shadow was left behind or cut off shows up as texels
+ *  that differ, and fails the run.
+ ***********************************************************/
+void ShadowManager::VerifyCache(const RenderQueue& renderQueue, DrawCasterFunc drawCaster)
+{
+	// the shadow units are bound again by ApplyToShader()
+	GLTrace::ActiveTexture(GL_TEXTURE0 + KEY_SHADOW_TEXTURE_UNIT);
+	if (0 == m_referenceCascades)
+	{
+		m_referenceCascades = CreateCascadeTexture("reference cascades");
+	}
+	if ((0 == m_referenceCubeMap) && !m_pointShadows.empty())
+	{
+		m_referenceCubeMap = CreateCubeTexture("reference point light cube map");
+	}
+
+	GLTrace::UseProgram(m_pDirectionalShader);
+	for (int i = 0; i < TOTAL_CASCADES; i++)
+	{
+		GLTrace::SetMat4(m_pDirectionalShader, "projection", m_cascadeMatrices[i]);
+		AttachLayer(m_referenceCascades, i, g_CascadeResolution);
+		GLTrace::Clear(GL_DEPTH_BUFFER_BIT);
+		DrawAllCasters(renderQueue, m_pDirectionalShader, drawCaster);
+	}
+
+	// the array is read back whole, all the cascades at once
+	int cascadeTexels = CountDifferentTexels(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_2D_ARRAY,
+		m_compositeCascades, m_referenceCascades,
+		(size_t)g_CascadeResolution * g_CascadeResolution * TOTAL_CASCADES);
+
+	int cubeTexels = 0;
+	GLTrace::UseProgram(m_pPointShader);
+	for (size_t i = 0; i < m_pointShadows.size(); i++)
+	{
+		const POINT_SHADOW& pointShadow = m_pointShadows[i];
+		GLTrace::SetVec3(m_pPointShader, "lightPosition", pointShadow.position);
+		for (int face = 0; face < 6; face++)
+		{
+			GLTrace::SetMat4(m_pPointShader, "projection", GetCubeFaceMatrix(pointShadow.position, face));
+			AttachLayer(m_referenceCubeMap, face, g_CubeResolution);
+			GLTrace::Clear(GL_DEPTH_BUFFER_BIT);
+			DrawAllCasters(renderQueue, m_pPointShader, drawCaster);
+		}
+
+		GLTrace::ActiveTexture(GL_TEXTURE0 + POINT_SHADOW_TEXTURE_UNIT + (GLenum)i);
+		for (int face = 0; face < 6; face++)
+		{
+			cubeTexels += CountDifferentTexels(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_CUBE_MAP_POSITIVE_X + face,
+				pointShadow.compositeCubeMap, m_referenceCubeMap,
+				(size_t)g_CubeResolution * g_CubeResolution);
+		}
+	}
+	GLTrace::ActiveTexture(GL_TEXTURE0);
+
+	bool bPassed = ((0 == cascadeTexels) && (0 == cubeTexels));
+	if (!bPassed)
+	{
+		m_bVerificationFailed = true;
+	}
+	std::cout << "SHADOWS: cascades differ in " << cascadeTexels
+		<< " texels, cube maps in " << cubeTexels
+		<< " texels, " << m_updateInfo.dynamicRegionsRendered << " regions "
+		<< m_updateInfo.dynamicCastersDrawn << " moving casters drawn"
+		<< (bPassed ? " pass" : " FAIL") << std::endl;
+}
+
+/***********************************************************
+ *  ApplyToShader()
+ *
+ *  This method is used for binding the composite shadow
+ *  maps and passing their matrices into the lighting
+ *  shader, which must be the bound program.
+ ***********************************************************/
+void ShadowManager::ApplyToShader(ShaderManager* pShaderManager)
+{
+	if (!m_bInitialized)
+	{
+		GLTrace::SetBool(pShaderManager, "bUseShadows", false);
+		return;
+	}
+
+	GLTrace::SetBool(pShaderManager, "bUseShadows", true);
+	GLTrace::SetFloat(pShaderManager, "pointShadowFarPlane", g_PointShadowFar);
+
+	GLTrace::ActiveTexture(GL_TEXTURE0 + KEY_SHADOW_TEXTURE_UNIT);
+	GLTrace::BindTexture(GL_TEXTURE_2D_ARRAY, m_compositeCascades);
+	for (int i = 0; i < TOTAL_CASCADES; i++)
+	{
+		GLTrace::SetMat4(pShaderManager, m_cascadeMatrixNames[i], m_cascadeMatrices[i]);
+	}
+
+	// the key light is always light source 0
+	GLTrace::SetInt(pShaderManager, "lightShadowMaps[0]", 0);
+	for (size_t i = 0; i < m_pointShadows.size(); i++)
+	{
+		GLTrace::ActiveTexture(GL_TEXTURE0 + POINT_SHADOW_TEXTURE_UNIT + (GLenum)i);
+		GLTrace::BindTexture(GL_TEXTURE_CUBE_MAP, m_pointShadows[i].compositeCubeMap);
+		GLTrace::SetInt(pShaderManager, m_pointShadows[i].shadowMapName, (int)i + 1);
+	}
+	GLTrace::ActiveTexture(GL_TEXTURE0);
+}
@@ -0,0 +1,219 @@
+///////////////////////////////////////////////////////////////////////////////
+// shadowmanager.h
+// ============
+// manage the cached shadow maps of the scene lights
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+#include "RenderQueue.h"
+#include "HotReload.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <functional>
+#include <vector>
+
+/***********************************************************
+ *  ShadowManager
+ *
+ *  This class renders the shadow maps of the key light
+ *  (cascaded, centered on the camera) and of the shadowed
+ *  point lights (cube maps).  Each map has a static layer
+ *  that only holds the non-moving casters and is rendered
+ *  once, and a composite layer used by the lighting shader.
+ *  Every frame only the regions touched by the moving
+ *  casters that changed are copied from the static layer
+ *  and redrawn with the moving casters that reach into
+ *  them on top.
+ ***********************************************************/
+class ShadowManager
+{
+public:
+	static const int TOTAL_CASCADES = 3;
+	static const int MAX_POINT_SHADOWS = 3;
+	// texture units used by the lighting shader
+	static const int KEY_SHADOW_TEXTURE_UNIT = 4;
+	static const int POINT_SHADOW_TEXTURE_UNIT = 5;
+
+	// callback that draws the mesh of a command with the bound shader
+	typedef std::function<void(const DRAW_COMMAND&)> DrawCasterFunc;
+
+	struct UPDATE_INFO
+	{
+		// static layers redrawn this frame (cascades and cube faces)
+		int staticLayersRendered;
+		// dirty regions redrawn with the moving casters
+		int dynamicRegionsRendered;
+		// moving casters drawn into the layers
+		int dynamicCastersDrawn;
+	};
+
+	// constructor
+	ShadowManager();
+	// destructor
+	~ShadowManager();
+
+	// create the shadow textures and shaders
+	bool Initialize();
+	// set the direction the key light shines in
+	void SetKeyLightDirection(const glm::vec3& direction);
+	// add a shadowed point light, returns its shadow index
+	int AddPointLight(int lightIndex, const glm::vec3& position);
+	// force all the static layers to be redrawn
+	void InvalidateStatic();
+	// rebuild the shadow shaders when their files change
+	void WatchShaders(HotReload* pHotReload);
+
+	// bring the composite shadow maps up to date
+	void Update(
+		const RenderQueue& renderQueue,
+		const glm::vec3& cameraPosition,
+		DrawCasterFunc drawCaster);
+
+	// bind the shadow maps and set the lighting shader uniforms
+	void ApplyToShader(ShaderManager* pShaderManager);
+
+	const UPDATE_INFO& GetUpdateInfo() const { return m_updateInfo; }
+
+	// redraw the maps from scratch after every update and compare
+	// them with the cached ones
+	void SetVerifyCache(bool bVerify) { m_bVerifyCache = bVerify; }
+	// true when a cached map differed from the redrawn one
+	bool HasVerificationFailed() const { return m_bVerificationFailed; }
+
+private:
+	struct POINT_SHADOW
+	{
+		int lightIndex;
+		// handle of the lightShadowMaps uniform of the light
+		int shadowMapName;
+		glm::vec3 position;
+		GLuint staticCubeMap;
+		GLuint compositeCubeMap;
+		bool bStaticValid;
+	};
+
+	// a moving caster of the frame
+	struct CASTER
+	{
+		// index of its command in the render queue
+		uint32_t command;
+		glm::vec3 minXYZ;
+		glm::vec3 maxXYZ;
+	};
+
+	bool m_bInitialized;
+	ShaderManager* m_pDirectionalShader;
+	ShaderManager* m_pPointShader;
+	GLuint m_framebuffer;
+
+	// key light cascades, one texture array layer each
+	glm::vec3 m_keyLightDirection;
+	GLuint m_staticCascades;
+	GLuint m_compositeCascades;
+	glm::vec3 m_cascadeCenters[TOTAL_CASCADES];
+	glm::mat4 m_cascadeMatrices[TOTAL_CASCADES];
+	bool m_bCascadeValid[TOTAL_CASCADES];
+	int m_cascadeMatrixNames[TOTAL_CASCADES];
+
+	std::vector<POINT_SHADOW> m_pointShadows;
+
+	// signature of the static casters the static layers hold
+	size_t m_staticSignature;
+	// moving casters of this and of the previous frame
+	std::vector<CASTER> m_casters;
+	std::vector<CASTER> m_previousCasters;
+	// world boxes whose shadows are redrawn: the casters that
+	// changed, where they are and where they were
+	std::vector<glm::vec3> m_dirtyMin;
+	std::vector<glm::vec3> m_dirtyMax;
+	// casters and dirty boxes that can reach the layers being
+	// updated, indices into the lists above
+	std::vector<uint32_t> m_layerCasters;
+	std::vector<uint32_t> m_layerDirty;
+
+	UPDATE_INFO m_updateInfo;
+
+	bool m_bVerifyCache;
+	bool m_bVerificationFailed;
+	// maps drawn from scratch to check the cached ones against
+	GLuint m_referenceCascades;
+	GLuint m_referenceCubeMap;
+	std::vector<float> m_cachedTexels;
+	std::vector<float> m_referenceTexels;
+
+	// create a depth texture array or cube map
+	GLuint CreateCascadeTexture(const char* asset);
+	GLuint CreateCubeTexture(const char* asset);
+	void DeleteTexture(GLuint& textureID);
+	// place the cascades around the camera
+	void UpdateCascades(const glm::vec3& cameraPosition);
+	// view projection matrix of a cube map face
+	glm::mat4 GetCubeFaceMatrix(const glm::vec3& position, int face) const;
+	// texel rectangle covered by the box, false when not visible
+	bool GetDirtyRect(
+		const glm::mat4& viewProjection,
+		const glm::vec3& minXYZ,
+		const glm::vec3& maxXYZ,
+		int resolution,
+		bool bPerspective,
+		glm::ivec4& rect) const;
+	// list the moving casters of the frame and the boxes they
+	// dirtied since the previous frame
+	void UpdateCasters(const RenderQueue& renderQueue);
+	// pick the casters and dirty boxes in reach of a point
+	// light, or all of them for the cascades
+	void SelectLayerCasters(bool bPointLight, const glm::vec3& lightPosition);
+	// draw the static casters into the attached layer
+	void DrawStaticCasters(
+		const RenderQueue& renderQueue,
+		ShaderManager* pShader,
+		DrawCasterFunc drawCaster);
+	// draw the selected moving casters whose texels in the
+	// attached layer touch the rect
+	void DrawDynamicCasters(
+		const RenderQueue& renderQueue,
+		const glm::mat4& viewProjection,
+		int resolution,
+		bool bPerspective,
+		const glm::ivec4& rect,
+		ShaderManager* pShader,
+		DrawCasterFunc drawCaster);
+	// restore the texels of a layer covered by the selected dirty
+	// boxes from its static layer and redraw the moving casters
+	// over them
+	void UpdateDynamicLayer(
+		const RenderQueue& renderQueue,
+		GLuint staticTexture,
+		GLuint compositeTexture,
+		GLenum target,
+		int layer,
+		const glm::mat4& viewProjection,
+		int resolution,
+		bool bPerspective,
+		ShaderManager* pShader,
+		DrawCasterFunc drawCaster);
+	// attach a layer of a shadow texture to the framebuffer
+	void AttachLayer(GLuint texture, int layer, int resolution);
+	// redraw the maps into the reference textures and compare
+	// them with the composite ones
+	void VerifyCache(const RenderQueue& renderQueue, DrawCasterFunc drawCaster);
+	// draw every caster into the attached layer
+	void DrawAllCasters(
+		const RenderQueue& renderQueue,
+		ShaderManager* pShader,
+		DrawCasterFunc drawCaster);
+	// count the texels that differ between an image of the cached
+	// and of the reference texture, bound to the active unit
+	int CountDifferentTexels(
+		GLenum bindTarget,
+		GLenum imageTarget,
+		GLuint cachedTexture,
+		GLuint referenceTexture,
+		size_t texelCount);
+	// hash of the static caster transforms
+	size_t ComputeStaticSignature(const RenderQueue& renderQueue) const;
+};
@@ -0,0 +1,139 @@
+///////////////////////////////////////////////////////////////////////////////
+// shapegeometry.cpp
+// ============
+// build the triangles of the basic shape meshes on the CPU
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShapeGeometry.h"
+
+#include <cmath>
+
+// declaration of global variables
+namespace
+{
+	// sides of the cylinder mesh
+	const int g_CylinderSlices = 36;
+	// corners in the order they are turned into two triangles
+	const int g_Quad[6] = { 0, 1, 2, 0, 2, 3 };
+
+	/***********************************************************
+	 *  AddVertex()
+	 *
+	 *  This function is used for adding a vertex with the
+	 *  given position, normal and texture coordinate.  The
+	 *  shapes have no tangents, so a fixed one is stored.
+	 ***********************************************************/
+	void AddVertex(
+		std::vector<MESH_VERTEX>& vertices,
+		const glm::vec3& position,
+		const glm::vec3& normal,
+		const glm::vec2& uv)
+	{
+		MESH_VERTEX vertex;
+		vertex.position[0] = position.x;
+		vertex.position[1] = position.y;
+		vertex.position[2] = position.z;
+		vertex.normal[0] = normal.x;
+		vertex.normal[1] = normal.y;
+		vertex.normal[2] = normal.z;
+		vertex.uv[0] = uv.x;
+		vertex.uv[1] = uv.y;
+		vertex.tangent[0] = 1.0f;
+		vertex.tangent[1] = 0.0f;
+		vertex.tangent[2] = 0.0f;
+		vertex.tangent[3] = 1.0f;
+		vertices.push_back(vertex);
+	}
+}
+
+/***********************************************************
+ *  BuildTriangles()
+ *
+ *  This method is used for building the triangle list with
+ *  the shape, normals and texture coordinates of one of the
+ *  basic shape meshes.
+ ***********************************************************/
+bool ShapeGeometry::BuildTriangles(MESH_TYPE mesh, std::vector<MESH_VERTEX>& vertices)
+{
+	const glm::vec2 quadUV[4] = {
+		glm::vec2(0.0f, 0.0f), glm::vec2(1.0f, 0.0f), glm::vec2(1.0f, 1.0f), glm::vec2(0.0f, 1.0f) };
+
+	if (MESH_PLANE == mesh)
+	{
+		const glm::vec3 planeCorners[4] = {
+			glm::vec3(-1.0f, 0.0f, 1.0f), glm::vec3(1.0f, 0.0f, 1.0f),
+			glm::vec3(1.0f, 0.0f, -1.0f), glm::vec3(-1.0f, 0.0f, -1.0f) };
+		for (int i = 0; i < 6; i++)
+		{
+			AddVertex(vertices, planeCorners[g_Quad[i]], glm::vec3(0.0f, 1.0f, 0.0f), quadUV[g_Quad[i]]);
+		}
+		return(true);
+	}
+
+	if (MESH_BOX == mesh)
+	{
+		// each face is built from its normal and two edge directions
+		const glm::vec3 faceNormals[6] = {
+			glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f),
+			glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f),
+			glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f) };
+		const glm::vec3 faceUps[6] = {
+			glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f),
+			glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f),
+			glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 0.0f, 1.0f) };
+		for (int face = 0; face < 6; face++)
+		{
+			glm::vec3 normal = faceNormals[face];
+			glm::vec3 up = faceUps[face];
+			glm::vec3 right = glm::cross(up, normal);
+			for (int i = 0; i < 6; i++)
+			{
+				glm::vec2 uv = quadUV[g_Quad[i]];
+				glm::vec3 position = normal * 0.5f + right * (uv.x - 0.5f) + up * (uv.y - 0.5f);
+				AddVertex(vertices, position, normal, uv);
+			}
+		}
+		return(true);
+	}
+
+	if (MESH_CYLINDER == mesh)
+	{
+		const float pi = 3.14159265358979f;
+		for (int slice = 0; slice < g_CylinderSlices; slice++)
+		{
+			float angle0 = 2.0f * pi * (float)slice / (float)g_CylinderSlices;
+			float angle1 = 2.0f * pi * (float)(slice + 1) / (float)g_CylinderSlices;
+			glm::vec3 direction0(std::cos(angle0), 0.0f, std::sin(angle0));
+			glm::vec3 direction1(std::cos(angle1), 0.0f, std::sin(angle1));
+			float u0 = (float)slice / (float)g_CylinderSlices;
+			float u1 = (float)(slice + 1) / (float)g_CylinderSlices;
+
+			// side
+			const glm::vec3 cornerPositions[4] = {
+				direction0, direction1,
+				direction1 + glm::vec3(0.0f, 1.0f, 0.0f), direction0 + glm::vec3(0.0f, 1.0f, 0.0f) };
+			const glm::vec3 cornerNormals[4] = { direction0, direction1, direction1, direction0 };
+			const glm::vec2 cornerUVs[4] = {
+				glm::vec2(u0, 0.0f), glm::vec2(u1, 0.0f), glm::vec2(u1, 1.0f), glm::vec2(u0, 1.0f) };
+			for (int i = 0; i < 6; i++)
+			{
+				AddVertex(vertices, cornerPositions[g_Quad[i]], cornerNormals[g_Quad[i]], cornerUVs[g_Quad[i]]);
+			}
+
+			// top and bottom caps
+			for (int cap = 0; cap < 2; cap++)
+			{
+				float height = (cap == 0) ? 1.0f : 0.0f;
+				glm::vec3 normal(0.0f, (cap == 0) ? 1.0f : -1.0f, 0.0f);
+				AddVertex(vertices, glm::vec3(0.0f, height, 0.0f), normal, glm::vec2(0.5f, 0.5f));
+				AddVertex(vertices, direction0 + glm::vec3(0.0f, height, 0.0f), normal,
+					glm::vec2(0.5f + 0.5f * direction0.x, 0.5f + 0.5f * direction0.z));
+				AddVertex(vertices, direction1 + glm::vec3(0.0f, height, 0.0f), normal,
+					glm::vec2(0.5f + 0.5f * direction1.x, 0.5f + 0.5f * direction1.z));
+			}
+		}
+		return(true);
+	}
+
+	return(false);
+}
@@ -0,0 +1,29 @@
+///////////////////////////////////////////////////////////////////////////////
+// shapegeometry.h
+// ============
+// build the triangles of the basic shape meshes on the CPU
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "RenderQueue.h"
+#include "MeshImporter.h"
+
+#include <vector>
+
+/***********************************************************
+ *  ShapeGeometry
+ *
+ *  This class builds copies of the basic shape meshes the
+ *  ShapeMeshes object loads into OpenGL, for the code that
+ *  needs their triangles on the CPU: a 2x2 plane facing up,
+ *  a unit box and a cylinder of radius 1 standing on its
+ *  base.  The triangles come as a list, three vertices each.
+ ***********************************************************/
+class ShapeGeometry
+{
+public:
+	// add the triangles of a basic shape mesh to the vertices,
+	// returns false for a mesh that is not a basic shape
+	static bool BuildTriangles(MESH_TYPE mesh, std::vector<MESH_VERTEX>& vertices);
+};
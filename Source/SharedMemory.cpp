@@ -0,0 +1,237 @@
+///////////////////////////////////////////////////////////////////////////////
+// sharedmemory.cpp
+// ============
+// named memory shared between processes on the same machine
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SharedMemory.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <cstring>
+
+// declaration of global variables
+namespace
+{
+	/***********************************************************
+	 *  GetSystemName()
+	 *
+	 *  This function is used for turning the block name into
+	 *  the name the operating system expects.  Local names keep
+	 *  the block inside the login session on Windows.
+	 ***********************************************************/
+	std::string GetSystemName(const std::string& name)
+	{
+#ifdef _WIN32
+		return("Local\\" + name);
+#else
+		return("/" + name);
+#endif
+	}
+}
+
+/***********************************************************
+ *  SharedMemory()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SharedMemory::SharedMemory()
+{
+	m_pData = NULL;
+	m_size = 0;
+	m_bOwner = false;
+#ifdef _WIN32
+	m_mappingHandle = NULL;
+#endif
+}
+
+/***********************************************************
+ *  ~SharedMemory()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+SharedMemory::~SharedMemory()
+{
+	Close();
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for creating a new block of shared
+ *  memory.  A block left behind by a process that crashed is
+ *  removed first, so the new block always starts zeroed.
+ ***********************************************************/
+bool SharedMemory::Create(const std::string& name, size_t size)
+{
+	Close();
+
+	if (size == 0)
+	{
+		return(false);
+	}
+
+	std::string systemName = GetSystemName(name);
+
+#ifdef _WIN32
+	unsigned long long size64 = (unsigned long long)size;
+	HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+		(DWORD)(size64 >> 32), (DWORD)(size64 & 0xFFFFFFFFu), systemName.c_str());
+	if (mapping == NULL)
+	{
+		return(false);
+	}
+	// the pagefile mapping lives as long as any handle does, so
+	// an existing block is still in use by another process
+	if (GetLastError() == ERROR_ALREADY_EXISTS)
+	{
+		CloseHandle(mapping);
+		return(false);
+	}
+
+	void* pView = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+	if (pView == NULL)
+	{
+		CloseHandle(mapping);
+		return(false);
+	}
+	m_mappingHandle = mapping;
+#else
+	shm_unlink(systemName.c_str());
+	int file = shm_open(systemName.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (file < 0)
+	{
+		return(false);
+	}
+	if (ftruncate(file, (off_t)size) != 0)
+	{
+		close(file);
+		shm_unlink(systemName.c_str());
+		return(false);
+	}
+
+	void* pView = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+	close(file);
+	if (pView == MAP_FAILED)
+	{
+		shm_unlink(systemName.c_str());
+		return(false);
+	}
+#endif
+
+	m_name = systemName;
+	m_pData = (unsigned char*)pView;
+	m_size = size;
+	m_bOwner = true;
+
+	return(true);
+}
+
+/***********************************************************
+ *  Open()
+ *
+ *  This method is used for mapping a block of shared memory
+ *  created by another process.  The whole block is mapped.
+ ***********************************************************/
+bool SharedMemory::Open(const std::string& name)
+{
+	Close();
+
+	std::string systemName = GetSystemName(name);
+
+#ifdef _WIN32
+	HANDLE mapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, systemName.c_str());
+	if (mapping == NULL)
+	{
+		return(false);
+	}
+
+	void* pView = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+	if (pView == NULL)
+	{
+		CloseHandle(mapping);
+		return(false);
+	}
+
+	// the region size is the block size rounded up to pages
+	MEMORY_BASIC_INFORMATION info;
+	memset(&info, 0, sizeof(info));
+	VirtualQuery(pView, &info, sizeof(info));
+	size_t size = info.RegionSize;
+	m_mappingHandle = mapping;
+#else
+	int file = shm_open(systemName.c_str(), O_RDWR, 0600);
+	if (file < 0)
+	{
+		return(false);
+	}
+
+	struct stat fileInfo;
+	if ((fstat(file, &fileInfo) != 0) || (fileInfo.st_size <= 0))
+	{
+		close(file);
+		return(false);
+	}
+	size_t size = (size_t)fileInfo.st_size;
+
+	void* pView = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+	close(file);
+	if (pView == MAP_FAILED)
+	{
+		return(false);
+	}
+#endif
+
+	m_name = systemName;
+	m_pData = (unsigned char*)pView;
+	m_size = size;
+	m_bOwner = false;
+
+	return(true);
+}
+
+/***********************************************************
+ *  Close()
+ *
+ *  This method is used for unmapping the block.  The creator
+ *  also removes the name, processes that still have the
+ *  block mapped keep using it until they close it.
+ ***********************************************************/
+void SharedMemory::Close()
+{
+#ifdef _WIN32
+	if (NULL != m_pData)
+	{
+		UnmapViewOfFile(m_pData);
+	}
+	if (NULL != m_mappingHandle)
+	{
+		CloseHandle(m_mappingHandle);
+		m_mappingHandle = NULL;
+	}
+#else
+	if (NULL != m_pData)
+	{
+		munmap(m_pData, m_size);
+	}
+	if (m_bOwner)
+	{
+		shm_unlink(m_name.c_str());
+	}
+#endif
+
+	m_name.clear();
+	m_pData = NULL;
+	m_size = 0;
+	m_bOwner = false;
+}
@@ -0,0 +1,52 @@
+///////////////////////////////////////////////////////////////////////////////
+// sharedmemory.h
+// ============
+// named memory shared between processes on the same machine
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/***********************************************************
+ *  SharedMemory
+ *
+ *  This class creates or opens a named block of memory that
+ *  other processes can map at the same time.  POSIX shared
+ *  memory objects are used on Linux and macOS and pagefile
+ *  backed file mappings on Windows.  The process that created
+ *  the block removes its name again when it is closed.
+ ***********************************************************/
+class SharedMemory
+{
+public:
+	// constructor
+	SharedMemory();
+	// destructor
+	~SharedMemory();
+
+	// create a new zero filled block, replacing a stale one
+	bool Create(const std::string& name, size_t size);
+	// map a block created by another process
+	bool Open(const std::string& name);
+	// unmap the block
+	void Close();
+
+	bool IsOpen() const { return m_pData != NULL; }
+	unsigned char* GetData() const { return m_pData; }
+	size_t GetSize() const { return m_size; }
+
+private:
+	std::string m_name;
+	unsigned char* m_pData;
+	size_t m_size;
+	bool m_bOwner;
+#ifdef _WIN32
+	void* m_mappingHandle;
+#endif
+
+	// the mapping cannot be shared between two owners
+	SharedMemory(const SharedMemory&);
+	SharedMemory& operator=(const SharedMemory&);
+};
@@ -0,0 +1,1222 @@
+///////////////////////////////////////////////////////////////////////////////
+// softwarerasterizer.cpp
+// ============
+// draw the render queue on the CPU with tile-binned worker threads
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SoftwareRasterizer.h"
+#include "ResourceTracker.h"
+#include "MeshCache.h"
+#include "ShapeGeometry.h"
+#include "stb_image.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+#if defined(SOFTWARE_RASTERIZER_AVX2) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// declaration of global variables
+namespace
+{
+	// window positions are snapped to this fraction of a pixel,
+	// like the subpixel precision of the GPU
+	const float g_SubpixelSteps = 16.0f;
+	// pixels off by more than this count as different
+	const float g_DifferentThreshold = 24.0f / 255.0f;
+	// owner of the images in the resource tracker
+	const char* const g_TrackerName = "software rasterizer";
+
+	/***********************************************************
+	 *  PackColor()
+	 *
+	 *  This function is used for converting a color to RGBA8
+	 *  in the byte order OpenGL reads with GL_RGBA.
+	 ***********************************************************/
+	uint32_t PackColor(const glm::vec4& color)
+	{
+		glm::vec4 clamped = glm::clamp(color, glm::vec4(0.0f), glm::vec4(1.0f));
+		return ((uint32_t)(clamped.r * 255.0f + 0.5f)) |
+			((uint32_t)(clamped.g * 255.0f + 0.5f) << 8) |
+			((uint32_t)(clamped.b * 255.0f + 0.5f) << 16) |
+			((uint32_t)(clamped.a * 255.0f + 0.5f) << 24);
+	}
+
+	/***********************************************************
+	 *  UnpackColor()
+	 *
+	 *  This function is used for converting an RGBA8 color
+	 *  back to floating point.
+	 ***********************************************************/
+	glm::vec4 UnpackColor(uint32_t color)
+	{
+		return glm::vec4(
+			(float)(color & 0xFF),
+			(float)((color >> 8) & 0xFF),
+			(float)((color >> 16) & 0xFF),
+			(float)(color >> 24)) * (1.0f / 255.0f);
+	}
+
+	/***********************************************************
+	 *  RotateAxisAngle()
+	 *
+	 *  This function is used for turning a vector around a
+	 *  unit axis, the same way the vertex shaders do.
+	 ***********************************************************/
+	glm::vec3 RotateAxisAngle(const glm::vec3& v, const glm::vec3& axis, float angle)
+	{
+		float c = std::cos(angle);
+		float s = std::sin(angle);
+		return v * c + glm::cross(axis, v) * s + axis * glm::dot(axis, v) * (1.0f - c);
+	}
+}
+
+/***********************************************************
+ *  SoftwareRasterizer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SoftwareRasterizer::SoftwareRasterizer()
+{
+	for (int i = 0; i < MAX_LIGHTS; i++)
+	{
+		m_lights[i].position = glm::vec3(0.0f);
+		m_lights[i].ambientColor = glm::vec3(0.0f);
+		m_lights[i].diffuseColor = glm::vec3(0.0f);
+		m_lights[i].specularColor = glm::vec3(0.0f);
+		m_lights[i].focalStrength = 0.0f;
+		m_lights[i].specularIntensity = 0.0f;
+	}
+	m_animationClock = 0.0f;
+	m_viewPosition = glm::vec3(0.0f);
+	m_currentMaterial = -1;
+
+	m_pCommands = NULL;
+	m_viewProjection = glm::mat4(1.0f);
+	m_width = 0;
+	m_height = 0;
+	m_tilesX = 0;
+	m_tilesY = 0;
+	m_clearColor = 0;
+	m_lastRenderMs = 0.0;
+
+	m_threadCount = 1;
+	m_bAvx2 = false;
+	m_phase = PHASE_SETUP;
+	m_generation = 0;
+	m_workersDone = 0;
+	m_bQuit = false;
+	m_nextTile = 0;
+
+	m_presentTexture = 0;
+	m_presentFramebuffer = 0;
+	m_presentWidth = 0;
+	m_presentHeight = 0;
+
+	BuildMeshes();
+}
+
+/***********************************************************
+ *  ~SoftwareRasterizer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+SoftwareRasterizer::~SoftwareRasterizer()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bQuit = true;
+	}
+	m_startCondition.notify_all();
+	for (size_t i = 0; i < m_workers.size(); i++)
+	{
+		m_workers[i].join();
+	}
+
+	if (0 != m_presentFramebuffer)
+	{
+		glDeleteFramebuffers(1, &m_presentFramebuffer);
+	}
+	if (0 != m_presentTexture)
+	{
+		ResourceTracker::Release(RESOURCE_RENDER_TARGET, m_presentTexture);
+		glDeleteTextures(1, &m_presentTexture);
+	}
+	ResourceTracker::Release(RESOURCE_HOST_RASTER, (uint64_t)(uintptr_t)&m_colorBuffer);
+	ResourceTracker::Release(RESOURCE_HOST_RASTER, (uint64_t)(uintptr_t)&m_depthBuffer);
+	std::map<int, RASTER_TEXTURE>::const_iterator it = m_textures.begin();
+	for (; it != m_textures.end(); ++it)
+	{
+		ResourceTracker::Release(RESOURCE_HOST_RASTER, (uint64_t)(uintptr_t)&it->second);
+	}
+	std::map<int, std::vector<RASTER_VERTEX>>::const_iterator model = m_models.begin();
+	for (; model != m_models.end(); ++model)
+	{
+		ResourceTracker::Release(RESOURCE_HOST_RASTER, (uint64_t)(uintptr_t)&model->second);
+	}
+}
+
+/***********************************************************
+ *  CpuHasAvx2()
+ *
+ *  This method is used for checking that the CPU has AVX2
+ *  and the operating system saves the AVX registers.  This
+ *  file is built without AVX2, so the check itself runs on
+ *  any x86 CPU.
+ ***********************************************************/
+bool SoftwareRasterizer::CpuHasAvx2()
+{
+#if defined(SOFTWARE_RASTERIZER_AVX2)
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+	{
+		return(false);
+	}
+	// the operating system must save the AVX registers
+	__cpuid(info, 1);
+	bool bOSXSave = (info[2] & (1 << 27)) != 0;
+	bool bAVX = (info[2] & (1 << 28)) != 0;
+	if (!bOSXSave || !bAVX || ((_xgetbv(0) & 6) != 6))
+	{
+		return(false);
+	}
+	__cpuidex(info, 7, 0);
+	return((info[1] & (1 << 5)) != 0);
+#else
+	__builtin_cpu_init();
+	return(__builtin_cpu_supports("avx2") != 0);
+#endif
+#else
+	return(false);
+#endif
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for starting the worker threads.
+ *  The calling thread works too, so one thread starts none.
+ ***********************************************************/
+bool SoftwareRasterizer::Initialize(int threadCount)
+{
+	if (threadCount <= 0)
+	{
+		threadCount = std::max((int)std::thread::hardware_concurrency(), 1);
+	}
+	m_threadCount = threadCount;
+	m_bAvx2 = CpuHasAvx2();
+	m_bins.resize(m_threadCount);
+	for (int i = 1; i < m_threadCount; i++)
+	{
+		m_workers.push_back(std::thread(&SoftwareRasterizer::WorkerLoop, this, i));
+	}
+
+	const char* edgeFunctions = m_bAvx2 ? "AVX2" : "scalar";
+	std::cout << "Software rasterizer: " << m_threadCount << " threads, "
+		<< edgeFunctions << " edge functions, " << TILE_SIZE << " pixel tiles" << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  LoadTexture()
+ *
+ *  This method is used for decoding an image into memory
+ *  with the same mip chain the texture streamer builds, for
+ *  the draws that use the OpenGL texture of the image.
+ ***********************************************************/
+bool SoftwareRasterizer::LoadTexture(int textureID, const char* filename)
+{
+	int width = 0;
+	int height = 0;
+	int colorChannels = 0;
+
+	// the same orientation as the OpenGL textures
+	stbi_set_flip_vertically_on_load(true);
+	unsigned char* image = stbi_load(filename, &width, &height, &colorChannels, 4);
+	if (NULL == image)
+	{
+		std::cout << "Software rasterizer could not load image:" << filename << std::endl;
+		return(false);
+	}
+
+	RASTER_TEXTURE& texture = m_textures[textureID];
+	texture.mips.assign(1, std::vector<uint32_t>((size_t)width * height));
+	texture.widths.assign(1, width);
+	texture.heights.assign(1, height);
+	for (size_t i = 0; i < texture.mips[0].size(); i++)
+	{
+		const unsigned char* pTexel = image + i * 4;
+		texture.mips[0][i] = (uint32_t)pTexel[0] | ((uint32_t)pTexel[1] << 8) |
+			((uint32_t)pTexel[2] << 16) | ((uint32_t)pTexel[3] << 24);
+	}
+	stbi_image_free(image);
+
+	// 2x2 box filter down to one texel, rounded like the streamer
+	while ((texture.widths.back() > 1) || (texture.heights.back() > 1))
+	{
+		int sourceWidth = texture.widths.back();
+		int sourceHeight = texture.heights.back();
+		int targetWidth = std::max(1, sourceWidth / 2);
+		int targetHeight = std::max(1, sourceHeight / 2);
+		std::vector<uint32_t> target((size_t)targetWidth * targetHeight);
+		const std::vector<uint32_t>& source = texture.mips.back();
+
+		for (int y = 0; y < targetHeight; y++)
+		{
+			int y0 = std::min(y * 2, sourceHeight - 1);
+			int y1 = std::min(y * 2 + 1, sourceHeight - 1);
+			for (int x = 0; x < targetWidth; x++)
+			{
+				int x0 = std::min(x * 2, sourceWidth - 1);
+				int x1 = std::min(x * 2 + 1, sourceWidth - 1);
+				uint32_t texels[4] = {
+					source[(size_t)y0 * sourceWidth + x0], source[(size_t)y0 * sourceWidth + x1],
+					source[(size_t)y1 * sourceWidth + x0], source[(size_t)y1 * sourceWidth + x1] };
+				uint32_t result = 0;
+				for (int c = 0; c < 4; c++)
+				{
+					uint32_t sum = 0;
+					for (int t = 0; t < 4; t++)
+					{
+						sum += (texels[t] >> (c * 8)) & 0xFF;
+					}
+					result |= ((sum + 2) / 4) << (c * 8);
+				}
+				target[(size_t)y * targetWidth + x] = result;
+			}
+		}
+
+		texture.mips.push_back(target);
+		texture.widths.push_back(targetWidth);
+		texture.heights.push_back(targetHeight);
+	}
+
+	size_t textureBytes = 0;
+	for (size_t i = 0; i < texture.mips.size(); i++)
+	{
+		textureBytes += texture.mips[i].size() * sizeof(uint32_t);
+	}
+	ResourceTracker::Track(RESOURCE_HOST_RASTER, (uint64_t)(uintptr_t)&texture, g_TrackerName, filename, textureBytes);
+
+	return(true);
+}
+
+/***********************************************************
+ *  LoadModel()
+ *
+ *  This method is used for copying the triangles of a model
+ *  out of its cooked mesh file.
+ ***********************************************************/
+bool SoftwareRasterizer::LoadModel(int model, const std::string& filename)
+{
+	MeshCache cache;
+	if (!cache.Load(filename, m_threadCount))
+	{
+		std::cout << "Software rasterizer could not load model:" << filename << std::endl;
+		return(false);
+	}
+
+	SetModel(model, filename, cache.GetVertices(), cache.GetIndices(), cache.GetIndexCount());
+	return(true);
+}
+
+/***********************************************************
+ *  SetModel()
+ *
+ *  This method is used for copying the triangles of a model
+ *  unrolled into a triangle list like the basic meshes.  A
+ *  model set before is replaced.
+ ***********************************************************/
+void SoftwareRasterizer::SetModel(
+	int model,
+	const std::string& name,
+	const MESH_VERTEX* pVertices,
+	const uint32_t* pIndices,
+	uint32_t indexCount)
+{
+	std::vector<RASTER_VERTEX>& mesh = m_models[model];
+	ResourceTracker::Release(RESOURCE_HOST_RASTER, (uint64_t)(uintptr_t)&mesh);
+
+	mesh.resize(indexCount);
+	for (uint32_t i = 0; i < indexCount; i++)
+	{
+		const MESH_VERTEX& vertex = pVertices[pIndices[i]];
+		mesh[i].position = glm::vec3(vertex.position[0], vertex.position[1], vertex.position[2]);
+		mesh[i].normal = glm::vec3(vertex.normal[0], vertex.normal[1], vertex.normal[2]);
+		mesh[i].uv = glm::vec2(vertex.uv[0], vertex.uv[1]);
+	}
+	ResourceTracker::Track(RESOURCE_HOST_RASTER, (uint64_t)(uintptr_t)&mesh, g_TrackerName, name.c_str(),
+		mesh.size() * sizeof(RASTER_VERTEX));
+}
+
+/***********************************************************
+ *  SetLight()
+ *
+ *  This method is used for setting the values of a light
+ *  source.  Lights that are never set stay zero, like the
+ *  shader uniforms, and still add the material ambient.
+ ***********************************************************/
+void SoftwareRasterizer::SetLight(int index, const RASTER_LIGHT& light)
+{
+	if ((index >= 0) && (index < MAX_LIGHTS))
+	{
+		m_lights[index] = light;
+	}
+}
+
+/***********************************************************
+ *  SetMaterials()
+ *
+ *  This method is used for setting the materials the draw
+ *  command material indices refer to.
+ ***********************************************************/
+void SoftwareRasterizer::SetMaterials(const std::vector<RASTER_MATERIAL>& materials)
+{
+	m_materials = materials;
+	m_currentMaterial = -1;
+}
+
+/***********************************************************
+ *  SetAnimations()
+ *
+ *  This method is used for copying the part animation
+ *  records the draw command animation indices refer to.
+ ***********************************************************/
+void SoftwareRasterizer::SetAnimations(const SCENE_ANIMATION_RECORD* pRecords, uint32_t count)
+{
+	m_animations.assign(pRecords, pRecords + count);
+}
+
+/***********************************************************
+ *  SetAnimationClock()
+ *
+ *  This method is used for setting the animation clock, the
+ *  value the vertex shaders get in animationClock.x.
+ ***********************************************************/
+void SoftwareRasterizer::SetAnimationClock(float seconds)
+{
+	m_animationClock = seconds;
+}
+
+/***********************************************************
+ *  SetViewPosition()
+ *
+ *  This method is used for setting the position the
+ *  specular highlights are seen from.
+ ***********************************************************/
+void SoftwareRasterizer::SetViewPosition(const glm::vec3& position)
+{
+	m_viewPosition = position;
+}
+
+/***********************************************************
+ *  Render()
+ *
+ *  This method is used for drawing the commands of the view
+ *  order into the color buffer.  The opaque commands come
+ *  before the transparent ones, and every tile draws its
+ *  triangles in that order, so the blending matches the
+ *  sorted OpenGL passes.
+ ***********************************************************/
+void SoftwareRasterizer::Render(
+	const std::vector<DRAW_COMMAND>& commands,
+	const VIEW_ORDER& order,
+	const RENDER_VIEW& view,
+	int width,
+	int height,
+	const glm::vec4& clearColor)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	if ((width <= 0) || (height <= 0))
+	{
+		return;
+	}
+	if ((width != m_width) || (height != m_height))
+	{
+		m_width = width;
+		m_height = height;
+		m_tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+		m_tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+		m_colorBuffer.assign((size_t)width * height, 0);
+		m_depthBuffer.assign((size_t)width * height, 1.0f);
+		ResourceTracker::Track(RESOURCE_HOST_RASTER, (uint64_t)(uintptr_t)&m_colorBuffer, g_TrackerName, "color buffer",
+			m_colorBuffer.size() * sizeof(uint32_t));
+		ResourceTracker::Track(RESOURCE_HOST_RASTER, (uint64_t)(uintptr_t)&m_depthBuffer, g_TrackerName, "depth buffer",
+			m_depthBuffer.size() * sizeof(float));
+	}
+	m_clearColor = PackColor(clearColor);
+	m_viewProjection = view.projection * view.view;
+	m_pCommands = &commands;
+
+	// resolve the shader state each command is drawn with, in
+	// the order OpenGL would draw them
+	m_draws.clear();
+	for (int pass = 0; pass < 2; pass++)
+	{
+		const std::vector<uint32_t>& indices = (pass == 0) ? order.opaqueOrder : order.transparentOrder;
+		for (size_t i = 0; i < indices.size(); i++)
+		{
+			const DRAW_COMMAND& command = commands[indices[i]];
+			if ((command.materialIndex >= 0) && (command.materialIndex < (int)m_materials.size()))
+			{
+				m_currentMaterial = command.materialIndex;
+			}
+
+			RASTER_DRAW draw;
+			draw.pCommand = &command;
+			draw.pTexture = NULL;
+			draw.materialIndex = m_currentMaterial;
+			draw.bTransparent = (pass == 1);
+			if (command.textureID >= 0)
+			{
+				std::map<int, RASTER_TEXTURE>::const_iterator found = m_textures.find(command.textureID);
+				if (found != m_textures.end())
+				{
+					draw.pTexture = &found->second;
+				}
+			}
+			m_draws.push_back(draw);
+		}
+	}
+
+	// the bins keep their memory from frame to frame
+	int tileCount = m_tilesX * m_tilesY;
+	for (int i = 0; i < m_threadCount; i++)
+	{
+		m_bins[i].triangles.clear();
+		m_bins[i].tiles.resize(tileCount);
+		for (int t = 0; t < tileCount; t++)
+		{
+			m_bins[i].tiles[t].clear();
+		}
+	}
+
+	RunPhase(PHASE_SETUP);
+	m_nextTile = 0;
+	RunPhase(PHASE_TILES);
+
+	m_pCommands = NULL;
+	m_lastRenderMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+/***********************************************************
+ *  Present()
+ *
+ *  This method is used for copying the color buffer into
+ *  the bound draw framebuffer with its lower left corner at
+ *  the position.  The buffer is uploaded into a texture and
+ *  blitted, which works for the window and for off-screen
+ *  render targets alike.
+ ***********************************************************/
+void SoftwareRasterizer::Present(int x, int y)
+{
+	if (m_colorBuffer.empty())
+	{
+		return;
+	}
+
+	GLint boundTexture = 0;
+	GLint readFramebuffer = 0;
+	GLint unpackBuffer = 0;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &boundTexture);
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &readFramebuffer);
+	glGetIntegerv(GL_PIXEL_UNPACK_BUFFER_BINDING, &unpackBuffer);
+
+	if (0 == m_presentTexture)
+	{
+		glGenTextures(1, &m_presentTexture);
+		glGenFramebuffers(1, &m_presentFramebuffer);
+	}
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindTexture(GL_TEXTURE_2D, m_presentTexture);
+	if ((m_width != m_presentWidth) || (m_height != m_presentHeight))
+	{
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_width, m_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, m_colorBuffer.data());
+		ResourceTracker::Track(RESOURCE_RENDER_TARGET, m_presentTexture, g_TrackerName, "presented frame",
+			ResourceTracker::GetImageBytes(GL_RGBA8, m_width, m_height, 1));
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, m_presentFramebuffer);
+		glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_presentTexture, 0);
+		m_presentWidth = m_width;
+		m_presentHeight = m_height;
+	}
+	else
+	{
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, m_colorBuffer.data());
+	}
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_presentFramebuffer);
+	glBlitFramebuffer(0, 0, m_width, m_height, x, y, x + m_width, y + m_height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, readFramebuffer);
+	glBindTexture(GL_TEXTURE_2D, boundTexture);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, unpackBuffer);
+}
+
+/***********************************************************
+ *  Compare()
+ *
+ *  This method is used for reading back what OpenGL drew at
+ *  the position and measuring how far the color buffer is
+ *  from it.  The color channels are compared, the alpha is
+ *  not shown.
+ ***********************************************************/
+void SoftwareRasterizer::Compare(int x, int y, RASTER_DIFFERENCE& difference)
+{
+	difference.meanError = 0.0f;
+	difference.maxError = 0.0f;
+	difference.differentFraction = 0.0f;
+	if (m_colorBuffer.empty())
+	{
+		return;
+	}
+
+	GLint packBuffer = 0;
+	glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &packBuffer);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+	std::vector<uint32_t> reference((size_t)m_width * m_height);
+	glReadPixels(x, y, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, reference.data());
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, packBuffer);
+
+	double errorSum = 0.0;
+	size_t differentCount = 0;
+	for (size_t i = 0; i < reference.size(); i++)
+	{
+		glm::vec3 delta = glm::abs(glm::vec3(UnpackColor(m_colorBuffer[i])) - glm::vec3(UnpackColor(reference[i])));
+		float error = std::max(delta.r, std::max(delta.g, delta.b));
+		errorSum += error;
+		difference.maxError = std::max(difference.maxError, error);
+		if (error > g_DifferentThreshold)
+		{
+			differentCount++;
+		}
+	}
+	difference.meanError = (float)(errorSum / reference.size());
+	difference.differentFraction = (float)differentCount / (float)reference.size();
+}
+
+/***********************************************************
+ *  BuildMeshes()
+ *
+ *  This method is used for building triangle lists with the
+ *  shape, normals and texture coordinates of the basic shape
+ *  meshes.
+ ***********************************************************/
+void SoftwareRasterizer::BuildMeshes()
+{
+	std::vector<MESH_VERTEX> vertices;
+	for (int mesh = 0; mesh < MESH_TYPE_COUNT; mesh++)
+	{
+		vertices.clear();
+		ShapeGeometry::BuildTriangles((MESH_TYPE)mesh, vertices);
+		m_meshes[mesh].resize(vertices.size());
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			const MESH_VERTEX& vertex = vertices[i];
+			m_meshes[mesh][i].position = glm::vec3(vertex.position[0], vertex.position[1], vertex.position[2]);
+			m_meshes[mesh][i].normal = glm::vec3(vertex.normal[0], vertex.normal[1], vertex.normal[2]);
+			m_meshes[mesh][i].uv = glm::vec2(vertex.uv[0], vertex.uv[1]);
+		}
+	}
+}
+
+/***********************************************************
+ *  GetMesh()
+ *
+ *  This method is used for finding the triangles a command
+ *  draws, NULL for a model that was not loaded.
+ ***********************************************************/
+const std::vector<SoftwareRasterizer::RASTER_VERTEX>* SoftwareRasterizer::GetMesh(MESH_TYPE mesh) const
+{
+	if (mesh < MESH_TYPE_COUNT)
+	{
+		return((mesh >= 0) ? &m_meshes[mesh] : NULL);
+	}
+	std::map<int, std::vector<RASTER_VERTEX>>::const_iterator it = m_models.find((int)(mesh - MESH_MODEL_FIRST));
+	return((it != m_models.end()) ? &it->second : NULL);
+}
+
+/***********************************************************
+ *  WorkerLoop()
+ *
+ *  This method is used for running the phases of the frames
+ *  on a worker thread until the rasterizer is destroyed.
+ ***********************************************************/
+void SoftwareRasterizer::WorkerLoop(int worker)
+{
+	uint64_t generation = 0;
+	while (true)
+	{
+		WORKER_PHASE phase;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_startCondition.wait(lock, [this, generation]() { return m_bQuit || (m_generation != generation); });
+			if (m_bQuit)
+			{
+				return;
+			}
+			generation = m_generation;
+			phase = m_phase;
+		}
+
+		RunWorker(worker, phase);
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_workersDone++;
+		m_doneCondition.notify_all();
+	}
+}
+
+/***********************************************************
+ *  RunPhase()
+ *
+ *  This method is used for starting a phase on the workers,
+ *  working on it from the calling thread and waiting until
+ *  all the workers are done.
+ ***********************************************************/
+void SoftwareRasterizer::RunPhase(WORKER_PHASE phase)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_phase = phase;
+		m_workersDone = 0;
+		m_generation++;
+	}
+	m_startCondition.notify_all();
+
+	RunWorker(0, phase);
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_doneCondition.wait(lock, [this]() { return m_workersDone == m_threadCount - 1; });
+}
+
+/***********************************************************
+ *  RunWorker()
+ *
+ *  This method is used for doing the share of a worker in
+ *  a phase.
+ ***********************************************************/
+void SoftwareRasterizer::RunWorker(int worker, WORKER_PHASE phase)
+{
+	if (PHASE_SETUP == phase)
+	{
+		SetupDraws(worker);
+	}
+	else
+	{
+		RasterizeTiles();
+	}
+}
+
+/***********************************************************
+ *  SetupDraws()
+ *
+ *  This method is used for running the vertex shader on the
+ *  draws of a worker, a contiguous range so the bins of the
+ *  workers together keep the draw order.  The triangles are
+ *  clipped against the near and far planes and binned.
+ ***********************************************************/
+void SoftwareRasterizer::SetupDraws(int worker)
+{
+	WORKER_BINS& bins = m_bins[worker];
+	size_t first = m_draws.size() * worker / m_threadCount;
+	size_t last = m_draws.size() * (worker + 1) / m_threadCount;
+
+	for (size_t d = first; d < last; d++)
+	{
+		const DRAW_COMMAND& command = *m_draws[d].pCommand;
+		const std::vector<RASTER_VERTEX>* pMesh = GetMesh(command.mesh);
+		if (NULL == pMesh)
+		{
+			continue;
+		}
+		const std::vector<RASTER_VERTEX>& mesh = *pMesh;
+		glm::mat4 modelViewProjection = m_viewProjection * command.model;
+
+		const SCENE_ANIMATION_RECORD* pAnimation = NULL;
+		glm::vec3 spinAxis;
+		glm::vec3 scale;
+		float spinAngle = 0.0f;
+		glm::vec3 bob;
+		if ((command.animationIndex >= 0) && (command.animationIndex < (int)m_animations.size()))
+		{
+			pAnimation = &m_animations[command.animationIndex];
+			spinAxis = glm::vec3(pAnimation->spinAxis[0], pAnimation->spinAxis[1], pAnimation->spinAxis[2]);
+			scale = glm::vec3(pAnimation->scale[0], pAnimation->scale[1], pAnimation->scale[2]);
+			spinAngle = pAnimation->spinRate * m_animationClock + pAnimation->phase;
+			bob = glm::vec3(pAnimation->bobOffset[0], pAnimation->bobOffset[1], pAnimation->bobOffset[2]) *
+				std::sin(pAnimation->bobRate * m_animationClock + pAnimation->phase);
+		}
+
+		for (size_t v = 0; v + 2 < mesh.size(); v += 3)
+		{
+			// room for a triangle clipped by two planes
+			CLIP_VERTEX polygon[5];
+			for (int i = 0; i < 3; i++)
+			{
+				const RASTER_VERTEX& vertex = mesh[v + i];
+				glm::vec3 position = vertex.position;
+				glm::vec3 normal = vertex.normal;
+				if (NULL != pAnimation)
+				{
+					glm::vec3 scaled = RotateAxisAngle(position * scale, spinAxis, spinAngle) + bob;
+					position = scaled / scale;
+					normal = RotateAxisAngle(normal, spinAxis, spinAngle);
+				}
+
+				glm::vec4 world = command.model * glm::vec4(position, 1.0f);
+				glm::vec2 uv = vertex.uv * command.uvScale;
+				polygon[i].clip = modelViewProjection * glm::vec4(position, 1.0f);
+				polygon[i].values[0] = world.x;
+				polygon[i].values[1] = world.y;
+				polygon[i].values[2] = world.z;
+				// the shaders light with the normal of the mesh
+				polygon[i].values[3] = normal.x;
+				polygon[i].values[4] = normal.y;
+				polygon[i].values[5] = normal.z;
+				polygon[i].values[6] = uv.x;
+				polygon[i].values[7] = uv.y;
+			}
+			ClipAndSetup(polygon, 3, (uint32_t)d, bins);
+		}
+	}
+}
+
+/***********************************************************
+ *  ClipAndSetup()
+ *
+ *  This method is used for clipping a triangle against the
+ *  near and the far plane, projecting what is left to the
+ *  window and setting up its triangles.  The sides need no
+ *  clipping since only the pixels inside are visited.
+ ***********************************************************/
+void SoftwareRasterizer::ClipAndSetup(CLIP_VERTEX* pPolygon, int vertexCount, uint32_t drawIndex, WORKER_BINS& bins)
+{
+	CLIP_VERTEX clipped[5];
+	for (int plane = 0; plane < 2; plane++)
+	{
+		float sign = (plane == 0) ? 1.0f : -1.0f;
+		int clippedCount = 0;
+		for (int i = 0; i < vertexCount; i++)
+		{
+			const CLIP_VERTEX& current = pPolygon[i];
+			const CLIP_VERTEX& next = pPolygon[(i + 1) % vertexCount];
+			// w + z for the near plane and w - z for the far plane
+			float currentDistance = current.clip.w + sign * current.clip.z;
+			float nextDistance = next.clip.w + sign * next.clip.z;
+
+			if (currentDistance >= 0.0f)
+			{
+				clipped[clippedCount++] = current;
+			}
+			if ((currentDistance >= 0.0f) != (nextDistance >= 0.0f))
+			{
+				float t = currentDistance / (currentDistance - nextDistance);
+				CLIP_VERTEX& crossing = clipped[clippedCount++];
+				crossing.clip = glm::mix(current.clip, next.clip, t);
+				for (int k = 0; k < 8; k++)
+				{
+					crossing.values[k] = current.values[k] + (next.values[k] - current.values[k]) * t;
+				}
+			}
+		}
+		if (clippedCount < 3)
+		{
+			return;
+		}
+		for (int i = 0; i < clippedCount; i++)
+		{
+			pPolygon[i] = clipped[i];
+		}
+		vertexCount = clippedCount;
+	}
+
+	SCREEN_VERTEX screen[5];
+	for (int i = 0; i < vertexCount; i++)
+	{
+		const CLIP_VERTEX& vertex = pPolygon[i];
+		if (vertex.clip.w <= 0.0f)
+		{
+			return;
+		}
+		float inverseW = 1.0f / vertex.clip.w;
+		float x = (vertex.clip.x * inverseW * 0.5f + 0.5f) * (float)m_width;
+		float y = (vertex.clip.y * inverseW * 0.5f + 0.5f) * (float)m_height;
+		screen[i].x = std::floor(x * g_SubpixelSteps + 0.5f) / g_SubpixelSteps;
+		screen[i].y = std::floor(y * g_SubpixelSteps + 0.5f) / g_SubpixelSteps;
+		screen[i].values[ATTRIBUTE_DEPTH] = vertex.clip.z * inverseW * 0.5f + 0.5f;
+		screen[i].values[ATTRIBUTE_INVERSE_W] = inverseW;
+		for (int k = 0; k < 8; k++)
+		{
+			screen[i].values[ATTRIBUTE_POSITION + k] = vertex.values[k] * inverseW;
+		}
+	}
+
+	for (int i = 1; i + 1 < vertexCount; i++)
+	{
+		SetupTriangle(screen[0], screen[i], screen[i + 1], drawIndex, bins);
+	}
+}
+
+/***********************************************************
+ *  SetupTriangle()
+ *
+ *  This method is used for computing the edge functions and
+ *  attribute planes of a window space triangle and adding it
+ *  to the bins of the tiles its bounds touch.  Both windings
+ *  are drawn, as with face culling off.  The edges shared by
+ *  two triangles get exactly negated functions, so every
+ *  pixel along them is drawn once.
+ ***********************************************************/
+void SoftwareRasterizer::SetupTriangle(
+	const SCREEN_VERTEX& v0,
+	const SCREEN_VERTEX& v1,
+	const SCREEN_VERTEX& v2,
+	uint32_t drawIndex,
+	WORKER_BINS& bins)
+{
+	float area = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+	if (area == 0.0f)
+	{
+		return;
+	}
+
+	RASTER_TRIANGLE triangle;
+	// pixels whose centers can be inside
+	float minX = std::min(v0.x, std::min(v1.x, v2.x));
+	float maxX = std::max(v0.x, std::max(v1.x, v2.x));
+	float minY = std::min(v0.y, std::min(v1.y, v2.y));
+	float maxY = std::max(v0.y, std::max(v1.y, v2.y));
+	triangle.minX = std::max((int)std::floor(minX - 0.5f), 0);
+	triangle.maxX = std::min((int)std::ceil(maxX - 0.5f), m_width - 1);
+	triangle.minY = std::max((int)std::floor(minY - 0.5f), 0);
+	triangle.maxY = std::min((int)std::ceil(maxY - 0.5f), m_height - 1);
+	if ((triangle.minX > triangle.maxX) || (triangle.minY > triangle.maxY))
+	{
+		return;
+	}
+
+	const SCREEN_VERTEX* vertices[3] = { &v0, &v1, &v2 };
+	float orientation = (area > 0.0f) ? 1.0f : -1.0f;
+	for (int e = 0; e < 3; e++)
+	{
+		const SCREEN_VERTEX& a = *vertices[e];
+		const SCREEN_VERTEX& b = *vertices[(e + 1) % 3];
+		triangle.edgeA[e] = (a.y - b.y) * orientation;
+		triangle.edgeB[e] = (b.x - a.x) * orientation;
+		triangle.edgeC[e] = (a.x * b.y - a.y * b.x) * orientation;
+		// of two triangles sharing the edge exactly one owns it
+		triangle.bTopLeft[e] = (triangle.edgeA[e] > 0.0f) ||
+			((triangle.edgeA[e] == 0.0f) && (triangle.edgeB[e] > 0.0f));
+	}
+
+	triangle.originX = v0.x;
+	triangle.originY = v0.y;
+	float x1 = v1.x - v0.x;
+	float y1 = v1.y - v0.y;
+	float x2 = v2.x - v0.x;
+	float y2 = v2.y - v0.y;
+	for (int k = 0; k < ATTRIBUTE_COUNT; k++)
+	{
+		float d1 = v1.values[k] - v0.values[k];
+		float d2 = v2.values[k] - v0.values[k];
+		triangle.planeX[k] = (d1 * y2 - d2 * y1) / area;
+		triangle.planeY[k] = (d2 * x1 - d1 * x2) / area;
+		triangle.planeOrigin[k] = v0.values[k];
+	}
+	triangle.drawIndex = drawIndex;
+
+	uint32_t triangleIndex = (uint32_t)bins.triangles.size();
+	bins.triangles.push_back(triangle);
+	for (int tileY = triangle.minY / TILE_SIZE; tileY <= triangle.maxY / TILE_SIZE; tileY++)
+	{
+		for (int tileX = triangle.minX / TILE_SIZE; tileX <= triangle.maxX / TILE_SIZE; tileX++)
+		{
+			bins.tiles[tileY * m_tilesX + tileX].push_back(triangleIndex);
+		}
+	}
+}
+
+/***********************************************************
+ *  RasterizeTiles()
+ *
+ *  This method is used for taking tiles from the shared
+ *  counter until none are left.  A tile is cleared and its
+ *  triangles drawn from the bins of the workers in order,
+ *  so no two threads ever write the same pixel.
+ ***********************************************************/
+void SoftwareRasterizer::RasterizeTiles()
+{
+	int tileCount = m_tilesX * m_tilesY;
+	for (int tile = m_nextTile++; tile < tileCount; tile = m_nextTile++)
+	{
+		int tileX = (tile % m_tilesX) * TILE_SIZE;
+		int tileY = (tile / m_tilesX) * TILE_SIZE;
+		int endX = std::min(tileX + TILE_SIZE, m_width);
+		int endY = std::min(tileY + TILE_SIZE, m_height);
+		for (int y = tileY; y < endY; y++)
+		{
+			size_t row = (size_t)y * m_width;
+			std::fill(m_colorBuffer.begin() + row + tileX, m_colorBuffer.begin() + row + endX, m_clearColor);
+			std::fill(m_depthBuffer.begin() + row + tileX, m_depthBuffer.begin() + row + endX, 1.0f);
+		}
+
+		for (int worker = 0; worker < m_threadCount; worker++)
+		{
+			const WORKER_BINS& bins = m_bins[worker];
+			const std::vector<uint32_t>& triangles = bins.tiles[tile];
+			for (size_t i = 0; i < triangles.size(); i++)
+			{
+				RasterizeTriangle(bins.triangles[triangles[i]], tileX, tileY);
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  RasterizeTriangle()
+ *
+ *  This method is used for finding the pixels of a tile
+ *  whose centers are inside the triangle and pass the depth
+ *  test, eight at a time, and shading them.  The edge
+ *  functions are evaluated the same way for every pixel so
+ *  shared edges stay watertight, and the same way as in
+ *  RasterizeTriangleAvx2() so both give the same image.
+ ***********************************************************/
+void SoftwareRasterizer::RasterizeTriangle(const RASTER_TRIANGLE& triangle, int tileX, int tileY)
+{
+	int startX = std::max(triangle.minX, tileX);
+	int endX = std::min(triangle.maxX, tileX + TILE_SIZE - 1);
+	int startY = std::max(triangle.minY, tileY);
+	int endY = std::min(triangle.maxY, tileY + TILE_SIZE - 1);
+	if ((startX > endX) || (startY > endY))
+	{
+		return;
+	}
+
+#if defined(SOFTWARE_RASTERIZER_AVX2)
+	if (m_bAvx2)
+	{
+		RasterizeTriangleAvx2(triangle, startX, endX, startY, endY, m_depthBuffer.data());
+		return;
+	}
+#endif
+
+	const float depthX = triangle.planeX[ATTRIBUTE_DEPTH];
+	const float depthY = triangle.planeY[ATTRIBUTE_DEPTH];
+	const float depthOrigin = triangle.planeOrigin[ATTRIBUTE_DEPTH];
+	float depths[8];
+
+	for (int y = startY; y <= endY; y++)
+	{
+		float pixelY = (float)y + 0.5f;
+		float rowDepth = depthOrigin + depthY * (pixelY - triangle.originY);
+		const float* pDepthRow = m_depthBuffer.data() + (size_t)y * m_width;
+
+		for (int x = startX; x <= endX; x += 8)
+		{
+			int laneCount = std::min(8, endX - x + 1);
+			for (int lane = 0; lane < laneCount; lane++)
+			{
+				float pixelX = (float)x + ((float)lane + 0.5f);
+				bool bInside = true;
+				for (int e = 0; (e < 3) && bInside; e++)
+				{
+					float value = ((triangle.edgeA[e] * pixelX) + (triangle.edgeB[e] * pixelY)) + triangle.edgeC[e];
+					bInside = (value > 0.0f) || ((value == 0.0f) && triangle.bTopLeft[e]);
+				}
+				if (!bInside)
+				{
+					continue;
+				}
+
+				depths[lane] = rowDepth + depthX * (pixelX - triangle.originX);
+				if (depths[lane] < pDepthRow[x + lane])
+				{
+					ShadePixel(triangle, x + lane, y, depths[lane]);
+				}
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  ShadePixel()
+ *
+ *  This method is used for interpolating the attributes at
+ *  the pixel center with perspective correction, running
+ *  the fragment shader and writing the result with the
+ *  depth and blend state of the pass of the draw.
+ ***********************************************************/
+void SoftwareRasterizer::ShadePixel(const RASTER_TRIANGLE& triangle, int x, int y, float depth)
+{
+	const RASTER_DRAW& draw = m_draws[triangle.drawIndex];
+	const DRAW_COMMAND& command = *draw.pCommand;
+
+	float dx = ((float)x + 0.5f) - triangle.originX;
+	float dy = ((float)y + 0.5f) - triangle.originY;
+	float values[ATTRIBUTE_COUNT];
+	for (int k = ATTRIBUTE_INVERSE_W; k < ATTRIBUTE_COUNT; k++)
+	{
+		values[k] = triangle.planeOrigin[k] + triangle.planeX[k] * dx + triangle.planeY[k] * dy;
+	}
+	float w = 1.0f / values[ATTRIBUTE_INVERSE_W];
+	glm::vec3 position = glm::vec3(values[ATTRIBUTE_POSITION], values[ATTRIBUTE_POSITION + 1], values[ATTRIBUTE_POSITION + 2]) * w;
+	glm::vec3 normal = glm::vec3(values[ATTRIBUTE_NORMAL], values[ATTRIBUTE_NORMAL + 1], values[ATTRIBUTE_NORMAL + 2]) * w;
+	glm::vec2 uv = glm::vec2(values[ATTRIBUTE_UV], values[ATTRIBUTE_UV + 1]) * w;
+
+	glm::vec4 textureColor(1.0f);
+	if (NULL != draw.pTexture)
+	{
+		// screen derivatives of the texture coordinate pick the
+		// mip level, like the GPU does from the pixel quad
+		float inverseWX = triangle.planeX[ATTRIBUTE_INVERSE_W];
+		float inverseWY = triangle.planeY[ATTRIBUTE_INVERSE_W];
+		glm::vec2 uvX = (glm::vec2(triangle.planeX[ATTRIBUTE_UV], triangle.planeX[ATTRIBUTE_UV + 1]) - uv * inverseWX) * w;
+		glm::vec2 uvY = (glm::vec2(triangle.planeY[ATTRIBUTE_UV], triangle.planeY[ATTRIBUTE_UV + 1]) - uv * inverseWY) * w;
+		glm::vec2 size((float)draw.pTexture->widths[0], (float)draw.pTexture->heights[0]);
+		float footprint = std::max(glm::length(uvX * size), glm::length(uvY * size));
+		float lod = (footprint > 0.0f) ? std::log2(footprint) : 0.0f;
+		textureColor = SampleTexture(*draw.pTexture, uv, lod);
+	}
+
+	glm::vec4 color;
+	if (command.bUseLighting)
+	{
+		RASTER_MATERIAL material = { glm::vec3(0.0f), 0.0f, glm::vec3(0.0f), glm::vec3(0.0f), 0.0f };
+		if (draw.materialIndex >= 0)
+		{
+			material = m_materials[draw.materialIndex];
+		}
+
+		float normalLength = glm::length(normal);
+		glm::vec3 lightNormal = (normalLength > 0.0f) ? normal / normalLength : normal;
+		glm::vec3 viewDirection = glm::normalize(m_viewPosition - position);
+		glm::vec3 phongResult(0.0f);
+		for (int i = 0; i < MAX_LIGHTS; i++)
+		{
+			phongResult += CalcLightSource(m_lights[i], material, lightNormal, position, viewDirection);
+		}
+
+		if (NULL != draw.pTexture)
+			color = glm::vec4(phongResult * glm::vec3(textureColor), 1.0f);
+		else
+			color = glm::vec4(phongResult * glm::vec3(command.color), command.color.a);
+	}
+	else
+	{
+		color = (NULL != draw.pTexture) ? textureColor : command.color;
+	}
+
+	size_t pixel = (size_t)y * m_width + x;
+	if (draw.bTransparent)
+	{
+		// blended over what is behind, without writing the depth
+		glm::vec4 destination = UnpackColor(m_colorBuffer[pixel]);
+		color = color * color.a + destination * (1.0f - color.a);
+	}
+	else
+	{
+		m_depthBuffer[pixel] = depth;
+	}
+	m_colorBuffer[pixel] = PackColor(color);
+}
+
+/***********************************************************
+ *  SampleTexture()
+ *
+ *  This method is used for reading a texture with repeat
+ *  wrapping and trilinear filtering, the sampler state the
+ *  texture streamer sets.
+ ***********************************************************/
+glm::vec4 SoftwareRasterizer::SampleTexture(const RASTER_TEXTURE& texture, const glm::vec2& uv, float lod) const
+{
+	int maxLevel = (int)texture.mips.size() - 1;
+	int levels[2] = { 0, 0 };
+	float blend = 0.0f;
+	if (lod >= (float)maxLevel)
+	{
+		levels[0] = maxLevel;
+		levels[1] = maxLevel;
+	}
+	else if (lod > 0.0f)
+	{
+		levels[0] = (int)lod;
+		levels[1] = levels[0] + 1;
+		blend = lod - (float)levels[0];
+	}
+
+	glm::vec4 samples[2];
+	for (int i = 0; i < 2; i++)
+	{
+		int level = levels[i];
+		int width = texture.widths[level];
+		int height = texture.heights[level];
+		const std::vector<uint32_t>& texels = texture.mips[level];
+
+		float u = uv.x * (float)width - 0.5f;
+		float v = uv.y * (float)height - 0.5f;
+		float u0 = std::floor(u);
+		float v0 = std::floor(v);
+		float fu = u - u0;
+		float fv = v - v0;
+		// repeat wrapping
+		int x0 = ((int)std::fmod(u0, (float)width) + width) % width;
+		int y0 = ((int)std::fmod(v0, (float)height) + height) % height;
+		int x1 = (x0 + 1) % width;
+		int y1 = (y0 + 1) % height;
+
+		glm::vec4 bottom = glm::mix(
+			UnpackColor(texels[(size_t)y0 * width + x0]), UnpackColor(texels[(size_t)y0 * width + x1]), fu);
+		glm::vec4 top = glm::mix(
+			UnpackColor(texels[(size_t)y1 * width + x0]), UnpackColor(texels[(size_t)y1 * width + x1]), fu);
+		samples[i] = glm::mix(bottom, top, fv);
+
+		if (levels[1] == levels[0])
+		{
+			return(samples[0]);
+		}
+	}
+
+	return(glm::mix(samples[0], samples[1], blend));
+}
+
+/***********************************************************
+ *  CalcLightSource()
+ *
+ *  This method is used for the light of one source, the
+ *  same terms as CalcLightSource() in the fragment shader
+ *  with the shadow fully lit.
+ ***********************************************************/
+glm::vec3 SoftwareRasterizer::CalcLightSource(
+	const RASTER_LIGHT& light,
+	const RASTER_MATERIAL& material,
+	const glm::vec3& lightNormal,
+	const glm::vec3& vertexPosition,
+	const glm::vec3& viewDirection) const
+{
+	glm::vec3 ambient = light.ambientColor + (material.ambientColor * material.ambientStrength);
+
+	glm::vec3 lightDirection = glm::normalize(light.position - vertexPosition);
+	float impact = std::max(glm::dot(lightNormal, lightDirection), 0.0f);
+	glm::vec3 diffuse = impact * material.diffuseColor;
+
+	glm::vec3 reflectDir = glm::reflect(-lightDirection, lightNormal);
+	float specularComponent = std::pow(std::max(glm::dot(viewDirection, reflectDir), 0.0f), light.focalStrength);
+	glm::vec3 specular = (light.specularIntensity * material.shininess) * specularComponent * material.specularColor;
+
+	return(ambient + diffuse + specular);
+}
@@ -0,0 +1,307 @@
+///////////////////////////////////////////////////////////////////////////////
+// softwarerasterizer.h
+// ============
+// draw the render queue on the CPU with tile-binned worker threads
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "RenderQueue.h"
+#include "SceneFile.h"
+#include "MeshImporter.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// the AVX2 edge functions are only built for x86 targets
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SOFTWARE_RASTERIZER_AVX2
+#endif
+
+/***********************************************************
+ *  SoftwareRasterizer
+ *
+ *  This class draws the commands of the render queue without
+ *  a GPU, for machines that only have a generic software
+ *  OpenGL driver.  It draws the same meshes and evaluates
+ *  the same part animations and Phong model as the shaders.
+ *  The triangles are set up on all the worker threads and
+ *  binned into screen tiles, then each worker rasterizes
+ *  whole tiles, testing eight pixels at a time against the
+ *  edge functions, with AVX2 when the CPU has it.  Shadows
+ *  are not drawn.  The color buffer can be copied into the
+ *  OpenGL framebuffer or compared with what OpenGL drew.
+ ***********************************************************/
+class SoftwareRasterizer
+{
+public:
+	// edge of the square screen tiles the triangles are binned into
+	static const int TILE_SIZE = 64;
+	// must match TOTAL_LIGHTS in the fragment shader
+	static const int MAX_LIGHTS = 4;
+
+	// light source values, as passed into the fragment shader
+	struct RASTER_LIGHT
+	{
+		glm::vec3 position;
+		glm::vec3 ambientColor;
+		glm::vec3 diffuseColor;
+		glm::vec3 specularColor;
+		float focalStrength;
+		float specularIntensity;
+	};
+
+	// material values, as passed into the fragment shader
+	struct RASTER_MATERIAL
+	{
+		glm::vec3 ambientColor;
+		float ambientStrength;
+		glm::vec3 diffuseColor;
+		glm::vec3 specularColor;
+		float shininess;
+	};
+
+	// how far the color buffer is from the OpenGL pixels
+	struct RASTER_DIFFERENCE
+	{
+		// average and largest channel difference, 0 to 1
+		float meanError;
+		float maxError;
+		// fraction of the pixels off by more than a few steps
+		float differentFraction;
+	};
+
+	// constructor
+	SoftwareRasterizer();
+	// destructor
+	~SoftwareRasterizer();
+
+	// start the workers, 0 for one per hardware thread
+	bool Initialize(int threadCount);
+	// decode a copy of the image drawn with an OpenGL texture
+	bool LoadTexture(int textureID, const char* filename);
+	// load a copy of the triangles of a loaded model
+	bool LoadModel(int model, const std::string& filename);
+	// copy the triangles of a model built in memory
+	void SetModel(
+		int model,
+		const std::string& name,
+		const MESH_VERTEX* pVertices,
+		const uint32_t* pIndices,
+		uint32_t indexCount);
+
+	// the scene values the shaders get as uniforms
+	void SetLight(int index, const RASTER_LIGHT& light);
+	void SetMaterials(const std::vector<RASTER_MATERIAL>& materials);
+	void SetAnimations(const SCENE_ANIMATION_RECORD* pRecords, uint32_t count);
+	void SetAnimationClock(float seconds);
+	void SetViewPosition(const glm::vec3& position);
+
+	// draw the commands of the order through the view into a
+	// color buffer of the given size
+	void Render(
+		const std::vector<DRAW_COMMAND>& commands,
+		const VIEW_ORDER& order,
+		const RENDER_VIEW& view,
+		int width,
+		int height,
+		const glm::vec4& clearColor);
+	// copy the color buffer into the bound draw framebuffer
+	void Present(int x, int y);
+	// compare the color buffer with the pixels of the bound
+	// read framebuffer at the position
+	void Compare(int x, int y, RASTER_DIFFERENCE& difference);
+
+	int GetThreadCount() const { return m_threadCount; }
+	// CPU time of the last Render() in milliseconds
+	double GetLastRenderMs() const { return m_lastRenderMs; }
+
+private:
+	// values interpolated across a triangle: window depth, 1/w,
+	// then the world position, the normal and the texture
+	// coordinate, each divided by w
+	enum RASTER_ATTRIBUTE
+	{
+		ATTRIBUTE_DEPTH = 0,
+		ATTRIBUTE_INVERSE_W,
+		ATTRIBUTE_POSITION,
+		ATTRIBUTE_NORMAL = ATTRIBUTE_POSITION + 3,
+		ATTRIBUTE_UV = ATTRIBUTE_NORMAL + 3,
+		ATTRIBUTE_COUNT = ATTRIBUTE_UV + 2
+	};
+
+	enum WORKER_PHASE
+	{
+		PHASE_SETUP = 0,
+		PHASE_TILES
+	};
+
+	struct RASTER_VERTEX
+	{
+		glm::vec3 position;
+		glm::vec3 normal;
+		glm::vec2 uv;
+	};
+
+	// vertex after the vertex shader, in clip space
+	struct CLIP_VERTEX
+	{
+		glm::vec4 clip;
+		// world position, normal and scaled texture coordinate
+		float values[8];
+	};
+
+	// vertex after the perspective divide, in window space
+	struct SCREEN_VERTEX
+	{
+		float x;
+		float y;
+		// the attributes in RASTER_ATTRIBUTE order
+		float values[ATTRIBUTE_COUNT];
+	};
+
+	struct RASTER_TEXTURE
+	{
+		// RGBA8 mip chain, finest level first
+		std::vector<std::vector<uint32_t>> mips;
+		std::vector<int> widths;
+		std::vector<int> heights;
+	};
+
+	// a command with the state the shaders would see for it
+	struct RASTER_DRAW
+	{
+		const DRAW_COMMAND* pCommand;
+		const RASTER_TEXTURE* pTexture;
+		int materialIndex;
+		bool bTransparent;
+	};
+
+	struct RASTER_TRIANGLE
+	{
+		// edge functions a * x + b * y + c, positive inside
+		float edgeA[3];
+		float edgeB[3];
+		float edgeC[3];
+		// edges that own the pixels exactly on them
+		bool bTopLeft[3];
+		// pixel bounds, inclusive
+		int minX;
+		int minY;
+		int maxX;
+		int maxY;
+		// attribute planes relative to the first vertex
+		float originX;
+		float originY;
+		float planeX[ATTRIBUTE_COUNT];
+		float planeY[ATTRIBUTE_COUNT];
+		float planeOrigin[ATTRIBUTE_COUNT];
+		uint32_t drawIndex;
+	};
+
+	// triangles set up by one worker and the tiles they touch
+	struct WORKER_BINS
+	{
+		std::vector<RASTER_TRIANGLE> triangles;
+		std::vector<std::vector<uint32_t>> tiles;
+	};
+
+	// meshes matching the basic shape meshes, as triangle lists
+	std::vector<RASTER_VERTEX> m_meshes[MESH_TYPE_COUNT];
+	// loaded models by model index, also as triangle lists
+	std::map<int, std::vector<RASTER_VERTEX>> m_models;
+	std::map<int, RASTER_TEXTURE> m_textures;
+	RASTER_LIGHT m_lights[MAX_LIGHTS];
+	std::vector<RASTER_MATERIAL> m_materials;
+	std::vector<SCENE_ANIMATION_RECORD> m_animations;
+	float m_animationClock;
+	glm::vec3 m_viewPosition;
+	// the material stays set in the shader until a command
+	// sets another one, so it carries over between frames
+	int m_currentMaterial;
+
+	// state of the frame being drawn
+	const std::vector<DRAW_COMMAND>* m_pCommands;
+	std::vector<RASTER_DRAW> m_draws;
+	glm::mat4 m_viewProjection;
+	int m_width;
+	int m_height;
+	int m_tilesX;
+	int m_tilesY;
+	uint32_t m_clearColor;
+	std::vector<uint32_t> m_colorBuffer;
+	std::vector<float> m_depthBuffer;
+	std::vector<WORKER_BINS> m_bins;
+	double m_lastRenderMs;
+
+	// worker threads, the calling thread is worker 0
+	int m_threadCount;
+	// the CPU can run the AVX2 edge functions
+	bool m_bAvx2;
+	std::vector<std::thread> m_workers;
+	std::mutex m_mutex;
+	std::condition_variable m_startCondition;
+	std::condition_variable m_doneCondition;
+	WORKER_PHASE m_phase;
+	uint64_t m_generation;
+	int m_workersDone;
+	bool m_bQuit;
+	std::atomic<int> m_nextTile;
+
+	// texture the color buffer is copied through
+	GLuint m_presentTexture;
+	GLuint m_presentFramebuffer;
+	int m_presentWidth;
+	int m_presentHeight;
+
+	// true when the CPU and the operating system support AVX2
+	static bool CpuHasAvx2();
+	void BuildMeshes();
+	// triangles of a basic mesh or a model, NULL when unknown
+	const std::vector<RASTER_VERTEX>* GetMesh(MESH_TYPE mesh) const;
+	void WorkerLoop(int worker);
+	// run a phase on all the workers and wait for them
+	void RunPhase(WORKER_PHASE phase);
+	void RunWorker(int worker, WORKER_PHASE phase);
+
+	// transform, clip and bin the triangles of a range of draws
+	void SetupDraws(int worker);
+	void ClipAndSetup(CLIP_VERTEX* pPolygon, int vertexCount, uint32_t drawIndex, WORKER_BINS& bins);
+	void SetupTriangle(
+		const SCREEN_VERTEX& v0,
+		const SCREEN_VERTEX& v1,
+		const SCREEN_VERTEX& v2,
+		uint32_t drawIndex,
+		WORKER_BINS& bins);
+	// clear the tiles taken from the shared counter and draw
+	// their triangles in submission order
+	void RasterizeTiles();
+	void RasterizeTriangle(const RASTER_TRIANGLE& triangle, int tileX, int tileY);
+	// the pixel loop of RasterizeTriangle() with AVX2, built in
+	// its own file and only called when m_bAvx2 is set
+	void RasterizeTriangleAvx2(
+		const RASTER_TRIANGLE& triangle,
+		int startX,
+		int endX,
+		int startY,
+		int endY,
+		float* pDepthBuffer);
+	// evaluate the fragment shader and write the pixel
+	void ShadePixel(const RASTER_TRIANGLE& triangle, int x, int y, float depth);
+	glm::vec4 SampleTexture(const RASTER_TEXTURE& texture, const glm::vec2& uv, float lod) const;
+	glm::vec3 CalcLightSource(
+		const RASTER_LIGHT& light,
+		const RASTER_MATERIAL& material,
+		const glm::vec3& lightNormal,
+		const glm::vec3& vertexPosition,
+		const glm::vec3& viewDirection) const;
+};
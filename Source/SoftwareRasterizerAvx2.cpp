@@ -0,0 +1,107 @@
+///////////////////////////////////////////////////////////////////////////////
+// softwarerasterizeravx2.cpp
+// ============
+// the AVX2 edge functions of the software rasterizer
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SoftwareRasterizer.h"
+
+#if defined(SOFTWARE_RASTERIZER_AVX2)
+
+#include <immintrin.h>
+
+// this file is built with AVX2 in the project; GCC and Clang
+// only enable it for the functions marked with the target
+#if defined(_MSC_VER) || defined(__AVX2__)
+#define AVX2_TARGET
+#else
+#define AVX2_TARGET __attribute__((target("avx2")))
+#endif
+
+/***********************************************************
+ *  RasterizeTriangleAvx2()
+ *
+ *  This method is used for testing eight pixels of a row at
+ *  a time against the edge functions and the depth buffer
+ *  with AVX2 and shading the ones that pass.  It must only
+ *  be called after CpuHasAvx2() returned true, and it calls
+ *  no inline functions from the headers, so no copy of them
+ *  built with AVX2 can end up in the rest of the program.
+ ***********************************************************/
+AVX2_TARGET void SoftwareRasterizer::RasterizeTriangleAvx2(
+	const RASTER_TRIANGLE& triangle,
+	int startX,
+	int endX,
+	int startY,
+	int endY,
+	float* pDepthBuffer)
+{
+	const float depthX = triangle.planeX[ATTRIBUTE_DEPTH];
+	const float depthY = triangle.planeY[ATTRIBUTE_DEPTH];
+	const float depthOrigin = triangle.planeOrigin[ATTRIBUTE_DEPTH];
+	float depths[8];
+
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 laneCenters = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+	const __m256i laneIndices = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	__m256 edgeA[3];
+	__m256 edgeB[3];
+	__m256 edgeC[3];
+	__m256 topLeft[3];
+	for (int e = 0; e < 3; e++)
+	{
+		edgeA[e] = _mm256_set1_ps(triangle.edgeA[e]);
+		edgeB[e] = _mm256_set1_ps(triangle.edgeB[e]);
+		edgeC[e] = _mm256_set1_ps(triangle.edgeC[e]);
+		topLeft[e] = _mm256_castsi256_ps(_mm256_set1_epi32(triangle.bTopLeft[e] ? -1 : 0));
+	}
+	const __m256 depthSlopeX = _mm256_set1_ps(depthX);
+	const __m256 originX = _mm256_set1_ps(triangle.originX);
+
+	for (int y = startY; y <= endY; y++)
+	{
+		float pixelY = (float)y + 0.5f;
+		__m256 centerY = _mm256_set1_ps(pixelY);
+		__m256 rowDepth = _mm256_set1_ps(depthOrigin + depthY * (pixelY - triangle.originY));
+		float* pDepthRow = pDepthBuffer + (size_t)y * m_width;
+
+		for (int x = startX; x <= endX; x += 8)
+		{
+			__m256 centerX = _mm256_add_ps(_mm256_set1_ps((float)x), laneCenters);
+			__m256 inside = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(endX - x + 1), laneIndices));
+			for (int e = 0; e < 3; e++)
+			{
+				__m256 value = _mm256_add_ps(
+					_mm256_add_ps(_mm256_mul_ps(edgeA[e], centerX), _mm256_mul_ps(edgeB[e], centerY)),
+					edgeC[e]);
+				__m256 covered = _mm256_or_ps(
+					_mm256_cmp_ps(value, zero, _CMP_GT_OQ),
+					_mm256_and_ps(_mm256_cmp_ps(value, zero, _CMP_EQ_OQ), topLeft[e]));
+				inside = _mm256_and_ps(inside, covered);
+			}
+			if (_mm256_movemask_ps(inside) == 0)
+			{
+				continue;
+			}
+
+			__m256 depth = _mm256_add_ps(rowDepth, _mm256_mul_ps(depthSlopeX, _mm256_sub_ps(centerX, originX)));
+			__m256 stored = _mm256_maskload_ps(pDepthRow + x, _mm256_castps_si256(inside));
+			int passed = _mm256_movemask_ps(_mm256_and_ps(inside, _mm256_cmp_ps(depth, stored, _CMP_LT_OQ)));
+			if (passed == 0)
+			{
+				continue;
+			}
+
+			_mm256_storeu_ps(depths, depth);
+			for (int lane = 0; lane < 8; lane++)
+			{
+				if (passed & (1 << lane))
+				{
+					ShadePixel(triangle, x + lane, y, depths[lane]);
+				}
+			}
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,324 @@
+///////////////////////////////////////////////////////////////////////////////
+// staticbatches.cpp
+// ============
+// merge the parts that never move apart into pre-transformed meshes
+///////////////////////////////////////////////////////////////////////////////
+
+#include "StaticBatches.h"
+#include "ShapeGeometry.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+
+// declaration of global variables
+namespace
+{
+	// the part values that must match for parts to be merged,
+	// compared bit for bit, and whether they are lightmapped
+	struct BATCH_KEY
+	{
+		uint32_t values[11];
+
+		bool operator<(const BATCH_KEY& other) const
+		{
+			return std::lexicographical_compare(values, values + 11, other.values, other.values + 11);
+		}
+	};
+
+	/***********************************************************
+	 *  MakeBatchKey()
+	 *
+	 *  This function is used for collecting the group and the
+	 *  draw state of a part.
+	 ***********************************************************/
+	BATCH_KEY MakeBatchKey(const SCENE_PART_RECORD& part, bool bLightmapped)
+	{
+		BATCH_KEY key;
+		key.values[0] = part.group;
+		key.values[1] = part.flags;
+		key.values[2] = (uint32_t)part.texture;
+		key.values[3] = (uint32_t)part.material;
+		memcpy(&key.values[4], part.color, sizeof(part.color));
+		memcpy(&key.values[8], part.uvScale, sizeof(part.uvScale));
+		key.values[10] = bLightmapped ? 1 : 0;
+		return(key);
+	}
+
+	/***********************************************************
+	 *  HashBytes()
+	 *
+	 *  This function is used for adding bytes to an FNV-1a
+	 *  hash.
+	 ***********************************************************/
+	uint64_t HashBytes(uint64_t hash, const void* pData, size_t size)
+	{
+		const unsigned char* pBytes = (const unsigned char*)pData;
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= pBytes[i];
+			hash *= 0x100000001B3ull;
+		}
+		return(hash);
+	}
+}
+
+/***********************************************************
+ *  StaticBatches()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+StaticBatches::StaticBatches()
+{
+	for (int mesh = 0; mesh < MESH_TYPE_COUNT; mesh++)
+	{
+		ShapeGeometry::BuildTriangles((MESH_TYPE)mesh, m_shapes[mesh]);
+	}
+}
+
+/***********************************************************
+ *  ~StaticBatches()
+ *
+ *  The destructor for the class, the model meshes delete the
+ *  buffers of the batches
+ ***********************************************************/
+StaticBatches::~StaticBatches()
+{
+}
+
+/***********************************************************
+ *  CanBatch()
+ *
+ *  This method is used for checking that a part can be
+ *  merged.  The vertex shaders turn animated parts about
+ *  their own origin, transparent parts are sorted one by one
+ *  and the models are large enough to be worth their own
+ *  draw.
+ ***********************************************************/
+bool StaticBatches::CanBatch(const SCENE_PART_RECORD& part)
+{
+	if ((part.mesh >= MESH_TYPE_COUNT) || (part.animation >= 0))
+	{
+		return(false);
+	}
+	return((part.texture >= 0) || (part.color[3] >= 1.0f));
+}
+
+/***********************************************************
+ *  HashParts()
+ *
+ *  This method is used for hashing what the merged triangles
+ *  are made of, the meshes and transforms of the parts.  The
+ *  draw state is taken from the part when it is drawn, so a
+ *  new color or texture needs no new triangles.  The atlas
+ *  coordinates of lightmapped parts move with the layout of
+ *  the atlas, so the hash of the lightmap is added for them.
+ ***********************************************************/
+uint64_t StaticBatches::HashParts(
+	const SCENE_PART_RECORD* pParts,
+	const uint32_t* pPartIndices,
+	uint32_t count,
+	const LightmapAtlas* pLightmapAtlas)
+{
+	uint64_t hash = 0xCBF29CE484222325ull;
+	if ((NULL != pLightmapAtlas) && (count > 0) && pLightmapAtlas->IsLightmapped(pPartIndices[0]))
+	{
+		uint64_t sceneHash = pLightmapAtlas->GetSceneHash();
+		hash = HashBytes(hash, &sceneHash, sizeof(sceneHash));
+	}
+	for (uint32_t i = 0; i < count; i++)
+	{
+		const SCENE_PART_RECORD& part = pParts[pPartIndices[i]];
+		hash = HashBytes(hash, &part.mesh, sizeof(part.mesh));
+		hash = HashBytes(hash, part.model, sizeof(part.model));
+	}
+	return(hash);
+}
+
+/***********************************************************
+ *  Build()
+ *
+ *  This method is used for grouping the parts that can be
+ *  merged by their group and draw state.  A group of two or
+ *  more parts becomes a batch, and so does every group of
+ *  lightmapped parts.  A batch made of the same
+ *  parts as one of the last build keeps its model, the
+ *  others take the model of a batch that went away or a new
+ *  one, and the models left over are emptied.
+ ***********************************************************/
+void StaticBatches::Build(
+	const SceneFile* pSceneFile,
+	ModelMeshes* pModelMeshes,
+	SoftwareRasterizer* pSoftwareRasterizer,
+	const LightmapAtlas* pLightmapAtlas)
+{
+	const SCENE_PART_RECORD* pParts = pSceneFile->GetParts();
+	uint32_t partCount = (NULL != pParts) ? pSceneFile->GetPartCount() : 0;
+
+	std::map<BATCH_KEY, std::vector<uint32_t>> groups;
+	for (uint32_t i = 0; i < partCount; i++)
+	{
+		if (CanBatch(pParts[i]))
+		{
+			bool bLightmapped = (NULL != pLightmapAtlas) && pLightmapAtlas->IsLightmapped(i);
+			groups[MakeBatchKey(pParts[i], bLightmapped)].push_back(i);
+		}
+	}
+
+	std::vector<STATIC_BATCH> oldBatches;
+	oldBatches.swap(m_batches);
+	m_batchParts.clear();
+	m_partBatches.assign(partCount, -1);
+
+	std::map<BATCH_KEY, std::vector<uint32_t>>::const_iterator it = groups.begin();
+	for (; it != groups.end(); ++it)
+	{
+		const std::vector<uint32_t>& parts = it->second;
+		bool bLightmapped = (it->first.values[10] != 0);
+		if ((parts.size() < 2) && !bLightmapped)
+		{
+			continue;
+		}
+
+		STATIC_BATCH batch;
+		batch.firstPart = (uint32_t)m_batchParts.size();
+		batch.partCount = (uint32_t)parts.size();
+		batch.model = -1;
+		batch.hash = HashParts(pParts, parts.data(), batch.partCount, pLightmapAtlas);
+		batch.bLightmapped = bLightmapped;
+		for (size_t i = 0; i < parts.size(); i++)
+		{
+			m_partBatches[parts[i]] = (int)m_batches.size();
+		}
+		m_batchParts.insert(m_batchParts.end(), parts.begin(), parts.end());
+		m_batches.push_back(batch);
+	}
+
+	// batches that did not change keep their triangles
+	for (size_t i = 0; i < m_batches.size(); i++)
+	{
+		for (size_t j = 0; j < oldBatches.size(); j++)
+		{
+			if ((oldBatches[j].model >= 0) && (oldBatches[j].hash == m_batches[i].hash))
+			{
+				m_batches[i].model = oldBatches[j].model;
+				oldBatches[j].model = -1;
+				break;
+			}
+		}
+	}
+	size_t firstFreed = m_freeModels.size();
+	for (size_t j = 0; j < oldBatches.size(); j++)
+	{
+		if (oldBatches[j].model >= 0)
+		{
+			m_freeModels.push_back(oldBatches[j].model);
+		}
+	}
+
+	int builtCount = 0;
+	for (size_t i = 0; i < m_batches.size(); i++)
+	{
+		STATIC_BATCH& batch = m_batches[i];
+		if (batch.model >= 0)
+		{
+			continue;
+		}
+		if (!m_freeModels.empty())
+		{
+			batch.model = m_freeModels.back();
+			m_freeModels.pop_back();
+		}
+		MergeParts(pParts, GetBatchParts((int)i), batch.partCount, batch.model,
+			pModelMeshes, pSoftwareRasterizer, pLightmapAtlas);
+		builtCount++;
+	}
+
+	// the models freed by this build that were not taken give
+	// back their memory, the newest free models go first
+	for (size_t i = firstFreed; i < m_freeModels.size(); i++)
+	{
+		MergeParts(pParts, NULL, 0, m_freeModels[i], pModelMeshes, pSoftwareRasterizer, pLightmapAtlas);
+	}
+
+	std::cout << "Static batches: " << m_batchParts.size() << " parts in " << m_batches.size()
+		<< " batches, " << builtCount << " built" << std::endl;
+}
+
+/***********************************************************
+ *  MergeParts()
+ *
+ *  This method is used for moving the triangles of the parts
+ *  by their part transforms and uploading them into a model,
+ *  created when the model is -1.  The shaders light with the
+ *  normals of the mesh as they are, so the normals are kept
+ *  to light the merged parts as before.  The tangent of a
+ *  lightmapped vertex is replaced by its atlas coordinate.
+ ***********************************************************/
+void StaticBatches::MergeParts(
+	const SCENE_PART_RECORD* pParts,
+	const uint32_t* pPartIndices,
+	uint32_t count,
+	int& model,
+	ModelMeshes* pModelMeshes,
+	SoftwareRasterizer* pSoftwareRasterizer,
+	const LightmapAtlas* pLightmapAtlas)
+{
+	m_vertices.clear();
+	m_indices.clear();
+	glm::vec3 boundsMin(0.0f);
+	glm::vec3 boundsMax(0.0f);
+	for (uint32_t i = 0; i < count; i++)
+	{
+		const SCENE_PART_RECORD& part = pParts[pPartIndices[i]];
+		const std::vector<MESH_VERTEX>& shape = m_shapes[part.mesh];
+		glm::mat4 transform = glm::make_mat4(part.model);
+		for (size_t v = 0; v < shape.size(); v++)
+		{
+			MESH_VERTEX vertex = shape[v];
+			glm::vec3 position = glm::vec3(transform * glm::vec4(
+				vertex.position[0], vertex.position[1], vertex.position[2], 1.0f));
+			vertex.position[0] = position.x;
+			vertex.position[1] = position.y;
+			vertex.position[2] = position.z;
+			if (NULL != pLightmapAtlas)
+			{
+				pLightmapAtlas->GetAtlasCoordinate(pPartIndices[i], (MESH_TYPE)part.mesh, shape[v], vertex.tangent);
+			}
+
+			if (m_vertices.empty())
+			{
+				boundsMin = position;
+				boundsMax = position;
+			}
+			boundsMin = glm::min(boundsMin, position);
+			boundsMax = glm::max(boundsMax, position);
+
+			m_indices.push_back((uint32_t)m_vertices.size());
+			m_vertices.push_back(vertex);
+		}
+	}
+
+	if (model < 0)
+	{
+		model = pModelMeshes->CreateModel("static batch " + std::to_string(pModelMeshes->GetModelCount()),
+			m_vertices.data(), (uint32_t)m_vertices.size(), m_indices.data(), (uint32_t)m_indices.size(),
+			boundsMin, boundsMax);
+	}
+	else
+	{
+		pModelMeshes->UpdateModel(model,
+			m_vertices.data(), (uint32_t)m_vertices.size(), m_indices.data(), (uint32_t)m_indices.size(),
+			boundsMin, boundsMax);
+	}
+
+	RenderQueue::SetModelBounds(model, boundsMin, boundsMax);
+	if (NULL != pSoftwareRasterizer)
+	{
+		pSoftwareRasterizer->SetModel(model, "static batch", m_vertices.data(), m_indices.data(), (uint32_t)m_indices.size());
+	}
+}
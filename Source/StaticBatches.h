@@ -0,0 +1,115 @@
+///////////////////////////////////////////////////////////////////////////////
+// staticbatches.h
+// ============
+// merge the parts that never move apart into pre-transformed meshes
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneFile.h"
+#include "ModelMeshes.h"
+#include "SoftwareRasterizer.h"
+#include "LightmapAtlas.h"
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  STATIC_BATCH
+ *
+ *  Parts of one group drawn with the same state, merged into
+ *  one model mesh.  The batch is drawn with the state of its
+ *  first part and the transform of the group.
+ ***********************************************************/
+struct STATIC_BATCH
+{
+	// first part in the batch and how many parts it has
+	uint32_t firstPart;
+	uint32_t partCount;
+	// model drawing the merged triangles
+	int model;
+	// hash of the state and meshes of the parts
+	uint64_t hash;
+	// true when the parts are baked into the lightmap, the
+	// vertices then carry the atlas coordinate in the tangent
+	bool bLightmapped;
+};
+
+/***********************************************************
+ *  StaticBatches
+ *
+ *  This class merges the parts of a scene file that keep
+ *  their place relative to their group.  The parts of a
+ *  group are only ever moved together, by the telemetry for
+ *  the drone, so the triangles of the parts that share a
+ *  texture, material, color, texture scale and flags are
+ *  moved by their part transforms once and drawn with one
+ *  call under the group transform.  Animated and transparent
+ *  parts and the imported models stay single draws.
+ *
+ *  The parts baked into the lightmap atlas are batched apart
+ *  from the others, even alone, since only the merged
+ *  vertices carry the coordinates of the atlas.
+ *
+ *  Each batch keeps its model mesh between builds, and a
+ *  batch whose parts did not change is not built again, so
+ *  a reloaded scene only uploads what was edited.
+ ***********************************************************/
+class StaticBatches
+{
+public:
+	// constructor
+	StaticBatches();
+	// destructor
+	~StaticBatches();
+
+	// merge the parts of the scene file, building only the
+	// batches that are new or whose parts changed.  The CPU
+	// rasterizer gets a copy of the batches when it is given,
+	// and the parts the lightmap atlas baked are merged with
+	// their atlas coordinates when it is given
+	void Build(
+		const SceneFile* pSceneFile,
+		ModelMeshes* pModelMeshes,
+		SoftwareRasterizer* pSoftwareRasterizer,
+		const LightmapAtlas* pLightmapAtlas);
+
+	// true when the part is drawn by one of the batches
+	bool IsBatched(uint32_t part) const { return (part < m_partBatches.size()) && (m_partBatches[part] >= 0); }
+	int GetBatchCount() const { return (int)m_batches.size(); }
+	const STATIC_BATCH& GetBatch(int batch) const { return m_batches[batch]; }
+	// parts of a batch, in scene file order
+	const uint32_t* GetBatchParts(int batch) const { return &m_batchParts[m_batches[batch].firstPart]; }
+
+private:
+	// triangles of the basic shape meshes
+	std::vector<MESH_VERTEX> m_shapes[MESH_TYPE_COUNT];
+	std::vector<STATIC_BATCH> m_batches;
+	// the parts of all the batches, a range for each batch
+	std::vector<uint32_t> m_batchParts;
+	// batch of each part, -1 for the parts drawn on their own
+	std::vector<int> m_partBatches;
+	// models of batches that went away, reused by new batches
+	std::vector<int> m_freeModels;
+	// vertices of the batch being merged
+	std::vector<MESH_VERTEX> m_vertices;
+	std::vector<uint32_t> m_indices;
+
+	// true when the part can be merged with others
+	static bool CanBatch(const SCENE_PART_RECORD& part);
+	// hash of the state and meshes of the parts of a batch
+	static uint64_t HashParts(
+		const SCENE_PART_RECORD* pParts,
+		const uint32_t* pPartIndices,
+		uint32_t count,
+		const LightmapAtlas* pLightmapAtlas);
+	// move the triangles of the parts into a model
+	void MergeParts(
+		const SCENE_PART_RECORD* pParts,
+		const uint32_t* pPartIndices,
+		uint32_t count,
+		int& model,
+		ModelMeshes* pModelMeshes,
+		SoftwareRasterizer* pSoftwareRasterizer,
+		const LightmapAtlas* pLightmapAtlas);
+};
@@ -0,0 +1,680 @@
+///////////////////////////////////////////////////////////////////////////////
+// swarmsimulation.cpp
+// ============
+// fly a swarm of drones with separation, alignment and waypoints
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SwarmSimulation.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+
+// SSE2 is part of every x64 target and of /arch:SSE2 and later on x86
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define SWARM_USE_SSE 1
+#include <emmintrin.h>
+#endif
+
+// declaration of global variables
+namespace
+{
+	// the fixed step, and the most steps one update may take
+	// so a long stall does not stall the next frames too
+	const double g_StepSeconds = 1.0 / 60.0;
+	const int g_MaxStepsPerUpdate = 4;
+
+	// the drones within this distance are neighbours, which
+	// is also the size of the cells of the spatial hash
+	const float g_NeighbourRadius = 4.0f;
+	// the drones within this distance are pushed apart
+	const float g_SeparationRadius = 2.0f;
+	// neighbours looked at per drone, a dense crowd costs no
+	// more than this
+	const int g_MaxNeighbours = 16;
+
+	const float g_SeparationWeight = 6.0f;
+	const float g_AlignmentWeight = 1.0f;
+	const float g_WaypointWeight = 1.5f;
+	const float g_MaxSpeed = 8.0f;
+	const float g_MaxAcceleration = 12.0f;
+
+	// the drones start on a grid at this spacing and height
+	const float g_StartSpacing = 3.0f;
+	const float g_StartAltitude = 6.0f;
+	// the drones never go below this height
+	const float g_MinAltitude = 1.0f;
+	// waypoints of the loop the swarm flies
+	const int g_WaypointCount = 6;
+
+	/***********************************************************
+	 *  HashBytes()
+	 *
+	 *  This function is used for adding bytes to an FNV-1a
+	 *  hash.
+	 ***********************************************************/
+	uint64_t HashBytes(uint64_t hash, const void* pData, size_t size)
+	{
+		const unsigned char* pBytes = (const unsigned char*)pData;
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= pBytes[i];
+			hash *= 0x100000001B3ull;
+		}
+		return(hash);
+	}
+
+	/***********************************************************
+	 *  Jitter()
+	 *
+	 *  This function is used for getting a repeatable offset
+	 *  between -0.5 and 0.5 for a drone and an axis.
+	 ***********************************************************/
+	float Jitter(uint32_t drone, uint32_t axis)
+	{
+		uint32_t value = drone * 0x9E3779B1u + axis * 0x85EBCA77u;
+		value ^= value >> 15;
+		value *= 0x2C1B3C6Du;
+		value ^= value >> 12;
+		return((float)(value & 0xFFFF) / 65535.0f - 0.5f);
+	}
+}
+
+/***********************************************************
+ *  SwarmSimulation()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SwarmSimulation::SwarmSimulation()
+{
+	m_droneCount = 0;
+	m_paddedCount = 0;
+	m_waypointRadius = 0.0f;
+	m_tableMask = 0;
+	m_stepCount = 0;
+	m_totalStepMs = 0.0;
+	m_timeAccumulator = 0.0;
+
+	m_threadCount = 1;
+	m_phase = PHASE_CELLS;
+	m_generation = 0;
+	m_workersDone = 0;
+	m_bQuit = false;
+}
+
+/***********************************************************
+ *  ~SwarmSimulation()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+SwarmSimulation::~SwarmSimulation()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bQuit = true;
+	}
+	m_startCondition.notify_all();
+	for (size_t i = 0; i < m_workers.size(); i++)
+	{
+		m_workers[i].join();
+	}
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for placing the drones on a grid,
+ *  laying out the waypoint loop around them and starting
+ *  the worker threads.  The drones start at the waypoints
+ *  in turn, so the swarm flies the loop in several groups
+ *  that meet and pass each other.
+ ***********************************************************/
+bool SwarmSimulation::Initialize(int droneCount, int threadCount)
+{
+	if ((droneCount <= 0) || (m_droneCount > 0))
+	{
+		std::cout << "The swarm needs at least one drone and is placed once" << std::endl;
+		return(false);
+	}
+
+	m_droneCount = droneCount;
+	m_paddedCount = (droneCount + 3) & ~3;
+	for (int c = 0; c < 3; c++)
+	{
+		m_position[c].assign(m_paddedCount, 0.0f);
+		m_velocity[c].assign(m_paddedCount, 0.0f);
+		m_acceleration[c].assign(m_paddedCount, 0.0f);
+		m_sortedPosition[c].assign(m_droneCount, 0.0f);
+		m_sortedVelocity[c].assign(m_droneCount, 0.0f);
+	}
+	m_waypoint.assign(m_droneCount, 0);
+	m_transforms.assign(m_droneCount, glm::mat4(1.0f));
+
+	int gridSize = (int)std::ceil(std::sqrt((double)droneCount));
+	float extent = gridSize * g_StartSpacing;
+	float loopRadius = std::max(20.0f, extent);
+	m_waypointRadius = std::max(4.0f, loopRadius * 0.35f);
+	m_waypoints.clear();
+	for (int i = 0; i < g_WaypointCount; i++)
+	{
+		float angle = 2.0f * 3.14159265358979f * (float)i / (float)g_WaypointCount;
+		m_waypoints.push_back(glm::vec3(loopRadius * std::cos(angle),
+			g_StartAltitude + 2.0f * (float)(i % 2), loopRadius * std::sin(angle)));
+	}
+
+	for (int i = 0; i < m_droneCount; i++)
+	{
+		m_position[0][i] = ((i % gridSize) - (gridSize - 1) * 0.5f + Jitter(i, 0)) * g_StartSpacing;
+		m_position[1][i] = g_StartAltitude + Jitter(i, 1) * g_StartSpacing;
+		m_position[2][i] = ((i / gridSize) - (gridSize - 1) * 0.5f + Jitter(i, 2)) * g_StartSpacing;
+		m_waypoint[i] = i % g_WaypointCount;
+		BuildTransform(i);
+	}
+
+	// at least twice as many slots as drones keeps the cells
+	// that share a slot few
+	uint32_t tableSize = 1;
+	while (tableSize < (uint32_t)m_droneCount * 2)
+	{
+		tableSize <<= 1;
+	}
+	m_tableMask = tableSize - 1;
+	m_cellOf.assign(m_droneCount, 0);
+	m_cellStart.assign(tableSize + 1, 0);
+	m_sortedDrones.assign(m_droneCount, 0);
+
+	if (threadCount <= 0)
+	{
+		threadCount = std::max((int)std::thread::hardware_concurrency(), 1);
+	}
+	m_threadCount = std::min(threadCount, std::max(m_paddedCount / 4, 1));
+	for (int i = 1; i < m_threadCount; i++)
+	{
+		m_workers.push_back(std::thread(&SwarmSimulation::WorkerLoop, this, i));
+	}
+
+#if defined(SWARM_USE_SSE)
+	const char* integration = "SSE2";
+#else
+	const char* integration = "scalar";
+#endif
+	std::cout << "Swarm simulation: " << m_droneCount << " drones, " << m_threadCount << " threads, "
+		<< integration << " integration, " << tableSize << " hash slots" << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for taking the fixed steps that fit
+ *  in the elapsed time.  The rest carries over to the next
+ *  update.
+ ***********************************************************/
+int SwarmSimulation::Update(double deltaSeconds)
+{
+	if (m_droneCount <= 0)
+	{
+		return(0);
+	}
+
+	m_timeAccumulator = std::min(m_timeAccumulator + std::max(deltaSeconds, 0.0),
+		g_StepSeconds * g_MaxStepsPerUpdate);
+	int steps = 0;
+	while (m_timeAccumulator >= g_StepSeconds)
+	{
+		Step();
+		m_timeAccumulator -= g_StepSeconds;
+		steps++;
+	}
+	return(steps);
+}
+
+/***********************************************************
+ *  Step()
+ *
+ *  This method is used for hashing the drones into their
+ *  cells, steering each drone from the drones around it and
+ *  moving all of them.  Every phase reads what the phase
+ *  before wrote for all the drones, so the workers meet in
+ *  between.
+ ***********************************************************/
+void SwarmSimulation::Step()
+{
+	if (m_droneCount <= 0)
+	{
+		return;
+	}
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	RunPhase(PHASE_CELLS);
+	SortByCell();
+	RunPhase(PHASE_STEER);
+	RunPhase(PHASE_INTEGRATE);
+
+	m_stepCount++;
+	m_totalStepMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+/***********************************************************
+ *  GetStepMs()
+ ***********************************************************/
+double SwarmSimulation::GetStepMs() const
+{
+	return((m_stepCount > 0) ? m_totalStepMs / (double)m_stepCount : 0.0);
+}
+
+/***********************************************************
+ *  GetStateHash()
+ ***********************************************************/
+uint64_t SwarmSimulation::GetStateHash() const
+{
+	uint64_t hash = 0xCBF29CE484222325ull;
+	for (int c = 0; c < 3; c++)
+	{
+		if (m_droneCount > 0)
+		{
+			hash = HashBytes(hash, m_position[c].data(), m_droneCount * sizeof(float));
+			hash = HashBytes(hash, m_velocity[c].data(), m_droneCount * sizeof(float));
+		}
+	}
+	return(hash);
+}
+
+/***********************************************************
+ *  RunBenchmark()
+ *
+ *  This method is used for timing the simulation alone.
+ *  The first steps spread the grid the drones start on, so
+ *  the time is reported for all the steps and the slowest.
+ ***********************************************************/
+bool SwarmSimulation::RunBenchmark(int droneCount, int stepCount, int threadCount)
+{
+	SwarmSimulation simulation;
+	if ((stepCount <= 0) || !simulation.Initialize(droneCount, threadCount))
+	{
+		return(false);
+	}
+
+	double slowestMs = 0.0;
+	for (int i = 0; i < stepCount; i++)
+	{
+		double totalMs = simulation.m_totalStepMs;
+		simulation.Step();
+		slowestMs = std::max(slowestMs, simulation.m_totalStepMs - totalMs);
+	}
+
+	std::cout << std::fixed << std::setprecision(3)
+		<< "SWARM: drones " << droneCount << " steps " << simulation.GetStepCount()
+		<< " threads " << simulation.GetThreadCount()
+		<< " step " << simulation.GetStepMs() << " ms, slowest " << slowestMs << " ms"
+		<< std::defaultfloat << " state " << std::hex << simulation.GetStateHash() << std::dec << std::endl;
+	return(true);
+}
+
+/***********************************************************
+ *  WorkerLoop()
+ *
+ *  This method is used for running the phases of the steps
+ *  on a worker thread until the simulation is destroyed.
+ ***********************************************************/
+void SwarmSimulation::WorkerLoop(int worker)
+{
+	uint64_t generation = 0;
+	while (true)
+	{
+		WORKER_PHASE phase;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_startCondition.wait(lock, [this, generation]() { return m_bQuit || (m_generation != generation); });
+			if (m_bQuit)
+			{
+				return;
+			}
+			generation = m_generation;
+			phase = m_phase;
+		}
+
+		RunWorker(worker, phase);
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_workersDone++;
+		m_doneCondition.notify_all();
+	}
+}
+
+/***********************************************************
+ *  RunPhase()
+ *
+ *  This method is used for starting a phase on the workers,
+ *  working on it from the calling thread and waiting until
+ *  all the workers are done.
+ ***********************************************************/
+void SwarmSimulation::RunPhase(WORKER_PHASE phase)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_phase = phase;
+		m_workersDone = 0;
+		m_generation++;
+	}
+	m_startCondition.notify_all();
+
+	RunWorker(0, phase);
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_doneCondition.wait(lock, [this]() { return m_workersDone == m_threadCount - 1; });
+}
+
+/***********************************************************
+ *  RunWorker()
+ *
+ *  This method is used for doing the share of a worker in
+ *  a phase.
+ ***********************************************************/
+void SwarmSimulation::RunWorker(int worker, WORKER_PHASE phase)
+{
+	int first = 0;
+	int last = 0;
+	GetWorkerRange(worker, first, last);
+
+	if (PHASE_CELLS == phase)
+	{
+		FindCells(first, std::min(last, m_droneCount));
+	}
+	else if (PHASE_STEER == phase)
+	{
+		SteerDrones(first, std::min(last, m_droneCount));
+	}
+	else
+	{
+		IntegrateDrones(first, last);
+	}
+}
+
+/***********************************************************
+ *  GetWorkerRange()
+ *
+ *  This method is used for splitting the padded drones into
+ *  a contiguous range for each worker, in groups of four.
+ ***********************************************************/
+void SwarmSimulation::GetWorkerRange(int worker, int& first, int& last) const
+{
+	long long groups = m_paddedCount / 4;
+	first = (int)(groups * worker / m_threadCount) * 4;
+	last = (int)(groups * (worker + 1) / m_threadCount) * 4;
+}
+
+/***********************************************************
+ *  GetCellHash()
+ *
+ *  This method is used for finding the slot of a cell.  The
+ *  cells next to each other along x get slots next to each
+ *  other, so a row of three cells is one run of the sorted
+ *  drones.
+ ***********************************************************/
+uint32_t SwarmSimulation::GetCellHash(int x, int y, int z) const
+{
+	uint32_t hash = (uint32_t)x + ((uint32_t)y * 19349663u) + ((uint32_t)z * 83492791u);
+	return(hash & m_tableMask);
+}
+
+/***********************************************************
+ *  FindCells()
+ *
+ *  This method is used for finding the slot of the spatial
+ *  hash the cell of each drone falls in.
+ ***********************************************************/
+void SwarmSimulation::FindCells(int first, int last)
+{
+	const float inverseCell = 1.0f / g_NeighbourRadius;
+	for (int i = first; i < last; i++)
+	{
+		m_cellOf[i] = GetCellHash(
+			(int)std::floor(m_position[0][i] * inverseCell),
+			(int)std::floor(m_position[1][i] * inverseCell),
+			(int)std::floor(m_position[2][i] * inverseCell));
+	}
+}
+
+/***********************************************************
+ *  SortByCell()
+ *
+ *  This method is used for sorting the drones by their slot
+ *  with a counting sort, which keeps the drones of a slot in
+ *  drone order so the neighbours are always visited in the
+ *  same order.  The slot starts are counted up to the slot
+ *  ends first and counted back down by the placing.
+ ***********************************************************/
+void SwarmSimulation::SortByCell()
+{
+	std::fill(m_cellStart.begin(), m_cellStart.end(), 0);
+	for (int i = 0; i < m_droneCount; i++)
+	{
+		m_cellStart[m_cellOf[i]]++;
+	}
+	uint32_t total = 0;
+	for (size_t slot = 0; slot + 1 < m_cellStart.size(); slot++)
+	{
+		total += m_cellStart[slot];
+		m_cellStart[slot] = total;
+	}
+	m_cellStart.back() = total;
+
+	for (int i = m_droneCount - 1; i >= 0; i--)
+	{
+		m_sortedDrones[--m_cellStart[m_cellOf[i]]] = (uint32_t)i;
+	}
+
+	for (int k = 0; k < m_droneCount; k++)
+	{
+		uint32_t drone = m_sortedDrones[k];
+		for (int c = 0; c < 3; c++)
+		{
+			m_sortedPosition[c][k] = m_position[c][drone];
+			m_sortedVelocity[c][k] = m_velocity[c][drone];
+		}
+	}
+}
+
+/***********************************************************
+ *  SteerDrones()
+ *
+ *  This method is used for adding up the pulls on each
+ *  drone: away from the drones too close to it, toward the
+ *  mean velocity of its neighbours, and toward its next
+ *  waypoint.  The 27 cells around the drone are read as
+ *  nine rows of three slots, skipping the slots two rows
+ *  share.  The range is of the drones sorted by cell, so the
+ *  drones one after another read the same neighbours.
+ ***********************************************************/
+void SwarmSimulation::SteerDrones(int first, int last)
+{
+	const float inverseCell = 1.0f / g_NeighbourRadius;
+	const float neighbourRadiusSquared = g_NeighbourRadius * g_NeighbourRadius;
+	const float separationRadiusSquared = g_SeparationRadius * g_SeparationRadius;
+
+	for (int sorted = first; sorted < last; sorted++)
+	{
+		uint32_t i = m_sortedDrones[sorted];
+		glm::vec3 position(m_sortedPosition[0][sorted], m_sortedPosition[1][sorted], m_sortedPosition[2][sorted]);
+		glm::vec3 velocity(m_sortedVelocity[0][sorted], m_sortedVelocity[1][sorted], m_sortedVelocity[2][sorted]);
+		int cellX = (int)std::floor(position.x * inverseCell);
+		int cellY = (int)std::floor(position.y * inverseCell);
+		int cellZ = (int)std::floor(position.z * inverseCell);
+
+		glm::vec3 separation(0.0f);
+		glm::vec3 velocitySum(0.0f);
+		int neighbourCount = 0;
+		uint32_t visited[27];
+		int visitedCount = 0;
+
+		for (int z = -1; (z <= 1) && (neighbourCount < g_MaxNeighbours); z++)
+		{
+			for (int y = -1; (y <= 1) && (neighbourCount < g_MaxNeighbours); y++)
+			{
+				uint32_t rowSlot = GetCellHash(cellX - 1, cellY + y, cellZ + z);
+				for (int x = 0; (x < 3) && (neighbourCount < g_MaxNeighbours); x++)
+				{
+					uint32_t slot = (rowSlot + x) & m_tableMask;
+					if (std::find(visited, visited + visitedCount, slot) != visited + visitedCount)
+					{
+						continue;
+					}
+					visited[visitedCount++] = slot;
+
+					for (uint32_t k = m_cellStart[slot]; k < m_cellStart[slot + 1]; k++)
+					{
+						if (k == (uint32_t)sorted)
+						{
+							continue;
+						}
+						glm::vec3 away(position.x - m_sortedPosition[0][k],
+							position.y - m_sortedPosition[1][k],
+							position.z - m_sortedPosition[2][k]);
+						float distanceSquared = glm::dot(away, away);
+						if ((distanceSquared > neighbourRadiusSquared) || (distanceSquared <= 0.0f))
+						{
+							continue;
+						}
+						if (distanceSquared < separationRadiusSquared)
+						{
+							separation += away / distanceSquared;
+						}
+						velocitySum += glm::vec3(m_sortedVelocity[0][k], m_sortedVelocity[1][k], m_sortedVelocity[2][k]);
+						if (++neighbourCount >= g_MaxNeighbours)
+						{
+							break;
+						}
+					}
+				}
+			}
+		}
+
+		glm::vec3 acceleration = separation * g_SeparationWeight;
+		if (neighbourCount > 0)
+		{
+			acceleration += (velocitySum / (float)neighbourCount - velocity) * g_AlignmentWeight;
+		}
+		glm::vec3 toWaypoint = m_waypoints[m_waypoint[i]] - position;
+		float waypointDistance = glm::length(toWaypoint);
+		if (waypointDistance > 0.0f)
+		{
+			acceleration += (toWaypoint * (g_MaxSpeed / waypointDistance) - velocity) * g_WaypointWeight;
+		}
+
+		float length = glm::length(acceleration);
+		if (length > g_MaxAcceleration)
+		{
+			acceleration *= g_MaxAcceleration / length;
+		}
+		m_acceleration[0][i] = acceleration.x;
+		m_acceleration[1][i] = acceleration.y;
+		m_acceleration[2][i] = acceleration.z;
+	}
+}
+
+/***********************************************************
+ *  IntegrateDrones()
+ *
+ *  This method is used for moving the drones of a range by
+ *  their velocity, limited to the top speed, four at a time.
+ *  The drones that reached their waypoint head for the next
+ *  one, and the transforms are built for the renderer.
+ ***********************************************************/
+void SwarmSimulation::IntegrateDrones(int first, int last)
+{
+	const float dt = (float)g_StepSeconds;
+
+#ifdef SWARM_USE_SSE
+	const __m128 step = _mm_set1_ps(dt);
+	const __m128 maxSpeed = _mm_set1_ps(g_MaxSpeed);
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 tiny = _mm_set1_ps(1e-12f);
+
+	for (int i = first; i < last; i += 4)
+	{
+		__m128 v[3];
+		for (int c = 0; c < 3; c++)
+		{
+			v[c] = _mm_add_ps(_mm_loadu_ps(&m_velocity[c][i]), _mm_mul_ps(_mm_loadu_ps(&m_acceleration[c][i]), step));
+		}
+
+		__m128 speedSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(v[0], v[0]), _mm_mul_ps(v[1], v[1])), _mm_mul_ps(v[2], v[2]));
+		__m128 scale = _mm_min_ps(one, _mm_div_ps(maxSpeed, _mm_sqrt_ps(_mm_max_ps(speedSquared, tiny))));
+
+		for (int c = 0; c < 3; c++)
+		{
+			v[c] = _mm_mul_ps(v[c], scale);
+			_mm_storeu_ps(&m_velocity[c][i], v[c]);
+			_mm_storeu_ps(&m_position[c][i], _mm_add_ps(_mm_loadu_ps(&m_position[c][i]), _mm_mul_ps(v[c], step)));
+		}
+	}
+#else
+	for (int i = first; i < last; i++)
+	{
+		float v[3];
+		for (int c = 0; c < 3; c++)
+		{
+			v[c] = m_velocity[c][i] + m_acceleration[c][i] * dt;
+		}
+
+		float speedSquared = v[0] * v[0] + v[1] * v[1] + v[2] * v[2];
+		float scale = std::min(1.0f, g_MaxSpeed / std::sqrt(std::max(speedSquared, 1e-12f)));
+
+		for (int c = 0; c < 3; c++)
+		{
+			m_velocity[c][i] = v[c] * scale;
+			m_position[c][i] += m_velocity[c][i] * dt;
+		}
+	}
+#endif
+
+	const float arrivalSquared = m_waypointRadius * m_waypointRadius;
+	for (int i = first; i < std::min(last, m_droneCount); i++)
+	{
+		if (m_position[1][i] < g_MinAltitude)
+		{
+			m_position[1][i] = g_MinAltitude;
+			m_velocity[1][i] = std::max(m_velocity[1][i], 0.0f);
+		}
+
+		const glm::vec3& waypoint = m_waypoints[m_waypoint[i]];
+		float dx = waypoint.x - m_position[0][i];
+		float dy = waypoint.y - m_position[1][i];
+		float dz = waypoint.z - m_position[2][i];
+		if (dx * dx + dy * dy + dz * dz < arrivalSquared)
+		{
+			m_waypoint[i] = (m_waypoint[i] + 1) % (int)m_waypoints.size();
+		}
+
+		BuildTransform(i);
+	}
+}
+
+/***********************************************************
+ *  BuildTransform()
+ *
+ *  This method is used for building the model matrix of a
+ *  drone, turned about the vertical so it faces the way it
+ *  flies.  A drone that is not moving across the ground
+ *  keeps its heading.
+ ***********************************************************/
+void SwarmSimulation::BuildTransform(int drone)
+{
+	glm::mat4& m = m_transforms[drone];
+	float vx = m_velocity[0][drone];
+	float vz = m_velocity[2][drone];
+	float groundSpeed = std::sqrt(vx * vx + vz * vz);
+	if (groundSpeed > 1e-3f)
+	{
+		float s = vx / groundSpeed;
+		float c = vz / groundSpeed;
+		m[0] = glm::vec4(c, 0.0f, -s, 0.0f);
+		m[1] = glm::vec4(0.0f, 1.0f, 0.0f, 0.0f);
+		m[2] = glm::vec4(s, 0.0f, c, 0.0f);
+	}
+	m[3] = glm::vec4(m_position[0][drone], m_position[1][drone], m_position[2][drone], 1.0f);
+}
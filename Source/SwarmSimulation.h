@@ -0,0 +1,135 @@
+///////////////////////////////////////////////////////////////////////////////
+// swarmsimulation.h
+// ============
+// fly a swarm of drones with separation, alignment and waypoints
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  SwarmSimulation
+ *
+ *  This class simulates the flight of a swarm.  Each drone
+ *  keeps its distance from the drones around it, matches
+ *  their heading and flies a loop of waypoints.  The state
+ *  is kept as a structure of arrays, padded to a multiple of
+ *  four so the integration runs on four drones at a time.
+ *
+ *  The neighbours are found through a uniform grid hashed
+ *  into a table, rebuilt every step with a counting sort.
+ *  The steps run on worker threads, each over a contiguous
+ *  range of drones, reading the state of the last step and
+ *  writing only its own drones, so the results are the same
+ *  for any thread count.  The step is fixed, so the same
+ *  drone count always flies the same way.
+ ***********************************************************/
+class SwarmSimulation
+{
+public:
+	// constructor
+	SwarmSimulation();
+	// destructor
+	~SwarmSimulation();
+
+	// place the drones and start the workers, 0 threads for
+	// one per hardware thread
+	bool Initialize(int droneCount, int threadCount);
+
+	// advance by the elapsed seconds in fixed steps, returns
+	// the number of steps taken
+	int Update(double deltaSeconds);
+	// take one fixed step
+	void Step();
+
+	// world transform of each drone, facing its velocity
+	int GetDroneCount() const { return m_droneCount; }
+	const std::vector<glm::mat4>& GetDroneTransforms() const { return m_transforms; }
+
+	int GetThreadCount() const { return m_threadCount; }
+	unsigned long long GetStepCount() const { return m_stepCount; }
+	// mean time of a step in milliseconds
+	double GetStepMs() const;
+	// hash of the positions and velocities, equal for runs
+	// that flew the same way
+	uint64_t GetStateHash() const;
+
+	// take the steps without drawing, print the step time and
+	// the state hash, for timing and for comparing thread counts
+	static bool RunBenchmark(int droneCount, int stepCount, int threadCount);
+
+private:
+	enum WORKER_PHASE
+	{
+		PHASE_CELLS = 0,
+		PHASE_STEER,
+		PHASE_INTEGRATE
+	};
+
+	int m_droneCount;
+	// drone count rounded up to a multiple of four
+	int m_paddedCount;
+
+	// state of the drones
+	std::vector<float> m_position[3];
+	std::vector<float> m_velocity[3];
+	std::vector<float> m_acceleration[3];
+	std::vector<int> m_waypoint;
+
+	// the waypoint loop, on a circle around the swarm
+	std::vector<glm::vec3> m_waypoints;
+	float m_waypointRadius;
+
+	// spatial hash of the last positions.  The drones are
+	// sorted by cell, and the positions and velocities are
+	// copied in that order so neighbours are read in a row
+	std::vector<uint32_t> m_cellOf;
+	std::vector<uint32_t> m_cellStart;
+	std::vector<uint32_t> m_sortedDrones;
+	std::vector<float> m_sortedPosition[3];
+	std::vector<float> m_sortedVelocity[3];
+	uint32_t m_tableMask;
+
+	std::vector<glm::mat4> m_transforms;
+	unsigned long long m_stepCount;
+	double m_totalStepMs;
+	double m_timeAccumulator;
+
+	// worker threads, the calling thread is worker 0
+	int m_threadCount;
+	std::vector<std::thread> m_workers;
+	std::mutex m_mutex;
+	std::condition_variable m_startCondition;
+	std::condition_variable m_doneCondition;
+	WORKER_PHASE m_phase;
+	uint64_t m_generation;
+	int m_workersDone;
+	bool m_bQuit;
+
+	void WorkerLoop(int worker);
+	// run a phase on all the workers and wait for them
+	void RunPhase(WORKER_PHASE phase);
+	void RunWorker(int worker, WORKER_PHASE phase);
+	// range of drones of a worker, a multiple of four long
+	void GetWorkerRange(int worker, int& first, int& last) const;
+
+	// hash the cell of each drone of the range
+	void FindCells(int first, int last);
+	// sort the drones by cell
+	void SortByCell();
+	// add up the pulls on each drone of the range
+	void SteerDrones(int first, int last);
+	// move the drones of the range and build their transforms
+	void IntegrateDrones(int first, int last);
+	// model matrix of a drone, facing along its velocity
+	void BuildTransform(int drone);
+
+	uint32_t GetCellHash(int x, int y, int z) const;
+};
@@ -0,0 +1,383 @@
+///////////////////////////////////////////////////////////////////////////////
+// telemetryingest.cpp
+// ============
+// receive live drone telemetry from other processes through shared memory
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TelemetryIngest.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <new>
+#include <thread>
+
+// declaration of global variables
+namespace
+{
+	// how long a producer waits for the viewer to create the ring
+	const int g_ProducerWaitSeconds = 10;
+
+	/***********************************************************
+	 *  WriteUpdate()
+	 *
+	 *  This function is used for claiming the next ring slot and
+	 *  writing one update into it.  The slot is marked as being
+	 *  written first, so a viewer reading it at the same time
+	 *  sees the sequence change and discards what it read.
+	 ***********************************************************/
+	void WriteUpdate(
+		TELEMETRY_RING_HEADER* pHeader,
+		TELEMETRY_RING_SLOT* pSlots,
+		uint32_t drone,
+		const TELEMETRY_RECORD& record)
+	{
+		uint64_t index = pHeader->writeIndex.fetch_add(1, std::memory_order_relaxed);
+		TELEMETRY_RING_SLOT& slot = pSlots[index & (pHeader->slotCount - 1)];
+
+		slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		slot.drone = drone;
+		slot.record = record;
+		slot.sequence.store(2 * index + 2, std::memory_order_release);
+	}
+
+	/***********************************************************
+	 *  ProduceUpdates()
+	 *
+	 *  This function is used for writing the updates of one
+	 *  producer thread.  The thread owns a range of drones and
+	 *  cycles through them, writing as many updates as its share
+	 *  of the rate allows and sleeping in between.
+	 ***********************************************************/
+	void ProduceUpdates(
+		TELEMETRY_RING_HEADER* pHeader,
+		TELEMETRY_RING_SLOT* pSlots,
+		int firstDrone,
+		int droneCount,
+		int gridSize,
+		double updatesPerSecond,
+		double durationSeconds,
+		unsigned long long* pWritten)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		unsigned long long written = 0;
+		int drone = 0;
+
+		while (pHeader->closed.load(std::memory_order_relaxed) == 0)
+		{
+			double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			if ((durationSeconds > 0.0) && (elapsed >= durationSeconds))
+			{
+				break;
+			}
+
+			unsigned long long due = (unsigned long long)(elapsed * updatesPerSecond);
+			for (; written < due; written++)
+			{
+				TELEMETRY_RECORD record = TelemetryPlayback::MakeSyntheticRecord(firstDrone + drone, gridSize, elapsed);
+				WriteUpdate(pHeader, pSlots, (uint32_t)(firstDrone + drone), record);
+				drone = (drone + 1) % droneCount;
+			}
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+
+		*pWritten = written;
+	}
+}
+
+/***********************************************************
+ *  TelemetryIngest()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TelemetryIngest::TelemetryIngest()
+{
+	m_pHeader = NULL;
+	m_pSlots = NULL;
+	m_readIndex = 0;
+	m_receivedCount = 0;
+	m_droppedCount = 0;
+	m_lateCount = 0;
+}
+
+/***********************************************************
+ *  ~TelemetryIngest()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TelemetryIngest::~TelemetryIngest()
+{
+	Close();
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for creating the shared ring that
+ *  the producers write to.  The slot count is rounded up to
+ *  a power of two so slot indices wrap with a mask.
+ ***********************************************************/
+bool TelemetryIngest::Create(const std::string& name, uint32_t slotCount, uint32_t droneCapacity)
+{
+	Close();
+
+	// the counters are shared with other processes, which only
+	// works when the atomics do not fall back to a hidden lock
+	std::atomic<uint64_t> probe(0);
+	if (!probe.is_lock_free())
+	{
+		std::cout << "Telemetry ingest needs lock-free 64-bit atomics" << std::endl;
+		return(false);
+	}
+
+	uint32_t ringSize = 1;
+	while (ringSize < slotCount)
+	{
+		ringSize <<= 1;
+	}
+
+	size_t size = sizeof(TELEMETRY_RING_HEADER) + (size_t)ringSize * sizeof(TELEMETRY_RING_SLOT);
+	if (!m_memory.Create(name, size))
+	{
+		std::cout << "Could not create telemetry ring:" << name << std::endl;
+		return(false);
+	}
+
+	// the block starts zeroed, the atomics are constructed in it
+	// and the magic is published last for the producers
+	m_pHeader = new (m_memory.GetData()) TELEMETRY_RING_HEADER();
+	m_pSlots = (TELEMETRY_RING_SLOT*)(m_memory.GetData() + sizeof(TELEMETRY_RING_HEADER));
+	for (uint32_t i = 0; i < ringSize; i++)
+	{
+		new (&m_pSlots[i].sequence) std::atomic<uint64_t>(0);
+	}
+	m_pHeader->version = TELEMETRY_RING_VERSION;
+	m_pHeader->slotCount = ringSize;
+	m_pHeader->droneCapacity = droneCapacity;
+	m_pHeader->closed.store(0, std::memory_order_relaxed);
+	m_pHeader->writeIndex.store(0, std::memory_order_relaxed);
+	m_pHeader->magic.store(TELEMETRY_RING_MAGIC, std::memory_order_release);
+
+	m_readIndex = 0;
+	m_receivedCount = 0;
+	m_droppedCount = 0;
+	m_lateCount = 0;
+
+	std::cout << "Created telemetry ring:" << name << ", slots:" << ringSize
+		<< ", drones:" << droneCapacity << std::endl;
+	return(true);
+}
+
+/***********************************************************
+ *  Close()
+ *
+ *  This method is used for telling the producers to stop,
+ *  reporting the update counts and removing the ring.
+ ***********************************************************/
+void TelemetryIngest::Close()
+{
+	if (NULL != m_pHeader)
+	{
+		m_pHeader->closed.store(1, std::memory_order_relaxed);
+		std::cout << "INGEST: received " << m_receivedCount << " updates, dropped "
+			<< m_droppedCount << ", late " << m_lateCount << std::endl;
+	}
+
+	m_memory.Close();
+	m_pHeader = NULL;
+	m_pSlots = NULL;
+	m_readIndex = 0;
+	m_latestTimes.clear();
+	m_transforms.clear();
+}
+
+/***********************************************************
+ *  Poll()
+ *
+ *  This method is used for reading the updates written since
+ *  the last frame.  When the producers have lapped the viewer
+ *  the overwritten updates are skipped.  Reading stops at
+ *  the first slot a producer is still writing, it is read on
+ *  the next frame.
+ ***********************************************************/
+bool TelemetryIngest::Poll()
+{
+	if (NULL == m_pHeader)
+	{
+		return(false);
+	}
+	unsigned long long receivedCount = m_receivedCount;
+	unsigned long long lateCount = m_lateCount;
+
+	uint64_t slotCount = m_pHeader->slotCount;
+	uint64_t mask = slotCount - 1;
+	uint64_t writeIndex = m_pHeader->writeIndex.load(std::memory_order_acquire);
+
+	if (writeIndex - m_readIndex > slotCount)
+	{
+		m_droppedCount += writeIndex - slotCount - m_readIndex;
+		m_readIndex = writeIndex - slotCount;
+	}
+
+	while (m_readIndex < writeIndex)
+	{
+		const TELEMETRY_RING_SLOT& slot = m_pSlots[m_readIndex & mask];
+		uint64_t expected = 2 * m_readIndex + 2;
+		uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+
+		if (sequence < expected)
+		{
+			break;
+		}
+		if (sequence == expected)
+		{
+			uint32_t drone = slot.drone;
+			TELEMETRY_RECORD record = slot.record;
+
+			// the slot must not have been claimed again while it
+			// was being read
+			std::atomic_thread_fence(std::memory_order_acquire);
+			sequence = slot.sequence.load(std::memory_order_relaxed);
+			if (sequence == expected)
+			{
+				ApplyUpdate(drone, record);
+			}
+		}
+		if (sequence != expected)
+		{
+			m_droppedCount++;
+		}
+		m_readIndex++;
+	}
+
+	// late updates are counted as received but move nothing
+	return((m_receivedCount - receivedCount) > (m_lateCount - lateCount));
+}
+
+/***********************************************************
+ *  ApplyUpdate()
+ *
+ *  This method is used for moving a drone to the pose of an
+ *  update, unless a newer update for it was already applied.
+ ***********************************************************/
+void TelemetryIngest::ApplyUpdate(uint32_t drone, const TELEMETRY_RECORD& record)
+{
+	if (drone >= m_pHeader->droneCapacity)
+	{
+		m_droppedCount++;
+		return;
+	}
+	m_receivedCount++;
+
+	// drones that have not reported yet collapse to a point
+	if (drone >= m_transforms.size())
+	{
+		m_transforms.resize(drone + 1, glm::mat4(0.0f));
+		m_latestTimes.resize(drone + 1, -1.0);
+	}
+	if (record.time < m_latestTimes[drone])
+	{
+		m_lateCount++;
+		return;
+	}
+	m_latestTimes[drone] = record.time;
+
+	float x = record.rotation[0];
+	float y = record.rotation[1];
+	float z = record.rotation[2];
+	float w = record.rotation[3];
+
+	glm::mat4& m = m_transforms[drone];
+	m[0] = glm::vec4(1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y + w * z), 2.0f * (x * z - w * y), 0.0f);
+	m[1] = glm::vec4(2.0f * (x * y - w * z), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z + w * x), 0.0f);
+	m[2] = glm::vec4(2.0f * (x * z + w * y), 2.0f * (y * z - w * x), 1.0f - 2.0f * (x * x + y * y), 0.0f);
+	m[3] = glm::vec4(record.position[0], record.position[1], record.position[2], 1.0f);
+}
+
+/***********************************************************
+ *  RunProducer()
+ *
+ *  This method is used for running the stand-in simulator.
+ *  It waits for the viewer to create the ring, then writes
+ *  drone poses from several threads at the requested rate.
+ ***********************************************************/
+bool TelemetryIngest::RunProducer(
+	const std::string& name,
+	int droneCount,
+	double updatesPerSecond,
+	double durationSeconds,
+	int threadCount)
+{
+	if ((droneCount <= 0) || (updatesPerSecond <= 0.0) || (threadCount <= 0))
+	{
+		return(false);
+	}
+	if (threadCount > droneCount)
+	{
+		threadCount = droneCount;
+	}
+
+	SharedMemory memory;
+	TELEMETRY_RING_HEADER* pHeader = NULL;
+	for (int attempt = 0; attempt <= g_ProducerWaitSeconds * 10; attempt++)
+	{
+		if (memory.Open(name) && (memory.GetSize() >= sizeof(TELEMETRY_RING_HEADER)))
+		{
+			pHeader = (TELEMETRY_RING_HEADER*)memory.GetData();
+			if (pHeader->magic.load(std::memory_order_acquire) == TELEMETRY_RING_MAGIC)
+			{
+				break;
+			}
+		}
+		pHeader = NULL;
+		if (attempt == 0)
+		{
+			std::cout << "Waiting for telemetry ring:" << name << std::endl;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	}
+
+	if ((NULL == pHeader) || (pHeader->version != TELEMETRY_RING_VERSION) ||
+		(memory.GetSize() < sizeof(TELEMETRY_RING_HEADER) + (size_t)pHeader->slotCount * sizeof(TELEMETRY_RING_SLOT)))
+	{
+		std::cout << "Could not open telemetry ring:" << name << std::endl;
+		return(false);
+	}
+	if ((uint32_t)droneCount > pHeader->droneCapacity)
+	{
+		std::cout << "Telemetry ring:" << name << " holds only " << pHeader->droneCapacity << " drones" << std::endl;
+		return(false);
+	}
+
+	TELEMETRY_RING_SLOT* pSlots = (TELEMETRY_RING_SLOT*)(memory.GetData() + sizeof(TELEMETRY_RING_HEADER));
+	int gridSize = (int)std::ceil(std::sqrt((double)droneCount));
+
+	std::cout << "Producing telemetry:" << name << ", drones:" << droneCount
+		<< ", rate:" << updatesPerSecond << "/s, threads:" << threadCount << std::endl;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::vector<std::thread> threads;
+	std::vector<unsigned long long> written(threadCount, 0);
+	for (int t = 0; t < threadCount; t++)
+	{
+		int firstDrone = (int)((long long)droneCount * t / threadCount);
+		int lastDrone = (int)((long long)droneCount * (t + 1) / threadCount);
+		threads.push_back(std::thread(ProduceUpdates, pHeader, pSlots, firstDrone, lastDrone - firstDrone,
+			gridSize, updatesPerSecond / threadCount, durationSeconds, &written[t]));
+	}
+
+	unsigned long long total = 0;
+	for (int t = 0; t < threadCount; t++)
+	{
+		threads[t].join();
+		total += written[t];
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	std::cout << "PRODUCER: wrote " << total << " updates in " << seconds << "s ("
+		<< (unsigned long long)(total / std::max(seconds, 1e-6)) << "/s)" << std::endl;
+	return(true);
+}
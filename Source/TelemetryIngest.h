@@ -0,0 +1,119 @@
+///////////////////////////////////////////////////////////////////////////////
+// telemetryingest.h
+// ============
+// receive live drone telemetry from other processes through shared memory
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SharedMemory.h"
+#include "TelemetryPlayback.h"
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// the viewer creates the shared block, producers open it and
+// claim ring slots with an atomic counter.  A slot sequence is
+// odd while its update is being written and even once it is
+// complete, so the viewer can tell finished, unfinished and
+// overwritten slots apart without a lock.
+//
+//   TELEMETRY_RING_HEADER
+//   TELEMETRY_RING_SLOT   slots[slotCount]
+#define TELEMETRY_RING_MAGIC 0x474E5254u   // "TRNG"
+#define TELEMETRY_RING_VERSION 1u
+
+struct TELEMETRY_RING_HEADER
+{
+	// written last by the viewer once the block is ready
+	std::atomic<uint32_t> magic;
+	uint32_t version;
+	// always a power of two
+	uint32_t slotCount;
+	uint32_t droneCapacity;
+	// set by the viewer when it stops consuming
+	std::atomic<uint32_t> closed;
+	unsigned char padding0[44];
+	// next slot to be claimed, on its own cache line
+	std::atomic<uint64_t> writeIndex;
+	unsigned char padding1[56];
+};
+
+struct TELEMETRY_RING_SLOT
+{
+	// 2 * index + 1 while written, 2 * index + 2 when complete
+	std::atomic<uint64_t> sequence;
+	uint32_t drone;
+	uint32_t reserved;
+	TELEMETRY_RECORD record;
+	unsigned char padding[8];
+};
+
+static_assert(sizeof(TELEMETRY_RING_HEADER) == 128, "telemetry ring header must be two cache lines");
+static_assert(sizeof(TELEMETRY_RING_SLOT) == 64, "telemetry ring slot must be one cache line");
+
+/***********************************************************
+ *  TelemetryIngest
+ *
+ *  This class receives live drone poses from simulator
+ *  processes on the same machine through a lock-free ring in
+ *  shared memory.  Any number of producers can write to the
+ *  ring and the viewer drains it once per frame without
+ *  locks or system calls.  Updates overwritten before they
+ *  were read are counted as dropped and updates older than
+ *  the pose already shown are counted as late.
+ ***********************************************************/
+class TelemetryIngest
+{
+public:
+	// constructor
+	TelemetryIngest();
+	// destructor
+	~TelemetryIngest();
+
+	// create the named ring for the producers to write to
+	bool Create(const std::string& name, uint32_t slotCount = 65536, uint32_t droneCapacity = 4096);
+	void Close();
+
+	// read every update written since the last call, returns
+	// true when a drone moved
+	bool Poll();
+
+	// world transform of each drone from its latest update
+	int GetDroneCount() const { return (int)m_transforms.size(); }
+	const std::vector<glm::mat4>& GetDroneTransforms() const { return m_transforms; }
+
+	unsigned long long GetReceivedCount() const { return m_receivedCount; }
+	unsigned long long GetDroppedCount() const { return m_droppedCount; }
+	unsigned long long GetLateCount() const { return m_lateCount; }
+
+	// stand-in simulator writing drones flying circles into the
+	// named ring until the duration is over or the viewer closes
+	static bool RunProducer(
+		const std::string& name,
+		int droneCount,
+		double updatesPerSecond,
+		double durationSeconds,
+		int threadCount = 2);
+
+private:
+	SharedMemory m_memory;
+	TELEMETRY_RING_HEADER* m_pHeader;
+	TELEMETRY_RING_SLOT* m_pSlots;
+	uint64_t m_readIndex;
+
+	// time of the update each transform was built from
+	std::vector<double> m_latestTimes;
+	std::vector<glm::mat4> m_transforms;
+
+	unsigned long long m_receivedCount;
+	unsigned long long m_droppedCount;
+	unsigned long long m_lateCount;
+
+	// apply one complete update to its drone
+	void ApplyUpdate(uint32_t drone, const TELEMETRY_RECORD& record);
+};
@@ -0,0 +1,633 @@
+///////////////////////////////////////////////////////////////////////////////
+// telemetryplayback.cpp
+// ============
+// replay recorded drone flights from telemetry log files
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TelemetryPlayback.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+// SSE2 is part of every x64 target and of /arch:SSE2 and later on x86
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define TELEMETRY_USE_SSE 1
+#include <emmintrin.h>
+#endif
+
+// declaration of global variables
+namespace
+{
+	/***********************************************************
+	 *  WriteValue()
+	 *
+	 *  This function is used for writing a block of plain data
+	 *  and adding its size to the running file offset.
+	 ***********************************************************/
+	bool WriteValue(FILE* pFile, const void* pData, size_t size, uint64_t& offset)
+	{
+		offset += size;
+		return(fwrite(pData, 1, size, pFile) == size);
+	}
+}
+
+/***********************************************************
+ *  TelemetryPlayback()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TelemetryPlayback::TelemetryPlayback()
+{
+	m_pHeader = NULL;
+	m_pBlocks = NULL;
+	m_useCounter = 0;
+	m_time = 0.0;
+	m_speed = 1.0;
+	m_bPaused = false;
+	m_bLooping = true;
+
+	for (int i = 0; i < TOTAL_CACHED_BLOCKS; i++)
+	{
+		m_cachedBlocks[i].blockIndex = -1;
+		m_cachedBlocks[i].lastUsed = 0;
+		m_cachedBlocks[i].pTracks = NULL;
+		m_cachedBlocks[i].pRecords = NULL;
+	}
+}
+
+/***********************************************************
+ *  ~TelemetryPlayback()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TelemetryPlayback::~TelemetryPlayback()
+{
+	Close();
+}
+
+/***********************************************************
+ *  Open()
+ *
+ *  This method is used for mapping the header and the block
+ *  index of a telemetry log.  The blocks themselves are only
+ *  mapped when the playback reaches them.
+ ***********************************************************/
+bool TelemetryPlayback::Open(const std::string& filename)
+{
+	Close();
+
+	if (!m_indexFile.Open(filename, 0, sizeof(TELEMETRY_FILE_HEADER)))
+	{
+		std::cout << "Could not open telemetry file:" << filename << std::endl;
+		return(false);
+	}
+
+	TELEMETRY_FILE_HEADER header;
+	memcpy(&header, m_indexFile.GetData(), sizeof(header));
+	unsigned long long fileSize = m_indexFile.GetFileSize();
+	size_t indexSize = sizeof(TELEMETRY_FILE_HEADER) + (size_t)header.blockCount * sizeof(TELEMETRY_BLOCK_INFO);
+
+	if ((header.magic != TELEMETRY_FILE_MAGIC) ||
+		(header.version != TELEMETRY_FILE_VERSION) ||
+		(header.droneCount == 0) || (header.blockCount == 0) ||
+		(indexSize > fileSize) ||
+		!m_indexFile.Open(filename, 0, indexSize))
+	{
+		std::cout << "Invalid telemetry file:" << filename << std::endl;
+		Close();
+		return(false);
+	}
+
+	m_pHeader = (const TELEMETRY_FILE_HEADER*)m_indexFile.GetData();
+	m_pBlocks = (const TELEMETRY_BLOCK_INFO*)(m_indexFile.GetData() + sizeof(TELEMETRY_FILE_HEADER));
+
+	// the blocks must be in time order and inside the file
+	size_t trackBytes = (size_t)header.droneCount * sizeof(TELEMETRY_TRACK_RANGE);
+	for (uint32_t i = 0; i < header.blockCount; i++)
+	{
+		const TELEMETRY_BLOCK_INFO& block = m_pBlocks[i];
+		if (((block.offset % 8) != 0) ||
+			(block.size < trackBytes) ||
+			(block.offset + block.size > fileSize) ||
+			(block.endTime < block.startTime) ||
+			((i > 0) && (block.startTime < m_pBlocks[i - 1].startTime)))
+		{
+			std::cout << "Invalid telemetry file:" << filename << std::endl;
+			Close();
+			return(false);
+		}
+	}
+
+	m_filename = filename;
+	size_t paddedCount = (header.droneCount + 3) & ~3u;
+	for (int i = 0; i < 3; i++)
+	{
+		m_batch.fromPosition[i].assign(paddedCount, 0.0f);
+		m_batch.toPosition[i].assign(paddedCount, 0.0f);
+		m_batch.position[i].assign(paddedCount, 0.0f);
+	}
+	for (int i = 0; i < 4; i++)
+	{
+		// the padding lanes hold identity rotations
+		m_batch.fromRotation[i].assign(paddedCount, (i == 3) ? 1.0f : 0.0f);
+		m_batch.toRotation[i].assign(paddedCount, (i == 3) ? 1.0f : 0.0f);
+		m_batch.rotation[i].assign(paddedCount, 0.0f);
+	}
+	m_batch.factor.assign(paddedCount, 0.0f);
+	m_transforms.assign(header.droneCount, glm::mat4(1.0f));
+
+	std::cout << "Opened telemetry file:" << filename << ", drones:" << header.droneCount
+		<< ", blocks:" << header.blockCount << ", duration:" << (header.endTime - header.startTime) << "s" << std::endl;
+
+	SetTime(header.startTime);
+	return(true);
+}
+
+/***********************************************************
+ *  Close()
+ *
+ *  This method is used for unmapping the telemetry log.
+ ***********************************************************/
+void TelemetryPlayback::Close()
+{
+	for (int i = 0; i < TOTAL_CACHED_BLOCKS; i++)
+	{
+		m_cachedBlocks[i].file.Close();
+		m_cachedBlocks[i].blockIndex = -1;
+		m_cachedBlocks[i].pTracks = NULL;
+		m_cachedBlocks[i].pRecords = NULL;
+	}
+	m_indexFile.Close();
+	m_pHeader = NULL;
+	m_pBlocks = NULL;
+	m_transforms.clear();
+}
+
+/***********************************************************
+ *  GetStartTime()
+ *
+ *  This method is used for getting the time of the first
+ *  record of the log.
+ ***********************************************************/
+double TelemetryPlayback::GetStartTime() const
+{
+	return((NULL != m_pHeader) ? m_pHeader->startTime : 0.0);
+}
+
+/***********************************************************
+ *  GetEndTime()
+ *
+ *  This method is used for getting the time of the last
+ *  record of the log.
+ ***********************************************************/
+double TelemetryPlayback::GetEndTime() const
+{
+	return((NULL != m_pHeader) ? m_pHeader->endTime : 0.0);
+}
+
+/***********************************************************
+ *  SetTime()
+ *
+ *  This method is used for seeking to a time of the log,
+ *  clamped to the recorded range.  The poses are updated
+ *  right away so scrubbing works while paused.
+ ***********************************************************/
+void TelemetryPlayback::SetTime(double time)
+{
+	m_time = std::min(std::max(time, GetStartTime()), GetEndTime());
+	Update(0.0);
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for advancing the playback time by
+ *  the frame time scaled by the playback speed, and then
+ *  interpolating the pose of every drone at that time.
+ ***********************************************************/
+void TelemetryPlayback::Update(double deltaSeconds)
+{
+	if (NULL == m_pHeader)
+	{
+		return;
+	}
+
+	double startTime = m_pHeader->startTime;
+	double endTime = m_pHeader->endTime;
+	double duration = endTime - startTime;
+
+	if (!m_bPaused)
+	{
+		m_time += deltaSeconds * m_speed;
+	}
+	if ((m_time > endTime) || (m_time < startTime))
+	{
+		if (m_bLooping && (duration > 0.0))
+		{
+			m_time = startTime + std::fmod(std::fmod(m_time - startTime, duration) + duration, duration);
+		}
+		else
+		{
+			m_time = std::min(std::max(m_time, startTime), endTime);
+		}
+	}
+
+	MAPPED_BLOCK* pBlock = MapBlock(FindBlock(m_time));
+	if (NULL == pBlock)
+	{
+		return;
+	}
+
+	GatherRecords(pBlock, m_time);
+	InterpolateBatch();
+	BuildTransforms();
+}
+
+/***********************************************************
+ *  FindBlock()
+ *
+ *  This method is used for finding the block covering the
+ *  time with a binary search over the block start times.
+ ***********************************************************/
+int TelemetryPlayback::FindBlock(double time) const
+{
+	const TELEMETRY_BLOCK_INFO* pFirst = m_pBlocks;
+	const TELEMETRY_BLOCK_INFO* pLast = m_pBlocks + m_pHeader->blockCount;
+	const TELEMETRY_BLOCK_INFO* pFound = std::upper_bound(pFirst, pLast, time,
+		[](double value, const TELEMETRY_BLOCK_INFO& block) { return value < block.startTime; });
+
+	return(std::max(0, (int)(pFound - pFirst) - 1));
+}
+
+/***********************************************************
+ *  MapBlock()
+ *
+ *  This method is used for getting a mapped block.  The two
+ *  most recently used blocks stay mapped, which covers the
+ *  crossing from one block into the next and scrubbing back
+ *  and forth over a block boundary.
+ ***********************************************************/
+TelemetryPlayback::MAPPED_BLOCK* TelemetryPlayback::MapBlock(int blockIndex)
+{
+	m_useCounter++;
+
+	MAPPED_BLOCK* pOldest = &m_cachedBlocks[0];
+	for (int i = 0; i < TOTAL_CACHED_BLOCKS; i++)
+	{
+		if (m_cachedBlocks[i].blockIndex == blockIndex)
+		{
+			m_cachedBlocks[i].lastUsed = m_useCounter;
+			return(&m_cachedBlocks[i]);
+		}
+		if (m_cachedBlocks[i].lastUsed < pOldest->lastUsed)
+		{
+			pOldest = &m_cachedBlocks[i];
+		}
+	}
+
+	const TELEMETRY_BLOCK_INFO& info = m_pBlocks[blockIndex];
+	pOldest->blockIndex = -1;
+	if (!pOldest->file.Open(m_filename, info.offset, (size_t)info.size))
+	{
+		std::cout << "Could not map telemetry block " << blockIndex << std::endl;
+		return(NULL);
+	}
+
+	// the track ranges must stay inside the records of the block
+	size_t trackBytes = (size_t)m_pHeader->droneCount * sizeof(TELEMETRY_TRACK_RANGE);
+	uint64_t recordCount = (info.size - trackBytes) / sizeof(TELEMETRY_RECORD);
+	const TELEMETRY_TRACK_RANGE* pTracks = (const TELEMETRY_TRACK_RANGE*)pOldest->file.GetData();
+	for (uint32_t i = 0; i < m_pHeader->droneCount; i++)
+	{
+		if ((uint64_t)pTracks[i].first + pTracks[i].count > recordCount)
+		{
+			std::cout << "Invalid telemetry block " << blockIndex << std::endl;
+			pOldest->file.Close();
+			return(NULL);
+		}
+	}
+
+	pOldest->blockIndex = blockIndex;
+	pOldest->lastUsed = m_useCounter;
+	pOldest->pTracks = pTracks;
+	pOldest->pRecords = (const TELEMETRY_RECORD*)(pOldest->file.GetData() + trackBytes);
+
+	return(pOldest);
+}
+
+/***********************************************************
+ *  GatherRecords()
+ *
+ *  This method is used for finding, with a binary search in
+ *  each drone track, the records before and after the time
+ *  and copying them into the batch with their blend factor.
+ *  Drones without records in the block keep their last pose.
+ ***********************************************************/
+void TelemetryPlayback::GatherRecords(const MAPPED_BLOCK* pBlock, double time)
+{
+	for (uint32_t drone = 0; drone < m_pHeader->droneCount; drone++)
+	{
+		const TELEMETRY_TRACK_RANGE& track = pBlock->pTracks[drone];
+		if (track.count == 0)
+		{
+			continue;
+		}
+
+		const TELEMETRY_RECORD* pFirst = pBlock->pRecords + track.first;
+		const TELEMETRY_RECORD* pLast = pFirst + track.count;
+		const TELEMETRY_RECORD* pNext = std::upper_bound(pFirst, pLast, time,
+			[](double value, const TELEMETRY_RECORD& record) { return value < record.time; });
+
+		const TELEMETRY_RECORD* pFrom = (pNext == pFirst) ? pFirst : pNext - 1;
+		const TELEMETRY_RECORD* pTo = (pNext == pLast) ? pLast - 1 : pNext;
+		double span = pTo->time - pFrom->time;
+		double factor = (span > 0.0) ? (time - pFrom->time) / span : 0.0;
+
+		for (int i = 0; i < 3; i++)
+		{
+			m_batch.fromPosition[i][drone] = pFrom->position[i];
+			m_batch.toPosition[i][drone] = pTo->position[i];
+		}
+		for (int i = 0; i < 4; i++)
+		{
+			m_batch.fromRotation[i][drone] = pFrom->rotation[i];
+			m_batch.toRotation[i][drone] = pTo->rotation[i];
+		}
+		m_batch.factor[drone] = (float)std::min(std::max(factor, 0.0), 1.0);
+	}
+}
+
+/***********************************************************
+ *  InterpolateBatch()
+ *
+ *  This method is used for blending the positions linearly
+ *  and the rotations with a corrected normalized lerp, four
+ *  drones at a time.  The correction reshapes the blend
+ *  factor so the nlerp follows the constant angular speed of
+ *  a slerp closely, without the trigonometry (the fitted
+ *  polynomial is from "Approximating slerp" by A. Kapoulkine).
+ ***********************************************************/
+void TelemetryPlayback::InterpolateBatch()
+{
+	size_t count = m_batch.factor.size();
+	POSE_BATCH& b = m_batch;
+
+#ifdef TELEMETRY_USE_SSE
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 signBit = _mm_set1_ps(-0.0f);
+
+	for (size_t i = 0; i < count; i += 4)
+	{
+		__m128 t = _mm_loadu_ps(&b.factor[i]);
+
+		for (int c = 0; c < 3; c++)
+		{
+			__m128 from = _mm_loadu_ps(&b.fromPosition[c][i]);
+			__m128 to = _mm_loadu_ps(&b.toPosition[c][i]);
+			_mm_storeu_ps(&b.position[c][i], _mm_add_ps(from, _mm_mul_ps(_mm_sub_ps(to, from), t)));
+		}
+
+		__m128 from[4];
+		__m128 to[4];
+		for (int c = 0; c < 4; c++)
+		{
+			from[c] = _mm_loadu_ps(&b.fromRotation[c][i]);
+			to[c] = _mm_loadu_ps(&b.toRotation[c][i]);
+		}
+
+		// take the short way around by flipping the target
+		__m128 cosine = _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(from[0], to[0]), _mm_mul_ps(from[1], to[1])),
+			_mm_add_ps(_mm_mul_ps(from[2], to[2]), _mm_mul_ps(from[3], to[3])));
+		__m128 flip = _mm_and_ps(cosine, signBit);
+		__m128 d = _mm_andnot_ps(signBit, cosine);
+
+		__m128 A = _mm_add_ps(_mm_set1_ps(1.0904f), _mm_mul_ps(d,
+			_mm_add_ps(_mm_set1_ps(-3.2452f), _mm_mul_ps(d,
+			_mm_sub_ps(_mm_set1_ps(3.55645f), _mm_mul_ps(d, _mm_set1_ps(1.43519f)))))));
+		__m128 B = _mm_add_ps(_mm_set1_ps(0.848013f), _mm_mul_ps(d,
+			_mm_add_ps(_mm_set1_ps(-1.06021f), _mm_mul_ps(d, _mm_set1_ps(0.215638f)))));
+		__m128 centered = _mm_sub_ps(t, half);
+		__m128 k = _mm_add_ps(_mm_mul_ps(A, _mm_mul_ps(centered, centered)), B);
+		__m128 ot = _mm_add_ps(t, _mm_mul_ps(_mm_mul_ps(t, centered), _mm_mul_ps(_mm_sub_ps(t, one), k)));
+
+		__m128 q[4];
+		for (int c = 0; c < 4; c++)
+		{
+			__m128 target = _mm_xor_ps(to[c], flip);
+			q[c] = _mm_add_ps(from[c], _mm_mul_ps(_mm_sub_ps(target, from[c]), ot));
+		}
+
+		// normalize with one Newton step on the rsqrt estimate
+		__m128 lengthSquared = _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(q[0], q[0]), _mm_mul_ps(q[1], q[1])),
+			_mm_add_ps(_mm_mul_ps(q[2], q[2]), _mm_mul_ps(q[3], q[3])));
+		__m128 inverse = _mm_rsqrt_ps(lengthSquared);
+		inverse = _mm_mul_ps(inverse, _mm_sub_ps(_mm_set1_ps(1.5f),
+			_mm_mul_ps(_mm_mul_ps(half, lengthSquared), _mm_mul_ps(inverse, inverse))));
+
+		for (int c = 0; c < 4; c++)
+		{
+			_mm_storeu_ps(&b.rotation[c][i], _mm_mul_ps(q[c], inverse));
+		}
+	}
+#else
+	for (size_t i = 0; i < count; i++)
+	{
+		float t = b.factor[i];
+
+		for (int c = 0; c < 3; c++)
+		{
+			b.position[c][i] = b.fromPosition[c][i] + (b.toPosition[c][i] - b.fromPosition[c][i]) * t;
+		}
+
+		float cosine = 0.0f;
+		for (int c = 0; c < 4; c++)
+		{
+			cosine += b.fromRotation[c][i] * b.toRotation[c][i];
+		}
+		float sign = (cosine < 0.0f) ? -1.0f : 1.0f;
+		float d = std::fabs(cosine);
+
+		float A = 1.0904f + d * (-3.2452f + d * (3.55645f - d * 1.43519f));
+		float B = 0.848013f + d * (-1.06021f + d * 0.215638f);
+		float k = A * (t - 0.5f) * (t - 0.5f) + B;
+		float ot = t + t * (t - 0.5f) * (t - 1.0f) * k;
+
+		float q[4];
+		float lengthSquared = 0.0f;
+		for (int c = 0; c < 4; c++)
+		{
+			q[c] = b.fromRotation[c][i] + (sign * b.toRotation[c][i] - b.fromRotation[c][i]) * ot;
+			lengthSquared += q[c] * q[c];
+		}
+		float inverse = 1.0f / std::sqrt(lengthSquared);
+		for (int c = 0; c < 4; c++)
+		{
+			b.rotation[c][i] = q[c] * inverse;
+		}
+	}
+#endif
+}
+
+/***********************************************************
+ *  BuildTransforms()
+ *
+ *  This method is used for turning the interpolated poses
+ *  into the model matrix of each drone.
+ ***********************************************************/
+void TelemetryPlayback::BuildTransforms()
+{
+	for (size_t i = 0; i < m_transforms.size(); i++)
+	{
+		float x = m_batch.rotation[0][i];
+		float y = m_batch.rotation[1][i];
+		float z = m_batch.rotation[2][i];
+		float w = m_batch.rotation[3][i];
+
+		glm::mat4& m = m_transforms[i];
+		m[0] = glm::vec4(1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y + w * z), 2.0f * (x * z - w * y), 0.0f);
+		m[1] = glm::vec4(2.0f * (x * y - w * z), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z + w * x), 0.0f);
+		m[2] = glm::vec4(2.0f * (x * z + w * y), 2.0f * (y * z - w * x), 1.0f - 2.0f * (x * x + y * y), 0.0f);
+		m[3] = glm::vec4(m_batch.position[0][i], m_batch.position[1][i], m_batch.position[2][i], 1.0f);
+	}
+}
+
+/***********************************************************
+ *  MakeSyntheticRecord()
+ *
+ *  This method is used for computing the pose of a drone
+ *  of the synthetic log and of the stand-in live producer.
+ *  The drones sit on a grid and each one flies a circle at
+ *  its own speed, bobbing up and down and banking into the
+ *  turn.
+ ***********************************************************/
+TELEMETRY_RECORD TelemetryPlayback::MakeSyntheticRecord(int drone, int gridSize, double time)
+{
+	const double spacing = 10.0;
+	const double radius = 3.0;
+	double centerX = ((drone % gridSize) - (gridSize - 1) * 0.5) * spacing;
+	double centerZ = ((drone / gridSize) - (gridSize - 1) * 0.5) * spacing;
+	double angularSpeed = 0.4 + 0.05 * (drone % 7);
+	double angle = time * angularSpeed + drone;
+
+	TELEMETRY_RECORD record;
+	record.time = time;
+	record.position[0] = (float)(centerX + radius * std::cos(angle));
+	record.position[1] = (float)(1.0 + 0.5 * std::sin(time * 0.7 + drone));
+	record.position[2] = (float)(centerZ + radius * std::sin(angle));
+
+	// face along the circle and bank into the turn
+	double yaw = -angle;
+	double roll = 0.25;
+	double cy = std::cos(yaw * 0.5);
+	double sy = std::sin(yaw * 0.5);
+	double cr = std::cos(roll * 0.5);
+	double sr = std::sin(roll * 0.5);
+	record.rotation[0] = (float)(-sy * sr);
+	record.rotation[1] = (float)(sy * cr);
+	record.rotation[2] = (float)(cy * sr);
+	record.rotation[3] = (float)(cy * cr);
+	record.flags = 0;
+
+	return(record);
+}
+
+/***********************************************************
+ *  WriteSyntheticLog()
+ *
+ *  This method is used for writing a telemetry log of drones
+ *  flying circles, one block at a time so logs of any length
+ *  can be written with little memory.  It is used to test
+ *  the playback with long logs and many drones.
+ ***********************************************************/
+bool TelemetryPlayback::WriteSyntheticLog(
+	const std::string& filename,
+	int droneCount,
+	double durationSeconds,
+	double recordsPerSecond,
+	double blockSeconds)
+{
+	if ((droneCount <= 0) || (durationSeconds <= 0.0) ||
+		(recordsPerSecond <= 0.0) || (blockSeconds <= 0.0))
+	{
+		return(false);
+	}
+
+	FILE* pFile = fopen(filename.c_str(), "wb");
+	if (NULL == pFile)
+	{
+		std::cout << "Could not create telemetry file:" << filename << std::endl;
+		return(false);
+	}
+
+	int gridSize = (int)std::ceil(std::sqrt((double)droneCount));
+	long long lastRecord = (long long)std::floor(durationSeconds * recordsPerSecond);
+	uint32_t blockCount = (uint32_t)std::ceil(durationSeconds / blockSeconds);
+
+	TELEMETRY_FILE_HEADER header;
+	header.magic = TELEMETRY_FILE_MAGIC;
+	header.version = TELEMETRY_FILE_VERSION;
+	header.droneCount = (uint32_t)droneCount;
+	header.blockCount = blockCount;
+	header.startTime = 0.0;
+	header.endTime = lastRecord / recordsPerSecond;
+	header.reserved = 0;
+
+	// the index is written again once the block offsets are known
+	std::vector<TELEMETRY_BLOCK_INFO> blocks(blockCount);
+	uint64_t offset = 0;
+	bool bWritten = WriteValue(pFile, &header, sizeof(header), offset);
+	bWritten = bWritten && WriteValue(pFile, blocks.data(), blocks.size() * sizeof(TELEMETRY_BLOCK_INFO), offset);
+
+	std::vector<TELEMETRY_TRACK_RANGE> tracks(droneCount);
+	std::vector<TELEMETRY_RECORD> records;
+
+	for (uint32_t block = 0; bWritten && (block < blockCount); block++)
+	{
+		double startTime = block * blockSeconds;
+		double endTime = std::min((block + 1) * blockSeconds, header.endTime);
+
+		// the records on or just outside the block bounds are
+		// included so each block can be interpolated on its own
+		long long firstRecord = (long long)std::floor(startTime * recordsPerSecond);
+		long long endRecord = std::min((long long)std::ceil(endTime * recordsPerSecond), lastRecord);
+
+		records.clear();
+		for (int drone = 0; drone < droneCount; drone++)
+		{
+			tracks[drone].first = (uint32_t)records.size();
+			tracks[drone].count = (uint32_t)(endRecord - firstRecord + 1);
+			for (long long r = firstRecord; r <= endRecord; r++)
+			{
+				records.push_back(MakeSyntheticRecord(drone, gridSize, r / recordsPerSecond));
+			}
+		}
+
+		blocks[block].startTime = startTime;
+		blocks[block].endTime = endTime;
+		blocks[block].offset = offset;
+		blocks[block].size = tracks.size() * sizeof(TELEMETRY_TRACK_RANGE) + records.size() * sizeof(TELEMETRY_RECORD);
+
+		bWritten = WriteValue(pFile, tracks.data(), tracks.size() * sizeof(TELEMETRY_TRACK_RANGE), offset) &&
+			WriteValue(pFile, records.data(), records.size() * sizeof(TELEMETRY_RECORD), offset);
+	}
+
+	bWritten = bWritten && (fseek(pFile, (long)sizeof(header), SEEK_SET) == 0);
+	bWritten = bWritten && (fwrite(blocks.data(), sizeof(TELEMETRY_BLOCK_INFO), blocks.size(), pFile) == blocks.size());
+	fclose(pFile);
+
+	if (!bWritten)
+	{
+		std::cout << "Could not write telemetry file:" << filename << std::endl;
+		return(false);
+	}
+
+	std::cout << "Wrote telemetry file:" << filename << ", drones:" << droneCount
+		<< ", duration:" << header.endTime << "s, size:" << offset << " bytes" << std::endl;
+	return(true);
+}
@@ -0,0 +1,169 @@
+///////////////////////////////////////////////////////////////////////////////
+// telemetryplayback.h
+// ============
+// replay recorded drone flights from telemetry log files
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MappedFile.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// the telemetry log is split into blocks that each cover a time
+// span for all the drones.  Each drone track in a block starts
+// with the last record at or before the block start and ends
+// with the first record at or after the block end, so a pose
+// can always be interpolated from a single block.
+//
+//   TELEMETRY_FILE_HEADER
+//   TELEMETRY_BLOCK_INFO   blocks[blockCount]
+//   per block:
+//     TELEMETRY_TRACK_RANGE  tracks[droneCount]
+//     TELEMETRY_RECORD       records[]   (sorted by time per track)
+#define TELEMETRY_FILE_MAGIC 0x4D4C5444u   // "DTLM"
+#define TELEMETRY_FILE_VERSION 1u
+
+struct TELEMETRY_FILE_HEADER
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t droneCount;
+	uint32_t blockCount;
+	double startTime;
+	double endTime;
+	uint64_t reserved;
+};
+
+struct TELEMETRY_BLOCK_INFO
+{
+	double startTime;
+	double endTime;
+	uint64_t offset;
+	uint64_t size;
+};
+
+struct TELEMETRY_TRACK_RANGE
+{
+	// first record of the drone within the block and how many
+	uint32_t first;
+	uint32_t count;
+};
+
+struct TELEMETRY_RECORD
+{
+	// seconds since the start of the recording
+	double time;
+	float position[3];
+	// orientation quaternion x, y, z, w
+	float rotation[4];
+	uint32_t flags;
+};
+
+static_assert(sizeof(TELEMETRY_FILE_HEADER) == 40, "telemetry header must be packed");
+static_assert(sizeof(TELEMETRY_BLOCK_INFO) == 32, "telemetry block info must be packed");
+static_assert(sizeof(TELEMETRY_RECORD) == 40, "telemetry record must be packed");
+
+/***********************************************************
+ *  TelemetryPlayback
+ *
+ *  This class replays a telemetry log.  Only the header, the
+ *  block index and the blocks around the playback time are
+ *  mapped into memory, so logs of many gigabytes play with a
+ *  small footprint.  Seeking is a binary search over the
+ *  block index and then over each drone track, and the poses
+ *  of all the drones are interpolated together in batches.
+ ***********************************************************/
+class TelemetryPlayback
+{
+public:
+	// constructor
+	TelemetryPlayback();
+	// destructor
+	~TelemetryPlayback();
+
+	// open a telemetry log and seek to its start
+	bool Open(const std::string& filename);
+	void Close();
+
+	// write a log of drones flying in circles, for testing
+	static bool WriteSyntheticLog(
+		const std::string& filename,
+		int droneCount,
+		double durationSeconds,
+		double recordsPerSecond = 10.0,
+		double blockSeconds = 10.0);
+	// pose of a synthetic drone on a grid of gridSize columns
+	static TELEMETRY_RECORD MakeSyntheticRecord(int drone, int gridSize, double time);
+
+	// playback controls, the time is in log seconds
+	void SetTime(double time);
+	double GetTime() const { return m_time; }
+	void SetSpeed(double speed) { m_speed = speed; }
+	double GetSpeed() const { return m_speed; }
+	void SetPaused(bool bPaused) { m_bPaused = bPaused; }
+	bool IsPaused() const { return m_bPaused; }
+	void SetLooping(bool bLooping) { m_bLooping = bLooping; }
+	double GetStartTime() const;
+	double GetEndTime() const;
+
+	// advance the playback time and interpolate the poses
+	void Update(double deltaSeconds);
+
+	// world transform of each drone at the playback time
+	int GetDroneCount() const { return (int)m_transforms.size(); }
+	const std::vector<glm::mat4>& GetDroneTransforms() const { return m_transforms; }
+
+private:
+	static const int TOTAL_CACHED_BLOCKS = 2;
+
+	struct MAPPED_BLOCK
+	{
+		int blockIndex;
+		unsigned long long lastUsed;
+		MappedFile file;
+		const TELEMETRY_TRACK_RANGE* pTracks;
+		const TELEMETRY_RECORD* pRecords;
+	};
+
+	// structure of arrays of the two records around the time
+	// of each drone, padded to a multiple of four
+	struct POSE_BATCH
+	{
+		std::vector<float> fromPosition[3];
+		std::vector<float> toPosition[3];
+		std::vector<float> fromRotation[4];
+		std::vector<float> toRotation[4];
+		std::vector<float> factor;
+		std::vector<float> position[3];
+		std::vector<float> rotation[4];
+	};
+
+	std::string m_filename;
+	MappedFile m_indexFile;
+	const TELEMETRY_FILE_HEADER* m_pHeader;
+	const TELEMETRY_BLOCK_INFO* m_pBlocks;
+	MAPPED_BLOCK m_cachedBlocks[TOTAL_CACHED_BLOCKS];
+	unsigned long long m_useCounter;
+
+	double m_time;
+	double m_speed;
+	bool m_bPaused;
+	bool m_bLooping;
+
+	POSE_BATCH m_batch;
+	std::vector<glm::mat4> m_transforms;
+
+	// block holding the time and its mapping
+	int FindBlock(double time) const;
+	MAPPED_BLOCK* MapBlock(int blockIndex);
+	// fill the batch with the records around the time
+	void GatherRecords(const MAPPED_BLOCK* pBlock, double time);
+	// interpolate the batch and build the transforms
+	void InterpolateBatch();
+	void BuildTransforms();
+};
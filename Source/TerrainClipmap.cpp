@@ -0,0 +1,536 @@
+///////////////////////////////////////////////////////////////////////////////
+// terrainclipmap.cpp
+// ============
+// draw a streamed heightmap as nested rings of detail around the camera
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TerrainClipmap.h"
+#include "GLTrace.h"
+#include "ResourceTracker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+
+// declaration of global variables
+namespace
+{
+	// half the grid size in quads, the grid has twice this
+	// many plus one samples per side
+	const int g_HalfGrid = 64;
+	const int g_GridSize = 2 * g_HalfGrid + 1;
+	// quads along the edge of a level that blend into the next
+	const float g_MorphBand = g_HalfGrid / 4.0f;
+	// tiles kept in memory, enough for every level and its margin
+	const int g_TileSlots = 512;
+	// the tiles around a level are requested this far out, in
+	// samples of the level, so they are there when it moves
+	const int g_RequestMargin = g_HalfGrid / 2;
+
+	// owner of the textures, buffers and shader in the resource tracker
+	const char* const g_TrackerName = "terrain";
+	const char* const g_VertexShaderFilename = "terrainVertexShader.glsl";
+	const char* const g_FragmentShaderFilename = "fragmentShader.glsl";
+
+	const int g_ViewName = GLTrace::RegisterName("view");
+	const int g_ProjectionName = GLTrace::RegisterName("projection");
+	const int g_LevelName = GLTrace::RegisterName("terrainLevel");
+}
+
+/***********************************************************
+ *  TerrainClipmap()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TerrainClipmap::TerrainClipmap()
+{
+	m_pShader = NULL;
+	m_heightTexture = 0;
+	m_vertexArray = 0;
+	m_vertexBuffer = 0;
+	m_indexBuffer = 0;
+	m_fullGrid.offset = 0;
+	m_fullGrid.count = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		m_rings[i] = m_fullGrid;
+	}
+	m_levelCount = 0;
+	m_center = glm::vec3(0.0f);
+	m_textureMeters = 1.0f;
+	m_levelUpdateCount = 0;
+	m_lastTriangleCount = 0;
+	for (int i = 0; i < MAX_LEVELS; i++)
+	{
+		m_levels[i].originX = 0;
+		m_levels[i].originZ = 0;
+		m_levels[i].bFilled = false;
+		m_levels[i].shaderLevel = glm::vec4(0.0f);
+		m_levelNames[i] = GLTrace::RegisterName(("terrainLevels[" + std::to_string(i) + "]").c_str());
+	}
+}
+
+/***********************************************************
+ *  ~TerrainClipmap()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TerrainClipmap::~TerrainClipmap()
+{
+	if (0 != m_heightTexture)
+	{
+		ResourceTracker::Release(RESOURCE_TEXTURE, m_heightTexture);
+		glDeleteTextures(1, &m_heightTexture);
+		m_heightTexture = 0;
+	}
+	if (0 != m_vertexBuffer)
+	{
+		ResourceTracker::Release(RESOURCE_BUFFER, m_vertexBuffer);
+		glDeleteBuffers(1, &m_vertexBuffer);
+		m_vertexBuffer = 0;
+	}
+	if (0 != m_indexBuffer)
+	{
+		ResourceTracker::Release(RESOURCE_BUFFER, m_indexBuffer);
+		glDeleteBuffers(1, &m_indexBuffer);
+		m_indexBuffer = 0;
+	}
+	if (0 != m_vertexArray)
+	{
+		glDeleteVertexArrays(1, &m_vertexArray);
+		m_vertexArray = 0;
+	}
+	if (NULL != m_pShader)
+	{
+		ResourceTracker::Release(RESOURCE_PROGRAM, m_pShader->m_programID);
+		delete m_pShader;
+		m_pShader = NULL;
+	}
+	m_tileCache.Close();
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for opening the terrain file and
+ *  creating what the levels are drawn with.  The levels go
+ *  up to the coarsest level of the file, at most MAX_LEVELS.
+ ***********************************************************/
+bool TerrainClipmap::Initialize(const std::string& filename)
+{
+	if (!m_tileCache.Open(filename, g_TileSlots))
+	{
+		return(false);
+	}
+	m_levelCount = std::min(m_tileCache.GetFile().GetLevelCount(), (int)MAX_LEVELS);
+	m_levelHeights.resize((size_t)g_GridSize * g_GridSize);
+
+	glGenTextures(1, &m_heightTexture);
+	GLTrace::ActiveTexture(GL_TEXTURE0 + HEIGHT_TEXTURE_UNIT);
+	GLTrace::BindTexture(GL_TEXTURE_2D_ARRAY, m_heightTexture);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_R32F, g_GridSize, g_GridSize, m_levelCount, 0, GL_RED, GL_FLOAT, NULL);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	GLTrace::ActiveTexture(GL_TEXTURE0);
+	ResourceTracker::Track(RESOURCE_TEXTURE, m_heightTexture, g_TrackerName, "clipmap levels",
+		(size_t)g_GridSize * g_GridSize * m_levelCount * sizeof(float));
+
+	if (!CreateGrid() || !LoadShader())
+	{
+		return(false);
+	}
+
+	const TerrainFile& file = m_tileCache.GetFile();
+	std::cout << "Terrain " << filename << ": " << file.GetLevel(0).width << " x " << file.GetLevel(0).height
+		<< " samples " << file.GetSampleSpacing() << " apart, " << m_levelCount << " clipmap levels of "
+		<< g_GridSize << " x " << g_GridSize << ", " << g_TileSlots << " tiles cached" << std::endl;
+	return(true);
+}
+
+/***********************************************************
+ *  CreateGrid()
+ *
+ *  This method is used for creating the grid mesh all the
+ *  levels share.  A vertex is only its position in the grid.
+ *  The finest level draws every quad.  A coarser level leaves
+ *  out the square the level inside covers, which is half its
+ *  size and lies one sample off the middle or not in each
+ *  direction, so there are four rings to pick from.
+ ***********************************************************/
+bool TerrainClipmap::CreateGrid()
+{
+	std::vector<glm::vec2> vertices;
+	vertices.reserve((size_t)g_GridSize * g_GridSize);
+	for (int z = 0; z < g_GridSize; z++)
+	{
+		for (int x = 0; x < g_GridSize; x++)
+		{
+			vertices.push_back(glm::vec2((float)x, (float)z));
+		}
+	}
+
+	std::vector<uint32_t> indices;
+	for (int range = 0; range < 5; range++)
+	{
+		// the square of quads the level inside covers
+		int holeX = g_HalfGrid / 2 + ((range - 1) & 1);
+		int holeZ = g_HalfGrid / 2 + ((range - 1) >> 1);
+		INDEX_RANGE& indexRange = (0 == range) ? m_fullGrid : m_rings[range - 1];
+		indexRange.offset = (GLintptr)(indices.size() * sizeof(uint32_t));
+
+		for (int z = 0; z < g_GridSize - 1; z++)
+		{
+			for (int x = 0; x < g_GridSize - 1; x++)
+			{
+				if ((range > 0) &&
+					(x >= holeX) && (x < holeX + g_HalfGrid) &&
+					(z >= holeZ) && (z < holeZ + g_HalfGrid))
+				{
+					continue;
+				}
+				// counter-clockwise seen from above
+				uint32_t corner = (uint32_t)(z * g_GridSize + x);
+				indices.push_back(corner);
+				indices.push_back(corner + g_GridSize);
+				indices.push_back(corner + 1);
+				indices.push_back(corner + 1);
+				indices.push_back(corner + g_GridSize);
+				indices.push_back(corner + g_GridSize + 1);
+			}
+		}
+		indexRange.count = (GLsizei)(indices.size() - indexRange.offset / sizeof(uint32_t));
+	}
+
+	glGenVertexArrays(1, &m_vertexArray);
+	glGenBuffers(1, &m_vertexBuffer);
+	glGenBuffers(1, &m_indexBuffer);
+	GLTrace::BindVertexArray(m_vertexArray);
+	glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(glm::vec2), vertices.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint32_t), indices.data(), GL_STATIC_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*)0);
+	GLTrace::BindVertexArray(0);
+
+	ResourceTracker::Track(RESOURCE_BUFFER, m_vertexBuffer, g_TrackerName, "clipmap grid",
+		vertices.size() * sizeof(glm::vec2));
+	ResourceTracker::Track(RESOURCE_BUFFER, m_indexBuffer, g_TrackerName, "clipmap grid",
+		indices.size() * sizeof(uint32_t));
+	return(true);
+}
+
+/***********************************************************
+ *  LoadShader()
+ *
+ *  This method is used for loading the terrain shader.  Its
+ *  vertex shader places the grid on the heights, the main
+ *  fragment shader lights and shadows it like the rest of
+ *  the scene.
+ ***********************************************************/
+bool TerrainClipmap::LoadShader()
+{
+	m_pShader = new ShaderManager();
+	m_pShader->LoadShaders(g_VertexShaderFilename, g_FragmentShaderFilename);
+	if (0 == m_pShader->m_programID)
+	{
+		std::cout << "The terrain shader failed to load" << std::endl;
+		delete m_pShader;
+		m_pShader = NULL;
+		return(false);
+	}
+	ResourceTracker::TrackProgram(m_pShader->m_programID, g_TrackerName, g_VertexShaderFilename);
+
+	GLTrace::UseProgram(m_pShader);
+	BindUniforms();
+	return(true);
+}
+
+/***********************************************************
+ *  WatchShaders()
+ *
+ *  This method is used for having the terrain shader rebuilt
+ *  when one of its files changes.  The values that are only
+ *  set once are set again before the caller's.
+ ***********************************************************/
+void TerrainClipmap::WatchShaders(HotReload* pHotReload, const HotReload::ProgramFunc& onReload)
+{
+	if (NULL == m_pShader)
+	{
+		return;
+	}
+	pHotReload->WatchProgram(m_pShader,
+		g_VertexShaderFilename, NULL, g_FragmentShaderFilename, g_TrackerName,
+		[this, onReload](ShaderManager* pShader)
+		{
+			BindUniforms();
+			onReload(pShader);
+		});
+}
+
+/***********************************************************
+ *  BindUniforms()
+ *
+ *  This method is used for passing the values that do not
+ *  change into the bound terrain shader.
+ ***********************************************************/
+void TerrainClipmap::BindUniforms()
+{
+	GLTrace::SetSampler(m_pShader, "terrainHeights", HEIGHT_TEXTURE_UNIT);
+	GLTrace::SetInt(m_pShader, "terrainGridSize", g_GridSize);
+	GLTrace::SetInt(m_pShader, "terrainLevelCount", m_levelCount);
+	GLTrace::SetFloat(m_pShader, "terrainMorphBand", g_MorphBand);
+	GLTrace::SetFloat(m_pShader, "terrainTextureMeters", m_textureMeters);
+}
+
+/***********************************************************
+ *  SetPlacement()
+ *
+ *  This method is used for placing the terrain.  A new place
+ *  has every level filled again.
+ ***********************************************************/
+void TerrainClipmap::SetPlacement(const glm::vec3& center, float textureMeters)
+{
+	if ((center == m_center) && (textureMeters == m_textureMeters))
+	{
+		return;
+	}
+	m_center = center;
+	m_textureMeters = std::max(textureMeters, 0.001f);
+	for (int i = 0; i < m_levelCount; i++)
+	{
+		m_levels[i].bFilled = false;
+	}
+	if (NULL != m_pShader)
+	{
+		GLTrace::UseProgram(m_pShader);
+		GLTrace::SetFloat(m_pShader, "terrainTextureMeters", m_textureMeters);
+	}
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for moving the levels with the
+ *  camera.  Each level is snapped to every other one of its
+ *  samples under the camera.  A level is filled again when it
+ *  moved, or when a tile arrived at its level or a coarser
+ *  one, since its heights may come from that tile while its
+ *  own are loading.  The tiles are requested from the coarse
+ *  levels to the fine ones, so the heights to fall back to
+ *  arrive first.
+ ***********************************************************/
+void TerrainClipmap::Update(const glm::vec3& cameraPosition)
+{
+	if (0 == m_levelCount)
+	{
+		return;
+	}
+	uint32_t arrivedLevels = m_tileCache.BeginFrame();
+
+	const TerrainFile& file = m_tileCache.GetFile();
+	float spacing = file.GetSampleSpacing();
+	// world position of the first sample of the file
+	float terrainX = m_center.x - 0.5f * (float)(file.GetLevel(0).width - 1) * spacing;
+	float terrainZ = m_center.z - 0.5f * (float)(file.GetLevel(0).height - 1) * spacing;
+
+	for (int l = 0; l < m_levelCount; l++)
+	{
+		CLIP_LEVEL& level = m_levels[l];
+		float levelSpacing = spacing * (float)(1 << l);
+		int cameraX = (int)std::floor((cameraPosition.x - terrainX) / levelSpacing);
+		int cameraZ = (int)std::floor((cameraPosition.z - terrainZ) / levelSpacing);
+		int originX = (cameraX & ~1) - g_HalfGrid;
+		int originZ = (cameraZ & ~1) - g_HalfGrid;
+
+		bool bMoved = (originX != level.originX) || (originZ != level.originZ);
+		if (bMoved || ((arrivedLevels >> l) != 0))
+		{
+			level.bFilled = false;
+		}
+		level.originX = originX;
+		level.originZ = originZ;
+		level.shaderLevel = glm::vec4(
+			terrainX + (float)originX * levelSpacing,
+			terrainZ + (float)originZ * levelSpacing,
+			levelSpacing, 0.0f);
+	}
+
+	for (int l = m_levelCount - 1; l >= 0; l--)
+	{
+		RequestTiles(l);
+	}
+	for (int l = 0; l < m_levelCount; l++)
+	{
+		if (!m_levels[l].bFilled)
+		{
+			FillLevel(l);
+		}
+	}
+}
+
+/***********************************************************
+ *  RequestTiles()
+ *
+ *  This method is used for keeping the tiles under a level
+ *  and a margin around it in the cache.
+ ***********************************************************/
+void TerrainClipmap::RequestTiles(int level)
+{
+	const CLIP_LEVEL& clipLevel = m_levels[level];
+	const TERRAIN_LEVEL_RECORD& record = m_tileCache.GetFile().GetLevel(level);
+	int tileSize = m_tileCache.GetFile().GetTileSize();
+
+	int firstX = std::max(clipLevel.originX - g_RequestMargin, 0) / tileSize;
+	int firstZ = std::max(clipLevel.originZ - g_RequestMargin, 0) / tileSize;
+	int lastX = std::min(clipLevel.originX + g_GridSize + g_RequestMargin, (int)record.width) / tileSize;
+	int lastZ = std::min(clipLevel.originZ + g_GridSize + g_RequestMargin, (int)record.height) / tileSize;
+	lastX = std::min(lastX, (int)record.tilesX - 1);
+	lastZ = std::min(lastZ, (int)record.tilesZ - 1);
+
+	for (int tileZ = firstZ; tileZ <= lastZ; tileZ++)
+	{
+		for (int tileX = firstX; tileX <= lastX; tileX++)
+		{
+			m_tileCache.Request(level, tileX, tileZ);
+		}
+	}
+}
+
+/***********************************************************
+ *  FillLevel()
+ *
+ *  This method is used for copying the heights under a level
+ *  out of the resident tiles and uploading them.  Samples
+ *  whose tile is not resident take the sample of the
+ *  coarser tile at the same place.  Beyond the edges of the
+ *  terrain the edge samples repeat.  The tile of a run of
+ *  samples is looked up once.
+ ***********************************************************/
+void TerrainClipmap::FillLevel(int level)
+{
+	CLIP_LEVEL& clipLevel = m_levels[level];
+	const TerrainFile& file = m_tileCache.GetFile();
+	const TERRAIN_LEVEL_RECORD& record = file.GetLevel(level);
+	int tileSize = file.GetTileSize();
+	int tileMask = tileSize - 1;
+	int tileShift = 0;
+	while ((1 << tileShift) < tileSize)
+	{
+		tileShift++;
+	}
+	float baseHeight = m_center.y + file.GetMinHeight();
+	float heightScale = (file.GetMaxHeight() - file.GetMinHeight()) / 65535.0f;
+	int lastX = (int)record.width - 1;
+	int lastZ = (int)record.height - 1;
+
+	for (int z = 0; z < g_GridSize; z++)
+	{
+		int sampleZ = glm::clamp(clipLevel.originZ + z, 0, lastZ);
+		int tileZ = sampleZ >> tileShift;
+		float* pRow = &m_levelHeights[(size_t)z * g_GridSize];
+
+		int x = 0;
+		while (x < g_GridSize)
+		{
+			int tileX = glm::clamp(clipLevel.originX + x, 0, lastX) >> tileShift;
+			int foundLevel = level;
+			const uint16_t* pTile = m_tileCache.FindTile(level, tileX, tileZ, foundLevel);
+			int shift = foundLevel - level;
+			const uint16_t* pTileRow = pTile + (size_t)((sampleZ >> shift) & tileMask) * tileSize;
+
+			for (; x < g_GridSize; x++)
+			{
+				int sampleX = glm::clamp(clipLevel.originX + x, 0, lastX);
+				if ((sampleX >> tileShift) != tileX)
+				{
+					break;
+				}
+				pRow[x] = baseHeight + (float)pTileRow[(sampleX >> shift) & tileMask] * heightScale;
+			}
+		}
+	}
+
+	GLTrace::ActiveTexture(GL_TEXTURE0 + HEIGHT_TEXTURE_UNIT);
+	GLTrace::BindTexture(GL_TEXTURE_2D_ARRAY, m_heightTexture);
+	glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, level, g_GridSize, g_GridSize, 1, GL_RED, GL_FLOAT, m_levelHeights.data());
+	GLTrace::ActiveTexture(GL_TEXTURE0);
+
+	clipLevel.bFilled = true;
+	m_levelUpdateCount++;
+}
+
+/***********************************************************
+ *  Draw()
+ *
+ *  This method is used for drawing the levels for a view.
+ *  The finest level is drawn whole and each coarser one as
+ *  the ring around the one inside.  A ring that is entirely
+ *  beyond the far plane of the view is left out.
+ ***********************************************************/
+void TerrainClipmap::Draw(const glm::mat4& view, const glm::mat4& projection)
+{
+	m_lastTriangleCount = 0;
+	if ((NULL == m_pShader) || (0 == m_levelCount))
+	{
+		return;
+	}
+
+	GLTrace::SetMat4(m_pShader, g_ViewName, view);
+	GLTrace::SetMat4(m_pShader, g_ProjectionName, projection);
+	for (int l = 0; l < m_levelCount; l++)
+	{
+		GLTrace::SetVec4(m_pShader, m_levelNames[l], m_levels[l].shaderLevel);
+	}
+
+	// orthographic views see every ring
+	float farDistance = -1.0f;
+	if (projection[3][3] == 0.0f)
+	{
+		farDistance = projection[3][2] / (projection[2][2] + 1.0f);
+	}
+	glm::vec3 cameraPosition = glm::vec3(glm::inverse(view)[3]);
+
+	GLTrace::ActiveTexture(GL_TEXTURE0 + HEIGHT_TEXTURE_UNIT);
+	GLTrace::BindTexture(GL_TEXTURE_2D_ARRAY, m_heightTexture);
+	GLTrace::ActiveTexture(GL_TEXTURE0);
+	GLTrace::BindVertexArray(m_vertexArray);
+
+	for (int l = 0; l < m_levelCount; l++)
+	{
+		const INDEX_RANGE* pRange = &m_fullGrid;
+		if (l > 0)
+		{
+			// the square of the level inside, in samples of this one
+			const CLIP_LEVEL& inner = m_levels[l - 1];
+			int holeX = inner.originX / 2 - m_levels[l].originX - g_HalfGrid / 2;
+			int holeZ = inner.originZ / 2 - m_levels[l].originZ - g_HalfGrid / 2;
+			if ((holeX < 0) || (holeX > 1) || (holeZ < 0) || (holeZ > 1))
+			{
+				continue;
+			}
+			pRange = &m_rings[holeX + 2 * holeZ];
+
+			if (farDistance > 0.0f)
+			{
+				glm::vec2 innerMin = glm::vec2(inner.shaderLevel.x, inner.shaderLevel.y);
+				glm::vec2 innerMax = innerMin + (float)(g_GridSize - 1) * inner.shaderLevel.z;
+				glm::vec2 camera = glm::vec2(cameraPosition.x, cameraPosition.z);
+				glm::vec2 toEdge = glm::min(camera - innerMin, innerMax - camera);
+				if (std::min(toEdge.x, toEdge.y) > farDistance)
+				{
+					break;
+				}
+			}
+		}
+
+		GLTrace::SetInt(m_pShader, g_LevelName, l);
+		GLTrace::DrawElements(GL_TRIANGLES, pRange->count, GL_UNSIGNED_INT, pRange->offset);
+		m_lastTriangleCount += pRange->count / 3;
+	}
+
+	GLTrace::BindVertexArray(0);
+}
@@ -0,0 +1,128 @@
+///////////////////////////////////////////////////////////////////////////////
+// terrainclipmap.h
+// ============
+// draw a streamed heightmap as nested rings of detail around the camera
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "TerrainTileCache.h"
+#include "ShaderManager.h"
+#include "HotReload.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  TerrainClipmap
+ *
+ *  This class draws a terrain file as geometry clipmaps.
+ *  Each level is a square grid of the same number of
+ *  samples centered on the camera, every level twice the
+ *  spacing of the one inside it, so the detail falls off
+ *  with the distance and the triangles drawn are the same
+ *  however large the terrain is.  The finest level is drawn
+ *  whole and the others as rings around the level inside.
+ *
+ *  The heights of the levels are kept in one texture array
+ *  the vertex shader reads, with one shared grid mesh for all
+ *  of them.  A level is refilled from the tile cache only
+ *  when the camera has moved a whole sample of it or a tile
+ *  under it arrived, so the work per frame is bounded by the
+ *  level count.  The grids are snapped to every other sample
+ *  of their level, so each level lines up with the samples
+ *  of the next, and the outer band of a level blends into
+ *  the next one so no cracks open between them.
+ ***********************************************************/
+class TerrainClipmap
+{
+public:
+	// must match MAX_TERRAIN_LEVELS of the vertex shader
+	static const int MAX_LEVELS = 10;
+	// after the shadow map units
+	static const int HEIGHT_TEXTURE_UNIT = 8;
+
+	// constructor
+	TerrainClipmap();
+	// destructor
+	~TerrainClipmap();
+
+	// open the terrain file, create the level textures and the
+	// grid and load the terrain shader
+	bool Initialize(const std::string& filename);
+	// have the shader rebuilt when one of its files changes
+	void WatchShaders(HotReload* pHotReload, const HotReload::ProgramFunc& onReload);
+
+	// put the middle of the terrain at a point, heights are
+	// added to its height, and set the world size of one
+	// repeat of the texture
+	void SetPlacement(const glm::vec3& center, float textureMeters);
+	// move the levels with the camera, request their tiles and
+	// refill the levels that changed - called once per frame
+	void Update(const glm::vec3& cameraPosition);
+	// draw the levels for a view with the shader, which must be
+	// bound with its lights and material set
+	void Draw(const glm::mat4& view, const glm::mat4& projection);
+
+	ShaderManager* GetShader() const { return m_pShader; }
+	int GetLevelCount() const { return m_levelCount; }
+	// true while tiles near the camera are still being read
+	bool IsStreaming() const { return m_tileCache.IsLoading(); }
+	const TerrainTileCache& GetTileCache() const { return m_tileCache; }
+	// levels refilled since the start
+	unsigned long long GetLevelUpdateCount() const { return m_levelUpdateCount; }
+	// triangles drawn by the last Draw()
+	int GetLastTriangleCount() const { return m_lastTriangleCount; }
+
+private:
+	struct CLIP_LEVEL
+	{
+		// level sample under grid sample 0
+		int originX;
+		int originZ;
+		bool bFilled;
+		// world x and z of grid sample 0 and the spacing, as the
+		// shader gets them
+		glm::vec4 shaderLevel;
+	};
+
+	// a range of the index buffer
+	struct INDEX_RANGE
+	{
+		GLintptr offset;
+		GLsizei count;
+	};
+
+	TerrainTileCache m_tileCache;
+	ShaderManager* m_pShader;
+	GLuint m_heightTexture;
+	GLuint m_vertexArray;
+	GLuint m_vertexBuffer;
+	GLuint m_indexBuffer;
+	// the whole grid, and the ring around each place the level
+	// inside can take
+	INDEX_RANGE m_fullGrid;
+	INDEX_RANGE m_rings[4];
+
+	CLIP_LEVEL m_levels[MAX_LEVELS];
+	int m_levelCount;
+	std::vector<float> m_levelHeights;
+	glm::vec3 m_center;
+	float m_textureMeters;
+	unsigned long long m_levelUpdateCount;
+	int m_lastTriangleCount;
+
+	// uniform handles of the per level values
+	int m_levelNames[MAX_LEVELS];
+
+	bool CreateGrid();
+	bool LoadShader();
+	void BindUniforms();
+	// copy the heights under a level from the tiles and upload them
+	void FillLevel(int level);
+	// request the tiles under a level and a margin around it
+	void RequestTiles(int level);
+};
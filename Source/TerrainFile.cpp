@@ -0,0 +1,442 @@
+///////////////////////////////////////////////////////////////////////////////
+// terrainfile.cpp
+// ============
+// cook heightmaps into tiled files that stream a tile at a time
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TerrainFile.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// smallest and largest tiles a file may have
+	const uint32_t g_MinTileSize = 8;
+	const uint32_t g_MaxTileSize = 1024;
+	// tiles of the files cooked here
+	const int g_CookTileSize = 64;
+
+	// the synthetic hills, in world units
+	const float g_HillHeight = 24.0f;
+	const float g_HillWavelength = 180.0f;
+	const int g_HillOctaves = 6;
+	// the hills rise between these distances from the middle
+	const float g_FlatRadius = 24.0f;
+	const float g_RiseRadius = 70.0f;
+
+	/***********************************************************
+	 *  HashLattice()
+	 *
+	 *  This function is used for getting a value between -1
+	 *  and 1 for a lattice point of the noise.
+	 ***********************************************************/
+	float HashLattice(int x, int z, uint32_t seed)
+	{
+		uint32_t hash = (uint32_t)x * 73856093u ^ (uint32_t)z * 19349663u ^ seed * 83492791u;
+		hash ^= hash >> 13;
+		hash *= 0x5BD1E995u;
+		hash ^= hash >> 15;
+		return((float)(hash & 0xFFFFu) / 32767.5f - 1.0f);
+	}
+
+	/***********************************************************
+	 *  ValueNoise()
+	 *
+	 *  This function is used for interpolating the lattice
+	 *  values around a point with a smooth curve.
+	 ***********************************************************/
+	float ValueNoise(float x, float z, uint32_t seed)
+	{
+		float cellX = std::floor(x);
+		float cellZ = std::floor(z);
+		int ix = (int)cellX;
+		int iz = (int)cellZ;
+		float fx = x - cellX;
+		float fz = z - cellZ;
+		fx = fx * fx * (3.0f - 2.0f * fx);
+		fz = fz * fz * (3.0f - 2.0f * fz);
+
+		float v00 = HashLattice(ix, iz, seed);
+		float v10 = HashLattice(ix + 1, iz, seed);
+		float v01 = HashLattice(ix, iz + 1, seed);
+		float v11 = HashLattice(ix + 1, iz + 1, seed);
+		float v0 = v00 + (v10 - v00) * fx;
+		float v1 = v01 + (v11 - v01) * fx;
+		return(v0 + (v1 - v0) * fz);
+	}
+
+	/***********************************************************
+	 *  SmoothLevel()
+	 *
+	 *  This function is used for making the next level of the
+	 *  pyramid.  A sample is the sample of the finer level at
+	 *  the same place, blended with its neighbours 1-2-1 in
+	 *  each direction, so it stays where it was.
+	 ***********************************************************/
+	void SmoothLevel(const std::vector<float>& fine, int fineWidth, int fineHeight,
+		std::vector<float>& coarse, int coarseWidth, int coarseHeight)
+	{
+		static const float weights[3] = { 0.25f, 0.5f, 0.25f };
+
+		coarse.resize((size_t)coarseWidth * coarseHeight);
+		for (int z = 0; z < coarseHeight; z++)
+		{
+			for (int x = 0; x < coarseWidth; x++)
+			{
+				float sum = 0.0f;
+				for (int dz = -1; dz <= 1; dz++)
+				{
+					int fz = std::min(std::max(2 * z + dz, 0), fineHeight - 1);
+					for (int dx = -1; dx <= 1; dx++)
+					{
+						int fx = std::min(std::max(2 * x + dx, 0), fineWidth - 1);
+						sum += weights[dz + 1] * weights[dx + 1] * fine[(size_t)fz * fineWidth + fx];
+					}
+				}
+				coarse[(size_t)z * coarseWidth + x] = sum;
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  TerrainFile()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TerrainFile::TerrainFile()
+{
+	memset(&m_header, 0, sizeof(m_header));
+	memset(m_levels, 0, sizeof(m_levels));
+}
+
+/***********************************************************
+ *  ~TerrainFile()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TerrainFile::~TerrainFile()
+{
+	Close();
+}
+
+/***********************************************************
+ *  Open()
+ *
+ *  This method is used for reading the header and the level
+ *  records of a cooked file and checking that every tile
+ *  they describe is inside the file.
+ ***********************************************************/
+bool TerrainFile::Open(const std::string& filename)
+{
+	Close();
+
+	MappedFile file;
+	if (!file.Open(filename, 0, sizeof(TERRAIN_FILE_HEADER)))
+	{
+		std::cout << "Could not load terrain file:" << filename << std::endl;
+		return(false);
+	}
+	TERRAIN_FILE_HEADER header;
+	memcpy(&header, file.GetData(), sizeof(header));
+
+	if ((header.magic != TERRAIN_FILE_MAGIC) ||
+		(header.version != TERRAIN_FILE_VERSION) ||
+		(header.tileSize < g_MinTileSize) || (header.tileSize > g_MaxTileSize) ||
+		((header.tileSize & (header.tileSize - 1)) != 0) ||
+		(header.levelCount == 0) || (header.levelCount > TERRAIN_MAX_LEVELS) ||
+		(header.fileSize != file.GetFileSize()) ||
+		!(header.sampleSpacing > 0.0f) ||
+		!(header.maxHeight >= header.minHeight) ||
+		((unsigned long long)header.levelOffset + header.levelCount * sizeof(TERRAIN_LEVEL_RECORD) > header.tileOffset))
+	{
+		std::cout << "Not a terrain file of this version:" << filename << std::endl;
+		return(false);
+	}
+
+	if (!file.Open(filename, header.levelOffset, header.levelCount * sizeof(TERRAIN_LEVEL_RECORD)))
+	{
+		std::cout << "Could not load terrain file:" << filename << std::endl;
+		return(false);
+	}
+	TERRAIN_LEVEL_RECORD levels[TERRAIN_MAX_LEVELS];
+	memcpy(levels, file.GetData(), header.levelCount * sizeof(TERRAIN_LEVEL_RECORD));
+
+	// each level must halve the last one, end in one tile and
+	// keep its tiles within the file
+	unsigned long long tileBytes = (unsigned long long)header.tileSize * header.tileSize * sizeof(uint16_t);
+	unsigned long long tileCount = 0;
+	for (uint32_t i = 0; i < header.levelCount; i++)
+	{
+		const TERRAIN_LEVEL_RECORD& level = levels[i];
+		uint32_t width = (0 == i) ? header.width : (levels[i - 1].width + 1) / 2;
+		uint32_t height = (0 == i) ? header.height : (levels[i - 1].height + 1) / 2;
+		if ((level.width != width) || (level.height != height) || (0 == width) || (0 == height) ||
+			(level.tilesX != (width + header.tileSize - 1) / header.tileSize) ||
+			(level.tilesZ != (height + header.tileSize - 1) / header.tileSize) ||
+			(level.firstTile != tileCount))
+		{
+			std::cout << "Damaged terrain file:" << filename << std::endl;
+			return(false);
+		}
+		tileCount += (unsigned long long)level.tilesX * level.tilesZ;
+	}
+	const TERRAIN_LEVEL_RECORD& last = levels[header.levelCount - 1];
+	if ((last.tilesX != 1) || (last.tilesZ != 1) ||
+		(header.tileOffset + tileCount * tileBytes != header.fileSize))
+	{
+		std::cout << "Damaged terrain file:" << filename << std::endl;
+		return(false);
+	}
+
+	m_filename = filename;
+	m_header = header;
+	memcpy(m_levels, levels, sizeof(levels));
+	return(true);
+}
+
+/***********************************************************
+ *  Close()
+ *
+ *  This method is used for forgetting the open file.
+ ***********************************************************/
+void TerrainFile::Close()
+{
+	m_filename.clear();
+	memset(&m_header, 0, sizeof(m_header));
+	memset(m_levels, 0, sizeof(m_levels));
+}
+
+/***********************************************************
+ *  ReadTile()
+ *
+ *  This method is used for copying the heights of one tile
+ *  out of the file.  Only the range of the tile is mapped,
+ *  and only for the copy.
+ ***********************************************************/
+bool TerrainFile::ReadTile(int level, int tileX, int tileZ, uint16_t* pHeights) const
+{
+	if (!IsOpen() || (level < 0) || (level >= (int)m_header.levelCount))
+	{
+		return(false);
+	}
+	const TERRAIN_LEVEL_RECORD& record = m_levels[level];
+	if ((tileX < 0) || (tileZ < 0) || (tileX >= (int)record.tilesX) || (tileZ >= (int)record.tilesZ))
+	{
+		return(false);
+	}
+
+	size_t tileBytes = (size_t)m_header.tileSize * m_header.tileSize * sizeof(uint16_t);
+	unsigned long long tile = record.firstTile + (unsigned long long)tileZ * record.tilesX + tileX;
+	MappedFile file;
+	if (!file.Open(m_filename, m_header.tileOffset + tile * tileBytes, tileBytes))
+	{
+		return(false);
+	}
+	memcpy(pHeights, file.GetData(), tileBytes);
+	return(true);
+}
+
+/***********************************************************
+ *  Cook()
+ *
+ *  This method is used for writing the height pyramid of a
+ *  heightmap.  The levels are made one from the other until
+ *  a level fits in a single tile, and each is written as it
+ *  is made, so only two levels are held at once.
+ ***********************************************************/
+bool TerrainFile::Cook(const std::vector<float>& heights, int width, int height,
+	float sampleSpacing, int tileSize, const std::string& filename)
+{
+	if ((width <= 0) || (height <= 0) || ((size_t)width * height != heights.size()) ||
+		!(sampleSpacing > 0.0f) || (tileSize < (int)g_MinTileSize) || (tileSize > (int)g_MaxTileSize) ||
+		((tileSize & (tileSize - 1)) != 0))
+	{
+		std::cout << "Cannot cook a heightmap of " << width << " x " << height << " samples" << std::endl;
+		return(false);
+	}
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+	TERRAIN_FILE_HEADER header;
+	memset(&header, 0, sizeof(header));
+	header.magic = TERRAIN_FILE_MAGIC;
+	header.version = TERRAIN_FILE_VERSION;
+	header.tileSize = (uint32_t)tileSize;
+	header.width = (uint32_t)width;
+	header.height = (uint32_t)height;
+	header.sampleSpacing = sampleSpacing;
+	header.minHeight = *std::min_element(heights.begin(), heights.end());
+	header.maxHeight = *std::max_element(heights.begin(), heights.end());
+
+	// the smoothing keeps every level within the height range
+	TERRAIN_LEVEL_RECORD levels[TERRAIN_MAX_LEVELS];
+	memset(levels, 0, sizeof(levels));
+	uint64_t tileCount = 0;
+	uint32_t levelWidth = (uint32_t)width;
+	uint32_t levelHeight = (uint32_t)height;
+	while (true)
+	{
+		if (header.levelCount == TERRAIN_MAX_LEVELS)
+		{
+			std::cout << "Heightmap has too many levels to cook" << std::endl;
+			return(false);
+		}
+		TERRAIN_LEVEL_RECORD& level = levels[header.levelCount++];
+		level.width = levelWidth;
+		level.height = levelHeight;
+		level.tilesX = (levelWidth + tileSize - 1) / tileSize;
+		level.tilesZ = (levelHeight + tileSize - 1) / tileSize;
+		level.firstTile = tileCount;
+		tileCount += (uint64_t)level.tilesX * level.tilesZ;
+		if ((level.tilesX == 1) && (level.tilesZ == 1))
+		{
+			break;
+		}
+		levelWidth = (levelWidth + 1) / 2;
+		levelHeight = (levelHeight + 1) / 2;
+	}
+
+	size_t tileSamples = (size_t)tileSize * tileSize;
+	header.levelOffset = sizeof(TERRAIN_FILE_HEADER);
+	header.tileOffset = (header.levelOffset + header.levelCount * sizeof(TERRAIN_LEVEL_RECORD) + 15) & ~15ull;
+	header.fileSize = header.tileOffset + tileCount * tileSamples * sizeof(uint16_t);
+
+	FILE* pFile = fopen(filename.c_str(), "wb");
+	if (NULL == pFile)
+	{
+		std::cout << "Could not write terrain file:" << filename << std::endl;
+		return(false);
+	}
+	fwrite(&header, sizeof(header), 1, pFile);
+	fwrite(levels, sizeof(TERRAIN_LEVEL_RECORD), header.levelCount, pFile);
+	static const unsigned char padding[16] = { 0 };
+	fwrite(padding, 1, (size_t)(header.tileOffset - header.levelOffset - header.levelCount * sizeof(TERRAIN_LEVEL_RECORD)), pFile);
+
+	float range = header.maxHeight - header.minHeight;
+	float quantize = (range > 0.0f) ? 65535.0f / range : 0.0f;
+	std::vector<float> current = heights;
+	std::vector<float> next;
+	std::vector<uint16_t> tile(tileSamples);
+	for (uint32_t l = 0; l < header.levelCount; l++)
+	{
+		const TERRAIN_LEVEL_RECORD& level = levels[l];
+		for (uint32_t tz = 0; tz < level.tilesZ; tz++)
+		{
+			for (uint32_t tx = 0; tx < level.tilesX; tx++)
+			{
+				// the tiles on the far edges repeat the last sample
+				for (int z = 0; z < tileSize; z++)
+				{
+					uint32_t sourceZ = std::min(tz * tileSize + z, level.height - 1);
+					for (int x = 0; x < tileSize; x++)
+					{
+						uint32_t sourceX = std::min(tx * tileSize + x, level.width - 1);
+						float value = (current[(size_t)sourceZ * level.width + sourceX] - header.minHeight) * quantize;
+						tile[(size_t)z * tileSize + x] = (uint16_t)std::min(std::max(value + 0.5f, 0.0f), 65535.0f);
+					}
+				}
+				fwrite(tile.data(), sizeof(uint16_t), tileSamples, pFile);
+			}
+		}
+
+		if (l + 1 < header.levelCount)
+		{
+			SmoothLevel(current, (int)level.width, (int)level.height,
+				next, (int)levels[l + 1].width, (int)levels[l + 1].height);
+			current.swap(next);
+		}
+	}
+	bool bWritten = (ferror(pFile) == 0);
+	fclose(pFile);
+
+	double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+	std::cout << "Cooked terrain file:" << filename
+		<< " (" << width << " x " << height << " samples, " << header.levelCount << " levels, "
+		<< tileCount << " tiles, " << header.fileSize / (1024 * 1024) << " MB, "
+		<< milliseconds << " ms)" << std::endl;
+	return(bWritten);
+}
+
+/***********************************************************
+ *  CookRaw()
+ *
+ *  This method is used for cooking a heightmap exported as
+ *  raw 16 bit samples, the way elevation tools write them.
+ ***********************************************************/
+bool TerrainFile::CookRaw(const std::string& rawFilename, int width, int height,
+	float sampleSpacing, float heightRange, const std::string& filename)
+{
+	MappedFile file;
+	if ((width <= 0) || (height <= 0) || !file.Open(rawFilename))
+	{
+		std::cout << "Could not load heightmap file:" << rawFilename << std::endl;
+		return(false);
+	}
+	size_t sampleCount = (size_t)width * height;
+	if (file.GetSize() != sampleCount * 2)
+	{
+		std::cout << "Heightmap file is not " << width << " x " << height
+			<< " 16 bit samples:" << rawFilename << std::endl;
+		return(false);
+	}
+
+	const unsigned char* pData = file.GetData();
+	std::vector<float> heights(sampleCount);
+	float scale = heightRange / 65535.0f;
+	for (size_t i = 0; i < sampleCount; i++)
+	{
+		heights[i] = (float)(pData[2 * i] | (pData[2 * i + 1] << 8)) * scale;
+	}
+	return(Cook(heights, width, height, sampleSpacing, g_CookTileSize, filename));
+}
+
+/***********************************************************
+ *  WriteSynthetic()
+ *
+ *  This method is used for cooking a square of rolling hills
+ *  made from several octaves of value noise.  The middle is
+ *  left flat at height 0 so the scene keeps standing on the
+ *  ground, and the hills rise around it.
+ ***********************************************************/
+bool TerrainFile::WriteSynthetic(const std::string& filename, int size, float sampleSpacing)
+{
+	if ((size < 2) || (size > 32768) || !(sampleSpacing > 0.0f))
+	{
+		std::cout << "Cannot write a terrain of " << size << " samples" << std::endl;
+		return(false);
+	}
+
+	std::vector<float> heights((size_t)size * size);
+	float center = 0.5f * (float)(size - 1);
+	for (int z = 0; z < size; z++)
+	{
+		for (int x = 0; x < size; x++)
+		{
+			float worldX = ((float)x - center) * sampleSpacing;
+			float worldZ = ((float)z - center) * sampleSpacing;
+
+			float noise = 0.0f;
+			float amplitude = 0.5f;
+			float frequency = 1.0f / g_HillWavelength;
+			for (int octave = 0; octave < g_HillOctaves; octave++)
+			{
+				noise += amplitude * ValueNoise(worldX * frequency, worldZ * frequency, (uint32_t)octave);
+				amplitude *= 0.5f;
+				frequency *= 2.0f;
+			}
+
+			float distance = std::sqrt(worldX * worldX + worldZ * worldZ);
+			float rise = std::min(std::max((distance - g_FlatRadius) / (g_RiseRadius - g_FlatRadius), 0.0f), 1.0f);
+			rise = rise * rise * (3.0f - 2.0f * rise);
+			heights[(size_t)z * size + x] = rise * g_HillHeight * (0.5f + noise);
+		}
+	}
+	return(Cook(heights, size, size, sampleSpacing, g_CookTileSize, filename));
+}
@@ -0,0 +1,115 @@
+///////////////////////////////////////////////////////////////////////////////
+// terrainfile.h
+// ============
+// cook heightmaps into tiled files that stream a tile at a time
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// the cooked file is the header, one level record per level
+// of the height pyramid and then the tiles of every level, row
+// by row, each the same size so its offset follows from its
+// position.  Heights are stored as 16 bit fractions of the
+// height range
+#define TERRAIN_FILE_MAGIC 0x4E525444u   // "DTRN"
+#define TERRAIN_FILE_VERSION 1u
+#define TERRAIN_MAX_LEVELS 24
+
+struct TERRAIN_FILE_HEADER
+{
+	uint32_t magic;
+	uint32_t version;
+	// samples along each side of a tile, a power of two
+	uint32_t tileSize;
+	uint32_t levelCount;
+	// samples of the finest level
+	uint32_t width;
+	uint32_t height;
+	// distance between the samples of the finest level
+	float sampleSpacing;
+	float minHeight;
+	float maxHeight;
+	uint32_t levelOffset;
+	uint64_t tileOffset;
+	uint64_t fileSize;
+};
+
+static_assert(sizeof(TERRAIN_FILE_HEADER) == 56, "terrain file header must be packed");
+
+struct TERRAIN_LEVEL_RECORD
+{
+	// samples of the level, each half the ones of the level
+	// before it rounded up
+	uint32_t width;
+	uint32_t height;
+	uint32_t tilesX;
+	uint32_t tilesZ;
+	// tiles of all the finer levels
+	uint64_t firstTile;
+};
+
+static_assert(sizeof(TERRAIN_LEVEL_RECORD) == 24, "terrain level record must be packed");
+
+/***********************************************************
+ *  TerrainFile
+ *
+ *  This class reads the tiles of a cooked terrain file.  The
+ *  file holds a pyramid of heightmaps, each level half the
+ *  size of the one before it down to a single tile, so any
+ *  part of the terrain can be shown at any detail by reading
+ *  only the tiles it covers.  Each level keeps every other
+ *  sample of the level before it, smoothed with its
+ *  neighbours, so a sample lies on the sample of the finer
+ *  level at the same place.
+ *
+ *  Only the header and the level records stay in memory.
+ *  ReadTile() maps the range of one tile, so it may be
+ *  called from any thread and the file may be larger than
+ *  the address space.
+ ***********************************************************/
+class TerrainFile
+{
+public:
+	// constructor
+	TerrainFile();
+	// destructor
+	~TerrainFile();
+
+	// read the header and the level records
+	bool Open(const std::string& filename);
+	void Close();
+
+	// copy the heights of a tile, tileSize by tileSize values
+	bool ReadTile(int level, int tileX, int tileZ, uint16_t* pHeights) const;
+
+	bool IsOpen() const { return m_header.magic == TERRAIN_FILE_MAGIC; }
+	const std::string& GetFilename() const { return m_filename; }
+	int GetTileSize() const { return (int)m_header.tileSize; }
+	int GetLevelCount() const { return (int)m_header.levelCount; }
+	const TERRAIN_LEVEL_RECORD& GetLevel(int level) const { return m_levels[level]; }
+	float GetSampleSpacing() const { return m_header.sampleSpacing; }
+	float GetMinHeight() const { return m_header.minHeight; }
+	float GetMaxHeight() const { return m_header.maxHeight; }
+	unsigned long long GetFileSize() const { return m_header.fileSize; }
+
+	// write the height pyramid of a heightmap of width by
+	// height samples into a cooked file
+	static bool Cook(const std::vector<float>& heights, int width, int height,
+		float sampleSpacing, int tileSize, const std::string& filename);
+	// cook a raw heightmap of 16 bit little endian samples,
+	// mapping 0 to 65535 onto the height range
+	static bool CookRaw(const std::string& rawFilename, int width, int height,
+		float sampleSpacing, float heightRange, const std::string& filename);
+	// cook rolling hills of the given size that are flat in the
+	// middle, where the scene stands
+	static bool WriteSynthetic(const std::string& filename, int size, float sampleSpacing);
+
+private:
+	std::string m_filename;
+	TERRAIN_FILE_HEADER m_header;
+	TERRAIN_LEVEL_RECORD m_levels[TERRAIN_MAX_LEVELS];
+};
@@ -0,0 +1,415 @@
+///////////////////////////////////////////////////////////////////////////////
+// terraintilecache.cpp
+// ============
+// keep the terrain tiles near the camera, loading them in the background
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TerrainTileCache.h"
+#include "ResourceTracker.h"
+
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// owner of the tiles in the resource tracker
+	const char* const g_TrackerName = "terrain";
+}
+
+/***********************************************************
+ *  TerrainTileCache()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TerrainTileCache::TerrainTileCache()
+{
+	m_tileSamples = 0;
+	m_tableMask = 0;
+	m_frameNumber = 0;
+	m_pendingLoads = 0;
+	m_residentCount = 0;
+	m_loadCount = 0;
+	m_evictionCount = 0;
+	m_queueHead = 0;
+	m_queueCount = 0;
+	m_bStopWorker = false;
+}
+
+/***********************************************************
+ *  ~TerrainTileCache()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TerrainTileCache::~TerrainTileCache()
+{
+	Close();
+}
+
+/***********************************************************
+ *  Open()
+ *
+ *  This method is used for opening a terrain file, reading
+ *  its coarsest tile and making room for the given number
+ *  of tiles.  The worker thread is started here.
+ ***********************************************************/
+bool TerrainTileCache::Open(const std::string& filename, int slotCount)
+{
+	Close();
+
+	if (!m_file.Open(filename))
+	{
+		return(false);
+	}
+	if (slotCount <= 0)
+	{
+		std::cout << "The terrain needs room for at least one tile" << std::endl;
+		m_file.Close();
+		return(false);
+	}
+
+	m_tileSamples = m_file.GetTileSize() * m_file.GetTileSize();
+	m_rootTile.resize(m_tileSamples);
+	if (!m_file.ReadTile(m_file.GetLevelCount() - 1, 0, 0, m_rootTile.data()))
+	{
+		std::cout << "Could not read terrain file:" << filename << std::endl;
+		m_file.Close();
+		return(false);
+	}
+
+	TILE_SLOT freeSlot;
+	freeSlot.key = 0;
+	freeSlot.state = SLOT_FREE;
+	freeSlot.lastUsedFrame = 0;
+	m_slots.assign(slotCount, freeSlot);
+	m_heights.assign((size_t)slotCount * m_tileSamples, 0);
+
+	// at most half full, so the probes stay short
+	uint32_t tableSize = 1;
+	while (tableSize < 2 * (uint32_t)slotCount)
+	{
+		tableSize <<= 1;
+	}
+	m_table.assign(tableSize, -1);
+	m_tableMask = tableSize - 1;
+
+	m_loadQueue.assign(slotCount, -1);
+	m_queueHead = 0;
+	m_queueCount = 0;
+	m_loadedSlots.reserve(slotCount);
+	m_takenSlots.reserve(slotCount);
+	m_bStopWorker = false;
+	m_worker = std::thread(&TerrainTileCache::WorkerLoop, this);
+
+	ResourceTracker::Track(RESOURCE_HOST_STAGING, (uint64_t)(uintptr_t)m_heights.data(), g_TrackerName,
+		filename.c_str(), (m_heights.size() + m_rootTile.size()) * sizeof(uint16_t));
+	return(true);
+}
+
+/***********************************************************
+ *  Close()
+ *
+ *  This method is used for stopping the worker thread and
+ *  freeing the tiles.  Tiles still being read are dropped.
+ ***********************************************************/
+void TerrainTileCache::Close()
+{
+	if (m_worker.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_bStopWorker = true;
+		}
+		m_condition.notify_all();
+		m_worker.join();
+	}
+	if (!m_heights.empty())
+	{
+		ResourceTracker::Release(RESOURCE_HOST_STAGING, (uint64_t)(uintptr_t)m_heights.data());
+	}
+
+	m_slots.clear();
+	m_heights.clear();
+	m_rootTile.clear();
+	m_table.clear();
+	m_loadQueue.clear();
+	m_loadedSlots.clear();
+	m_takenSlots.clear();
+	m_queueCount = 0;
+	m_pendingLoads = 0;
+	m_residentCount = 0;
+	m_file.Close();
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for making the tiles the worker has
+ *  read since the last frame resident.  The levels of the
+ *  tiles are returned as bits, since the heights shown at
+ *  those levels and the finer ones may have changed.
+ ***********************************************************/
+uint32_t TerrainTileCache::BeginFrame()
+{
+	m_frameNumber++;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_takenSlots.swap(m_loadedSlots);
+	}
+
+	uint32_t levelMask = 0;
+	for (size_t i = 0; i < m_takenSlots.size(); i++)
+	{
+		// the worker hands failed slots back complemented
+		bool bRead = (m_takenSlots[i] >= 0);
+		TILE_SLOT& slot = m_slots[bRead ? m_takenSlots[i] : ~m_takenSlots[i]];
+		slot.state = bRead ? SLOT_READY : SLOT_FAILED;
+		if (bRead)
+		{
+			levelMask |= 1u << (uint32_t)(slot.key >> 48);
+			m_residentCount++;
+		}
+		m_pendingLoads--;
+	}
+	m_takenSlots.clear();
+
+	return(levelMask);
+}
+
+/***********************************************************
+ *  Request()
+ *
+ *  This method is used for keeping a tile resident for this
+ *  frame.  A tile that is not in the cache takes the slot of
+ *  the tile used longest ago and is queued for the worker.
+ *  When every slot is in use this frame the request is left
+ *  for a later frame, the coarser tiles fill in meanwhile.
+ ***********************************************************/
+void TerrainTileCache::Request(int level, int tileX, int tileZ)
+{
+	uint64_t key = GetKey(level, tileX, tileZ);
+	int slotIndex = FindSlot(key);
+	if (slotIndex >= 0)
+	{
+		m_slots[slotIndex].lastUsedFrame = m_frameNumber;
+		return;
+	}
+
+	slotIndex = FindVictim();
+	if (slotIndex < 0)
+	{
+		return;
+	}
+
+	TILE_SLOT& slot = m_slots[slotIndex];
+	if (SLOT_FREE != slot.state)
+	{
+		if (SLOT_READY == slot.state)
+		{
+			m_residentCount--;
+		}
+		RemoveSlot(slotIndex);
+		m_evictionCount++;
+	}
+	slot.key = key;
+	slot.state = SLOT_LOADING;
+	slot.lastUsedFrame = m_frameNumber;
+	InsertSlot(slotIndex);
+	m_pendingLoads++;
+	m_loadCount++;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_loadQueue[(m_queueHead + m_queueCount) % (int)m_loadQueue.size()] = slotIndex;
+		m_queueCount++;
+	}
+	m_condition.notify_one();
+}
+
+/***********************************************************
+ *  FindTile()
+ *
+ *  This method is used for finding the heights to show for a
+ *  tile.  When the tile is not resident its parent tiles are
+ *  tried one level up at a time, down to the coarsest tile,
+ *  which is always there.
+ ***********************************************************/
+const uint16_t* TerrainTileCache::FindTile(int level, int tileX, int tileZ, int& foundLevel) const
+{
+	int lastLevel = m_file.GetLevelCount() - 1;
+	for (; level < lastLevel; level++)
+	{
+		int slotIndex = FindSlot(GetKey(level, tileX, tileZ));
+		if ((slotIndex >= 0) && (SLOT_READY == m_slots[slotIndex].state))
+		{
+			foundLevel = level;
+			return(&m_heights[(size_t)slotIndex * m_tileSamples]);
+		}
+		tileX >>= 1;
+		tileZ >>= 1;
+	}
+	foundLevel = lastLevel;
+	return(m_rootTile.data());
+}
+
+/***********************************************************
+ *  WorkerLoop()
+ *
+ *  This method is run by the worker thread.  It reads the
+ *  queued tiles into their slots one at a time and hands the
+ *  slots back to the render thread.
+ ***********************************************************/
+void TerrainTileCache::WorkerLoop()
+{
+	while (true)
+	{
+		int slotIndex = -1;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_condition.wait(lock, [this]() { return m_bStopWorker || (m_queueCount > 0); });
+			if (true == m_bStopWorker)
+			{
+				return;
+			}
+			slotIndex = m_loadQueue[m_queueHead];
+			m_queueHead = (m_queueHead + 1) % (int)m_loadQueue.size();
+			m_queueCount--;
+		}
+
+		// the render thread leaves the key and the heights of a
+		// loading slot alone, and sets its state when it takes it
+		uint64_t key = m_slots[slotIndex].key;
+		int level = (int)(key >> 48);
+		int tileZ = (int)((key >> 24) & 0xFFFFFF);
+		int tileX = (int)(key & 0xFFFFFF);
+		bool bRead = m_file.ReadTile(level, tileX, tileZ, &m_heights[(size_t)slotIndex * m_tileSamples]);
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_loadedSlots.push_back(bRead ? slotIndex : ~slotIndex);
+	}
+}
+
+/***********************************************************
+ *  GetKey()
+ *
+ *  This method is used for packing the position of a tile
+ *  into the key of its slot.
+ ***********************************************************/
+uint64_t TerrainTileCache::GetKey(int level, int tileX, int tileZ)
+{
+	return(((uint64_t)level << 48) | ((uint64_t)(tileZ & 0xFFFFFF) << 24) | (uint64_t)(tileX & 0xFFFFFF));
+}
+
+/***********************************************************
+ *  HashKey()
+ *
+ *  This method is used for spreading the keys of tiles next
+ *  to each other over the table.
+ ***********************************************************/
+uint32_t TerrainTileCache::HashKey(uint64_t key)
+{
+	key ^= key >> 29;
+	key *= 0xBF58476D1CE4E5B9ull;
+	key ^= key >> 32;
+	return((uint32_t)key);
+}
+
+/***********************************************************
+ *  FindSlot()
+ *
+ *  This method is used for finding the slot of a tile in the
+ *  table, -1 when it has none.
+ ***********************************************************/
+int TerrainTileCache::FindSlot(uint64_t key) const
+{
+	if (m_table.empty())
+	{
+		return(-1);
+	}
+	for (uint32_t i = HashKey(key) & m_tableMask; ; i = (i + 1) & m_tableMask)
+	{
+		int slotIndex = m_table[i];
+		if (slotIndex < 0)
+		{
+			return(-1);
+		}
+		if (m_slots[slotIndex].key == key)
+		{
+			return(slotIndex);
+		}
+	}
+}
+
+/***********************************************************
+ *  InsertSlot()
+ *
+ *  This method is used for adding a slot to the table under
+ *  the key of its tile.
+ ***********************************************************/
+void TerrainTileCache::InsertSlot(int slotIndex)
+{
+	uint32_t i = HashKey(m_slots[slotIndex].key) & m_tableMask;
+	while (m_table[i] >= 0)
+	{
+		i = (i + 1) & m_tableMask;
+	}
+	m_table[i] = slotIndex;
+}
+
+/***********************************************************
+ *  RemoveSlot()
+ *
+ *  This method is used for taking a slot out of the table.
+ *  The entries after it are shifted back into the gap when
+ *  their probe started at or before it, so every entry stays
+ *  reachable without leaving markers behind.
+ ***********************************************************/
+void TerrainTileCache::RemoveSlot(int slotIndex)
+{
+	uint32_t i = HashKey(m_slots[slotIndex].key) & m_tableMask;
+	while (m_table[i] != slotIndex)
+	{
+		i = (i + 1) & m_tableMask;
+	}
+	m_table[i] = -1;
+
+	for (uint32_t j = (i + 1) & m_tableMask; m_table[j] >= 0; j = (j + 1) & m_tableMask)
+	{
+		uint32_t home = HashKey(m_slots[m_table[j]].key) & m_tableMask;
+		bool bStays = (i <= j) ? ((i < home) && (home <= j)) : ((i < home) || (home <= j));
+		if (!bStays)
+		{
+			m_table[i] = m_table[j];
+			m_table[j] = -1;
+			i = j;
+		}
+	}
+}
+
+/***********************************************************
+ *  FindVictim()
+ *
+ *  This method is used for picking the slot a new tile is
+ *  read into.
+ ***********************************************************/
+int TerrainTileCache::FindVictim() const
+{
+	int victim = -1;
+	for (size_t i = 0; i < m_slots.size(); i++)
+	{
+		const TILE_SLOT& slot = m_slots[i];
+		if (SLOT_FREE == slot.state)
+		{
+			return((int)i);
+		}
+		if ((SLOT_LOADING == slot.state) || (slot.lastUsedFrame == m_frameNumber))
+		{
+			continue;
+		}
+		if ((victim < 0) || (slot.lastUsedFrame < m_slots[victim].lastUsedFrame))
+		{
+			victim = (int)i;
+		}
+	}
+	return(victim);
+}
@@ -0,0 +1,121 @@
+///////////////////////////////////////////////////////////////////////////////
+// terraintilecache.h
+// ============
+// keep the terrain tiles near the camera, loading them in the background
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "TerrainFile.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  TerrainTileCache
+ *
+ *  This class holds a fixed number of tiles of a terrain
+ *  file.  Tiles asked for that are not resident are read by
+ *  a worker thread into the slot of the tile used longest
+ *  ago, so the memory stays the same however large the file
+ *  is.  The single tile of the coarsest level is read when
+ *  the file is opened and never evicted, so every sample has
+ *  a height while finer tiles load.
+ *
+ *  The slots are found through a hash table of the tile
+ *  positions, and the queues between the threads are
+ *  allocated once, so the cache allocates nothing after
+ *  Open().  Only the render thread calls the methods.
+ ***********************************************************/
+class TerrainTileCache
+{
+public:
+	// constructor
+	TerrainTileCache();
+	// destructor
+	~TerrainTileCache();
+
+	// open the file and start the worker with room for the
+	// given number of tiles
+	bool Open(const std::string& filename, int slotCount);
+	// stop the worker and free the tiles
+	void Close();
+
+	// take the tiles the worker has read since the last frame,
+	// returns a bit for each level that got one
+	uint32_t BeginFrame();
+	// keep a tile for this frame, queueing it when it is not
+	// resident or on its way
+	void Request(int level, int tileX, int tileZ);
+	// heights of the finest resident tile at or above the
+	// level that covers the tile, and the level it is from
+	const uint16_t* FindTile(int level, int tileX, int tileZ, int& foundLevel) const;
+
+	const TerrainFile& GetFile() const { return m_file; }
+	// true while requested tiles are still being read
+	bool IsLoading() const { return m_pendingLoads > 0; }
+	int GetSlotCount() const { return (int)m_slots.size(); }
+	int GetResidentCount() const { return m_residentCount; }
+	unsigned long long GetLoadCount() const { return m_loadCount; }
+	unsigned long long GetEvictionCount() const { return m_evictionCount; }
+
+private:
+	enum SLOT_STATE
+	{
+		SLOT_FREE = 0,
+		SLOT_LOADING,
+		SLOT_READY,
+		// the tile could not be read, kept so it is not asked for
+		// again every frame
+		SLOT_FAILED
+	};
+
+	struct TILE_SLOT
+	{
+		uint64_t key;
+		SLOT_STATE state;
+		unsigned long long lastUsedFrame;
+	};
+
+	TerrainFile m_file;
+	int m_tileSamples;
+	std::vector<TILE_SLOT> m_slots;
+	// heights of all the slots, one tile after the other
+	std::vector<uint16_t> m_heights;
+	std::vector<uint16_t> m_rootTile;
+	// open addressing table of slot indices, -1 when empty
+	std::vector<int> m_table;
+	uint32_t m_tableMask;
+	unsigned long long m_frameNumber;
+	int m_pendingLoads;
+	int m_residentCount;
+	unsigned long long m_loadCount;
+	unsigned long long m_evictionCount;
+
+	// the worker thread, with a ring of slots to read and a
+	// list of slots it has read
+	std::thread m_worker;
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	std::vector<int> m_loadQueue;
+	int m_queueHead;
+	int m_queueCount;
+	std::vector<int> m_loadedSlots;
+	std::vector<int> m_takenSlots;
+	bool m_bStopWorker;
+
+	void WorkerLoop();
+
+	static uint64_t GetKey(int level, int tileX, int tileZ);
+	static uint32_t HashKey(uint64_t key);
+	int FindSlot(uint64_t key) const;
+	void InsertSlot(int slot);
+	void RemoveSlot(int slot);
+	// the free slot, or the ready one used longest ago and not
+	// this frame, -1 when every slot is in use
+	int FindVictim() const;
+};
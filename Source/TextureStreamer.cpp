@@ -0,0 +1,935 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturestreamer.cpp
+// ============
+// stream texture mip levels in and out of GPU memory on demand
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureStreamer.h"
+#include "GLTrace.h"
+#include "ResourceTracker.h"
+
+#include "stb_image.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// levels up to this size are uploaded as soon as the image
+	// is decoded and are never evicted
+	const int g_MinimumLevelSize = 64;
+	// default GPU memory budget and upload rate
+	const size_t g_DefaultBudgetBytes = 128 * 1024 * 1024;
+	const size_t g_DefaultUploadLimit = 4 * 1024 * 1024;
+	// host memory the decoded mip chains may use
+	const size_t g_HostBudgetBytes = 32 * 1024 * 1024;
+	// color shown until the low mip levels are decoded
+	const unsigned char g_PlaceholderTexel[4] = { 128, 128, 128, 255 };
+	// owner of the textures in the resource tracker
+	const char* const g_TrackerName = "texture streamer";
+}
+
+/***********************************************************
+ *  TextureStreamer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TextureStreamer::TextureStreamer()
+{
+	m_budgetBytes = g_DefaultBudgetBytes;
+	m_uploadLimit = g_DefaultUploadLimit;
+	m_totalResidentBytes = 0;
+	m_totalHostBytes = 0;
+	m_frameNumber = 0;
+	m_pendingDecodes = 0;
+	m_bStreaming = false;
+	m_bStopWorker = false;
+}
+
+/***********************************************************
+ *  ~TextureStreamer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TextureStreamer::~TextureStreamer()
+{
+	DestroyAll();
+}
+
+/***********************************************************
+ *  LoadTexture()
+ *
+ *  This method is used for creating the OpenGL texture of an
+ *  image file.  Only the image header is read here, the
+ *  texture holds a placeholder until the worker thread has
+ *  decoded the image and built its mip chain.
+ ***********************************************************/
+GLuint TextureStreamer::LoadTexture(const char* filename, const std::string& tag)
+{
+	int width = 0;
+	int height = 0;
+	int colorChannels = 0;
+
+	if (!stbi_info(filename, &width, &height, &colorChannels))
+	{
+		std::cout << "Could not load image:" << filename << std::endl;
+		return(0);
+	}
+
+	STREAMED_TEXTURE* pTexture = new STREAMED_TEXTURE();
+	pTexture->tag = tag;
+	pTexture->filename = filename;
+	pTexture->loadIndex = m_textures.size();
+	SetImageSize(pTexture, width, height, colorChannels);
+	pTexture->residentLevel = pTexture->mipCount - 1;
+	pTexture->requestedLevel = pTexture->mipCount;
+	pTexture->residentBytes = 0;
+	pTexture->lastUsedFrame = m_frameNumber;
+	pTexture->bDecoded = false;
+	pTexture->bFailed = false;
+	pTexture->hostBytes = 0;
+	pTexture->bRestoring = false;
+	pTexture->pReplaced = NULL;
+	pTexture->pReload = NULL;
+
+	GLenum internalFormat = (colorChannels == 4) ? GL_RGBA8 : GL_RGB8;
+	int lastLevel = pTexture->mipCount - 1;
+
+	glGenTextures(1, &pTexture->textureID);
+	glBindTexture(GL_TEXTURE_2D, pTexture->textureID);
+
+	// set the texture wrapping parameters
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	// sample between the resident mip levels
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	// a single texel in the 1x1 level until the image is decoded
+	glTexImage2D(GL_TEXTURE_2D, lastLevel, internalFormat, 1, 1, 0,
+		GL_RGBA, GL_UNSIGNED_BYTE, g_PlaceholderTexel);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, lastLevel);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, lastLevel);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	pTexture->residentBytes = GetLevelBytes(pTexture, lastLevel);
+	m_totalResidentBytes += pTexture->residentBytes;
+	TrackTexture(pTexture);
+
+	m_textures.push_back(pTexture);
+	m_textureByID[pTexture->textureID] = pTexture;
+
+	// indicate to always flip images vertically when loaded
+	stbi_set_flip_vertically_on_load(true);
+
+	// queue the image for the worker thread
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_decodeQueue.push_back(pTexture);
+	}
+	m_pendingDecodes++;
+	if (!m_worker.joinable())
+	{
+		m_bStopWorker = false;
+		m_worker = std::thread(&TextureStreamer::WorkerLoop, this);
+	}
+	m_condition.notify_one();
+
+	return(pTexture->textureID);
+}
+
+/***********************************************************
+ *  ReloadTexture()
+ *
+ *  This method is used for decoding an image file again
+ *  after it changed on disk.  A copy of each texture loaded
+ *  from the file is queued for the worker thread, and the
+ *  texture keeps its current levels until Update() swaps the
+ *  new ones in.  The image may change its size.  Textures
+ *  still decoding the first time pick up the file as it is.
+ ***********************************************************/
+int TextureStreamer::ReloadTexture(const std::string& filename)
+{
+	int queuedCount = 0;
+	for (size_t i = 0; i < m_textures.size(); i++)
+	{
+		STREAMED_TEXTURE* pTexture = m_textures[i];
+		if ((pTexture->filename.compare(filename) != 0) ||
+			(false == pTexture->bDecoded) || (NULL != pTexture->pReload))
+		{
+			continue;
+		}
+
+		STREAMED_TEXTURE* pReload = new STREAMED_TEXTURE();
+		pReload->tag = pTexture->tag;
+		pReload->filename = pTexture->filename;
+		pReload->loadIndex = pTexture->loadIndex;
+		pReload->textureID = pTexture->textureID;
+		pReload->width = 0;
+		pReload->height = 0;
+		pReload->channels = 0;
+		pReload->mipCount = 0;
+		pReload->residentLevel = 0;
+		pReload->minimumLevel = 0;
+		pReload->requestedLevel = 0;
+		pReload->residentBytes = 0;
+		pReload->lastUsedFrame = m_frameNumber;
+		pReload->bDecoded = false;
+		pReload->bFailed = false;
+		pReload->hostBytes = 0;
+		pReload->bRestoring = false;
+		pReload->pReplaced = pTexture;
+		pReload->pReload = NULL;
+		pTexture->pReload = pReload;
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_decodeQueue.push_back(pReload);
+		}
+		m_pendingDecodes++;
+		queuedCount++;
+	}
+
+	if (queuedCount > 0)
+	{
+		m_condition.notify_one();
+	}
+	return(queuedCount);
+}
+
+/***********************************************************
+ *  DestroyAll()
+ *
+ *  This method is used for stopping the worker thread and
+ *  freeing the memory of all the textures.
+ ***********************************************************/
+void TextureStreamer::DestroyAll()
+{
+	if (m_worker.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			for (size_t i = 0; i < m_decodeQueue.size(); i++)
+			{
+				if (NULL != m_decodeQueue[i]->pReplaced)
+				{
+					delete m_decodeQueue[i];
+				}
+			}
+			m_decodeQueue.clear();
+			m_bStopWorker = true;
+		}
+		m_condition.notify_all();
+		m_worker.join();
+	}
+	// copies decoded for a reload are not in the texture list
+	for (size_t i = 0; i < m_decodedTextures.size(); i++)
+	{
+		if (NULL != m_decodedTextures[i]->pReplaced)
+		{
+			delete m_decodedTextures[i];
+		}
+	}
+	m_decodedTextures.clear();
+	m_pendingDecodes = 0;
+	m_bStreaming = false;
+
+	for (size_t i = 0; i < m_textures.size(); i++)
+	{
+		ResourceTracker::Release(RESOURCE_TEXTURE, m_textures[i]->textureID);
+		ResourceTracker::Release(RESOURCE_HOST_STAGING, (uint64_t)(uintptr_t)m_textures[i]);
+		glDeleteTextures(1, &m_textures[i]->textureID);
+		delete m_textures[i];
+	}
+	m_textures.clear();
+	m_textureByID.clear();
+	m_totalResidentBytes = 0;
+	m_totalHostBytes = 0;
+}
+
+/***********************************************************
+ *  SetMemoryBudget()
+ *
+ *  This method is used for setting how many bytes of GPU
+ *  memory the textures may use.  The budget is enforced on
+ *  the next Update().
+ ***********************************************************/
+void TextureStreamer::SetMemoryBudget(size_t budgetBytes)
+{
+	m_budgetBytes = budgetBytes;
+}
+
+/***********************************************************
+ *  SetUploadLimit()
+ *
+ *  This method is used for setting how many bytes may be
+ *  uploaded in one frame, which bounds the frame time hit
+ *  when many levels are requested at once.
+ ***********************************************************/
+void TextureStreamer::SetUploadLimit(size_t bytesPerFrame)
+{
+	m_uploadLimit = bytesPerFrame;
+}
+
+/***********************************************************
+ *  RequestFootprint()
+ *
+ *  This method is used for reporting an object drawn with
+ *  the texture this frame.  The finest level needed is the
+ *  one where a texel is about the size of a screen pixel.
+ ***********************************************************/
+void TextureStreamer::RequestFootprint(GLuint textureID, float uvPerPixel)
+{
+	std::unordered_map<GLuint, STREAMED_TEXTURE*>::iterator it = m_textureByID.find(textureID);
+	if (it == m_textureByID.end())
+	{
+		return;
+	}
+
+	STREAMED_TEXTURE* pTexture = it->second;
+	float texelsPerPixel = uvPerPixel * (float)std::max(pTexture->width, pTexture->height);
+	int level = 0;
+	if (texelsPerPixel > 1.0f)
+	{
+		level = (int)std::floor(std::log2(texelsPerPixel));
+	}
+	level = std::min(level, pTexture->mipCount - 1);
+
+	pTexture->requestedLevel = std::min(pTexture->requestedLevel, level);
+	pTexture->lastUsedFrame = m_frameNumber;
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for uploading the images decoded by
+ *  the worker thread, streaming in the levels requested this
+ *  frame within the upload limit, and evicting the least
+ *  recently used levels while over the memory budget.  The
+ *  lists of the frame are taken from the arena.
+ ***********************************************************/
+void TextureStreamer::Update(FrameArena& arena)
+{
+	// take the images the worker thread has finished, the list
+	// keeps its capacity for the worker
+	STREAMED_TEXTURE** decoded = NULL;
+	size_t decodedCount = 0;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		decodedCount = m_decodedTextures.size();
+		if (decodedCount > 0)
+		{
+			decoded = arena.AllocateArray<STREAMED_TEXTURE*>(decodedCount);
+			std::copy(m_decodedTextures.begin(), m_decodedTextures.end(), decoded);
+			m_decodedTextures.clear();
+		}
+	}
+	m_pendingDecodes -= decodedCount;
+	for (size_t i = 0; i < decodedCount; i++)
+	{
+		if (NULL != decoded[i]->pReplaced)
+		{
+			SwapReloadedTexture(decoded[i]);
+		}
+		else if (true == decoded[i]->bRestoring)
+		{
+			FinishRestore(decoded[i]);
+		}
+		else
+		{
+			UploadInitialLevels(decoded[i]);
+		}
+	}
+
+	// stream in one level at a time for the textures that need
+	// finer levels, those missing the most levels first and the
+	// earlier loaded first among equals.  A texture whose chain
+	// was freed decodes it again first
+	STREAMED_TEXTURE** pending = arena.AllocateArray<STREAMED_TEXTURE*>(m_textures.size());
+	size_t pendingCount = 0;
+	for (size_t i = 0; i < m_textures.size(); i++)
+	{
+		STREAMED_TEXTURE* pTexture = m_textures[i];
+		if ((false == pTexture->bDecoded) || (true == pTexture->bRestoring) ||
+			(pTexture->requestedLevel >= pTexture->residentLevel))
+		{
+			continue;
+		}
+		if (pTexture->mips.empty())
+		{
+			// a reload on the way brings a new chain anyway
+			if ((false == pTexture->bFailed) && (NULL == pTexture->pReload))
+			{
+				QueueRestore(pTexture);
+			}
+			continue;
+		}
+		pending[pendingCount++] = pTexture;
+	}
+	std::sort(pending, pending + pendingCount,
+		[](const STREAMED_TEXTURE* a, const STREAMED_TEXTURE* b)
+		{
+			int missingA = a->residentLevel - a->requestedLevel;
+			int missingB = b->residentLevel - b->requestedLevel;
+			return (missingA > missingB) || ((missingA == missingB) && (a->loadIndex < b->loadIndex));
+		});
+
+	size_t uploadedBytes = 0;
+	bool bLimitReached = false;
+	for (size_t i = 0; i < pendingCount; i++)
+	{
+		STREAMED_TEXTURE* pTexture = pending[i];
+		int level = pTexture->residentLevel - 1;
+		size_t levelBytes = GetLevelBytes(pTexture, level);
+
+		// always allow one level so large levels still arrive
+		if ((uploadedBytes > 0) && (uploadedBytes + levelBytes > m_uploadLimit))
+		{
+			bLimitReached = true;
+			break;
+		}
+		if (!MakeRoom(levelBytes, pTexture))
+		{
+			continue;
+		}
+
+		UploadLevel(pTexture, level);
+		uploadedBytes += levelBytes;
+	}
+
+	// the budget may have been lowered since the last frame
+	MakeRoom(0, NULL);
+	TrimHostMips();
+
+	// a level that did not fit in the budget is not retried
+	// until the footprints change, so it does not count
+	m_bStreaming = (m_pendingDecodes > 0) || (uploadedBytes > 0) || bLimitReached;
+
+	// the footprints are reported again every frame
+	for (size_t i = 0; i < m_textures.size(); i++)
+	{
+		m_textures[i]->requestedLevel = m_textures[i]->mipCount;
+	}
+	m_frameNumber++;
+}
+
+/***********************************************************
+ *  GetResidentBytes()
+ *
+ *  This method is used for getting the GPU memory used by
+ *  the resident levels of the texture with the passed tag.
+ ***********************************************************/
+size_t TextureStreamer::GetResidentBytes(const std::string& tag) const
+{
+	const STREAMED_TEXTURE* pTexture = FindTexture(tag);
+	if (NULL == pTexture)
+	{
+		return(0);
+	}
+
+	return(pTexture->residentBytes);
+}
+
+/***********************************************************
+ *  GetResidentLevel()
+ *
+ *  This method is used for getting the finest mip level of
+ *  the texture with the passed tag that is on the GPU.
+ ***********************************************************/
+int TextureStreamer::GetResidentLevel(const std::string& tag) const
+{
+	const STREAMED_TEXTURE* pTexture = FindTexture(tag);
+	if (NULL == pTexture)
+	{
+		return(-1);
+	}
+
+	return(pTexture->residentLevel);
+}
+
+/***********************************************************
+ *  WorkerLoop()
+ *
+ *  This method is run by the worker thread.  It decodes the
+ *  queued images one at a time and hands them back to the
+ *  render thread, which owns the OpenGL context.
+ ***********************************************************/
+void TextureStreamer::WorkerLoop()
+{
+	while (true)
+	{
+		STREAMED_TEXTURE* pTexture = NULL;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_condition.wait(lock, [this]() { return m_bStopWorker || !m_decodeQueue.empty(); });
+			if (true == m_bStopWorker)
+			{
+				return;
+			}
+			pTexture = m_decodeQueue.front();
+			m_decodeQueue.pop_front();
+		}
+
+		DecodeTexture(pTexture);
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_decodedTextures.push_back(pTexture);
+	}
+}
+
+/***********************************************************
+ *  DecodeTexture()
+ *
+ *  This method is used for reading the image file and
+ *  building its full mip chain with a 2x2 box filter.  The
+ *  chain stays in system memory while levels are streamed
+ *  in from it, until TrimHostMips() frees it.
+ ***********************************************************/
+void TextureStreamer::DecodeTexture(STREAMED_TEXTURE* pTexture)
+{
+	int width = 0;
+	int height = 0;
+	int colorChannels = 0;
+
+	unsigned char* image = stbi_load(
+		pTexture->filename.c_str(),
+		&width,
+		&height,
+		&colorChannels,
+		0);
+
+	// a reloaded image may have changed its size
+	if ((NULL != image) && (NULL != pTexture->pReplaced))
+	{
+		SetImageSize(pTexture, width, height, colorChannels);
+	}
+
+	if ((NULL == image) ||
+		(width != pTexture->width) || (height != pTexture->height) ||
+		((colorChannels != 3) && (colorChannels != 4)))
+	{
+		pTexture->bFailed = true;
+		if (NULL != image)
+		{
+			stbi_image_free(image);
+		}
+		return;
+	}
+
+	pTexture->mips.resize(pTexture->mipCount);
+	pTexture->mips[0].width = width;
+	pTexture->mips[0].height = height;
+	pTexture->mips[0].pixels.assign(image, image + (size_t)width * height * colorChannels);
+	stbi_image_free(image);
+
+	for (int level = 1; level < pTexture->mipCount; level++)
+	{
+		const MIP_LEVEL& source = pTexture->mips[level - 1];
+		MIP_LEVEL& target = pTexture->mips[level];
+		target.width = std::max(1, source.width / 2);
+		target.height = std::max(1, source.height / 2);
+		target.pixels.resize((size_t)target.width * target.height * colorChannels);
+
+		for (int y = 0; y < target.height; y++)
+		{
+			int y0 = std::min(y * 2, source.height - 1);
+			int y1 = std::min(y * 2 + 1, source.height - 1);
+			for (int x = 0; x < target.width; x++)
+			{
+				int x0 = std::min(x * 2, source.width - 1);
+				int x1 = std::min(x * 2 + 1, source.width - 1);
+				for (int c = 0; c < colorChannels; c++)
+				{
+					int sum =
+						source.pixels[((size_t)y0 * source.width + x0) * colorChannels + c] +
+						source.pixels[((size_t)y0 * source.width + x1) * colorChannels + c] +
+						source.pixels[((size_t)y1 * source.width + x0) * colorChannels + c] +
+						source.pixels[((size_t)y1 * source.width + x1) * colorChannels + c];
+					target.pixels[((size_t)y * target.width + x) * colorChannels + c] = (unsigned char)((sum + 2) / 4);
+				}
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  SetImageSize()
+ *
+ *  This method is used for setting the size of the image of
+ *  a texture, the length of its mip chain and the coarse
+ *  levels that are uploaded first and always kept resident.
+ ***********************************************************/
+void TextureStreamer::SetImageSize(STREAMED_TEXTURE* pTexture, int width, int height, int channels)
+{
+	pTexture->width = width;
+	pTexture->height = height;
+	pTexture->channels = channels;
+	pTexture->mipCount = 1 + (int)std::floor(std::log2((float)std::max(width, height)));
+	pTexture->minimumLevel = pTexture->mipCount - 1;
+
+	// the coarsest levels are the ones uploaded first
+	while ((pTexture->minimumLevel > 0) &&
+		(std::max(width >> (pTexture->minimumLevel - 1), height >> (pTexture->minimumLevel - 1)) <= g_MinimumLevelSize))
+	{
+		pTexture->minimumLevel--;
+	}
+}
+
+/***********************************************************
+ *  UploadInitialLevels()
+ *
+ *  This method is used for replacing the placeholder of a
+ *  decoded texture with its small mip levels.  These levels
+ *  are cheap and stay resident so the texture never falls
+ *  back to the placeholder again.
+ ***********************************************************/
+void TextureStreamer::UploadInitialLevels(STREAMED_TEXTURE* pTexture)
+{
+	if (true == pTexture->bFailed)
+	{
+		std::cout << "Could not decode image:" << pTexture->filename << std::endl;
+		return;
+	}
+
+	std::cout << "Successfully loaded image:" << pTexture->filename << ", width:" << pTexture->width
+		<< ", height:" << pTexture->height << ", channels:" << pTexture->channels << std::endl;
+
+	pTexture->bDecoded = true;
+	for (int level = pTexture->mipCount - 1; level >= pTexture->minimumLevel; level--)
+	{
+		UploadLevel(pTexture, level);
+	}
+
+	// the mip chain stays in system memory for the levels that
+	// are streamed in later
+	TrackHostMips(pTexture);
+}
+
+/***********************************************************
+ *  QueueRestore()
+ *
+ *  This method is used for decoding the image of a texture
+ *  again after its chain was freed, because a level that is
+ *  not resident was asked for.  The texture keeps drawing
+ *  with its resident levels meanwhile.
+ ***********************************************************/
+void TextureStreamer::QueueRestore(STREAMED_TEXTURE* pTexture)
+{
+	pTexture->bRestoring = true;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_decodeQueue.push_back(pTexture);
+	}
+	m_pendingDecodes++;
+	m_condition.notify_one();
+}
+
+/***********************************************************
+ *  FinishRestore()
+ *
+ *  This method is used for taking back a chain decoded
+ *  again.  When the file can no longer be decoded at its
+ *  size, the texture stays at the levels it has until the
+ *  file is reloaded.
+ ***********************************************************/
+void TextureStreamer::FinishRestore(STREAMED_TEXTURE* pTexture)
+{
+	pTexture->bRestoring = false;
+	if (true == pTexture->bFailed)
+	{
+		std::cout << "Could not decode image again:" << pTexture->filename << std::endl;
+		return;
+	}
+
+	TrackHostMips(pTexture);
+}
+
+/***********************************************************
+ *  TrackHostMips()
+ *
+ *  This method is used for counting the decoded chain of a
+ *  texture against the host budget and passing its size to
+ *  the resource tracker.
+ ***********************************************************/
+void TextureStreamer::TrackHostMips(STREAMED_TEXTURE* pTexture)
+{
+	size_t mipBytes = 0;
+	for (size_t i = 0; i < pTexture->mips.size(); i++)
+	{
+		mipBytes += pTexture->mips[i].pixels.size();
+	}
+	m_totalHostBytes = m_totalHostBytes - pTexture->hostBytes + mipBytes;
+	pTexture->hostBytes = mipBytes;
+	ResourceTracker::Track(RESOURCE_HOST_STAGING, (uint64_t)(uintptr_t)pTexture,
+		g_TrackerName, pTexture->filename.c_str(), mipBytes);
+}
+
+/***********************************************************
+ *  FreeHostMips()
+ *
+ *  This method is used for freeing the decoded chain of a
+ *  texture, its resident levels stay on the GPU.
+ ***********************************************************/
+void TextureStreamer::FreeHostMips(STREAMED_TEXTURE* pTexture)
+{
+	m_totalHostBytes -= pTexture->hostBytes;
+	pTexture->hostBytes = 0;
+	std::vector<MIP_LEVEL>().swap(pTexture->mips);
+	ResourceTracker::Release(RESOURCE_HOST_STAGING, (uint64_t)(uintptr_t)pTexture);
+}
+
+/***********************************************************
+ *  TrimHostMips()
+ *
+ *  This method is used for freeing the decoded chains that
+ *  are not needed.  A texture with its finest level on the
+ *  GPU has nothing left to stream in.  Over the budget, the
+ *  least recently used chains go first, but not the ones
+ *  still streaming in levels asked for this frame.
+ ***********************************************************/
+void TextureStreamer::TrimHostMips()
+{
+	for (size_t i = 0; i < m_textures.size(); i++)
+	{
+		STREAMED_TEXTURE* pTexture = m_textures[i];
+		if ((false == pTexture->bRestoring) && (pTexture->hostBytes > 0) &&
+			(0 == pTexture->residentLevel))
+		{
+			FreeHostMips(pTexture);
+		}
+	}
+
+	while (m_totalHostBytes > g_HostBudgetBytes)
+	{
+		STREAMED_TEXTURE* pVictim = NULL;
+		for (size_t i = 0; i < m_textures.size(); i++)
+		{
+			STREAMED_TEXTURE* pTexture = m_textures[i];
+			if ((true == pTexture->bRestoring) || (0 == pTexture->hostBytes))
+			{
+				continue;
+			}
+			if ((pTexture->lastUsedFrame == m_frameNumber) &&
+				(pTexture->requestedLevel < pTexture->residentLevel))
+			{
+				continue;
+			}
+			if ((NULL == pVictim) || (pTexture->lastUsedFrame < pVictim->lastUsedFrame))
+			{
+				pVictim = pTexture;
+			}
+		}
+
+		if (NULL == pVictim)
+		{
+			break;
+		}
+		FreeHostMips(pVictim);
+	}
+}
+
+/***********************************************************
+ *  SwapReloadedTexture()
+ *
+ *  This method is used for replacing the levels of a texture
+ *  with the ones of its copy decoded again.  The old levels
+ *  are freed and the small new ones uploaded like the first
+ *  time, the finer ones stream in over the next frames, so
+ *  the swap costs no more than loading a texture.  The
+ *  texture ID stays the same, so nothing that refers to the
+ *  texture has to change.  When the new image could not be
+ *  decoded the old one stays.
+ ***********************************************************/
+void TextureStreamer::SwapReloadedTexture(STREAMED_TEXTURE* pReload)
+{
+	STREAMED_TEXTURE* pTexture = pReload->pReplaced;
+	pTexture->pReload = NULL;
+
+	if (true == pReload->bFailed)
+	{
+		std::cout << "Could not reload image:" << pTexture->filename << ", keeping the old one" << std::endl;
+		delete pReload;
+		return;
+	}
+
+	GLenum format = (pTexture->channels == 4) ? GL_RGBA : GL_RGB;
+	GLenum internalFormat = (pTexture->channels == 4) ? GL_RGBA8 : GL_RGB8;
+	GLTrace::BindTexture(GL_TEXTURE_2D, pTexture->textureID);
+	for (int level = pTexture->residentLevel; level < pTexture->mipCount; level++)
+	{
+		GLTrace::TexImage2D(GL_TEXTURE_2D, level, internalFormat, 0, 0,
+			format, GL_UNSIGNED_BYTE, NULL, 0);
+	}
+	GLTrace::BindTexture(GL_TEXTURE_2D, 0);
+	m_totalResidentBytes -= pTexture->residentBytes;
+
+	pTexture->width = pReload->width;
+	pTexture->height = pReload->height;
+	pTexture->channels = pReload->channels;
+	pTexture->mipCount = pReload->mipCount;
+	pTexture->minimumLevel = pReload->minimumLevel;
+	pTexture->mips.swap(pReload->mips);
+	// the new file decoded, so the chain can be restored again
+	pTexture->bFailed = false;
+	// no level is resident, so the first upload counts them all
+	pTexture->residentLevel = pTexture->mipCount;
+	pTexture->requestedLevel = pTexture->mipCount;
+	pTexture->residentBytes = 0;
+	delete pReload;
+
+	UploadInitialLevels(pTexture);
+}
+
+/***********************************************************
+ *  UploadLevel()
+ *
+ *  This method is used for copying a mip level from system
+ *  memory into the texture and making it the finest level
+ *  the sampler may use.
+ ***********************************************************/
+void TextureStreamer::UploadLevel(STREAMED_TEXTURE* pTexture, int level)
+{
+	const MIP_LEVEL& mip = pTexture->mips[level];
+	GLenum format = (pTexture->channels == 4) ? GL_RGBA : GL_RGB;
+	GLenum internalFormat = (pTexture->channels == 4) ? GL_RGBA8 : GL_RGB8;
+	size_t levelBytes = GetLevelBytes(pTexture, level);
+
+	// the placeholder already counts the last level
+	if (level < pTexture->residentLevel)
+	{
+		pTexture->residentBytes += levelBytes;
+		m_totalResidentBytes += levelBytes;
+		pTexture->residentLevel = level;
+	}
+
+	GLTrace::BindTexture(GL_TEXTURE_2D, pTexture->textureID);
+	// rows of the small RGB levels are not 4 byte aligned
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	GLTrace::TexImage2D(GL_TEXTURE_2D, level, internalFormat, mip.width, mip.height,
+		format, GL_UNSIGNED_BYTE, mip.pixels.data(), mip.pixels.size());
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, pTexture->residentLevel);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, pTexture->mipCount - 1);
+	GLTrace::BindTexture(GL_TEXTURE_2D, 0);
+	TrackTexture(pTexture);
+}
+
+/***********************************************************
+ *  EvictLevel()
+ *
+ *  This method is used for releasing the finest resident
+ *  level of the texture.  The level is redefined with no
+ *  size so the driver frees its storage, and the base level
+ *  moves to the next coarser one.
+ ***********************************************************/
+void TextureStreamer::EvictLevel(STREAMED_TEXTURE* pTexture)
+{
+	int level = pTexture->residentLevel;
+	GLenum format = (pTexture->channels == 4) ? GL_RGBA : GL_RGB;
+	GLenum internalFormat = (pTexture->channels == 4) ? GL_RGBA8 : GL_RGB8;
+	size_t levelBytes = GetLevelBytes(pTexture, level);
+
+	pTexture->residentLevel = level + 1;
+	pTexture->residentBytes -= levelBytes;
+	m_totalResidentBytes -= levelBytes;
+
+	GLTrace::BindTexture(GL_TEXTURE_2D, pTexture->textureID);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, pTexture->residentLevel);
+	GLTrace::TexImage2D(GL_TEXTURE_2D, level, internalFormat, 0, 0,
+		format, GL_UNSIGNED_BYTE, NULL, 0);
+	GLTrace::BindTexture(GL_TEXTURE_2D, 0);
+	TrackTexture(pTexture);
+}
+
+/***********************************************************
+ *  TrackTexture()
+ *
+ *  This method is used for passing the resident size of the
+ *  texture to the resource tracker.
+ ***********************************************************/
+void TextureStreamer::TrackTexture(const STREAMED_TEXTURE* pTexture)
+{
+	ResourceTracker::Track(RESOURCE_TEXTURE, pTexture->textureID,
+		g_TrackerName, pTexture->filename.c_str(), pTexture->residentBytes);
+}
+
+/***********************************************************
+ *  MakeRoom()
+ *
+ *  This method is used for evicting levels until the passed
+ *  number of bytes fits in the budget.  The least recently
+ *  used texture loses its finest level first.  Textures used
+ *  this frame only give up levels finer than they need, and
+ *  the minimum levels are never evicted.
+ ***********************************************************/
+bool TextureStreamer::MakeRoom(size_t bytesNeeded, const STREAMED_TEXTURE* pKeep)
+{
+	while (m_totalResidentBytes + bytesNeeded > m_budgetBytes)
+	{
+		STREAMED_TEXTURE* pVictim = NULL;
+		for (size_t i = 0; i < m_textures.size(); i++)
+		{
+			STREAMED_TEXTURE* pTexture = m_textures[i];
+			if ((pTexture == pKeep) ||
+				(pTexture->residentLevel >= pTexture->minimumLevel))
+			{
+				continue;
+			}
+			if ((pTexture->lastUsedFrame == m_frameNumber) &&
+				(pTexture->residentLevel >= pTexture->requestedLevel))
+			{
+				continue;
+			}
+			if ((NULL == pVictim) ||
+				(pTexture->lastUsedFrame < pVictim->lastUsedFrame) ||
+				((pTexture->lastUsedFrame == pVictim->lastUsedFrame) &&
+				 (pTexture->residentLevel < pVictim->residentLevel)))
+			{
+				pVictim = pTexture;
+			}
+		}
+
+		if (NULL == pVictim)
+		{
+			return(false);
+		}
+		EvictLevel(pVictim);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  GetLevelBytes()
+ *
+ *  This method is used for estimating the GPU memory of a
+ *  mip level.  RGB8 textures are counted at four bytes per
+ *  texel since drivers pad them to RGBA8.
+ ***********************************************************/
+size_t TextureStreamer::GetLevelBytes(const STREAMED_TEXTURE* pTexture, int level) const
+{
+	size_t width = (size_t)std::max(1, pTexture->width >> level);
+	size_t height = (size_t)std::max(1, pTexture->height >> level);
+
+	return(width * height * 4);
+}
+
+/***********************************************************
+ *  FindTexture()
+ *
+ *  This method is used for finding a texture by its tag.
+ ***********************************************************/
+const TextureStreamer::STREAMED_TEXTURE* TextureStreamer::FindTexture(const std::string& tag) const
+{
+	for (size_t i = 0; i < m_textures.size(); i++)
+	{
+		if (m_textures[i]->tag.compare(tag) == 0)
+		{
+			return(m_textures[i]);
+		}
+	}
+
+	return(NULL);
+}
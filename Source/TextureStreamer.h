@@ -0,0 +1,171 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturestreamer.h
+// ============
+// stream texture mip levels in and out of GPU memory on demand
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "FrameArena.h"
+
+#include <GL/glew.h>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/***********************************************************
+ *  TextureStreamer
+ *
+ *  This class owns the scene textures and decides which mip
+ *  levels of each one are resident on the GPU.  Images are
+ *  decoded and their mip chain built on a worker thread,
+ *  then only the small levels are uploaded.  Finer levels
+ *  are streamed in when the screen footprint of the objects
+ *  using a texture asks for them, and the least recently
+ *  used levels are evicted to stay under the memory budget.
+ *
+ *  The decoded chains are host memory under a budget of
+ *  their own.  A chain is freed once its finest level is on
+ *  the GPU, or when the least recently used chains go over
+ *  the budget, and the image is decoded again when a freed
+ *  level is asked for.
+ *
+ *  The OpenGL texture ID never changes while a texture is
+ *  loaded: levels are added and removed in place and the
+ *  GL_TEXTURE_BASE_LEVEL selects the finest resident one.
+ ***********************************************************/
+class TextureStreamer
+{
+public:
+	// constructor
+	TextureStreamer();
+	// destructor
+	~TextureStreamer();
+
+	// start loading an image file, returns the OpenGL texture
+	// ID right away or 0 when the file cannot be read
+	GLuint LoadTexture(const char* filename, const std::string& tag);
+	// decode the image file of the textures loaded from it
+	// again and swap the new image in once it is ready, under
+	// the same OpenGL texture IDs.  Returns how many textures
+	// were queued
+	int ReloadTexture(const std::string& filename);
+	// delete all the textures
+	void DestroyAll();
+
+	// set the GPU memory the textures may use, in bytes
+	void SetMemoryBudget(size_t budgetBytes);
+	// set the most bytes uploaded in a single frame
+	void SetUploadLimit(size_t bytesPerFrame);
+
+	// report how much of the UV range one screen pixel covers
+	// on an object drawn with the texture this frame
+	void RequestFootprint(GLuint textureID, float uvPerPixel);
+	// upload decoded images, stream requested levels in and
+	// evict levels over budget - called once per frame
+	void Update(FrameArena& arena);
+
+	// bytes resident on the GPU for a texture or for all
+	size_t GetResidentBytes(const std::string& tag) const;
+	size_t GetTotalResidentBytes() const { return m_totalResidentBytes; }
+	size_t GetMemoryBudget() const { return m_budgetBytes; }
+	// finest resident mip level of a texture, -1 if unknown
+	int GetResidentLevel(const std::string& tag) const;
+	// true while images are decoding or levels are streaming in,
+	// so more frames are needed to show the finished textures
+	bool IsStreaming() const { return m_bStreaming; }
+
+private:
+	struct MIP_LEVEL
+	{
+		int width;
+		int height;
+		std::vector<unsigned char> pixels;
+	};
+
+	struct STREAMED_TEXTURE
+	{
+		std::string tag;
+		std::string filename;
+		// position in the load order
+		size_t loadIndex;
+		GLuint textureID;
+		int width;
+		int height;
+		int channels;
+		int mipCount;
+		// finest level resident on the GPU
+		int residentLevel;
+		// coarsest level kept resident no matter the budget
+		int minimumLevel;
+		// finest level asked for by the footprint this frame
+		int requestedLevel;
+		size_t residentBytes;
+		unsigned long long lastUsedFrame;
+		// decoded mip chain, written by the worker thread
+		bool bDecoded;
+		bool bFailed;
+		std::vector<MIP_LEVEL> mips;
+		// bytes of the chain counted against the host budget
+		size_t hostBytes;
+		// the freed chain is being decoded again
+		bool bRestoring;
+		// a copy being decoded again replaces the texture it was
+		// made from, which points back at it until then
+		STREAMED_TEXTURE* pReplaced;
+		STREAMED_TEXTURE* pReload;
+	};
+
+	std::vector<STREAMED_TEXTURE*> m_textures;
+	std::unordered_map<GLuint, STREAMED_TEXTURE*> m_textureByID;
+	size_t m_budgetBytes;
+	size_t m_uploadLimit;
+	size_t m_totalResidentBytes;
+	size_t m_totalHostBytes;
+	unsigned long long m_frameNumber;
+	// images queued for decoding and not yet taken back
+	size_t m_pendingDecodes;
+	bool m_bStreaming;
+
+	// background decoding
+	std::thread m_worker;
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	std::deque<STREAMED_TEXTURE*> m_decodeQueue;
+	std::vector<STREAMED_TEXTURE*> m_decodedTextures;
+	bool m_bStopWorker;
+
+	// worker thread loop and image decoding
+	void WorkerLoop();
+	void DecodeTexture(STREAMED_TEXTURE* pTexture);
+	// mip chain size of an image and the levels kept resident
+	void SetImageSize(STREAMED_TEXTURE* pTexture, int width, int height, int channels);
+
+	// first upload after the image was decoded
+	void UploadInitialLevels(STREAMED_TEXTURE* pTexture);
+	// decode the freed chain of a texture again, or take it back
+	void QueueRestore(STREAMED_TEXTURE* pTexture);
+	void FinishRestore(STREAMED_TEXTURE* pTexture);
+	// count or free the decoded chain of a texture
+	void TrackHostMips(STREAMED_TEXTURE* pTexture);
+	void FreeHostMips(STREAMED_TEXTURE* pTexture);
+	// free the chains that are no longer needed or over budget
+	void TrimHostMips();
+	// replace the levels of a texture with its decoded copy
+	void SwapReloadedTexture(STREAMED_TEXTURE* pReload);
+	// add or remove the finest resident level
+	void UploadLevel(STREAMED_TEXTURE* pTexture, int level);
+	void EvictLevel(STREAMED_TEXTURE* pTexture);
+	void TrackTexture(const STREAMED_TEXTURE* pTexture);
+	// free memory from the least recently used textures
+	bool MakeRoom(size_t bytesNeeded, const STREAMED_TEXTURE* pKeep);
+
+	// bytes a level takes on the GPU
+	size_t GetLevelBytes(const STREAMED_TEXTURE* pTexture, int level) const;
+	const STREAMED_TEXTURE* FindTexture(const std::string& tag) const;
+};
@@ -0,0 +1,396 @@
+///////////////////////////////////////////////////////////////////////////////
+// trailrenderer.cpp
+// ============
+// draw the recent flight paths of the drones from a ring buffer on the GPU
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TrailRenderer.h"
+#include "ResourceTracker.h"
+
+#include <algorithm>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// seconds between two samples of a trail
+	const double g_SampleSeconds = 0.05;
+	// limits of the samples kept per drone
+	const int g_MinSamples = 2;
+	const int g_MaxSamples = 4096;
+	// drones nearer the camera than this draw every segment,
+	// each doubling of the distance doubles the stride
+	const float g_DetailDistance = 25.0f;
+	// width of the lines in pixels
+	const float g_TrailPixels = 3.0f;
+	// must match the binding of the vertex shader
+	const GLuint g_SampleBinding = 0;
+
+	const char* const g_TrackerName = "trails";
+	const char* const g_VertexShaderFilename = "trailVertexShader.glsl";
+	const char* const g_FragmentShaderFilename = "trailFragmentShader.glsl";
+
+	const int g_ViewName = GLTrace::RegisterName("view");
+	const int g_ProjectionName = GLTrace::RegisterName("projection");
+	const int g_ViewportSizeName = GLTrace::RegisterName("viewportSize");
+	const int g_TrailWidthName = GLTrace::RegisterName("trailWidth");
+	const int g_DroneCountName = GLTrace::RegisterName("trailDroneCount");
+	const int g_RowCountName = GLTrace::RegisterName("trailRowCount");
+	const int g_NewestRowName = GLTrace::RegisterName("trailNewestRow");
+	const int g_TimeName = GLTrace::RegisterName("trailTime");
+	const int g_DurationName = GLTrace::RegisterName("trailDuration");
+}
+
+/***********************************************************
+ *  TrailRenderer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TrailRenderer::TrailRenderer()
+{
+	m_pShader = NULL;
+	m_sampleBuffer = 0;
+	m_instanceBuffer = 0;
+	m_indirectBuffer = 0;
+	m_vertexArray = 0;
+	m_sampleCount = 0;
+	m_droneCount = 0;
+	m_newestRow = -1;
+	m_filledRows = 0;
+	m_rowSeconds = 0.0;
+	m_startSeconds = 0.0;
+	m_trailSeconds = 0.0f;
+	m_commandCount = 0;
+	m_rowCount = 0;
+	m_uploadBytes = 0;
+	m_lastSegmentCount = 0;
+	for (int i = 0; i < LOD_COUNT; i++)
+	{
+		m_lodCounts[i] = 0;
+	}
+}
+
+/***********************************************************
+ *  ~TrailRenderer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TrailRenderer::~TrailRenderer()
+{
+	DeleteBuffers();
+	if (0 != m_indirectBuffer)
+	{
+		ResourceTracker::Release(RESOURCE_BUFFER, m_indirectBuffer);
+		glDeleteBuffers(1, &m_indirectBuffer);
+		m_indirectBuffer = 0;
+	}
+	if (0 != m_vertexArray)
+	{
+		glDeleteVertexArrays(1, &m_vertexArray);
+		m_vertexArray = 0;
+	}
+	if (NULL != m_pShader)
+	{
+		ResourceTracker::Release(RESOURCE_PROGRAM, m_pShader->m_programID);
+		delete m_pShader;
+		m_pShader = NULL;
+	}
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for loading the trail shader and
+ *  creating the buffer of the draws.  The sample ring is
+ *  only created once the number of drones is known.  The
+ *  storage buffer and the indirect draws need OpenGL 4.3.
+ ***********************************************************/
+bool TrailRenderer::Initialize(int sampleCount)
+{
+	if (!GLEW_VERSION_4_3)
+	{
+		std::cout << "Trails need OpenGL 4.3 and are not drawn" << std::endl;
+		return(false);
+	}
+	m_sampleCount = glm::clamp(sampleCount, g_MinSamples, g_MaxSamples);
+
+	if (!LoadShader())
+	{
+		return(false);
+	}
+
+	glGenBuffers(1, &m_indirectBuffer);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectBuffer);
+	glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(m_commands), NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	ResourceTracker::Track(RESOURCE_BUFFER, m_indirectBuffer, g_TrackerName, "trail draws", sizeof(m_commands));
+
+	std::cout << "Trails of " << m_sampleCount << " samples, " << g_SampleSeconds * m_sampleCount
+		<< " seconds long" << std::endl;
+	return(true);
+}
+
+/***********************************************************
+ *  LoadShader()
+ *
+ *  This method is used for loading the trail shader.
+ ***********************************************************/
+bool TrailRenderer::LoadShader()
+{
+	m_pShader = new ShaderManager();
+	m_pShader->LoadShaders(g_VertexShaderFilename, g_FragmentShaderFilename);
+	if (0 == m_pShader->m_programID)
+	{
+		std::cout << "The trail shader failed to load" << std::endl;
+		delete m_pShader;
+		m_pShader = NULL;
+		return(false);
+	}
+	ResourceTracker::TrackProgram(m_pShader->m_programID, g_TrackerName, g_VertexShaderFilename);
+	return(true);
+}
+
+/***********************************************************
+ *  WatchShaders()
+ *
+ *  This method is used for having the trail shader rebuilt
+ *  when one of its files changes.  Every value it reads is
+ *  set again by each Draw(), so nothing has to be restored.
+ ***********************************************************/
+void TrailRenderer::WatchShaders(HotReload* pHotReload)
+{
+	if (NULL == m_pShader)
+	{
+		return;
+	}
+	pHotReload->WatchProgram(m_pShader,
+		g_VertexShaderFilename, NULL, g_FragmentShaderFilename, g_TrackerName,
+		HotReload::ProgramFunc());
+}
+
+/***********************************************************
+ *  CreateBuffers()
+ *
+ *  This method is used for creating the sample ring and the
+ *  instance list for a number of drones.  The ring holds
+ *  m_sampleCount rows of one position and time per drone
+ *  and starts out empty.  The instance list is attribute 0
+ *  of the vertex array, advancing once per instance.
+ ***********************************************************/
+void TrailRenderer::CreateBuffers(int droneCount)
+{
+	DeleteBuffers();
+	m_droneCount = droneCount;
+	m_newestRow = -1;
+	m_filledRows = 0;
+	if (0 == droneCount)
+	{
+		return;
+	}
+
+	m_row.resize(droneCount);
+	m_droneLods.resize(droneCount);
+	m_instances.resize(droneCount);
+
+	glGenBuffers(1, &m_sampleBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_sampleBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, GetRingBytes(), NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_SampleBinding, m_sampleBuffer);
+	ResourceTracker::Track(RESOURCE_BUFFER, m_sampleBuffer, g_TrackerName, "trail samples", GetRingBytes());
+
+	if (0 == m_vertexArray)
+	{
+		glGenVertexArrays(1, &m_vertexArray);
+	}
+	glGenBuffers(1, &m_instanceBuffer);
+	glBindVertexArray(m_vertexArray);
+	glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+	glBufferData(GL_ARRAY_BUFFER, droneCount * sizeof(TRAIL_INSTANCE), NULL, GL_DYNAMIC_DRAW);
+	glVertexAttribIPointer(0, 2, GL_UNSIGNED_INT, sizeof(TRAIL_INSTANCE), (void*)0);
+	glEnableVertexAttribArray(0);
+	glVertexAttribDivisor(0, 1);
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	ResourceTracker::Track(RESOURCE_BUFFER, m_instanceBuffer, g_TrackerName, "trail instances",
+		droneCount * sizeof(TRAIL_INSTANCE));
+}
+
+/***********************************************************
+ *  DeleteBuffers()
+ *
+ *  This method is used for deleting the sample ring and the
+ *  instance list.
+ ***********************************************************/
+void TrailRenderer::DeleteBuffers()
+{
+	if (0 != m_sampleBuffer)
+	{
+		ResourceTracker::Release(RESOURCE_BUFFER, m_sampleBuffer);
+		glDeleteBuffers(1, &m_sampleBuffer);
+		m_sampleBuffer = 0;
+	}
+	if (0 != m_instanceBuffer)
+	{
+		ResourceTracker::Release(RESOURCE_BUFFER, m_instanceBuffer);
+		glDeleteBuffers(1, &m_instanceBuffer);
+		m_instanceBuffer = 0;
+	}
+	m_droneCount = 0;
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for writing the positions of the
+ *  drones into the newest row of the ring.  Once the newest
+ *  row is a whole sample interval old the next row is
+ *  started, overwriting the oldest one.  A new number of
+ *  drones starts the trails over.
+ ***********************************************************/
+void TrailRenderer::Update(const std::vector<glm::mat4>* pDrones, double seconds, const glm::vec3& cameraPosition)
+{
+	m_commandCount = 0;
+	if (NULL == m_pShader)
+	{
+		return;
+	}
+	int droneCount = (NULL == pDrones) ? 0 : (int)pDrones->size();
+	if (droneCount != m_droneCount)
+	{
+		CreateBuffers(droneCount);
+	}
+	if (0 == m_droneCount)
+	{
+		return;
+	}
+
+	if ((0 == m_filledRows) || (seconds - m_rowSeconds >= g_SampleSeconds) || (seconds < m_rowSeconds))
+	{
+		if (0 == m_filledRows)
+		{
+			m_startSeconds = seconds;
+		}
+		m_newestRow = (m_newestRow + 1) % m_sampleCount;
+		m_filledRows = std::min(m_filledRows + 1, m_sampleCount);
+		m_rowSeconds = seconds;
+		m_rowCount++;
+	}
+	m_trailSeconds = (float)(seconds - m_startSeconds);
+
+	const std::vector<glm::mat4>& drones = *pDrones;
+	for (int i = 0; i < m_droneCount; i++)
+	{
+		m_row[i] = glm::vec4(glm::vec3(drones[i][3]), m_trailSeconds);
+	}
+	GLsizeiptr rowBytes = (GLsizeiptr)m_droneCount * sizeof(glm::vec4);
+	GLTrace::BindBuffer(GL_SHADER_STORAGE_BUFFER, m_sampleBuffer);
+	GLTrace::BufferSubData(GL_SHADER_STORAGE_BUFFER, (GLintptr)m_newestRow * rowBytes, rowBytes, m_row.data());
+	GLTrace::BindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	m_uploadBytes += rowBytes;
+
+	SortDrones(drones, cameraPosition);
+}
+
+/***********************************************************
+ *  SortDrones()
+ *
+ *  This method is used for picking the stride of each drone
+ *  from its distance to the camera and counting sorting the
+ *  drones by it, so the drones of a stride are one range of
+ *  the instance list and one draw.  A draw has six vertices
+ *  per segment, the segments of a stride spanning as much
+ *  of the ring as it fits.
+ ***********************************************************/
+void TrailRenderer::SortDrones(const std::vector<glm::mat4>& drones, const glm::vec3& cameraPosition)
+{
+	for (int lod = 0; lod < LOD_COUNT; lod++)
+	{
+		m_lodCounts[lod] = 0;
+	}
+	for (int i = 0; i < m_droneCount; i++)
+	{
+		float distance = glm::length(glm::vec3(drones[i][3]) - cameraPosition);
+		int lod = 0;
+		float limit = g_DetailDistance;
+		while ((lod + 1 < LOD_COUNT) && (distance > limit))
+		{
+			lod++;
+			limit *= 2.0f;
+		}
+		m_droneLods[i] = (uint8_t)lod;
+		m_lodCounts[lod]++;
+	}
+
+	int firsts[LOD_COUNT];
+	int first = 0;
+	for (int lod = 0; lod < LOD_COUNT; lod++)
+	{
+		firsts[lod] = first;
+		first += m_lodCounts[lod];
+	}
+	for (int i = 0; i < m_droneCount; i++)
+	{
+		int lod = m_droneLods[i];
+		TRAIL_INSTANCE& instance = m_instances[firsts[lod]++];
+		instance.drone = (uint32_t)i;
+		instance.stride = 1u << lod;
+	}
+	GLTrace::BindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+	GLTrace::BufferSubData(GL_ARRAY_BUFFER, 0, m_droneCount * sizeof(TRAIL_INSTANCE), m_instances.data());
+	GLTrace::BindBuffer(GL_ARRAY_BUFFER, 0);
+	m_uploadBytes += m_droneCount * sizeof(TRAIL_INSTANCE);
+
+	first = 0;
+	for (int lod = 0; lod < LOD_COUNT; lod++)
+	{
+		int segments = (m_filledRows - 1) >> lod;
+		if ((m_lodCounts[lod] > 0) && (segments > 0))
+		{
+			DRAW_ARRAYS_INDIRECT& command = m_commands[m_commandCount++];
+			command.count = (uint32_t)segments * 6;
+			command.instanceCount = (uint32_t)m_lodCounts[lod];
+			command.first = 0;
+			command.baseInstance = (uint32_t)first;
+		}
+		first += m_lodCounts[lod];
+	}
+}
+
+/***********************************************************
+ *  Draw()
+ *
+ *  This method is used for drawing the trails of all the
+ *  drones for a view with one call.  The blending and depth
+ *  state are left to the caller.
+ ***********************************************************/
+void TrailRenderer::Draw(const glm::mat4& view, const glm::mat4& projection, const glm::vec2& viewportSize)
+{
+	m_lastSegmentCount = 0;
+	if ((NULL == m_pShader) || (0 == m_commandCount))
+	{
+		return;
+	}
+
+	GLTrace::UseProgram(m_pShader);
+	GLTrace::SetMat4(m_pShader, g_ViewName, view);
+	GLTrace::SetMat4(m_pShader, g_ProjectionName, projection);
+	GLTrace::SetVec2(m_pShader, g_ViewportSizeName, viewportSize);
+	GLTrace::SetFloat(m_pShader, g_TrailWidthName, g_TrailPixels);
+	GLTrace::SetInt(m_pShader, g_DroneCountName, m_droneCount);
+	GLTrace::SetInt(m_pShader, g_RowCountName, m_sampleCount);
+	GLTrace::SetInt(m_pShader, g_NewestRowName, m_newestRow);
+	GLTrace::SetFloat(m_pShader, g_TimeName, m_trailSeconds);
+	GLTrace::SetFloat(m_pShader, g_DurationName, (float)(g_SampleSeconds * (m_sampleCount - 1)));
+
+	GLTrace::BindVertexArray(m_vertexArray);
+	GLTrace::BindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectBuffer);
+	GLTrace::MultiDrawArraysIndirect(GL_TRIANGLES, m_commands, m_commandCount);
+	GLTrace::BindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	GLTrace::BindVertexArray(0);
+
+	for (int i = 0; i < m_commandCount; i++)
+	{
+		m_lastSegmentCount += (unsigned long long)(m_commands[i].count / 6) * m_commands[i].instanceCount;
+	}
+}
@@ -0,0 +1,119 @@
+///////////////////////////////////////////////////////////////////////////////
+// trailrenderer.h
+// ============
+// draw the recent flight paths of the drones from a ring buffer on the GPU
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "GLTrace.h"
+#include "ShaderManager.h"
+#include "HotReload.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  TrailRenderer
+ *
+ *  This class draws a fading line behind every drone along
+ *  the path it flew.  The positions are sampled at a fixed
+ *  rate into a ring of rows in a storage buffer, one row of
+ *  all the drones per sample, so a frame only uploads the
+ *  newest row and the older samples never move.  The newest
+ *  row follows the drones every frame until the next sample
+ *  is due, so the lines stay attached to them.
+ *
+ *  Nothing but the sample index is fed to the vertex
+ *  shader, which reads the two ends of its segment from the
+ *  ring and widens it to a fixed number of pixels on the
+ *  screen.  Drones far from the camera draw every second,
+ *  fourth or eighth segment.  The drones are sorted by that
+ *  stride into one instance list each frame and all of them
+ *  are drawn with a single indirect multi-draw.
+ ***********************************************************/
+class TrailRenderer
+{
+public:
+	// constructor
+	TrailRenderer();
+	// destructor
+	~TrailRenderer();
+
+	// load the trail shader, the samples kept per drone set the
+	// length of the trails
+	bool Initialize(int sampleCount);
+	// have the shader rebuilt when one of its files changes
+	void WatchShaders(HotReload* pHotReload);
+
+	// sample the positions of the drones, called once per frame
+	// with the time in seconds and the camera the distances are
+	// measured from
+	void Update(const std::vector<glm::mat4>* pDrones, double seconds, const glm::vec3& cameraPosition);
+	// draw the trails for a view of the given size in pixels
+	void Draw(const glm::mat4& view, const glm::mat4& projection, const glm::vec2& viewportSize);
+
+	int GetSampleCount() const { return m_sampleCount; }
+	int GetDroneCount() const { return m_droneCount; }
+	// bytes of the sample ring
+	size_t GetRingBytes() const { return (size_t)m_sampleCount * m_droneCount * sizeof(glm::vec4); }
+	// sample rows started since the start
+	unsigned long long GetRowCount() const { return m_rowCount; }
+	// bytes uploaded by Update() since the start
+	unsigned long long GetUploadBytes() const { return m_uploadBytes; }
+	// segments drawn by the last Draw()
+	unsigned long long GetLastSegmentCount() const { return m_lastSegmentCount; }
+
+private:
+	// strides the drones are sorted into by distance
+	static const int LOD_COUNT = 4;
+
+	// the per instance vertex attribute
+	struct TRAIL_INSTANCE
+	{
+		uint32_t drone;
+		uint32_t stride;
+	};
+
+	ShaderManager* m_pShader;
+	GLuint m_sampleBuffer;
+	GLuint m_instanceBuffer;
+	GLuint m_indirectBuffer;
+	GLuint m_vertexArray;
+
+	int m_sampleCount;
+	int m_droneCount;
+	// ring row the newest sample is in, and how many rows hold
+	// samples
+	int m_newestRow;
+	int m_filledRows;
+	// seconds the newest row was started at and the trails
+	// started at, sample times are kept from the start so they
+	// stay precise as floats
+	double m_rowSeconds;
+	double m_startSeconds;
+	float m_trailSeconds;
+
+	std::vector<glm::vec4> m_row;
+	std::vector<uint8_t> m_droneLods;
+	std::vector<TRAIL_INSTANCE> m_instances;
+	int m_lodCounts[LOD_COUNT];
+	DRAW_ARRAYS_INDIRECT m_commands[LOD_COUNT];
+	int m_commandCount;
+
+	unsigned long long m_rowCount;
+	unsigned long long m_uploadBytes;
+	unsigned long long m_lastSegmentCount;
+
+	bool LoadShader();
+	// create the buffers for a number of drones, dropping the
+	// samples kept so far
+	void CreateBuffers(int droneCount);
+	void DeleteBuffers();
+	// sort the drones into the instance list by stride and build
+	// the draws of the strides
+	void SortDrones(const std::vector<glm::mat4>& drones, const glm::vec3& cameraPosition);
+};
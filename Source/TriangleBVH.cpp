@@ -0,0 +1,295 @@
+///////////////////////////////////////////////////////////////////////////////
+// trianglebvh.cpp
+// ============
+// bounding volume hierarchy for tracing rays against triangles
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TriangleBVH.h"
+
+#include <algorithm>
+#include <cmath>
+
+// declaration of global variables
+namespace
+{
+	// most triangles kept in one leaf
+	const uint32_t g_LeafTriangles = 4;
+	// below this depth ranges are split in half by count, so
+	// the tree never gets deeper than the query stack
+	const int g_MaxMiddleSplitDepth = 32;
+	const int g_StackSize = 64;
+}
+
+/***********************************************************
+ *  TriangleBVH()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TriangleBVH::TriangleBVH()
+{
+}
+
+/***********************************************************
+ *  ~TriangleBVH()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TriangleBVH::~TriangleBVH()
+{
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for dropping the triangles and the
+ *  tree built over them.
+ ***********************************************************/
+void TriangleBVH::Clear()
+{
+	m_triangles.clear();
+	m_nodes.clear();
+}
+
+/***********************************************************
+ *  AddTriangle()
+ *
+ *  This method is used for adding a triangle.  It is kept as
+ *  a corner and two edges, what the hit test needs.
+ ***********************************************************/
+void TriangleBVH::AddTriangle(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+{
+	BVH_TRIANGLE triangle;
+	triangle.a = a;
+	triangle.edge1 = b - a;
+	triangle.edge2 = c - a;
+	m_triangles.push_back(triangle);
+}
+
+/***********************************************************
+ *  Build()
+ *
+ *  This method is used for building the tree over all the
+ *  added triangles, which are put into the order of the
+ *  leaves.
+ ***********************************************************/
+void TriangleBVH::Build()
+{
+	m_nodes.clear();
+	if (m_triangles.empty())
+	{
+		return;
+	}
+
+	std::vector<uint32_t> order(m_triangles.size());
+	std::vector<glm::vec3> centers(m_triangles.size());
+	for (size_t i = 0; i < m_triangles.size(); i++)
+	{
+		const BVH_TRIANGLE& triangle = m_triangles[i];
+		order[i] = (uint32_t)i;
+		centers[i] = triangle.a + (triangle.edge1 + triangle.edge2) / 3.0f;
+	}
+
+	m_nodes.reserve(2 * m_triangles.size() / g_LeafTriangles + 1);
+	BuildNode(order, centers, 0, (uint32_t)order.size(), 0);
+
+	std::vector<BVH_TRIANGLE> sorted(m_triangles.size());
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		sorted[i] = m_triangles[order[i]];
+	}
+	m_triangles.swap(sorted);
+}
+
+/***********************************************************
+ *  BuildNode()
+ *
+ *  This method is used for adding the node of a range of the
+ *  triangle order and splitting the range in two at the
+ *  middle of the longest side of the box around their
+ *  centers.  When every center falls on one side, or the
+ *  tree is already deep, the range is split in half by
+ *  count instead.
+ ***********************************************************/
+uint32_t TriangleBVH::BuildNode(
+	std::vector<uint32_t>& order,
+	const std::vector<glm::vec3>& centers,
+	uint32_t first,
+	uint32_t count,
+	int depth)
+{
+	uint32_t nodeIndex = (uint32_t)m_nodes.size();
+	m_nodes.push_back(BVH_NODE());
+
+	glm::vec3 boundsMin(INFINITY);
+	glm::vec3 boundsMax(-INFINITY);
+	glm::vec3 centerMin(INFINITY);
+	glm::vec3 centerMax(-INFINITY);
+	for (uint32_t i = first; i < first + count; i++)
+	{
+		const BVH_TRIANGLE& triangle = m_triangles[order[i]];
+		glm::vec3 b = triangle.a + triangle.edge1;
+		glm::vec3 c = triangle.a + triangle.edge2;
+		boundsMin = glm::min(boundsMin, glm::min(triangle.a, glm::min(b, c)));
+		boundsMax = glm::max(boundsMax, glm::max(triangle.a, glm::max(b, c)));
+		centerMin = glm::min(centerMin, centers[order[i]]);
+		centerMax = glm::max(centerMax, centers[order[i]]);
+	}
+	m_nodes[nodeIndex].boundsMin = boundsMin;
+	m_nodes[nodeIndex].boundsMax = boundsMax;
+
+	if (count <= g_LeafTriangles)
+	{
+		m_nodes[nodeIndex].firstIndex = first;
+		m_nodes[nodeIndex].triangleCount = count;
+		return(nodeIndex);
+	}
+
+	glm::vec3 extent = centerMax - centerMin;
+	int axis = 0;
+	if (extent.y > extent[axis])
+		axis = 1;
+	if (extent.z > extent[axis])
+		axis = 2;
+	float split = 0.5f * (centerMin[axis] + centerMax[axis]);
+
+	uint32_t* pBegin = order.data() + first;
+	uint32_t* pMiddle = std::partition(pBegin, pBegin + count,
+		[&centers, axis, split](uint32_t triangle) { return centers[triangle][axis] < split; });
+	uint32_t leftCount = (uint32_t)(pMiddle - pBegin);
+	if ((leftCount == 0) || (leftCount == count) || (depth >= g_MaxMiddleSplitDepth))
+	{
+		leftCount = count / 2;
+		std::nth_element(pBegin, pBegin + leftCount, pBegin + count,
+			[&centers, axis](uint32_t a, uint32_t b) { return centers[a][axis] < centers[b][axis]; });
+	}
+
+	// the left child follows its parent, m_nodes may grow so
+	// the parent is only written through its index
+	BuildNode(order, centers, first, leftCount, depth + 1);
+	uint32_t rightIndex = BuildNode(order, centers, first + leftCount, count - leftCount, depth + 1);
+	m_nodes[nodeIndex].firstIndex = rightIndex;
+	m_nodes[nodeIndex].triangleCount = 0;
+	return(nodeIndex);
+}
+
+/***********************************************************
+ *  HitBox()
+ *
+ *  This method is used for intersecting a ray with a box by
+ *  its slabs, returning where the ray enters it, or -1 when
+ *  the ray misses it or enters it beyond the distance.
+ ***********************************************************/
+float TriangleBVH::HitBox(
+	const glm::vec3& boundsMin,
+	const glm::vec3& boundsMax,
+	const glm::vec3& origin,
+	const glm::vec3& inverseDirection,
+	float distance)
+{
+	glm::vec3 t0 = (boundsMin - origin) * inverseDirection;
+	glm::vec3 t1 = (boundsMax - origin) * inverseDirection;
+	glm::vec3 tNear = glm::min(t0, t1);
+	glm::vec3 tFar = glm::max(t0, t1);
+	float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+	float leave = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, distance));
+	return((enter <= leave) ? enter : -1.0f);
+}
+
+/***********************************************************
+ *  IsOccluded()
+ *
+ *  This method is used for checking whether anything lies
+ *  on a ray segment.  The walk stops at the first triangle
+ *  hit, since it does not matter which one is the nearest,
+ *  and the nearer child is visited first so the hit tends
+ *  to come early.  Triangles are hit from both sides.
+ ***********************************************************/
+bool TriangleBVH::IsOccluded(const glm::vec3& origin, const glm::vec3& direction, float distance) const
+{
+	if (m_nodes.empty())
+	{
+		return(false);
+	}
+
+	// a zero component gives an infinite slab distance, which
+	// the box test handles
+	glm::vec3 inverseDirection = glm::vec3(1.0f) / direction;
+
+	uint32_t stack[g_StackSize];
+	int stackSize = 0;
+	uint32_t nodeIndex = 0;
+	if (HitBox(m_nodes[0].boundsMin, m_nodes[0].boundsMax, origin, inverseDirection, distance) < 0.0f)
+	{
+		return(false);
+	}
+
+	for (;;)
+	{
+		const BVH_NODE& node = m_nodes[nodeIndex];
+		if (node.triangleCount > 0)
+		{
+			for (uint32_t i = node.firstIndex; i < node.firstIndex + node.triangleCount; i++)
+			{
+				// Moller-Trumbore
+				const BVH_TRIANGLE& triangle = m_triangles[i];
+				glm::vec3 p = glm::cross(direction, triangle.edge2);
+				float determinant = glm::dot(triangle.edge1, p);
+				if (std::fabs(determinant) < 1e-12f)
+				{
+					continue;
+				}
+				float inverseDeterminant = 1.0f / determinant;
+				glm::vec3 s = origin - triangle.a;
+				float u = glm::dot(s, p) * inverseDeterminant;
+				if ((u < 0.0f) || (u > 1.0f))
+				{
+					continue;
+				}
+				glm::vec3 q = glm::cross(s, triangle.edge1);
+				float v = glm::dot(direction, q) * inverseDeterminant;
+				if ((v < 0.0f) || (u + v > 1.0f))
+				{
+					continue;
+				}
+				float t = glm::dot(triangle.edge2, q) * inverseDeterminant;
+				if ((t > 0.0f) && (t < distance))
+				{
+					return(true);
+				}
+			}
+		}
+		else
+		{
+			uint32_t left = nodeIndex + 1;
+			uint32_t right = node.firstIndex;
+			float leftHit = HitBox(m_nodes[left].boundsMin, m_nodes[left].boundsMax, origin, inverseDirection, distance);
+			float rightHit = HitBox(m_nodes[right].boundsMin, m_nodes[right].boundsMax, origin, inverseDirection, distance);
+			if ((leftHit >= 0.0f) && (rightHit >= 0.0f))
+			{
+				if (rightHit < leftHit)
+				{
+					std::swap(left, right);
+				}
+				stack[stackSize++] = right;
+				nodeIndex = left;
+				continue;
+			}
+			if (leftHit >= 0.0f)
+			{
+				nodeIndex = left;
+				continue;
+			}
+			if (rightHit >= 0.0f)
+			{
+				nodeIndex = right;
+				continue;
+			}
+		}
+
+		if (stackSize == 0)
+		{
+			return(false);
+		}
+		nodeIndex = stack[--stackSize];
+	}
+}
@@ -0,0 +1,85 @@
+///////////////////////////////////////////////////////////////////////////////
+// trianglebvh.h
+// ============
+// bounding volume hierarchy for tracing rays against triangles
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  TriangleBVH
+ *
+ *  This class answers whether a ray segment hits any of a
+ *  set of triangles.  The triangles are sorted into a tree of
+ *  boxes, split at the middle of the longest side of their
+ *  centers, and the tree is stored depth first in one array,
+ *  so a query walks it with a small stack and no pointers.
+ *  Queries only read the tree, so any number of threads can
+ *  trace against it at the same time once it is built.
+ ***********************************************************/
+class TriangleBVH
+{
+public:
+	// constructor
+	TriangleBVH();
+	// destructor
+	~TriangleBVH();
+
+	// drop the triangles and the tree
+	void Clear();
+	// add a triangle in world space
+	void AddTriangle(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c);
+	// build the tree over the added triangles
+	void Build();
+
+	// true when the segment from the origin along the direction
+	// hits a triangle closer than the distance
+	bool IsOccluded(const glm::vec3& origin, const glm::vec3& direction, float distance) const;
+
+	int GetTriangleCount() const { return (int)m_triangles.size(); }
+	int GetNodeCount() const { return (int)m_nodes.size(); }
+
+private:
+	struct BVH_TRIANGLE
+	{
+		glm::vec3 a;
+		glm::vec3 edge1;
+		glm::vec3 edge2;
+	};
+
+	// a leaf holds triangleCount triangles from firstIndex, an
+	// inner node has its left child right after it and its
+	// right child at firstIndex
+	struct BVH_NODE
+	{
+		glm::vec3 boundsMin;
+		uint32_t firstIndex;
+		glm::vec3 boundsMax;
+		uint32_t triangleCount;
+	};
+
+	std::vector<BVH_TRIANGLE> m_triangles;
+	std::vector<BVH_NODE> m_nodes;
+
+	// add the node of the triangles in the range, and its
+	// children, returns the index of the node
+	uint32_t BuildNode(
+		std::vector<uint32_t>& order,
+		const std::vector<glm::vec3>& centers,
+		uint32_t first,
+		uint32_t count,
+		int depth);
+	// distance along the ray at which it enters the box, or a
+	// negative value when it misses it within the distance
+	static float HitBox(
+		const glm::vec3& boundsMin,
+		const glm::vec3& boundsMax,
+		const glm::vec3& origin,
+		const glm::vec3& inverseDirection,
+		float distance);
+};
@@ -9,12 +9,15 @@
 
 #include "ViewManager.h"
 #include "camera.h"
+#include "GLTrace.h"
 
 // GLM Math Header inclusions
 #include <glm/glm.hpp>
 #include <glm/gtx/transform.hpp>
 #include <glm/gtc/type_ptr.hpp>    
 
+#include <algorithm>
+
 
 // declaration of the global variables and defines
 namespace
@@ -37,12 +40,28 @@ namespace
 	// time between current frame and last frame
 	float gDeltaTime = 0.0f; 
 	float gLastFrame = 0.0f;
+	// longest step the camera moves for, so the first key press
+	// after the window was idle does not jump
+	const float g_MaxDeltaTime = 0.1f;
 
 	// the following variable is false when orthographic projection
 	// is off and true when it is on
 	bool bOrthographicProjection = false;
 	float gOrthoZoom = 10.0f; // Default orthographic zoom size
 	bool bProjectionChanged = false; //added
+
+	// cameras of the quad layout, in the space of the drone
+	// they follow, which faces along +Z
+	const glm::vec3 g_ChaseEye = glm::vec3(0.0f, 5.0f, -9.0f);
+	const glm::vec3 g_ChaseTarget = glm::vec3(0.0f, 2.0f, 0.0f);
+	const float g_ChaseFieldOfView = 45.0f;
+	// just ahead of the camera lens
+	const glm::vec3 g_DroneCameraEye = glm::vec3(0.0f, 1.6f, 1.3f);
+	const glm::vec3 g_DroneCameraTarget = glm::vec3(0.0f, 1.2f, 5.0f);
+	const float g_DroneCameraFieldOfView = 60.0f;
+	// the top-down camera looks at the origin from above
+	const float g_TopDownHeight = 30.0f;
+	const float g_TopDownHalfSize = 12.0f;
 	
 
 
@@ -58,6 +77,11 @@ ViewManager::ViewManager(ShaderManager* pShaderManager)
 	// initialize the member variables
 	m_pShaderManager = pShaderManager;
 	m_pWindow = NULL;
+	m_viewMatrix = glm::mat4(1.0f);
+	m_projectionMatrix = glm::mat4(1.0f);
+	m_viewLayout = VIEW_LAYOUT_SINGLE;
+	m_bHudVisible = false;
+	m_bHudChanged = false;
 
 	// create and configure camera
 	g_pCamera = new Camera();
@@ -120,9 +144,9 @@ GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
 		});
 
 
-	// enable blending for supporting tranparent rendering
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	// blending is left disabled here - the scene manager only
+	// enables it for the pass that draws transparent objects
+	glDisable(GL_BLEND);
 
 	m_pWindow = window;
 
@@ -170,6 +194,7 @@ void ViewManager::ProcessKeyboardEvents()
 {
 	static bool pKeyPressed = false;
 	static bool oKeyPressed = false;
+	static bool hKeyPressed = false;
 
 	// Handle window close on ESC
 	if (glfwGetKey(m_pWindow, GLFW_KEY_ESCAPE) == GLFW_PRESS)
@@ -234,6 +259,17 @@ void ViewManager::ProcessKeyboardEvents()
 	{
 		oKeyPressed = false;
 	}
+
+	// Toggle the performance overlay with H (on key press only)
+	if (glfwGetKey(m_pWindow, GLFW_KEY_H) == GLFW_PRESS && !hKeyPressed)
+	{
+		SetHudVisible(!m_bHudVisible);
+		hKeyPressed = true;
+	}
+	if (glfwGetKey(m_pWindow, GLFW_KEY_H) == GLFW_RELEASE)
+	{
+		hKeyPressed = false;
+	}
 }
 
 
@@ -256,29 +292,61 @@ void ViewManager::ProcessMouseScroll(float yoffset)
 
 
 /***********************************************************
- *  PrepareSceneView()
+ *  ProcessInput()
  *
- *  This method is used for preparing the 3D scene by loading
- *  the shapes, textures in memory to support the 3D scene 
- *  rendering
+ *  This method is used for moving the camera from the keys
+ *  that are held down.  It is called once per loop, also
+ *  when no frame is drawn, so changes can be detected.
  ***********************************************************/
-void ViewManager::PrepareSceneView()
+void ViewManager::ProcessInput()
 {
-	glm::mat4 view;
-	glm::mat4 projection;
-
 	// per-frame timing
 	float currentFrame = glfwGetTime();
-	gDeltaTime = currentFrame - gLastFrame;
+	gDeltaTime = std::min(currentFrame - gLastFrame, g_MaxDeltaTime);
 	gLastFrame = currentFrame;
 
 	// process any keyboard events that may be waiting in the 
 	// event queue
 	ProcessKeyboardEvents();
+}
+
+/***********************************************************
+ *  HasViewChanged()
+ *
+ *  This method is used for checking whether the camera or
+ *  the projection changed since the view was last prepared,
+ *  from the mouse, the scroll wheel or the keyboard, or the
+ *  performance overlay was shown or hidden.
+ ***********************************************************/
+bool ViewManager::HasViewChanged() const
+{
+	if (bProjectionChanged || m_bHudChanged)
+	{
+		return(true);
+	}
+
+	glm::mat4 view;
+	glm::mat4 projection;
+	ComputeViewTransform(view, projection);
 
+	return((view != m_viewMatrix) || (projection != m_projectionMatrix));
+}
+
+/***********************************************************
+ *  ComputeViewTransform()
+ *
+ *  This method is used for building the view and projection
+ *  matrices from the camera and the projection mode.
+ ***********************************************************/
+void ViewManager::ComputeViewTransform(glm::mat4& view, glm::mat4& projection) const
+{
 	// get the current view matrix from the camera
 	view = g_pCamera->GetViewMatrix();
 
+	// the window can be resized, so the aspect ratio follows
+	// its framebuffer
+	float aspectRatio = GetAspectRatio();
+
 	// define the current projection matrix
 	//projection = glm::perspective(glm::radians(g_pCamera->Zoom), (GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT, 0.1f, 100.0f);
 	if (bOrthographicProjection)
@@ -286,26 +354,156 @@ void ViewManager::PrepareSceneView()
 		// Orthographic projection with dynamic zoom
 		projection = glm::ortho(
 			-gOrthoZoom, gOrthoZoom,
-			-gOrthoZoom * (float)WINDOW_HEIGHT / (float)WINDOW_WIDTH,
-			gOrthoZoom * (float)WINDOW_HEIGHT / (float)WINDOW_WIDTH,
+			-gOrthoZoom / aspectRatio,
+			gOrthoZoom / aspectRatio,
 			0.1f, 100.0f);
 	}
 	else
 	{
 		// Perspective projection  realistic 3D
-		projection = glm::perspective(glm::radians(g_pCamera->Zoom), (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT, 0.1f, 100.0f);
+		projection = glm::perspective(glm::radians(g_pCamera->Zoom), aspectRatio, 0.1f, 100.0f);
+	}
+}
+
+/***********************************************************
+ *  GetAspectRatio()
+ *
+ *  This method is used for getting the aspect ratio of the
+ *  framebuffer, which has no area while minimized.  The
+ *  quarters of the quad layout have the same aspect ratio.
+ ***********************************************************/
+float ViewManager::GetAspectRatio() const
+{
+	float aspectRatio = (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT;
+	if (NULL != m_pWindow)
+	{
+		int width = 0;
+		int height = 0;
+		glfwGetFramebufferSize(m_pWindow, &width, &height);
+		if ((width > 0) && (height > 0))
+		{
+			aspectRatio = (float)width / (float)height;
+		}
 	}
+	return(aspectRatio);
+}
+
+/***********************************************************
+ *  PrepareSceneView()
+ *
+ *  This method is used for preparing the 3D scene by loading
+ *  the shapes, textures in memory to support the 3D scene 
+ *  rendering
+ ***********************************************************/
+void ViewManager::PrepareSceneView()
+{
+	glm::mat4 view;
+	glm::mat4 projection;
+
+	ComputeViewTransform(view, projection);
 
 	// if the shader manager object is valid
 	if (NULL != m_pShaderManager)
 	{
 		// set the view matrix into the shader for proper rendering
-		m_pShaderManager->setMat4Value(g_ViewName, view);
+		GLTrace::SetMat4(m_pShaderManager, g_ViewName, view);
 		// set the view matrix into the shader for proper rendering
-		m_pShaderManager->setMat4Value(g_ProjectionName, projection);
+		GLTrace::SetMat4(m_pShaderManager, g_ProjectionName, projection);
 		// set the view position of the camera into the shader for proper rendering
-		m_pShaderManager->setVec3Value("viewPosition", g_pCamera->Position);
+		GLTrace::SetVec3(m_pShaderManager, "viewPosition", g_pCamera->Position);
 	}
+	m_viewMatrix = view;
+	m_projectionMatrix = projection;
 	bProjectionChanged = false; // ? Reset it for next frame
+	m_bHudChanged = false;
+
+}
+
+/***********************************************************
+ *  SetHudVisible()
+ *
+ *  This method is used for showing or hiding the performance
+ *  overlay, which the H key toggles.
+ ***********************************************************/
+void ViewManager::SetHudVisible(bool bVisible)
+{
+	if (bVisible != m_bHudVisible)
+	{
+		m_bHudVisible = bVisible;
+		m_bHudChanged = true;
+	}
+}
 
-}
\ No newline at end of file
+/***********************************************************
+ *  IsOrthographic()
+ ***********************************************************/
+bool ViewManager::IsOrthographic() const
+{
+	return(bOrthographicProjection);
+}
+
+/***********************************************************
+ *  SetViewLayout()
+ *
+ *  This method is used for setting how the window is split
+ *  between views.
+ ***********************************************************/
+void ViewManager::SetViewLayout(VIEW_LAYOUT layout)
+{
+	m_viewLayout = layout;
+}
+
+/***********************************************************
+ *  GetRenderViews()
+ *
+ *  This method is used for building the views of the layout
+ *  from the camera transforms of the last PrepareSceneView().
+ *  The quad layout shows the main camera top left, a chase
+ *  camera behind the drone top right, a top-down map bottom
+ *  left and the camera of the drone bottom right.  The
+ *  single layout needs no views.
+ ***********************************************************/
+void ViewManager::GetRenderViews(const glm::mat4& droneTransform, std::vector<RENDER_VIEW>& views) const
+{
+	views.clear();
+	if (VIEW_LAYOUT_QUAD != m_viewLayout)
+	{
+		return;
+	}
+
+	float aspectRatio = GetAspectRatio();
+	glm::vec3 droneUp = glm::normalize(glm::mat3(droneTransform) * glm::vec3(0.0f, 1.0f, 0.0f));
+	RENDER_VIEW view;
+
+	view.view = m_viewMatrix;
+	view.projection = m_projectionMatrix;
+	view.viewport = glm::vec4(0.0f, 0.5f, 0.5f, 0.5f);
+	views.push_back(view);
+
+	view.view = glm::lookAt(
+		glm::vec3(droneTransform * glm::vec4(g_ChaseEye, 1.0f)),
+		glm::vec3(droneTransform * glm::vec4(g_ChaseTarget, 1.0f)),
+		glm::vec3(0.0f, 1.0f, 0.0f));
+	view.projection = glm::perspective(glm::radians(g_ChaseFieldOfView), aspectRatio, 0.1f, 100.0f);
+	view.viewport = glm::vec4(0.5f, 0.5f, 0.5f, 0.5f);
+	views.push_back(view);
+
+	view.view = glm::lookAt(
+		glm::vec3(0.0f, g_TopDownHeight, 0.0f),
+		glm::vec3(0.0f, 0.0f, 0.0f),
+		glm::vec3(0.0f, 0.0f, -1.0f));
+	view.projection = glm::ortho(
+		-g_TopDownHalfSize * aspectRatio, g_TopDownHalfSize * aspectRatio,
+		-g_TopDownHalfSize, g_TopDownHalfSize,
+		0.1f, 100.0f);
+	view.viewport = glm::vec4(0.0f, 0.0f, 0.5f, 0.5f);
+	views.push_back(view);
+
+	view.view = glm::lookAt(
+		glm::vec3(droneTransform * glm::vec4(g_DroneCameraEye, 1.0f)),
+		glm::vec3(droneTransform * glm::vec4(g_DroneCameraTarget, 1.0f)),
+		droneUp);
+	view.projection = glm::perspective(glm::radians(g_DroneCameraFieldOfView), aspectRatio, 0.05f, 100.0f);
+	view.viewport = glm::vec4(0.5f, 0.0f, 0.5f, 0.5f);
+	views.push_back(view);
+}
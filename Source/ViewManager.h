@@ -10,11 +10,22 @@
 #pragma once
 
 #include "ShaderManager.h"
+#include "RenderQueue.h"
 #include "camera.h"
 
 // GLFW library
 #include "GLFW/glfw3.h" 
 
+#include <vector>
+
+// how the window is split between views
+enum VIEW_LAYOUT
+{
+	VIEW_LAYOUT_SINGLE = 0,
+	// main, chase, top-down and drone cameras in four quarters
+	VIEW_LAYOUT_QUAD
+};
+
 class ViewManager
 {
 public:
@@ -33,14 +44,49 @@ private:
 	ShaderManager* m_pShaderManager;
 	// active OpenGL display window
 	GLFWwindow* m_pWindow;
+	// camera transforms of the current frame
+	glm::mat4 m_viewMatrix;
+	glm::mat4 m_projectionMatrix;
+	// how the window is split between views
+	VIEW_LAYOUT m_viewLayout;
+	// whether the performance overlay is shown, and whether
+	// that changed since the view was last prepared
+	bool m_bHudVisible;
+	bool m_bHudChanged;
 
 	// process keyboard events for interaction with the 3D scene
 	void ProcessKeyboardEvents();
+	// build the camera transforms from the current camera state
+	void ComputeViewTransform(glm::mat4& view, glm::mat4& projection) const;
+	// aspect ratio of the framebuffer, or of the default size
+	// while it has no area
+	float GetAspectRatio() const;
 
 public:
 	// create the initial OpenGL display window
 	GLFWwindow* CreateDisplayWindow(const char* windowTitle);
 	
+	// move the camera from the keys held down, once per loop
+	void ProcessInput();
+	// true when the camera moved since the last PrepareSceneView()
+	bool HasViewChanged() const;
+
 	// prepare the conversion from 3D object display to 2D scene display
 	void PrepareSceneView();
+
+	// camera transforms set by the last PrepareSceneView()
+	const glm::mat4& GetViewMatrix() const { return m_viewMatrix; }
+	const glm::mat4& GetProjectionMatrix() const { return m_projectionMatrix; }
+
+	// set how the window is split between views
+	void SetViewLayout(VIEW_LAYOUT layout);
+	VIEW_LAYOUT GetViewLayout() const { return m_viewLayout; }
+	// show or hide the performance overlay
+	void SetHudVisible(bool bVisible);
+	bool IsHudVisible() const { return m_bHudVisible; }
+	// true while the orthographic projection is used
+	bool IsOrthographic() const;
+	// build the views of the layout, the cameras following a
+	// drone are placed by its world transform
+	void GetRenderViews(const glm::mat4& droneTransform, std::vector<RENDER_VIEW>& views) const;
 };
\ No newline at end of file
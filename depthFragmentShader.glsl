@@ -0,0 +1,7 @@
+#version 330 core
+
+// depth-only pre-pass: color writes are masked off, so nothing
+// needs to be computed per fragment
+void main()
+{
+}
@@ -20,10 +20,13 @@ struct LightSource
 };
 
 #define TOTAL_LIGHTS 4
+#define TOTAL_CASCADES 3
+#define TOTAL_POINT_SHADOWS 3
 
-in vec3 fragmentPosition;
-in vec3 fragmentVertexNormal;
-in vec2 fragmentTextureCoordinate;
+layout (location = 0) in vec3 fragmentPosition;
+layout (location = 1) in vec3 fragmentVertexNormal;
+layout (location = 2) in vec2 fragmentTextureCoordinate;
+layout (location = 3) in vec2 fragmentLightmapCoordinate;
 
 out vec4 outFragmentColor;
 
@@ -36,8 +39,27 @@ uniform vec2 UVscale = vec2(1.0f, 1.0f);
 uniform LightSource lightSources[TOTAL_LIGHTS];
 uniform Material material;
 
+// shadow maps - the key light (source 0) uses the cascades, the
+// other lights select a point light cube map, -1 means no shadow
+uniform bool bUseShadows = false;
+uniform sampler2DArrayShadow keyLightShadowMap;
+uniform mat4 cascadeMatrices[TOTAL_CASCADES];
+uniform samplerCubeShadow pointShadowMaps[TOTAL_POINT_SHADOWS];
+uniform float pointShadowFarPlane = 40.0f;
+uniform int lightShadowMaps[TOTAL_LIGHTS] = int[](-1, -1, -1, -1);
+
+// baked light of the static batches - rgb is the ambient light
+// with ambient occlusion plus the diffuse light of the other
+// lights, alpha is the diffuse impact of the key light, both
+// shadowed by the static parts
+uniform bool bUseLightmap = false;
+uniform sampler2D lightmap;
+
 // function prototypes
-vec3 CalcLightSource(LightSource light, vec3 lightNormal, vec3 vertexPosition, vec3 viewDirection);
+vec3 CalcLightSource(LightSource light, vec3 lightNormal, vec3 vertexPosition, vec3 viewDirection, float shadow);
+vec3 CalcSpecular(LightSource light, vec3 lightNormal, vec3 vertexPosition, vec3 viewDirection);
+vec3 CalcLightmapLighting(vec3 lightNormal, vec3 vertexPosition, vec3 viewDirection);
+float CalcShadow(int lightIndex, vec3 vertexPosition);
 
 void main()
 {
@@ -48,10 +70,17 @@ void main()
       vec3 viewDirection = normalize(viewPosition - fragmentPosition);
       vec3 phongResult = vec3(0.0f);
 
-      for(int i = 0; i < TOTAL_LIGHTS; i++)
+      if(bUseLightmap == true)
+      {
+         phongResult = CalcLightmapLighting(lightNormal, fragmentPosition, viewDirection);
+      }
+      else
       {
-         phongResult += CalcLightSource(lightSources[i], lightNormal, fragmentPosition, viewDirection); 
-      }   
+         for(int i = 0; i < TOTAL_LIGHTS; i++)
+         {
+            phongResult += CalcLightSource(lightSources[i], lightNormal, fragmentPosition, viewDirection, CalcShadow(i, fragmentPosition)); 
+         }   
+      }
     
       if(bUseTexture == true)
       {
@@ -76,8 +105,41 @@ void main()
    }
 }
 
+// calculates how much of the light reaches the fragment, 0 is fully shadowed
+float CalcShadow(int lightIndex, vec3 vertexPosition)
+{
+   if(bUseShadows == false)
+   {
+      return(1.0);
+   }
+
+   int shadowMap = lightShadowMaps[lightIndex];
+   if(shadowMap == 0)
+   {
+      // use the first cascade that covers the fragment
+      for(int i = 0; i < TOTAL_CASCADES; i++)
+      {
+         vec4 lightSpace = cascadeMatrices[i] * vec4(vertexPosition, 1.0);
+         vec3 coordinates = lightSpace.xyz / lightSpace.w * 0.5 + 0.5;
+         if(all(greaterThan(coordinates.xy, vec2(0.01))) && all(lessThan(coordinates.xy, vec2(0.99))) && coordinates.z < 1.0)
+         {
+            return(texture(keyLightShadowMap, vec4(coordinates.xy, float(i), coordinates.z)));
+         }
+      }
+   }
+   else if(shadowMap > 0)
+   {
+      // the cube maps hold the linear distance to the light
+      vec3 lightToFragment = vertexPosition - lightSources[lightIndex].position;
+      float reference = length(lightToFragment) / pointShadowFarPlane - 0.005;
+      return(texture(pointShadowMaps[shadowMap - 1], vec4(lightToFragment, reference)));
+   }
+
+   return(1.0);
+}
+
 // calculates the color when using a directional light.
-vec3 CalcLightSource(LightSource light, vec3 lightNormal, vec3 vertexPosition, vec3 viewDirection)
+vec3 CalcLightSource(LightSource light, vec3 lightNormal, vec3 vertexPosition, vec3 viewDirection, float shadow)
 {
    vec3 ambient;
    vec3 diffuse;
@@ -100,11 +162,37 @@ vec3 CalcLightSource(LightSource light, vec3 lightNormal, vec3 vertexPosition, v
 
    //**Calculate Specular lighting**
 
+   specular = CalcSpecular(light, lightNormal, vertexPosition, viewDirection);
+  
+   // the ambient term is not affected by shadows
+   return(ambient + shadow * (diffuse + specular));
+}
+
+// calculates the specular highlight of a light, which depends
+// on the view and is never baked
+vec3 CalcSpecular(LightSource light, vec3 lightNormal, vec3 vertexPosition, vec3 viewDirection)
+{
+   vec3 lightDirection = normalize(light.position - vertexPosition); 
    // Calculate reflection vector
    vec3 reflectDir = reflect(-lightDirection, lightNormal);
    // Calculate specular component
    float specularComponent = pow(max(dot(viewDirection, reflectDir), 0.0), light.focalStrength);
-   specular = (light.specularIntensity * material.shininess) * specularComponent * material.specularColor;
-  
-   return(ambient + diffuse + specular);
+   return((light.specularIntensity * material.shininess) * specularComponent * material.specularColor);
+}
+
+// calculates the color of a lightmapped fragment.  The key
+// light keeps its shadow map so the moving parts still shadow
+// the baked surfaces, the highlights of the other lights are
+// added unshadowed.
+vec3 CalcLightmapLighting(vec3 lightNormal, vec3 vertexPosition, vec3 viewDirection)
+{
+   vec4 baked = texture(lightmap, fragmentLightmapCoordinate);
+   float keyShadow = CalcShadow(0, vertexPosition);
+   vec3 result = baked.rgb + keyShadow * baked.a * material.diffuseColor;
+   result += keyShadow * CalcSpecular(lightSources[0], lightNormal, vertexPosition, viewDirection);
+   for(int i = 1; i < TOTAL_LIGHTS; i++)
+   {
+      result += CalcSpecular(lightSources[i], lightNormal, vertexPosition, viewDirection);
+   }
+   return(result);
 }
\ No newline at end of file
@@ -0,0 +1,14 @@
+#version 440 core
+layout (location = 0) in vec2 fragmentTextureCoordinate;
+layout (location = 1) in vec4 fragmentColor;
+
+out vec4 outFragmentColor;
+
+// coverage of the glyphs, the last cell is solid
+uniform sampler2D glyphAtlas;
+
+void main()
+{
+   float coverage = texture(glyphAtlas, fragmentTextureCoordinate).r;
+   outFragmentColor = vec4(fragmentColor.rgb, fragmentColor.a * coverage);
+}
@@ -0,0 +1,18 @@
+#version 440 core
+// pixels from the top left corner of the window
+layout (location = 0) in vec2 inPosition;
+layout (location = 1) in vec2 inTextureCoordinate;
+layout (location = 2) in vec4 inColor;
+
+layout (location = 0) out vec2 fragmentTextureCoordinate;
+layout (location = 1) out vec4 fragmentColor;
+
+uniform vec2 screenSize;
+
+void main()
+{
+   vec2 ndc = inPosition / screenSize * 2.0 - 1.0;
+   gl_Position = vec4(ndc.x, -ndc.y, 0.0, 1.0);
+   fragmentTextureCoordinate = inTextureCoordinate;
+   fragmentColor = inColor;
+}
@@ -0,0 +1,28 @@
+#version 440 core
+
+// depth-only pre-pass for several viewports in one pass, see
+// multiviewGeometryShader.glsl
+#define MAX_VIEWS 4
+
+layout (triangles, invocations = MAX_VIEWS) in;
+layout (triangle_strip, max_vertices = 3) out;
+
+// must match multiviewGeometryShader.glsl exactly
+invariant gl_Position;
+
+uniform mat4 viewProjections[MAX_VIEWS];
+uniform int viewCount = 1;
+
+void main()
+{
+   if (gl_InvocationID >= viewCount)
+      return;
+
+   for (int i = 0; i < 3; i++)
+   {
+      gl_Position = viewProjections[gl_InvocationID] * gl_in[i].gl_Position;
+      gl_ViewportIndex = gl_InvocationID;
+      EmitVertex();
+   }
+   EndPrimitive();
+}
@@ -0,0 +1,45 @@
+#version 440 core
+
+// draws each triangle into several viewports in one pass, one
+// invocation per view.  The vertex shader runs with identity
+// view and projection matrices, so gl_Position arrives in
+// world space and is projected here for each view.
+#define MAX_VIEWS 4
+
+layout (triangles, invocations = MAX_VIEWS) in;
+layout (triangle_strip, max_vertices = 3) out;
+
+layout (location = 0) in vec3 vertexPosition[];
+layout (location = 1) in vec3 vertexNormal[];
+layout (location = 2) in vec2 vertexTextureCoordinate[];
+layout (location = 3) in vec2 vertexLightmapCoordinate[];
+
+layout (location = 0) out vec3 fragmentPosition;
+layout (location = 1) out vec3 fragmentVertexNormal;
+layout (location = 2) out vec2 fragmentTextureCoordinate;
+layout (location = 3) out vec2 fragmentLightmapCoordinate;
+
+// must match multiviewDepthGeometryShader.glsl exactly so the
+// pre-pass depth values are identical
+invariant gl_Position;
+
+uniform mat4 viewProjections[MAX_VIEWS];
+uniform int viewCount = 1;
+
+void main()
+{
+   if (gl_InvocationID >= viewCount)
+      return;
+
+   for (int i = 0; i < 3; i++)
+   {
+      gl_Position = viewProjections[gl_InvocationID] * gl_in[i].gl_Position;
+      gl_ViewportIndex = gl_InvocationID;
+      fragmentPosition = vertexPosition[i];
+      fragmentVertexNormal = vertexNormal[i];
+      fragmentTextureCoordinate = vertexTextureCoordinate[i];
+      fragmentLightmapCoordinate = vertexLightmapCoordinate[i];
+      EmitVertex();
+   }
+   EndPrimitive();
+}
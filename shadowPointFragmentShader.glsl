@@ -0,0 +1,13 @@
+#version 330 core
+
+in vec3 fragmentPosition;
+
+uniform vec3 lightPosition;
+uniform float farPlane;
+
+// store the linear distance to the light, so the lighting shader
+// can compare against it with a direction-only cube map lookup
+void main()
+{
+   gl_FragDepth = length(fragmentPosition - lightPosition) / farPlane;
+}
@@ -0,0 +1,95 @@
+#version 440 core
+layout (location = 0) in vec2 inGridPosition;
+
+// the same outputs as the main vertex shader, so the terrain
+// is lit and shadowed by the main fragment shader
+layout (location = 0) out vec3 fragmentPosition;
+layout (location = 1) out vec3 fragmentVertexNormal;
+layout (location = 2) out vec2 fragmentTextureCoordinate;
+// the terrain is never lightmapped
+layout (location = 3) out vec2 fragmentLightmapCoordinate;
+
+invariant gl_Position;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+// must match TerrainClipmap::MAX_LEVELS
+#define MAX_TERRAIN_LEVELS 10
+
+// heights of the clipmap levels in world units, one layer per
+// level, each a grid of terrainGridSize samples per side
+uniform sampler2DArray terrainHeights;
+// per level: world x and z of grid sample 0, sample spacing
+uniform vec4 terrainLevels[MAX_TERRAIN_LEVELS];
+uniform int terrainLevelCount;
+uniform int terrainLevel;
+uniform int terrainGridSize;
+// quads along the outer edge of a level that blend into the
+// next coarser level
+uniform float terrainMorphBand;
+// world size of one repeat of the floor texture
+uniform float terrainTextureMeters;
+
+float FetchHeight(int level, ivec2 cell)
+{
+   cell = clamp(cell, ivec2(0), ivec2(terrainGridSize - 1));
+   return texelFetch(terrainHeights, ivec3(cell, level), 0).r;
+}
+
+// bilinear height between the samples of a level, cell in
+// samples of that level
+float SampleHeight(int level, vec2 cell)
+{
+   vec2 uv = (cell + 0.5) / float(terrainGridSize);
+   return texture(terrainHeights, vec3(uv, float(level))).r;
+}
+
+vec3 FetchNormal(int level, ivec2 cell, float spacing)
+{
+   float dx = FetchHeight(level, cell + ivec2(1, 0)) - FetchHeight(level, cell - ivec2(1, 0));
+   float dz = FetchHeight(level, cell + ivec2(0, 1)) - FetchHeight(level, cell - ivec2(0, 1));
+   return normalize(vec3(-dx, 2.0 * spacing, -dz));
+}
+
+vec3 SampleNormal(int level, vec2 cell, float spacing)
+{
+   float dx = SampleHeight(level, cell + vec2(1.0, 0.0)) - SampleHeight(level, cell - vec2(1.0, 0.0));
+   float dz = SampleHeight(level, cell + vec2(0.0, 1.0)) - SampleHeight(level, cell - vec2(0.0, 1.0));
+   return normalize(vec3(-dx, 2.0 * spacing, -dz));
+}
+
+void main()
+{
+   vec4 fine = terrainLevels[terrainLevel];
+   vec2 worldXZ = fine.xy + inGridPosition * fine.z;
+   ivec2 cell = ivec2(inGridPosition);
+   float height = FetchHeight(terrainLevel, cell);
+   vec3 normal = FetchNormal(terrainLevel, cell, fine.z);
+
+   // toward the outer edge the level takes the shape of the
+   // next coarser one.  On the edge it matches it exactly, the
+   // odd samples lying halfway along the coarse edges, so the
+   // rings meet without cracks
+   if (terrainLevel + 1 < terrainLevelCount)
+   {
+      float halfSize = 0.5 * float(terrainGridSize - 1);
+      vec2 fromCenter = abs(inGridPosition - vec2(halfSize));
+      float distance = max(fromCenter.x, fromCenter.y);
+      float morph = clamp((distance - (halfSize - terrainMorphBand)) / terrainMorphBand, 0.0, 1.0);
+      if (morph > 0.0)
+      {
+         vec4 coarse = terrainLevels[terrainLevel + 1];
+         vec2 coarseCell = (worldXZ - coarse.xy) / coarse.z;
+         height = mix(height, SampleHeight(terrainLevel + 1, coarseCell), morph);
+         normal = normalize(mix(normal, SampleNormal(terrainLevel + 1, coarseCell, coarse.z), morph));
+      }
+   }
+
+   vec3 position = vec3(worldXZ.x, height, worldXZ.y);
+   fragmentPosition = position;
+   fragmentVertexNormal = normal;
+   fragmentTextureCoordinate = worldXZ / terrainTextureMeters;
+   fragmentLightmapCoordinate = vec2(0.0);
+   gl_Position = projection * view * vec4(position, 1.0f);
+}
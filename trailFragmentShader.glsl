@@ -0,0 +1,9 @@
+#version 440 core
+layout (location = 0) in vec4 fragmentColor;
+
+out vec4 outFragmentColor;
+
+void main()
+{
+   outFragmentColor = fragmentColor;
+}
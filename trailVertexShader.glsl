@@ -0,0 +1,91 @@
+#version 440 core
+// drone and segment stride of the instance
+layout (location = 0) in uvec2 inTrail;
+
+layout (location = 0) out vec4 fragmentColor;
+
+// ring of samples, row after row of one position per drone,
+// the sample time in seconds in w
+layout (std430, binding = 0) readonly buffer TrailSamples
+{
+   vec4 trailSamples[];
+};
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform vec2 viewportSize;
+// width of the lines in pixels
+uniform float trailWidth;
+uniform int trailDroneCount;
+uniform int trailRowCount;
+uniform int trailNewestRow;
+// seconds of the newest sample and of the whole trail
+uniform float trailTime;
+uniform float trailDuration;
+
+// end of the segment and side of the line of each corner of
+// the two triangles of a segment
+const int segmentEnds[6] = int[6](0, 1, 0, 0, 1, 1);
+const float segmentSides[6] = float[6](-1.0, -1.0, 1.0, 1.0, -1.0, 1.0);
+
+vec4 FetchSample(int age)
+{
+   int row = (trailNewestRow - age + trailRowCount) % trailRowCount;
+   return trailSamples[row * trailDroneCount + int(inTrail.x)];
+}
+
+vec3 HueColor(float hue)
+{
+   vec3 color = abs(mod(hue * 6.0 + vec3(0.0, 4.0, 2.0), 6.0) - 3.0) - 1.0;
+   return clamp(color, 0.0, 1.0);
+}
+
+void main()
+{
+   int stride = int(inTrail.y);
+   int segment = gl_VertexID / 6;
+   int corner = gl_VertexID % 6;
+
+   vec4 newer = FetchSample(segment * stride);
+   vec4 older = FetchSample((segment + 1) * stride);
+   vec4 point = (segmentEnds[corner] == 0) ? newer : older;
+
+   mat4 viewProjection = projection * view;
+   vec4 clipNewer = viewProjection * vec4(newer.xyz, 1.0);
+   vec4 clipOlder = viewProjection * vec4(older.xyz, 1.0);
+
+   // a segment crossing the camera plane is cut at the near
+   // side, one entirely behind it collapses
+   const float nearW = 0.01;
+   if ((clipNewer.w < nearW) && (clipOlder.w < nearW))
+   {
+      gl_Position = vec4(0.0, 0.0, 2.0, 1.0);
+      fragmentColor = vec4(0.0);
+      return;
+   }
+   if (clipNewer.w < nearW)
+   {
+      clipNewer = mix(clipNewer, clipOlder, (nearW - clipNewer.w) / (clipOlder.w - clipNewer.w));
+   }
+   else if (clipOlder.w < nearW)
+   {
+      clipOlder = mix(clipOlder, clipNewer, (nearW - clipOlder.w) / (clipNewer.w - clipOlder.w));
+   }
+
+   // widen the segment across its direction on the screen by
+   // the same number of pixels at any distance
+   vec2 screenDirection = (clipOlder.xy / clipOlder.w - clipNewer.xy / clipNewer.w) * viewportSize;
+   if (dot(screenDirection, screenDirection) < 1e-8)
+   {
+      screenDirection = vec2(1.0, 0.0);
+   }
+   vec2 across = normalize(vec2(-screenDirection.y, screenDirection.x));
+
+   vec4 position = (segmentEnds[corner] == 0) ? clipNewer : clipOlder;
+   position.xy += across * segmentSides[corner] * trailWidth / viewportSize * position.w;
+   gl_Position = position;
+
+   float age = clamp((trailTime - point.w) / trailDuration, 0.0, 1.0);
+   float hue = fract(float(inTrail.x) * 0.618034);
+   fragmentColor = vec4(HueColor(hue), (1.0 - age) * (1.0 - age));
+}
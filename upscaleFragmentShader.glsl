@@ -0,0 +1,58 @@
+#version 330 core
+
+// upscale the scene rendered at the dynamic resolution to the
+// window with a Catmull-Rom filter.  The scene only covers the
+// lower left part of the texture, so every tap is clamped to
+// the rendered texels.
+in vec2 fragmentTextureCoordinate;
+
+out vec4 outFragmentColor;
+
+uniform sampler2D sourceTexture;
+// size of the rendered part and of the whole texture, in texels
+uniform vec2 sourceSize;
+uniform vec2 textureSize;
+
+vec3 SampleClamped(vec2 texelPosition)
+{
+    texelPosition = clamp(texelPosition, vec2(0.5), sourceSize - 0.5);
+    return texture(sourceTexture, texelPosition / textureSize).rgb;
+}
+
+// the 16 taps of the bicubic filter folded into 9 bilinear
+// samples by merging the two middle taps of each axis
+vec3 SampleCatmullRom(vec2 texelPosition)
+{
+    vec2 center = floor(texelPosition - 0.5) + 0.5;
+    vec2 f = texelPosition - center;
+
+    vec2 w0 = f * (-0.5 + f * (1.0 - 0.5 * f));
+    vec2 w1 = 1.0 + f * f * (-2.5 + 1.5 * f);
+    vec2 w2 = f * (0.5 + f * (2.0 - 1.5 * f));
+    vec2 w3 = f * f * (-0.5 + 0.5 * f);
+
+    vec2 w12 = w1 + w2;
+    vec2 position0 = center - 1.0;
+    vec2 position12 = center + w2 / w12;
+    vec2 position3 = center + 2.0;
+
+    vec3 color =
+        SampleClamped(vec2(position0.x, position0.y)) * w0.x * w0.y +
+        SampleClamped(vec2(position12.x, position0.y)) * w12.x * w0.y +
+        SampleClamped(vec2(position3.x, position0.y)) * w3.x * w0.y +
+        SampleClamped(vec2(position0.x, position12.y)) * w0.x * w12.y +
+        SampleClamped(vec2(position12.x, position12.y)) * w12.x * w12.y +
+        SampleClamped(vec2(position3.x, position12.y)) * w3.x * w12.y +
+        SampleClamped(vec2(position0.x, position3.y)) * w0.x * w3.y +
+        SampleClamped(vec2(position12.x, position3.y)) * w12.x * w3.y +
+        SampleClamped(vec2(position3.x, position3.y)) * w3.x * w3.y;
+
+    // the negative lobes can overshoot next to hard edges
+    return clamp(color, 0.0, 1.0);
+}
+
+void main()
+{
+    vec3 color = SampleCatmullRom(fragmentTextureCoordinate * sourceSize);
+    outFragmentColor = vec4(color, 1.0);
+}
@@ -0,0 +1,12 @@
+#version 330 core
+
+// one triangle covering the whole window, built from the vertex
+// index so the upscale pass needs no vertex buffer
+out vec2 fragmentTextureCoordinate;
+
+void main()
+{
+    vec2 corner = vec2(float((gl_VertexID << 1) & 2), float(gl_VertexID & 2));
+    fragmentTextureCoordinate = corner;
+    gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+}
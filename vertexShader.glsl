@@ -1,20 +1,83 @@
-#version 330 core
+#version 440 core
 layout (location = 0) in vec3 inVertexPosition;
 layout (location = 1) in vec3 inVertexNormal;
 layout (location = 2) in vec2 inTextureCoordinate;
+// the static batches drawn with lightmaps carry the atlas
+// coordinate in the tangent
+layout (location = 3) in vec4 inTangent;
 
-out vec3 fragmentPosition;
-out vec3 fragmentVertexNormal;
-out vec2 fragmentTextureCoordinate;
+// the outputs have locations so the multiview geometry shader
+// can pass them on under the same names
+layout (location = 0) out vec3 fragmentPosition;
+layout (location = 1) out vec3 fragmentVertexNormal;
+layout (location = 2) out vec2 fragmentTextureCoordinate;
+layout (location = 3) out vec2 fragmentLightmapCoordinate;
+
+// keeps the depth identical to the depth pre-pass shader
+invariant gl_Position;
 
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 
+// part animations, uploaded once by the AnimationManager and
+// evaluated from the clock.  Must be the same in all the
+// vertex shaders so the depth of animated parts matches.
+#define MAX_PART_ANIMATIONS 256
+
+struct PartAnimation
+{
+   vec4 spin;          // unit axis, radians per second
+   vec4 bob;           // peak offset, radians per second
+   vec4 scalePhase;    // part scale, start angle
+};
+
+layout (std140) uniform PartAnimations
+{
+   vec4 animationClock;    // x = seconds
+   PartAnimation partAnimations[MAX_PART_ANIMATIONS];
+};
+
+// index of the animation of the drawn part, -1 for none
+uniform int animationIndex = -1;
+
+vec3 RotateAxisAngle(vec3 v, vec3 axis, float angle)
+{
+   float c = cos(angle);
+   float s = sin(angle);
+   return v * c + cross(axis, v) * s + axis * dot(axis, v) * (1.0 - c);
+}
+
+// the part is turned at its real size and scaled back, so the
+// model matrix scale does not shear it while it spins
+vec3 AnimatePosition(vec3 position)
+{
+   if (animationIndex < 0)
+      return position;
+
+   PartAnimation animation = partAnimations[animationIndex];
+   float time = animationClock.x;
+   vec3 scaled = position * animation.scalePhase.xyz;
+   scaled = RotateAxisAngle(scaled, animation.spin.xyz, animation.spin.w * time + animation.scalePhase.w);
+   scaled += animation.bob.xyz * sin(animation.bob.w * time + animation.scalePhase.w);
+   return scaled / animation.scalePhase.xyz;
+}
+
+vec3 AnimateNormal(vec3 normal)
+{
+   if (animationIndex < 0)
+      return normal;
+
+   PartAnimation animation = partAnimations[animationIndex];
+   return RotateAxisAngle(normal, animation.spin.xyz, animation.spin.w * animationClock.x + animation.scalePhase.w);
+}
+
 void main()
 {
-   fragmentPosition = vec3(model * vec4(inVertexPosition, 1.0));
-   gl_Position = projection * view * model * vec4(inVertexPosition, 1.0f);
-   fragmentVertexNormal = inVertexNormal;
+   vec3 position = AnimatePosition(inVertexPosition);
+   fragmentPosition = vec3(model * vec4(position, 1.0));
+   gl_Position = projection * view * model * vec4(position, 1.0f);
+   fragmentVertexNormal = AnimateNormal(inVertexNormal);
    fragmentTextureCoordinate = inTextureCoordinate;
-}
\ No newline at end of file
+   fragmentLightmapCoordinate = inTangent.xy;
+}